@@ -0,0 +1,864 @@
+#include "AsyncFileQueue.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+namespace
+{
+    // Big enough to keep a read at full bandwidth, small enough that a large file does not
+    // occupy the whole queue.
+    const std::uint32_t ChunkSize = 2 * 1024 * 1024;
+
+#if defined(_WIN32)
+    typedef HANDLE FileHandle;
+    const FileHandle InvalidFile = INVALID_HANDLE_VALUE;
+#else
+    typedef int FileHandle;
+    const FileHandle InvalidFile = -1;
+#endif
+
+    struct ReadJob;
+
+    struct ReadChunk
+    {
+#if defined(_WIN32)
+        // Completion packets hand back this pointer, so it stays the first member.
+        OVERLAPPED Overlapped;
+#else
+        iovec Vector;
+#endif
+        ReadJob* Job = nullptr;
+        std::uint64_t Offset = 0;
+        std::uint8_t* Destination = nullptr;
+        std::uint32_t Size = 0;
+
+        // Filled in by the driver: bytes transferred, or the error code.
+        std::uint32_t Transferred = 0;
+        int Error = 0;
+    };
+
+    struct ReadJob
+    {
+        FileReadRequest Request;
+        FileHandle File = InvalidFile;
+        bool bOverlapped = false;
+        FileReadResult Result;
+        std::uint8_t* Destination = nullptr;
+        std::uint64_t Size = 0;
+        std::vector<ReadChunk> Chunks;
+        std::size_t ChunksLeft = 0;
+    };
+
+    int GetLastErrorCode()
+    {
+#if defined(_WIN32)
+        return (int)GetLastError();
+#else
+        return errno;
+#endif
+    }
+
+    void CloseFile(FileHandle file)
+    {
+        if (file == InvalidFile)
+            return;
+#if defined(_WIN32)
+        CloseHandle(file);
+#else
+        close(file);
+#endif
+    }
+
+    bool OpenFile(const std::string& fileName, bool bOverlapped, FileHandle& file, std::uint64_t& fileSize)
+    {
+#if defined(_WIN32)
+        int Length = MultiByteToWideChar(CP_ACP, 0, fileName.c_str(), -1, nullptr, 0);
+        if (Length <= 0)
+            return false;
+
+        std::wstring WideName(Length - 1, L'\0');
+        MultiByteToWideChar(CP_ACP, 0, fileName.c_str(), -1, &WideName[0], Length);
+
+        DWORD Flags = FILE_ATTRIBUTE_NORMAL | (bOverlapped ? FILE_FLAG_OVERLAPPED : 0);
+        file = CreateFileW(WideName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, Flags, nullptr);
+        if (file == InvalidFile)
+            return false;
+
+        LARGE_INTEGER Size = {};
+        if (!GetFileSizeEx(file, &Size))
+        {
+            DWORD Error = GetLastError();
+            CloseFile(file);
+            file = InvalidFile;
+            SetLastError(Error);
+            return false;
+        }
+
+        fileSize = (std::uint64_t)Size.QuadPart;
+        return true;
+#else
+        (void)bOverlapped;
+
+        file = open(fileName.c_str(), O_RDONLY | O_CLOEXEC);
+        if (file < 0)
+            return false;
+
+        struct stat Info;
+        if (fstat(file, &Info) != 0)
+        {
+            int Error = errno;
+            CloseFile(file);
+            file = InvalidFile;
+            errno = Error;
+            return false;
+        }
+
+        fileSize = (std::uint64_t)Info.st_size;
+        return true;
+#endif
+    }
+
+    // Positioned read on the calling thread.
+    void ReadBlocking(ReadChunk& chunk)
+    {
+#if defined(_WIN32)
+        OVERLAPPED Overlapped = {};
+        Overlapped.Offset = (DWORD)chunk.Offset;
+        Overlapped.OffsetHigh = (DWORD)(chunk.Offset >> 32);
+
+        // Files opened for a completion port before the queue fell back to threads read
+        // asynchronously even here.  Wait on an event of our own; its low bit keeps the
+        // completion packet away from the port.
+        HANDLE Event = nullptr;
+        if (chunk.Job->bOverlapped)
+        {
+            Event = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+            if (Event == nullptr)
+            {
+                chunk.Error = (int)GetLastError();
+                return;
+            }
+            Overlapped.hEvent = (HANDLE)((std::uintptr_t)Event | 1);
+        }
+
+        DWORD Transferred = 0;
+        BOOL bRead = ReadFile(chunk.Job->File, chunk.Destination, chunk.Size, &Transferred, &Overlapped);
+        if (!bRead && GetLastError() == ERROR_IO_PENDING)
+            bRead = GetOverlappedResult(chunk.Job->File, &Overlapped, &Transferred, TRUE);
+
+        if (bRead)
+            chunk.Transferred = Transferred;
+        else if (GetLastError() != ERROR_HANDLE_EOF)
+            chunk.Error = (int)GetLastError();
+
+        if (Event != nullptr)
+            CloseHandle(Event);
+#else
+        for (;;)
+        {
+            ssize_t Transferred = pread(chunk.Job->File, chunk.Destination, chunk.Size, (off_t)chunk.Offset);
+            if (Transferred >= 0)
+            {
+                chunk.Transferred = (std::uint32_t)Transferred;
+                break;
+            }
+            if (errno != EINTR)
+            {
+                chunk.Error = errno;
+                break;
+            }
+        }
+#endif
+    }
+
+    // Issues chunk reads and reports them back once they finish.  Only the queue's I/O
+    // thread calls into a driver.
+    class FileIODriver
+    {
+    public:
+        virtual ~FileIODriver() = default;
+
+        virtual const char* GetName()const = 0;
+        virtual bool UsesOverlappedFiles()const { return false; }
+        virtual bool Attach(FileHandle) { return true; }
+
+        // Returns false when the read finished (or failed) immediately; the chunk's result
+        // is then already filled in and no completion follows.
+        virtual bool Issue(ReadChunk& chunk) = 0;
+
+        // Hands batched submissions to the OS.
+        virtual void Flush() {}
+
+        // Blocks until at least one issued chunk has finished.  Returns 0, or an error code
+        // once the driver can no longer report completions; the queue then stops using it.
+        virtual int WaitCompletions(std::vector<ReadChunk*>& done) = 0;
+    };
+
+    class ThreadDriver : public FileIODriver
+    {
+    public:
+        explicit ThreadDriver(std::uint32_t queueDepth)
+            : m_Pool((std::min)(queueDepth, 16u))
+        {
+        }
+
+        const char* GetName()const override { return "threads"; }
+
+        bool Issue(ReadChunk& chunk) override
+        {
+            ReadChunk* Chunk = &chunk;
+            m_Pool.Submit([this, Chunk]()
+            {
+                ReadBlocking(*Chunk);
+
+                std::lock_guard<std::mutex> Lock(m_Mutex);
+                m_Done.push_back(Chunk);
+                m_Condition.notify_one();
+            });
+            return true;
+        }
+
+        int WaitCompletions(std::vector<ReadChunk*>& done) override
+        {
+            std::unique_lock<std::mutex> Lock(m_Mutex);
+            m_Condition.wait(Lock, [this]() { return !m_Done.empty(); });
+            done.insert(done.end(), m_Done.begin(), m_Done.end());
+            m_Done.clear();
+            return 0;
+        }
+
+    private:
+        std::mutex m_Mutex;
+        std::condition_variable m_Condition;
+        std::vector<ReadChunk*> m_Done;
+
+        // Declared last so the workers are joined before the members they touch go away.
+        ThreadPool m_Pool;
+    };
+
+#if defined(_WIN32)
+
+    class IocpDriver : public FileIODriver
+    {
+    public:
+        ~IocpDriver()
+        {
+            if (m_Port)
+                CloseHandle(m_Port);
+        }
+
+        bool Init()
+        {
+            m_Port = CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 1);
+            return m_Port != nullptr;
+        }
+
+        const char* GetName()const override { return "iocp"; }
+        bool UsesOverlappedFiles()const override { return true; }
+
+        bool Attach(FileHandle file) override
+        {
+            return CreateIoCompletionPort(file, m_Port, 0, 0) != nullptr;
+        }
+
+        bool Issue(ReadChunk& chunk) override
+        {
+            std::memset(&chunk.Overlapped, 0, sizeof(chunk.Overlapped));
+            chunk.Overlapped.Offset = (DWORD)chunk.Offset;
+            chunk.Overlapped.OffsetHigh = (DWORD)(chunk.Offset >> 32);
+
+            // A read that completes synchronously still posts a packet to the port.
+            if (ReadFile(chunk.Job->File, chunk.Destination, chunk.Size, nullptr, &chunk.Overlapped))
+                return true;
+
+            DWORD Error = GetLastError();
+            if (Error == ERROR_IO_PENDING)
+                return true;
+            if (Error != ERROR_HANDLE_EOF)
+                chunk.Error = (int)Error;
+            return false;
+        }
+
+        int WaitCompletions(std::vector<ReadChunk*>& done) override
+        {
+            // With no timeout this only fails when the port itself is unusable.
+            OVERLAPPED_ENTRY Entries[64];
+            ULONG Count = 0;
+            if (!GetQueuedCompletionStatusEx(m_Port, Entries, _countof(Entries), &Count, INFINITE, FALSE))
+                return (int)GetLastError();
+
+            for (ULONG i = 0; i < Count; ++i)
+            {
+                ReadChunk* Chunk = reinterpret_cast<ReadChunk*>(Entries[i].lpOverlapped);
+
+                DWORD Transferred = 0;
+                if (GetOverlappedResult(Chunk->Job->File, &Chunk->Overlapped, &Transferred, FALSE))
+                    Chunk->Transferred = Transferred;
+                else if (GetLastError() != ERROR_HANDLE_EOF)
+                    Chunk->Error = (int)GetLastError();
+
+                done.push_back(Chunk);
+            }
+            return 0;
+        }
+
+    private:
+        HANDLE m_Port = nullptr;
+    };
+
+#elif defined(__linux__)
+
+    // io_uring through the raw system calls so that liburing is not needed.  The queue
+    // keeps at most queueDepth reads in flight, which is also the ring size, so neither
+    // ring can overflow.
+    class UringDriver : public FileIODriver
+    {
+    public:
+        ~UringDriver()
+        {
+            if (m_Sqes)
+                munmap(m_Sqes, m_SqesBytes);
+            if (m_CqRing && m_CqRing != m_SqRing)
+                munmap(m_CqRing, m_CqBytes);
+            if (m_SqRing)
+                munmap(m_SqRing, m_SqBytes);
+            if (m_Ring >= 0)
+                close(m_Ring);
+        }
+
+        bool Init(std::uint32_t entries)
+        {
+            io_uring_params Params;
+            std::memset(&Params, 0, sizeof(Params));
+
+            m_Ring = (int)syscall(__NR_io_uring_setup, entries, &Params);
+            if (m_Ring < 0)
+                return false;
+
+            m_SqBytes = Params.sq_off.array + Params.sq_entries * sizeof(std::uint32_t);
+            m_CqBytes = Params.cq_off.cqes + Params.cq_entries * sizeof(io_uring_cqe);
+
+            const bool bSingleMap = (Params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+            if (bSingleMap)
+                m_SqBytes = m_CqBytes = (std::max)(m_SqBytes, m_CqBytes);
+
+            m_SqRing = MapRing(m_SqBytes, IORING_OFF_SQ_RING);
+            if (!m_SqRing)
+                return false;
+
+            m_CqRing = bSingleMap ? m_SqRing : MapRing(m_CqBytes, IORING_OFF_CQ_RING);
+            if (!m_CqRing)
+                return false;
+
+            m_SqesBytes = Params.sq_entries * sizeof(io_uring_sqe);
+            m_Sqes = static_cast<io_uring_sqe*>(MapRing(m_SqesBytes, IORING_OFF_SQES));
+            if (!m_Sqes)
+                return false;
+
+            m_SqEntries = Params.sq_entries;
+            m_SqHead = RingField(m_SqRing, Params.sq_off.head);
+            m_SqTail = RingField(m_SqRing, Params.sq_off.tail);
+            m_SqMask = *RingField(m_SqRing, Params.sq_off.ring_mask);
+            m_SqArray = RingField(m_SqRing, Params.sq_off.array);
+
+            m_CqHead = RingField(m_CqRing, Params.cq_off.head);
+            m_CqTail = RingField(m_CqRing, Params.cq_off.tail);
+            m_CqMask = *RingField(m_CqRing, Params.cq_off.ring_mask);
+            m_Cqes = reinterpret_cast<io_uring_cqe*>(static_cast<std::uint8_t*>(m_CqRing) + Params.cq_off.cqes);
+            return true;
+        }
+
+        const char* GetName()const override { return "io_uring"; }
+
+        bool Issue(ReadChunk& chunk) override
+        {
+            std::uint32_t Tail = *m_SqTail;
+            if (Tail - __atomic_load_n(m_SqHead, __ATOMIC_ACQUIRE) >= m_SqEntries)
+            {
+                Flush();
+                Tail = *m_SqTail;
+            }
+
+            chunk.Vector.iov_base = chunk.Destination;
+            chunk.Vector.iov_len = chunk.Size;
+
+            // READV rather than READ so that 5.1 kernels work too.
+            const std::uint32_t Index = Tail & m_SqMask;
+            io_uring_sqe& Entry = m_Sqes[Index];
+            std::memset(&Entry, 0, sizeof(Entry));
+            Entry.opcode = IORING_OP_READV;
+            Entry.fd = chunk.Job->File;
+            Entry.addr = (std::uint64_t)(std::uintptr_t)&chunk.Vector;
+            Entry.len = 1;
+            Entry.off = chunk.Offset;
+            Entry.user_data = (std::uint64_t)(std::uintptr_t)&chunk;
+
+            m_SqArray[Index] = Index;
+            __atomic_store_n(m_SqTail, Tail + 1, __ATOMIC_RELEASE);
+            ++m_Unsubmitted;
+            return true;
+        }
+
+        void Flush() override
+        {
+            // A hard error shows up again in WaitCompletions, which submits what is left.
+            Enter(0, 0);
+        }
+
+        int WaitCompletions(std::vector<ReadChunk*>& done) override
+        {
+            std::uint32_t Head = *m_CqHead;
+            while (Head == __atomic_load_n(m_CqTail, __ATOMIC_ACQUIRE))
+            {
+                const int Error = Enter(1, IORING_ENTER_GETEVENTS);
+                if (Error != 0)
+                    return Error;
+            }
+
+            for (; Head != __atomic_load_n(m_CqTail, __ATOMIC_ACQUIRE); ++Head)
+            {
+                const io_uring_cqe& Entry = m_Cqes[Head & m_CqMask];
+                ReadChunk* Chunk = reinterpret_cast<ReadChunk*>((std::uintptr_t)Entry.user_data);
+
+                if (Entry.res >= 0)
+                    Chunk->Transferred = (std::uint32_t)Entry.res;
+                else
+                    Chunk->Error = -Entry.res;
+
+                done.push_back(Chunk);
+            }
+
+            __atomic_store_n(m_CqHead, Head, __ATOMIC_RELEASE);
+            return 0;
+        }
+
+    private:
+        void* MapRing(std::size_t bytes, off_t offset)
+        {
+            void* Ring = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_Ring, offset);
+            return Ring == MAP_FAILED ? nullptr : Ring;
+        }
+
+        static std::uint32_t* RingField(void* ring, std::uint32_t offset)
+        {
+            return reinterpret_cast<std::uint32_t*>(static_cast<std::uint8_t*>(ring) + offset);
+        }
+
+        // Returns 0, or the errno of a failure that retrying will not fix (EBADF, EFAULT).
+        int Enter(std::uint32_t minComplete, std::uint32_t flags)
+        {
+            for (;;)
+            {
+                int Submitted = (int)syscall(__NR_io_uring_enter, m_Ring, m_Unsubmitted, minComplete, flags, nullptr, 0);
+                if (Submitted >= 0)
+                {
+                    m_Unsubmitted -= (std::min)((std::uint32_t)Submitted, m_Unsubmitted);
+                    if (m_Unsubmitted == 0 || minComplete > 0)
+                        return 0;
+                }
+                else if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+                {
+                    return errno;
+                }
+            }
+        }
+
+    private:
+        int m_Ring = -1;
+
+        void* m_SqRing = nullptr;
+        void* m_CqRing = nullptr;
+        io_uring_sqe* m_Sqes = nullptr;
+        std::size_t m_SqBytes = 0;
+        std::size_t m_CqBytes = 0;
+        std::size_t m_SqesBytes = 0;
+
+        std::uint32_t m_SqEntries = 0;
+        std::uint32_t* m_SqHead = nullptr;
+        std::uint32_t* m_SqTail = nullptr;
+        std::uint32_t m_SqMask = 0;
+        std::uint32_t* m_SqArray = nullptr;
+
+        std::uint32_t* m_CqHead = nullptr;
+        std::uint32_t* m_CqTail = nullptr;
+        std::uint32_t m_CqMask = 0;
+        io_uring_cqe* m_Cqes = nullptr;
+
+        std::uint32_t m_Unsubmitted = 0;
+    };
+
+#endif
+
+    std::unique_ptr<FileIODriver> CreateDriver(std::uint32_t queueDepth, FileIOBackend backend)
+    {
+        if (backend != FileIOBackend::Threads)
+        {
+#if defined(_WIN32)
+            std::unique_ptr<IocpDriver> Driver(new IocpDriver());
+            if (Driver->Init())
+                return std::unique_ptr<FileIODriver>(Driver.release());
+#elif defined(__linux__)
+            std::unique_ptr<UringDriver> Driver(new UringDriver());
+            if (Driver->Init(queueDepth))
+                return std::unique_ptr<FileIODriver>(Driver.release());
+#endif
+        }
+
+        return std::unique_ptr<FileIODriver>(new ThreadDriver(queueDepth));
+    }
+}
+
+class AsyncFileQueue::Impl
+{
+public:
+    Impl(std::uint32_t queueDepth, FileIOBackend backend)
+        : m_QueueDepth((std::max)(queueDepth, 1u))
+        , m_Driver(CreateDriver(m_QueueDepth, backend))
+    {
+        m_Thread = std::thread([this]() { IOLoop(); });
+    }
+
+    ~Impl()
+    {
+        {
+            std::lock_guard<std::mutex> Lock(m_Mutex);
+            m_bStop = true;
+        }
+        m_Condition.notify_all();
+        m_Thread.join();
+    }
+
+    void Submit(FileReadRequest&& request)
+    {
+        {
+            std::lock_guard<std::mutex> Lock(m_Mutex);
+            m_Pending.push_back(std::move(request));
+            ++m_Outstanding;
+            ++m_Stats.Requests;
+        }
+        m_Condition.notify_all();
+    }
+
+    void WaitIdle()
+    {
+        std::unique_lock<std::mutex> Lock(m_Mutex);
+        m_IdleCondition.wait(Lock, [this]() { return m_Outstanding == 0; });
+    }
+
+    const char* GetBackendName()const
+    {
+        std::lock_guard<std::mutex> Lock(m_Mutex);
+        return m_Driver->GetName();
+    }
+
+    FileIOStats GetStats()const
+    {
+        std::lock_guard<std::mutex> Lock(m_Mutex);
+        return m_Stats;
+    }
+
+private:
+    void IOLoop()
+    {
+        std::vector<ReadChunk*> Done;
+
+        for (;;)
+        {
+            // Only open more files while the chunk backlog is short; every started job
+            // holds an open handle and its whole buffer.
+            std::deque<FileReadRequest> Starting;
+            {
+                std::unique_lock<std::mutex> Lock(m_Mutex);
+                if (m_InFlight == 0 && m_Ready.empty())
+                {
+                    m_Condition.wait(Lock, [this]() { return m_bStop || !m_Pending.empty(); });
+                    if (m_Pending.empty())
+                        return;
+                }
+
+                while (!m_Pending.empty() && m_Ready.size() < m_QueueDepth)
+                {
+                    Starting.push_back(std::move(m_Pending.front()));
+                    m_Pending.pop_front();
+                }
+            }
+
+            for (FileReadRequest& Request : Starting)
+            {
+                StartJob(std::move(Request));
+            }
+
+            while (!m_Ready.empty() && m_InFlight < m_QueueDepth)
+            {
+                ReadChunk* Chunk = m_Ready.front();
+                m_Ready.pop_front();
+
+                if (m_Driver->Issue(*Chunk))
+                {
+                    ++m_InFlight;
+                    m_Issued.insert(Chunk);
+                }
+                else
+                {
+                    FinishChunk(*Chunk);
+                }
+            }
+            m_Driver->Flush();
+
+            // New submissions wait here until something completes; with reads in flight
+            // that is never long, and it saves a wake-up channel into every driver.
+            if (m_InFlight > 0)
+            {
+                Done.clear();
+                const int Error = m_Driver->WaitCompletions(Done);
+
+                for (ReadChunk* Chunk : Done)
+                {
+                    --m_InFlight;
+                    m_Issued.erase(Chunk);
+                    FinishChunk(*Chunk);
+                }
+
+                if (Error != 0)
+                    FallBack(Error);
+            }
+        }
+    }
+
+    // The driver cannot report completions any more.  Fail the chunks it still holds and
+    // read everything else on threads.
+    void FallBack(int error)
+    {
+        std::unique_ptr<FileIODriver> Failed;
+        {
+            std::lock_guard<std::mutex> Lock(m_Mutex);
+            Failed = std::move(m_Driver);
+            m_Driver.reset(new ThreadDriver(m_QueueDepth));
+            ++m_Stats.DriverFailures;
+        }
+
+        // Tear the ring or port down before the buffers of its reads go back to the callers.
+        Failed.reset();
+
+        std::vector<ReadChunk*> Lost(m_Issued.begin(), m_Issued.end());
+        m_Issued.clear();
+        m_InFlight = 0;
+
+        for (ReadChunk* Chunk : Lost)
+        {
+            Chunk->Error = error;
+            FinishChunk(*Chunk);
+        }
+    }
+
+    void StartJob(FileReadRequest&& request)
+    {
+        std::unique_ptr<ReadJob> Job(new ReadJob());
+        Job->Request = std::move(request);
+
+        std::uint64_t FileSize = 0;
+        Job->bOverlapped = m_Driver->UsesOverlappedFiles();
+        if (!OpenFile(Job->Request.FileName, Job->bOverlapped, Job->File, FileSize) ||
+            !m_Driver->Attach(Job->File))
+        {
+            Job->Result.Error = GetLastErrorCode();
+            FinishJob(Job.release());
+            return;
+        }
+
+        const FileReadRequest& Request = Job->Request;
+        if (Request.Offset > FileSize)
+        {
+#if defined(_WIN32)
+            Job->Result.Error = ERROR_HANDLE_EOF;
+#else
+            Job->Result.Error = EINVAL;
+#endif
+            FinishJob(Job.release());
+            return;
+        }
+
+        Job->Size = Request.Size == FileReadRequest::WholeFile ? FileSize - Request.Offset : Request.Size;
+        if (Job->Size > (std::size_t)-1)
+        {
+#if defined(_WIN32)
+            Job->Result.Error = ERROR_NOT_ENOUGH_MEMORY;
+#else
+            Job->Result.Error = ENOMEM;
+#endif
+            FinishJob(Job.release());
+            return;
+        }
+
+        if (Request.Destination)
+        {
+            Job->Destination = static_cast<std::uint8_t*>(Request.Destination);
+        }
+        else
+        {
+            Job->Result.Data.resize((std::size_t)Job->Size);
+            Job->Destination = Job->Result.Data.data();
+        }
+
+        const std::size_t ChunkCount = (std::size_t)((Job->Size + ChunkSize - 1) / ChunkSize);
+        if (ChunkCount == 0)
+        {
+            FinishJob(Job.release());
+            return;
+        }
+
+        Job->Chunks.resize(ChunkCount);
+        Job->ChunksLeft = ChunkCount;
+
+        ReadJob* Owner = Job.release();
+        for (std::size_t i = 0; i < ChunkCount; ++i)
+        {
+            const std::uint64_t Start = (std::uint64_t)i * ChunkSize;
+
+            ReadChunk& Chunk = Owner->Chunks[i];
+            Chunk.Job = Owner;
+            Chunk.Offset = Owner->Request.Offset + Start;
+            Chunk.Destination = Owner->Destination + Start;
+            Chunk.Size = (std::uint32_t)(std::min)((std::uint64_t)ChunkSize, Owner->Size - Start);
+            m_Ready.push_back(&Chunk);
+        }
+
+        std::lock_guard<std::mutex> Lock(m_Mutex);
+        m_Stats.Chunks += ChunkCount;
+    }
+
+    void FinishChunk(ReadChunk& chunk)
+    {
+        ReadJob* Job = chunk.Job;
+        Job->Result.BytesRead += chunk.Transferred;
+
+        // Short read: issue the rest again before the job is allowed to finish.  A zero
+        // byte read means the file is shorter than the range and ends the chunk.
+        if (chunk.Error == 0 && chunk.Transferred > 0 && chunk.Transferred < chunk.Size)
+        {
+            chunk.Offset += chunk.Transferred;
+            chunk.Destination += chunk.Transferred;
+            chunk.Size -= chunk.Transferred;
+            chunk.Transferred = 0;
+            m_Ready.push_front(&chunk);
+
+            std::lock_guard<std::mutex> Lock(m_Mutex);
+            ++m_Stats.ShortReads;
+            return;
+        }
+
+        if (chunk.Error != 0 && Job->Result.Error == 0)
+            Job->Result.Error = chunk.Error;
+
+        if (--Job->ChunksLeft == 0)
+            FinishJob(Job);
+    }
+
+    void FinishJob(ReadJob* job)
+    {
+        std::unique_ptr<ReadJob> Job(job);
+        CloseFile(Job->File);
+
+        FileReadResult& Result = Job->Result;
+        Result.bOk = Result.Error == 0 && Job->File != InvalidFile && Result.BytesRead == Job->Size;
+        if (!Result.bOk && Result.Data.size() > Result.BytesRead)
+            Result.Data.resize((std::size_t)Result.BytesRead);
+
+        {
+            std::lock_guard<std::mutex> Lock(m_Mutex);
+            m_Stats.Bytes += Result.BytesRead;
+            if (!Result.bOk)
+                ++m_Stats.Failed;
+        }
+
+        if (Job->Request.OnComplete)
+            Job->Request.OnComplete(std::move(Result));
+
+        {
+            std::lock_guard<std::mutex> Lock(m_Mutex);
+            --m_Outstanding;
+        }
+        m_IdleCondition.notify_all();
+    }
+
+private:
+    const std::uint32_t m_QueueDepth;
+    std::unique_ptr<FileIODriver> m_Driver;
+    std::thread m_Thread;
+
+    mutable std::mutex m_Mutex;
+    std::condition_variable m_Condition;
+    std::condition_variable m_IdleCondition;
+    std::deque<FileReadRequest> m_Pending;
+    std::size_t m_Outstanding = 0;
+    FileIOStats m_Stats;
+    bool m_bStop = false;
+
+    // Owned by the I/O thread.
+    std::deque<ReadChunk*> m_Ready;
+    std::unordered_set<ReadChunk*> m_Issued;
+    std::uint32_t m_InFlight = 0;
+};
+
+AsyncFileQueue::AsyncFileQueue(std::uint32_t queueDepth, FileIOBackend backend)
+    : m_Impl(new Impl(queueDepth, backend))
+{
+}
+
+AsyncFileQueue::~AsyncFileQueue() = default;
+
+void AsyncFileQueue::Submit(FileReadRequest request)
+{
+    m_Impl->Submit(std::move(request));
+}
+
+std::future<FileReadResult> AsyncFileQueue::Read(const std::string& fileName, std::uint64_t offset, std::uint64_t size)
+{
+    auto Promise = std::make_shared<std::promise<FileReadResult>>();
+    std::future<FileReadResult> Result = Promise->get_future();
+
+    FileReadRequest Request;
+    Request.FileName = fileName;
+    Request.Offset = offset;
+    Request.Size = size;
+    Request.OnComplete = [Promise](FileReadResult result) { Promise->set_value(std::move(result)); };
+    Submit(std::move(Request));
+
+    return Result;
+}
+
+void AsyncFileQueue::WaitIdle()
+{
+    m_Impl->WaitIdle();
+}
+
+const char* AsyncFileQueue::GetBackendName()const
+{
+    return m_Impl->GetBackendName();
+}
+
+FileIOStats AsyncFileQueue::GetStats()const
+{
+    return m_Impl->GetStats();
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct FileReadResult
+{
+    bool bOk = false;
+
+    // GetLastError() on Windows, errno elsewhere.  0 with bOk false means the file ended
+    // before the requested range did.
+    int Error = 0;
+
+    std::uint64_t BytesRead = 0;
+
+    // Filled only when the request had no Destination.
+    std::vector<std::uint8_t> Data;
+};
+
+struct FileReadRequest
+{
+    static const std::uint64_t WholeFile = ~0ull;
+
+    std::string FileName;
+    std::uint64_t Offset = 0;
+
+    // WholeFile reads from Offset to the end of the file.
+    std::uint64_t Size = WholeFile;
+
+    // Optional caller-owned buffer of at least Size bytes.  It must stay alive until
+    // OnComplete has run.
+    void* Destination = nullptr;
+
+    // Runs on the queue's I/O thread, so keep it short (fulfil a promise, hand the data to
+    // a worker) and do not let it throw.
+    std::function<void(FileReadResult)> OnComplete;
+};
+
+enum class FileIOBackend
+{
+    // Native when the platform supports it, otherwise Threads.
+    Auto,
+
+    // Blocking positioned reads on a small worker pool.
+    Threads,
+
+    // Overlapped ReadFile on an I/O completion port (Windows) or io_uring (Linux).
+    Native,
+};
+
+struct FileIOStats
+{
+    std::uint64_t Requests = 0;
+    std::uint64_t Failed = 0;
+    std::uint64_t Bytes = 0;
+    std::uint64_t Chunks = 0;
+
+    // Chunks issued again after the OS returned fewer bytes than asked for.
+    std::uint64_t ShortReads = 0;
+
+    // Times the native driver failed and the queue went on with threads; the chunks it
+    // had in flight fail with its error.
+    std::uint32_t DriverFailures = 0;
+};
+
+// Batches file reads and keeps up to queueDepth chunk reads in flight at once, so loaders
+// can submit everything they need up front and pick the results up later.  Large requests
+// are split into chunks so that one big file does not hold back the small ones.
+class AsyncFileQueue
+{
+public:
+    // Native falls back to Threads when the backend cannot be created (io_uring disabled
+    // in the kernel, for example); GetBackendName reports what is actually used.
+    explicit AsyncFileQueue(std::uint32_t queueDepth = 32, FileIOBackend backend = FileIOBackend::Auto);
+
+    // Finishes every submitted request before returning.
+    ~AsyncFileQueue();
+
+    AsyncFileQueue(const AsyncFileQueue&) = delete;
+    AsyncFileQueue& operator=(const AsyncFileQueue&) = delete;
+
+    void Submit(FileReadRequest request);
+
+    std::future<FileReadResult> Read(const std::string& fileName,
+        std::uint64_t offset = 0, std::uint64_t size = FileReadRequest::WholeFile);
+
+    // Blocks until every request submitted so far has completed.
+    void WaitIdle();
+
+    const char* GetBackendName()const;
+    FileIOStats GetStats()const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> m_Impl;
+};
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+// Records a frame as an ordered list of jobs, each into a command list of its own, on a
+// ThreadPool.  Job i always records into list i, so submitting the lists by index keeps
+// the order the jobs were added in no matter which worker finishes first.  Has no
+// graphics API dependency: CommandList is ID3D12GraphicsCommandList in the sample and a
+// mock in TextureTool record-sim.
+template<typename CommandList>
+class CommandListRecorder
+{
+public:
+    typedef std::function<void(CommandList&)> RecordFunc;
+    typedef std::function<void(CommandList&, std::size_t, std::size_t)> RangeFunc;
+
+    void Reset() { m_Jobs.clear(); }
+
+    std::size_t GetJobCount()const { return m_Jobs.size(); }
+
+    void AddJob(RecordFunc record)
+    {
+        m_Jobs.push_back(std::move(record));
+    }
+
+    // Splits [0, itemCount) into chunks of at most chunkSize items.  Every chunk gets a job
+    // that replays setup (root signature, heaps, pass constants, targets) on its own list
+    // before drawing its range, since state does not carry over between command lists.
+    // Adds nothing when itemCount is 0.
+    void AddPass(RecordFunc setup, std::size_t itemCount, std::size_t chunkSize, RangeFunc draw)
+    {
+        chunkSize = (std::max)(chunkSize, (std::size_t)1);
+
+        for (std::size_t Begin = 0; Begin < itemCount; Begin += chunkSize)
+        {
+            const std::size_t End = (std::min)(Begin + chunkSize, itemCount);
+            m_Jobs.push_back([setup, draw, Begin, End](CommandList& cmdList)
+            {
+                setup(cmdList);
+                draw(cmdList, Begin, End);
+            });
+        }
+    }
+
+    // begin(i) returns the list job i records into, ready for recording; end(i, list) closes
+    // it.  Both run on the thread that records job i.  Returns once every job is recorded;
+    // an exception from a job is rethrown here after the others have finished.
+    template<typename BeginFunc, typename EndFunc>
+    void Record(ThreadPool& pool, BeginFunc begin, EndFunc end)
+    {
+        pool.ParallelFor(m_Jobs.size(), [&](std::size_t i) { RecordJob(i, begin, end); });
+    }
+
+    // Same result on the calling thread only.
+    template<typename BeginFunc, typename EndFunc>
+    void RecordSerial(BeginFunc begin, EndFunc end)
+    {
+        for (std::size_t i = 0; i < m_Jobs.size(); ++i)
+        {
+            RecordJob(i, begin, end);
+        }
+    }
+
+private:
+    template<typename BeginFunc, typename EndFunc>
+    void RecordJob(std::size_t i, BeginFunc& begin, EndFunc& end)
+    {
+        CommandList& List = begin(i);
+        m_Jobs[i](List);
+        end(i, List);
+    }
+
+private:
+    std::vector<RecordFunc> m_Jobs;
+};
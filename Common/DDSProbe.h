@@ -0,0 +1,671 @@
+//--------------------------------------------------------------------------------------
+// File: DDSProbe.h
+//
+// Header-only DDS metadata probe.  Reads the fixed header region of a file (magic,
+// DDS_HEADER and the optional DX10 extension, 148 bytes at most) and works out the
+// texture description and its byte sizes without touching any pixel data.
+//
+// The format properties live in a constexpr table so they can be looked up in constant
+// expressions and checked with static_assert.  They describe the same formats as
+// DDS::BitsPerPixel / DDS::GetSurfaceInfo in DDSHeader.cpp; 'TextureTool probe --verify'
+// compares the two.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include "DDSHeader.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace DDS
+{
+    enum class FormatLayout : uint8_t
+    {
+        Unknown,    // no size information, the loaders reject these
+        Linear,     // BitsPerPixel per texel, rows rounded up to whole bytes
+        Block,      // 4x4 blocks of BytesPerElement bytes (BC1-BC7)
+        Packed,     // two texels share BytesPerElement bytes (YUY2, RGBG, Y210, ...)
+        Planar,     // full resolution luma plane followed by a half height chroma plane
+        NV11,       // 4:1:1, sized the way Direct3D sizes it
+    };
+
+    struct FormatInfo
+    {
+        uint8_t         BitsPerPixel = 0;
+        uint8_t         BytesPerElement = 0;
+        FormatLayout    Layout = FormatLayout::Unknown;
+        bool            bSRGB = false;
+    };
+
+    struct SurfaceSize
+    {
+        uint64_t    RowBytes = 0;
+        uint64_t    NumRows = 0;    // rows of blocks for block-compressed formats
+        uint64_t    NumBytes = 0;
+    };
+
+    namespace Detail
+    {
+        constexpr uint8_t GetBitsPerPixel(uint32_t fmt)
+        {
+            switch (fmt)
+            {
+            case DXGI_FORMAT_R32G32B32A32_TYPELESS:
+            case DXGI_FORMAT_R32G32B32A32_FLOAT:
+            case DXGI_FORMAT_R32G32B32A32_UINT:
+            case DXGI_FORMAT_R32G32B32A32_SINT:
+                return 128;
+
+            case DXGI_FORMAT_R32G32B32_TYPELESS:
+            case DXGI_FORMAT_R32G32B32_FLOAT:
+            case DXGI_FORMAT_R32G32B32_UINT:
+            case DXGI_FORMAT_R32G32B32_SINT:
+                return 96;
+
+            case DXGI_FORMAT_R16G16B16A16_TYPELESS:
+            case DXGI_FORMAT_R16G16B16A16_FLOAT:
+            case DXGI_FORMAT_R16G16B16A16_UNORM:
+            case DXGI_FORMAT_R16G16B16A16_UINT:
+            case DXGI_FORMAT_R16G16B16A16_SNORM:
+            case DXGI_FORMAT_R16G16B16A16_SINT:
+            case DXGI_FORMAT_R32G32_TYPELESS:
+            case DXGI_FORMAT_R32G32_FLOAT:
+            case DXGI_FORMAT_R32G32_UINT:
+            case DXGI_FORMAT_R32G32_SINT:
+            case DXGI_FORMAT_R32G8X24_TYPELESS:
+            case DXGI_FORMAT_D32_FLOAT_S8X24_UINT:
+            case DXGI_FORMAT_R32_FLOAT_X8X24_TYPELESS:
+            case DXGI_FORMAT_X32_TYPELESS_G8X24_UINT:
+            case DXGI_FORMAT_Y416:
+            case DXGI_FORMAT_Y210:
+            case DXGI_FORMAT_Y216:
+                return 64;
+
+            case DXGI_FORMAT_R10G10B10A2_TYPELESS:
+            case DXGI_FORMAT_R10G10B10A2_UNORM:
+            case DXGI_FORMAT_R10G10B10A2_UINT:
+            case DXGI_FORMAT_R11G11B10_FLOAT:
+            case DXGI_FORMAT_R8G8B8A8_TYPELESS:
+            case DXGI_FORMAT_R8G8B8A8_UNORM:
+            case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+            case DXGI_FORMAT_R8G8B8A8_UINT:
+            case DXGI_FORMAT_R8G8B8A8_SNORM:
+            case DXGI_FORMAT_R8G8B8A8_SINT:
+            case DXGI_FORMAT_R16G16_TYPELESS:
+            case DXGI_FORMAT_R16G16_FLOAT:
+            case DXGI_FORMAT_R16G16_UNORM:
+            case DXGI_FORMAT_R16G16_UINT:
+            case DXGI_FORMAT_R16G16_SNORM:
+            case DXGI_FORMAT_R16G16_SINT:
+            case DXGI_FORMAT_R32_TYPELESS:
+            case DXGI_FORMAT_D32_FLOAT:
+            case DXGI_FORMAT_R32_FLOAT:
+            case DXGI_FORMAT_R32_UINT:
+            case DXGI_FORMAT_R32_SINT:
+            case DXGI_FORMAT_R24G8_TYPELESS:
+            case DXGI_FORMAT_D24_UNORM_S8_UINT:
+            case DXGI_FORMAT_R24_UNORM_X8_TYPELESS:
+            case DXGI_FORMAT_X24_TYPELESS_G8_UINT:
+            case DXGI_FORMAT_R9G9B9E5_SHAREDEXP:
+            case DXGI_FORMAT_R8G8_B8G8_UNORM:
+            case DXGI_FORMAT_G8R8_G8B8_UNORM:
+            case DXGI_FORMAT_B8G8R8A8_UNORM:
+            case DXGI_FORMAT_B8G8R8X8_UNORM:
+            case DXGI_FORMAT_R10G10B10_XR_BIAS_A2_UNORM:
+            case DXGI_FORMAT_B8G8R8A8_TYPELESS:
+            case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+            case DXGI_FORMAT_B8G8R8X8_TYPELESS:
+            case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+            case DXGI_FORMAT_AYUV:
+            case DXGI_FORMAT_Y410:
+            case DXGI_FORMAT_YUY2:
+                return 32;
+
+            case DXGI_FORMAT_P010:
+            case DXGI_FORMAT_P016:
+                return 24;
+
+            case DXGI_FORMAT_R8G8_TYPELESS:
+            case DXGI_FORMAT_R8G8_UNORM:
+            case DXGI_FORMAT_R8G8_UINT:
+            case DXGI_FORMAT_R8G8_SNORM:
+            case DXGI_FORMAT_R8G8_SINT:
+            case DXGI_FORMAT_R16_TYPELESS:
+            case DXGI_FORMAT_R16_FLOAT:
+            case DXGI_FORMAT_D16_UNORM:
+            case DXGI_FORMAT_R16_UNORM:
+            case DXGI_FORMAT_R16_UINT:
+            case DXGI_FORMAT_R16_SNORM:
+            case DXGI_FORMAT_R16_SINT:
+            case DXGI_FORMAT_B5G6R5_UNORM:
+            case DXGI_FORMAT_B5G5R5A1_UNORM:
+            case DXGI_FORMAT_A8P8:
+            case DXGI_FORMAT_B4G4R4A4_UNORM:
+                return 16;
+
+            case DXGI_FORMAT_NV12:
+            case DXGI_FORMAT_420_OPAQUE:
+            case DXGI_FORMAT_NV11:
+                return 12;
+
+            case DXGI_FORMAT_R8_TYPELESS:
+            case DXGI_FORMAT_R8_UNORM:
+            case DXGI_FORMAT_R8_UINT:
+            case DXGI_FORMAT_R8_SNORM:
+            case DXGI_FORMAT_R8_SINT:
+            case DXGI_FORMAT_A8_UNORM:
+            case DXGI_FORMAT_AI44:
+            case DXGI_FORMAT_IA44:
+            case DXGI_FORMAT_P8:
+            case DXGI_FORMAT_BC2_TYPELESS:
+            case DXGI_FORMAT_BC2_UNORM:
+            case DXGI_FORMAT_BC2_UNORM_SRGB:
+            case DXGI_FORMAT_BC3_TYPELESS:
+            case DXGI_FORMAT_BC3_UNORM:
+            case DXGI_FORMAT_BC3_UNORM_SRGB:
+            case DXGI_FORMAT_BC5_TYPELESS:
+            case DXGI_FORMAT_BC5_UNORM:
+            case DXGI_FORMAT_BC5_SNORM:
+            case DXGI_FORMAT_BC6H_TYPELESS:
+            case DXGI_FORMAT_BC6H_UF16:
+            case DXGI_FORMAT_BC6H_SF16:
+            case DXGI_FORMAT_BC7_TYPELESS:
+            case DXGI_FORMAT_BC7_UNORM:
+            case DXGI_FORMAT_BC7_UNORM_SRGB:
+                return 8;
+
+            case DXGI_FORMAT_BC1_TYPELESS:
+            case DXGI_FORMAT_BC1_UNORM:
+            case DXGI_FORMAT_BC1_UNORM_SRGB:
+            case DXGI_FORMAT_BC4_TYPELESS:
+            case DXGI_FORMAT_BC4_UNORM:
+            case DXGI_FORMAT_BC4_SNORM:
+                return 4;
+
+            case DXGI_FORMAT_R1_UNORM:
+                return 1;
+
+            default:
+                return 0;
+            }
+        }
+
+        constexpr FormatInfo ClassifyFormat(uint32_t fmt)
+        {
+            FormatInfo Info;
+            Info.BitsPerPixel = GetBitsPerPixel(fmt);
+            Info.Layout = Info.BitsPerPixel ? FormatLayout::Linear : FormatLayout::Unknown;
+
+            switch (fmt)
+            {
+            case DXGI_FORMAT_BC1_TYPELESS:
+            case DXGI_FORMAT_BC1_UNORM:
+            case DXGI_FORMAT_BC1_UNORM_SRGB:
+            case DXGI_FORMAT_BC4_TYPELESS:
+            case DXGI_FORMAT_BC4_UNORM:
+            case DXGI_FORMAT_BC4_SNORM:
+                Info.Layout = FormatLayout::Block;
+                Info.BytesPerElement = 8;
+                break;
+
+            case DXGI_FORMAT_BC2_TYPELESS:
+            case DXGI_FORMAT_BC2_UNORM:
+            case DXGI_FORMAT_BC2_UNORM_SRGB:
+            case DXGI_FORMAT_BC3_TYPELESS:
+            case DXGI_FORMAT_BC3_UNORM:
+            case DXGI_FORMAT_BC3_UNORM_SRGB:
+            case DXGI_FORMAT_BC5_TYPELESS:
+            case DXGI_FORMAT_BC5_UNORM:
+            case DXGI_FORMAT_BC5_SNORM:
+            case DXGI_FORMAT_BC6H_TYPELESS:
+            case DXGI_FORMAT_BC6H_UF16:
+            case DXGI_FORMAT_BC6H_SF16:
+            case DXGI_FORMAT_BC7_TYPELESS:
+            case DXGI_FORMAT_BC7_UNORM:
+            case DXGI_FORMAT_BC7_UNORM_SRGB:
+                Info.Layout = FormatLayout::Block;
+                Info.BytesPerElement = 16;
+                break;
+
+            case DXGI_FORMAT_R8G8_B8G8_UNORM:
+            case DXGI_FORMAT_G8R8_G8B8_UNORM:
+            case DXGI_FORMAT_YUY2:
+                Info.Layout = FormatLayout::Packed;
+                Info.BytesPerElement = 4;
+                break;
+
+            case DXGI_FORMAT_Y210:
+            case DXGI_FORMAT_Y216:
+                Info.Layout = FormatLayout::Packed;
+                Info.BytesPerElement = 8;
+                break;
+
+            case DXGI_FORMAT_NV12:
+            case DXGI_FORMAT_420_OPAQUE:
+                Info.Layout = FormatLayout::Planar;
+                Info.BytesPerElement = 2;
+                break;
+
+            case DXGI_FORMAT_P010:
+            case DXGI_FORMAT_P016:
+                Info.Layout = FormatLayout::Planar;
+                Info.BytesPerElement = 4;
+                break;
+
+            case DXGI_FORMAT_NV11:
+                Info.Layout = FormatLayout::NV11;
+                Info.BytesPerElement = 4;
+                break;
+
+            default:
+                break;
+            }
+
+            Info.bSRGB =
+                fmt == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB || fmt == DXGI_FORMAT_B8G8R8A8_UNORM_SRGB ||
+                fmt == DXGI_FORMAT_B8G8R8X8_UNORM_SRGB || fmt == DXGI_FORMAT_BC1_UNORM_SRGB ||
+                fmt == DXGI_FORMAT_BC2_UNORM_SRGB || fmt == DXGI_FORMAT_BC3_UNORM_SRGB ||
+                fmt == DXGI_FORMAT_BC7_UNORM_SRGB;
+
+            return Info;
+        }
+
+        // Every format dxgiformat.h defined up to B4G4R4A4_UNORM.  Later additions are
+        // video formats the loaders reject anyway.
+        constexpr size_t FormatTableSize = size_t(DXGI_FORMAT_B4G4R4A4_UNORM) + 1;
+
+        struct FormatTableData
+        {
+            FormatInfo Entries[FormatTableSize];
+        };
+
+        constexpr FormatTableData BuildFormatTable()
+        {
+            FormatTableData Table = {};
+            for (size_t i = 0; i < FormatTableSize; ++i)
+            {
+                Table.Entries[i] = ClassifyFormat(uint32_t(i));
+            }
+            return Table;
+        }
+
+        // Built by the compiler; lookups are a bounds check and an index.
+        constexpr FormatTableData FormatTable = BuildFormatTable();
+
+        // A D3D9 style DDS_PIXELFORMAT and the DXGI format it maps to.  Flags holds the one
+        // DDS_RGB / DDS_LUMINANCE / DDS_ALPHA / DDS_FOURCC bit the entry is for.
+        struct LegacyFormat
+        {
+            uint32_t    Flags;
+            uint32_t    FourCC;
+            uint32_t    BitCount;
+            uint32_t    RMask;
+            uint32_t    GMask;
+            uint32_t    BMask;
+            uint32_t    AMask;
+            DXGI_FORMAT Format;
+        };
+
+        // Same mappings, in the same order, as DDS::GetDXGIFormat.
+        constexpr LegacyFormat LegacyFormatTable[] =
+        {
+            { DDS_RGB, 0, 32, 0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000, DXGI_FORMAT_R8G8B8A8_UNORM },
+            { DDS_RGB, 0, 32, 0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000, DXGI_FORMAT_B8G8R8A8_UNORM },
+            { DDS_RGB, 0, 32, 0x00ff0000, 0x0000ff00, 0x000000ff, 0x00000000, DXGI_FORMAT_B8G8R8X8_UNORM },
+            { DDS_RGB, 0, 32, 0x3ff00000, 0x000ffc00, 0x000003ff, 0xc0000000, DXGI_FORMAT_R10G10B10A2_UNORM }, // D3DX's swapped masks
+            { DDS_RGB, 0, 32, 0x0000ffff, 0xffff0000, 0x00000000, 0x00000000, DXGI_FORMAT_R16G16_UNORM },
+            { DDS_RGB, 0, 32, 0xffffffff, 0x00000000, 0x00000000, 0x00000000, DXGI_FORMAT_R32_FLOAT },
+            { DDS_RGB, 0, 16, 0x7c00, 0x03e0, 0x001f, 0x8000, DXGI_FORMAT_B5G5R5A1_UNORM },
+            { DDS_RGB, 0, 16, 0xf800, 0x07e0, 0x001f, 0x0000, DXGI_FORMAT_B5G6R5_UNORM },
+            { DDS_RGB, 0, 16, 0x0f00, 0x00f0, 0x000f, 0xf000, DXGI_FORMAT_B4G4R4A4_UNORM },
+
+            { DDS_LUMINANCE, 0, 8, 0x000000ff, 0x00000000, 0x00000000, 0x00000000, DXGI_FORMAT_R8_UNORM },
+            { DDS_LUMINANCE, 0, 16, 0x0000ffff, 0x00000000, 0x00000000, 0x00000000, DXGI_FORMAT_R16_UNORM },
+            { DDS_LUMINANCE, 0, 16, 0x000000ff, 0x00000000, 0x00000000, 0x0000ff00, DXGI_FORMAT_R8G8_UNORM },
+
+            // Masks are not checked for alpha-only formats.
+            { DDS_ALPHA, 0, 8, 0, 0, 0, 0, DXGI_FORMAT_A8_UNORM },
+
+            { DDS_FOURCC, MAKEFOURCC('D', 'X', 'T', '1'), 0, 0, 0, 0, 0, DXGI_FORMAT_BC1_UNORM },
+            { DDS_FOURCC, MAKEFOURCC('D', 'X', 'T', '3'), 0, 0, 0, 0, 0, DXGI_FORMAT_BC2_UNORM },
+            { DDS_FOURCC, MAKEFOURCC('D', 'X', 'T', '5'), 0, 0, 0, 0, 0, DXGI_FORMAT_BC3_UNORM },
+            { DDS_FOURCC, MAKEFOURCC('D', 'X', 'T', '2'), 0, 0, 0, 0, 0, DXGI_FORMAT_BC2_UNORM },
+            { DDS_FOURCC, MAKEFOURCC('D', 'X', 'T', '4'), 0, 0, 0, 0, 0, DXGI_FORMAT_BC3_UNORM },
+            { DDS_FOURCC, MAKEFOURCC('A', 'T', 'I', '1'), 0, 0, 0, 0, 0, DXGI_FORMAT_BC4_UNORM },
+            { DDS_FOURCC, MAKEFOURCC('B', 'C', '4', 'U'), 0, 0, 0, 0, 0, DXGI_FORMAT_BC4_UNORM },
+            { DDS_FOURCC, MAKEFOURCC('B', 'C', '4', 'S'), 0, 0, 0, 0, 0, DXGI_FORMAT_BC4_SNORM },
+            { DDS_FOURCC, MAKEFOURCC('A', 'T', 'I', '2'), 0, 0, 0, 0, 0, DXGI_FORMAT_BC5_UNORM },
+            { DDS_FOURCC, MAKEFOURCC('B', 'C', '5', 'U'), 0, 0, 0, 0, 0, DXGI_FORMAT_BC5_UNORM },
+            { DDS_FOURCC, MAKEFOURCC('B', 'C', '5', 'S'), 0, 0, 0, 0, 0, DXGI_FORMAT_BC5_SNORM },
+            { DDS_FOURCC, MAKEFOURCC('R', 'G', 'B', 'G'), 0, 0, 0, 0, 0, DXGI_FORMAT_R8G8_B8G8_UNORM },
+            { DDS_FOURCC, MAKEFOURCC('G', 'R', 'G', 'B'), 0, 0, 0, 0, 0, DXGI_FORMAT_G8R8_G8B8_UNORM },
+            { DDS_FOURCC, MAKEFOURCC('Y', 'U', 'Y', '2'), 0, 0, 0, 0, 0, DXGI_FORMAT_YUY2 },
+
+            // D3DFORMAT values stored in the FourCC field
+            { DDS_FOURCC, 36, 0, 0, 0, 0, 0, DXGI_FORMAT_R16G16B16A16_UNORM },  // D3DFMT_A16B16G16R16
+            { DDS_FOURCC, 110, 0, 0, 0, 0, 0, DXGI_FORMAT_R16G16B16A16_SNORM }, // D3DFMT_Q16W16V16U16
+            { DDS_FOURCC, 111, 0, 0, 0, 0, 0, DXGI_FORMAT_R16_FLOAT },          // D3DFMT_R16F
+            { DDS_FOURCC, 112, 0, 0, 0, 0, 0, DXGI_FORMAT_R16G16_FLOAT },       // D3DFMT_G16R16F
+            { DDS_FOURCC, 113, 0, 0, 0, 0, 0, DXGI_FORMAT_R16G16B16A16_FLOAT }, // D3DFMT_A16B16G16R16F
+            { DDS_FOURCC, 114, 0, 0, 0, 0, 0, DXGI_FORMAT_R32_FLOAT },          // D3DFMT_R32F
+            { DDS_FOURCC, 115, 0, 0, 0, 0, 0, DXGI_FORMAT_R32G32_FLOAT },       // D3DFMT_G32R32F
+            { DDS_FOURCC, 116, 0, 0, 0, 0, 0, DXGI_FORMAT_R32G32B32A32_FLOAT }, // D3DFMT_A32B32G32R32F
+        };
+
+        template<typename T>
+        T ReadAt(const uint8_t* data)
+        {
+            T Value;
+            memcpy(&Value, data, sizeof(T));
+            return Value;
+        }
+    }
+
+    constexpr FormatInfo GetFormatInfo(DXGI_FORMAT fmt)
+    {
+        return uint32_t(fmt) < Detail::FormatTableSize ? Detail::FormatTable.Entries[uint32_t(fmt)] : FormatInfo();
+    }
+
+    // Same results as DDS::GetSurfaceInfo, in 64 bits.
+    constexpr SurfaceSize ComputeSurfaceSize(uint64_t width, uint64_t height, DXGI_FORMAT fmt)
+    {
+        const FormatInfo Info = GetFormatInfo(fmt);
+
+        SurfaceSize Size;
+        switch (Info.Layout)
+        {
+        case FormatLayout::Block:
+        {
+            const uint64_t BlocksWide = width > 0 ? (width + 3) / 4 : 0;
+            const uint64_t BlocksHigh = height > 0 ? (height + 3) / 4 : 0;
+            Size.RowBytes = BlocksWide * Info.BytesPerElement;
+            Size.NumRows = BlocksHigh;
+            Size.NumBytes = Size.RowBytes * BlocksHigh;
+            break;
+        }
+
+        case FormatLayout::Packed:
+            Size.RowBytes = ((width + 1) >> 1) * Info.BytesPerElement;
+            Size.NumRows = height;
+            Size.NumBytes = Size.RowBytes * height;
+            break;
+
+        case FormatLayout::NV11:
+            Size.RowBytes = ((width + 3) >> 2) * 4;
+            Size.NumRows = height * 2;
+            Size.NumBytes = Size.RowBytes * Size.NumRows;
+            break;
+
+        case FormatLayout::Planar:
+            Size.RowBytes = ((width + 1) >> 1) * Info.BytesPerElement;
+            Size.NumBytes = (Size.RowBytes * height) + ((Size.RowBytes * height + 1) >> 1);
+            Size.NumRows = height + ((height + 1) >> 1);
+            break;
+
+        case FormatLayout::Linear:
+        case FormatLayout::Unknown:
+            Size.RowBytes = (width * Info.BitsPerPixel + 7) / 8;
+            Size.NumRows = height;
+            Size.NumBytes = Size.RowBytes * height;
+            break;
+        }
+
+        return Size;
+    }
+
+    // Table driven DDS::GetDXGIFormat.
+    constexpr DXGI_FORMAT FindLegacyFormat(const DDS_PIXELFORMAT& ddpf)
+    {
+        // The first of these flags that is set decides how the rest is read.
+        const uint32_t Kind =
+            (ddpf.flags & DDS_RGB) ? DDS_RGB :
+            (ddpf.flags & DDS_LUMINANCE) ? DDS_LUMINANCE :
+            (ddpf.flags & DDS_ALPHA) ? DDS_ALPHA :
+            (ddpf.flags & DDS_FOURCC) ? DDS_FOURCC : 0;
+
+        for (const Detail::LegacyFormat& Entry : Detail::LegacyFormatTable)
+        {
+            if (Entry.Flags != Kind)
+                continue;
+
+            if (Kind == DDS_FOURCC)
+            {
+                if (Entry.FourCC == ddpf.fourCC)
+                    return Entry.Format;
+            }
+            else if (Entry.BitCount == ddpf.RGBBitCount)
+            {
+                if (Kind == DDS_ALPHA ||
+                    (Entry.RMask == ddpf.RBitMask && Entry.GMask == ddpf.GBitMask &&
+                     Entry.BMask == ddpf.BBitMask && Entry.AMask == ddpf.ABitMask))
+                    return Entry.Format;
+            }
+        }
+
+        return DXGI_FORMAT_UNKNOWN;
+    }
+
+    // Bytes a probe needs: magic, DDS_HEADER and the DX10 extension.
+    constexpr size_t ProbeHeaderSize = sizeof(uint32_t) + sizeof(DDS_HEADER) + sizeof(DDS_HEADER_DXT10);
+
+    // A 32-bit dimension never needs more levels than this.
+    constexpr uint32_t MaxProbeMips = 32;
+
+    struct ProbeInfo
+    {
+        TextureDesc Desc;
+        uint32_t    DataOffset = 0;                 // header bytes before the first texel
+        uint64_t    MipBytes[MaxProbeMips] = {};    // one array slice, all depth slices of the level
+        uint64_t    SliceBytes = 0;                 // one array slice, every mip
+        uint64_t    TotalBytes = 0;                 // pixel data the header describes
+        uint64_t    FileSize = 0;                   // set by ProbeFile
+    };
+
+    constexpr uint32_t GetFullMipCount(uint32_t width, uint32_t height, uint32_t depth)
+    {
+        uint32_t Largest = width > height ? width : height;
+        Largest = Largest > depth ? Largest : depth;
+
+        uint32_t Count = 1;
+        for (; Largest > 1; Largest >>= 1)
+        {
+            ++Count;
+        }
+        return Count;
+    }
+
+    // Applies the checks of ParseHeader and GetTextureDesc to the first bytes of a file and
+    // sizes every mip.  size may be anything from 0 to the whole file; only
+    // ProbeHeaderSize bytes are ever read.  A file shorter than TotalBytes is not detected
+    // here (ProbeFile does that).
+    inline Status ProbeHeader(const uint8_t* data, size_t size, ProbeInfo& out)
+    {
+        out = ProbeInfo();
+
+        const size_t BaseSize = sizeof(uint32_t) + sizeof(DDS_HEADER);
+        if (data == nullptr || size < BaseSize || Detail::ReadAt<uint32_t>(data) != DDS_MAGIC)
+            return Status::InvalidData;
+
+        const DDS_HEADER Header = Detail::ReadAt<DDS_HEADER>(data + sizeof(uint32_t));
+        if (Header.size != sizeof(DDS_HEADER) || Header.ddspf.size != sizeof(DDS_PIXELFORMAT))
+            return Status::InvalidData;
+
+        TextureDesc& Desc = out.Desc;
+        Desc.Width = Header.width;
+        Desc.Height = Header.height;
+        Desc.Depth = Header.depth;
+        Desc.ArraySize = 1;
+        Desc.MipCount = Header.mipMapCount ? Header.mipMapCount : 1;
+        out.DataOffset = uint32_t(BaseSize);
+
+        if ((Header.ddspf.flags & DDS_FOURCC) && Header.ddspf.fourCC == MAKEFOURCC('D', 'X', '1', '0'))
+        {
+            if (size < ProbeHeaderSize)
+                return Status::InvalidData;
+
+            const DDS_HEADER_DXT10 Extension = Detail::ReadAt<DDS_HEADER_DXT10>(data + BaseSize);
+            out.DataOffset = uint32_t(ProbeHeaderSize);
+
+            Desc.ArraySize = Extension.arraySize;
+            if (Desc.ArraySize == 0)
+                return Status::InvalidData;
+
+            switch (Extension.dxgiFormat)
+            {
+            case DXGI_FORMAT_AI44:
+            case DXGI_FORMAT_IA44:
+            case DXGI_FORMAT_P8:
+            case DXGI_FORMAT_A8P8:
+                return Status::NotSupported;
+
+            default:
+                if (GetFormatInfo(Extension.dxgiFormat).BitsPerPixel == 0)
+                    return Status::NotSupported;
+            }
+
+            Desc.Format = Extension.dxgiFormat;
+
+            switch (Extension.resourceDimension)
+            {
+            case DDS_DIMENSION_TEXTURE1D:
+                if ((Header.flags & DDS_HEIGHT) && Desc.Height != 1)
+                    return Status::InvalidData;
+                Desc.Height = Desc.Depth = 1;
+                break;
+
+            case DDS_DIMENSION_TEXTURE2D:
+                if (Extension.miscFlag & DDS_RESOURCE_MISC_TEXTURECUBE)
+                {
+                    Desc.ArraySize *= 6;
+                    Desc.IsCubeMap = true;
+                }
+                Desc.Depth = 1;
+                break;
+
+            case DDS_DIMENSION_TEXTURE3D:
+                if (!(Header.flags & DDS_HEADER_FLAGS_VOLUME))
+                    return Status::InvalidData;
+                if (Desc.ArraySize > 1)
+                    return Status::NotSupported;
+                break;
+
+            default:
+                return Status::NotSupported;
+            }
+
+            Desc.Dimension = Extension.resourceDimension;
+        }
+        else
+        {
+            Desc.Format = FindLegacyFormat(Header.ddspf);
+            if (Desc.Format == DXGI_FORMAT_UNKNOWN)
+                return Status::NotSupported;
+
+            if (Header.flags & DDS_HEADER_FLAGS_VOLUME)
+            {
+                Desc.Dimension = DDS_DIMENSION_TEXTURE3D;
+            }
+            else
+            {
+                if (Header.caps2 & DDS_CUBEMAP)
+                {
+                    if ((Header.caps2 & DDS_CUBEMAP_ALLFACES) != DDS_CUBEMAP_ALLFACES)
+                        return Status::NotSupported;
+
+                    Desc.ArraySize = 6;
+                    Desc.IsCubeMap = true;
+                }
+
+                Desc.Depth = 1;
+                Desc.Dimension = DDS_DIMENSION_TEXTURE2D;
+            }
+        }
+
+        if (Desc.Width == 0 || Desc.Height == 0 || Desc.Depth == 0)
+            return Status::InvalidData;
+
+        // A garbage mip count would otherwise run past MipBytes.
+        if (Desc.MipCount > GetFullMipCount(Desc.Width, Desc.Height, Desc.Depth))
+            return Status::InvalidData;
+
+        uint64_t Width = Desc.Width;
+        uint64_t Height = Desc.Height;
+        uint64_t Depth = Desc.Depth;
+
+        for (uint32_t Mip = 0; Mip < Desc.MipCount; ++Mip)
+        {
+            out.MipBytes[Mip] = ComputeSurfaceSize(Width, Height, Desc.Format).NumBytes * Depth;
+            out.SliceBytes += out.MipBytes[Mip];
+
+            Width = Width > 1 ? Width >> 1 : 1;
+            Height = Height > 1 ? Height >> 1 : 1;
+            Depth = Depth > 1 ? Depth >> 1 : 1;
+        }
+
+        out.TotalBytes = out.SliceBytes * Desc.ArraySize;
+        return Status::Ok;
+    }
+
+    namespace Detail
+    {
+        inline bool ProbeOpenFile(FILE* file, ProbeInfo& out, Status& status)
+        {
+            uint8_t Buffer[ProbeHeaderSize];
+            const size_t Read = fread(Buffer, 1, sizeof(Buffer), file);
+
+#if defined(_WIN32)
+            const bool bSized = _fseeki64(file, 0, SEEK_END) == 0;
+            const int64_t FileSize = bSized ? _ftelli64(file) : -1;
+#else
+            const bool bSized = fseeko(file, 0, SEEK_END) == 0;
+            const int64_t FileSize = bSized ? int64_t(ftello(file)) : -1;
+#endif
+            fclose(file);
+
+            status = ProbeHeader(Buffer, Read, out);
+            out.FileSize = FileSize > 0 ? uint64_t(FileSize) : 0;
+
+            if (status == Status::Ok && out.DataOffset + out.TotalBytes > out.FileSize)
+                status = Status::EndOfFile;
+
+            return true;
+        }
+    }
+
+    // Reads at most ProbeHeaderSize bytes of the file.  Returns false if it could not be
+    // opened; otherwise status says whether the header is usable.
+    inline bool ProbeFile(const char* fileName, ProbeInfo& out, Status& status)
+    {
+        FILE* File = fopen(fileName, "rb");
+        if (File == nullptr)
+            return false;
+
+        return Detail::ProbeOpenFile(File, out, status);
+    }
+
+#if defined(_WIN32)
+    inline bool ProbeFile(const wchar_t* fileName, ProbeInfo& out, Status& status)
+    {
+        FILE* File = _wfopen(fileName, L"rb");
+        if (File == nullptr)
+            return false;
+
+        return Detail::ProbeOpenFile(File, out, status);
+    }
+#endif
+
+    // Compile-time checks of the table against values the loaders depend on.
+    static_assert(GetFormatInfo(DXGI_FORMAT_R8G8B8A8_UNORM).BitsPerPixel == 32, "format table");
+    static_assert(GetFormatInfo(DXGI_FORMAT_R32G32B32A32_FLOAT).BitsPerPixel == 128, "format table");
+    static_assert(GetFormatInfo(DXGI_FORMAT_BC1_UNORM).Layout == FormatLayout::Block, "format table");
+    static_assert(GetFormatInfo(DXGI_FORMAT_BC7_UNORM_SRGB).bSRGB, "format table");
+    static_assert(GetFormatInfo(DXGI_FORMAT_P8).BitsPerPixel == 8, "format table");
+    static_assert(GetFormatInfo(DXGI_FORMAT_UNKNOWN).Layout == FormatLayout::Unknown, "format table");
+    static_assert(ComputeSurfaceSize(1, 1, DXGI_FORMAT_BC1_UNORM).NumBytes == 8, "surface size");
+    static_assert(ComputeSurfaceSize(512, 512, DXGI_FORMAT_BC3_UNORM).NumBytes == 262144, "surface size");
+    static_assert(ComputeSurfaceSize(3, 5, DXGI_FORMAT_R8G8B8A8_UNORM).RowBytes == 12, "surface size");
+    static_assert(ComputeSurfaceSize(5, 2, DXGI_FORMAT_YUY2).NumBytes == 24, "surface size");
+    static_assert(ComputeSurfaceSize(4, 4, DXGI_FORMAT_NV12).NumRows == 6, "surface size");
+    static_assert(GetFullMipCount(1024, 512, 1) == 11, "mip count");
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#include "RangeAllocator.h"
+#include "RingAllocator.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+
+struct DescriptorAllocatorStats
+{
+    std::uint32_t PersistentCapacity = 0;
+    std::uint32_t PersistentUsed = 0;
+    std::uint32_t PersistentPeak = 0;
+
+    // Freed slots the GPU may still read; they return to the free list in Reclaim.
+    std::uint32_t PendingFreeCount = 0;
+
+    std::uint32_t TransientCapacity = 0;
+    std::uint32_t TransientUsed = 0;
+    std::uint32_t TransientPeak = 0;
+
+    std::uint64_t PersistentAllocations = 0;
+    std::uint64_t TransientAllocations = 0;
+
+    // Allocations refused because the region was full.
+    std::uint64_t FailedCount = 0;
+};
+
+// Slot bookkeeping for one descriptor heap split in two regions.  [0, persistentCount)
+// holds descriptors that live until they are freed (texture views): slots come from a
+// RangeAllocator free list, and a freed slot is only handed out again once the fence
+// value it was freed with has been reached, so a view the GPU may still read is never
+// overwritten.  [persistentCount, persistentCount + transientCount) is a RingAllocator
+// for ranges that are written and used in one frame (descriptor tables copied together
+// for a draw) and retired with that frame's fence.  Indices are heap indices in both
+// regions.  Not thread safe.  Has no graphics API dependency.
+class DescriptorAllocator
+{
+public:
+    static const std::uint32_t InvalidIndex = 0xffffffffu;
+
+    // Drops every allocation in both regions.
+    void Reset(std::uint32_t persistentCount, std::uint32_t transientCount)
+    {
+        m_Persistent.Reset(persistentCount);
+        m_Transient.Reset(transientCount);
+        m_PendingFrees.clear();
+
+        m_Stats = DescriptorAllocatorStats();
+        m_Stats.PersistentCapacity = persistentCount;
+        m_Stats.TransientCapacity = transientCount;
+    }
+
+    // Returns the first of count consecutive persistent slots, or InvalidIndex.
+    std::uint32_t AllocatePersistent(std::uint32_t count = 1)
+    {
+        const std::uint32_t Index = m_Persistent.Allocate(count);
+        if (Index == RangeAllocator::InvalidOffset)
+        {
+            ++m_Stats.FailedCount;
+            return InvalidIndex;
+        }
+
+        m_Stats.PersistentUsed += count;
+        m_Stats.PersistentPeak = (std::max)(m_Stats.PersistentPeak, m_Stats.PersistentUsed);
+        ++m_Stats.PersistentAllocations;
+        return Index;
+    }
+
+    // The slots may be handed out again once fenceValue has been reached.  Fence values
+    // must not decrease between calls.
+    void FreePersistent(std::uint32_t index, std::uint32_t count, std::uint64_t fenceValue)
+    {
+        if (index == InvalidIndex || count == 0)
+            return;
+
+        m_PendingFrees.push_back({ index, count, fenceValue });
+        m_Stats.PendingFreeCount += count;
+    }
+
+    // Returns the heap index of count consecutive transient slots, or InvalidIndex if the
+    // GPU has not released enough of the ring yet.
+    std::uint32_t AllocateTransient(std::uint32_t count)
+    {
+        const std::uint64_t Offset = m_Transient.Allocate(count, 1);
+        if (Offset == RingAllocator::InvalidOffset)
+        {
+            ++m_Stats.FailedCount;
+            return InvalidIndex;
+        }
+
+        ++m_Stats.TransientAllocations;
+        m_Stats.TransientUsed = (std::uint32_t)m_Transient.GetUsedBytes();
+        m_Stats.TransientPeak = (std::max)(m_Stats.TransientPeak, m_Stats.TransientUsed);
+        return m_Stats.PersistentCapacity + (std::uint32_t)Offset;
+    }
+
+    // Retires every transient range allocated since the last call.
+    void RetireTransient(std::uint64_t fenceValue)
+    {
+        m_Transient.RetireAll(fenceValue);
+    }
+
+    // Returns freed persistent slots and transient ranges whose fence has been reached.
+    void Reclaim(std::uint64_t completedFence)
+    {
+        while (!m_PendingFrees.empty() && m_PendingFrees.front().FenceValue <= completedFence)
+        {
+            const PendingFree& Free = m_PendingFrees.front();
+            m_Persistent.Free(Free.Index, Free.Count);
+            m_Stats.PersistentUsed -= Free.Count;
+            m_Stats.PendingFreeCount -= Free.Count;
+            m_PendingFrees.pop_front();
+        }
+
+        m_Transient.Reclaim(completedFence);
+        m_Stats.TransientUsed = (std::uint32_t)m_Transient.GetUsedBytes();
+    }
+
+    bool IsPersistent(std::uint32_t index)const { return index < m_Stats.PersistentCapacity; }
+
+    std::uint32_t GetCapacity()const { return m_Stats.PersistentCapacity + m_Stats.TransientCapacity; }
+    std::uint32_t GetPersistentCapacity()const { return m_Stats.PersistentCapacity; }
+
+    const DescriptorAllocatorStats& GetStats()const { return m_Stats; }
+
+private:
+    struct PendingFree
+    {
+        std::uint32_t Index;
+        std::uint32_t Count;
+        std::uint64_t FenceValue;
+    };
+
+    RangeAllocator m_Persistent;
+    RingAllocator m_Transient;
+
+    // Oldest first.
+    std::deque<PendingFree> m_PendingFrees;
+
+    DescriptorAllocatorStats m_Stats;
+};
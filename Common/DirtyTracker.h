@@ -0,0 +1,88 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// Remembers which entries of a buffer with one copy per frame slot are out of date.
+// Marking an entry sets its counter to the slot count; every Flush writes it into the
+// current slot and counts down, so after frameCount flushes each slot holds the new value
+// and the entry drops out.  Flush must therefore run exactly once per frame.
+//
+// Dirty entries live in a packed index list: a frame in which little changes costs time
+// in the number of changed entries, not the total.  The list is visited in ascending
+// index order so that writes into a mapped (write-combined) upload heap only move
+// forward.  Has no graphics API dependency.
+class DirtyTracker
+{
+public:
+    explicit DirtyTracker(std::uint32_t frameCount = 3)
+        : m_FrameCount((std::min)((std::max)(frameCount, 1u), 255u))
+    {
+    }
+
+    // Sets the entry count; every entry starts dirty.
+    void Reset(std::uint32_t count)
+    {
+        m_FramesDirty.assign(count, (std::uint8_t)m_FrameCount);
+        m_DirtyList.resize(count);
+        for (std::uint32_t i = 0; i < count; ++i)
+        {
+            m_DirtyList[i] = i;
+        }
+        m_bSorted = true;
+    }
+
+    void MarkDirty(std::uint32_t index)
+    {
+        if (m_FramesDirty[index] == 0)
+        {
+            if (!m_DirtyList.empty() && m_DirtyList.back() > index)
+                m_bSorted = false;
+            m_DirtyList.push_back(index);
+        }
+        m_FramesDirty[index] = (std::uint8_t)m_FrameCount;
+    }
+
+    bool IsDirty(std::uint32_t index)const { return m_FramesDirty[index] != 0; }
+
+    std::uint32_t GetCount()const { return (std::uint32_t)m_FramesDirty.size(); }
+    std::uint32_t GetDirtyCount()const { return (std::uint32_t)m_DirtyList.size(); }
+
+    // Calls write(index) for every entry the current slot does not have yet, in
+    // ascending index order, and returns how many there were.
+    template<typename F>
+    std::uint32_t Flush(F&& write)
+    {
+        if (!m_bSorted)
+        {
+            std::sort(m_DirtyList.begin(), m_DirtyList.end());
+            m_bSorted = true;
+        }
+
+        const std::uint32_t Written = (std::uint32_t)m_DirtyList.size();
+
+        std::size_t Kept = 0;
+        for (std::size_t i = 0; i < m_DirtyList.size(); ++i)
+        {
+            const std::uint32_t Index = m_DirtyList[i];
+            write(Index);
+
+            if (--m_FramesDirty[Index] != 0)
+                m_DirtyList[Kept++] = Index;
+        }
+        m_DirtyList.resize(Kept);
+
+        return Written;
+    }
+
+private:
+    std::uint32_t m_FrameCount;
+
+    // Slots still missing the current value, per entry.
+    std::vector<std::uint8_t> m_FramesDirty;
+
+    // Entries with a non-zero counter.
+    std::vector<std::uint32_t> m_DirtyList;
+    bool m_bSorted = true;
+};
@@ -0,0 +1,219 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// 64-bit draw order key.  Fields from the most significant bit down:
+//
+//     front-to-back : Layer(4) Pipeline(6) Texture(10) Material(10) Geometry(10) Depth(24)
+//     back-to-front : Layer(4) Pipeline(6) Depth(24, inverted) Texture(10) Material(10) Geometry(10)
+//
+// Opaque draws put the state fields above depth so that draws sharing a texture table,
+// material and mesh end up next to each other, with depth only ordering draws of equal
+// state.  Blended draws have to be in depth order, so there depth comes first and state
+// only breaks ties.  Values wider than their field are masked; for everything except
+// Layer that only costs grouping, never correctness.  Has no graphics API dependency.
+namespace DrawSortKey
+{
+    const std::uint32_t LayerBits = 4;
+    const std::uint32_t PipelineBits = 6;
+    const std::uint32_t TextureBits = 10;
+    const std::uint32_t MaterialBits = 10;
+    const std::uint32_t GeometryBits = 10;
+    const std::uint32_t DepthBits = 24;
+
+    inline std::uint64_t Field(std::uint32_t value, std::uint32_t bits)
+    {
+        return (std::uint64_t)value & ((1ull << bits) - 1);
+    }
+
+    // Linear view depth in [0, farZ] to DepthBits.  Out of range depths are clamped.
+    inline std::uint32_t QuantizeDepth(float viewDepth, float farZ)
+    {
+        const float Scale = (float)((1u << DepthBits) - 1);
+        const float Normalized = farZ > 0.0f ? viewDepth / farZ : 0.0f;
+        return (std::uint32_t)((std::min)((std::max)(Normalized, 0.0f), 1.0f) * Scale);
+    }
+
+    inline std::uint64_t Make(std::uint32_t layer, std::uint32_t pipeline, std::uint32_t texture,
+        std::uint32_t material, std::uint32_t geometry, std::uint32_t depth, bool bBackToFront)
+    {
+        const std::uint64_t State =
+            (Field(texture, TextureBits) << (MaterialBits + GeometryBits)) |
+            (Field(material, MaterialBits) << GeometryBits) |
+            Field(geometry, GeometryBits);
+
+        const std::uint64_t Pass =
+            (Field(layer, LayerBits) << (64 - LayerBits)) |
+            (Field(pipeline, PipelineBits) << (64 - LayerBits - PipelineBits));
+
+        if (bBackToFront)
+            return Pass | (Field(~depth, DepthBits) << (TextureBits + MaterialBits + GeometryBits)) | State;
+
+        return Pass | (State << DepthBits) | Field(depth, DepthBits);
+    }
+
+    inline std::uint32_t GetLayer(std::uint64_t key)
+    {
+        return (std::uint32_t)(key >> (64 - LayerBits));
+    }
+}
+
+struct DrawSortEntry
+{
+    std::uint64_t Key;
+
+    // Index of the draw in the caller's list.
+    std::uint32_t Index;
+};
+
+// Stable LSD radix sort on Key, 8 bits per pass.  All eight histograms are built in one
+// read; a pass whose digit is the same for every entry is skipped, which is most of them
+// for a scene with few layers and pipelines.  Small lists go through insertion sort.
+// scratch is resized as needed and can be kept between frames to avoid allocating.
+inline void RadixSortDraws(std::vector<DrawSortEntry>& entries, std::vector<DrawSortEntry>& scratch)
+{
+    const std::size_t Count = entries.size();
+
+    if (Count <= 32)
+    {
+        for (std::size_t i = 1; i < Count; ++i)
+        {
+            const DrawSortEntry Entry = entries[i];
+            std::size_t j = i;
+            for (; j > 0 && entries[j - 1].Key > Entry.Key; --j)
+            {
+                entries[j] = entries[j - 1];
+            }
+            entries[j] = Entry;
+        }
+        return;
+    }
+
+    std::uint32_t Counts[8][256];
+    std::memset(Counts, 0, sizeof(Counts));
+
+    for (const DrawSortEntry& Entry : entries)
+    {
+        for (std::uint32_t Digit = 0; Digit < 8; ++Digit)
+        {
+            ++Counts[Digit][(Entry.Key >> (Digit * 8)) & 0xff];
+        }
+    }
+
+    scratch.resize(Count);
+    DrawSortEntry* Source = entries.data();
+    DrawSortEntry* Destination = scratch.data();
+
+    for (std::uint32_t Digit = 0; Digit < 8; ++Digit)
+    {
+        std::uint32_t* DigitCounts = Counts[Digit];
+        if (DigitCounts[(Source[0].Key >> (Digit * 8)) & 0xff] == Count)
+            continue;
+
+        std::uint32_t Offset = 0;
+        for (std::uint32_t Bucket = 0; Bucket < 256; ++Bucket)
+        {
+            const std::uint32_t BucketCount = DigitCounts[Bucket];
+            DigitCounts[Bucket] = Offset;
+            Offset += BucketCount;
+        }
+
+        for (std::size_t i = 0; i < Count; ++i)
+        {
+            Destination[DigitCounts[(Source[i].Key >> (Digit * 8)) & 0xff]++] = Source[i];
+        }
+
+        std::swap(Source, Destination);
+    }
+
+    if (Source != entries.data())
+        std::memcpy(entries.data(), Source, Count * sizeof(DrawSortEntry));
+}
+
+// Root arguments and input assembler state a draw sets.
+enum class DrawState : std::uint32_t
+{
+    ObjectCB = 0,
+    MaterialCB,
+    TextureTable,
+    SkinnedCB,
+    VertexBuffer,
+    IndexBuffer,
+    Topology,
+    Count
+};
+
+// Remembers what is bound on one command list and tells the caller whether a binding
+// call is needed.  Values are opaque 64-bit identities (GPU addresses, heap indices,
+// topology).  Starts with nothing bound; call Invalidate whenever the list's state is
+// lost (new list, different root signature).
+class DrawStateTracker
+{
+public:
+    DrawStateTracker()
+    {
+        Invalidate();
+        std::memset(m_Issued, 0, sizeof(m_Issued));
+        std::memset(m_Skipped, 0, sizeof(m_Skipped));
+    }
+
+    void Invalidate()
+    {
+        std::memset(m_bBound, 0, sizeof(m_bBound));
+    }
+
+    // Returns true if the call has to be made.
+    bool Set(DrawState state, std::uint64_t value)
+    {
+        const std::uint32_t Slot = (std::uint32_t)state;
+        if (m_bBound[Slot] && m_Values[Slot] == value)
+        {
+            ++m_Skipped[Slot];
+            return false;
+        }
+
+        m_Values[Slot] = value;
+        m_bBound[Slot] = true;
+        ++m_Issued[Slot];
+        return true;
+    }
+
+    std::uint32_t GetIssued(DrawState state)const { return m_Issued[(std::uint32_t)state]; }
+    std::uint32_t GetSkipped(DrawState state)const { return m_Skipped[(std::uint32_t)state]; }
+
+private:
+    static const std::uint32_t SlotCount = (std::uint32_t)DrawState::Count;
+
+    std::uint64_t m_Values[SlotCount];
+    bool m_bBound[SlotCount];
+
+    std::uint32_t m_Issued[SlotCount];
+    std::uint32_t m_Skipped[SlotCount];
+};
+
+// Run of neighbouring draws that can go out as one instanced draw.
+struct InstanceRun
+{
+    std::uint32_t First;
+    std::uint32_t Count;
+};
+
+// Splits draws [0, count) into runs in which bSameBatch(previous, current) holds between
+// every pair of neighbours.  The sort key puts texture, material and geometry above depth,
+// so on a sorted front-to-back layer all draws of one group land in a single run.
+template<typename F>
+inline void FindInstanceRuns(std::uint32_t count, F&& bSameBatch, std::vector<InstanceRun>& runs)
+{
+    runs.clear();
+
+    for (std::uint32_t i = 0; i < count; ++i)
+    {
+        if (i == 0 || !bSameBatch(i - 1, i))
+            runs.push_back({ i, 0 });
+
+        ++runs.back().Count;
+    }
+}
@@ -0,0 +1,511 @@
+#include "DynamicBVH.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace
+{
+    const std::uint32_t SAHBinCount = 16;
+
+    // Past this depth BuildStatic splits at the median, so badly distributed input cannot
+    // recurse further than another log2(count) levels.
+    const std::uint32_t MaxSAHDepth = 48;
+
+    BVHBounds EmptyBounds()
+    {
+        BVHBounds Bounds;
+        for (int i = 0; i < 3; ++i)
+        {
+            Bounds.Min[i] = 3.4e38f;
+            Bounds.Max[i] = -3.4e38f;
+        }
+        return Bounds;
+    }
+}
+
+void DynamicBVH::Clear()
+{
+    m_Nodes.clear();
+    m_Root = NullNode;
+    m_FreeList = NullNode;
+    m_FreeCount = 0;
+    m_LeafCount = 0;
+    m_OptimizeCursor = 0;
+}
+
+std::uint32_t DynamicBVH::AllocateNode()
+{
+    std::uint32_t Index;
+    if (m_FreeList != NullNode)
+    {
+        Index = m_FreeList;
+        m_FreeList = m_Nodes[Index].Parent;
+        --m_FreeCount;
+    }
+    else
+    {
+        Index = (std::uint32_t)m_Nodes.size();
+        m_Nodes.emplace_back();
+    }
+
+    Node& N = m_Nodes[Index];
+    N.Parent = NullNode;
+    N.Child[0] = NullNode;
+    N.Child[1] = NullNode;
+    N.Item = NullNode;
+    return Index;
+}
+
+void DynamicBVH::FreeNode(std::uint32_t node)
+{
+    // Free nodes look like leaves, so Optimize passes over them.
+    m_Nodes[node].Child[0] = NullNode;
+    m_Nodes[node].Child[1] = NullNode;
+    m_Nodes[node].Parent = m_FreeList;
+    m_FreeList = node;
+    ++m_FreeCount;
+}
+
+void DynamicBVH::BuildStatic(const BVHBounds* bounds, std::uint32_t count)
+{
+    Clear();
+    if (count == 0)
+        return;
+
+    m_Nodes.reserve((std::size_t)count * 2);
+    m_Nodes.resize(count);
+
+    // The build partitions copies of the boxes rather than indices, so every level reads
+    // its range front to back instead of jumping around the input.
+    std::vector<BuildEntry> Entries(count);
+    for (std::uint32_t i = 0; i < count; ++i)
+    {
+        Node& Leaf = m_Nodes[i];
+        Leaf.Bounds = bounds[i];
+        Leaf.Parent = NullNode;
+        Leaf.Child[0] = NullNode;
+        Leaf.Child[1] = NullNode;
+        Leaf.Item = i;
+
+        BuildEntry& Entry = Entries[i];
+        Entry.Bounds = bounds[i];
+        Entry.Leaf = i;
+        for (int Axis = 0; Axis < 3; ++Axis)
+        {
+            Entry.Centroid[Axis] = (bounds[i].Min[Axis] + bounds[i].Max[Axis]) * 0.5f;
+        }
+    }
+
+    m_LeafCount = count;
+    m_Root = BuildRange(Entries.data(), count, 0);
+}
+
+std::uint32_t DynamicBVH::BuildRange(BuildEntry* entries, std::uint32_t count, std::uint32_t depth)
+{
+    if (count == 1)
+        return entries[0].Leaf;
+
+    if (count == 2)
+        return MakeParent(entries[0].Leaf, entries[1].Leaf);
+
+    float CentroidMin[3] = { 3.4e38f, 3.4e38f, 3.4e38f };
+    float CentroidMax[3] = { -3.4e38f, -3.4e38f, -3.4e38f };
+    for (std::uint32_t i = 0; i < count; ++i)
+    {
+        for (int Axis = 0; Axis < 3; ++Axis)
+        {
+            CentroidMin[Axis] = (std::min)(CentroidMin[Axis], entries[i].Centroid[Axis]);
+            CentroidMax[Axis] = (std::max)(CentroidMax[Axis], entries[i].Centroid[Axis]);
+        }
+    }
+
+    int LargestAxis = 0;
+    for (int Axis = 1; Axis < 3; ++Axis)
+    {
+        if (CentroidMax[Axis] - CentroidMin[Axis] > CentroidMax[LargestAxis] - CentroidMin[LargestAxis])
+            LargestAxis = Axis;
+    }
+
+    std::uint32_t LeftCount = count / 2;
+
+    if (CentroidMax[LargestAxis] - CentroidMin[LargestAxis] <= 0.0f)
+    {
+        // All centroids coincide; any split is as good as another.
+    }
+    else if (depth >= MaxSAHDepth)
+    {
+        std::nth_element(entries, entries + LeftCount, entries + count, [&](const BuildEntry& a, const BuildEntry& b)
+        {
+            return a.Centroid[LargestAxis] < b.Centroid[LargestAxis];
+        });
+    }
+    else
+    {
+        // Bin the centroids on all three axes in one pass, then sweep each axis for the
+        // cheapest split plane.
+        float Scale[3];
+        for (int Axis = 0; Axis < 3; ++Axis)
+        {
+            const float Extent = CentroidMax[Axis] - CentroidMin[Axis];
+            Scale[Axis] = Extent > 0.0f ? SAHBinCount / Extent : 0.0f;
+        }
+
+        BVHBounds BinBounds[3][SAHBinCount];
+        std::uint32_t BinCounts[3][SAHBinCount] = {};
+        for (int Axis = 0; Axis < 3; ++Axis)
+        {
+            for (BVHBounds& Bin : BinBounds[Axis])
+            {
+                Bin = EmptyBounds();
+            }
+        }
+
+        for (std::uint32_t i = 0; i < count; ++i)
+        {
+            const BuildEntry& Entry = entries[i];
+            for (int Axis = 0; Axis < 3; ++Axis)
+            {
+                const std::uint32_t Bin = (std::min)((std::uint32_t)((Entry.Centroid[Axis] - CentroidMin[Axis]) * Scale[Axis]), SAHBinCount - 1);
+                BinBounds[Axis][Bin].Grow(Entry.Bounds);
+                ++BinCounts[Axis][Bin];
+            }
+        }
+
+        float BestCost = 3.4e38f;
+        int BestAxis = LargestAxis;
+        std::uint32_t BestSplit = SAHBinCount / 2;
+
+        for (int Axis = 0; Axis < 3; ++Axis)
+        {
+            if (Scale[Axis] == 0.0f)
+                continue;
+
+            // RightArea[s] covers bins s.. , for split s putting bins < s on the left.
+            float RightArea[SAHBinCount];
+            std::uint32_t RightCount[SAHBinCount];
+            BVHBounds Right = EmptyBounds();
+            std::uint32_t RightItems = 0;
+            for (std::uint32_t Bin = SAHBinCount - 1; Bin > 0; --Bin)
+            {
+                if (BinCounts[Axis][Bin] != 0)
+                {
+                    Right.Grow(BinBounds[Axis][Bin]);
+                    RightItems += BinCounts[Axis][Bin];
+                }
+                RightArea[Bin] = RightItems != 0 ? Right.GetHalfArea() : 0.0f;
+                RightCount[Bin] = RightItems;
+            }
+
+            BVHBounds Left = EmptyBounds();
+            std::uint32_t LeftItems = 0;
+            for (std::uint32_t Split = 1; Split < SAHBinCount; ++Split)
+            {
+                if (BinCounts[Axis][Split - 1] == 0)
+                    continue;
+
+                Left.Grow(BinBounds[Axis][Split - 1]);
+                LeftItems += BinCounts[Axis][Split - 1];
+                if (RightCount[Split] == 0)
+                    break;
+
+                const float Cost = Left.GetHalfArea() * LeftItems + RightArea[Split] * RightCount[Split];
+                if (Cost < BestCost)
+                {
+                    BestCost = Cost;
+                    BestAxis = Axis;
+                    BestSplit = Split;
+                }
+            }
+        }
+
+        BuildEntry* Middle = std::partition(entries, entries + count, [&](const BuildEntry& Entry)
+        {
+            const std::uint32_t Bin = (std::min)((std::uint32_t)((Entry.Centroid[BestAxis] - CentroidMin[BestAxis]) * Scale[BestAxis]), SAHBinCount - 1);
+            return Bin < BestSplit;
+        });
+        LeftCount = (std::uint32_t)(Middle - entries);
+    }
+
+    const std::uint32_t Left = BuildRange(entries, LeftCount, depth + 1);
+    const std::uint32_t Right = BuildRange(entries + LeftCount, count - LeftCount, depth + 1);
+    return MakeParent(Left, Right);
+}
+
+std::uint32_t DynamicBVH::MakeParent(std::uint32_t left, std::uint32_t right)
+{
+    const std::uint32_t Index = AllocateNode();
+    Node& N = m_Nodes[Index];
+    N.Child[0] = left;
+    N.Child[1] = right;
+    N.Bounds = BVHBounds::Union(m_Nodes[left].Bounds, m_Nodes[right].Bounds);
+    m_Nodes[left].Parent = Index;
+    m_Nodes[right].Parent = Index;
+    return Index;
+}
+
+std::uint32_t DynamicBVH::Insert(const BVHBounds& bounds, std::uint32_t item)
+{
+    const std::uint32_t Leaf = AllocateNode();
+    Node& N = m_Nodes[Leaf];
+    N.Item = item;
+    for (int i = 0; i < 3; ++i)
+    {
+        N.Bounds.Min[i] = bounds.Min[i] - m_Margin;
+        N.Bounds.Max[i] = bounds.Max[i] + m_Margin;
+    }
+
+    InsertLeaf(Leaf);
+    ++m_LeafCount;
+    return Leaf;
+}
+
+void DynamicBVH::Remove(std::uint32_t proxy)
+{
+    RemoveLeaf(proxy);
+    FreeNode(proxy);
+    --m_LeafCount;
+}
+
+bool DynamicBVH::Move(std::uint32_t proxy, const BVHBounds& bounds)
+{
+    if (m_Nodes[proxy].Bounds.Contains(bounds))
+        return false;
+
+    BVHBounds Fat;
+    for (int i = 0; i < 3; ++i)
+    {
+        Fat.Min[i] = bounds.Min[i] - m_Margin;
+        Fat.Max[i] = bounds.Max[i] + m_Margin;
+    }
+
+    // A leaf that stays inside its parent only needs the path refit; anything else would
+    // grow every ancestor, so it goes back in from the root.
+    const std::uint32_t Parent = m_Nodes[proxy].Parent;
+    if (Parent != NullNode && m_Nodes[Parent].Bounds.Contains(Fat))
+    {
+        m_Nodes[proxy].Bounds = Fat;
+        RefitFrom(Parent);
+        return true;
+    }
+
+    RemoveLeaf(proxy);
+    m_Nodes[proxy].Bounds = Fat;
+    InsertLeaf(proxy);
+    return true;
+}
+
+void DynamicBVH::InsertLeaf(std::uint32_t leaf)
+{
+    if (m_Root == NullNode)
+    {
+        m_Root = leaf;
+        m_Nodes[leaf].Parent = NullNode;
+        return;
+    }
+
+    // Walk down while going deeper is cheaper than pairing with the current node.  Every
+    // ancestor grows to cover the leaf, which is charged to the children as inherited cost.
+    const BVHBounds LeafBounds = m_Nodes[leaf].Bounds;
+    std::uint32_t Index = m_Root;
+    while (!m_Nodes[Index].IsLeaf())
+    {
+        const Node& N = m_Nodes[Index];
+        const float Area = N.Bounds.GetHalfArea();
+        const float CombinedArea = BVHBounds::Union(N.Bounds, LeafBounds).GetHalfArea();
+
+        const float Cost = 2.0f * CombinedArea;
+        const float Inherited = 2.0f * (CombinedArea - Area);
+
+        float ChildCost[2];
+        for (int i = 0; i < 2; ++i)
+        {
+            const Node& Child = m_Nodes[N.Child[i]];
+            const float Combined = BVHBounds::Union(Child.Bounds, LeafBounds).GetHalfArea();
+            ChildCost[i] = (Child.IsLeaf() ? Combined : Combined - Child.Bounds.GetHalfArea()) + Inherited;
+        }
+
+        if (Cost < ChildCost[0] && Cost < ChildCost[1])
+            break;
+
+        Index = ChildCost[0] < ChildCost[1] ? N.Child[0] : N.Child[1];
+    }
+
+    const std::uint32_t Sibling = Index;
+    const std::uint32_t OldParent = m_Nodes[Sibling].Parent;
+    const std::uint32_t NewParent = AllocateNode();
+
+    Node& P = m_Nodes[NewParent];
+    P.Parent = OldParent;
+    P.Child[0] = Sibling;
+    P.Child[1] = leaf;
+    P.Bounds = BVHBounds::Union(m_Nodes[Sibling].Bounds, LeafBounds);
+    m_Nodes[Sibling].Parent = NewParent;
+    m_Nodes[leaf].Parent = NewParent;
+
+    if (OldParent == NullNode)
+    {
+        m_Root = NewParent;
+        return;
+    }
+
+    Node& Old = m_Nodes[OldParent];
+    Old.Child[Old.Child[0] == Sibling ? 0 : 1] = NewParent;
+    RefitFrom(OldParent);
+}
+
+void DynamicBVH::RemoveLeaf(std::uint32_t leaf)
+{
+    if (leaf == m_Root)
+    {
+        m_Root = NullNode;
+        return;
+    }
+
+    const std::uint32_t Parent = m_Nodes[leaf].Parent;
+    const std::uint32_t GrandParent = m_Nodes[Parent].Parent;
+    const std::uint32_t Sibling = m_Nodes[Parent].Child[m_Nodes[Parent].Child[0] == leaf ? 1 : 0];
+
+    m_Nodes[Sibling].Parent = GrandParent;
+    FreeNode(Parent);
+
+    if (GrandParent == NullNode)
+    {
+        m_Root = Sibling;
+        return;
+    }
+
+    Node& G = m_Nodes[GrandParent];
+    G.Child[G.Child[0] == Parent ? 0 : 1] = Sibling;
+    RefitFrom(GrandParent);
+}
+
+void DynamicBVH::RefitFrom(std::uint32_t node)
+{
+    while (node != NullNode)
+    {
+        Node& N = m_Nodes[node];
+        N.Bounds = BVHBounds::Union(m_Nodes[N.Child[0]].Bounds, m_Nodes[N.Child[1]].Bounds);
+        Rotate(node);
+        node = N.Parent;
+    }
+}
+
+void DynamicBVH::Rotate(std::uint32_t node)
+{
+    // Swapping a child with a grandchild on the other side changes only the bounds of the
+    // inner node between them; node's own bounds stay the same, so nothing above needs a
+    // refit.  Take the swap that shrinks that inner node the most, if any does.
+    Node& A = m_Nodes[node];
+    if (A.IsLeaf())
+        return;
+
+    float BestGain = 0.0f;
+    int BestOuter = -1;
+    int BestGrandChild = -1;
+
+    for (int Outer = 0; Outer < 2; ++Outer)
+    {
+        const Node& OuterNode = m_Nodes[A.Child[Outer]];
+        const Node& Inner = m_Nodes[A.Child[1 - Outer]];
+        if (Inner.IsLeaf())
+            continue;
+
+        const float InnerArea = Inner.Bounds.GetHalfArea();
+        for (int GrandChild = 0; GrandChild < 2; ++GrandChild)
+        {
+            // OuterNode takes GrandChild's place next to the other grandchild.
+            const float NewArea = BVHBounds::Union(OuterNode.Bounds, m_Nodes[Inner.Child[1 - GrandChild]].Bounds).GetHalfArea();
+            const float Gain = InnerArea - NewArea;
+            if (Gain > BestGain)
+            {
+                BestGain = Gain;
+                BestOuter = Outer;
+                BestGrandChild = GrandChild;
+            }
+        }
+    }
+
+    if (BestOuter < 0)
+        return;
+
+    const std::uint32_t OuterIndex = A.Child[BestOuter];
+    const std::uint32_t InnerIndex = A.Child[1 - BestOuter];
+    Node& Inner = m_Nodes[InnerIndex];
+    const std::uint32_t GrandChildIndex = Inner.Child[BestGrandChild];
+
+    A.Child[BestOuter] = GrandChildIndex;
+    m_Nodes[GrandChildIndex].Parent = node;
+
+    Inner.Child[BestGrandChild] = OuterIndex;
+    m_Nodes[OuterIndex].Parent = InnerIndex;
+    Inner.Bounds = BVHBounds::Union(m_Nodes[Inner.Child[0]].Bounds, m_Nodes[Inner.Child[1]].Bounds);
+}
+
+void DynamicBVH::Optimize(std::uint32_t rotationCount)
+{
+    const std::uint32_t NodeCount = (std::uint32_t)m_Nodes.size();
+    if (NodeCount == 0)
+        return;
+
+    // Visiting in index order is not bottom-up, but repeated passes converge all the same.
+    for (std::uint32_t i = 0; i < rotationCount; ++i)
+    {
+        if (m_OptimizeCursor >= NodeCount)
+            m_OptimizeCursor = 0;
+
+        Rotate(m_OptimizeCursor++);
+    }
+}
+
+std::uint32_t DynamicBVH::ComputeHeight()const
+{
+    if (m_Root == NullNode)
+        return 0;
+
+    std::uint32_t Height = 0;
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> Stack;
+    Stack.push_back({ m_Root, 0 });
+    while (!Stack.empty())
+    {
+        const std::pair<std::uint32_t, std::uint32_t> Current = Stack.back();
+        Stack.pop_back();
+
+        const Node& N = m_Nodes[Current.first];
+        if (N.IsLeaf())
+        {
+            Height = (std::max)(Height, Current.second);
+            continue;
+        }
+
+        Stack.push_back({ N.Child[0], Current.second + 1 });
+        Stack.push_back({ N.Child[1], Current.second + 1 });
+    }
+    return Height;
+}
+
+float DynamicBVH::ComputeSAHCost()const
+{
+    if (m_Root == NullNode)
+        return 0.0f;
+
+    const float RootArea = m_Nodes[m_Root].Bounds.GetHalfArea();
+    if (RootArea <= 0.0f)
+        return 0.0f;
+
+    double Sum = 0.0;
+    std::vector<std::uint32_t> Stack;
+    Stack.push_back(m_Root);
+    while (!Stack.empty())
+    {
+        const Node& N = m_Nodes[Stack.back()];
+        Stack.pop_back();
+
+        if (N.IsLeaf())
+            continue;
+
+        Sum += N.Bounds.GetHalfArea();
+        Stack.push_back(N.Child[0]);
+        Stack.push_back(N.Child[1]);
+    }
+    return (float)(Sum / RootArea);
+}
@@ -0,0 +1,363 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// World-space axis-aligned box.
+struct BVHBounds
+{
+    float Min[3];
+    float Max[3];
+
+    static BVHBounds FromCenterExtents(const float center[3], const float extents[3])
+    {
+        BVHBounds Bounds;
+        for (int i = 0; i < 3; ++i)
+        {
+            Bounds.Min[i] = center[i] - extents[i];
+            Bounds.Max[i] = center[i] + extents[i];
+        }
+        return Bounds;
+    }
+
+    // Box around a local AABB moved by a DirectXMath style world matrix (row vectors,
+    // translation in row 3).
+    static BVHBounds FromLocalBox(const float localCenter[3], const float localExtents[3], const float world[16])
+    {
+        float Center[3];
+        float Extents[3];
+        for (int i = 0; i < 3; ++i)
+        {
+            Center[i] = localCenter[0] * world[i] + localCenter[1] * world[4 + i] + localCenter[2] * world[8 + i] + world[12 + i];
+            Extents[i] = localExtents[0] * std::fabs(world[i]) + localExtents[1] * std::fabs(world[4 + i]) + localExtents[2] * std::fabs(world[8 + i]);
+        }
+        return FromCenterExtents(Center, Extents);
+    }
+
+    static BVHBounds Union(const BVHBounds& a, const BVHBounds& b)
+    {
+        BVHBounds Bounds;
+        for (int i = 0; i < 3; ++i)
+        {
+            Bounds.Min[i] = a.Min[i] < b.Min[i] ? a.Min[i] : b.Min[i];
+            Bounds.Max[i] = a.Max[i] > b.Max[i] ? a.Max[i] : b.Max[i];
+        }
+        return Bounds;
+    }
+
+    void Grow(const BVHBounds& other)
+    {
+        for (int i = 0; i < 3; ++i)
+        {
+            Min[i] = other.Min[i] < Min[i] ? other.Min[i] : Min[i];
+            Max[i] = other.Max[i] > Max[i] ? other.Max[i] : Max[i];
+        }
+    }
+
+    // Half the surface area, which is all SAH comparisons need.
+    float GetHalfArea()const
+    {
+        const float Dx = Max[0] - Min[0];
+        const float Dy = Max[1] - Min[1];
+        const float Dz = Max[2] - Min[2];
+        return Dx * Dy + Dy * Dz + Dz * Dx;
+    }
+
+    bool Contains(const BVHBounds& other)const
+    {
+        for (int i = 0; i < 3; ++i)
+        {
+            if (other.Min[i] < Min[i] || other.Max[i] > Max[i])
+                return false;
+        }
+        return true;
+    }
+
+    bool Overlaps(const BVHBounds& other)const
+    {
+        for (int i = 0; i < 3; ++i)
+        {
+            if (other.Min[i] > Max[i] || other.Max[i] < Min[i])
+                return false;
+        }
+        return true;
+    }
+
+    // Plane (nx, ny, nz, d) with inside >= 0.  -1 fully outside, 1 fully inside, 0 crossing.
+    // Uses the corner furthest along the normal and the one furthest against it; since
+    // that is monotonic in the box coordinates, a box inside its parent never tests more
+    // inside than the parent did.
+    int ClassifyPlane(const float plane[4])const
+    {
+        float Far = plane[3];
+        float Near = plane[3];
+        for (int i = 0; i < 3; ++i)
+        {
+            Far += plane[i] * (plane[i] >= 0.0f ? Max[i] : Min[i]);
+            Near += plane[i] * (plane[i] >= 0.0f ? Min[i] : Max[i]);
+        }
+        if (Far < 0.0f)
+            return -1;
+        return Near >= 0.0f ? 1 : 0;
+    }
+
+    bool OverlapsSphere(const float center[3], float radius)const
+    {
+        float DistanceSq = 0.0f;
+        for (int i = 0; i < 3; ++i)
+        {
+            const float Closest = center[i] < Min[i] ? Min[i] : (center[i] > Max[i] ? Max[i] : center[i]);
+            const float D = center[i] - Closest;
+            DistanceSq += D * D;
+        }
+        return DistanceSq <= radius * radius;
+    }
+
+    // Slab test against origin + t * direction for t in [0, maxT].  invDirection is
+    // 1 / direction per axis (infinity for zero components).  Returns the entry t or a
+    // negative value on a miss.
+    float IntersectRay(const float origin[3], const float invDirection[3], float maxT)const
+    {
+        float Enter = 0.0f;
+        float Exit = maxT;
+        for (int i = 0; i < 3; ++i)
+        {
+            float T0 = (Min[i] - origin[i]) * invDirection[i];
+            float T1 = (Max[i] - origin[i]) * invDirection[i];
+            if (T0 > T1)
+            {
+                const float Swap = T0;
+                T0 = T1;
+                T1 = Swap;
+            }
+            // NaN from 0 * inf (origin on the slab with a parallel ray) keeps the bounds.
+            Enter = T0 > Enter ? T0 : Enter;
+            Exit = T1 < Exit ? T1 : Exit;
+        }
+        return Enter <= Exit ? Enter : -1.0f;
+    }
+};
+
+// Bounding volume hierarchy over world-space item boxes that stays valid while items are
+// added, removed and moved.
+//
+//  - BuildStatic builds the whole tree top-down with a binned SAH split, for content that
+//    is known up front.
+//  - Insert descends to the sibling that adds the least area to the tree, Remove splices
+//    the leaf out.  Both refit the path to the root and try a tree rotation at every node
+//    on it, which keeps the SAH cost close to a full rebuild without ever doing one.
+//  - Move keeps the leaf if the new box still fits in its fattened box, refits in place
+//    for small moves and reinserts for large ones.
+//  - Optimize spends a fixed number of rotations per call walking the whole tree, for
+//    trees that were built by many moves.
+//
+// Leaves are addressed by proxy ids, which stay valid until the leaf is removed.  Queries
+// are templates taking a callback with the item value.  Has no graphics API dependency.
+class DynamicBVH
+{
+public:
+    static const std::uint32_t NullNode = 0xffffffffu;
+
+    void Clear();
+
+    // Replaces the tree with bounds[0..count); item i gets value i and proxy id i.  Leaves
+    // are not fattened.
+    void BuildStatic(const BVHBounds* bounds, std::uint32_t count);
+
+    // Margin added on every side of moved and inserted leaves.
+    void SetMargin(float margin) { m_Margin = margin; }
+
+    std::uint32_t Insert(const BVHBounds& bounds, std::uint32_t item);
+    void Remove(std::uint32_t proxy);
+
+    // Returns true if the tree had to change.
+    bool Move(std::uint32_t proxy, const BVHBounds& bounds);
+
+    // Tries up to rotationCount rotations, continuing where the previous call stopped.
+    void Optimize(std::uint32_t rotationCount);
+
+    std::uint32_t GetItem(std::uint32_t proxy)const { return m_Nodes[proxy].Item; }
+    const BVHBounds& GetFatBounds(std::uint32_t proxy)const { return m_Nodes[proxy].Bounds; }
+    std::uint32_t GetLeafCount()const { return m_LeafCount; }
+    std::uint32_t GetNodeCount()const { return (std::uint32_t)m_Nodes.size() - m_FreeCount; }
+
+    std::uint32_t ComputeHeight()const;
+
+    // Sum of internal node areas relative to the root, the usual SAH quality measure.
+    // Lower is better.
+    float ComputeSAHCost()const;
+
+    // Calls visit(item) for every leaf not fully behind one of the planes (nx, ny, nz, d,
+    // inside >= 0).  Subtrees fully inside a plane stop testing it.
+    template<typename F>
+    void QueryFrustum(const float planes[6][4], F&& visit)const;
+
+    template<typename F>
+    void QuerySphere(const float center[3], float radius, F&& visit)const;
+
+    // Calls visit(item, entryT) for every leaf the ray enters before maxT.  visit returns
+    // the new maxT: return maxT to see every hit, the hit distance to only see closer
+    // ones, or 0 to stop.
+    template<typename F>
+    void QueryRay(const float origin[3], const float direction[3], float maxT, F&& visit)const;
+
+private:
+    struct Node
+    {
+        BVHBounds Bounds;
+        std::uint32_t Parent;
+
+        // Both NullNode for a leaf.
+        std::uint32_t Child[2];
+
+        std::uint32_t Item;
+
+        bool IsLeaf()const { return Child[0] == NullNode; }
+    };
+
+    std::uint32_t AllocateNode();
+    void FreeNode(std::uint32_t node);
+
+    void InsertLeaf(std::uint32_t leaf);
+    void RemoveLeaf(std::uint32_t leaf);
+
+    // Recomputes bounds from node to the root, rotating on the way.
+    void RefitFrom(std::uint32_t node);
+    void Rotate(std::uint32_t node);
+
+    struct BuildEntry
+    {
+        BVHBounds Bounds;
+        float Centroid[3];
+        std::uint32_t Leaf;
+    };
+
+    std::uint32_t BuildRange(BuildEntry* entries, std::uint32_t count, std::uint32_t depth);
+    std::uint32_t MakeParent(std::uint32_t left, std::uint32_t right);
+
+private:
+    std::vector<Node> m_Nodes;
+    std::uint32_t m_Root = NullNode;
+    std::uint32_t m_FreeList = NullNode;
+    std::uint32_t m_FreeCount = 0;
+    std::uint32_t m_LeafCount = 0;
+
+    float m_Margin = 0.0f;
+    std::uint32_t m_OptimizeCursor = 0;
+};
+
+template<typename F>
+void DynamicBVH::QueryFrustum(const float planes[6][4], F&& visit)const
+{
+    if (m_Root == NullNode)
+        return;
+
+    struct Entry
+    {
+        std::uint32_t Node;
+
+        // Planes still to be tested, one bit each.
+        std::uint32_t Mask;
+    };
+
+    std::vector<Entry> Stack;
+    Stack.reserve(64);
+    Stack.push_back({ m_Root, 0x3f });
+
+    while (!Stack.empty())
+    {
+        const Entry Current = Stack.back();
+        Stack.pop_back();
+
+        const Node& N = m_Nodes[Current.Node];
+
+        std::uint32_t Mask = Current.Mask;
+        bool bOutside = false;
+        for (std::uint32_t Plane = 0; Plane < 6 && !bOutside; ++Plane)
+        {
+            if ((Mask & (1u << Plane)) == 0)
+                continue;
+
+            const int Side = N.Bounds.ClassifyPlane(planes[Plane]);
+            if (Side < 0)
+                bOutside = true;
+            else if (Side > 0)
+                Mask &= ~(1u << Plane);
+        }
+
+        if (bOutside)
+            continue;
+
+        if (N.IsLeaf())
+            visit(N.Item);
+        else
+        {
+            Stack.push_back({ N.Child[1], Mask });
+            Stack.push_back({ N.Child[0], Mask });
+        }
+    }
+}
+
+template<typename F>
+void DynamicBVH::QuerySphere(const float center[3], float radius, F&& visit)const
+{
+    if (m_Root == NullNode)
+        return;
+
+    std::vector<std::uint32_t> Stack;
+    Stack.reserve(64);
+    Stack.push_back(m_Root);
+
+    while (!Stack.empty())
+    {
+        const Node& N = m_Nodes[Stack.back()];
+        Stack.pop_back();
+
+        if (!N.Bounds.OverlapsSphere(center, radius))
+            continue;
+
+        if (N.IsLeaf())
+            visit(N.Item);
+        else
+        {
+            Stack.push_back(N.Child[1]);
+            Stack.push_back(N.Child[0]);
+        }
+    }
+}
+
+template<typename F>
+void DynamicBVH::QueryRay(const float origin[3], const float direction[3], float maxT, F&& visit)const
+{
+    if (m_Root == NullNode)
+        return;
+
+    float InvDirection[3];
+    for (int i = 0; i < 3; ++i)
+    {
+        InvDirection[i] = 1.0f / direction[i];
+    }
+
+    std::vector<std::uint32_t> Stack;
+    Stack.reserve(64);
+    Stack.push_back(m_Root);
+
+    while (!Stack.empty() && maxT > 0.0f)
+    {
+        const Node& N = m_Nodes[Stack.back()];
+        Stack.pop_back();
+
+        const float EntryT = N.Bounds.IntersectRay(origin, InvDirection, maxT);
+        if (EntryT < 0.0f)
+            continue;
+
+        if (N.IsLeaf())
+            maxT = visit(N.Item, EntryT);
+        else
+        {
+            Stack.push_back(N.Child[1]);
+            Stack.push_back(N.Child[0]);
+        }
+    }
+}
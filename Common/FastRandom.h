@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+
+// Small seedable PCG32 generator.  Unlike MathHelper::RandF it does not share the global
+// rand() state, so a given seed always reproduces the same sequence on every platform.
+// Has no graphics API dependency.
+class FastRandom
+{
+public:
+    explicit FastRandom(std::uint64_t seed = 0x853c49e6748fea9bULL)
+    {
+        Seed(seed);
+    }
+
+    void Seed(std::uint64_t seed, std::uint64_t stream = 0xda3e39cb94b95bdbULL)
+    {
+        m_State = 0u;
+        m_Inc = (stream << 1u) | 1u;
+        NextUInt();
+        m_State += seed;
+        NextUInt();
+    }
+
+    std::uint32_t NextUInt()
+    {
+        const std::uint64_t Old = m_State;
+        m_State = Old * 6364136223846793005ULL + m_Inc;
+        const std::uint32_t XorShifted = (std::uint32_t)(((Old >> 18u) ^ Old) >> 27u);
+        const std::uint32_t Rot = (std::uint32_t)(Old >> 59u);
+        return (XorShifted >> Rot) | (XorShifted << ((32u - Rot) & 31u));
+    }
+
+    // Returns random float in [0, 1).
+    float NextFloat()
+    {
+        return (float)(NextUInt() >> 8) * (1.0f / 16777216.0f);
+    }
+
+    // Returns random float in [a, b).
+    float NextFloat(float a, float b)
+    {
+        return a + NextFloat() * (b - a);
+    }
+
+private:
+    std::uint64_t m_State = 0;
+    std::uint64_t m_Inc = 1;
+};
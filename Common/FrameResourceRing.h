@@ -0,0 +1,62 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// Hands out frame slots in turn and remembers the fence value signalled after each slot's
+// commands.  The CPU only waits when it comes back to a slot the GPU has not finished
+// with yet, so up to GetFrameCount() frames can be in flight.  Has no graphics API
+// dependency; the fence is passed in so a simulated one can drive it headless.
+//
+// Fence needs:
+//     std::uint64_t GetCompletedValue();
+//     void Wait(std::uint64_t value);      // returns once the value has been reached
+class FrameResourceRing
+{
+public:
+    explicit FrameResourceRing(std::uint32_t frameCount = 3)
+        : m_FenceValues((std::max)(frameCount, 1u), 0)
+    {
+    }
+
+    std::uint32_t GetFrameCount()const { return (std::uint32_t)m_FenceValues.size(); }
+    std::uint32_t GetCurrentIndex()const { return m_Current; }
+
+    // Fence value guarding the current slot; 0 if it has never been submitted.
+    std::uint64_t GetCurrentFence()const { return m_FenceValues[m_Current]; }
+
+    // Call before writing anything that belongs to the current slot.  Returns true if the
+    // CPU had to wait for the GPU.
+    template<typename Fence>
+    bool WaitForCurrent(Fence& fence)
+    {
+        const std::uint64_t Value = m_FenceValues[m_Current];
+        if (Value == 0 || fence.GetCompletedValue() >= Value)
+            return false;
+
+        fence.Wait(Value);
+        ++m_Stalls;
+        return true;
+    }
+
+    // Records the fence value signalled after the current slot's commands and moves on
+    // to the next slot.
+    void Advance(std::uint64_t signalledFence)
+    {
+        m_FenceValues[m_Current] = signalledFence;
+        m_Current = (m_Current + 1) % GetFrameCount();
+        ++m_Frames;
+    }
+
+    // Totals since creation.
+    std::uint64_t GetFrames()const { return m_Frames; }
+    std::uint64_t GetStalls()const { return m_Stalls; }
+
+private:
+    std::vector<std::uint64_t> m_FenceValues;
+    std::uint32_t m_Current = 0;
+
+    std::uint64_t m_Frames = 0;
+    std::uint64_t m_Stalls = 0;
+};
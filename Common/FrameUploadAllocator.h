@@ -0,0 +1,95 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+
+// Linear allocator over one persistently mapped upload buffer split into a region per
+// frame slot.  Everything a frame writes for the GPU (constants, instance data) is carved
+// out of its slot's region by bumping an offset; the whole region is reclaimed at once
+// when the slot comes round again, which FrameResourceRing only allows after the fence of
+// the slot's previous frame has passed.  Allocate is lock-free, so recording threads can
+// allocate alongside each other.  Works in byte offsets from the start of the buffer and
+// has no graphics API dependency; the caller adds them to its mapped pointer and GPU
+// address.
+//
+// Allocations made in the same order with the same sizes at the start of every frame get
+// the same offsets within their region, which lets callers keep data that rarely changes
+// in place across frames (see DirtyTracker).
+class FrameUploadAllocator
+{
+public:
+    static const std::uint64_t InvalidOffset = ~0ull;
+
+    // Constant buffer views need 256 byte aligned addresses.
+    static const std::uint64_t DefaultAlignment = 256;
+
+    // Total buffer size is regionSize * frameCount.
+    void Reset(std::uint64_t regionSize, std::uint32_t frameCount)
+    {
+        m_RegionSize = AlignUp(regionSize, DefaultAlignment);
+        m_FrameCount = (std::max)(frameCount, 1u);
+        m_RegionBegin = 0;
+        m_Offset.store(0, std::memory_order_relaxed);
+        m_Peak = 0;
+        m_bOverflowed = false;
+    }
+
+    std::uint64_t GetRegionSize()const { return m_RegionSize; }
+    std::uint64_t GetBufferSize()const { return m_RegionSize * m_FrameCount; }
+
+    // Starts allocating from the slot's region, dropping whatever the slot held.  Only
+    // call once the GPU is done with the slot's previous frame.
+    void BeginFrame(std::uint32_t slot)
+    {
+        const std::uint64_t Used = GetUsed();
+        m_Peak = (std::max)(m_Peak, Used);
+
+        m_RegionBegin = (std::uint64_t)(slot % m_FrameCount) * m_RegionSize;
+        m_Offset.store(m_RegionBegin, std::memory_order_relaxed);
+        m_bOverflowed = false;
+    }
+
+    // Returns the offset of size bytes at the given power of two alignment, or
+    // InvalidOffset if the region is full.  Safe to call from several threads at once.
+    std::uint64_t Allocate(std::uint64_t size, std::uint64_t alignment = DefaultAlignment)
+    {
+        const std::uint64_t RegionEnd = m_RegionBegin + m_RegionSize;
+
+        std::uint64_t Current = m_Offset.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            const std::uint64_t Begin = AlignUp(Current, alignment);
+            const std::uint64_t End = Begin + size;
+            if (End > RegionEnd)
+            {
+                m_bOverflowed = true;
+                return InvalidOffset;
+            }
+
+            if (m_Offset.compare_exchange_weak(Current, End, std::memory_order_relaxed))
+                return Begin;
+        }
+    }
+
+    // Bytes handed out in the current frame, and the most any finished frame used.
+    std::uint64_t GetUsed()const { return m_Offset.load(std::memory_order_relaxed) - m_RegionBegin; }
+    std::uint64_t GetPeak()const { return m_Peak; }
+
+    // True if an allocation in the current frame did not fit.
+    bool HasOverflowed()const { return m_bOverflowed; }
+
+    static std::uint64_t AlignUp(std::uint64_t value, std::uint64_t alignment)
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+
+private:
+    std::uint64_t m_RegionSize = 0;
+    std::uint32_t m_FrameCount = 1;
+    std::uint64_t m_RegionBegin = 0;
+    std::atomic<std::uint64_t> m_Offset{ 0 };
+
+    std::uint64_t m_Peak = 0;
+    std::atomic<bool> m_bOverflowed{ false };
+};
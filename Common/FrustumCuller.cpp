@@ -0,0 +1,284 @@
+#include "FrustumCuller.h"
+
+#include <cmath>
+
+// The AVX kernel is compiled for every x86 build and chosen at run time.  It only uses
+// AVX (no FMA) and does the arithmetic in the same order as the scalar path, so both
+// paths give bit-identical results.
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CULL_USE_AVX 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define CULL_AVX_TARGET
+#else
+#define CULL_AVX_TARGET __attribute__((target("avx")))
+#endif
+#else
+#define CULL_USE_AVX 0
+#endif
+
+void FrustumCuller::Clear()
+{
+    for (std::vector<float>& Stream : m_Streams)
+    {
+        Stream.clear();
+    }
+    m_Count = 0;
+}
+
+std::uint32_t FrustumCuller::AddItem(const float localCenter[3], const float localExtents[3], const float world[16])
+{
+    m_Streams[CenterX].push_back(localCenter[0]);
+    m_Streams[CenterY].push_back(localCenter[1]);
+    m_Streams[CenterZ].push_back(localCenter[2]);
+    m_Streams[ExtentX].push_back(localExtents[0]);
+    m_Streams[ExtentY].push_back(localExtents[1]);
+    m_Streams[ExtentZ].push_back(localExtents[2]);
+
+    for (int Stream = M00; Stream < StreamCount; ++Stream)
+    {
+        m_Streams[Stream].push_back(0.0f);
+    }
+
+    SetWorld(m_Count, world);
+    return m_Count++;
+}
+
+void FrustumCuller::SetWorld(std::uint32_t item, const float world[16])
+{
+    for (int Row = 0; Row < 4; ++Row)
+    {
+        for (int Column = 0; Column < 3; ++Column)
+        {
+            m_Streams[M00 + Row * 3 + Column][item] = world[Row * 4 + Column];
+        }
+    }
+}
+
+void FrustumCuller::SetViewProjection(const float viewProj[16])
+{
+    ExtractPlanes(viewProj, m_Planes);
+}
+
+void FrustumCuller::ExtractPlanes(const float viewProj[16], float outPlanes[6][4])
+{
+    // With row vectors clip = v * M, so every plane is a combination of the columns.
+    auto Column = [&](int c, int row) { return viewProj[row * 4 + c]; };
+
+    for (int Row = 0; Row < 4; ++Row)
+    {
+        outPlanes[0][Row] = Column(3, Row) + Column(0, Row);     // left    -w <= x
+        outPlanes[1][Row] = Column(3, Row) - Column(0, Row);     // right    x <= w
+        outPlanes[2][Row] = Column(3, Row) + Column(1, Row);     // bottom  -w <= y
+        outPlanes[3][Row] = Column(3, Row) - Column(1, Row);     // top      y <= w
+        outPlanes[4][Row] = Column(2, Row);                      // near     0 <= z
+        outPlanes[5][Row] = Column(3, Row) - Column(2, Row);     // far      z <= w
+    }
+
+    for (int PlaneIndex = 0; PlaneIndex < 6; ++PlaneIndex)
+    {
+        float* Plane = outPlanes[PlaneIndex];
+        const float Length = std::sqrt(Plane[0] * Plane[0] + Plane[1] * Plane[1] + Plane[2] * Plane[2]);
+        const float InvLength = Length > 0.0f ? 1.0f / Length : 0.0f;
+        for (int i = 0; i < 4; ++i)
+        {
+            Plane[i] *= InvLength;
+        }
+    }
+}
+
+std::uint32_t FrustumCuller::Cull(std::vector<std::uint32_t>& outVisible, CullPath path)const
+{
+    outVisible.clear();
+    outVisible.reserve(m_Count);
+
+    if (path == CullPath::Auto)
+        path = IsAVXAvailable() ? CullPath::AVX : CullPath::Scalar;
+
+    if (path == CullPath::AVX && IsAVXAvailable())
+        return CullAVX(outVisible);
+
+    return CullScalar(0, outVisible);
+}
+
+bool FrustumCuller::IsVisibleScalar(std::uint32_t i)const
+{
+    const float Cx = m_Streams[CenterX][i];
+    const float Cy = m_Streams[CenterY][i];
+    const float Cz = m_Streams[CenterZ][i];
+    const float Ex = m_Streams[ExtentX][i];
+    const float Ey = m_Streams[ExtentY][i];
+    const float Ez = m_Streams[ExtentZ][i];
+
+    float M[12];
+    for (int k = 0; k < 12; ++k)
+    {
+        M[k] = m_Streams[M00 + k][i];
+    }
+
+    // World-space box: transformed center, extents through the absolute matrix.
+    const float Wx = Cx * M[0] + Cy * M[3] + Cz * M[6] + M[9];
+    const float Wy = Cx * M[1] + Cy * M[4] + Cz * M[7] + M[10];
+    const float Wz = Cx * M[2] + Cy * M[5] + Cz * M[8] + M[11];
+
+    const float Rx = Ex * std::fabs(M[0]) + Ey * std::fabs(M[3]) + Ez * std::fabs(M[6]);
+    const float Ry = Ex * std::fabs(M[1]) + Ey * std::fabs(M[4]) + Ez * std::fabs(M[7]);
+    const float Rz = Ex * std::fabs(M[2]) + Ey * std::fabs(M[5]) + Ez * std::fabs(M[8]);
+
+    for (const float* Plane : m_Planes)
+    {
+        const float Distance = Plane[0] * Wx + Plane[1] * Wy + Plane[2] * Wz + Plane[3];
+        const float Radius = std::fabs(Plane[0]) * Rx + std::fabs(Plane[1]) * Ry + std::fabs(Plane[2]) * Rz;
+        if (Distance + Radius < 0.0f)
+            return false;
+    }
+
+    return true;
+}
+
+std::uint32_t FrustumCuller::CullScalar(std::uint32_t begin, std::vector<std::uint32_t>& outVisible)const
+{
+    for (std::uint32_t i = begin; i < m_Count; ++i)
+    {
+        if (IsVisibleScalar(i))
+            outVisible.push_back(i);
+    }
+
+    return (std::uint32_t)outVisible.size();
+}
+
+#if CULL_USE_AVX
+
+namespace
+{
+    CULL_AVX_TARGET inline __m256 Abs(__m256 v)
+    {
+        return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), v);
+    }
+
+    CULL_AVX_TARGET std::uint32_t CullBlocksAVX(const std::vector<float>* streams, std::uint32_t blockCount,
+        const float (*planes)[4], std::vector<std::uint32_t>& outVisible)
+    {
+        __m256 PlaneX[6], PlaneY[6], PlaneZ[6], PlaneD[6], AbsX[6], AbsY[6], AbsZ[6];
+        for (int p = 0; p < 6; ++p)
+        {
+            PlaneX[p] = _mm256_set1_ps(planes[p][0]);
+            PlaneY[p] = _mm256_set1_ps(planes[p][1]);
+            PlaneZ[p] = _mm256_set1_ps(planes[p][2]);
+            PlaneD[p] = _mm256_set1_ps(planes[p][3]);
+            AbsX[p] = Abs(PlaneX[p]);
+            AbsY[p] = Abs(PlaneY[p]);
+            AbsZ[p] = Abs(PlaneZ[p]);
+        }
+
+        const __m256 Zero = _mm256_setzero_ps();
+
+        // Stream order matches FrustumCuller::Stream.
+        const float* S[18];
+        for (int Stream = 0; Stream < 18; ++Stream)
+        {
+            S[Stream] = streams[Stream].data();
+        }
+
+        for (std::uint32_t Block = 0; Block < blockCount; ++Block)
+        {
+            const std::uint32_t Base = Block * 8;
+
+            const __m256 Cx = _mm256_loadu_ps(S[0] + Base), Cy = _mm256_loadu_ps(S[1] + Base), Cz = _mm256_loadu_ps(S[2] + Base);
+            const __m256 Ex = _mm256_loadu_ps(S[3] + Base), Ey = _mm256_loadu_ps(S[4] + Base), Ez = _mm256_loadu_ps(S[5] + Base);
+
+            const __m256 M00 = _mm256_loadu_ps(S[6] + Base), M01 = _mm256_loadu_ps(S[7] + Base), M02 = _mm256_loadu_ps(S[8] + Base);
+            const __m256 M10 = _mm256_loadu_ps(S[9] + Base), M11 = _mm256_loadu_ps(S[10] + Base), M12 = _mm256_loadu_ps(S[11] + Base);
+            const __m256 M20 = _mm256_loadu_ps(S[12] + Base), M21 = _mm256_loadu_ps(S[13] + Base), M22 = _mm256_loadu_ps(S[14] + Base);
+            const __m256 M30 = _mm256_loadu_ps(S[15] + Base), M31 = _mm256_loadu_ps(S[16] + Base), M32 = _mm256_loadu_ps(S[17] + Base);
+
+            const __m256 Wx = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(Cx, M00), _mm256_mul_ps(Cy, M10)), _mm256_mul_ps(Cz, M20)), M30);
+            const __m256 Wy = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(Cx, M01), _mm256_mul_ps(Cy, M11)), _mm256_mul_ps(Cz, M21)), M31);
+            const __m256 Wz = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(Cx, M02), _mm256_mul_ps(Cy, M12)), _mm256_mul_ps(Cz, M22)), M32);
+
+            const __m256 Rx = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(Ex, Abs(M00)), _mm256_mul_ps(Ey, Abs(M10))), _mm256_mul_ps(Ez, Abs(M20)));
+            const __m256 Ry = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(Ex, Abs(M01)), _mm256_mul_ps(Ey, Abs(M11))), _mm256_mul_ps(Ez, Abs(M21)));
+            const __m256 Rz = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(Ex, Abs(M02)), _mm256_mul_ps(Ey, Abs(M12))), _mm256_mul_ps(Ez, Abs(M22)));
+
+            __m256 Outside = _mm256_setzero_ps();
+            for (int p = 0; p < 6; ++p)
+            {
+                const __m256 Distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(
+                    _mm256_mul_ps(PlaneX[p], Wx), _mm256_mul_ps(PlaneY[p], Wy)), _mm256_mul_ps(PlaneZ[p], Wz)), PlaneD[p]);
+                const __m256 Radius = _mm256_add_ps(_mm256_add_ps(
+                    _mm256_mul_ps(AbsX[p], Rx), _mm256_mul_ps(AbsY[p], Ry)), _mm256_mul_ps(AbsZ[p], Rz));
+
+                Outside = _mm256_or_ps(Outside, _mm256_cmp_ps(_mm256_add_ps(Distance, Radius), Zero, _CMP_LT_OQ));
+            }
+
+            std::uint32_t VisibleMask = ~(std::uint32_t)_mm256_movemask_ps(Outside) & 0xff;
+            while (VisibleMask != 0)
+            {
+                std::uint32_t Lane = 0;
+                while ((VisibleMask & (1u << Lane)) == 0)
+                {
+                    ++Lane;
+                }
+                outVisible.push_back(Base + Lane);
+                VisibleMask &= VisibleMask - 1;
+            }
+        }
+
+        return (std::uint32_t)outVisible.size();
+    }
+}
+
+std::uint32_t FrustumCuller::CullAVX(std::vector<std::uint32_t>& outVisible)const
+{
+    const std::uint32_t BlockCount = m_Count / 8;
+    CullBlocksAVX(m_Streams, BlockCount, m_Planes, outVisible);
+
+    // The last partial block goes through the scalar path.
+    return CullScalar(BlockCount * 8, outVisible);
+}
+
+bool FrustumCuller::IsAVXAvailable()
+{
+    static const bool bAvailable = []()
+    {
+#if defined(_MSC_VER)
+        int Info[4];
+        __cpuid(Info, 1);
+
+        // AVX in leaf 1, and the OS must save the YMM registers.
+        const bool bOSXSave = (Info[2] & (1 << 27)) != 0;
+        const bool bAVX = (Info[2] & (1 << 28)) != 0;
+        return bOSXSave && bAVX && (_xgetbv(0) & 6) == 6;
+#else
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx") != 0;
+#endif
+    }();
+
+    return bAvailable;
+}
+
+#else
+
+std::uint32_t FrustumCuller::CullAVX(std::vector<std::uint32_t>& outVisible)const
+{
+    return CullScalar(0, outVisible);
+}
+
+bool FrustumCuller::IsAVXAvailable()
+{
+    return false;
+}
+
+#endif
+
+const char* FrustumCuller::GetPathName(CullPath path)
+{
+    switch (path)
+    {
+    case CullPath::Scalar:  return "scalar";
+    case CullPath::AVX:     return "avx";
+    default:                return IsAVXAvailable() ? "avx" : "scalar";
+    }
+}
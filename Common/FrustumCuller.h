@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+enum class CullPath
+{
+    // AVX when the CPU has it, scalar otherwise.
+    Auto,
+    Scalar,
+    AVX,
+};
+
+// Culls world-space boxes against the six planes of a view-projection frustum.  Items are
+// a local-space AABB (center and half extents) plus a world matrix, kept in
+// structure-of-arrays form so the AVX path transforms and tests 8 items per iteration.
+// Has no graphics API dependency.
+//
+// Matrices use the DirectXMath layout: row vectors, v' = v * M, translation in row 3, and
+// a D3D clip space with 0 <= z <= w.
+//
+// The test is the usual conservative one: a box is culled only if it lies entirely behind
+// one plane.  Boxes near a frustum corner may be kept although they are outside, never the
+// other way round.
+class FrustumCuller
+{
+public:
+    void Clear();
+
+    // Returns the item index; indices are assigned in order starting at 0.
+    std::uint32_t AddItem(const float localCenter[3], const float localExtents[3], const float world[16]);
+    void SetWorld(std::uint32_t item, const float world[16]);
+
+    std::uint32_t GetItemCount()const { return m_Count; }
+
+    // Extracts and normalizes the planes, pointing into the frustum.
+    void SetViewProjection(const float viewProj[16]);
+
+    // The same extraction for callers that test against the planes themselves, in the
+    // order left, right, bottom, top, near, far.
+    static void ExtractPlanes(const float viewProj[16], float outPlanes[6][4]);
+
+    // Clears outVisible and appends the indices of the items that may be visible, in
+    // increasing order.  Returns the count.
+    std::uint32_t Cull(std::vector<std::uint32_t>& outVisible, CullPath path = CullPath::Auto)const;
+
+    // Plane i as (nx, ny, nz, d) with nx*x + ny*y + nz*z + d >= 0 inside.
+    const float* GetPlane(std::uint32_t i)const { return m_Planes[i]; }
+
+    static bool IsAVXAvailable();
+    static const char* GetPathName(CullPath path);
+
+private:
+    enum Stream
+    {
+        CenterX, CenterY, CenterZ,
+        ExtentX, ExtentY, ExtentZ,
+
+        // The upper 4x3 of the world matrix; the last column is always (0, 0, 0, 1).
+        M00, M01, M02,
+        M10, M11, M12,
+        M20, M21, M22,
+        M30, M31, M32,
+
+        StreamCount
+    };
+
+    bool IsVisibleScalar(std::uint32_t item)const;
+    std::uint32_t CullScalar(std::uint32_t begin, std::vector<std::uint32_t>& outVisible)const;
+    std::uint32_t CullAVX(std::vector<std::uint32_t>& outVisible)const;
+
+private:
+    std::vector<float> m_Streams[StreamCount];
+    std::uint32_t m_Count = 0;
+
+    float m_Planes[6][4] = {};
+};
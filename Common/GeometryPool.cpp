@@ -0,0 +1,218 @@
+#include "GeometryPool.h"
+
+using Microsoft::WRL::ComPtr;
+
+void GeometryPool::Initialize(ID3D12Device* device, GpuMemoryAllocator* allocator, UINT64 bufferByteSize)
+{
+    m_Device = device;
+    m_Allocator = allocator;
+    m_BufferByteSize = bufferByteSize;
+}
+
+GeometryRange GeometryPool::AddVertices(const void* data, UINT count, UINT stride)
+{
+    return Add(data, count, stride, stride);
+}
+
+GeometryRange GeometryPool::AddIndices(const std::uint32_t* data, UINT count)
+{
+    return Add(data, count, 0, sizeof(std::uint32_t));
+}
+
+GeometryRange GeometryPool::Add(const void* data, UINT count, UINT stride, UINT elementSize)
+{
+    GeometryRange Range;
+    if (count == 0)
+        return Range;
+
+    // Best fit over the chain for this stride, then a new buffer.
+    for (UINT i = 0; i < (UINT)m_Buffers.size() && !Range.IsValid(); ++i)
+    {
+        Buffer& B = m_Buffers[i];
+        if (B.Stride != stride || B.ElementSize != elementSize)
+            continue;
+
+        const std::uint32_t First = B.Ranges.Allocate(count);
+        if (First != RangeAllocator::InvalidOffset)
+        {
+            Range.Buffer = i;
+            Range.First = First;
+        }
+    }
+
+    if (!Range.IsValid())
+    {
+        Range.Buffer = CreateBuffer(stride, elementSize, count);
+        Range.First = m_Buffers[Range.Buffer].Ranges.Allocate(count);
+    }
+    Range.Count = count;
+
+    const UINT64 ByteSize = (UINT64)count * elementSize;
+
+    PendingCopy Copy;
+    Copy.Buffer = Range.Buffer;
+    Copy.DstOffset = (UINT64)Range.First * elementSize;
+    Copy.StagingOffset = m_PendingData.size();
+    Copy.Size = ByteSize;
+    m_PendingCopies.push_back(Copy);
+
+    const BYTE* Bytes = reinterpret_cast<const BYTE*>(data);
+    m_PendingData.insert(m_PendingData.end(), Bytes, Bytes + ByteSize);
+
+    m_Stats.UsedBytes += ByteSize;
+    m_Stats.SeparateResourceCount += 2;
+    m_Stats.SeparateBytes += 2 * d3dUtil::AlignUp(ByteSize, (UINT64)D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+
+    return Range;
+}
+
+UINT GeometryPool::CreateBuffer(UINT stride, UINT elementSize, UINT minCount)
+{
+    const UINT Capacity = (UINT)(std::max)((UINT64)minCount, m_BufferByteSize / elementSize);
+    const UINT64 ByteSize = (UINT64)Capacity * elementSize;
+
+    Buffer NewBuffer;
+    NewBuffer.Stride = stride;
+    NewBuffer.ElementSize = elementSize;
+    NewBuffer.Ranges.Reset(Capacity);
+
+    if (m_Allocator != nullptr)
+    {
+        ThrowIfFailed(m_Allocator->CreateResource(
+            D3D12_HEAP_TYPE_DEFAULT,
+            CD3DX12_RESOURCE_DESC::Buffer(ByteSize),
+            D3D12_RESOURCE_STATE_COMMON,
+            nullptr,
+            IID_PPV_ARGS(NewBuffer.Resource.GetAddressOf())));
+    }
+    else
+    {
+        ThrowIfFailed(m_Device->CreateCommittedResource(
+            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+            D3D12_HEAP_FLAG_NONE,
+            &CD3DX12_RESOURCE_DESC::Buffer(ByteSize),
+            D3D12_RESOURCE_STATE_COMMON,
+            nullptr,
+            IID_PPV_ARGS(NewBuffer.Resource.GetAddressOf())));
+    }
+
+    m_Buffers.push_back(std::move(NewBuffer));
+
+    ++m_Stats.BufferCount;
+    m_Stats.BufferBytes += ByteSize;
+
+    return (UINT)m_Buffers.size() - 1;
+}
+
+void GeometryPool::Free(const GeometryRange& range)
+{
+    if (!range.IsValid())
+        return;
+
+    Buffer& B = m_Buffers[range.Buffer];
+    B.Ranges.Free(range.First, range.Count);
+
+    m_Stats.UsedBytes -= (UINT64)range.Count * B.ElementSize;
+}
+
+void GeometryPool::Execute(ID3D12GraphicsCommandList* cmdList, UploadRing* ring, UINT64 fenceValue)
+{
+    if (m_PendingCopies.empty())
+        return;
+
+    ComPtr<ID3D12Resource> Staging;
+    UINT64 StagingBase = 0;
+
+    UploadRingAllocation RingSpace;
+    if (ring != nullptr && ring->Allocate(m_PendingData.size(), 16, RingSpace))
+    {
+        memcpy(RingSpace.CpuAddress, m_PendingData.data(), m_PendingData.size());
+        ring->Retire(RingSpace, fenceValue);
+
+        Staging = RingSpace.Resource;
+        StagingBase = RingSpace.Offset;
+        ++m_Stats.RingUploadCount;
+    }
+    else
+    {
+        ThrowIfFailed(m_Device->CreateCommittedResource(
+            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+            D3D12_HEAP_FLAG_NONE,
+            &CD3DX12_RESOURCE_DESC::Buffer(m_PendingData.size()),
+            D3D12_RESOURCE_STATE_GENERIC_READ,
+            nullptr,
+            IID_PPV_ARGS(Staging.GetAddressOf())));
+
+        BYTE* MappedStaging = nullptr;
+        ThrowIfFailed(Staging->Map(0, nullptr, reinterpret_cast<void**>(&MappedStaging)));
+        memcpy(MappedStaging, m_PendingData.data(), m_PendingData.size());
+        Staging->Unmap(0, nullptr);
+
+        ++m_Stats.UploadBufferCount;
+        m_Staging.push_back(Staging);
+    }
+
+    // Every buffer receiving data goes to COPY_DEST once, with one barrier call either side.
+    std::vector<bool> bTouched(m_Buffers.size(), false);
+    for (const PendingCopy& Copy : m_PendingCopies)
+    {
+        bTouched[Copy.Buffer] = true;
+    }
+
+    std::vector<D3D12_RESOURCE_BARRIER> Barriers;
+    for (UINT i = 0; i < (UINT)m_Buffers.size(); ++i)
+    {
+        if (bTouched[i])
+            Barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(m_Buffers[i].Resource.Get(), m_Buffers[i].State, D3D12_RESOURCE_STATE_COPY_DEST));
+    }
+    cmdList->ResourceBarrier((UINT)Barriers.size(), Barriers.data());
+
+    for (const PendingCopy& Copy : m_PendingCopies)
+    {
+        cmdList->CopyBufferRegion(m_Buffers[Copy.Buffer].Resource.Get(), Copy.DstOffset, Staging.Get(), StagingBase + Copy.StagingOffset, Copy.Size);
+    }
+
+    Barriers.clear();
+    for (UINT i = 0; i < (UINT)m_Buffers.size(); ++i)
+    {
+        if (!bTouched[i])
+            continue;
+
+        Barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(m_Buffers[i].Resource.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_GENERIC_READ));
+        m_Buffers[i].State = D3D12_RESOURCE_STATE_GENERIC_READ;
+    }
+    cmdList->ResourceBarrier((UINT)Barriers.size(), Barriers.data());
+
+    m_Stats.StagingBytes = m_PendingData.size();
+
+    m_PendingCopies.clear();
+    m_PendingData.clear();
+    m_PendingData.shrink_to_fit();
+}
+
+void GeometryPool::ReleaseStaging()
+{
+    m_Staging.clear();
+}
+
+D3D12_VERTEX_BUFFER_VIEW GeometryPool::GetVertexBufferView(const GeometryRange& range)const
+{
+    const Buffer& B = m_Buffers[range.Buffer];
+
+    D3D12_VERTEX_BUFFER_VIEW View;
+    View.BufferLocation = B.Resource->GetGPUVirtualAddress();
+    View.StrideInBytes = B.Stride;
+    View.SizeInBytes = B.Ranges.GetCapacity() * B.ElementSize;
+    return View;
+}
+
+D3D12_INDEX_BUFFER_VIEW GeometryPool::GetIndexBufferView(const GeometryRange& range)const
+{
+    const Buffer& B = m_Buffers[range.Buffer];
+
+    D3D12_INDEX_BUFFER_VIEW View;
+    View.BufferLocation = B.Resource->GetGPUVirtualAddress();
+    View.Format = DXGI_FORMAT_R32_UINT;
+    View.SizeInBytes = B.Ranges.GetCapacity() * B.ElementSize;
+    return View;
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "d3dUtil.h"
+#include "GpuMemoryAllocator.h"
+#include "RangeAllocator.h"
+#include "UploadRing.h"
+
+// Vertices or indices of one mesh inside a GeometryPool buffer.  First and Count are in
+// elements, so First is the mesh's BaseVertexLocation or StartIndexLocation.
+struct GeometryRange
+{
+    UINT Buffer = 0xffffffff;
+    UINT First = 0;
+    UINT Count = 0;
+
+    bool IsValid()const { return Buffer != 0xffffffff; }
+};
+
+struct GeometryPoolStats
+{
+    // Default-heap buffers and the bytes they take.
+    UINT BufferCount = 0;
+    UINT64 BufferBytes = 0;
+
+    // Bytes in live ranges.
+    UINT64 UsedBytes = 0;
+
+    // Upload buffers created by Execute so far, and the size of the last upload.
+    UINT UploadBufferCount = 0;
+    UINT64 StagingBytes = 0;
+
+    // Uploads that went through an UploadRing instead of a buffer of their own.
+    UINT RingUploadCount = 0;
+
+    // What the same meshes would take as one committed default buffer plus one kept upload
+    // buffer each for vertices and for indices (committed buffers are placed at 64KB).
+    UINT SeparateResourceCount = 0;
+    UINT64 SeparateBytes = 0;
+};
+
+// Keeps mesh vertices and indices in a few large default-heap buffers: a chain of buffers
+// per vertex stride and one chain for 32 bit indices, each sub-allocated with a
+// RangeAllocator.  A mesh only holds ranges; every mesh of a stride shares one vertex
+// buffer view and one index buffer view, and selects itself with BaseVertexLocation and
+// StartIndexLocation.
+// Add copies the data into a CPU staging area and Execute records all pending copies from
+// the upload ring, or from one upload buffer like TextureBatchLoader when the ring is too
+// small.
+class GeometryPool
+{
+public:
+    // Buffers are bufferByteSize big unless a single mesh needs more.  With an allocator
+    // they are placed in its heaps, otherwise created committed.
+    void Initialize(ID3D12Device* device, GpuMemoryAllocator* allocator = nullptr, UINT64 bufferByteSize = 4 * 1024 * 1024);
+
+    GeometryRange AddVertices(const void* data, UINT count, UINT stride);
+    GeometryRange AddIndices(const std::uint32_t* data, UINT count);
+
+    // Only call once the GPU no longer reads the range.
+    void Free(const GeometryRange& range);
+
+    // Records the copies of everything added since the last call.
+    // fenceValue: value signalled after cmdList executes; releases the ring space.
+    void Execute(ID3D12GraphicsCommandList* cmdList, UploadRing* ring = nullptr, UINT64 fenceValue = 0);
+
+    // Call after the fence covering the recorded copies has been reached.
+    void ReleaseStaging();
+
+    // Views over the whole buffer holding the range.
+    D3D12_VERTEX_BUFFER_VIEW GetVertexBufferView(const GeometryRange& range)const;
+    D3D12_INDEX_BUFFER_VIEW GetIndexBufferView(const GeometryRange& range)const;
+
+    const GeometryPoolStats& GetStats()const { return m_Stats; }
+
+private:
+    struct Buffer
+    {
+        Microsoft::WRL::ComPtr<ID3D12Resource> Resource;
+
+        // 0 for index buffers.
+        UINT Stride = 0;
+        UINT ElementSize = 0;
+
+        RangeAllocator Ranges;
+        D3D12_RESOURCE_STATES State = D3D12_RESOURCE_STATE_COMMON;
+    };
+
+    struct PendingCopy
+    {
+        UINT Buffer;
+        UINT64 DstOffset;
+        UINT64 StagingOffset;
+        UINT64 Size;
+    };
+
+    GeometryRange Add(const void* data, UINT count, UINT stride, UINT elementSize);
+    UINT CreateBuffer(UINT stride, UINT elementSize, UINT minCount);
+
+private:
+    Microsoft::WRL::ComPtr<ID3D12Device> m_Device;
+    GpuMemoryAllocator* m_Allocator = nullptr;
+    UINT64 m_BufferByteSize = 0;
+
+    std::vector<Buffer> m_Buffers;
+
+    std::vector<BYTE> m_PendingData;
+    std::vector<PendingCopy> m_PendingCopies;
+
+    // Upload buffers of Execute calls whose fence has not been reached yet.
+    std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> m_Staging;
+
+    GeometryPoolStats m_Stats;
+};
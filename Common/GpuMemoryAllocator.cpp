@@ -0,0 +1,282 @@
+#include "GpuMemoryAllocator.h"
+
+using Microsoft::WRL::ComPtr;
+
+void GpuMemoryAllocator::Initialize(ID3D12Device* device, UINT64 blockSize)
+{
+    m_Device = device;
+    m_BlockSize = blockSize;
+
+    for (UINT Type = 0; Type < HeapTypeCount; ++Type)
+    {
+        for (UINT Category = 0; Category < (UINT)GpuResourceCategory::Count; ++Category)
+        {
+            Pool& P = m_Pools[Type * (UINT)GpuResourceCategory::Count + Category];
+            P.HeapType = (D3D12_HEAP_TYPE)(D3D12_HEAP_TYPE_DEFAULT + Type);
+            P.Category = (GpuResourceCategory)Category;
+
+            // Only plain textures can use the 4KB small resource placement.
+            const UINT64 Granularity = P.Category == GpuResourceCategory::Texture ?
+                D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT : D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+            P.Blocks.Reset(blockSize, Granularity);
+            P.Heaps.clear();
+        }
+    }
+}
+
+UINT GpuMemoryAllocator::GetPoolIndex(D3D12_HEAP_TYPE heapType, GpuResourceCategory category)
+{
+    return (UINT)(heapType - D3D12_HEAP_TYPE_DEFAULT) * (UINT)GpuResourceCategory::Count + (UINT)category;
+}
+
+GpuResourceCategory GpuMemoryAllocator::GetCategory(const D3D12_RESOURCE_DESC& desc)
+{
+    if (desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
+        return GpuResourceCategory::Buffer;
+
+    if (desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL))
+        return GpuResourceCategory::RenderTarget;
+
+    return GpuResourceCategory::Texture;
+}
+
+HRESULT GpuMemoryAllocator::CreateResource(
+    D3D12_HEAP_TYPE heapType,
+    const D3D12_RESOURCE_DESC& desc,
+    D3D12_RESOURCE_STATES initialState,
+    const D3D12_CLEAR_VALUE* clearValue,
+    REFIID riid,
+    void** resource)
+{
+    if (heapType < D3D12_HEAP_TYPE_DEFAULT || heapType > D3D12_HEAP_TYPE_READBACK)
+        return E_INVALIDARG;
+
+    const GpuResourceCategory Category = GetCategory(desc);
+
+    // Small single-sample textures may be placed at 4KB; the device says whether this one
+    // qualifies by returning the alignment it was asked for.
+    D3D12_RESOURCE_DESC Desc = desc;
+    D3D12_RESOURCE_ALLOCATION_INFO Info = {};
+    bool bSmall = false;
+
+    if (Category == GpuResourceCategory::Texture && Desc.SampleDesc.Count <= 1 && Desc.Alignment == 0)
+    {
+        Desc.Alignment = D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT;
+        Info = m_Device->GetResourceAllocationInfo(0, 1, &Desc);
+        bSmall = Info.Alignment == D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT;
+    }
+
+    if (!bSmall)
+    {
+        Desc.Alignment = desc.Alignment;
+        Info = m_Device->GetResourceAllocationInfo(0, 1, &Desc);
+    }
+
+    if (Info.SizeInBytes == UINT64_MAX)
+        return E_INVALIDARG;
+
+    // A committed resource takes a heap of its own, at least 64KB (4MB for MSAA).
+    const UINT64 CommittedAlignment = (std::max)(Info.Alignment, (UINT64)D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+
+    std::lock_guard<std::mutex> Guard(m_Lock);
+
+    return PlaceResource(GetPoolIndex(heapType, Category), Desc, Info.SizeInBytes, Info.Alignment,
+        d3dUtil::AlignUp(Info.SizeInBytes, CommittedAlignment), bSmall, initialState, clearValue, riid, resource);
+}
+
+HRESULT GpuMemoryAllocator::PlaceResource(
+    UINT pool,
+    const D3D12_RESOURCE_DESC& desc,
+    UINT64 size,
+    UINT64 alignment,
+    UINT64 committedBytes,
+    bool bSmall,
+    D3D12_RESOURCE_STATES initialState,
+    const D3D12_CLEAR_VALUE* clearValue,
+    REFIID riid,
+    void** resource)
+{
+    Pool& P = m_Pools[pool];
+
+    PoolAllocation Allocation;
+    bool bNewBlock = false;
+    if (!P.Blocks.Allocate(size, alignment, Allocation, bNewBlock))
+        return E_OUTOFMEMORY;
+
+    // Not only for new blocks: a block whose heap could not be created may have been
+    // kept as the pool's empty block.
+    HRESULT hr = EnsureHeap(pool, Allocation.Block);
+
+    // Resources are created as IID_ID3D12Resource so the map key is the same pointer
+    // Release gets; other interfaces are queried from it.
+    ComPtr<ID3D12Resource> Resource;
+    if (SUCCEEDED(hr))
+        hr = m_Device->CreatePlacedResource(P.Heaps[Allocation.Block].Get(), Allocation.Offset, &desc, initialState, clearValue, IID_PPV_ARGS(&Resource));
+    if (SUCCEEDED(hr))
+        hr = Resource->QueryInterface(riid, resource);
+
+    Placement NewPlacement;
+    NewPlacement.Pool = pool;
+    NewPlacement.Allocation = Allocation;
+    NewPlacement.CommittedBytes = committedBytes;
+    NewPlacement.bSmall = bSmall;
+    NewPlacement.Desc = desc;
+    NewPlacement.bClearValue = clearValue != nullptr;
+    if (clearValue != nullptr)
+        NewPlacement.ClearValue = *clearValue;
+
+    if (FAILED(hr))
+    {
+        FreePlacement(NewPlacement);
+        return hr;
+    }
+
+    // The caller's reference keeps the resource alive; the map holds a raw pointer.
+    AddPlacement(Resource.Get(), NewPlacement);
+    return S_OK;
+}
+
+void GpuMemoryAllocator::AddPlacement(ID3D12Resource* resource, const Placement& placement)
+{
+    m_Placements[resource] = placement;
+    m_CommittedBytes += placement.CommittedBytes;
+    if (placement.bSmall)
+        ++m_SmallTextureCount;
+}
+
+HRESULT GpuMemoryAllocator::EnsureHeap(UINT pool, UINT block)
+{
+    Pool& P = m_Pools[pool];
+    if (block < P.Heaps.size() && P.Heaps[block] != nullptr)
+        return S_OK;
+
+    D3D12_HEAP_DESC HeapDesc = {};
+    HeapDesc.SizeInBytes = P.Blocks.GetBlockSize(block);
+    HeapDesc.Properties = CD3DX12_HEAP_PROPERTIES(P.HeapType);
+
+    switch (P.Category)
+    {
+    case GpuResourceCategory::Buffer:
+        HeapDesc.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+        HeapDesc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+        break;
+    case GpuResourceCategory::Texture:
+        HeapDesc.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+        HeapDesc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES;
+        break;
+    default:
+        HeapDesc.Alignment = D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT;
+        HeapDesc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES;
+        break;
+    }
+
+    if (P.Heaps.size() <= block)
+        P.Heaps.resize(block + 1);
+
+    return m_Device->CreateHeap(&HeapDesc, IID_PPV_ARGS(&P.Heaps[block]));
+}
+
+void GpuMemoryAllocator::FreePlacement(const Placement& placement)
+{
+    Pool& P = m_Pools[placement.Pool];
+
+    // Keep one empty heap per pool so that a resource freed and made again does not
+    // recreate the heap every time.
+    if (P.Blocks.Free(placement.Allocation))
+        P.Blocks.ReleaseEmptyBlocks(1, [&P](std::uint32_t block) { P.Heaps[block] = nullptr; });
+}
+
+void GpuMemoryAllocator::Release(ID3D12Resource* resource)
+{
+    std::lock_guard<std::mutex> Guard(m_Lock);
+
+    auto Found = m_Placements.find(resource);
+    if (Found == m_Placements.end())
+        return;
+
+    m_CommittedBytes -= Found->second.CommittedBytes;
+    if (Found->second.bSmall)
+        --m_SmallTextureCount;
+
+    FreePlacement(Found->second);
+    m_Placements.erase(Found);
+}
+
+UINT GpuMemoryAllocator::PlanDefragmentation(UINT64 maxBytes, std::vector<GpuDefragMove>& moves)
+{
+    std::lock_guard<std::mutex> Guard(m_Lock);
+
+    const UINT Before = (UINT)moves.size();
+    UINT64 Remaining = maxBytes;
+
+    std::vector<PoolMove> PoolMoves;
+    for (UINT PoolIndex = 0; PoolIndex < _countof(m_Pools) && Remaining > 0; ++PoolIndex)
+    {
+        Pool& P = m_Pools[PoolIndex];
+
+        const UINT64 Alignment = P.Category == GpuResourceCategory::RenderTarget ?
+            D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT : D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+
+        PoolMoves.clear();
+        P.Blocks.PlanDefragmentation(Remaining, Alignment, PoolMoves);
+
+        for (const PoolMove& Move : PoolMoves)
+        {
+            // Find the resource in the source range.
+            ID3D12Resource* Source = nullptr;
+            const Placement* SourcePlacement = nullptr;
+            for (const auto& Entry : m_Placements)
+            {
+                if (Entry.second.Pool == PoolIndex && Entry.second.Allocation.Block == Move.From.Block && Entry.second.Allocation.Handle == Move.From.Handle)
+                {
+                    Source = Entry.first;
+                    SourcePlacement = &Entry.second;
+                    break;
+                }
+            }
+
+            const D3D12_RESOURCE_STATES State = P.HeapType == D3D12_HEAP_TYPE_DEFAULT ? D3D12_RESOURCE_STATE_COPY_DEST : D3D12_RESOURCE_STATE_GENERIC_READ;
+
+            GpuDefragMove NewMove;
+            NewMove.Source = Source;
+
+            HRESULT hr = SourcePlacement != nullptr ? EnsureHeap(PoolIndex, Move.To.Block) : E_FAIL;
+            if (SUCCEEDED(hr))
+            {
+                hr = m_Device->CreatePlacedResource(P.Heaps[Move.To.Block].Get(), Move.To.Offset, &SourcePlacement->Desc, State,
+                    SourcePlacement->bClearValue ? &SourcePlacement->ClearValue : nullptr, IID_PPV_ARGS(&NewMove.Destination));
+            }
+
+            if (FAILED(hr))
+            {
+                P.Blocks.Free(Move.To);
+                continue;
+            }
+
+            Placement Destination = *SourcePlacement;
+            Destination.Allocation = Move.To;
+            AddPlacement(NewMove.Destination.Get(), Destination);
+
+            moves.push_back(NewMove);
+            Remaining -= (std::min)(Remaining, Move.From.Size);
+        }
+    }
+
+    return (UINT)moves.size() - Before;
+}
+
+GpuMemoryStats GpuMemoryAllocator::GetStats()const
+{
+    std::lock_guard<std::mutex> Guard(m_Lock);
+
+    GpuMemoryStats Stats;
+    for (const Pool& P : m_Pools)
+    {
+        Stats.Pools.Add(P.Blocks.GetStats());
+    }
+
+    Stats.ResourceCount = (UINT)m_Placements.size();
+    Stats.CommittedBytes = m_CommittedBytes;
+    Stats.SmallTextureCount = m_SmallTextureCount;
+    return Stats;
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include "d3dUtil.h"
+#include "HeapBlockPool.h"
+
+#include <mutex>
+#include <unordered_map>
+
+// Heap tier 1 hardware keeps buffers, plain textures and render target / depth textures
+// in separate heaps, so every heap type has a pool per category.
+enum class GpuResourceCategory
+{
+    Buffer,
+    Texture,
+    RenderTarget,
+    Count
+};
+
+struct GpuMemoryStats
+{
+    HeapPoolStats Pools;
+
+    UINT ResourceCount = 0;
+
+    // Bytes the same resources would reserve as committed resources, each in an implicit
+    // heap of its own rounded to 64KB.
+    UINT64 CommittedBytes = 0;
+
+    UINT SmallTextureCount = 0;
+};
+
+// A resource created in a fuller heap by PlanDefragmentation, in COPY_DEST (GENERIC_READ
+// on upload heaps).  Copy Source into Destination, point every view at Destination, and
+// call Release(Source) once the GPU is done with it.
+struct GpuDefragMove
+{
+    ID3D12Resource* Source = nullptr;
+    Microsoft::WRL::ComPtr<ID3D12Resource> Destination;
+};
+
+// Places resources in large ID3D12Heap blocks instead of creating each one committed.
+// Every (heap type, category) pair has a HeapBlockPool; sizes and alignments come from
+// GetResourceAllocationInfo, so 4KB small textures, 64KB resources and 4MB MSAA targets
+// share the same blocks.  Safe to call from several threads.
+class GpuMemoryAllocator
+{
+public:
+    GpuMemoryAllocator() = default;
+
+    GpuMemoryAllocator(const GpuMemoryAllocator&) = delete;
+    GpuMemoryAllocator& operator=(const GpuMemoryAllocator&) = delete;
+
+    void Initialize(ID3D12Device* device, UINT64 blockSize = 64 * 1024 * 1024);
+
+    // Same arguments as CreateCommittedResource without the heap flags.
+    HRESULT CreateResource(
+        D3D12_HEAP_TYPE heapType,
+        const D3D12_RESOURCE_DESC& desc,
+        D3D12_RESOURCE_STATES initialState,
+        const D3D12_CLEAR_VALUE* clearValue,
+        REFIID riid,
+        void** resource);
+
+    // Returns the resource's range to its heap; call with the ID3D12Resource pointer while
+    // the resource is still alive and the GPU no longer uses it.  Resources not made here
+    // are ignored.
+    void Release(ID3D12Resource* resource);
+
+    // Creates destinations for up to maxBytes of resources in the least used heaps; see
+    // GpuDefragMove.
+    UINT PlanDefragmentation(UINT64 maxBytes, std::vector<GpuDefragMove>& moves);
+
+    GpuMemoryStats GetStats()const;
+
+private:
+    struct Pool
+    {
+        D3D12_HEAP_TYPE HeapType = D3D12_HEAP_TYPE_DEFAULT;
+        GpuResourceCategory Category = GpuResourceCategory::Buffer;
+
+        HeapBlockPool Blocks;
+
+        // One heap per block, null for released blocks.
+        std::vector<Microsoft::WRL::ComPtr<ID3D12Heap>> Heaps;
+    };
+
+    struct Placement
+    {
+        UINT Pool = 0;
+        PoolAllocation Allocation;
+
+        // This resource's share of GpuMemoryStats, taken back out by Release.
+        UINT64 CommittedBytes = 0;
+        bool bSmall = false;
+
+        // Kept to recreate the resource elsewhere when defragmenting.
+        D3D12_RESOURCE_DESC Desc = {};
+        bool bClearValue = false;
+        D3D12_CLEAR_VALUE ClearValue = {};
+    };
+
+    static const UINT HeapTypeCount = 3;
+
+    static UINT GetPoolIndex(D3D12_HEAP_TYPE heapType, GpuResourceCategory category);
+    static GpuResourceCategory GetCategory(const D3D12_RESOURCE_DESC& desc);
+
+    HRESULT PlaceResource(
+        UINT pool,
+        const D3D12_RESOURCE_DESC& desc,
+        UINT64 size,
+        UINT64 alignment,
+        UINT64 committedBytes,
+        bool bSmall,
+        D3D12_RESOURCE_STATES initialState,
+        const D3D12_CLEAR_VALUE* clearValue,
+        REFIID riid,
+        void** resource);
+
+    void AddPlacement(ID3D12Resource* resource, const Placement& placement);
+
+    // Creates the block's heap if it has none.
+    HRESULT EnsureHeap(UINT pool, UINT block);
+    void FreePlacement(const Placement& placement);
+
+private:
+    Microsoft::WRL::ComPtr<ID3D12Device> m_Device;
+    UINT64 m_BlockSize = 0;
+
+    Pool m_Pools[HeapTypeCount * (UINT)GpuResourceCategory::Count];
+
+    std::unordered_map<ID3D12Resource*, Placement> m_Placements;
+    UINT64 m_CommittedBytes = 0;
+    UINT m_SmallTextureCount = 0;
+
+    mutable std::mutex m_Lock;
+};
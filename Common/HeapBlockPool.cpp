@@ -0,0 +1,151 @@
+#include "HeapBlockPool.h"
+
+void HeapBlockPool::Reset(std::uint64_t blockSize, std::uint64_t granularity)
+{
+    m_BlockSize = blockSize;
+    m_Granularity = granularity;
+    m_Blocks.clear();
+    m_BlocksCreated = 0;
+    m_BlocksReleased = 0;
+}
+
+std::uint32_t HeapBlockPool::AddBlock(std::uint64_t size)
+{
+    std::unique_ptr<TLSFAllocator> Block = std::make_unique<TLSFAllocator>();
+    Block->Reset(size, m_Granularity);
+    ++m_BlocksCreated;
+
+    for (std::uint32_t i = 0; i < (std::uint32_t)m_Blocks.size(); ++i)
+    {
+        if (m_Blocks[i] == nullptr)
+        {
+            m_Blocks[i] = std::move(Block);
+            return i;
+        }
+    }
+
+    m_Blocks.push_back(std::move(Block));
+    return (std::uint32_t)m_Blocks.size() - 1;
+}
+
+bool HeapBlockPool::AllocateIn(std::uint32_t block, std::uint64_t size, std::uint64_t alignment, PoolAllocation& allocation)
+{
+    TLSFAllocator& Block = *m_Blocks[block];
+
+    const std::uint32_t Handle = Block.Allocate(size, alignment);
+    if (Handle == TLSFAllocator::InvalidHandle)
+        return false;
+
+    allocation.Block = block;
+    allocation.Handle = Handle;
+    allocation.Offset = Block.GetOffset(Handle);
+    allocation.Size = Block.GetAllocationSize(Handle);
+    return true;
+}
+
+bool HeapBlockPool::Allocate(std::uint64_t size, std::uint64_t alignment, PoolAllocation& allocation, bool& bNewBlock)
+{
+    bNewBlock = false;
+
+    for (std::uint32_t i = 0; i < (std::uint32_t)m_Blocks.size(); ++i)
+    {
+        if (m_Blocks[i] != nullptr && AllocateIn(i, size, alignment, allocation))
+            return true;
+    }
+
+    // Heaps are aligned to their largest placement alignment, so offset 0 suits any.
+    const std::uint64_t Rounded = (size + m_Granularity - 1) & ~(m_Granularity - 1);
+    const std::uint32_t Block = AddBlock((std::max)(m_BlockSize, Rounded));
+    bNewBlock = true;
+
+    return AllocateIn(Block, size, alignment, allocation);
+}
+
+bool HeapBlockPool::Free(const PoolAllocation& allocation)
+{
+    TLSFAllocator& Block = *m_Blocks[allocation.Block];
+    Block.Free(allocation.Handle);
+    return Block.IsEmpty();
+}
+
+std::uint32_t HeapBlockPool::PlanDefragmentation(std::uint64_t maxBytes, std::uint64_t alignment, std::vector<PoolMove>& moves)
+{
+    // Blocks in use, least used first.  Sources are taken from the front, destinations
+    // only from behind them, so nothing moves into a block that is being emptied.
+    std::vector<std::uint32_t> Order;
+    for (std::uint32_t i = 0; i < (std::uint32_t)m_Blocks.size(); ++i)
+    {
+        if (m_Blocks[i] != nullptr && !m_Blocks[i]->IsEmpty())
+            Order.push_back(i);
+    }
+    std::sort(Order.begin(), Order.end(), [this](std::uint32_t a, std::uint32_t b)
+    {
+        return m_Blocks[a]->GetUsedBytes() < m_Blocks[b]->GetUsedBytes();
+    });
+
+    const std::uint32_t Before = (std::uint32_t)moves.size();
+    std::uint64_t Moved = 0;
+
+    for (size_t Source = 0; Source + 1 < Order.size() && Moved < maxBytes; ++Source)
+    {
+        struct Entry
+        {
+            std::uint32_t Handle;
+            std::uint64_t Offset;
+            std::uint64_t Size;
+        };
+        std::vector<Entry> Entries;
+        m_Blocks[Order[Source]]->ForEachAllocation([&Entries](std::uint32_t handle, std::uint64_t offset, std::uint64_t size)
+        {
+            Entries.push_back({ handle, offset, size });
+        });
+
+        for (const Entry& E : Entries)
+        {
+            if (Moved + E.Size > maxBytes)
+                break;
+
+            PoolMove Move;
+            Move.From.Block = Order[Source];
+            Move.From.Handle = E.Handle;
+            Move.From.Offset = E.Offset;
+            Move.From.Size = E.Size;
+
+            // Fullest destination first, so free space gathers in as few blocks as possible.
+            bool bPlaced = false;
+            for (size_t Destination = Order.size(); Destination-- > Source + 1 && !bPlaced;)
+            {
+                bPlaced = AllocateIn(Order[Destination], E.Size, alignment, Move.To);
+            }
+
+            if (!bPlaced)
+                continue;
+
+            moves.push_back(Move);
+            Moved += E.Size;
+        }
+    }
+
+    return (std::uint32_t)moves.size() - Before;
+}
+
+HeapPoolStats HeapBlockPool::GetStats()const
+{
+    HeapPoolStats Stats;
+    for (const std::unique_ptr<TLSFAllocator>& Block : m_Blocks)
+    {
+        if (Block == nullptr)
+            continue;
+
+        ++Stats.BlockCount;
+        Stats.BlockBytes += Block->GetSize();
+        Stats.UsedBytes += Block->GetUsedBytes();
+        Stats.AllocationCount += Block->GetAllocationCount();
+        Stats.FreeRangeCount += Block->GetFreeBlockCount();
+        Stats.LargestFreeRange = (std::max)(Stats.LargestFreeRange, Block->GetLargestFreeBlock());
+    }
+
+    Stats.BlocksCreated = m_BlocksCreated;
+    Stats.BlocksReleased = m_BlocksReleased;
+    return Stats;
+}
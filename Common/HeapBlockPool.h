@@ -0,0 +1,129 @@
+#pragma once
+
+#include "TLSFAllocator.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Placement of one resource: a block of the pool and the range inside it.
+struct PoolAllocation
+{
+    std::uint32_t Block = 0xffffffffu;
+    std::uint32_t Handle = TLSFAllocator::InvalidHandle;
+    std::uint64_t Offset = 0;
+    std::uint64_t Size = 0;
+
+    bool IsValid()const { return Block != 0xffffffffu; }
+};
+
+struct HeapPoolStats
+{
+    std::uint32_t BlockCount = 0;
+    std::uint64_t BlockBytes = 0;
+    std::uint64_t UsedBytes = 0;
+    std::uint32_t AllocationCount = 0;
+
+    std::uint32_t FreeRangeCount = 0;
+    std::uint64_t LargestFreeRange = 0;
+
+    std::uint32_t BlocksCreated = 0;
+    std::uint32_t BlocksReleased = 0;
+
+    void Add(const HeapPoolStats& other)
+    {
+        BlockCount += other.BlockCount;
+        BlockBytes += other.BlockBytes;
+        UsedBytes += other.UsedBytes;
+        AllocationCount += other.AllocationCount;
+        FreeRangeCount += other.FreeRangeCount;
+        LargestFreeRange = (std::max)(LargestFreeRange, other.LargestFreeRange);
+        BlocksCreated += other.BlocksCreated;
+        BlocksReleased += other.BlocksReleased;
+    }
+};
+
+// Moving an allocation to a fuller block so that its own block can empty out.  To is
+// already reserved; once the data is copied and the GPU is done with From, free From.
+struct PoolMove
+{
+    PoolAllocation From;
+    PoolAllocation To;
+};
+
+// A growing set of equally sized blocks (one GPU heap each) with a TLSFAllocator per
+// block.  The pool only does the bookkeeping: when Allocate reports a new block the
+// caller creates the heap behind it, and ReleaseEmptyBlocks tells it which heaps to
+// destroy.  Block indices stay valid until the block is released and are then reused.
+// Resources bigger than the block size get a block of their own size.  Has no graphics
+// API dependency.
+class HeapBlockPool
+{
+public:
+    void Reset(std::uint64_t blockSize, std::uint64_t granularity);
+
+    // bNewBlock is set when the allocation opened a block the caller has not seen yet.
+    bool Allocate(std::uint64_t size, std::uint64_t alignment, PoolAllocation& allocation, bool& bNewBlock);
+
+    // Returns true if the block is now empty.
+    bool Free(const PoolAllocation& allocation);
+
+    // Releases empty blocks beyond keepEmpty, calling release(block) for each, and
+    // returns how many were released.
+    template<typename F>
+    std::uint32_t ReleaseEmptyBlocks(std::uint32_t keepEmpty, F&& release);
+
+    // Defragmentation hook.  Picks the least used blocks and reserves room in fuller ones
+    // for their allocations, up to maxBytes, so that after the moves the sources can be
+    // released.  Destinations are aligned to alignment, the largest placement alignment
+    // any allocation of the pool needs.  Returns the number of moves added.
+    std::uint32_t PlanDefragmentation(std::uint64_t maxBytes, std::uint64_t alignment, std::vector<PoolMove>& moves);
+
+    std::uint32_t GetBlockCount()const { return (std::uint32_t)m_Blocks.size(); }
+    bool IsBlockLive(std::uint32_t block)const { return m_Blocks[block] != nullptr; }
+    std::uint64_t GetBlockSize(std::uint32_t block)const { return m_Blocks[block]->GetSize(); }
+    const TLSFAllocator& GetBlock(std::uint32_t block)const { return *m_Blocks[block]; }
+
+    HeapPoolStats GetStats()const;
+
+private:
+    std::uint32_t AddBlock(std::uint64_t size);
+    bool AllocateIn(std::uint32_t block, std::uint64_t size, std::uint64_t alignment, PoolAllocation& allocation);
+
+private:
+    std::uint64_t m_BlockSize = 0;
+    std::uint64_t m_Granularity = 1;
+
+    // Null for released blocks.
+    std::vector<std::unique_ptr<TLSFAllocator>> m_Blocks;
+
+    std::uint32_t m_BlocksCreated = 0;
+    std::uint32_t m_BlocksReleased = 0;
+};
+
+template<typename F>
+std::uint32_t HeapBlockPool::ReleaseEmptyBlocks(std::uint32_t keepEmpty, F&& release)
+{
+    std::uint32_t Kept = 0;
+    std::uint32_t Released = 0;
+    for (std::uint32_t i = 0; i < (std::uint32_t)m_Blocks.size(); ++i)
+    {
+        if (m_Blocks[i] == nullptr || !m_Blocks[i]->IsEmpty())
+            continue;
+
+        // Only standard sized blocks are worth keeping around.
+        if (Kept < keepEmpty && m_Blocks[i]->GetSize() == m_BlockSize)
+        {
+            ++Kept;
+            continue;
+        }
+
+        release(i);
+        m_Blocks[i] = nullptr;
+        ++Released;
+    }
+
+    m_BlocksReleased += Released;
+    return Released;
+}
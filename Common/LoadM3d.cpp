@@ -10,6 +10,15 @@ bool M3DLoader::LoadM3d(const std::string& filename,
 {
 	std::ifstream fin(filename);
 
+	return LoadM3d(fin, vertices, indices, subsets, mats);
+}
+
+bool M3DLoader::LoadM3d(std::istream& fin, 
+						std::vector<Vertex>& vertices,
+						std::vector<USHORT>& indices,
+						std::vector<Subset>& subsets,
+						std::vector<M3dMaterial>& mats)
+{
 	UINT numMaterials = 0;
 	UINT numVertices  = 0;
 	UINT numTriangles = 0;
@@ -46,6 +55,16 @@ bool M3DLoader::LoadM3d(const std::string& filename,
 {
     std::ifstream fin(filename);
 
+	return LoadM3d(fin, vertices, indices, subsets, mats, skinInfo);
+}
+
+bool M3DLoader::LoadM3d(std::istream& fin, 
+						std::vector<SkinnedVertex>& vertices,
+						std::vector<USHORT>& indices,
+						std::vector<Subset>& subsets,
+						std::vector<M3dMaterial>& mats,
+						SkinnedData& skinInfo)
+{
 	UINT numMaterials = 0;
 	UINT numVertices  = 0;
 	UINT numTriangles = 0;
@@ -82,7 +101,7 @@ bool M3DLoader::LoadM3d(const std::string& filename,
     return false;
 }
 
-void M3DLoader::ReadMaterials(std::ifstream& fin, UINT numMaterials, std::vector<M3dMaterial>& mats)
+void M3DLoader::ReadMaterials(std::istream& fin, UINT numMaterials, std::vector<M3dMaterial>& mats)
 {
 	 std::string ignore;
      mats.resize(numMaterials);
@@ -104,7 +123,7 @@ void M3DLoader::ReadMaterials(std::ifstream& fin, UINT numMaterials, std::vector
 		}
 }
 
-void M3DLoader::ReadSubsetTable(std::ifstream& fin, UINT numSubsets, std::vector<Subset>& subsets)
+void M3DLoader::ReadSubsetTable(std::istream& fin, UINT numSubsets, std::vector<Subset>& subsets)
 {
     std::string ignore;
 	subsets.resize(numSubsets);
@@ -120,7 +139,7 @@ void M3DLoader::ReadSubsetTable(std::ifstream& fin, UINT numSubsets, std::vector
     }
 }
 
-void M3DLoader::ReadVertices(std::ifstream& fin, UINT numVertices, std::vector<Vertex>& vertices)
+void M3DLoader::ReadVertices(std::istream& fin, UINT numVertices, std::vector<Vertex>& vertices)
 {
 	std::string ignore;
     vertices.resize(numVertices);
@@ -135,7 +154,7 @@ void M3DLoader::ReadVertices(std::ifstream& fin, UINT numVertices, std::vector<V
     }
 }
 
-void M3DLoader::ReadSkinnedVertices(std::ifstream& fin, UINT numVertices, std::vector<SkinnedVertex>& vertices)
+void M3DLoader::ReadSkinnedVertices(std::istream& fin, UINT numVertices, std::vector<SkinnedVertex>& vertices)
 {
 	std::string ignore;
     vertices.resize(numVertices);
@@ -164,7 +183,7 @@ void M3DLoader::ReadSkinnedVertices(std::ifstream& fin, UINT numVertices, std::v
     }
 }
 
-void M3DLoader::ReadTriangles(std::ifstream& fin, UINT numTriangles, std::vector<USHORT>& indices)
+void M3DLoader::ReadTriangles(std::istream& fin, UINT numTriangles, std::vector<USHORT>& indices)
 {
 	std::string ignore;
     indices.resize(numTriangles*3);
@@ -176,7 +195,7 @@ void M3DLoader::ReadTriangles(std::ifstream& fin, UINT numTriangles, std::vector
     }
 }
  
-void M3DLoader::ReadBoneOffsets(std::ifstream& fin, UINT numBones, std::vector<XMFLOAT4X4>& boneOffsets)
+void M3DLoader::ReadBoneOffsets(std::istream& fin, UINT numBones, std::vector<XMFLOAT4X4>& boneOffsets)
 {
 	std::string ignore;
     boneOffsets.resize(numBones);
@@ -192,7 +211,7 @@ void M3DLoader::ReadBoneOffsets(std::ifstream& fin, UINT numBones, std::vector<X
     }
 }
 
-void M3DLoader::ReadBoneHierarchy(std::ifstream& fin, UINT numBones, std::vector<int>& boneIndexToParentIndex)
+void M3DLoader::ReadBoneHierarchy(std::istream& fin, UINT numBones, std::vector<int>& boneIndexToParentIndex)
 {
 	std::string ignore;
     boneIndexToParentIndex.resize(numBones);
@@ -204,7 +223,7 @@ void M3DLoader::ReadBoneHierarchy(std::ifstream& fin, UINT numBones, std::vector
 	}
 }
 
-void M3DLoader::ReadAnimationClips(std::ifstream& fin, UINT numBones, UINT numAnimationClips, 
+void M3DLoader::ReadAnimationClips(std::istream& fin, UINT numBones, UINT numAnimationClips, 
 								   std::unordered_map<std::string, AnimationClip>& animations)
 {
 	std::string ignore;
@@ -228,7 +247,7 @@ void M3DLoader::ReadAnimationClips(std::ifstream& fin, UINT numBones, UINT numAn
     }
 }
 
-void M3DLoader::ReadBoneKeyframes(std::ifstream& fin, UINT numBones, BoneAnimation& boneAnimation)
+void M3DLoader::ReadBoneKeyframes(std::istream& fin, UINT numBones, BoneAnimation& boneAnimation)
 {
 	std::string ignore;
     UINT numKeyframes = 0;
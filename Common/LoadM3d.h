@@ -61,16 +61,29 @@ public:
 		std::vector<M3dMaterial>& mats,
 		SkinnedData& skinInfo);
 
+	// Same as above, parsing from an already loaded stream (e.g. a buffer read by AsyncFileQueue).
+	bool LoadM3d(std::istream& fin, 
+		std::vector<Vertex>& vertices,
+		std::vector<USHORT>& indices,
+		std::vector<Subset>& subsets,
+		std::vector<M3dMaterial>& mats);
+	bool LoadM3d(std::istream& fin, 
+		std::vector<SkinnedVertex>& vertices,
+		std::vector<USHORT>& indices,
+		std::vector<Subset>& subsets,
+		std::vector<M3dMaterial>& mats,
+		SkinnedData& skinInfo);
+
 private:
-	void ReadMaterials(std::ifstream& fin, UINT numMaterials, std::vector<M3dMaterial>& mats);
-	void ReadSubsetTable(std::ifstream& fin, UINT numSubsets, std::vector<Subset>& subsets);
-	void ReadVertices(std::ifstream& fin, UINT numVertices, std::vector<Vertex>& vertices);
-	void ReadSkinnedVertices(std::ifstream& fin, UINT numVertices, std::vector<SkinnedVertex>& vertices);
-	void ReadTriangles(std::ifstream& fin, UINT numTriangles, std::vector<USHORT>& indices);
-	void ReadBoneOffsets(std::ifstream& fin, UINT numBones, std::vector<DirectX::XMFLOAT4X4>& boneOffsets);
-	void ReadBoneHierarchy(std::ifstream& fin, UINT numBones, std::vector<int>& boneIndexToParentIndex);
-	void ReadAnimationClips(std::ifstream& fin, UINT numBones, UINT numAnimationClips, std::unordered_map<std::string, AnimationClip>& animations);
-	void ReadBoneKeyframes(std::ifstream& fin, UINT numBones, BoneAnimation& boneAnimation);
+	void ReadMaterials(std::istream& fin, UINT numMaterials, std::vector<M3dMaterial>& mats);
+	void ReadSubsetTable(std::istream& fin, UINT numSubsets, std::vector<Subset>& subsets);
+	void ReadVertices(std::istream& fin, UINT numVertices, std::vector<Vertex>& vertices);
+	void ReadSkinnedVertices(std::istream& fin, UINT numVertices, std::vector<SkinnedVertex>& vertices);
+	void ReadTriangles(std::istream& fin, UINT numTriangles, std::vector<USHORT>& indices);
+	void ReadBoneOffsets(std::istream& fin, UINT numBones, std::vector<DirectX::XMFLOAT4X4>& boneOffsets);
+	void ReadBoneHierarchy(std::istream& fin, UINT numBones, std::vector<int>& boneIndexToParentIndex);
+	void ReadAnimationClips(std::istream& fin, UINT numBones, UINT numAnimationClips, std::unordered_map<std::string, AnimationClip>& animations);
+	void ReadBoneKeyframes(std::istream& fin, UINT numBones, BoneAnimation& boneAnimation);
 };
 
 
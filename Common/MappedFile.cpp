@@ -0,0 +1,167 @@
+#include "MappedFile.h"
+
+#include <utility>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+{
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other)
+    {
+        Close();
+
+        std::swap(m_Data, other.m_Data);
+        std::swap(m_Size, other.m_Size);
+        std::swap(m_File, other.m_File);
+#if defined(_WIN32)
+        std::swap(m_Mapping, other.m_Mapping);
+#endif
+    }
+
+    return *this;
+}
+
+#if defined(_WIN32)
+
+bool MappedFile::Open(const std::wstring& fileName)
+{
+    Close();
+
+    HANDLE File = CreateFileW(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (File == INVALID_HANDLE_VALUE)
+        return false;
+
+    m_File = File;
+
+    LARGE_INTEGER FileSize = {};
+    if (!GetFileSizeEx(File, &FileSize) || FileSize.QuadPart == 0 ||
+        (unsigned long long)FileSize.QuadPart > (size_t)-1)
+    {
+        Close();
+        SetLastError(ERROR_INVALID_DATA);
+        return false;
+    }
+
+    m_Mapping = CreateFileMappingW(File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!m_Mapping)
+    {
+        DWORD Error = GetLastError();
+        Close();
+        SetLastError(Error);
+        return false;
+    }
+
+    m_Data = static_cast<const std::uint8_t*>(MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!m_Data)
+    {
+        DWORD Error = GetLastError();
+        Close();
+        SetLastError(Error);
+        return false;
+    }
+
+    m_Size = (size_t)FileSize.QuadPart;
+    return true;
+}
+
+bool MappedFile::Open(const std::string& fileName)
+{
+    int Length = MultiByteToWideChar(CP_ACP, 0, fileName.c_str(), -1, nullptr, 0);
+    if (Length <= 0)
+        return false;
+
+    std::wstring WideName(Length - 1, L'\0');
+    MultiByteToWideChar(CP_ACP, 0, fileName.c_str(), -1, &WideName[0], Length);
+    return Open(WideName);
+}
+
+void MappedFile::Close()
+{
+    if (m_Data)
+        UnmapViewOfFile(m_Data);
+    if (m_Mapping)
+        CloseHandle(m_Mapping);
+    if (m_File)
+        CloseHandle(m_File);
+
+    m_Data = nullptr;
+    m_Size = 0;
+    m_Mapping = nullptr;
+    m_File = nullptr;
+}
+
+#else
+
+bool MappedFile::Open(const std::string& fileName)
+{
+    Close();
+
+    m_File = open(fileName.c_str(), O_RDONLY | O_CLOEXEC);
+    if (m_File < 0)
+        return false;
+
+    struct stat Info;
+    if (fstat(m_File, &Info) != 0 || Info.st_size <= 0)
+    {
+        Close();
+        return false;
+    }
+
+    void* Data = mmap(nullptr, (size_t)Info.st_size, PROT_READ, MAP_PRIVATE, m_File, 0);
+    if (Data == MAP_FAILED)
+    {
+        Close();
+        return false;
+    }
+
+    // Textures are consumed front to back exactly once.
+    madvise(Data, (size_t)Info.st_size, MADV_SEQUENTIAL);
+
+    m_Data = static_cast<const std::uint8_t*>(Data);
+    m_Size = (size_t)Info.st_size;
+    return true;
+}
+
+bool MappedFile::Open(const std::wstring& fileName)
+{
+    std::string NarrowName(fileName.size() * 4 + 1, '\0');
+    size_t Length = wcstombs(&NarrowName[0], fileName.c_str(), NarrowName.size());
+    if (Length == (size_t)-1)
+        return false;
+
+    NarrowName.resize(Length);
+    return Open(NarrowName);
+}
+
+void MappedFile::Close()
+{
+    if (m_Data)
+        munmap(const_cast<std::uint8_t*>(m_Data), m_Size);
+    if (m_File >= 0)
+        close(m_File);
+
+    m_Data = nullptr;
+    m_Size = 0;
+    m_File = -1;
+}
+
+#endif
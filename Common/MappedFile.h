@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Read-only memory mapping of a whole file (CreateFileMapping on Windows, mmap elsewhere).
+// Lets loaders parse file contents in place instead of reading them into a heap copy.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    // Returns false if the file cannot be opened or mapped.  On Windows GetLastError()
+    // holds the reason, elsewhere errno.
+    bool Open(const std::wstring& fileName);
+    bool Open(const std::string& fileName);
+    void Close();
+
+    bool IsOpen()const { return m_Data != nullptr; }
+    const std::uint8_t* GetData()const { return m_Data; }
+    std::size_t GetSize()const { return m_Size; }
+
+private:
+    const std::uint8_t* m_Data = nullptr;
+    std::size_t m_Size = 0;
+
+#if defined(_WIN32)
+    void* m_File = nullptr;
+    void* m_Mapping = nullptr;
+#else
+    int m_File = -1;
+#endif
+};
@@ -0,0 +1,119 @@
+#include "PipelineLibrary.h"
+
+#include <fstream>
+
+using Microsoft::WRL::ComPtr;
+
+void PipelineLibrary::Initialize(ID3D12Device* device, const std::string& fileName)
+{
+    m_Device = device;
+    m_FileName = fileName;
+    m_Library.Reset();
+    m_Data.clear();
+    m_Pipelines.clear();
+    m_bStale = false;
+    m_Stats = PipelineLibraryStats();
+
+    // Pipeline libraries need ID3D12Device1 (Windows 10 Creators Update).
+    if (fileName.empty() || FAILED(device->QueryInterface(IID_PPV_ARGS(&m_Device1))))
+        return;
+
+    std::ifstream File(fileName, std::ios::binary | std::ios::ate);
+    if (File)
+    {
+        m_Data.resize((size_t)File.tellg());
+        File.seekg(0);
+        File.read(m_Data.data(), (std::streamsize)m_Data.size());
+        if (!File)
+            m_Data.clear();
+    }
+
+    // A library written by another driver version or for another adapter is rejected
+    // (D3D12_ERROR_DRIVER_VERSION_MISMATCH, D3D12_ERROR_ADAPTER_NOT_FOUND).
+    if (!m_Data.empty() && SUCCEEDED(CreateLibrary(m_Data.data(), m_Data.size())))
+    {
+        m_Stats.bLoadedFromFile = true;
+        return;
+    }
+
+    m_Data.clear();
+    if (FAILED(CreateLibrary(nullptr, 0)))
+        m_Library.Reset();
+}
+
+HRESULT PipelineLibrary::CreateLibrary(const void* data, SIZE_T size)
+{
+    return m_Device1->CreatePipelineLibrary(data, size, IID_PPV_ARGS(&m_Library));
+}
+
+ComPtr<ID3D12PipelineState> PipelineLibrary::CreateGraphicsPipelineState(
+    const std::wstring& name,
+    const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc)
+{
+    ComPtr<ID3D12PipelineState> PipelineState;
+
+    // The library is free-threaded, so only the bookkeeping below takes the lock.
+    bool bLoaded = m_Library != nullptr && SUCCEEDED(m_Library->LoadGraphicsPipeline(name.c_str(), &desc, IID_PPV_ARGS(&PipelineState)));
+    bool bStored = true;
+    if (!bLoaded)
+    {
+        ThrowIfFailed(m_Device->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(&PipelineState)));
+
+        // Storing fails when a pipeline of the same name was stored with another
+        // description; names cannot be replaced, so Save builds a new library instead.
+        if (m_Library != nullptr)
+            bStored = SUCCEEDED(m_Library->StorePipeline(name.c_str(), PipelineState.Get()));
+    }
+
+    std::lock_guard<std::mutex> Lock(m_Mutex);
+
+    if (bLoaded)
+        ++m_Stats.Loaded;
+    else
+        ++m_Stats.Created;
+
+    m_bStale = m_bStale || !bStored;
+    m_Pipelines.push_back({ name, PipelineState });
+
+    return PipelineState;
+}
+
+bool PipelineLibrary::Save()
+{
+    std::lock_guard<std::mutex> Lock(m_Mutex);
+
+    if (m_Library == nullptr || m_Stats.Created == 0)
+        return true;
+
+    if (m_bStale)
+    {
+        ComPtr<ID3D12PipelineLibrary> Library;
+        if (FAILED(m_Device1->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(&Library))))
+            return false;
+
+        for (const auto& Pipeline : m_Pipelines)
+        {
+            if (FAILED(Library->StorePipeline(Pipeline.first.c_str(), Pipeline.second.Get())))
+                return false;
+        }
+
+        // Release the old library before the memory it was loaded from.
+        m_Library = Library;
+        m_Data.clear();
+        m_bStale = false;
+    }
+
+    std::vector<char> Data(m_Library->GetSerializedSize());
+    if (FAILED(m_Library->Serialize(Data.data(), Data.size())))
+        return false;
+
+    std::ofstream File(m_FileName, std::ios::binary | std::ios::trunc);
+    File.write(Data.data(), (std::streamsize)Data.size());
+    return (bool)File;
+}
+
+PipelineLibraryStats PipelineLibrary::GetStats()
+{
+    std::lock_guard<std::mutex> Lock(m_Mutex);
+    return m_Stats;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "d3dUtil.h"
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct PipelineLibraryStats
+{
+    // Pipeline states loaded from the serialized library, and created by the driver.
+    UINT Loaded = 0;
+    UINT Created = 0;
+
+    bool bLoadedFromFile = false;
+};
+
+// Creates graphics pipeline states through an ID3D12PipelineLibrary that is serialized to
+// a file, so a warm start loads compiled pipelines instead of having the driver compile
+// them again.  A stored pipeline is only returned when its whole description, shader
+// bytecode included, matches; a changed shader makes the driver compile it and Save
+// writes a new library.  Falls back to plain CreateGraphicsPipelineState when the file
+// name is empty or the device has no pipeline library support.  Safe to call from
+// several threads.
+class PipelineLibrary
+{
+public:
+    PipelineLibrary() = default;
+
+    PipelineLibrary(const PipelineLibrary&) = delete;
+    PipelineLibrary& operator=(const PipelineLibrary&) = delete;
+
+    // A missing, damaged or out of date file (another driver or adapter) starts an empty
+    // library.
+    void Initialize(ID3D12Device* device, const std::string& fileName);
+
+    bool IsEnabled()const { return m_Library != nullptr; }
+
+    // name identifies the pipeline in the library and must be unique.
+    Microsoft::WRL::ComPtr<ID3D12PipelineState> CreateGraphicsPipelineState(
+        const std::wstring& name,
+        const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc);
+
+    // Writes the library if any pipeline had to be created.  Returns false if writing failed.
+    bool Save();
+
+    PipelineLibraryStats GetStats();
+
+private:
+    HRESULT CreateLibrary(const void* data, SIZE_T size);
+
+private:
+    Microsoft::WRL::ComPtr<ID3D12Device> m_Device;
+    Microsoft::WRL::ComPtr<ID3D12Device1> m_Device1;
+    Microsoft::WRL::ComPtr<ID3D12PipelineLibrary> m_Library;
+    std::string m_FileName;
+
+    // The library reads serialized pipelines from this memory for as long as it lives.
+    std::vector<char> m_Data;
+
+    // Every pipeline handed out, for writing a new library when a stored one was stale.
+    std::vector<std::pair<std::wstring, Microsoft::WRL::ComPtr<ID3D12PipelineState>>> m_Pipelines;
+    bool m_bStale = false;
+
+    std::mutex m_Mutex;
+    PipelineLibraryStats m_Stats;
+};
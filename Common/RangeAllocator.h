@@ -0,0 +1,116 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// Free-list allocator over [0, capacity) in whatever unit the caller counts in (vertices,
+// indices, bytes).  Allocate takes the smallest free range that fits, Free merges the
+// range with its free neighbours, so a buffer whose contents come and go keeps its free
+// space in as few pieces as the live ranges allow.  Free ranges are kept sorted by offset
+// in a vector, which suits the few dozen ranges a mesh buffer sees.  Has no graphics API
+// dependency.
+class RangeAllocator
+{
+public:
+    static const std::uint32_t InvalidOffset = 0xffffffffu;
+
+    // Drops every allocation and makes the whole capacity one free range.
+    void Reset(std::uint32_t capacity)
+    {
+        m_Capacity = capacity;
+        m_FreeCount = capacity;
+        m_FreeRanges.clear();
+        if (capacity > 0)
+            m_FreeRanges.push_back({ 0, capacity });
+    }
+
+    // Returns the offset of count units, or InvalidOffset if no free range is big enough.
+    std::uint32_t Allocate(std::uint32_t count)
+    {
+        if (count == 0)
+            return InvalidOffset;
+
+        std::size_t Best = m_FreeRanges.size();
+        for (std::size_t i = 0; i < m_FreeRanges.size(); ++i)
+        {
+            if (m_FreeRanges[i].Count >= count && (Best == m_FreeRanges.size() || m_FreeRanges[i].Count < m_FreeRanges[Best].Count))
+            {
+                Best = i;
+                if (m_FreeRanges[i].Count == count)
+                    break;
+            }
+        }
+
+        if (Best == m_FreeRanges.size())
+            return InvalidOffset;
+
+        Range& Free = m_FreeRanges[Best];
+        const std::uint32_t Offset = Free.Offset;
+        Free.Offset += count;
+        Free.Count -= count;
+        if (Free.Count == 0)
+            m_FreeRanges.erase(m_FreeRanges.begin() + Best);
+
+        m_FreeCount -= count;
+        return Offset;
+    }
+
+    // Returns a range handed out by Allocate.
+    void Free(std::uint32_t offset, std::uint32_t count)
+    {
+        if (count == 0)
+            return;
+
+        auto Next = std::lower_bound(m_FreeRanges.begin(), m_FreeRanges.end(), offset,
+            [](const Range& range, std::uint32_t value) { return range.Offset < value; });
+
+        const bool bMergePrevious = Next != m_FreeRanges.begin() && (Next - 1)->Offset + (Next - 1)->Count == offset;
+        const bool bMergeNext = Next != m_FreeRanges.end() && offset + count == Next->Offset;
+
+        if (bMergePrevious && bMergeNext)
+        {
+            (Next - 1)->Count += count + Next->Count;
+            m_FreeRanges.erase(Next);
+        }
+        else if (bMergePrevious)
+            (Next - 1)->Count += count;
+        else if (bMergeNext)
+        {
+            Next->Offset = offset;
+            Next->Count += count;
+        }
+        else
+            m_FreeRanges.insert(Next, { offset, count });
+
+        m_FreeCount += count;
+    }
+
+    std::uint32_t GetCapacity()const { return m_Capacity; }
+    std::uint32_t GetUsedCount()const { return m_Capacity - m_FreeCount; }
+    std::uint32_t GetFreeCount()const { return m_FreeCount; }
+    std::uint32_t GetFreeRangeCount()const { return (std::uint32_t)m_FreeRanges.size(); }
+
+    std::uint32_t GetLargestFreeRange()const
+    {
+        std::uint32_t Largest = 0;
+        for (const Range& Free : m_FreeRanges)
+        {
+            Largest = (std::max)(Largest, Free.Count);
+        }
+        return Largest;
+    }
+
+private:
+    struct Range
+    {
+        std::uint32_t Offset;
+        std::uint32_t Count;
+    };
+
+    std::uint32_t m_Capacity = 0;
+    std::uint32_t m_FreeCount = 0;
+
+    // Sorted by offset, never adjacent to each other.
+    std::vector<Range> m_FreeRanges;
+};
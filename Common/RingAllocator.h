@@ -0,0 +1,141 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+
+struct RingAllocatorStats
+{
+    std::uint64_t Capacity = 0;
+    std::uint64_t UsedBytes = 0;
+    std::uint64_t PeakBytes = 0;
+
+    // Bytes handed out over the ring's lifetime, without alignment or wrap padding.
+    std::uint64_t AllocatedBytes = 0;
+    std::uint64_t AllocationCount = 0;
+
+    // Allocations refused because the GPU had not released enough of the ring yet.
+    std::uint64_t FailedCount = 0;
+    std::uint64_t WrapCount = 0;
+};
+
+// Fence-retired ring over [0, capacity) bytes of one upload buffer.  Allocations are
+// taken from the head in order; each one is retired with the fence value of the
+// submission that reads it, and Reclaim frees retired allocations from the tail once
+// that fence has been reached.  An allocation that has not been retired yet holds back
+// everything after it.  An allocation that does not fit before the end of the ring
+// starts again at 0 and the skipped bytes are freed with it.  Has no graphics API
+// dependency.
+class RingAllocator
+{
+public:
+    static const std::uint64_t InvalidOffset = ~0ull;
+
+    void Reset(std::uint64_t capacity)
+    {
+        m_Head = 0;
+        m_Allocations.clear();
+        m_Stats = RingAllocatorStats();
+        m_Stats.Capacity = capacity;
+    }
+
+    // Returns the offset of size bytes aligned to alignment (a power of two), or
+    // InvalidOffset if the free part of the ring is too small.
+    std::uint64_t Allocate(std::uint64_t size, std::uint64_t alignment)
+    {
+        const std::uint64_t Capacity = m_Stats.Capacity;
+        if (size == 0 || size > Capacity)
+        {
+            ++m_Stats.FailedCount;
+            return InvalidOffset;
+        }
+
+        // An empty ring starts over at 0 so that nothing is lost to wrap padding.
+        if (m_Allocations.empty())
+            m_Head = 0;
+
+        std::uint64_t Begin = (m_Head + alignment - 1) & ~(alignment - 1);
+        bool bWrap = false;
+        if (Begin + size > Capacity)
+        {
+            Begin = 0;
+            bWrap = true;
+        }
+
+        // Bytes taken from the free part: padding up to Begin (or to the end) plus size.
+        const std::uint64_t Taken = (bWrap ? Capacity - m_Head : Begin - m_Head) + size;
+        if (m_Stats.UsedBytes + Taken > Capacity)
+        {
+            ++m_Stats.FailedCount;
+            return InvalidOffset;
+        }
+
+        m_Allocations.push_back({ Begin, Taken, PendingFence });
+        m_Head = Begin + size == Capacity ? 0 : Begin + size;
+
+        m_Stats.UsedBytes += Taken;
+        m_Stats.PeakBytes = (std::max)(m_Stats.PeakBytes, m_Stats.UsedBytes);
+        m_Stats.AllocatedBytes += size;
+        ++m_Stats.AllocationCount;
+        if (bWrap)
+            ++m_Stats.WrapCount;
+
+        return Begin;
+    }
+
+    // The allocation at offset may be reclaimed once fenceValue has been reached.
+    void Retire(std::uint64_t offset, std::uint64_t fenceValue)
+    {
+        for (Allocation& A : m_Allocations)
+        {
+            if (A.Offset == offset && A.FenceValue == PendingFence)
+            {
+                A.FenceValue = fenceValue;
+                return;
+            }
+        }
+    }
+
+    // Retires every allocation not retired yet, for callers that submit all of them at once.
+    void RetireAll(std::uint64_t fenceValue)
+    {
+        for (Allocation& A : m_Allocations)
+        {
+            if (A.FenceValue == PendingFence)
+                A.FenceValue = fenceValue;
+        }
+    }
+
+    // Frees allocations from the tail whose fence value is at most completedFence.
+    void Reclaim(std::uint64_t completedFence)
+    {
+        while (!m_Allocations.empty() && m_Allocations.front().FenceValue <= completedFence)
+        {
+            m_Stats.UsedBytes -= m_Allocations.front().Taken;
+            m_Allocations.pop_front();
+        }
+    }
+
+    std::uint64_t GetCapacity()const { return m_Stats.Capacity; }
+    std::uint64_t GetUsedBytes()const { return m_Stats.UsedBytes; }
+    std::uint32_t GetLiveCount()const { return (std::uint32_t)m_Allocations.size(); }
+
+    const RingAllocatorStats& GetStats()const { return m_Stats; }
+
+private:
+    static const std::uint64_t PendingFence = ~0ull;
+
+    struct Allocation
+    {
+        std::uint64_t Offset;
+        std::uint64_t Taken;
+        std::uint64_t FenceValue;
+    };
+
+    std::uint64_t m_Head = 0;
+
+    // Oldest first; the tail of the ring is the first allocation's start.
+    std::deque<Allocation> m_Allocations;
+
+    RingAllocatorStats m_Stats;
+};
@@ -0,0 +1,348 @@
+#include "ShaderCache.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#endif
+
+namespace
+{
+    const std::uint32_t EntryMagic = 0x31434853; // "SHC1"
+    const std::uint32_t ManifestMagic = 0x314d4853; // "SHM1"
+
+    // Reads the fields of an entry in order and fails once anything runs past the end.
+    class EntryReader
+    {
+    public:
+        EntryReader(const std::uint8_t* data, std::size_t size) : m_Data(data), m_Size(size) {}
+
+        template<typename T>
+        bool Read(T& value)
+        {
+            if (m_Size - m_Offset < sizeof(T))
+                return false;
+            memcpy(&value, m_Data + m_Offset, sizeof(T));
+            m_Offset += sizeof(T);
+            return true;
+        }
+
+        bool ReadString(std::string& value)
+        {
+            std::uint32_t Length = 0;
+            if (!Read(Length) || m_Size - m_Offset < Length)
+                return false;
+            value.assign(reinterpret_cast<const char*>(m_Data + m_Offset), Length);
+            m_Offset += Length;
+            return true;
+        }
+
+        const std::uint8_t* Skip(std::uint64_t size)
+        {
+            if (m_Size - m_Offset < size)
+                return nullptr;
+            const std::uint8_t* Data = m_Data + m_Offset;
+            m_Offset += (std::size_t)size;
+            return Data;
+        }
+
+    private:
+        const std::uint8_t* m_Data;
+        std::size_t m_Size;
+        std::size_t m_Offset = 0;
+    };
+
+    void WriteString(std::ofstream& file, const std::string& value)
+    {
+        const std::uint32_t Length = (std::uint32_t)value.size();
+        file.write(reinterpret_cast<const char*>(&Length), sizeof(Length));
+        file.write(value.data(), Length);
+    }
+
+    void CreateDirectoryIfMissing(const std::string& directory)
+    {
+#if defined(_WIN32)
+        CreateDirectoryA(directory.c_str(), nullptr);
+#else
+        mkdir(directory.c_str(), 0755);
+#endif
+    }
+}
+
+std::string ShaderCacheKey::ToString()const
+{
+    std::string Text = SourcePath + "|" + EntryPoint + "|" + Target + "|" + std::to_string(Flags) + "|" + std::to_string(CompilerVersion);
+    for (const std::pair<std::string, std::string>& Define : Defines)
+    {
+        Text += "|" + Define.first + "=" + Define.second;
+    }
+    return Text;
+}
+
+void ShaderCache::SetDirectory(const std::string& directory)
+{
+    m_Directory = directory;
+    while (!m_Directory.empty() && (m_Directory.back() == '/' || m_Directory.back() == '\\'))
+    {
+        m_Directory.pop_back();
+    }
+}
+
+std::string ShaderCache::GetManifestPath(const ShaderCacheKey& key)const
+{
+    const std::string Text = key.ToString();
+
+    char Name[32];
+    snprintf(Name, sizeof(Name), "%016llx.shm", (unsigned long long)HashBytes(Text.data(), Text.size()));
+    return m_Directory + "/" + Name;
+}
+
+std::string ShaderCache::GetEntryPath(const ShaderCacheKey& key, const std::vector<ShaderDependency>& dependencies)const
+{
+    const std::string Text = key.ToString();
+    return GetEntryPath(HashBytes(Text.data(), Text.size()), GetContentHash(dependencies));
+}
+
+std::uint64_t ShaderCache::GetContentHash(const std::vector<ShaderDependency>& dependencies)
+{
+    std::uint64_t Hash = HashSeed;
+    for (const ShaderDependency& Dependency : dependencies)
+    {
+        Hash = HashBytes(Dependency.Path.data(), Dependency.Path.size(), Hash);
+        Hash = HashBytes(&Dependency.Hash, sizeof(Dependency.Hash), Hash);
+    }
+    return Hash;
+}
+
+std::string ShaderCache::GetEntryPath(std::uint64_t keyHash, std::uint64_t contentHash)const
+{
+    char Name[48];
+    snprintf(Name, sizeof(Name), "%016llx-%016llx.cso", (unsigned long long)keyHash, (unsigned long long)contentHash);
+    return m_Directory + "/" + Name;
+}
+
+std::vector<std::uint64_t> ShaderCache::ReadManifest(const std::string& path, const std::string& keyText)const
+{
+    std::vector<std::uint64_t> ContentHashes;
+
+    MappedFile File;
+    if (!File.Open(path))
+        return ContentHashes;
+
+    EntryReader Reader(File.GetData(), File.GetSize());
+
+    std::uint32_t Magic = 0;
+    std::string KeyText;
+    std::uint32_t Count = 0;
+    if (!Reader.Read(Magic) || Magic != ManifestMagic || !Reader.ReadString(KeyText) || KeyText != keyText ||
+        !Reader.Read(Count) || Count > MaxVariants)
+        return ContentHashes;
+
+    ContentHashes.resize(Count);
+    for (std::uint64_t& ContentHash : ContentHashes)
+    {
+        if (!Reader.Read(ContentHash))
+            return std::vector<std::uint64_t>();
+    }
+    return ContentHashes;
+}
+
+ShaderCache::EntryState ShaderCache::ReadEntry(const std::string& path, const std::string& keyText, std::vector<std::uint8_t>& bytecode)
+{
+    MappedFile File;
+    if (!File.Open(path))
+        return EntryState::Damaged;
+
+    EntryReader Reader(File.GetData(), File.GetSize());
+
+    std::uint32_t Magic = 0;
+    std::string KeyText;
+    std::uint32_t DependencyCount = 0;
+    if (!Reader.Read(Magic) || Magic != EntryMagic || !Reader.ReadString(KeyText) || KeyText != keyText ||
+        !Reader.Read(DependencyCount))
+        return EntryState::Damaged;
+
+    for (std::uint32_t i = 0; i < DependencyCount; ++i)
+    {
+        ShaderDependency Dependency;
+        std::uint64_t Hash = 0;
+        if (!Reader.ReadString(Dependency.Path) || !Reader.Read(Dependency.Hash))
+            return EntryState::Damaged;
+        if (!HashFile(Dependency.Path, Hash) || Hash != Dependency.Hash)
+            return EntryState::Stale;
+    }
+
+    std::uint64_t Size = 0;
+    const std::uint8_t* Data = Reader.Read(Size) ? Reader.Skip(Size) : nullptr;
+    if (Data == nullptr || Size == 0)
+        return EntryState::Damaged;
+
+    bytecode.assign(Data, Data + Size);
+    return EntryState::Valid;
+}
+
+bool ShaderCache::Find(const ShaderCacheKey& key, std::vector<std::uint8_t>& bytecode)
+{
+    if (!IsEnabled())
+        return false;
+
+    const std::string KeyText = key.ToString();
+    const std::uint64_t KeyHash = HashBytes(KeyText.data(), KeyText.size());
+
+    // Any variant whose files all still match will do; the newest is the likeliest.
+    bool bStale = false;
+    for (std::uint64_t ContentHash : ReadManifest(GetManifestPath(key), KeyText))
+    {
+        switch (ReadEntry(GetEntryPath(KeyHash, ContentHash), KeyText, bytecode))
+        {
+        case EntryState::Valid:
+            Count(m_Stats.Hits);
+            return true;
+        case EntryState::Stale:
+            bStale = true;
+            break;
+        case EntryState::Damaged:
+            break;
+        }
+    }
+
+    Count(bStale ? m_Stats.Stale : m_Stats.Misses);
+    return false;
+}
+
+bool ShaderCache::Store(const ShaderCacheKey& key, const std::vector<ShaderDependency>& dependencies, const void* bytecode, std::size_t size)
+{
+    if (!IsEnabled())
+        return false;
+
+    CreateDirectoryIfMissing(m_Directory);
+
+    const std::string KeyText = key.ToString();
+    const std::uint64_t KeyHash = HashBytes(KeyText.data(), KeyText.size());
+    const std::uint64_t ContentHash = GetContentHash(dependencies);
+
+    {
+        std::ofstream File(GetEntryPath(KeyHash, ContentHash), std::ios::binary | std::ios::trunc);
+        if (!File)
+            return false;
+
+        const std::uint32_t DependencyCount = (std::uint32_t)dependencies.size();
+        File.write(reinterpret_cast<const char*>(&EntryMagic), sizeof(EntryMagic));
+        WriteString(File, KeyText);
+        File.write(reinterpret_cast<const char*>(&DependencyCount), sizeof(DependencyCount));
+        for (const ShaderDependency& Dependency : dependencies)
+        {
+            WriteString(File, Dependency.Path);
+            File.write(reinterpret_cast<const char*>(&Dependency.Hash), sizeof(Dependency.Hash));
+        }
+
+        const std::uint64_t Size = size;
+        File.write(reinterpret_cast<const char*>(&Size), sizeof(Size));
+        File.write(reinterpret_cast<const char*>(bytecode), (std::streamsize)size);
+
+        if (!File)
+            return false;
+    }
+
+    // The compile just read these contents, so later lookups need not hash them again.
+    {
+        std::lock_guard<std::mutex> Lock(m_Mutex);
+        for (const ShaderDependency& Dependency : dependencies)
+        {
+            m_FileHashes[Dependency.Path] = Dependency.Hash;
+        }
+    }
+
+    // The new entry goes to the front of the manifest; whatever falls off the end is deleted.
+    const std::string ManifestPath = GetManifestPath(key);
+
+    std::vector<std::uint64_t> ContentHashes = ReadManifest(ManifestPath, KeyText);
+    ContentHashes.erase(std::remove(ContentHashes.begin(), ContentHashes.end(), ContentHash), ContentHashes.end());
+    ContentHashes.insert(ContentHashes.begin(), ContentHash);
+    while (ContentHashes.size() > MaxVariants)
+    {
+        std::remove(GetEntryPath(KeyHash, ContentHashes.back()).c_str());
+        ContentHashes.pop_back();
+    }
+
+    std::ofstream File(ManifestPath, std::ios::binary | std::ios::trunc);
+    if (!File)
+        return false;
+
+    const std::uint32_t VariantCount = (std::uint32_t)ContentHashes.size();
+    File.write(reinterpret_cast<const char*>(&ManifestMagic), sizeof(ManifestMagic));
+    WriteString(File, KeyText);
+    File.write(reinterpret_cast<const char*>(&VariantCount), sizeof(VariantCount));
+    File.write(reinterpret_cast<const char*>(ContentHashes.data()), ContentHashes.size() * sizeof(std::uint64_t));
+
+    if (!File)
+        return false;
+
+    Count(m_Stats.Stores);
+    return true;
+}
+
+std::uint64_t ShaderCache::HashBytes(const void* data, std::size_t size, std::uint64_t hash)
+{
+    const std::uint8_t* Bytes = reinterpret_cast<const std::uint8_t*>(data);
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        hash ^= Bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+bool ShaderCache::HashFile(const std::string& path, std::uint64_t& hash)
+{
+    {
+        std::lock_guard<std::mutex> Lock(m_Mutex);
+        auto Found = m_FileHashes.find(path);
+        if (Found != m_FileHashes.end())
+        {
+            hash = Found->second;
+            return true;
+        }
+    }
+
+    // Two threads may hash the same file; both get the same result.
+    MappedFile File;
+    if (!File.Open(path))
+        return false;
+
+    hash = HashBytes(File.GetData(), File.GetSize());
+
+    std::lock_guard<std::mutex> Lock(m_Mutex);
+    m_FileHashes[path] = hash;
+    return true;
+}
+
+void ShaderCache::ClearFileHashes()
+{
+    std::lock_guard<std::mutex> Lock(m_Mutex);
+    m_FileHashes.clear();
+}
+
+ShaderCacheStats ShaderCache::GetStats()const
+{
+    std::lock_guard<std::mutex> Lock(m_Mutex);
+    return m_Stats;
+}
+
+void ShaderCache::ResetStats()
+{
+    std::lock_guard<std::mutex> Lock(m_Mutex);
+    m_Stats = ShaderCacheStats();
+}
+
+void ShaderCache::Count(std::uint32_t& counter)
+{
+    std::lock_guard<std::mutex> Lock(m_Mutex);
+    ++counter;
+}
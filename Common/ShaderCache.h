@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+struct ShaderCacheStats
+{
+    std::uint32_t Hits = 0;
+
+    // Lookups with no usable entry, and entries thrown away because a file they were
+    // compiled from has changed since.
+    std::uint32_t Misses = 0;
+    std::uint32_t Stale = 0;
+
+    std::uint32_t Stores = 0;
+};
+
+// A file a compile read, with the hash of its contents at the time.
+struct ShaderDependency
+{
+    std::string Path;
+    std::uint64_t Hash = 0;
+};
+
+// Everything besides file contents that decides the bytecode.
+struct ShaderCacheKey
+{
+    std::string SourcePath;
+    std::vector<std::pair<std::string, std::string>> Defines;
+    std::string EntryPoint;
+    std::string Target;
+    std::uint32_t Flags = 0;
+    std::uint32_t CompilerVersion = 0;
+
+    // One line of text; stored in the entry so that a file name hash collision is a miss.
+    std::string ToString()const;
+};
+
+// On-disk shader bytecode cache in a directory.  An entry lists every file the compile
+// read (the source and each include the include handler resolved) with the hash of its
+// contents, and is only used while all of them still hash the same, so editing an include
+// invalidates every permutation that pulled it in.  Entries are named by key and by those
+// contents, and a per-key manifest lists the newest MaxVariants of them, so reverting the
+// edit finds the earlier entry again instead of compiling.  File hashes are computed once
+// per ShaderCache; call ClearFileHashes after editing sources at run time.  Find, Store and
+// HashFile may be called from several threads, but not Store for the same key at once.
+// Has no graphics API dependency.
+class ShaderCache
+{
+public:
+    static const std::uint64_t HashSeed = 14695981039346656037ull;
+
+    // Older entries of a key are deleted when a newer one pushes them out of its manifest.
+    static const std::uint32_t MaxVariants = 8;
+
+    // An empty directory disables the cache.  The directory is created on the first Store.
+    void SetDirectory(const std::string& directory);
+    const std::string& GetDirectory()const { return m_Directory; }
+    bool IsEnabled()const { return !m_Directory.empty(); }
+
+    // Returns true and the bytecode if a valid entry exists.
+    bool Find(const ShaderCacheKey& key, std::vector<std::uint8_t>& bytecode);
+
+    // Returns false if the entry could not be written; the compile result is still good.
+    bool Store(const ShaderCacheKey& key, const std::vector<ShaderDependency>& dependencies, const void* bytecode, std::size_t size);
+
+    // FNV-1a; pass the previous result as hash to continue a hash.
+    static std::uint64_t HashBytes(const void* data, std::size_t size, std::uint64_t hash = HashSeed);
+
+    bool HashFile(const std::string& path, std::uint64_t& hash);
+    void ClearFileHashes();
+
+    std::string GetManifestPath(const ShaderCacheKey& key)const;
+    std::string GetEntryPath(const ShaderCacheKey& key, const std::vector<ShaderDependency>& dependencies)const;
+
+    ShaderCacheStats GetStats()const;
+    void ResetStats();
+
+private:
+    enum class EntryState
+    {
+        Valid,
+        Stale,
+        Damaged
+    };
+
+    EntryState ReadEntry(const std::string& path, const std::string& keyText, std::vector<std::uint8_t>& bytecode);
+
+    // Content hashes of the key's entries, newest first; empty if there is no manifest.
+    std::vector<std::uint64_t> ReadManifest(const std::string& path, const std::string& keyText)const;
+
+    std::string GetEntryPath(std::uint64_t keyHash, std::uint64_t contentHash)const;
+    static std::uint64_t GetContentHash(const std::vector<ShaderDependency>& dependencies);
+
+    void Count(std::uint32_t& counter);
+
+private:
+    std::string m_Directory;
+
+    std::unordered_map<std::string, std::uint64_t> m_FileHashes;
+
+    ShaderCacheStats m_Stats;
+
+    // Guards the file hashes and the stats.
+    mutable std::mutex m_Mutex;
+};
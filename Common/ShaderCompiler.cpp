@@ -0,0 +1,179 @@
+#include "ShaderCompiler.h"
+#include "MappedFile.h"
+
+#include <memory>
+#include <unordered_map>
+
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+    std::string WStringToAnsi(const std::wstring& str)
+    {
+        int Length = WideCharToMultiByte(CP_ACP, 0, str.c_str(), -1, nullptr, 0, nullptr, nullptr);
+        if (Length <= 0)
+            return std::string();
+
+        std::string Result(Length - 1, '\0');
+        WideCharToMultiByte(CP_ACP, 0, str.c_str(), -1, &Result[0], Length, nullptr, nullptr);
+        return Result;
+    }
+
+    std::string GetDirectory(const std::string& path)
+    {
+        const size_t Slash = path.find_last_of("/\\");
+        return Slash == std::string::npos ? std::string() : path.substr(0, Slash + 1);
+    }
+
+    std::wstring GetDirectory(const std::wstring& path)
+    {
+        const size_t Slash = path.find_last_of(L"/\\");
+        return Slash == std::wstring::npos ? std::wstring() : path.substr(0, Slash + 1);
+    }
+
+    bool GetWriteTime(const std::wstring& path, FILETIME& writeTime)
+    {
+        WIN32_FILE_ATTRIBUTE_DATA Data;
+        if (!GetFileAttributesExW(path.c_str(), GetFileExInfoStandard, &Data))
+            return false;
+
+        writeTime = Data.ftLastWriteTime;
+        return true;
+    }
+
+    // Opens includes relative to the file that includes them and records each one with
+    // the hash of the contents the compiler actually saw.
+    class RecordingInclude : public ID3DInclude
+    {
+    public:
+        RecordingInclude(const std::string& sourcePath, std::vector<ShaderDependency>& dependencies)
+            : m_SourceDirectory(GetDirectory(sourcePath)), m_Dependencies(dependencies)
+        {
+        }
+
+        HRESULT __stdcall Open(D3D_INCLUDE_TYPE includeType, LPCSTR fileName, LPCVOID parentData, LPCVOID* data, UINT* bytes) override
+        {
+            auto Parent = m_Directories.find(parentData);
+            const std::string Path = (Parent != m_Directories.end() ? Parent->second : m_SourceDirectory) + fileName;
+
+            auto File = std::make_unique<MappedFile>();
+            if (!File->Open(Path))
+                return E_FAIL;
+
+            // Include guards make the compiler open the same file more than once.
+            bool bRecorded = false;
+            for (const ShaderDependency& Dependency : m_Dependencies)
+            {
+                bRecorded = bRecorded || Dependency.Path == Path;
+            }
+            if (!bRecorded)
+                m_Dependencies.push_back({ Path, ShaderCache::HashBytes(File->GetData(), File->GetSize()) });
+
+            *data = File->GetData();
+            *bytes = (UINT)File->GetSize();
+
+            m_Directories[*data] = GetDirectory(Path);
+            m_Files.push_back(std::move(File));
+            return S_OK;
+        }
+
+        // The mappings stay open until the compile is done.
+        HRESULT __stdcall Close(LPCVOID data) override
+        {
+            return S_OK;
+        }
+
+    private:
+        std::string m_SourceDirectory;
+        std::vector<ShaderDependency>& m_Dependencies;
+
+        std::unordered_map<LPCVOID, std::string> m_Directories;
+        std::vector<std::unique_ptr<MappedFile>> m_Files;
+    };
+}
+
+ComPtr<ID3DBlob> ShaderCompiler::LoadPrecompiled(const std::wstring& byteCodeFile, const std::wstring& sourceFile)
+{
+    FILETIME ByteCodeTime;
+    if (!GetWriteTime(byteCodeFile, ByteCodeTime))
+        return nullptr;
+
+    // Which includes a shader uses is only known after compiling it, so every file next to
+    // the source counts; the sample keeps all of its includes in the shader directory.
+    const std::wstring SourceDirectory = GetDirectory(sourceFile);
+
+    WIN32_FIND_DATAW FindData;
+    HANDLE hFind = FindFirstFileW((SourceDirectory + L"*").c_str(), &FindData);
+    if (hFind == INVALID_HANDLE_VALUE)
+        return nullptr;
+
+    bool bCurrent = true;
+    do
+    {
+        if ((FindData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0)
+            bCurrent = bCurrent && CompareFileTime(&FindData.ftLastWriteTime, &ByteCodeTime) <= 0;
+    } while (bCurrent && FindNextFileW(hFind, &FindData));
+    FindClose(hFind);
+
+    ComPtr<ID3DBlob> ByteCode;
+    if (!bCurrent || FAILED(D3DReadFileToBlob(byteCodeFile.c_str(), &ByteCode)))
+        return nullptr;
+
+    ++m_PrecompiledCount;
+    return ByteCode;
+}
+
+ComPtr<ID3DBlob> ShaderCompiler::Compile(
+    const std::wstring& fileName,
+    const D3D_SHADER_MACRO* defines,
+    const std::string& entryPoint,
+    const std::string& target)
+{
+    UINT CompileFlags = 0;
+#if defined(DEBUG) || defined(_DEBUG)
+    CompileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+#endif
+
+    ShaderCacheKey Key;
+    Key.SourcePath = WStringToAnsi(fileName);
+    for (const D3D_SHADER_MACRO* Define = defines; Define != nullptr && Define->Name != nullptr; ++Define)
+    {
+        Key.Defines.push_back({ Define->Name, Define->Definition != nullptr ? Define->Definition : "" });
+    }
+    Key.EntryPoint = entryPoint;
+    Key.Target = target;
+    Key.Flags = CompileFlags;
+    Key.CompilerVersion = D3D_COMPILER_VERSION;
+
+    std::vector<std::uint8_t> Cached;
+    if (m_Cache.Find(Key, Cached))
+    {
+        ComPtr<ID3DBlob> ByteCode;
+        ThrowIfFailed(D3DCreateBlob(Cached.size(), &ByteCode));
+        memcpy(ByteCode->GetBufferPointer(), Cached.data(), Cached.size());
+        return ByteCode;
+    }
+
+    MappedFile Source;
+    if (!Source.Open(fileName))
+        throw DxException(HRESULT_FROM_WIN32(GetLastError()), L"ShaderCompiler: " + fileName, AnsiToWString(__FILE__), __LINE__);
+
+    std::vector<ShaderDependency> Dependencies;
+    Dependencies.push_back({ Key.SourcePath, ShaderCache::HashBytes(Source.GetData(), Source.GetSize()) });
+
+    RecordingInclude Include(Key.SourcePath, Dependencies);
+
+    ComPtr<ID3DBlob> ByteCode;
+    ComPtr<ID3DBlob> Errors;
+    HRESULT hr = D3DCompile(Source.GetData(), Source.GetSize(), Key.SourcePath.c_str(), defines, &Include,
+        entryPoint.c_str(), target.c_str(), CompileFlags, 0, &ByteCode, &Errors);
+
+    if (Errors != nullptr)
+        OutputDebugStringA((char*)Errors->GetBufferPointer());
+
+    ThrowIfFailed(hr);
+    ++m_CompileCount;
+
+    m_Cache.Store(Key, Dependencies, ByteCode->GetBufferPointer(), ByteCode->GetBufferSize());
+    return ByteCode;
+}
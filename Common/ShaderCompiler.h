@@ -0,0 +1,42 @@
+#pragma once
+
+#include "d3dUtil.h"
+#include "ShaderCache.h"
+
+#include <atomic>
+
+// d3dUtil::CompileShader with a ShaderCache in front of it.  A compile first looks for
+// an entry for the file, defines, entry point, target and flags; on a miss it compiles
+// with an include handler that records every file it opens, and stores the bytecode
+// with those files' hashes so that changing any of them invalidates the entry.  Paths
+// are resolved like D3D_COMPILE_STANDARD_FILE_INCLUDE: relative to the including file.
+// Compile may be called from several threads; D3DCompile is thread-safe.
+class ShaderCompiler
+{
+public:
+    // An empty directory disables the cache.
+    void SetCacheDirectory(const std::string& directory) { m_Cache.SetDirectory(directory); }
+
+    // Reads bytecode compiled offline (TextureTool permutations --fxc).  Returns null if the
+    // file is missing or older than the source or any other file in the source's directory,
+    // where its includes live, so that an edited shader falls back to Compile.
+    Microsoft::WRL::ComPtr<ID3DBlob> LoadPrecompiled(const std::wstring& byteCodeFile, const std::wstring& sourceFile);
+
+    Microsoft::WRL::ComPtr<ID3DBlob> Compile(
+        const std::wstring& fileName,
+        const D3D_SHADER_MACRO* defines,
+        const std::string& entryPoint,
+        const std::string& target);
+
+    // Counts compiles since the last reset; Hits + Misses + Stale is the number of calls
+    // while the cache is enabled.
+    ShaderCacheStats GetStats()const { return m_Cache.GetStats(); }
+    UINT GetCompileCount()const { return m_CompileCount; }
+    UINT GetPrecompiledCount()const { return m_PrecompiledCount; }
+    void ResetStats() { m_Cache.ResetStats(); m_CompileCount = 0; m_PrecompiledCount = 0; }
+
+private:
+    ShaderCache m_Cache;
+    std::atomic<UINT> m_CompileCount{ 0 };
+    std::atomic<UINT> m_PrecompiledCount{ 0 };
+};
@@ -0,0 +1,76 @@
+#include "ShaderDescriptorHeap.h"
+
+using Microsoft::WRL::ComPtr;
+
+void ShaderDescriptorHeap::Initialize(ID3D12Device* device, UINT persistentCount, UINT transientCount)
+{
+    m_Device = device;
+    m_DescriptorSize = device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+    D3D12_DESCRIPTOR_HEAP_DESC StagingDesc = {};
+    StagingDesc.NumDescriptors = persistentCount;
+    StagingDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+    StagingDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+    ThrowIfFailed(device->CreateDescriptorHeap(&StagingDesc, IID_PPV_ARGS(&m_StagingHeap)));
+
+    D3D12_DESCRIPTOR_HEAP_DESC ShaderDesc = {};
+    ShaderDesc.NumDescriptors = persistentCount + transientCount;
+    ShaderDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+    ShaderDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+    ThrowIfFailed(device->CreateDescriptorHeap(&ShaderDesc, IID_PPV_ARGS(&m_ShaderHeap)));
+
+    m_Allocator.Reset(persistentCount, transientCount);
+}
+
+UINT ShaderDescriptorHeap::AllocatePersistent(UINT count)
+{
+    const UINT Index = m_Allocator.AllocatePersistent(count);
+    if (Index == DescriptorAllocator::InvalidIndex)
+        throw DxException(E_OUTOFMEMORY, L"ShaderDescriptorHeap: persistent region full", AnsiToWString(__FILE__), __LINE__);
+    return Index;
+}
+
+void ShaderDescriptorHeap::FreePersistent(UINT index, UINT count, UINT64 fenceValue)
+{
+    m_Allocator.FreePersistent(index, count, fenceValue);
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE ShaderDescriptorHeap::GetStagingHandle(UINT index)const
+{
+    return CD3DX12_CPU_DESCRIPTOR_HANDLE(m_StagingHeap->GetCPUDescriptorHandleForHeapStart(), (INT)index, m_DescriptorSize);
+}
+
+void ShaderDescriptorHeap::Publish(UINT index, UINT count)
+{
+    CD3DX12_CPU_DESCRIPTOR_HANDLE Dst(m_ShaderHeap->GetCPUDescriptorHandleForHeapStart(), (INT)index, m_DescriptorSize);
+    m_Device->CopyDescriptorsSimple(count, Dst, GetStagingHandle(index), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+}
+
+UINT ShaderDescriptorHeap::CopyToTransient(const UINT* persistentIndices, UINT count)
+{
+    const UINT First = m_Allocator.AllocateTransient(count);
+    if (First == DescriptorAllocator::InvalidIndex)
+        throw DxException(E_OUTOFMEMORY, L"ShaderDescriptorHeap: transient ring full", AnsiToWString(__FILE__), __LINE__);
+
+    for (UINT i = 0; i < count; ++i)
+    {
+        CD3DX12_CPU_DESCRIPTOR_HANDLE Dst(m_ShaderHeap->GetCPUDescriptorHandleForHeapStart(), (INT)(First + i), m_DescriptorSize);
+        m_Device->CopyDescriptorsSimple(1, Dst, GetStagingHandle(persistentIndices[i]), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+    }
+    return First;
+}
+
+void ShaderDescriptorHeap::RetireTransient(UINT64 fenceValue)
+{
+    m_Allocator.RetireTransient(fenceValue);
+}
+
+void ShaderDescriptorHeap::Reclaim(UINT64 completedFence)
+{
+    m_Allocator.Reclaim(completedFence);
+}
+
+D3D12_GPU_DESCRIPTOR_HANDLE ShaderDescriptorHeap::GetGpuHandle(UINT index)const
+{
+    return CD3DX12_GPU_DESCRIPTOR_HANDLE(m_ShaderHeap->GetGPUDescriptorHandleForHeapStart(), (INT)index, m_DescriptorSize);
+}
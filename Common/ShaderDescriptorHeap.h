@@ -0,0 +1,48 @@
+#pragma once
+
+#include "d3dUtil.h"
+#include "DescriptorAllocator.h"
+
+// The CBV/SRV/UAV heap the shaders read, plus a CPU-only staging heap of the same
+// persistent size.  Views are created in the staging heap and Publish copies them to
+// the same index of the shader-visible heap; shader-visible memory may be write-combined,
+// so descriptors are only ever copied out of the staging heap.  Slots come from a
+// DescriptorAllocator: persistent ones are freed with a fence value, transient ranges
+// (tables copied together for this frame) are retired with the frame's fence.  Not
+// thread safe.
+class ShaderDescriptorHeap
+{
+public:
+    void Initialize(ID3D12Device* device, UINT persistentCount, UINT transientCount);
+
+    // Throws when the persistent region is full.
+    UINT AllocatePersistent(UINT count = 1);
+    void FreePersistent(UINT index, UINT count, UINT64 fenceValue);
+
+    // Where the view for a persistent slot is written before Publish.
+    D3D12_CPU_DESCRIPTOR_HANDLE GetStagingHandle(UINT index)const;
+    void Publish(UINT index, UINT count = 1);
+
+    // Copies the views of count persistent slots next to each other in the transient
+    // region and returns the heap index of the copy.  Throws when the ring is full.
+    UINT CopyToTransient(const UINT* persistentIndices, UINT count);
+    void RetireTransient(UINT64 fenceValue);
+
+    void Reclaim(UINT64 completedFence);
+
+    D3D12_GPU_DESCRIPTOR_HANDLE GetGpuHandle(UINT index)const;
+
+    ID3D12DescriptorHeap* GetHeap()const { return m_ShaderHeap.Get(); }
+    UINT GetPersistentCapacity()const { return m_Allocator.GetPersistentCapacity(); }
+
+    const DescriptorAllocatorStats& GetStats()const { return m_Allocator.GetStats(); }
+
+private:
+    Microsoft::WRL::ComPtr<ID3D12Device> m_Device;
+    Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> m_StagingHeap;
+    Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> m_ShaderHeap;
+
+    UINT m_DescriptorSize = 0;
+
+    DescriptorAllocator m_Allocator;
+};
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <string>
+
+// Feature bits of the object shaders.  A permutation key is an OR of them: Shadow picks
+// ShadowMap.hlsl over Default.hlsl, every other bit compiles with its define.
+enum ShaderFeature : std::uint32_t
+{
+    ShaderFeature_None = 0,
+    ShaderFeature_Fog = 1u << 0,
+    ShaderFeature_AlphaTested = 1u << 1,
+    ShaderFeature_Skinned = 1u << 2,
+    ShaderFeature_Instanced = 1u << 3,
+    ShaderFeature_Shadow = 1u << 4,
+};
+
+// The set of valid permutation keys, enumerated at compile time, and a dense index for
+// each so that variants can live in a flat array.  Adding a feature means adding its bit
+// above and its define and name below.  Has no graphics API dependency.
+namespace ShaderPermutation
+{
+    const std::uint32_t FeatureCount = 5;
+    const std::uint32_t KeyCount = 1u << FeatureCount;
+    const std::uint32_t InvalidIndex = UINT32_MAX;
+
+    // Per feature bit; nullptr where the feature only picks the source file.
+    constexpr const char* FeatureDefines[FeatureCount] = { "FOG", "ALPHA_TESTED", "SKINNED", "INSTANCED", nullptr };
+    constexpr const char* FeatureNames[FeatureCount] = { "Fog", "AlphaTested", "Skinned", "Instanced", "Shadow" };
+
+    // Features each stage reads.  Other bits do not change that stage's bytecode, so a
+    // stage only needs compiling for keys that have no bits outside its mask.
+    const std::uint32_t VertexFeatures = ShaderFeature_Skinned | ShaderFeature_Instanced | ShaderFeature_Shadow;
+    const std::uint32_t PixelFeatures = ShaderFeature_Fog | ShaderFeature_AlphaTested | ShaderFeature_Shadow;
+
+    // Skinned draws are never instanced (the bones are per object), and the shadow pass
+    // only writes depth, so fog means nothing there.  Removing a bit from a valid key
+    // always leaves a valid key, which the stage masks rely on.
+    constexpr bool IsValid(std::uint32_t key)
+    {
+        return key < KeyCount &&
+            (key & (ShaderFeature_Skinned | ShaderFeature_Instanced)) != (ShaderFeature_Skinned | ShaderFeature_Instanced) &&
+            (key & (ShaderFeature_Shadow | ShaderFeature_Fog)) != (ShaderFeature_Shadow | ShaderFeature_Fog);
+    }
+
+    struct Table
+    {
+        std::uint32_t Count;
+
+        // Valid keys in increasing order, and the position of each key in that list.
+        std::uint32_t Keys[KeyCount];
+        std::uint32_t Indices[KeyCount];
+    };
+
+    constexpr Table BuildTable()
+    {
+        Table Result = {};
+        for (std::uint32_t Key = 0; Key < KeyCount; ++Key)
+        {
+            Result.Indices[Key] = InvalidIndex;
+            if (IsValid(Key))
+            {
+                Result.Indices[Key] = Result.Count;
+                Result.Keys[Result.Count++] = Key;
+            }
+        }
+        return Result;
+    }
+
+    constexpr Table Permutations = BuildTable();
+    constexpr std::uint32_t Count = Permutations.Count;
+
+    constexpr std::uint32_t GetIndex(std::uint32_t key)
+    {
+        return key < KeyCount ? Permutations.Indices[key] : InvalidIndex;
+    }
+
+    static_assert(Count == 18, "object shader permutations changed; check the pipelines BuildPipelineState creates");
+    static_assert(GetIndex(ShaderFeature_None) == 0, "the base permutation must be valid");
+    static_assert(GetIndex(ShaderFeature_Skinned | ShaderFeature_Instanced) == InvalidIndex, "");
+
+    // "Fog+AlphaTested"; "Base" for no features.
+    inline std::string GetName(std::uint32_t key)
+    {
+        std::string Name;
+        for (std::uint32_t Feature = 0; Feature < FeatureCount; ++Feature)
+        {
+            if (key & (1u << Feature))
+                Name += (Name.empty() ? "" : "+") + std::string(FeatureNames[Feature]);
+        }
+        return Name.empty() ? "Base" : Name;
+    }
+
+    // Writes the define names of key to defines (room for FeatureCount) and returns how
+    // many there are.
+    inline std::uint32_t GetDefines(std::uint32_t key, const char** defines)
+    {
+        std::uint32_t DefineCount = 0;
+        for (std::uint32_t Feature = 0; Feature < FeatureCount; ++Feature)
+        {
+            if ((key & (1u << Feature)) && FeatureDefines[Feature] != nullptr)
+                defines[DefineCount++] = FeatureDefines[Feature];
+        }
+        return DefineCount;
+    }
+}
+
+// One T (bytecode, pipeline state) per valid permutation in a flat array.  Get<Key>()
+// rejects an invalid key at compile time; the runtime overload is one table load and an
+// index, with no hashing or strings.
+template<typename T>
+class ShaderPermutationArray
+{
+public:
+    template<std::uint32_t Key>
+    T& Get()
+    {
+        static_assert(ShaderPermutation::IsValid(Key), "invalid shader permutation");
+        return m_Items[ShaderPermutation::Permutations.Indices[Key]];
+    }
+
+    template<std::uint32_t Key>
+    const T& Get()const
+    {
+        static_assert(ShaderPermutation::IsValid(Key), "invalid shader permutation");
+        return m_Items[ShaderPermutation::Permutations.Indices[Key]];
+    }
+
+    T& operator[](std::uint32_t key)
+    {
+        assert(ShaderPermutation::IsValid(key));
+        return m_Items[ShaderPermutation::Permutations.Indices[key]];
+    }
+
+    const T& operator[](std::uint32_t key)const
+    {
+        assert(ShaderPermutation::IsValid(key));
+        return m_Items[ShaderPermutation::Permutations.Indices[key]];
+    }
+
+    static constexpr std::uint32_t Size() { return ShaderPermutation::Count; }
+
+private:
+    T m_Items[ShaderPermutation::Count];
+};
@@ -0,0 +1,373 @@
+#include "TLSFAllocator.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace
+{
+    std::uint32_t LowestBit(std::uint64_t value)
+    {
+#if defined(_MSC_VER)
+        unsigned long Index;
+        _BitScanForward64(&Index, value);
+        return (std::uint32_t)Index;
+#else
+        return (std::uint32_t)__builtin_ctzll(value);
+#endif
+    }
+
+    std::uint32_t HighestBit(std::uint64_t value)
+    {
+#if defined(_MSC_VER)
+        unsigned long Index;
+        _BitScanReverse64(&Index, value);
+        return (std::uint32_t)Index;
+#else
+        return 63u - (std::uint32_t)__builtin_clzll(value);
+#endif
+    }
+
+    std::uint64_t AlignUp(std::uint64_t value, std::uint64_t alignment)
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+}
+
+void TLSFAllocator::Reset(std::uint64_t size, std::uint64_t granularity)
+{
+    m_Granularity = granularity > 0 ? granularity : 1;
+    m_GranularityShift = HighestBit(m_Granularity);
+    m_Size = size & ~(m_Granularity - 1);
+
+    m_Blocks.clear();
+    m_UnusedBlocks.clear();
+    m_FirstPhysical = InvalidHandle;
+
+    m_FirstLevelBitmap = 0;
+    for (std::uint32_t i = 0; i < FirstLevelCount; ++i)
+    {
+        m_SecondLevelBitmap[i] = 0;
+        for (std::uint32_t j = 0; j < SecondLevelCount; ++j)
+        {
+            m_FreeHeads[i][j] = InvalidHandle;
+        }
+    }
+
+    m_UsedBytes = 0;
+    m_AllocationCount = 0;
+    m_FreeBlockCount = 0;
+
+    if (m_Size == 0)
+        return;
+
+    const std::uint32_t Whole = NewBlock();
+    m_Blocks[Whole].Offset = 0;
+    m_Blocks[Whole].Size = m_Size;
+    m_FirstPhysical = Whole;
+    InsertFree(Whole);
+}
+
+void TLSFAllocator::MapSize(std::uint64_t units, std::uint32_t& firstLevel, std::uint32_t& secondLevel)
+{
+    if (units < SecondLevelCount)
+    {
+        firstLevel = 0;
+        secondLevel = (std::uint32_t)units;
+        return;
+    }
+
+    const std::uint32_t Log2 = HighestBit(units);
+    firstLevel = Log2 - SecondLevelBits + 1;
+    secondLevel = (std::uint32_t)(units >> (Log2 - SecondLevelBits)) - SecondLevelCount;
+}
+
+std::uint32_t TLSFAllocator::NewBlock()
+{
+    if (!m_UnusedBlocks.empty())
+    {
+        const std::uint32_t Reused = m_UnusedBlocks.back();
+        m_UnusedBlocks.pop_back();
+        return Reused;
+    }
+
+    m_Blocks.emplace_back();
+    return (std::uint32_t)m_Blocks.size() - 1;
+}
+
+void TLSFAllocator::ReleaseBlock(std::uint32_t block)
+{
+    m_Blocks[block] = Block();
+    m_UnusedBlocks.push_back(block);
+}
+
+void TLSFAllocator::InsertFree(std::uint32_t block)
+{
+    std::uint32_t FirstLevel;
+    std::uint32_t SecondLevel;
+    MapSize(m_Blocks[block].Size >> m_GranularityShift, FirstLevel, SecondLevel);
+
+    Block& B = m_Blocks[block];
+    B.bFree = true;
+    B.PrevFree = InvalidHandle;
+    B.NextFree = m_FreeHeads[FirstLevel][SecondLevel];
+    if (B.NextFree != InvalidHandle)
+        m_Blocks[B.NextFree].PrevFree = block;
+    m_FreeHeads[FirstLevel][SecondLevel] = block;
+
+    m_FirstLevelBitmap |= 1ull << FirstLevel;
+    m_SecondLevelBitmap[FirstLevel] |= 1u << SecondLevel;
+    ++m_FreeBlockCount;
+}
+
+void TLSFAllocator::RemoveFree(std::uint32_t block)
+{
+    std::uint32_t FirstLevel;
+    std::uint32_t SecondLevel;
+    MapSize(m_Blocks[block].Size >> m_GranularityShift, FirstLevel, SecondLevel);
+
+    Block& B = m_Blocks[block];
+    if (B.PrevFree != InvalidHandle)
+        m_Blocks[B.PrevFree].NextFree = B.NextFree;
+    else
+        m_FreeHeads[FirstLevel][SecondLevel] = B.NextFree;
+    if (B.NextFree != InvalidHandle)
+        m_Blocks[B.NextFree].PrevFree = B.PrevFree;
+
+    B.PrevFree = InvalidHandle;
+    B.NextFree = InvalidHandle;
+    B.bFree = false;
+
+    if (m_FreeHeads[FirstLevel][SecondLevel] == InvalidHandle)
+    {
+        m_SecondLevelBitmap[FirstLevel] &= ~(1u << SecondLevel);
+        if (m_SecondLevelBitmap[FirstLevel] == 0)
+            m_FirstLevelBitmap &= ~(1ull << FirstLevel);
+    }
+    --m_FreeBlockCount;
+}
+
+std::uint32_t TLSFAllocator::FindFree(std::uint64_t size)const
+{
+    std::uint64_t Units = size >> m_GranularityShift;
+
+    // Round up to the next bin boundary so that every block in the bin found is big enough.
+    if (Units >= SecondLevelCount)
+        Units += (1ull << (HighestBit(Units) - SecondLevelBits)) - 1;
+
+    std::uint32_t FirstLevel;
+    std::uint32_t SecondLevel;
+    MapSize(Units, FirstLevel, SecondLevel);
+    if (FirstLevel >= FirstLevelCount)
+        return InvalidHandle;
+
+    std::uint32_t SecondLevelMap = m_SecondLevelBitmap[FirstLevel] & (~0u << SecondLevel);
+    if (SecondLevelMap == 0)
+    {
+        const std::uint64_t FirstLevelMap = FirstLevel + 1 < 64 ? m_FirstLevelBitmap & (~0ull << (FirstLevel + 1)) : 0;
+        if (FirstLevelMap == 0)
+            return InvalidHandle;
+
+        FirstLevel = LowestBit(FirstLevelMap);
+        SecondLevelMap = m_SecondLevelBitmap[FirstLevel];
+    }
+
+    return m_FreeHeads[FirstLevel][LowestBit(SecondLevelMap)];
+}
+
+std::uint32_t TLSFAllocator::Split(std::uint32_t block, std::uint64_t size)
+{
+    const std::uint32_t Rest = NewBlock();
+
+    Block& B = m_Blocks[block];
+    Block& R = m_Blocks[Rest];
+    R.Offset = B.Offset + size;
+    R.Size = B.Size - size;
+    R.PrevPhysical = block;
+    R.NextPhysical = B.NextPhysical;
+    if (B.NextPhysical != InvalidHandle)
+        m_Blocks[B.NextPhysical].PrevPhysical = Rest;
+
+    B.Size = size;
+    B.NextPhysical = Rest;
+
+    return Rest;
+}
+
+std::uint32_t TLSFAllocator::Allocate(std::uint64_t size, std::uint64_t alignment)
+{
+    size = AlignUp(size > 0 ? size : 1, m_Granularity);
+    alignment = alignment > m_Granularity ? alignment : m_Granularity;
+
+    const std::uint64_t SearchSize = size + alignment - m_Granularity;
+    if (SearchSize > m_Size)
+        return InvalidHandle;
+
+    std::uint32_t Found = FindFree(SearchSize);
+
+    // The rounded search skips the bin the size falls in, which may still hold a block that
+    // fits (a heap made for exactly one resource, say).  Look through that bin before
+    // giving up.
+    if (Found == InvalidHandle)
+    {
+        std::uint32_t FirstLevel;
+        std::uint32_t SecondLevel;
+        MapSize(SearchSize >> m_GranularityShift, FirstLevel, SecondLevel);
+
+        for (std::uint32_t Current = m_FreeHeads[FirstLevel][SecondLevel]; Current != InvalidHandle; Current = m_Blocks[Current].NextFree)
+        {
+            const Block& B = m_Blocks[Current];
+            if (AlignUp(B.Offset, alignment) + size <= B.Offset + B.Size)
+            {
+                Found = Current;
+                break;
+            }
+        }
+
+        if (Found == InvalidHandle)
+            return InvalidHandle;
+    }
+
+    RemoveFree(Found);
+
+    // Padding in front goes back to the bins.  Its physical neighbour before it is in use,
+    // since free neighbours are always merged.
+    const std::uint64_t Padding = AlignUp(m_Blocks[Found].Offset, alignment) - m_Blocks[Found].Offset;
+    if (Padding > 0)
+    {
+        const std::uint32_t Front = Found;
+        Found = Split(Front, Padding);
+        InsertFree(Front);
+    }
+
+    if (m_Blocks[Found].Size > size)
+        InsertFree(Split(Found, size));
+
+    m_Blocks[Found].bFree = false;
+    m_UsedBytes += size;
+    ++m_AllocationCount;
+
+    return Found;
+}
+
+void TLSFAllocator::Free(std::uint32_t handle)
+{
+    m_UsedBytes -= m_Blocks[handle].Size;
+    --m_AllocationCount;
+
+    std::uint32_t Current = handle;
+
+    const std::uint32_t Prev = m_Blocks[Current].PrevPhysical;
+    if (Prev != InvalidHandle && m_Blocks[Prev].bFree)
+    {
+        RemoveFree(Prev);
+
+        m_Blocks[Prev].Size += m_Blocks[Current].Size;
+        m_Blocks[Prev].NextPhysical = m_Blocks[Current].NextPhysical;
+        if (m_Blocks[Current].NextPhysical != InvalidHandle)
+            m_Blocks[m_Blocks[Current].NextPhysical].PrevPhysical = Prev;
+
+        ReleaseBlock(Current);
+        Current = Prev;
+    }
+
+    const std::uint32_t Next = m_Blocks[Current].NextPhysical;
+    if (Next != InvalidHandle && m_Blocks[Next].bFree)
+    {
+        RemoveFree(Next);
+
+        m_Blocks[Current].Size += m_Blocks[Next].Size;
+        m_Blocks[Current].NextPhysical = m_Blocks[Next].NextPhysical;
+        if (m_Blocks[Next].NextPhysical != InvalidHandle)
+            m_Blocks[m_Blocks[Next].NextPhysical].PrevPhysical = Current;
+
+        ReleaseBlock(Next);
+    }
+
+    InsertFree(Current);
+}
+
+std::uint64_t TLSFAllocator::GetLargestFreeBlock()const
+{
+    if (m_FirstLevelBitmap == 0)
+        return 0;
+
+    const std::uint32_t FirstLevel = HighestBit(m_FirstLevelBitmap);
+    const std::uint32_t SecondLevel = HighestBit(m_SecondLevelBitmap[FirstLevel]);
+
+    std::uint64_t Largest = 0;
+    for (std::uint32_t Current = m_FreeHeads[FirstLevel][SecondLevel]; Current != InvalidHandle; Current = m_Blocks[Current].NextFree)
+    {
+        Largest = m_Blocks[Current].Size > Largest ? m_Blocks[Current].Size : Largest;
+    }
+    return Largest;
+}
+
+bool TLSFAllocator::Validate()const
+{
+    // Physical chain: contiguous from 0 to m_Size, no two free neighbours.
+    std::uint64_t Offset = 0;
+    std::uint64_t Used = 0;
+    std::uint32_t Allocations = 0;
+    std::uint32_t FreeBlocks = 0;
+    std::uint32_t Prev = InvalidHandle;
+    bool bPrevFree = false;
+
+    for (std::uint32_t Current = m_FirstPhysical; Current != InvalidHandle; Current = m_Blocks[Current].NextPhysical)
+    {
+        const Block& B = m_Blocks[Current];
+        if (B.Offset != Offset || B.Size == 0 || (B.Size & (m_Granularity - 1)) != 0 || B.PrevPhysical != Prev)
+            return false;
+        if (B.bFree && bPrevFree)
+            return false;
+
+        if (B.bFree)
+            ++FreeBlocks;
+        else
+        {
+            Used += B.Size;
+            ++Allocations;
+        }
+
+        Offset += B.Size;
+        Prev = Current;
+        bPrevFree = B.bFree;
+    }
+
+    if (Offset != m_Size || Used != m_UsedBytes || Allocations != m_AllocationCount || FreeBlocks != m_FreeBlockCount)
+        return false;
+
+    // Bins: every listed block is free and in the bin of its size, bitmaps match the lists.
+    std::uint32_t Listed = 0;
+    for (std::uint32_t FirstLevel = 0; FirstLevel < FirstLevelCount; ++FirstLevel)
+    {
+        for (std::uint32_t SecondLevel = 0; SecondLevel < SecondLevelCount; ++SecondLevel)
+        {
+            const std::uint32_t Head = m_FreeHeads[FirstLevel][SecondLevel];
+            const bool bBit = (m_SecondLevelBitmap[FirstLevel] & (1u << SecondLevel)) != 0;
+            if (bBit != (Head != InvalidHandle))
+                return false;
+
+            std::uint32_t PrevFree = InvalidHandle;
+            for (std::uint32_t Current = Head; Current != InvalidHandle; Current = m_Blocks[Current].NextFree)
+            {
+                const Block& B = m_Blocks[Current];
+
+                std::uint32_t BlockFirst;
+                std::uint32_t BlockSecond;
+                MapSize(B.Size >> m_GranularityShift, BlockFirst, BlockSecond);
+                if (!B.bFree || B.PrevFree != PrevFree || BlockFirst != FirstLevel || BlockSecond != SecondLevel)
+                    return false;
+
+                PrevFree = Current;
+                ++Listed;
+            }
+        }
+
+        const bool bFirstBit = (m_FirstLevelBitmap & (1ull << FirstLevel)) != 0;
+        if (bFirstBit != (m_SecondLevelBitmap[FirstLevel] != 0))
+            return false;
+    }
+
+    return Listed == m_FreeBlockCount;
+}
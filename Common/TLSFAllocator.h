@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Two-level segregated fit allocator over one range of offsets, for placing resources in
+// a GPU heap.  Free blocks are binned by size: the first level is the power of two, the
+// second splits each power of two into 16 linear steps, and a bitmap per level finds the
+// smallest non-empty bin that is certain to fit in constant time.  Freed blocks merge
+// with their free neighbours straight away, so allocation and free are O(1) and free
+// space stays in as few blocks as the live allocations allow.
+//
+// Sizes and offsets are multiples of a power of two granularity (the smallest placement
+// alignment, e.g. 4KB or 64KB).  Larger alignments (64KB, 4MB for MSAA) are handled by
+// searching for size + alignment - granularity and returning the padding in front to
+// the bins.  Has no graphics API dependency.
+class TLSFAllocator
+{
+public:
+    static const std::uint32_t InvalidHandle = 0xffffffffu;
+
+    // size is rounded down to granularity.
+    void Reset(std::uint64_t size, std::uint64_t granularity);
+
+    // Returns a handle for size bytes at an offset that is a multiple of alignment (a
+    // power of two), or InvalidHandle if no free block fits.
+    std::uint32_t Allocate(std::uint64_t size, std::uint64_t alignment);
+    void Free(std::uint32_t handle);
+
+    std::uint64_t GetOffset(std::uint32_t handle)const { return m_Blocks[handle].Offset; }
+    std::uint64_t GetAllocationSize(std::uint32_t handle)const { return m_Blocks[handle].Size; }
+
+    std::uint64_t GetSize()const { return m_Size; }
+    std::uint64_t GetGranularity()const { return m_Granularity; }
+    std::uint64_t GetUsedBytes()const { return m_UsedBytes; }
+    std::uint64_t GetFreeBytes()const { return m_Size - m_UsedBytes; }
+    std::uint32_t GetAllocationCount()const { return m_AllocationCount; }
+    std::uint32_t GetFreeBlockCount()const { return m_FreeBlockCount; }
+    bool IsEmpty()const { return m_AllocationCount == 0; }
+
+    std::uint64_t GetLargestFreeBlock()const;
+
+    // Calls visit(handle, offset, size) for every allocation in offset order.
+    template<typename F>
+    void ForEachAllocation(F&& visit)const;
+
+    // Checks every internal invariant; used by the heap-sim tool command.
+    bool Validate()const;
+
+private:
+    static const std::uint32_t SecondLevelBits = 4;
+    static const std::uint32_t SecondLevelCount = 1u << SecondLevelBits;
+    static const std::uint32_t FirstLevelCount = 48;
+
+    struct Block
+    {
+        std::uint64_t Offset = 0;
+        std::uint64_t Size = 0;
+
+        // Neighbours by offset, and in the free list of the block's bin.
+        std::uint32_t PrevPhysical = InvalidHandle;
+        std::uint32_t NextPhysical = InvalidHandle;
+        std::uint32_t PrevFree = InvalidHandle;
+        std::uint32_t NextFree = InvalidHandle;
+
+        bool bFree = false;
+    };
+
+    // Bin of a size in granularity units.
+    static void MapSize(std::uint64_t units, std::uint32_t& firstLevel, std::uint32_t& secondLevel);
+
+    std::uint32_t NewBlock();
+    void ReleaseBlock(std::uint32_t block);
+
+    void InsertFree(std::uint32_t block);
+    void RemoveFree(std::uint32_t block);
+
+    // Smallest free block whose bin guarantees at least size bytes.
+    std::uint32_t FindFree(std::uint64_t size)const;
+
+    // Cuts the block at offset + size and returns the new block holding the rest.
+    std::uint32_t Split(std::uint32_t block, std::uint64_t size);
+
+private:
+    std::uint64_t m_Size = 0;
+    std::uint64_t m_Granularity = 1;
+    std::uint32_t m_GranularityShift = 0;
+
+    std::vector<Block> m_Blocks;
+    std::vector<std::uint32_t> m_UnusedBlocks;
+    std::uint32_t m_FirstPhysical = InvalidHandle;
+
+    std::uint64_t m_FirstLevelBitmap = 0;
+    std::uint32_t m_SecondLevelBitmap[FirstLevelCount] = {};
+    std::uint32_t m_FreeHeads[FirstLevelCount][SecondLevelCount];
+
+    std::uint64_t m_UsedBytes = 0;
+    std::uint32_t m_AllocationCount = 0;
+    std::uint32_t m_FreeBlockCount = 0;
+};
+
+template<typename F>
+void TLSFAllocator::ForEachAllocation(F&& visit)const
+{
+    for (std::uint32_t Current = m_FirstPhysical; Current != InvalidHandle; Current = m_Blocks[Current].NextPhysical)
+    {
+        const Block& B = m_Blocks[Current];
+        if (!B.bFree)
+            visit(Current, B.Offset, B.Size);
+    }
+}
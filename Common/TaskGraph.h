@@ -0,0 +1,227 @@
+#pragma once
+
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+struct TaskGraphStats
+{
+    std::size_t TaskCount = 0;
+
+    // Tasks not run because a task they depend on threw.
+    std::size_t SkippedCount = 0;
+
+    // Most tasks running at once during the last Run.
+    std::size_t PeakRunning = 0;
+};
+
+// A set of tasks with dependencies, run on a ThreadPool.  A task is submitted as soon as
+// every task it depends on has finished, so independent chains (a shader compile and the
+// pipeline states that use it) overlap.  Dependencies must be tasks added earlier, which
+// keeps the graph acyclic and makes the order tasks were added in a valid serial order.
+// Has no graphics API dependency.
+class TaskGraph
+{
+public:
+    typedef std::size_t TaskId;
+    typedef std::function<void()> TaskFunc;
+
+    void Reset()
+    {
+        m_Tasks.clear();
+        m_Stats = TaskGraphStats();
+    }
+
+    std::size_t GetTaskCount()const { return m_Tasks.size(); }
+
+    TaskId AddTask(TaskFunc func, const std::vector<TaskId>& dependencies = std::vector<TaskId>())
+    {
+        const TaskId Id = m_Tasks.size();
+
+        Task NewTask;
+        NewTask.Func = std::move(func);
+        for (TaskId Dependency : dependencies)
+        {
+            if (Dependency >= Id)
+                throw std::invalid_argument("TaskGraph: a dependency must be added before the task");
+
+            // The same dependency listed twice would be counted twice.
+            std::vector<TaskId>& Dependents = m_Tasks[Dependency].Dependents;
+            if (std::find(Dependents.begin(), Dependents.end(), Id) == Dependents.end())
+            {
+                Dependents.push_back(Id);
+                ++NewTask.DependencyCount;
+            }
+        }
+
+        m_Tasks.push_back(std::move(NewTask));
+        return Id;
+    }
+
+    // Runs every task and returns once all of them have finished or been skipped.  When a
+    // task throws, the tasks that depend on it are skipped, everything else still runs and
+    // the first exception is rethrown here.  The calling thread only waits, so this must
+    // not be called from a task running on the same pool.
+    void Run(ThreadPool& pool)
+    {
+        BeginRun();
+        if (m_Tasks.empty())
+            return;
+
+        // Workers start counting down m_Remaining as soon as the first task is submitted,
+        // so pick the roots from the fixed dependency counts.
+        for (TaskId i = 0; i < m_Tasks.size(); ++i)
+        {
+            if (m_Tasks[i].DependencyCount == 0)
+                Submit(pool, i);
+        }
+
+        {
+            std::unique_lock<std::mutex> Lock(m_Mutex);
+            m_Condition.wait(Lock, [this]() { return m_FinishedCount == m_Tasks.size(); });
+        }
+
+        EndRun();
+    }
+
+    // Same result on the calling thread only, in the order the tasks were added.
+    void RunSerial()
+    {
+        BeginRun();
+
+        for (TaskId i = 0; i < m_Tasks.size(); ++i)
+        {
+            Execute(nullptr, i);
+        }
+
+        EndRun();
+    }
+
+    const TaskGraphStats& GetStats()const { return m_Stats; }
+
+private:
+    struct Task
+    {
+        TaskFunc Func;
+        std::vector<TaskId> Dependents;
+        std::size_t DependencyCount = 0;
+    };
+
+    void BeginRun()
+    {
+        m_Remaining.resize(m_Tasks.size());
+        m_Blocked.assign(m_Tasks.size(), false);
+        for (TaskId i = 0; i < m_Tasks.size(); ++i)
+        {
+            m_Remaining[i] = m_Tasks[i].DependencyCount;
+        }
+
+        m_FinishedCount = 0;
+        m_RunningCount = 0;
+        m_Error = nullptr;
+
+        m_Stats.TaskCount = m_Tasks.size();
+        m_Stats.SkippedCount = 0;
+        m_Stats.PeakRunning = 0;
+    }
+
+    void EndRun()
+    {
+        if (m_Error)
+        {
+            std::exception_ptr Error = m_Error;
+            m_Error = nullptr;
+            std::rethrow_exception(Error);
+        }
+    }
+
+    void Submit(ThreadPool& pool, TaskId id)
+    {
+        // Execute catches everything, so the future has nothing to report.
+        pool.Submit([this, &pool, id]() { Execute(&pool, id); });
+    }
+
+    // pool is null when running serially; dependents then run from the caller's loop.
+    void Execute(ThreadPool* pool, TaskId id)
+    {
+        bool bSkip = false;
+        {
+            std::lock_guard<std::mutex> Lock(m_Mutex);
+            bSkip = m_Blocked[id];
+            if (!bSkip)
+            {
+                ++m_RunningCount;
+                m_Stats.PeakRunning = (std::max)(m_Stats.PeakRunning, m_RunningCount);
+            }
+        }
+
+        std::exception_ptr Error;
+        if (!bSkip)
+        {
+            try
+            {
+                m_Tasks[id].Func();
+            }
+            catch (...)
+            {
+                Error = std::current_exception();
+            }
+        }
+
+        std::vector<TaskId> Ready;
+        {
+            std::lock_guard<std::mutex> Lock(m_Mutex);
+
+            if (bSkip)
+                ++m_Stats.SkippedCount;
+            else
+                --m_RunningCount;
+
+            if (Error && !m_Error)
+                m_Error = Error;
+
+            for (TaskId Dependent : m_Tasks[id].Dependents)
+            {
+                if (bSkip || Error)
+                    m_Blocked[Dependent] = true;
+                if (--m_Remaining[Dependent] == 0)
+                    Ready.push_back(Dependent);
+            }
+
+            // Notify under the lock: once Run sees the last task finish it may return, and
+            // nothing here may touch the graph after that.
+            if (++m_FinishedCount == m_Tasks.size())
+                m_Condition.notify_all();
+        }
+
+        if (pool != nullptr)
+        {
+            for (TaskId Next : Ready)
+            {
+                Submit(*pool, Next);
+            }
+        }
+    }
+
+private:
+    std::vector<Task> m_Tasks;
+
+    // State of the current run.
+    std::vector<std::size_t> m_Remaining;
+    std::vector<bool> m_Blocked;
+    std::size_t m_FinishedCount = 0;
+    std::size_t m_RunningCount = 0;
+    std::exception_ptr m_Error;
+
+    std::mutex m_Mutex;
+    std::condition_variable m_Condition;
+
+    TaskGraphStats m_Stats;
+};
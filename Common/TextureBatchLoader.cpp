@@ -0,0 +1,258 @@
+#include "TextureBatchLoader.h"
+#include <chrono>
+
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+    void ThrowLoadError(HRESULT hr, const std::wstring& fileName, int lineNumber)
+    {
+        throw DxException(hr, L"TextureBatchLoader: " + fileName, AnsiToWString(__FILE__), lineNumber);
+    }
+
+    HRESULT StatusToHRESULT(DDS::Status status)
+    {
+        switch (status)
+        {
+        case DDS::Status::Ok:           return S_OK;
+        case DDS::Status::InvalidData:  return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+        case DDS::Status::NotSupported: return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+        case DDS::Status::EndOfFile:    return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+        default:                        return E_FAIL;
+        }
+    }
+}
+
+UINT TextureBatchLoader::Add(const std::wstring& fileName, UINT maxSize)
+{
+    Entry NewEntry;
+    NewEntry.FileName = fileName;
+    NewEntry.MaxSize = maxSize;
+    m_Entries.push_back(std::move(NewEntry));
+
+    return (UINT)m_Entries.size() - 1;
+}
+
+void TextureBatchLoader::Execute(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, ThreadPool& pool)
+{
+    m_Stats = TextureBatchStats();
+    m_Stats.TextureCount = (UINT)m_Entries.size();
+
+    if (m_Entries.empty())
+        return;
+
+    auto StartTime = std::chrono::high_resolution_clock::now();
+
+    // 1. Map, validate and create the textures in parallel.
+    pool.ParallelFor(m_Entries.size(), [&](size_t i) { LoadEntry(device, m_Entries[i]); });
+
+    // 2. Place every texture in one staging buffer.
+    UINT64 StagingSize = 0;
+    for (Entry& E : m_Entries)
+    {
+        StagingSize = d3dUtil::AlignUp(StagingSize, (UINT64)D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+        E.StagingOffset = StagingSize;
+        StagingSize += E.StagingSize;
+
+        for (D3D12_PLACED_SUBRESOURCE_FOOTPRINT& Footprint : E.Footprints)
+        {
+            Footprint.Offset += E.StagingOffset;
+        }
+
+        m_Stats.SubresourceCount += (UINT)E.Footprints.size();
+        m_Stats.FileBytes += E.View.BitSize;
+    }
+
+    m_Stats.StagingBytes = StagingSize;
+
+    ThrowIfFailed(device->CreateCommittedResource(
+        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+        D3D12_HEAP_FLAG_NONE,
+        &CD3DX12_RESOURCE_DESC::Buffer(StagingSize),
+        D3D12_RESOURCE_STATE_GENERIC_READ,
+        nullptr,
+        IID_PPV_ARGS(&m_Staging)));
+
+    auto ParsedTime = std::chrono::high_resolution_clock::now();
+
+    // 3. Copy texels straight from the file mappings into the staging buffer.
+    BYTE* MappedStaging = nullptr;
+    ThrowIfFailed(m_Staging->Map(0, nullptr, reinterpret_cast<void**>(&MappedStaging)));
+
+    pool.ParallelFor(m_Entries.size(), [&](size_t i) { CopyEntry(m_Entries[i], MappedStaging); });
+
+    m_Staging->Unmap(0, nullptr);
+
+    // 4. Record all copies, then transition every texture with one barrier call.
+    std::vector<D3D12_RESOURCE_BARRIER> Barriers;
+    Barriers.reserve(m_Entries.size());
+
+    for (Entry& E : m_Entries)
+    {
+        for (UINT i = 0; i < (UINT)E.Footprints.size(); ++i)
+        {
+            CD3DX12_TEXTURE_COPY_LOCATION Dst(E.Resource.Get(), i);
+            CD3DX12_TEXTURE_COPY_LOCATION Src(m_Staging.Get(), E.Footprints[i]);
+            cmdList->CopyTextureRegion(&Dst, 0, 0, 0, &Src, nullptr);
+        }
+
+        Barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(E.Resource.Get(),
+            D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
+
+        // The texels now live in the staging buffer.
+        E.File.Close();
+        E.View = DDS::FileView();
+    }
+
+    cmdList->ResourceBarrier((UINT)Barriers.size(), Barriers.data());
+
+    auto EndTime = std::chrono::high_resolution_clock::now();
+
+    m_Stats.ParseMilliseconds = std::chrono::duration<double, std::milli>(ParsedTime - StartTime).count();
+    m_Stats.CopyMilliseconds = std::chrono::duration<double, std::milli>(EndTime - ParsedTime).count();
+}
+
+ComPtr<ID3D12Resource> TextureBatchLoader::GetResource(UINT index)const
+{
+    return m_Entries[index].Resource;
+}
+
+void TextureBatchLoader::ReleaseStaging()
+{
+    m_Staging = nullptr;
+
+    for (Entry& E : m_Entries)
+    {
+        E.Footprints.clear();
+        E.Footprints.shrink_to_fit();
+        E.NumRows.clear();
+        E.NumRows.shrink_to_fit();
+        E.RowSizes.clear();
+        E.RowSizes.shrink_to_fit();
+        E.Layout.clear();
+        E.Layout.shrink_to_fit();
+    }
+}
+
+void TextureBatchLoader::LoadEntry(ID3D12Device* device, Entry& entry)
+{
+    if (!entry.File.Open(entry.FileName))
+        ThrowLoadError(HRESULT_FROM_WIN32(GetLastError()), entry.FileName, __LINE__);
+
+    HRESULT hr = StatusToHRESULT(DDS::ParseHeader(entry.File.GetData(), entry.File.GetSize(), entry.View));
+    if (SUCCEEDED(hr))
+        hr = StatusToHRESULT(DDS::GetTextureDesc(entry.View, entry.Desc));
+    if (SUCCEEDED(hr))
+        hr = StatusToHRESULT(DDS::GetSubresourceLayout(entry.Desc, entry.View.BitSize, entry.Layout));
+    if (SUCCEEDED(hr) && entry.Desc.MipCount > D3D12_REQ_MIP_LEVELS)
+        hr = HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+
+    if (FAILED(hr))
+        ThrowLoadError(hr, entry.FileName, __LINE__);
+
+    // Skip the mips above MaxSize, always keeping at least the last one.
+    const DDS::TextureDesc& Desc = entry.Desc;
+    entry.FirstMip = 0;
+    if (entry.MaxSize > 0)
+    {
+        while (entry.FirstMip + 1 < Desc.MipCount &&
+            (entry.Layout[entry.FirstMip].Width > entry.MaxSize || entry.Layout[entry.FirstMip].Height > entry.MaxSize))
+        {
+            ++entry.FirstMip;
+        }
+    }
+
+    const DDS::Subresource& Top = entry.Layout[entry.FirstMip];
+
+    D3D12_RESOURCE_DESC TexDesc;
+    ZeroMemory(&TexDesc, sizeof(D3D12_RESOURCE_DESC));
+    TexDesc.Dimension = (D3D12_RESOURCE_DIMENSION)Desc.Dimension;
+    TexDesc.Alignment = 0;
+    TexDesc.Width = Top.Width;
+    TexDesc.Height = Top.Height;
+    TexDesc.DepthOrArraySize = (UINT16)(Desc.Dimension == DDS_DIMENSION_TEXTURE3D ? Top.Depth : Desc.ArraySize);
+    TexDesc.MipLevels = (UINT16)(Desc.MipCount - entry.FirstMip);
+    TexDesc.Format = Desc.Format;
+    TexDesc.SampleDesc.Count = 1;
+    TexDesc.SampleDesc.Quality = 0;
+    TexDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+    TexDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+    // Resource creation is free-threaded, and the allocator locks its own heaps.
+    if (m_Allocator != nullptr)
+    {
+        hr = m_Allocator->CreateResource(
+            D3D12_HEAP_TYPE_DEFAULT,
+            TexDesc,
+            D3D12_RESOURCE_STATE_COPY_DEST,
+            nullptr,
+            IID_PPV_ARGS(&entry.Resource));
+    }
+    else
+    {
+        hr = device->CreateCommittedResource(
+            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+            D3D12_HEAP_FLAG_NONE,
+            &TexDesc,
+            D3D12_RESOURCE_STATE_COPY_DEST,
+            nullptr,
+            IID_PPV_ARGS(&entry.Resource));
+    }
+    if (FAILED(hr))
+        ThrowLoadError(hr, entry.FileName, __LINE__);
+
+    const UINT NumSubresources = Desc.ArraySize * TexDesc.MipLevels;
+    entry.Footprints.resize(NumSubresources);
+    entry.NumRows.resize(NumSubresources);
+    entry.RowSizes.resize(NumSubresources);
+
+    device->GetCopyableFootprints(&TexDesc, 0, NumSubresources, 0,
+        entry.Footprints.data(), entry.NumRows.data(), entry.RowSizes.data(), &entry.StagingSize);
+}
+
+void TextureBatchLoader::CopyEntry(const Entry& entry, BYTE* mappedStaging)
+{
+    const UINT MipLevels = entry.Desc.MipCount - entry.FirstMip;
+
+    for (size_t i = 0; i < entry.Footprints.size(); ++i)
+    {
+        // Footprints only cover the loaded mips of every array slice.
+        const size_t Slice = i / MipLevels;
+        const size_t Mip = entry.FirstMip + i % MipLevels;
+        const DDS::Subresource& Source = entry.Layout[Slice * entry.Desc.MipCount + Mip];
+
+        CopySubresource(entry.View.BitData + Source.Offset, Source,
+            mappedStaging + entry.Footprints[i].Offset, entry.Footprints[i].Footprint,
+            entry.NumRows[i], entry.RowSizes[i]);
+    }
+}
+
+void TextureBatchLoader::CopySubresource(
+    const BYTE* srcBits,
+    const DDS::Subresource& source,
+    BYTE* dstBits,
+    const D3D12_SUBRESOURCE_FOOTPRINT& footprint,
+    UINT numRows,
+    UINT64 rowSize)
+{
+    const SIZE_T DstRowPitch = footprint.RowPitch;
+    const SIZE_T DstSlicePitch = DstRowPitch * numRows;
+
+    for (UINT z = 0; z < footprint.Depth; ++z)
+    {
+        const BYTE* SrcSlice = srcBits + source.SlicePitch * z;
+        BYTE* DstSlice = dstBits + DstSlicePitch * z;
+
+        // Tightly packed rows (most mips wider than 256 bytes) copy in one go.
+        if (DstRowPitch == source.RowPitch)
+        {
+            memcpy(DstSlice, SrcSlice, (SIZE_T)rowSize * numRows);
+            continue;
+        }
+
+        for (UINT y = 0; y < numRows; ++y)
+        {
+            memcpy(DstSlice + DstRowPitch * y, SrcSlice + source.RowPitch * y, (SIZE_T)rowSize);
+        }
+    }
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "d3dUtil.h"
+#include "DDSHeader.h"
+#include "GpuMemoryAllocator.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+
+struct TextureBatchStats
+{
+    UINT TextureCount = 0;
+    UINT SubresourceCount = 0;
+
+    // Bytes of pixel data read from the files.
+    UINT64 FileBytes = 0;
+
+    // Size of the single staging buffer (footprints include row pitch padding).
+    UINT64 StagingBytes = 0;
+
+    double ParseMilliseconds = 0.0;
+    double CopyMilliseconds = 0.0;
+};
+
+// Loads a batch of DDS files into default-heap textures.
+// Files are mapped and validated on the worker pool, every subresource is packed into
+// one upload buffer and all copies are recorded on a single command list.
+class TextureBatchLoader
+{
+public:
+    // Returns the index to pass to GetResource.  With maxSize set, mips larger than
+    // maxSize are skipped and the texture starts at the first smaller mip.
+    UINT Add(const std::wstring& fileName, UINT maxSize = 0);
+
+    // Textures are placed in the allocator's heaps when set, otherwise created committed.
+    void SetAllocator(GpuMemoryAllocator* allocator) { m_Allocator = allocator; }
+
+    // Throws DxException if a file is missing or not a supported DDS.
+    void Execute(ID3D12Device* device, ID3D12GraphicsCommandList* cmdList, ThreadPool& pool);
+
+    Microsoft::WRL::ComPtr<ID3D12Resource> GetResource(UINT index)const;
+
+    // Mip of the file that became mip 0 of the resource.
+    UINT GetFirstMip(UINT index)const { return m_Entries[index].FirstMip; }
+
+    // Call after the fence covering the recorded copies has been reached.
+    void ReleaseStaging();
+
+    const TextureBatchStats& GetStats()const { return m_Stats; }
+
+    // Copies one DDS subresource into an upload footprint, padding rows to its pitch.
+    static void CopySubresource(
+        const BYTE* srcBits,
+        const DDS::Subresource& source,
+        BYTE* dstBits,
+        const D3D12_SUBRESOURCE_FOOTPRINT& footprint,
+        UINT numRows,
+        UINT64 rowSize);
+
+private:
+    struct Entry
+    {
+        std::wstring FileName;
+        MappedFile File;
+        DDS::FileView View;
+        DDS::TextureDesc Desc;
+        std::vector<DDS::Subresource> Layout;
+
+        UINT MaxSize = 0;
+        UINT FirstMip = 0;
+
+        Microsoft::WRL::ComPtr<ID3D12Resource> Resource;
+
+        // Copyable footprints, offsets are relative to StagingOffset until Execute
+        // places the entry in the staging buffer.
+        std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> Footprints;
+        std::vector<UINT> NumRows;
+        std::vector<UINT64> RowSizes;
+
+        UINT64 StagingOffset = 0;
+        UINT64 StagingSize = 0;
+    };
+
+    void LoadEntry(ID3D12Device* device, Entry& entry);
+    void CopyEntry(const Entry& entry, BYTE* mappedStaging);
+
+private:
+    std::vector<Entry> m_Entries;
+
+    GpuMemoryAllocator* m_Allocator = nullptr;
+
+    Microsoft::WRL::ComPtr<ID3D12Resource> m_Staging;
+
+    TextureBatchStats m_Stats;
+};
@@ -0,0 +1,143 @@
+#include "TexturePackManifest.h"
+#include "MappedFile.h"
+
+#include <cctype>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+    std::string GetLowerFileName(const std::string& path)
+    {
+        const size_t Slash = path.find_last_of("/\\");
+        std::string Name = Slash == std::string::npos ? path : path.substr(Slash + 1);
+
+        for (char& c : Name)
+        {
+            c = (char)tolower((unsigned char)c);
+        }
+        return Name;
+    }
+}
+
+bool TexturePackManifest::Load(const std::wstring& fileName)
+{
+    Clear();
+
+    MappedFile File;
+    return File.Open(fileName) && Parse(reinterpret_cast<const char*>(File.GetData()), File.GetSize());
+}
+
+bool TexturePackManifest::Load(const std::string& fileName)
+{
+    Clear();
+
+    MappedFile File;
+    return File.Open(fileName) && Parse(reinterpret_cast<const char*>(File.GetData()), File.GetSize());
+}
+
+bool TexturePackManifest::Save(const std::string& fileName)const
+{
+    std::ofstream Output(fileName);
+    if (!Output)
+        return false;
+
+    // Enough digits for the floats to read back exactly.
+    Output.precision(9);
+    Output << "# TextureTool pack manifest\n";
+
+    for (const std::string& Pack : m_Packs)
+    {
+        Output << "pack " << Pack << "\n";
+    }
+
+    for (const TexturePackPlacement& Placement : m_Placements)
+    {
+        Output << "texture " << Placement.SourceName << " " << Placement.PackIndex << " " << Placement.Slice << " "
+            << Placement.Scale[0] << " " << Placement.Scale[1] << " " << Placement.Bias[0] << " " << Placement.Bias[1] << "\n";
+    }
+
+    return (bool)Output;
+}
+
+void TexturePackManifest::Clear()
+{
+    m_Packs.clear();
+    m_Placements.clear();
+}
+
+uint32_t TexturePackManifest::AddPack(const std::string& fileName)
+{
+    m_Packs.push_back(fileName);
+    return (uint32_t)m_Packs.size() - 1;
+}
+
+void TexturePackManifest::AddPlacement(const TexturePackPlacement& placement)
+{
+    m_Placements.push_back(placement);
+}
+
+const TexturePackPlacement* TexturePackManifest::Find(const std::string& fileName)const
+{
+    const std::string Name = GetLowerFileName(fileName);
+
+    for (const TexturePackPlacement& Placement : m_Placements)
+    {
+        if (GetLowerFileName(Placement.SourceName) == Name)
+            return &Placement;
+    }
+    return nullptr;
+}
+
+const TexturePackPlacement* TexturePackManifest::Find(const std::wstring& fileName)const
+{
+    // Texture paths in this project are ASCII.
+    std::string Narrow;
+    Narrow.reserve(fileName.size());
+    for (wchar_t c : fileName)
+    {
+        Narrow.push_back(c < 0x80 ? (char)c : '?');
+    }
+    return Find(Narrow);
+}
+
+bool TexturePackManifest::Parse(const char* text, size_t size)
+{
+    std::istringstream Input(std::string(text, size));
+
+    for (std::string Line; std::getline(Input, Line);)
+    {
+        std::istringstream Fields(Line);
+
+        std::string Keyword;
+        if (!(Fields >> Keyword) || Keyword[0] == '#')
+            continue;
+
+        if (Keyword == "pack")
+        {
+            std::string Pack;
+            if (!(Fields >> Pack))
+                return false;
+
+            m_Packs.push_back(Pack);
+        }
+        else if (Keyword == "texture")
+        {
+            TexturePackPlacement Placement;
+            if (!(Fields >> Placement.SourceName >> Placement.PackIndex >> Placement.Slice
+                >> Placement.Scale[0] >> Placement.Scale[1] >> Placement.Bias[0] >> Placement.Bias[1]))
+                return false;
+
+            if (Placement.PackIndex >= m_Packs.size())
+                return false;
+
+            m_Placements.push_back(Placement);
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
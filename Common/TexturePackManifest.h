@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Where a source texture ended up after TextureTool's pack step.  Sample the pack with
+// float3(uv * Scale + Bias, Slice); array slices have Scale 1 and Bias 0.
+struct TexturePackPlacement
+{
+    std::string SourceName;     // file name only, e.g. "bricks.dds"
+    uint32_t PackIndex = 0;
+    uint32_t Slice = 0;
+    float Scale[2] = { 1.0f, 1.0f };
+    float Bias[2] = { 0.0f, 0.0f };
+};
+
+// Text manifest written next to the packed textures:
+//
+//   pack <file>
+//   texture <source> <pack index> <slice> <scale u> <scale v> <bias u> <bias v>
+//
+// Packs are listed in the order they should take descriptor heap slots.  A normal map pack
+// directly follows the colour pack it pairs with, with the same slices and layout, so a
+// material's [diffuse, normal] table stays two consecutive descriptors.
+class TexturePackManifest
+{
+public:
+    bool Load(const std::wstring& fileName);
+    bool Load(const std::string& fileName);
+    bool Save(const std::string& fileName)const;
+
+    void Clear();
+
+    uint32_t AddPack(const std::string& fileName);
+    void AddPlacement(const TexturePackPlacement& placement);
+
+    const std::vector<std::string>& GetPacks()const { return m_Packs; }
+    const std::vector<TexturePackPlacement>& GetPlacements()const { return m_Placements; }
+
+    // Looks a source up by file name, ignoring any directory and case.  nullptr if it was
+    // not packed.
+    const TexturePackPlacement* Find(const std::string& fileName)const;
+    const TexturePackPlacement* Find(const std::wstring& fileName)const;
+
+private:
+    bool Parse(const char* text, size_t size);
+
+private:
+    std::vector<std::string> m_Packs;
+    std::vector<TexturePackPlacement> m_Placements;
+};
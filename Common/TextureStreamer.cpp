@@ -0,0 +1,226 @@
+#include "TextureStreamer.h"
+#include "TextureBatchLoader.h"
+#include <chrono>
+
+using Microsoft::WRL::ComPtr;
+
+TextureStreamer::~TextureStreamer()
+{
+    // Workers still reference the file mappings.
+    for (StreamedTexture& Texture : m_Textures)
+    {
+        if (Texture.Load->State == JobState::Running && Texture.Load->Done.valid())
+            Texture.Load->Done.wait();
+    }
+}
+
+UINT TextureStreamer::Register(const std::wstring& fileName, ComPtr<ID3D12Resource> resource, UINT residentMip)
+{
+    StreamedTexture Texture;
+    Texture.FileName = fileName;
+    Texture.Resource = resource;
+    Texture.Load = std::make_unique<Job>();
+
+    if (!Texture.File.Open(fileName))
+        throw DxException(HRESULT_FROM_WIN32(GetLastError()), L"TextureStreamer: " + fileName, AnsiToWString(__FILE__), __LINE__);
+
+    if (DDS::ParseHeader(Texture.File.GetData(), Texture.File.GetSize(), Texture.View) != DDS::Status::Ok ||
+        DDS::GetTextureDesc(Texture.View, Texture.Desc) != DDS::Status::Ok ||
+        DDS::GetSubresourceLayout(Texture.Desc, Texture.View.BitSize, Texture.Layout) != DDS::Status::Ok)
+    {
+        throw DxException(HRESULT_FROM_WIN32(ERROR_INVALID_DATA), L"TextureStreamer: " + fileName, AnsiToWString(__FILE__), __LINE__);
+    }
+
+    StreamingTextureDesc Desc;
+    Desc.Width = Texture.Desc.Width;
+    Desc.Height = Texture.Desc.Height;
+    Desc.TailMip = residentMip;
+    Desc.MipBytes.assign(Texture.Desc.MipCount, 0);
+
+    // Layout is slice-major: every array slice lists all of its mips.
+    for (size_t i = 0; i < Texture.Layout.size(); ++i)
+    {
+        const DDS::Subresource& Source = Texture.Layout[i];
+        Desc.MipBytes[i % Texture.Desc.MipCount] += Source.SlicePitch * Source.Depth;
+    }
+
+    m_Textures.push_back(std::move(Texture));
+    m_Policy.AddTexture(Desc);
+
+    return (UINT)m_Textures.size() - 1;
+}
+
+void TextureStreamer::Update(
+    ID3D12Device* device,
+    ID3D12GraphicsCommandList* cmdList,
+    ThreadPool& pool,
+    UploadRing& ring,
+    UINT64 completedFence,
+    UINT64 frameFence,
+    std::vector<UINT>& outChanged)
+{
+    // 1. Free what the GPU no longer reads.
+    if (m_Allocator != nullptr)
+    {
+        for (const RetiredResource& Retired : m_Retired)
+        {
+            if (Retired.FenceValue <= completedFence)
+                m_Allocator->Release(Retired.Resource.Get());
+        }
+    }
+    m_Retired.erase(std::remove_if(m_Retired.begin(), m_Retired.end(),
+        [completedFence](const RetiredResource& Retired) { return Retired.FenceValue <= completedFence; }),
+        m_Retired.end());
+
+    // 2. Swap in finished loads.
+    std::vector<D3D12_RESOURCE_BARRIER> Barriers;
+
+    for (UINT i = 0; i < (UINT)m_Textures.size(); ++i)
+    {
+        StreamedTexture& Texture = m_Textures[i];
+        Job& Finished = *Texture.Load;
+        if (Finished.State != JobState::Running || Finished.Done.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            continue;
+
+        // Rethrows a DxException raised on the worker.
+        Finished.Done.get();
+
+        for (UINT j = 0; j < Finished.SubresourceCount; ++j)
+        {
+            CD3DX12_TEXTURE_COPY_LOCATION Dst(Finished.Resource.Get(), j);
+            CD3DX12_TEXTURE_COPY_LOCATION Src(Finished.Upload.Resource, Finished.Footprints[j]);
+            cmdList->CopyTextureRegion(&Dst, 0, 0, 0, &Src, nullptr);
+        }
+
+        Barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(Finished.Resource.Get(),
+            D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE));
+
+        ring.Retire(Finished.Upload, frameFence);
+        m_Retired.push_back({ Texture.Resource, frameFence });
+
+        Texture.Resource = Finished.Resource;
+        Finished.Resource = nullptr;
+        Finished.State = JobState::Idle;
+        m_Policy.OnRequestCompleted(i, Finished.FirstMip);
+
+        outChanged.push_back(i);
+    }
+
+    if (!Barriers.empty())
+        cmdList->ResourceBarrier((UINT)Barriers.size(), Barriers.data());
+
+    // 3. Queue the loads the policy asks for.
+    m_Requests.clear();
+    m_Policy.Update(m_Requests);
+
+    for (const StreamingRequest& Request : m_Requests)
+    {
+        Job& NewJob = *m_Textures[Request.Texture].Load;
+        NewJob.FirstMip = Request.FirstMip;
+        NewJob.State = JobState::Waiting;
+    }
+
+    // 4. Start queued loads while the upload ring has room; the rest wait for the GPU to
+    // release ring space in a later frame.
+    for (StreamedTexture& Texture : m_Textures)
+    {
+        Job& Waiting = *Texture.Load;
+        if (Waiting.State != JobState::Waiting)
+            continue;
+
+        // Waiting cannot help a load bigger than the whole ring.
+        const UINT64 UploadSize = PrepareJob(device, Texture, Waiting);
+        if (UploadSize > ring.GetCapacity())
+            throw DxException(E_OUTOFMEMORY, L"TextureStreamer: upload ring too small for " + Texture.FileName, AnsiToWString(__FILE__), __LINE__);
+
+        if (!ring.Allocate(UploadSize, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT, Waiting.Upload))
+        {
+            ++m_DeferredLoads;
+            break;
+        }
+
+        for (UINT j = 0; j < Waiting.SubresourceCount; ++j)
+        {
+            Waiting.Footprints[j].Offset += Waiting.Upload.Offset;
+        }
+
+        // Textures are only registered at startup, so the references stay valid.
+        Waiting.State = JobState::Running;
+        Job* NewJob = &Waiting;
+        const StreamedTexture* Source = &Texture;
+        GpuMemoryAllocator* Allocator = m_Allocator;
+        NewJob->Done = pool.Submit([device, Allocator, Source, NewJob]() { LoadMips(device, Allocator, *Source, *NewJob); });
+    }
+}
+
+UINT64 TextureStreamer::PrepareJob(ID3D12Device* device, const StreamedTexture& texture, Job& job)
+{
+    const DDS::TextureDesc& Desc = texture.Desc;
+    const DDS::Subresource& Top = texture.Layout[job.FirstMip];
+
+    D3D12_RESOURCE_DESC& TexDesc = job.Desc;
+    ZeroMemory(&TexDesc, sizeof(D3D12_RESOURCE_DESC));
+    TexDesc.Dimension = (D3D12_RESOURCE_DIMENSION)Desc.Dimension;
+    TexDesc.Alignment = 0;
+    TexDesc.Width = Top.Width;
+    TexDesc.Height = Top.Height;
+    TexDesc.DepthOrArraySize = (UINT16)(Desc.Dimension == DDS_DIMENSION_TEXTURE3D ? Top.Depth : Desc.ArraySize);
+    TexDesc.MipLevels = (UINT16)(Desc.MipCount - job.FirstMip);
+    TexDesc.Format = Desc.Format;
+    TexDesc.SampleDesc.Count = 1;
+    TexDesc.SampleDesc.Quality = 0;
+    TexDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+    TexDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+    // The footprint arrays belong to the texture and only grow, so a load allocates nothing.
+    job.SubresourceCount = Desc.ArraySize * TexDesc.MipLevels;
+    if (job.Footprints.size() < job.SubresourceCount)
+    {
+        job.Footprints.resize(job.SubresourceCount);
+        job.NumRows.resize(job.SubresourceCount);
+        job.RowSizes.resize(job.SubresourceCount);
+    }
+
+    UINT64 UploadSize = 0;
+    device->GetCopyableFootprints(&TexDesc, 0, job.SubresourceCount, 0,
+        job.Footprints.data(), job.NumRows.data(), job.RowSizes.data(), &UploadSize);
+
+    return UploadSize;
+}
+
+void TextureStreamer::LoadMips(ID3D12Device* device, GpuMemoryAllocator* allocator, const StreamedTexture& texture, Job& job)
+{
+    if (allocator != nullptr)
+    {
+        ThrowIfFailed(allocator->CreateResource(
+            D3D12_HEAP_TYPE_DEFAULT,
+            job.Desc,
+            D3D12_RESOURCE_STATE_COPY_DEST,
+            nullptr,
+            IID_PPV_ARGS(&job.Resource)));
+    }
+    else
+    {
+        ThrowIfFailed(device->CreateCommittedResource(
+            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+            D3D12_HEAP_FLAG_NONE,
+            &job.Desc,
+            D3D12_RESOURCE_STATE_COPY_DEST,
+            nullptr,
+            IID_PPV_ARGS(&job.Resource)));
+    }
+
+    // Footprint offsets already include the ring offset, so they index the mapped ring.
+    BYTE* MappedRing = job.Upload.CpuAddress - job.Upload.Offset;
+    const UINT MipLevels = job.Desc.MipLevels;
+
+    for (UINT i = 0; i < job.SubresourceCount; ++i)
+    {
+        const UINT Slice = i / MipLevels;
+        const UINT Mip = job.FirstMip + i % MipLevels;
+        const DDS::Subresource& Source = texture.Layout[Slice * texture.Desc.MipCount + Mip];
+
+        TextureBatchLoader::CopySubresource(texture.View.BitData + Source.Offset, Source,
+            MappedRing + job.Footprints[i].Offset, job.Footprints[i].Footprint, job.NumRows[i], job.RowSizes[i]);
+    }
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "d3dUtil.h"
+#include "DDSHeader.h"
+#include "GpuMemoryAllocator.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+#include "TextureStreamingPolicy.h"
+#include "UploadRing.h"
+
+// Applies TextureStreamingPolicy decisions to D3D12 textures.
+// Every streamed texture keeps its DDS file mapped.  A request reserves space in the
+// upload ring, builds a new texture holding mips FirstMip..last on the worker pool, fills
+// the ring space straight from the mapping, and swaps the texture in once the copy is
+// recorded on the frame's command list.  Requests wait while the ring is full.
+class TextureStreamer
+{
+public:
+    TextureStreamer() = default;
+    ~TextureStreamer();
+
+    TextureStreamer(const TextureStreamer&) = delete;
+    TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+    // resource holds the file's mips from residentMip down, already in PIXEL_SHADER_RESOURCE.
+    // The resident mips become the tail that is never evicted.
+    UINT Register(const std::wstring& fileName, Microsoft::WRL::ComPtr<ID3D12Resource> resource, UINT residentMip);
+
+    void SetBudget(UINT64 bytes) { m_Policy.SetBudget(bytes); }
+
+    // New mip chains are placed in the allocator's heaps when set, and retired textures
+    // are given back to it.  Set before the first Update.
+    void SetAllocator(GpuMemoryAllocator* allocator) { m_Allocator = allocator; }
+
+    void BeginFrame() { m_Policy.BeginFrame(); }
+    void RequestFootprint(UINT texture, float screenTexels) { m_Policy.RequestFootprint(texture, screenTexels); }
+
+    // Records copies for finished loads and starts new ones.
+    // completedFence: last value the queue has reached.
+    // frameFence: value signalled after cmdList executes; guards the textures and ring
+    // space retired here.
+    // outChanged receives textures whose resource was replaced and need a new SRV.
+    void Update(
+        ID3D12Device* device,
+        ID3D12GraphicsCommandList* cmdList,
+        ThreadPool& pool,
+        UploadRing& ring,
+        UINT64 completedFence,
+        UINT64 frameFence,
+        std::vector<UINT>& outChanged);
+
+    ID3D12Resource* GetResource(UINT texture)const { return m_Textures[texture].Resource.Get(); }
+
+    const StreamingStats& GetStats()const { return m_Policy.GetStats(); }
+
+    // Times a queued load had to wait a frame for upload ring space.
+    UINT64 GetDeferredLoads()const { return m_DeferredLoads; }
+
+private:
+    enum class JobState
+    {
+        Idle,
+        Waiting,    // requested, no ring space yet
+        Running     // on the worker pool
+    };
+
+    // One per texture, reused by every load of it.
+    struct Job
+    {
+        JobState State = JobState::Idle;
+        UINT FirstMip = 0;
+
+        D3D12_RESOURCE_DESC Desc = {};
+        Microsoft::WRL::ComPtr<ID3D12Resource> Resource;
+        UploadRingAllocation Upload;
+
+        // Offsets are in the ring buffer.
+        UINT SubresourceCount = 0;
+        std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> Footprints;
+        std::vector<UINT> NumRows;
+        std::vector<UINT64> RowSizes;
+
+        std::future<void> Done;
+    };
+
+    struct StreamedTexture
+    {
+        std::wstring FileName;
+        MappedFile File;
+        DDS::FileView View;
+        DDS::TextureDesc Desc;
+        std::vector<DDS::Subresource> Layout;
+
+        Microsoft::WRL::ComPtr<ID3D12Resource> Resource;
+
+        std::unique_ptr<Job> Load;
+    };
+
+    struct RetiredResource
+    {
+        Microsoft::WRL::ComPtr<ID3D12Resource> Resource;
+        UINT64 FenceValue = 0;
+    };
+
+    // Fills job's description and footprints and returns the upload size.
+    static UINT64 PrepareJob(ID3D12Device* device, const StreamedTexture& texture, Job& job);
+    static void LoadMips(ID3D12Device* device, GpuMemoryAllocator* allocator, const StreamedTexture& texture, Job& job);
+
+private:
+    std::vector<StreamedTexture> m_Textures;
+
+    // Old textures wait here until the GPU is done with them.
+    std::vector<RetiredResource> m_Retired;
+
+    GpuMemoryAllocator* m_Allocator = nullptr;
+
+    TextureStreamingPolicy m_Policy;
+    std::vector<StreamingRequest> m_Requests;
+
+    UINT64 m_DeferredLoads = 0;
+};
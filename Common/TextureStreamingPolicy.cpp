@@ -0,0 +1,242 @@
+#include "TextureStreamingPolicy.h"
+
+#include <algorithm>
+
+std::uint32_t TextureStreamingPolicy::AddTexture(const StreamingTextureDesc& desc)
+{
+    TextureState Texture;
+    Texture.Desc = desc;
+    Texture.ResidentMip = desc.TailMip;
+    Texture.WantedMip = desc.TailMip;
+
+    m_Textures.push_back(Texture);
+    m_Stats.TextureCount = (std::uint32_t)m_Textures.size();
+    m_Stats.CommittedBytes += BytesFrom(Texture, desc.TailMip);
+
+    return (std::uint32_t)m_Textures.size() - 1;
+}
+
+void TextureStreamingPolicy::BeginFrame()
+{
+    ++m_FrameIndex;
+
+    for (TextureState& Texture : m_Textures)
+    {
+        Texture.WantedMip = Texture.Desc.TailMip;
+    }
+}
+
+void TextureStreamingPolicy::RequestFootprint(std::uint32_t texture, float screenTexels)
+{
+    TextureState& Texture = m_Textures[texture];
+
+    std::uint32_t Mip = ComputeWantedMip(Texture.Desc.Width, Texture.Desc.Height,
+        (std::uint32_t)Texture.Desc.MipBytes.size(), screenTexels);
+
+    Texture.WantedMip = (std::min)(Texture.WantedMip, Mip);
+    Texture.LastUsedFrame = m_FrameIndex;
+}
+
+void TextureStreamingPolicy::Update(std::vector<StreamingRequest>& outRequests)
+{
+    // A lowered budget is enforced before anything else, as far as the free request
+    // slots allow; the rest follows in later frames.
+    if (m_Stats.CommittedBytes > m_Stats.BudgetBytes)
+    {
+        std::vector<std::uint32_t> Victims;
+        SelectVictims(m_Stats.CommittedBytes - m_Stats.BudgetBytes, NoRequest, GetFreeRequestSlots(), Victims);
+        Evict(Victims, outRequests);
+    }
+
+    std::vector<std::uint32_t> Candidates;
+    for (std::uint32_t i = 0; i < (std::uint32_t)m_Textures.size(); ++i)
+    {
+        const TextureState& Texture = m_Textures[i];
+        if (Texture.PendingMip == NoRequest && Texture.WantedMip < Texture.ResidentMip)
+            Candidates.push_back(i);
+    }
+
+    // Blurriest first, then most recently used.  The index keeps the order deterministic.
+    std::sort(Candidates.begin(), Candidates.end(), [this](std::uint32_t a, std::uint32_t b)
+    {
+        const TextureState& A = m_Textures[a];
+        const TextureState& B = m_Textures[b];
+        std::uint32_t GapA = A.ResidentMip - A.WantedMip;
+        std::uint32_t GapB = B.ResidentMip - B.WantedMip;
+        if (GapA != GapB)
+            return GapA > GapB;
+        if (A.LastUsedFrame != B.LastUsedFrame)
+            return A.LastUsedFrame > B.LastUsedFrame;
+        return a < b;
+    });
+
+    for (std::uint32_t Index : Candidates)
+    {
+        if (m_Stats.PendingRequests >= m_MaxPendingRequests)
+            break;
+
+        const TextureState& Texture = m_Textures[Index];
+        const std::uint64_t CurrentBytes = BytesFrom(Texture, Texture.ResidentMip);
+
+        // Take the finest wanted mip that fits, possibly after evicting others.  Evictions
+        // are requests too, so they get the slots the upgrade itself leaves free.
+        bool bSubmitted = false;
+        for (std::uint32_t Mip = Texture.WantedMip; Mip < Texture.ResidentMip && !bSubmitted; ++Mip)
+        {
+            const std::uint64_t Needed = m_Stats.CommittedBytes + BytesFrom(Texture, Mip) - CurrentBytes;
+            if (Needed > m_Stats.BudgetBytes && !MakeRoom(Needed - m_Stats.BudgetBytes, Index, GetFreeRequestSlots() - 1, outRequests))
+                continue;
+
+            Submit(Index, Mip, outRequests);
+            ++m_Stats.Upgrades;
+            bSubmitted = true;
+        }
+
+        if (bSubmitted)
+            continue;
+
+        ++m_Stats.BudgetDenials;
+
+        // There may be enough to reclaim but too few free slots to do it in one frame.
+        // Start evicting for this texture, the blurriest, so it fits once those finish.
+        const std::uint64_t Needed = m_Stats.CommittedBytes + BytesFrom(Texture, Texture.ResidentMip - 1) - CurrentBytes - m_Stats.BudgetBytes;
+        std::vector<std::uint32_t> Victims;
+        if (SelectVictims(Needed, Index, UINT32_MAX, Victims) >= Needed)
+        {
+            Victims.resize((std::min)((std::uint32_t)Victims.size(), GetFreeRequestSlots()));
+            Evict(Victims, outRequests);
+        }
+        break;
+    }
+}
+
+void TextureStreamingPolicy::OnRequestCompleted(std::uint32_t texture, std::uint32_t firstMip)
+{
+    TextureState& Texture = m_Textures[texture];
+    Texture.ResidentMip = firstMip;
+
+    if (Texture.PendingMip == firstMip)
+    {
+        Texture.PendingMip = NoRequest;
+        --m_Stats.PendingRequests;
+    }
+}
+
+std::uint32_t TextureStreamingPolicy::ComputeWantedMip(std::uint32_t width, std::uint32_t height, std::uint32_t mipCount, float screenTexels)
+{
+    if (mipCount == 0)
+        return 0;
+
+    const std::uint32_t MaxDimension = (std::max)(width, height);
+
+    std::uint32_t Mip = 0;
+    while (Mip + 1 < mipCount && (float)(MaxDimension >> (Mip + 1)) >= screenTexels)
+    {
+        ++Mip;
+    }
+
+    return Mip;
+}
+
+float TextureStreamingPolicy::EstimateScreenTexels(float radius, float distance, float projScaleY, float viewportHeight, float uvScale)
+{
+    // Projected diameter in pixels.  Inside the sphere the object covers the screen.
+    distance = (std::max)(distance, radius);
+    if (distance <= 0.0f)
+        return viewportHeight * uvScale;
+
+    return radius * projScaleY * viewportHeight / distance * uvScale;
+}
+
+std::uint64_t TextureStreamingPolicy::BytesFrom(const TextureState& texture, std::uint32_t firstMip)const
+{
+    std::uint64_t Bytes = 0;
+    for (size_t i = firstMip; i < texture.Desc.MipBytes.size(); ++i)
+    {
+        Bytes += texture.Desc.MipBytes[i];
+    }
+
+    return Bytes;
+}
+
+std::uint32_t TextureStreamingPolicy::TargetMip(const TextureState& texture)const
+{
+    return texture.PendingMip != NoRequest ? texture.PendingMip : texture.ResidentMip;
+}
+
+void TextureStreamingPolicy::Submit(std::uint32_t texture, std::uint32_t firstMip, std::vector<StreamingRequest>& outRequests)
+{
+    TextureState& Texture = m_Textures[texture];
+
+    m_Stats.CommittedBytes -= BytesFrom(Texture, TargetMip(Texture));
+    m_Stats.CommittedBytes += BytesFrom(Texture, firstMip);
+
+    if (Texture.PendingMip == NoRequest)
+        ++m_Stats.PendingRequests;
+    Texture.PendingMip = firstMip;
+
+    StreamingRequest Request;
+    Request.Texture = texture;
+    Request.FirstMip = firstMip;
+    outRequests.push_back(Request);
+}
+
+std::uint32_t TextureStreamingPolicy::GetFreeRequestSlots()const
+{
+    return m_Stats.PendingRequests < m_MaxPendingRequests ? m_MaxPendingRequests - m_Stats.PendingRequests : 0;
+}
+
+std::uint64_t TextureStreamingPolicy::SelectVictims(std::uint64_t bytes, std::uint32_t exclude, std::uint32_t maxCount, std::vector<std::uint32_t>& outVictims)const
+{
+    // Victims: idle textures holding top mips the current frame does not need.
+    std::vector<std::uint32_t> Candidates;
+    for (std::uint32_t i = 0; i < (std::uint32_t)m_Textures.size(); ++i)
+    {
+        const TextureState& Texture = m_Textures[i];
+        if (i == exclude || Texture.PendingMip != NoRequest || Texture.WantedMip <= Texture.ResidentMip)
+            continue;
+
+        Candidates.push_back(i);
+    }
+
+    // Least recently used first.
+    std::sort(Candidates.begin(), Candidates.end(), [this](std::uint32_t a, std::uint32_t b)
+    {
+        if (m_Textures[a].LastUsedFrame != m_Textures[b].LastUsedFrame)
+            return m_Textures[a].LastUsedFrame < m_Textures[b].LastUsedFrame;
+        return a < b;
+    });
+
+    std::uint64_t Freed = 0;
+    for (std::uint32_t Index : Candidates)
+    {
+        if (Freed >= bytes || outVictims.size() >= maxCount)
+            break;
+
+        const TextureState& Texture = m_Textures[Index];
+        Freed += BytesFrom(Texture, Texture.ResidentMip) - BytesFrom(Texture, Texture.WantedMip);
+        outVictims.push_back(Index);
+    }
+
+    return Freed;
+}
+
+void TextureStreamingPolicy::Evict(const std::vector<std::uint32_t>& victims, std::vector<StreamingRequest>& outRequests)
+{
+    // WantedMip never goes past the tail, so the tail stays resident.
+    for (std::uint32_t Index : victims)
+    {
+        Submit(Index, m_Textures[Index].WantedMip, outRequests);
+        ++m_Stats.Evictions;
+    }
+}
+
+bool TextureStreamingPolicy::MakeRoom(std::uint64_t bytes, std::uint32_t exclude, std::uint32_t maxVictims, std::vector<StreamingRequest>& outRequests)
+{
+    std::vector<std::uint32_t> Victims;
+    if (SelectVictims(bytes, exclude, maxVictims, Victims) < bytes)
+        return false;
+
+    Evict(Victims, outRequests);
+    return true;
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Per-texture data the streaming policy needs.  Mip 0 is the most detailed level.
+struct StreamingTextureDesc
+{
+    std::uint32_t Width = 0;
+    std::uint32_t Height = 0;
+
+    // First mip of the tail that is loaded at startup and never evicted.
+    std::uint32_t TailMip = 0;
+
+    // Bytes of every mip level, summed over array slices.
+    std::vector<std::uint64_t> MipBytes;
+};
+
+// Make texture resident from FirstMip down to the last mip.
+struct StreamingRequest
+{
+    std::uint32_t Texture = 0;
+    std::uint32_t FirstMip = 0;
+};
+
+struct StreamingStats
+{
+    std::uint64_t BudgetBytes = 0;
+
+    // Bytes of resident mips, counting in-flight requests at their target size.
+    std::uint64_t CommittedBytes = 0;
+
+    std::uint32_t TextureCount = 0;
+    std::uint32_t PendingRequests = 0;
+
+    // Totals since startup.
+    std::uint64_t Upgrades = 0;
+    std::uint64_t Evictions = 0;
+    std::uint64_t BudgetDenials = 0;
+};
+
+// Decides which mips of which textures should be resident.  Has no graphics API
+// dependency so the decisions can be driven from a headless simulation.
+//
+// Each frame the caller reports how many texels every visible texture needs on screen.
+// Update() then upgrades the textures that look blurriest, within the budget, evicting
+// the top mips of the least recently used textures when it runs out of room.
+class TextureStreamingPolicy
+{
+public:
+    std::uint32_t AddTexture(const StreamingTextureDesc& desc);
+
+    void SetBudget(std::uint64_t bytes) { m_Stats.BudgetBytes = bytes; }
+    void SetMaxPendingRequests(std::uint32_t count) { m_MaxPendingRequests = count; }
+
+    // Textures not requested this frame fall back to their tail.
+    void BeginFrame();
+
+    // screenTexels: texels needed along the texture's largest axis to cover its
+    // screen footprint at one texel per pixel.
+    void RequestFootprint(std::uint32_t texture, float screenTexels);
+
+    void Update(std::vector<StreamingRequest>& outRequests);
+
+    // Called by the executor once the request has been applied.
+    void OnRequestCompleted(std::uint32_t texture, std::uint32_t firstMip);
+
+    std::uint32_t GetResidentMip(std::uint32_t texture)const { return m_Textures[texture].ResidentMip; }
+    std::uint32_t GetWantedMip(std::uint32_t texture)const { return m_Textures[texture].WantedMip; }
+    const StreamingStats& GetStats()const { return m_Stats; }
+
+    // Coarsest mip that still has at least screenTexels texels along the largest axis.
+    static std::uint32_t ComputeWantedMip(std::uint32_t width, std::uint32_t height, std::uint32_t mipCount, float screenTexels);
+
+    // Screen footprint of a bounding sphere, in texels along the largest texture axis.
+    // projScaleY is element [1][1] of the projection matrix, uvScale the texture
+    // coordinate tiling across the object.
+    static float EstimateScreenTexels(float radius, float distance, float projScaleY, float viewportHeight, float uvScale);
+
+private:
+    static const std::uint32_t NoRequest = 0xffffffff;
+
+    struct TextureState
+    {
+        StreamingTextureDesc Desc;
+        std::uint32_t ResidentMip = 0;
+        std::uint32_t PendingMip = NoRequest;
+        std::uint32_t WantedMip = 0;
+        std::uint64_t LastUsedFrame = 0;
+    };
+
+    std::uint64_t BytesFrom(const TextureState& texture, std::uint32_t firstMip)const;
+    std::uint32_t TargetMip(const TextureState& texture)const;
+    void Submit(std::uint32_t texture, std::uint32_t firstMip, std::vector<StreamingRequest>& outRequests);
+    std::uint32_t GetFreeRequestSlots()const;
+
+    // Least recently used textures that together free at least bytes, at most maxCount
+    // of them.  Returns the bytes they free, which is less than asked if they run out.
+    std::uint64_t SelectVictims(std::uint64_t bytes, std::uint32_t exclude, std::uint32_t maxCount, std::vector<std::uint32_t>& outVictims)const;
+    void Evict(const std::vector<std::uint32_t>& victims, std::vector<StreamingRequest>& outRequests);
+
+    // Evicts only if enough can be freed with maxVictims requests.
+    bool MakeRoom(std::uint64_t bytes, std::uint32_t exclude, std::uint32_t maxVictims, std::vector<StreamingRequest>& outRequests);
+
+private:
+    std::vector<TextureState> m_Textures;
+    std::uint64_t m_FrameIndex = 0;
+    std::uint32_t m_MaxPendingRequests = 4;
+
+    StreamingStats m_Stats;
+};
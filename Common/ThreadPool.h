@@ -0,0 +1,176 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// Fixed-size worker pool.  Tasks run in FIFO order; exceptions thrown by a task are
+// rethrown from the future returned by Submit (or from ParallelFor).
+class ThreadPool
+{
+public:
+    // threadCount 0 uses one worker per hardware thread minus the calling thread.
+    explicit ThreadPool(std::size_t threadCount = 0)
+    {
+        if (threadCount == 0)
+        {
+            unsigned int HardwareThreads = std::thread::hardware_concurrency();
+            threadCount = HardwareThreads > 1 ? HardwareThreads - 1 : 1;
+        }
+
+        m_Workers.reserve(threadCount);
+        for (std::size_t i = 0; i < threadCount; ++i)
+        {
+            m_Workers.emplace_back([this]() { WorkerLoop(); });
+        }
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> Lock(m_Mutex);
+            m_bStop = true;
+        }
+        m_Condition.notify_all();
+
+        for (std::thread& Worker : m_Workers)
+        {
+            Worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    std::size_t GetThreadCount()const { return m_Workers.size(); }
+
+    template<typename F>
+    std::future<void> Submit(F&& task)
+    {
+        auto Task = std::make_shared<std::packaged_task<void()>>(std::forward<F>(task));
+        std::future<void> Result = Task->get_future();
+
+        Enqueue([Task]() { (*Task)(); });
+        return Result;
+    }
+
+    // Calls func(i) for every i in [0, count).  The calling thread takes part and the
+    // call returns once every index has been processed.  Helpers are queued behind
+    // whatever the pool is already running; the caller only waits for helpers that
+    // started before it ran out of indices, so a pool busy with long tasks makes the
+    // loop run on the calling thread instead of stalling it.  Helpers that start later
+    // find the loop closed and return without touching func.
+    template<typename F>
+    void ParallelFor(std::size_t count, F&& func)
+    {
+        if (count == 0)
+            return;
+
+        struct LoopState
+        {
+            std::atomic<std::size_t> Next{ 0 };
+            std::mutex Mutex;
+            std::condition_variable Done;
+            std::size_t Running = 0;
+            bool bClosed = false;
+            std::exception_ptr Error;
+        };
+
+        auto State = std::make_shared<LoopState>();
+        auto* Func = &func;
+        auto Body = [count, Func](LoopState& state)
+        {
+            try
+            {
+                for (std::size_t i = state.Next++; i < count; i = state.Next++)
+                {
+                    (*Func)(i);
+                }
+            }
+            catch (...)
+            {
+                // Stop handing out indices; the first error is rethrown by the caller.
+                state.Next = count;
+
+                std::lock_guard<std::mutex> Lock(state.Mutex);
+                if (!state.Error)
+                    state.Error = std::current_exception();
+            }
+        };
+
+        const std::size_t HelperCount = (std::min)(count - 1, m_Workers.size());
+        for (std::size_t i = 0; i < HelperCount; ++i)
+        {
+            Enqueue([State, Body]()
+            {
+                {
+                    std::lock_guard<std::mutex> Lock(State->Mutex);
+                    if (State->bClosed)
+                        return;
+                    ++State->Running;
+                }
+
+                Body(*State);
+
+                std::lock_guard<std::mutex> Lock(State->Mutex);
+                if (--State->Running == 0)
+                    State->Done.notify_all();
+            });
+        }
+
+        Body(*State);
+
+        std::unique_lock<std::mutex> Lock(State->Mutex);
+        State->bClosed = true;
+        State->Done.wait(Lock, [&State]() { return State->Running == 0; });
+
+        if (State->Error)
+            std::rethrow_exception(State->Error);
+    }
+
+private:
+    void Enqueue(std::function<void()> task)
+    {
+        {
+            std::lock_guard<std::mutex> Lock(m_Mutex);
+            m_Tasks.emplace(std::move(task));
+        }
+        m_Condition.notify_one();
+    }
+
+    void WorkerLoop()
+    {
+        for (;;)
+        {
+            std::function<void()> Task;
+            {
+                std::unique_lock<std::mutex> Lock(m_Mutex);
+                m_Condition.wait(Lock, [this]() { return m_bStop || !m_Tasks.empty(); });
+
+                if (m_bStop && m_Tasks.empty())
+                    return;
+
+                Task = std::move(m_Tasks.front());
+                m_Tasks.pop();
+            }
+
+            Task();
+        }
+    }
+
+private:
+    std::vector<std::thread> m_Workers;
+    std::queue<std::function<void()>> m_Tasks;
+    std::mutex m_Mutex;
+    std::condition_variable m_Condition;
+    bool m_bStop = false;
+};
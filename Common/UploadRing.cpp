@@ -0,0 +1,118 @@
+#include "UploadRing.h"
+
+using Microsoft::WRL::ComPtr;
+
+UploadRing::~UploadRing()
+{
+    if (m_Buffer != nullptr)
+        m_Buffer->Unmap(0, nullptr);
+}
+
+void UploadRing::Initialize(ID3D12Device* device, UINT64 byteSize)
+{
+    m_Device = device;
+
+    ThrowIfFailed(device->CreateCommittedResource(
+        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+        D3D12_HEAP_FLAG_NONE,
+        &CD3DX12_RESOURCE_DESC::Buffer(byteSize),
+        D3D12_RESOURCE_STATE_GENERIC_READ,
+        nullptr,
+        IID_PPV_ARGS(&m_Buffer)));
+
+    // Upload heaps may stay mapped for their whole lifetime.
+    ThrowIfFailed(m_Buffer->Map(0, nullptr, reinterpret_cast<void**>(&m_MappedData)));
+
+    m_Ring.Reset(byteSize);
+}
+
+bool UploadRing::Allocate(UINT64 size, UINT64 alignment, UploadRingAllocation& allocation)
+{
+    const UINT64 Offset = m_Ring.Allocate(size, alignment);
+    if (Offset == RingAllocator::InvalidOffset)
+        return false;
+
+    allocation.CpuAddress = m_MappedData + Offset;
+    allocation.Resource = m_Buffer.Get();
+    allocation.Offset = Offset;
+    allocation.Size = size;
+    return true;
+}
+
+void UploadRing::Retire(const UploadRingAllocation& allocation, UINT64 fenceValue)
+{
+    m_Ring.Retire(allocation.Offset, fenceValue);
+}
+
+void UploadRing::RetireAll(UINT64 fenceValue)
+{
+    m_Ring.RetireAll(fenceValue);
+}
+
+void UploadRing::Reclaim(UINT64 completedFence)
+{
+    m_Ring.Reclaim(completedFence);
+}
+
+bool UploadRing::UploadBuffer(ID3D12GraphicsCommandList* cmdList, ID3D12Resource* dst, UINT64 dstOffset,
+    const void* data, UINT64 size, UINT64 fenceValue)
+{
+    UploadRingAllocation Allocation;
+    if (!Allocate(size, 16, Allocation))
+        return false;
+
+    memcpy(Allocation.CpuAddress, data, size);
+    cmdList->CopyBufferRegion(dst, dstOffset, m_Buffer.Get(), Allocation.Offset, size);
+
+    Retire(Allocation, fenceValue);
+    return true;
+}
+
+bool UploadRing::UploadTexture(ID3D12GraphicsCommandList* cmdList, ID3D12Resource* dst,
+    UINT firstSubresource, UINT numSubresources, const D3D12_SUBRESOURCE_DATA* data, UINT64 fenceValue)
+{
+    if (m_Footprints.size() < numSubresources)
+    {
+        m_Footprints.resize(numSubresources);
+        m_NumRows.resize(numSubresources);
+        m_RowSizes.resize(numSubresources);
+    }
+
+    const D3D12_RESOURCE_DESC Desc = dst->GetDesc();
+    UINT64 UploadSize = 0;
+    m_Device->GetCopyableFootprints(&Desc, firstSubresource, numSubresources, 0,
+        m_Footprints.data(), m_NumRows.data(), m_RowSizes.data(), &UploadSize);
+
+    UploadRingAllocation Allocation;
+    if (!Allocate(UploadSize, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT, Allocation))
+        return false;
+
+    for (UINT i = 0; i < numSubresources; ++i)
+    {
+        D3D12_PLACED_SUBRESOURCE_FOOTPRINT& Footprint = m_Footprints[i];
+
+        // Rows are RowPitch apart in the ring and SlicePitch / depth slices apart in data.
+        BYTE* DstBits = Allocation.CpuAddress + Footprint.Offset;
+        const BYTE* SrcBits = reinterpret_cast<const BYTE*>(data[i].pData);
+        const UINT64 DstSlicePitch = (UINT64)Footprint.Footprint.RowPitch * m_NumRows[i];
+
+        for (UINT z = 0; z < Footprint.Footprint.Depth; ++z)
+        {
+            for (UINT y = 0; y < m_NumRows[i]; ++y)
+            {
+                memcpy(DstBits + DstSlicePitch * z + (UINT64)Footprint.Footprint.RowPitch * y,
+                    SrcBits + data[i].SlicePitch * z + data[i].RowPitch * y,
+                    (size_t)m_RowSizes[i]);
+            }
+        }
+
+        Footprint.Offset += Allocation.Offset;
+
+        CD3DX12_TEXTURE_COPY_LOCATION Dst(dst, firstSubresource + i);
+        CD3DX12_TEXTURE_COPY_LOCATION Src(m_Buffer.Get(), Footprint);
+        cmdList->CopyTextureRegion(&Dst, 0, 0, 0, &Src, nullptr);
+    }
+
+    Retire(Allocation, fenceValue);
+    return true;
+}
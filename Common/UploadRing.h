@@ -0,0 +1,69 @@
+#pragma once
+
+#include "d3dUtil.h"
+#include "RingAllocator.h"
+
+// Space in the ring: CpuAddress is persistently mapped, Offset is the copy source offset
+// in Resource.
+struct UploadRingAllocation
+{
+    BYTE* CpuAddress = nullptr;
+    ID3D12Resource* Resource = nullptr;
+    UINT64 Offset = 0;
+    UINT64 Size = 0;
+
+    bool IsValid()const { return CpuAddress != nullptr; }
+};
+
+// One persistently mapped upload buffer that every load goes through, instead of an
+// upload buffer per resource.  Space is handed out by a RingAllocator and comes back
+// once the fence value of the submission that copies from it has been reached, so the
+// upload memory stays at the ring's size however much is loaded.  Not thread safe:
+// allocate on the thread that records the copies and let workers fill the space.
+class UploadRing
+{
+public:
+    UploadRing() = default;
+    ~UploadRing();
+
+    UploadRing(const UploadRing&) = delete;
+    UploadRing& operator=(const UploadRing&) = delete;
+
+    void Initialize(ID3D12Device* device, UINT64 byteSize);
+
+    // Returns false when the GPU has not released enough of the ring yet; try again after
+    // a later Reclaim.
+    bool Allocate(UINT64 size, UINT64 alignment, UploadRingAllocation& allocation);
+
+    // The space may be reused once fenceValue has been reached.
+    void Retire(const UploadRingAllocation& allocation, UINT64 fenceValue);
+    void RetireAll(UINT64 fenceValue);
+
+    void Reclaim(UINT64 completedFence);
+
+    // Copies data into the ring and records the copy into dst.  dst must be in COPY_DEST.
+    bool UploadBuffer(ID3D12GraphicsCommandList* cmdList, ID3D12Resource* dst, UINT64 dstOffset,
+        const void* data, UINT64 size, UINT64 fenceValue);
+
+    // Same as UpdateSubresources, but the footprints go into scratch arrays kept by the
+    // ring rather than a heap block allocated per call.
+    bool UploadTexture(ID3D12GraphicsCommandList* cmdList, ID3D12Resource* dst,
+        UINT firstSubresource, UINT numSubresources, const D3D12_SUBRESOURCE_DATA* data, UINT64 fenceValue);
+
+    ID3D12Resource* GetResource()const { return m_Buffer.Get(); }
+    UINT64 GetCapacity()const { return m_Ring.GetCapacity(); }
+
+    const RingAllocatorStats& GetStats()const { return m_Ring.GetStats(); }
+
+private:
+    Microsoft::WRL::ComPtr<ID3D12Device> m_Device;
+    Microsoft::WRL::ComPtr<ID3D12Resource> m_Buffer;
+    BYTE* m_MappedData = nullptr;
+
+    RingAllocator m_Ring;
+
+    // Reused by UploadTexture; only grow.
+    std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> m_Footprints;
+    std::vector<UINT> m_NumRows;
+    std::vector<UINT64> m_RowSizes;
+};
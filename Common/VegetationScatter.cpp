@@ -0,0 +1,335 @@
+#include "VegetationScatter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace
+{
+    const float Pi = 3.1415926535f;
+
+    enum class Containment
+    {
+        Disjoint,
+        Intersects,
+        Contains,
+    };
+
+    // Squared distance from p to the closest point of the box.
+    float DistanceSqToBox(const float p[3], const float center[3], const float extents[3])
+    {
+        float DistanceSq = 0.0f;
+        for (int i = 0; i < 3; ++i)
+        {
+            const float d = (std::max)(std::fabs(p[i] - center[i]) - extents[i], 0.0f);
+            DistanceSq += d * d;
+        }
+        return DistanceSq;
+    }
+
+    // Squared distance from p to the farthest corner of the box.
+    float FarthestDistanceSqToBox(const float p[3], const float center[3], const float extents[3])
+    {
+        float DistanceSq = 0.0f;
+        for (int i = 0; i < 3; ++i)
+        {
+            const float d = std::fabs(p[i] - center[i]) + extents[i];
+            DistanceSq += d * d;
+        }
+        return DistanceSq;
+    }
+
+    // Planes point into the frustum, so a box is outside when it lies entirely on the
+    // negative side of one plane and inside when it is on the positive side of all six.
+    Containment ContainBox(const float planes[6][4], const float center[3], const float extents[3])
+    {
+        Containment Result = Containment::Contains;
+        for (int i = 0; i < 6; ++i)
+        {
+            const float* Plane = planes[i];
+            const float Distance = Plane[0] * center[0] + Plane[1] * center[1] + Plane[2] * center[2] + Plane[3];
+            const float Radius = std::fabs(Plane[0]) * extents[0] + std::fabs(Plane[1]) * extents[1] + std::fabs(Plane[2]) * extents[2];
+
+            if (Distance < -Radius)
+                return Containment::Disjoint;
+            if (Distance < Radius)
+                Result = Containment::Intersects;
+        }
+        return Result;
+    }
+
+    bool IntersectsSphere(const float planes[6][4], const float center[3], float radius)
+    {
+        for (int i = 0; i < 6; ++i)
+        {
+            const float* Plane = planes[i];
+            if (Plane[0] * center[0] + Plane[1] * center[1] + Plane[2] * center[2] + Plane[3] < -radius)
+                return false;
+        }
+        return true;
+    }
+}
+
+void VegetationScatter::Build(
+    std::uint64_t seed,
+    const float areaMin[2],
+    const float areaMax[2],
+    float groundHeight,
+    float cellSize,
+    const std::vector<VegetationLayerDesc>& layers)
+{
+    m_AreaMin[0] = areaMin[0];
+    m_AreaMin[1] = areaMin[1];
+    m_AreaMax[0] = areaMax[0];
+    m_AreaMax[1] = areaMax[1];
+    m_CellSize = cellSize;
+    m_CellsX = (std::max)(1u, (std::uint32_t)std::ceil((areaMax[0] - areaMin[0]) / cellSize));
+    m_CellsZ = (std::max)(1u, (std::uint32_t)std::ceil((areaMax[1] - areaMin[1]) / cellSize));
+
+    const std::uint32_t CellsPerLayer = m_CellsX * m_CellsZ;
+
+    // Every layer gets its own set of cells so the cell draw distance is exact.
+    std::vector<VegetationInstance> Unsorted;
+    std::vector<std::uint32_t> CellOfInstance;
+    m_Cells.assign(CellsPerLayer * layers.size(), Cell());
+
+    FastRandom Rng(seed);
+
+    for (size_t l = 0; l < layers.size(); ++l)
+    {
+        const VegetationLayerDesc& Layer = layers[l];
+
+        std::vector<Point> Points;
+        ScatterLayer(Rng, Layer, Points);
+
+        for (const Point& P : Points)
+        {
+            const float Height = Rng.NextFloat(Layer.MinHeight, Layer.MaxHeight);
+
+            VegetationInstance Instance;
+            Instance.Size[0] = Height * Layer.Aspect;
+            Instance.Size[1] = Height;
+            Instance.Position[0] = P.X;
+            Instance.Position[1] = groundHeight + 0.4f * Height;
+            Instance.Position[2] = P.Z;
+
+            const std::uint32_t cx = (std::min)((std::uint32_t)((P.X - areaMin[0]) / cellSize), m_CellsX - 1);
+            const std::uint32_t cz = (std::min)((std::uint32_t)((P.Z - areaMin[1]) / cellSize), m_CellsZ - 1);
+            const std::uint32_t CellIndex = (std::uint32_t)l * CellsPerLayer + cz * m_CellsX + cx;
+
+            Unsorted.push_back(Instance);
+            CellOfInstance.push_back(CellIndex);
+            m_Cells[CellIndex].Count++;
+        }
+
+        for (std::uint32_t c = 0; c < CellsPerLayer; ++c)
+        {
+            m_Cells[l * CellsPerLayer + c].DrawDistance = Layer.DrawDistance;
+        }
+    }
+
+    // Counting sort by cell so each cell owns a contiguous range.
+    std::uint32_t Offset = 0;
+    for (Cell& C : m_Cells)
+    {
+        C.First = Offset;
+        Offset += C.Count;
+        C.Count = 0;
+    }
+
+    m_Instances.resize(Unsorted.size());
+    for (size_t i = 0; i < Unsorted.size(); ++i)
+    {
+        Cell& C = m_Cells[CellOfInstance[i]];
+        m_Instances[C.First + C.Count++] = Unsorted[i];
+    }
+
+    // Cell bounds enclose the full billboards of their instances.
+    for (Cell& C : m_Cells)
+    {
+        if (C.Count == 0)
+            continue;
+
+        float Min[3] = { +std::numeric_limits<float>::infinity(), +std::numeric_limits<float>::infinity(), +std::numeric_limits<float>::infinity() };
+        float Max[3] = { -std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity() };
+        for (std::uint32_t i = 0; i < C.Count; ++i)
+        {
+            const VegetationInstance& Instance = m_Instances[C.First + i];
+            const float HalfExtent = 0.5f * (std::max)(Instance.Size[0], Instance.Size[1]);
+            for (int Axis = 0; Axis < 3; ++Axis)
+            {
+                Min[Axis] = (std::min)(Min[Axis], Instance.Position[Axis] - HalfExtent);
+                Max[Axis] = (std::max)(Max[Axis], Instance.Position[Axis] + HalfExtent);
+            }
+        }
+
+        for (int Axis = 0; Axis < 3; ++Axis)
+        {
+            C.Center[Axis] = 0.5f * (Min[Axis] + Max[Axis]);
+            C.Extents[Axis] = 0.5f * (Max[Axis] - Min[Axis]);
+        }
+    }
+
+    m_Stats = VegetationCullStats();
+    m_Stats.TotalInstances = (std::uint32_t)m_Instances.size();
+}
+
+void VegetationScatter::ScatterLayer(
+    FastRandom& rng,
+    const VegetationLayerDesc& layer,
+    std::vector<Point>& outPoints)const
+{
+    // Bridson's Poisson-disk sampling.  The background grid cell holds at most
+    // one sample because its diagonal equals the minimum distance.
+    const float Radius = layer.MinDistance;
+    const float RadiusSq = Radius * Radius;
+    const float GridCellSize = Radius / std::sqrt(2.0f);
+    const float Width = m_AreaMax[0] - m_AreaMin[0];
+    const float Depth = m_AreaMax[1] - m_AreaMin[1];
+    const int GridW = (int)std::ceil(Width / GridCellSize);
+    const int GridH = (int)std::ceil(Depth / GridCellSize);
+    const int Attempts = 30;
+
+    std::vector<int> Grid((size_t)GridW * GridH, -1);
+    std::vector<int> Active;
+
+    auto GridX = [&](float x) { return (std::min)((std::max)((int)((x - m_AreaMin[0]) / GridCellSize), 0), GridW - 1); };
+    auto GridZ = [&](float z) { return (std::min)((std::max)((int)((z - m_AreaMin[1]) / GridCellSize), 0), GridH - 1); };
+
+    auto AddPoint = [&](const Point& P)
+    {
+        Grid[(size_t)GridZ(P.Z) * GridW + GridX(P.X)] = (int)outPoints.size();
+        Active.push_back((int)outPoints.size());
+        outPoints.push_back(P);
+    };
+
+    const float FirstX = rng.NextFloat(m_AreaMin[0], m_AreaMax[0]);
+    const float FirstZ = rng.NextFloat(m_AreaMin[1], m_AreaMax[1]);
+    AddPoint({ FirstX, FirstZ });
+
+    while (!Active.empty())
+    {
+        const std::uint32_t ActiveIndex = rng.NextUInt() % (std::uint32_t)Active.size();
+        const Point Center = outPoints[Active[ActiveIndex]];
+
+        bool bFound = false;
+        for (int k = 0; k < Attempts && !bFound; ++k)
+        {
+            // Uniform sample in the annulus [r, 2r] around the active point.
+            const float Angle = rng.NextFloat() * 2.0f * Pi;
+            const float Dist = Radius * std::sqrt(1.0f + 3.0f * rng.NextFloat());
+            const Point Candidate = { Center.X + Dist * std::cos(Angle), Center.Z + Dist * std::sin(Angle) };
+
+            if (Candidate.X < m_AreaMin[0] || Candidate.X >= m_AreaMax[0] ||
+                Candidate.Z < m_AreaMin[1] || Candidate.Z >= m_AreaMax[1])
+                continue;
+
+            const int gx = GridX(Candidate.X);
+            const int gz = GridZ(Candidate.Z);
+
+            bool bTooClose = false;
+            for (int z = (std::max)(gz - 2, 0); z <= (std::min)(gz + 2, GridH - 1) && !bTooClose; ++z)
+            {
+                for (int x = (std::max)(gx - 2, 0); x <= (std::min)(gx + 2, GridW - 1); ++x)
+                {
+                    const int Neighbor = Grid[(size_t)z * GridW + x];
+                    if (Neighbor < 0)
+                        continue;
+
+                    const float dx = outPoints[Neighbor].X - Candidate.X;
+                    const float dz = outPoints[Neighbor].Z - Candidate.Z;
+                    if (dx * dx + dz * dz < RadiusSq)
+                    {
+                        bTooClose = true;
+                        break;
+                    }
+                }
+            }
+
+            if (!bTooClose)
+            {
+                AddPoint(Candidate);
+                bFound = true;
+            }
+        }
+
+        if (!bFound)
+        {
+            Active[ActiveIndex] = Active.back();
+            Active.pop_back();
+        }
+    }
+}
+
+std::uint32_t VegetationScatter::Cull(
+    const float frustumPlanes[6][4],
+    const float eyePosW[3],
+    VegetationInstance* outInstances,
+    std::uint32_t capacity)
+{
+    auto StartTime = std::chrono::high_resolution_clock::now();
+
+    std::uint32_t Written = 0;
+    std::uint32_t CellsTested = 0;
+    std::uint32_t CellsVisible = 0;
+
+    for (const Cell& C : m_Cells)
+    {
+        if (C.Count == 0)
+            continue;
+
+        if (Written >= capacity)
+            break;
+
+        ++CellsTested;
+
+        const float DrawDistanceSq = C.DrawDistance * C.DrawDistance;
+        if (DistanceSqToBox(eyePosW, C.Center, C.Extents) > DrawDistanceSq)
+            continue;
+
+        const Containment CellContainment = ContainBox(frustumPlanes, C.Center, C.Extents);
+        if (CellContainment == Containment::Disjoint)
+            continue;
+
+        ++CellsVisible;
+
+        const VegetationInstance* Source = &m_Instances[C.First];
+
+        // Whole cell visible: copy the range without per-instance tests.
+        if (CellContainment == Containment::Contains && FarthestDistanceSqToBox(eyePosW, C.Center, C.Extents) <= DrawDistanceSq)
+        {
+            const std::uint32_t Count = (std::min)(C.Count, capacity - Written);
+            memcpy(&outInstances[Written], Source, Count * sizeof(VegetationInstance));
+            Written += Count;
+            continue;
+        }
+
+        for (std::uint32_t i = 0; i < C.Count && Written < capacity; ++i)
+        {
+            const float* P = Source[i].Position;
+            const float dx = P[0] - eyePosW[0];
+            const float dy = P[1] - eyePosW[1];
+            const float dz = P[2] - eyePosW[2];
+            if (dx * dx + dy * dy + dz * dz > DrawDistanceSq)
+                continue;
+
+            if (CellContainment == Containment::Intersects &&
+                !IntersectsSphere(frustumPlanes, P, 0.5f * (std::max)(Source[i].Size[0], Source[i].Size[1])))
+                continue;
+
+            outInstances[Written++] = Source[i];
+        }
+    }
+
+    auto EndTime = std::chrono::high_resolution_clock::now();
+
+    m_Stats.TotalInstances = (std::uint32_t)m_Instances.size();
+    m_Stats.VisibleInstances = Written;
+    m_Stats.CellsTested = CellsTested;
+    m_Stats.CellsVisible = CellsVisible;
+    m_Stats.CullMilliseconds = std::chrono::duration<double, std::milli>(EndTime - StartTime).count();
+
+    return Written;
+}
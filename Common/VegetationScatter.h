@@ -0,0 +1,113 @@
+#pragma once
+
+#include "FastRandom.h"
+
+#include <cstdint>
+#include <vector>
+
+// One billboard instance.  Layout matches the POSITION/SIZE point vertex
+// consumed by Tree.hlsl so visible instances can be written straight into
+// the vertex buffer.
+struct VegetationInstance
+{
+    float Position[3];
+    float Size[2];
+};
+
+// A scatter layer (trees, grass clumps, ...).
+struct VegetationLayerDesc
+{
+    // Minimum distance between two instances of this layer (Poisson-disk radius).
+    float MinDistance = 4.0f;
+
+    // Billboard height range, width is Aspect * height.
+    float MinHeight = 8.0f;
+    float MaxHeight = 12.0f;
+    float Aspect = 1.0f;
+
+    // Instances farther than this from the eye are culled.
+    float DrawDistance = 200.0f;
+};
+
+struct VegetationCullStats
+{
+    std::uint32_t TotalInstances = 0;
+    std::uint32_t VisibleInstances = 0;
+    std::uint32_t CellsTested = 0;
+    std::uint32_t CellsVisible = 0;
+    double CullMilliseconds = 0.0;
+
+    // Instances processed (visible or rejected) per millisecond of cull time.
+    double InstancesPerMillisecond()const
+    {
+        return CullMilliseconds > 0.0 ? TotalInstances / CullMilliseconds : 0.0;
+    }
+};
+
+// Deterministic Poisson-disk vegetation scatter bucketed into a uniform grid.
+// Each frame Cull() walks the grid, rejects whole cells against the frustum
+// and draw distance, and writes the surviving instances into a compact buffer.
+// The area lies in the xz plane; areaMin / areaMax are (x, z).  Has no graphics
+// API dependency.
+class VegetationScatter
+{
+public:
+    // Takes about a second for the sample's square kilometre, so callers run it
+    // on a worker thread.  Cull must not run until Build has returned.
+    void Build(
+        std::uint64_t seed,
+        const float areaMin[2],
+        const float areaMax[2],
+        float groundHeight,
+        float cellSize,
+        const std::vector<VegetationLayerDesc>& layers);
+
+    // frustumPlanes are world-space planes as FrustumCuller::ExtractPlanes returns them.
+    // Writes at most capacity visible instances to outInstances and returns the count.
+    std::uint32_t Cull(
+        const float frustumPlanes[6][4],
+        const float eyePosW[3],
+        VegetationInstance* outInstances,
+        std::uint32_t capacity);
+
+    std::uint32_t GetInstanceCount()const { return (std::uint32_t)m_Instances.size(); }
+
+    // Instances sorted by cell; the order is the same for every build with the same seed.
+    const std::vector<VegetationInstance>& GetInstances()const { return m_Instances; }
+
+    const VegetationCullStats& GetStats()const { return m_Stats; }
+
+private:
+    struct Point
+    {
+        float X;
+        float Z;
+    };
+
+    void ScatterLayer(
+        FastRandom& rng,
+        const VegetationLayerDesc& layer,
+        std::vector<Point>& outPoints)const;
+
+private:
+    struct Cell
+    {
+        float Center[3] = {};
+        float Extents[3] = {};
+        float DrawDistance = 0.0f;
+        std::uint32_t First = 0;
+        std::uint32_t Count = 0;
+    };
+
+    float m_AreaMin[2] = {};
+    float m_AreaMax[2] = {};
+    float m_CellSize = 0.0f;
+    std::uint32_t m_CellsX = 0;
+    std::uint32_t m_CellsZ = 0;
+
+    // Instances sorted by cell, each cell references a contiguous range.
+    std::vector<VegetationInstance> m_Instances;
+    std::vector<Cell> m_Cells;
+
+    VegetationCullStats m_Stats;
+};
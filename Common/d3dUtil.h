@@ -112,6 +112,12 @@ public:
         return (byteSize + 255) & ~255;
     }
 
+    // Rounds value up to a multiple of alignment, which must be a power of two.
+    static UINT64 AlignUp(UINT64 value, UINT64 alignment)
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+
     static Microsoft::WRL::ComPtr<ID3DBlob> LoadBinary(const std::wstring& filename);
 
     static Microsoft::WRL::ComPtr<ID3D12Resource> CreateDefaultBuffer(
@@ -17,11 +17,36 @@
 #include "../Common/GeometryGenerator.h"
 #include "../Common/LoadM3d.h"
 #include "../Common/SkinnedData.h"
+#include "../Common/VegetationScatter.h"
+#include "../Common/ThreadPool.h"
+#include "../Common/TextureBatchLoader.h"
+#include "../Common/TextureStreamer.h"
+#include "../Common/TexturePackManifest.h"
+#include "../Common/AsyncFileQueue.h"
+#include "../Common/FrameResourceRing.h"
+#include "../Common/CommandListRecorder.h"
+#include "../Common/DrawSort.h"
+#include "../Common/FrustumCuller.h"
+#include "../Common/DynamicBVH.h"
+#include "../Common/DirtyTracker.h"
+#include "../Common/FrameUploadAllocator.h"
+#include "../Common/GeometryPool.h"
+#include "../Common/GpuMemoryAllocator.h"
+#include "../Common/UploadRing.h"
+#include "../Common/ShaderDescriptorHeap.h"
+#include "../Common/ShaderCompiler.h"
+#include "../Common/TaskGraph.h"
+#include "../Common/PipelineLibrary.h"
+#include "../Common/ShaderPermutation.h"
+
+#include <Psapi.h>
+#include <chrono>
 
 // Link necessary d3d12 libraries.
 #pragma comment(lib,"d3dcompiler.lib")
 #pragma comment(lib, "D3D12.lib")
 #pragma comment(lib, "dxgi.lib")
+#pragma comment(lib, "psapi.lib")
 
 using Microsoft::WRL::ComPtr;
 using namespace std;
@@ -29,6 +54,9 @@ using namespace DirectX;
 
 const UINT SWAP_CHAIN_BUFFER_COUNT = 2;
 
+// 동시에 GPU 에 올라가 있을 수 있는 프레임 수
+const UINT FRAME_RESOURCE_COUNT = 3;
+
 enum class RenderLayer : int
 {
 	Opaque = 0,
@@ -40,6 +68,18 @@ enum class RenderLayer : int
 	ShadowMap,
 	ShadowMapDebug,
 	SkinnedOpaque,
+	ShadowMapSkinned,
+	ShadowMapAlphaTested,
+	Count
+};
+
+// 창 제목에 FPS 와 함께 보여줄 통계 묶음 (Tab 으로 순환, 나머지는 OutputDebugString)
+enum class FrameStatsGroup : int
+{
+	None = 0,
+	Culling,
+	Draws,
+	Memory,
 	Count
 };
 
@@ -50,7 +90,7 @@ enum class ETextureType : int
 	Count
 };
 
-//  ü
+// 정점 구조체
 struct Vertex
 {
 	XMFLOAT3 Pos;
@@ -59,45 +99,51 @@ struct Vertex
 	XMFLOAT3 TangentU;
 };
 
-// ٴ  ü
+// 바닥 정점 구조체
 struct QuadPatchVertex
 {
 	XMFLOAT3 Pos;
 };
 
-//   ü
+// 나무 정점 구조체
 struct TreeVertex
 {
 	XMFLOAT3 Pos;
 	XMFLOAT2 Size;
 };
 
-// Ʈ ü
+static_assert(sizeof(TreeVertex) == sizeof(VegetationInstance), "Visible vegetation instances are written as TreeVertex");
+
+// 오브젝트 구조체
 struct GeometryInfo
 {
 	std::wstring Name;
 
-	//  
-	ComPtr<ID3D12Resource>		VertexBuffer = nullptr;
-	ComPtr<ID3D12Resource>		VertexUploadBuffer = nullptr;
-	D3D12_VERTEX_BUFFER_VIEW	VertexBufferView = {};
+	// 지오메트리 풀 안의 정점 / 인덱스 범위
+	GeometryRange VertexRange;
+	GeometryRange IndexRange;
 
-	// ε 
-	ComPtr<ID3D12Resource>		IndexBuffer = nullptr;
-	ComPtr<ID3D12Resource>		IndexUploadBuffer = nullptr;
+	// 범위가 들어 있는 풀 버퍼 전체의 뷰 (같은 버퍼의 메시는 뷰가 같음)
+	D3D12_VERTEX_BUFFER_VIEW	VertexBufferView = {};
 	D3D12_INDEX_BUFFER_VIEW		IndexBufferView = {};
 
-	//  
+	// 정점 갯수
 	UINT VertexCount = 0;
 
-	// ε 
+	// 인덱스 갯수
 	UINT IndexCount = 0;
 
-	// ù Index ġ
+	// 첫 Index 위치
 	UINT StartIndexLocation = 0;
 
-	// Vertex ġ
+	// Vertex 위치
 	int BaseVertexLocation = 0;
+
+	// 로컬 공간 경계 상자
+	BoundingBox Bounds;
+
+	// 그리기 정렬 키의 지오메트리 필드 (BuildRenderItems 에서 부여)
+	UINT SortId = 0;
 };
 
 struct TextureInfo
@@ -105,12 +151,20 @@ struct TextureInfo
 	std::wstring Name;
 	std::wstring FileName;
 
+	// ShaderDescriptorHeap 영구 슬롯 (스트리밍으로 리소스가 바뀌면 새 슬롯으로 옮김)
 	UINT TextureHeapIndex = 0;
 
 	ETextureType TextureType = ETextureType::Texture2D;
 
 	ComPtr<ID3D12Resource> Resource = nullptr;
-	ComPtr<ID3D12Resource> UploadHeap = nullptr;
+
+	// TextureStreamer 인덱스 (-1 : 스트리밍 안 함)
+	int StreamIndex = -1;
+
+	// 팩(배열/아틀라스)에 들어간 텍스처는 Resource / 슬롯 없이 팩과 팩 안의 위치만 가짐
+	TextureInfo* Pack = nullptr;
+	UINT ArraySlice = 0;
+	XMFLOAT4 UvScaleBias = { 1.0f, 1.0f, 0.0f, 0.0f };
 };
 
 struct MaterialInfo
@@ -119,10 +173,19 @@ struct MaterialInfo
 
 	UINT MatCBIndex = 0;
 	UINT Texture_On = 0;
-	UINT TextureHeapIndex = 0;
-
 	UINT Normal_On = 0;
 
+	// 서술자를 가진 텍스처 (팩에 들어간 텍스처는 팩)
+	TextureInfo* DiffuseTexture = nullptr;
+	TextureInfo* NormalTexture = nullptr;
+
+	// 테이블 모드에서 이번 프레임 임시 영역에 복사한 t0/t1 테이블의 힙 인덱스
+	UINT TextureTableIndex = 0;
+
+	// 텍스처 배열 슬라이스, 아틀라스 UV 스케일(xy) / 오프셋(zw)
+	UINT TextureSlice = 0;
+	XMFLOAT4 TextureScaleBias = { 1.0f, 1.0f, 0.0f, 0.0f };
+
 	XMFLOAT4 Albedo = { 1.0f, 1.0f, 1.0f, 1.0f };
 	XMFLOAT3 Fresnel = { 0.01f, 0.01f, 0.01f };
 	float Roughness = 0.25f;
@@ -146,7 +209,7 @@ struct SkinnedModelAnimation
 	}
 };
 
-//   ü
+// 렌더링할 아이템 구조체
 struct RenderItem
 {
 	RenderItem() = default;
@@ -164,9 +227,37 @@ struct RenderItem
 
 	SkinnedModelAnimation* SkinnedAnimation = nullptr;
 	UINT SkinnedCBIndex = 0;
+
+	// FrustumCuller 아이템 번호 / 이번 프레임 카메라 절두체 컬링 결과
+	UINT CullIndex = 0;
+	bool bVisible = true;
+
+	// 카메라를 따라가는 아이템 (스카이박스) 은 월드 경계가 없으므로 컬링하지 않고 항상 그림
+	bool bCullable = true;
+
+	// 이번 프레임 그림자 맵에 그릴 캐스터인지
+	bool bShadowVisible = true;
+};
+
+// 지오메트리, 재질, PSO 가 같은 아이템을 한 번에 그리는 인스턴싱 배치
+struct DrawBatch
+{
+	// 배치의 첫 아이템 (지오메트리 / 재질 / 토폴로지는 배치 전체가 같음)
+	RenderItem* Item = nullptr;
+
+	// 레코드 번호 목록에서 이 배치가 시작하는 원소와 원소 수 (번호는 ObjectCBIndex)
+	UINT InstanceBase = 0;
+	UINT InstanceCount = 0;
+};
+
+// 프레임 업로드 힙에서 받은 영역 (CPU 기록 주소와 GPU 가상 주소)
+struct UploadAllocation
+{
+	BYTE* CpuAddress = nullptr;
+	D3D12_GPU_VIRTUAL_ADDRESS GpuAddress = 0;
 };
 
-//  
+// 조명 정보
 #define MAX_LIGHT 16
 
 struct LightInfo
@@ -181,14 +272,21 @@ struct LightInfo
 	XMFLOAT3	Padding = { 0.0f, 0.0f, 0.0f };
 };
 
-// Ʈ   
+// 오브젝트 개별 상수 버퍼
 struct ObjectConstant
 {
 	XMFLOAT4X4	World = MathHelper::Identity4x4();
 	XMFLOAT4X4	TextureTransform = MathHelper::Identity4x4();
 };
 
-//   
+// 인스턴스 레코드 (아이템마다 하나, 재질은 배치마다 하나라 재질 상수 버퍼를 그대로 씀)
+struct InstanceData
+{
+	XMFLOAT4X4	World = MathHelper::Identity4x4();
+	XMFLOAT4X4	TextureTransform = MathHelper::Identity4x4();
+};
+
+// 공용 상수 버퍼
 struct PassConstant
 {
 	XMFLOAT4X4	View = MathHelper::Identity4x4();
@@ -209,7 +307,7 @@ struct PassConstant
 	XMFLOAT2	FogPadding = { 0.0f, 0.0f };
 };
 
-//   
+// 재질 상수 버퍼
 struct MatConstant
 {
 	XMFLOAT4 Albedo = { 1.0f, 1.0f, 1.0f, 1.0f };
@@ -217,11 +315,43 @@ struct MatConstant
 	float Roughness = 0.25f;
 	UINT Texture_On = 0;
 	UINT Normal_On = 0;
-	XMFLOAT2 Padding = { 0.0f, 0.0f };
+	UINT TextureSlice = 0;
+	UINT DiffuseIndex = 0;
+	XMFLOAT4 TextureScaleBias = { 1.0f, 1.0f, 0.0f, 0.0f };
+
+	// 바인드리스 모드의 노멀 맵 서술자 인덱스
+	UINT NormalIndex = 0;
+	XMFLOAT3 IndexPadding = { 0.0f, 0.0f, 0.0f };
 };
 
-// Ų    
+// 스킨드 모델 본 행렬 버퍼
 struct SkinnedConstant
 {
 	XMFLOAT4X4 BoneTransforms[96];
+};
+
+// 프레임 슬롯별 리소스 (상수 버퍼는 버퍼 하나를 슬롯 수만큼 나눠 사용)
+struct FrameResource
+{
+	// GPU 가 이 슬롯의 명령을 다 실행한 뒤에만 Reset
+	ComPtr<ID3D12CommandAllocator> CommandAlloc;
+
+	// 병렬 기록 작업별 할당자 / 커맨드 리스트 (작업 수에 맞춰 늘어남)
+	std::vector<ComPtr<ID3D12CommandAllocator>> JobAllocs;
+	std::vector<ComPtr<ID3D12GraphicsCommandList>> JobLists;
+};
+
+// FrameResourceRing 이 사용하는 펜스 래퍼
+struct GpuFence
+{
+	ID3D12Fence* Fence = nullptr;
+	HANDLE hEvent = nullptr;
+
+	UINT64 GetCompletedValue() const { return Fence->GetCompletedValue(); }
+
+	void Wait(UINT64 value)
+	{
+		ThrowIfFailed(Fence->SetEventOnCompletion(value, hEvent));
+		WaitForSingleObject(hEvent, INFINITE);
+	}
 };
\ No newline at end of file
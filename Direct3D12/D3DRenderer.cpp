@@ -166,6 +166,10 @@ LRESULT D3DRenderer::MsgProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 		{
 			PostQuitMessage(0);
 		}
+		else
+		{
+			OnKeyUp(wParam);
+		}
 
 		return 0;
 	}
@@ -291,7 +295,8 @@ void D3DRenderer::CalculateFrameStats()
 
 		wstring windowText = m_strMainWnd +
 			L"    fps: " + fpsStr +
-			L"   mspf: " + mspfStr;
+			L"   mspf: " + mspfStr +
+			GetFrameStats();
 
 		SetWindowText(m_hWnd, windowText.c_str());
 
@@ -33,6 +33,10 @@ protected:
     virtual void OnMouseDown(WPARAM btnState, int x, int y) {}
     virtual void OnMouseUp(WPARAM btnState, int x, int y) {}
     virtual void OnMouseMove(WPARAM btnState, int x, int y) {}
+    virtual void OnKeyUp(WPARAM key) {}
+
+    // Extra statistics appended to the window caption.
+    virtual std::wstring GetFrameStats() const { return std::wstring(); }
 
 protected:
     bool CreateMainWindow();
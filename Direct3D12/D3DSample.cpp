@@ -1,5 +1,76 @@
 #include "D3DSample.h"
 
+namespace
+{
+    // 메인 패스에서 레이어를 그리는 순서 (정렬 키의 레이어 필드)
+    const RenderLayer MainPassLayers[] =
+    {
+        RenderLayer::Skybox,
+        RenderLayer::Opaque,
+        RenderLayer::SkinnedOpaque,
+        RenderLayer::QuadPatch,
+        RenderLayer::AlphaTested,
+        RenderLayer::Tree,
+        RenderLayer::Transparent,
+        RenderLayer::ShadowMapDebug,
+    };
+
+    // 쉐도우 패스에서 그리는 캐스터 레이어와 그 레이어용 쉐도우 PSO
+    struct ShadowPassLayer
+    {
+        RenderLayer Caster;
+        RenderLayer Pipeline;
+    };
+
+    const ShadowPassLayer ShadowPassLayers[] =
+    {
+        { RenderLayer::Opaque, RenderLayer::ShadowMap },
+        { RenderLayer::SkinnedOpaque, RenderLayer::ShadowMapSkinned },
+        { RenderLayer::AlphaTested, RenderLayer::ShadowMapAlphaTested },
+    };
+
+    bool IsShadowCasterLayer(RenderLayer layer)
+    {
+        for (const ShadowPassLayer& Pass : ShadowPassLayers)
+        {
+            if (Pass.Caster == layer)
+                return true;
+        }
+        return false;
+    }
+
+    // 인스턴싱으로 그리는 레이어 (Transparent 는 깊이 순서, Skinned 는 아이템별 본 행렬 때문에 제외)
+    bool IsInstancedLayer(RenderLayer layer)
+    {
+        return layer == RenderLayer::Opaque || layer == RenderLayer::AlphaTested;
+    }
+
+    // 읽은 파일 버퍼를 복사하지 않고 istream 으로 파싱하기 위한 뷰 (버퍼보다 먼저 사라져야 함)
+    class ByteViewBuffer : public std::streambuf
+    {
+    public:
+        explicit ByteViewBuffer(std::vector<std::uint8_t>& data)
+        {
+            char* Begin = reinterpret_cast<char*>(data.data());
+            setg(Begin, Begin, Begin + data.size());
+        }
+    };
+
+    const std::uint32_t NoPermutation = UINT32_MAX;
+
+    // 오브젝트 셰이더 퍼뮤테이션으로 그리는 레이어의 기능 비트 (인스턴싱 비트는 그릴 때 더함)
+    constexpr std::uint32_t GetLayerFeatures(RenderLayer layer)
+    {
+        return layer == RenderLayer::Opaque ? ShaderFeature_Fog :
+            layer == RenderLayer::AlphaTested ? ShaderFeature_Fog | ShaderFeature_AlphaTested :
+            layer == RenderLayer::SkinnedOpaque ? ShaderFeature_Fog | ShaderFeature_Skinned :
+            layer == RenderLayer::ShadowMap ? ShaderFeature_Shadow :
+            layer == RenderLayer::ShadowMapSkinned ? ShaderFeature_Shadow | ShaderFeature_Skinned :
+            layer == RenderLayer::ShadowMapAlphaTested ? ShaderFeature_Shadow | ShaderFeature_AlphaTested :
+            NoPermutation;
+    }
+}
+
 D3DSample::D3DSample(HINSTANCE hInstance)
     : D3DRenderer(hInstance)
 {
@@ -7,6 +78,13 @@ D3DSample::D3DSample(HINSTANCE hInstance)
 
 D3DSample::~D3DSample()
 {
+    // 아직 GPU 가 사용 중인 프레임 리소스가 있을 수 있음
+    if (m_D3dDevice != nullptr)
+        FlushCommandQueue();
+
+    // 초기화 도중 실패했으면 식생 분포 생성이 아직 m_Vegetation 을 쓰고 있을 수 있음
+    if (m_VegetationBuild.valid())
+        m_VegetationBuild.wait();
 }
 
 bool D3DSample::Initialize()
@@ -14,9 +92,33 @@ bool D3DSample::Initialize()
     if (!D3DRenderer::Initialize())
         return false;
 
+    auto StartTime = std::chrono::high_resolution_clock::now();
+
     ThrowIfFailed(m_CommandAlloc->Reset());
     ThrowIfFailed(m_CommandList->Reset(m_CommandAlloc.Get(), nullptr));
 
+    m_ThreadPool = std::make_unique<ThreadPool>();
+
+    // 기본 힙 리소스 (지오메트리, 텍스처, 섀도우 맵) 는 공용 힙 블록에 배치
+    m_GpuAllocator.Initialize(m_D3dDevice.Get());
+    m_TextureLoader.SetAllocator(&m_GpuAllocator);
+    m_TextureStreamer.SetAllocator(&m_GpuAllocator);
+
+    m_UploadRing.Initialize(m_D3dDevice.Get(), m_UploadRingSize);
+
+    // 무제한 SRV 배열은 리소스 바인딩 티어 2 부터
+    D3D12_FEATURE_DATA_D3D12_OPTIONS Options = {};
+    ThrowIfFailed(m_D3dDevice->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS, &Options, sizeof(Options)));
+    m_bBindless = m_bBindless && Options.ResourceBindingTier >= D3D12_RESOURCE_BINDING_TIER_2;
+
+    // 텍스처 서술자 슬롯은 BuildTextures 부터 할당하므로 힙을 먼저 생성
+    m_SrvHeap.Initialize(m_D3dDevice.Get(), m_SrvPersistentCount, m_SrvTransientCount);
+
+    // 모델 파일 읽기는 먼저 요청만 해두고, 나머지 초기화와 겹쳐서 진행
+    m_FileQueue = std::make_unique<AsyncFileQueue>();
+    m_SkullFile = m_FileQueue->Read("../Models/skull.txt");
+    m_SkinnedModelFile = m_FileQueue->Read(m_SkinnedModelFileName);
+
     // Camera Initialize
     m_Camera.SetPosition(0.0f, 2.0f, -15.0f);
 
@@ -32,6 +134,7 @@ bool D3DSample::Initialize()
     BuildTextures();
     BuildMaterials();
     BuildRenderItems();
+    BuildFrameResources();
     BuildConstantBuffer();
     BuildDescriptorHeap();
     BuildDsvDescriptorHeap();
@@ -39,6 +142,7 @@ bool D3DSample::Initialize()
     BuildRootSignature();
     BuildInputLayout();
     BuildPipelineState();
+    FinishTreeGeometry();
 
     ThrowIfFailed(m_CommandList->Close());
 
@@ -46,6 +150,33 @@ bool D3DSample::Initialize()
     m_CommandQueue->ExecuteCommandLists(_countof(CmdsList), CmdsList);
 
     FlushCommandQueue();
+
+    // 펜스 통과 후 텍스처 / 지오메트리 스테이징 버퍼 해제
+    m_TextureLoader.ReleaseStaging();
+    m_GeometryPool.ReleaseStaging();
+    m_UploadRing.Reclaim(m_Fence->GetCompletedValue());
+
+    auto EndTime = std::chrono::high_resolution_clock::now();
+
+    PROCESS_MEMORY_COUNTERS MemoryCounters = {};
+    GetProcessMemoryInfo(GetCurrentProcess(), &MemoryCounters, sizeof(MemoryCounters));
+
+    std::wostringstream Log;
+    Log << L"Startup: " << std::chrono::duration<double, std::milli>(EndTime - StartTime).count() << L" ms, "
+        << L"peak working set " << MemoryCounters.PeakWorkingSetSize / (1024 * 1024) << L" MB, "
+        << L"peak commit " << MemoryCounters.PeakPagefileUsage / (1024 * 1024) << L" MB\n";
+    OutputDebugString(Log.str().c_str());
+
+    const GpuMemoryStats GpuStats = m_GpuAllocator.GetStats();
+
+    std::wostringstream HeapLog;
+    HeapLog << L"GPU heaps: " << GpuStats.ResourceCount << L" resources (" << GpuStats.SmallTextureCount << L" small textures) in "
+        << GpuStats.Pools.BlockCount << L" heaps, " << GpuStats.Pools.UsedBytes / 1024 << L"/" << GpuStats.Pools.BlockBytes / 1024 << L" KB used; "
+        << L"committed resources would reserve " << GpuStats.CommittedBytes / 1024 << L" KB; "
+        << L"upload ring " << m_UploadRing.GetCapacity() / 1024 << L" KB resident (peak " << m_UploadRing.GetStats().PeakBytes / 1024 << L" KB); "
+        << L"descriptors " << m_SrvHeap.GetStats().PersistentUsed << L"/" << m_SrvHeap.GetPersistentCapacity() << (m_bBindless ? L" bindless\n" : L" with per-draw tables\n");
+    OutputDebugString(HeapLog.str().c_str());
+
     return true;
 }
 
@@ -53,12 +184,23 @@ void D3DSample::OnResize()
 {
     D3DRenderer::OnResize();
 
-    //   
+    // 투영 행렬 생성
     m_Camera.SetLens(0.25f * MathHelper::Pi, AspectRatio(), 1.0f, 1000.0f);
 }
 
 void D3DSample::Update(float deltaTime)
 {
+    // 이번 슬롯을 GPU 가 아직 사용 중이면 끝날 때까지 대기
+    GpuFence Fence = { m_Fence.Get(), m_hFenceEvent };
+    m_FrameRing.WaitForCurrent(Fence);
+
+    // 이 슬롯의 업로드 영역은 GPU 가 다 썼으므로 처음부터 다시 할당
+    ReserveUploadHeap();
+    m_UploadAllocator.BeginFrame(m_FrameRing.GetCurrentIndex());
+
+    m_CBBytesWritten = 0;
+
+    // 오브젝트 (+ 인스턴스 레코드) / 재질 블록이 슬롯 안에서 같은 위치에 오도록 항상 이 순서로 가장 먼저 할당
     UpdateObjectCB(deltaTime);
     UpdateMaterialCB(deltaTime);
     UpdateSkinnedCB(deltaTime);
@@ -68,6 +210,11 @@ void D3DSample::LateUpdate(float deltaTime)
 {
     UpdateLight(deltaTime);
     UpdateCamera(deltaTime);
+    UpdateVegetation(deltaTime);
+    CullRenderItems();
+    CullShadowCasters();
+    SortRenderItems();
+    BuildInstanceBatches();
 
     UpdatePassCB(deltaTime);
     UpdateShadowMapPassCB(deltaTime);
@@ -75,93 +222,116 @@ void D3DSample::LateUpdate(float deltaTime)
 
 void D3DSample::BeginRender()
 {
-    ThrowIfFailed(m_CommandAlloc->Reset());
+    ID3D12CommandAllocator* CommandAlloc = m_FrameResources[m_FrameRing.GetCurrentIndex()].CommandAlloc.Get();
 
-    ThrowIfFailed(m_CommandList->Reset(m_CommandAlloc.Get(), nullptr));
+    ThrowIfFailed(CommandAlloc->Reset());
+
+    ThrowIfFailed(m_CommandList->Reset(CommandAlloc, nullptr));
+
+    for (UINT i = 0; i < (UINT)DrawState::Count; ++i)
+    {
+        m_StateCalls[i] = 0;
+        m_StateSkips[i] = 0;
+    }
+
+    // 이번 프레임에 그릴 텍스처의 밉 교체는 렌더링보다 먼저 기록
+    UpdateTextureStreaming();
+    UpdateTextureTables();
 }
 
 void D3DSample::Render()
 {
-    // н 1 :   
+    if (m_bParallelRecording)
+    {
+        RenderParallel();
+        return;
+    }
+
+    // 패스 1 : 쉐도우 맵 렌더링
     RenderSceneToShadowMap();
 
-    // н 2 : Ʈ 
+    // 패스 2 : 오브젝트 렌더링
     m_CommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(CurrentBackBuffer(), D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET));
 
-    m_CommandList->RSSetViewports(1, &m_ScreenViewport);
-    m_CommandList->RSSetScissorRects(1, &m_ScissorRect);
-
     m_CommandList->ClearRenderTargetView(GetRenderTargetView(), Colors::LightSkyBlue, 0, nullptr);
     m_CommandList->ClearDepthStencilView(GetDepthStencilView(), D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0, 0, nullptr);
 
-    m_CommandList->OMSetRenderTargets(1, &GetRenderTargetView(), true, &GetDepthStencilView());
-
-    m_CommandList->SetGraphicsRootSignature(m_RootSignature.Get());
-
-    // ؽó   ο 
-    ID3D12DescriptorHeap* DescritprHeaps[] = { m_TextureDescriptorHeap.Get() };
-    m_CommandList->SetDescriptorHeaps(_countof(DescritprHeaps), DescritprHeaps);
-
-    //   (,  )
-    D3D12_GPU_VIRTUAL_ADDRESS PassCBAddress = m_PassCB->GetGPUVirtualAddress();
-    m_CommandList->SetGraphicsRootConstantBufferView(1, PassCBAddress);
-
-    // ī̹ڽ ؽó  ο 
-    CD3DX12_GPU_DESCRIPTOR_HANDLE SkyboxHeapAddress(m_TextureDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
-    SkyboxHeapAddress.Offset(m_SkyboxTexture->TextureHeapIndex, m_CbvSrvUavDescriptorSize);
-    m_CommandList->SetGraphicsRootDescriptorTable(4, SkyboxHeapAddress);
-
-    //   ؽó  ο 
-    CD3DX12_GPU_DESCRIPTOR_HANDLE ShadowMapHeapAddress(m_TextureDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
-    ShadowMapHeapAddress.Offset(m_ShadowMapHeapIndex, m_CbvSrvUavDescriptorSize);
-    m_CommandList->SetGraphicsRootDescriptorTable(5, ShadowMapHeapAddress);
+    SetMainPassState(m_CommandList.Get());
 
-    // ī̹ڽ Ʈ 
-    m_CommandList->SetPipelineState(m_PipelineStates[RenderLayer::Skybox].Get());
-    RenderGeometry(m_RenderItemLayer[(int)RenderLayer::Skybox]);
+    // 스카이박스 오브젝트 렌더링
+    m_CommandList->SetPipelineState(m_PipelineStates[(int)RenderLayer::Skybox].Get());
+    RenderGeometry(m_SortedRenderItemLayer[(int)RenderLayer::Skybox]);
 
-    //  Ʈ 
-    m_CommandList->SetPipelineState(m_PipelineStates[RenderLayer::Opaque].Get());
-    RenderGeometry(m_RenderItemLayer[(int)RenderLayer::Opaque]);
+    // 개별 오브젝트 렌더링
+    if (m_bInstancing)
+    {
+        m_CommandList->SetPipelineState(m_ObjectPipelines.Get<ShaderFeature_Fog | ShaderFeature_Instanced>().Get());
+        RenderBatches(m_InstanceBatchLayer[(int)RenderLayer::Opaque]);
+    }
+    else
+    {
+        m_CommandList->SetPipelineState(m_ObjectPipelines.Get<ShaderFeature_Fog>().Get());
+        RenderGeometry(m_SortedRenderItemLayer[(int)RenderLayer::Opaque]);
+    }
 
     // Skinned Object Rendering
-    m_CommandList->SetPipelineState(m_PipelineStates[RenderLayer::SkinnedOpaque].Get());
-    RenderGeometry(m_RenderItemLayer[(int)RenderLayer::SkinnedOpaque]);
+    m_CommandList->SetPipelineState(m_ObjectPipelines.Get<ShaderFeature_Fog | ShaderFeature_Skinned>().Get());
+    RenderGeometry(m_SortedRenderItemLayer[(int)RenderLayer::SkinnedOpaque]);
 
-    // ٴ Ʈ 
-    m_CommandList->SetPipelineState(m_PipelineStates[RenderLayer::QuadPatch].Get());
-    RenderGeometry(m_RenderItemLayer[(int)RenderLayer::QuadPatch]);
+    // 바닥 오브젝트 렌더링
+    m_CommandList->SetPipelineState(m_PipelineStates[(int)RenderLayer::QuadPatch].Get());
+    RenderGeometry(m_SortedRenderItemLayer[(int)RenderLayer::QuadPatch]);
 
-    // AlphaTested Ʈ 
-    m_CommandList->SetPipelineState(m_PipelineStates[RenderLayer::AlphaTested].Get());
-    RenderGeometry(m_RenderItemLayer[(int)RenderLayer::AlphaTested]);
+    // AlphaTested 오브젝트 렌더링
+    if (m_bInstancing)
+    {
+        m_CommandList->SetPipelineState(m_ObjectPipelines.Get<ShaderFeature_Fog | ShaderFeature_AlphaTested | ShaderFeature_Instanced>().Get());
+        RenderBatches(m_InstanceBatchLayer[(int)RenderLayer::AlphaTested]);
+    }
+    else
+    {
+        m_CommandList->SetPipelineState(m_ObjectPipelines.Get<ShaderFeature_Fog | ShaderFeature_AlphaTested>().Get());
+        RenderGeometry(m_SortedRenderItemLayer[(int)RenderLayer::AlphaTested]);
+    }
 
-    //  Ʈ 
-    m_CommandList->SetPipelineState(m_PipelineStates[RenderLayer::Tree].Get());
-    RenderGeometry(m_RenderItemLayer[(int)RenderLayer::Tree]);
+    // 나무 오브젝트 렌더링
+    m_CommandList->SetPipelineState(m_PipelineStates[(int)RenderLayer::Tree].Get());
+    RenderGeometry(m_SortedRenderItemLayer[(int)RenderLayer::Tree]);
 
-    // Transparent Ʈ 
-    m_CommandList->SetPipelineState(m_PipelineStates[RenderLayer::Transparent].Get());
-    RenderGeometry(m_RenderItemLayer[(int)RenderLayer::Transparent]);
+    // Transparent 오브젝트 렌더링
+    m_CommandList->SetPipelineState(m_PipelineStates[(int)RenderLayer::Transparent].Get());
+    RenderGeometry(m_SortedRenderItemLayer[(int)RenderLayer::Transparent]);
 
-    // ShadowMapDebug Ʈ 
-    m_CommandList->SetPipelineState(m_PipelineStates[RenderLayer::ShadowMapDebug].Get());
-    RenderGeometry(m_RenderItemLayer[(int)RenderLayer::ShadowMapDebug]);
+    // ShadowMapDebug 오브젝트 렌더링
+    m_CommandList->SetPipelineState(m_PipelineStates[(int)RenderLayer::ShadowMapDebug].Get());
+    RenderGeometry(m_SortedRenderItemLayer[(int)RenderLayer::ShadowMapDebug]);
 }
 
 void D3DSample::EndRender()
 {
-    m_CommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(CurrentBackBuffer(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT));
+    if (m_bParallelRecording)
+    {
+        // RenderParallel 에서 닫아 둔 리스트를 기록 순서대로 한 번에 제출 (Present 전환은 마지막 리스트)
+        m_CommandQueue->ExecuteCommandLists((UINT)m_SubmitLists.size(), m_SubmitLists.data());
+    }
+    else
+    {
+        m_CommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(CurrentBackBuffer(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT));
 
-    ThrowIfFailed(m_CommandList->Close());
+        ThrowIfFailed(m_CommandList->Close());
 
-    ID3D12CommandList* CmdsLists[] = { m_CommandList.Get() };
-    m_CommandQueue->ExecuteCommandLists(_countof(CmdsLists), CmdsLists);
+        ID3D12CommandList* CmdsLists[] = { m_CommandList.Get() };
+        m_CommandQueue->ExecuteCommandLists(_countof(CmdsLists), CmdsLists);
+    }
 
     ThrowIfFailed(m_SwapChain->Present(0, 0));
     m_CurrentBackBufferIndex = (m_CurrentBackBufferIndex + 1) % SWAP_CHAIN_BUFFER_COUNT;
 
-    FlushCommandQueue();
+    // GPU 완료를 기다리지 않고 이 슬롯의 펜스 값만 기록 (슬롯을 다시 쓸 때 Update 에서 대기)
+    ++m_CurrentFence;
+    ThrowIfFailed(m_CommandQueue->Signal(m_Fence.Get(), m_CurrentFence));
+
+    m_FrameRing.Advance(m_CurrentFence);
 }
 
 void D3DSample::OnMouseDown(WPARAM btnState, int x, int y)
@@ -192,6 +362,84 @@ void D3DSample::OnMouseMove(WPARAM btnState, int x, int y)
     m_LastMousePos.y = y;
 }
 
+void D3DSample::OnKeyUp(WPARAM key)
+{
+    // Tab : 창 제목에 보여줄 통계 묶음 순환
+    if (key == VK_TAB)
+        m_StatsGroup = (FrameStatsGroup)(((int)m_StatsGroup + 1) % (int)FrameStatsGroup::Count);
+}
+
+std::wstring D3DSample::GetFrameStats() const
+{
+    // 창 제목이 잘리지 않도록 선택한 묶음만 붙이고, 나머지는 초당 한 번 디버그 출력으로 보냄
+    std::wstring Others;
+    for (int i = (int)FrameStatsGroup::None + 1; i < (int)FrameStatsGroup::Count; ++i)
+    {
+        if ((FrameStatsGroup)i != m_StatsGroup)
+            Others += GetFrameStats((FrameStatsGroup)i);
+    }
+    OutputDebugString((L"Frame stats:" + Others + L"\n").c_str());
+
+    return GetFrameStats(m_StatsGroup) + L"   [Tab]";
+}
+
+std::wstring D3DSample::GetFrameStats(FrameStatsGroup group) const
+{
+    switch (group)
+    {
+    case FrameStatsGroup::Culling:
+    {
+        const VegetationCullStats& Stats = m_Vegetation.GetStats();
+
+        return L"   vegetation: " + std::to_wstring(Stats.VisibleInstances) + L"/" + std::to_wstring(Stats.TotalInstances) +
+            L"   cull: " + std::to_wstring(Stats.CullMilliseconds) + L"ms (" +
+            std::to_wstring((UINT)Stats.InstancesPerMillisecond()) + L" inst/ms)" +
+            L"   items: " + std::to_wstring(m_VisibleItems.size()) + L"/" + std::to_wstring(m_CullItems.size()) + L" (" + (m_bUseSceneBVH ? L"bvh " : L"flat ") + std::to_wstring(m_ItemCullMilliseconds) + L"ms cull)" +
+            L"   casters: " + std::to_wstring(m_ShadowCastersDrawn) + L" drawn, " + std::to_wstring(m_ShadowCastersCulled) + L" culled";
+    }
+
+    case FrameStatsGroup::Draws:
+    {
+        UINT StateCalls = 0;
+        UINT StateSkips = 0;
+        for (UINT i = 0; i < (UINT)DrawState::Count; ++i)
+        {
+            StateCalls += m_StateCalls[i].load();
+            StateSkips += m_StateSkips[i].load();
+        }
+
+        const UINT TextureTableIndex = (UINT)DrawState::TextureTable;
+
+        return L"   instancing: " + (m_bInstancing ? std::to_wstring(m_InstancedItems) + L" items in " + std::to_wstring(m_InstancedDraws) + L" draws" : std::wstring(L"off")) +
+            L"   draw state: " + std::to_wstring(StateCalls) + L" set, " + std::to_wstring(StateSkips) + L" skipped" +
+            L"   texture tables: " + std::to_wstring(m_StateCalls[TextureTableIndex].load()) + L" set, " + std::to_wstring(m_StateSkips[TextureTableIndex].load()) + L" skipped" +
+            L"   cb writes: " + std::to_wstring(m_ObjectsWritten) + L" objects, " + std::to_wstring(m_MaterialsWritten) + L" materials (" + std::to_wstring(m_CBBytesWritten) + L" bytes)" +
+            L"   frames in flight: " + std::to_wstring(m_FrameRing.GetFrameCount()) + L" (" + std::to_wstring(m_FrameRing.GetStalls()) + L" cpu waits)" +
+            L"   command lists: " + (m_bParallelRecording ? std::to_wstring(m_SubmitLists.size()) + L" (" + std::to_wstring(m_RecordMilliseconds) + L"ms record)" : std::wstring(L"1"));
+    }
+
+    case FrameStatsGroup::Memory:
+    {
+        const StreamingStats& StreamStats = m_TextureStreamer.GetStats();
+        const GpuMemoryStats GpuStats = m_GpuAllocator.GetStats();
+        const RingAllocatorStats& RingStats = m_UploadRing.GetStats();
+        const DescriptorAllocatorStats& SrvStats = m_SrvHeap.GetStats();
+
+        return L"   textures: " + std::to_wstring(StreamStats.CommittedBytes / 1024) + L"/" + std::to_wstring(StreamStats.BudgetBytes / 1024) + L"KB" +
+            L" (" + std::to_wstring(StreamStats.PendingRequests) + L" pending)" +
+            L"   upload heap: " + std::to_wstring(m_UploadAllocator.GetPeak() / 1024) + L"/" + std::to_wstring(m_UploadAllocator.GetRegionSize() / 1024) + L"KB per frame" +
+            L"   upload ring: " + std::to_wstring(RingStats.UsedBytes / 1024) + L"/" + std::to_wstring(RingStats.Capacity / 1024) + L"KB (" +
+            std::to_wstring(RingStats.AllocatedBytes / (1024 * 1024)) + L"MB uploaded, " + std::to_wstring(m_TextureStreamer.GetDeferredLoads()) + L" loads deferred)" +
+            L"   descriptors: " + std::to_wstring(SrvStats.PersistentUsed) + L"/" + std::to_wstring(SrvStats.PersistentCapacity) + L" + " +
+            std::to_wstring(SrvStats.TransientUsed) + L" transient (" + (m_bBindless ? L"bindless)" : L"tables)") +
+            L"   gpu heaps: " + std::to_wstring(GpuStats.Pools.UsedBytes / (1024 * 1024)) + L"/" + std::to_wstring(GpuStats.Pools.BlockBytes / (1024 * 1024)) + L"MB in " + std::to_wstring(GpuStats.Pools.BlockCount) + L" heaps";
+    }
+
+    default:
+        return std::wstring();
+    }
+}
+
 void D3DSample::BuildShadowMap()
 {
     m_ShadowMapViewport = { 0.0f, 0.0f, (float)m_ShadowMapWidth, (float)m_ShadowMapHeight, 0.0f, 1.0f };
@@ -217,10 +465,9 @@ void D3DSample::BuildShadowMap()
     OptClear.DepthStencil.Depth = 1.0f;
     OptClear.DepthStencil.Stencil = 0;
 
-    ThrowIfFailed(m_D3dDevice->CreateCommittedResource(
-        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
-        D3D12_HEAP_FLAG_NONE,
-        &TexDesc,
+    ThrowIfFailed(m_GpuAllocator.CreateResource(
+        D3D12_HEAP_TYPE_DEFAULT,
+        TexDesc,
         D3D12_RESOURCE_STATE_GENERIC_READ,
         &OptClear,
         IID_PPV_ARGS(&m_ShadowMapResource)));
@@ -228,6 +475,9 @@ void D3DSample::BuildShadowMap()
 
 void D3DSample::BuildGeometry()
 {
+    // 버퍼 크기 : 시작할 때 올리는 메시가 정점 형식마다 버퍼 하나에 들어가는 크기 (기본값 4MB 는 대부분 빈 공간)
+    m_GeometryPool.Initialize(m_D3dDevice.Get(), &m_GpuAllocator, 2 * 1024 * 1024);
+
     CreateBoxGeometry();
     CreateGridGeometry();
     CreateSphereGeometry();
@@ -237,97 +487,111 @@ void D3DSample::BuildGeometry()
     CreateTreeGeometry();
     CreateQuadGeometry();
     CreateSkinnedModel();
+
+    // 모든 메시를 업로드 링에서 한 번에 복사 (초기화 끝의 FlushCommandQueue 가 m_CurrentFence + 1 을 시그널)
+    m_GeometryPool.Execute(m_CommandList.Get(), &m_UploadRing, m_CurrentFence + 1);
+
+    const GeometryPoolStats& Stats = m_GeometryPool.GetStats();
+
+    std::wostringstream Log;
+    Log << L"Geometry: " << Stats.BufferCount << L" buffers, " << Stats.BufferBytes / 1024 << L" KB ("
+        << Stats.UsedBytes / 1024 << L" KB used), " << Stats.StagingBytes / 1024 << L" KB uploaded through " << (Stats.RingUploadCount > 0 ? L"the upload ring; " : L"a separate upload buffer; ")
+        << L"per-mesh buffers would be " << Stats.SeparateResourceCount << L" resources, " << Stats.SeparateBytes / 1024 << L" KB kept\n";
+    OutputDebugString(Log.str().c_str());
+}
+
+void D3DSample::UploadGeometry(GeometryInfo* geometry, const void* vertices, UINT vertexCount, UINT vertexStride, const std::int32_t* indices, UINT indexCount)
+{
+    geometry->VertexCount = vertexCount;
+    geometry->VertexRange = m_GeometryPool.AddVertices(vertices, vertexCount, vertexStride);
+    geometry->VertexBufferView = m_GeometryPool.GetVertexBufferView(geometry->VertexRange);
+    geometry->BaseVertexLocation = (int)geometry->VertexRange.First;
+
+    geometry->IndexCount = indexCount;
+    geometry->IndexRange = m_GeometryPool.AddIndices(reinterpret_cast<const std::uint32_t*>(indices), indexCount);
+    geometry->IndexBufferView = m_GeometryPool.GetIndexBufferView(geometry->IndexRange);
+    geometry->StartIndexLocation = geometry->IndexRange.First;
 }
 
 void D3DSample::BuildTextures()
 {
-    UINT TextureHeapIndex = 0;
-
-    auto BrickTexture = std::make_unique<TextureInfo>();
-    BrickTexture->Name = TEXT("BrickTexture");
-    BrickTexture->FileName = TEXT("../Textures/bricks.dds");
-    BrickTexture->TextureHeapIndex = TextureHeapIndex++;
-    ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(
-        m_D3dDevice.Get(),
-        m_CommandList.Get(),
-        BrickTexture->FileName.c_str(),
-        BrickTexture->Resource,
-        BrickTexture->UploadHeap));
-    m_Textures[BrickTexture->Name] = std::move(BrickTexture);
-
-    auto BrickNormal = std::make_unique<TextureInfo>();
-    BrickNormal->Name = TEXT("BrickNormal");
-    BrickNormal->FileName = TEXT("../Textures/bricks_nmap.dds");
-    BrickNormal->TextureHeapIndex = TextureHeapIndex++;
-    ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(
-        m_D3dDevice.Get(),
-        m_CommandList.Get(),
-        BrickNormal->FileName.c_str(),
-        BrickNormal->Resource,
-        BrickNormal->UploadHeap));
-    m_Textures[BrickNormal->Name] = std::move(BrickNormal);
-
-    auto StoneTexture = std::make_unique<TextureInfo>();
-    StoneTexture->Name = TEXT("StoneTexture");
-    StoneTexture->FileName = TEXT("../Textures/stone.dds");
-    StoneTexture->TextureHeapIndex = TextureHeapIndex++;
-    ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(
-        m_D3dDevice.Get(),
-        m_CommandList.Get(),
-        StoneTexture->FileName.c_str(),
-        StoneTexture->Resource,
-        StoneTexture->UploadHeap));
-    m_Textures[StoneTexture->Name] = std::move(StoneTexture);
-
-    auto TileTexture = std::make_unique<TextureInfo>();
-    TileTexture->Name = TEXT("TileTexture");
-    TileTexture->FileName = TEXT("../Textures/tile.dds");
-    TileTexture->TextureHeapIndex = TextureHeapIndex++;
-    ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(
-        m_D3dDevice.Get(),
-        m_CommandList.Get(),
-        TileTexture->FileName.c_str(),
-        TileTexture->Resource,
-        TileTexture->UploadHeap));
-    m_Textures[TileTexture->Name] = std::move(TileTexture);
-
-    auto TileNormal = std::make_unique<TextureInfo>();
-    TileNormal->Name = TEXT("TileNormal");
-    TileNormal->FileName = TEXT("../Textures/tile_nmap.dds");
-    TileNormal->TextureHeapIndex = TextureHeapIndex++;
-    ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(
-        m_D3dDevice.Get(),
-        m_CommandList.Get(),
-        TileNormal->FileName.c_str(),
-        TileNormal->Resource,
-        TileNormal->UploadHeap));
-    m_Textures[TileNormal->Name] = std::move(TileNormal);
-
-    auto FenceTexture = std::make_unique<TextureInfo>();
-    FenceTexture->Name = TEXT("FenceTexture");
-    FenceTexture->FileName = TEXT("../Textures/WireFence.dds");
-    FenceTexture->TextureHeapIndex = TextureHeapIndex++;
-    ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(
-        m_D3dDevice.Get(),
-        m_CommandList.Get(),
-        FenceTexture->FileName.c_str(),
-        FenceTexture->Resource,
-        FenceTexture->UploadHeap));
-    m_Textures[FenceTexture->Name] = std::move(FenceTexture);
-
-
-    auto TreeTexture = std::make_unique<TextureInfo>();
-    TreeTexture->Name = TEXT("TreeTexture");
-    TreeTexture->FileName = TEXT("../Textures/treearray.dds");
-    TreeTexture->TextureHeapIndex = TextureHeapIndex++;
-    TreeTexture->TextureType = ETextureType::Texture2DArray;
-    ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(
-        m_D3dDevice.Get(),
-        m_CommandList.Get(),
-        TreeTexture->FileName.c_str(),
-        TreeTexture->Resource,
-        TreeTexture->UploadHeap));
-    m_Textures[TreeTexture->Name] = std::move(TreeTexture);
+    struct TextureFile
+    {
+        const TCHAR* Name;
+        const TCHAR* FileName;
+        ETextureType TextureType;
+    };
+
+    // 로드 순서 = 테이블 순서
+    static const TextureFile TextureTable[] =
+    {
+        { TEXT("BrickTexture"), TEXT("../Textures/bricks.dds"),      ETextureType::Texture2D },
+        { TEXT("BrickNormal"),  TEXT("../Textures/bricks_nmap.dds"), ETextureType::Texture2D },
+        { TEXT("StoneTexture"), TEXT("../Textures/stone.dds"),       ETextureType::Texture2D },
+        { TEXT("TileTexture"),  TEXT("../Textures/tile.dds"),        ETextureType::Texture2D },
+        { TEXT("TileNormal"),   TEXT("../Textures/tile_nmap.dds"),   ETextureType::Texture2D },
+        { TEXT("FenceTexture"), TEXT("../Textures/WireFence.dds"),   ETextureType::Texture2D },
+        { TEXT("TreeTexture"),  TEXT("../Textures/treearray.dds"),   ETextureType::Texture2DArray },
+    };
+
+    // 스트리밍 텍스처는 이 크기 이하의 밉만 시작 시 로드
+    const UINT StreamingTailSize = 64;
+
+    // 로더 인덱스 순서대로 결과를 받을 텍스처
+    std::vector<TextureInfo*> PendingTextures;
+    std::vector<bool> PendingStreamed;
+
+    auto AddTexture = [&](std::unique_ptr<TextureInfo>& Texture, bool bStream)
+    {
+        Texture->TextureHeapIndex = m_SrvHeap.AllocatePersistent();
+        m_TextureLoader.Add(Texture->FileName, bStream ? StreamingTailSize : 0);
+        PendingTextures.push_back(Texture.get());
+        PendingStreamed.push_back(bStream);
+    };
+
+    // TextureTool pack 결과가 있으면 묶인 원본 대신 팩을 로드
+    std::vector<TextureInfo*> PackTextures;
+    if (m_TexturePacks.Load(std::wstring(TEXT("../Textures/Packed/packs.txt"))))
+    {
+        const std::vector<std::string>& Packs = m_TexturePacks.GetPacks();
+        for (size_t i = 0; i < Packs.size(); ++i)
+        {
+            auto Texture = std::make_unique<TextureInfo>();
+            Texture->Name = TEXT("Pack") + std::to_wstring(i);
+            Texture->FileName = TEXT("../Textures/Packed/") + AnsiToWString(Packs[i]);
+            Texture->TextureType = ETextureType::Texture2DArray;
+            AddTexture(Texture, true);
+            PackTextures.push_back(Texture.get());
+            m_Textures[Texture->Name] = std::move(Texture);
+        }
+    }
+    else
+    {
+        m_TexturePacks.Clear();
+    }
+
+    for (const TextureFile& File : TextureTable)
+    {
+        auto Texture = std::make_unique<TextureInfo>();
+        Texture->Name = File.Name;
+        Texture->FileName = File.FileName;
+        Texture->TextureType = File.TextureType;
+
+        // 팩에 들어간 텍스처는 리소스 없이 팩과 팩 안의 위치만 기록
+        const TexturePackPlacement* Placement = m_TexturePacks.Find(Texture->FileName);
+        if (Placement != nullptr)
+        {
+            Texture->Pack = PackTextures[Placement->PackIndex];
+            Texture->ArraySlice = Placement->Slice;
+            Texture->UvScaleBias = XMFLOAT4(Placement->Scale[0], Placement->Scale[1], Placement->Bias[0], Placement->Bias[1]);
+        }
+        else
+        {
+            AddTexture(Texture, true);
+        }
+
+        m_Textures[Texture->Name] = std::move(Texture);
+    }
 
     // Skinned Object Texture
     for (size_t i = 0; i < m_SkinnedMaterials.size(); ++i)
@@ -347,15 +611,7 @@ void D3DSample::BuildTextures()
             auto TexDiff = std::make_unique<TextureInfo>();
             TexDiff->Name = diffuseName;
             TexDiff->FileName = diffuseFileName;
-            TexDiff->TextureHeapIndex = TextureHeapIndex++;
-
-            ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(
-                m_D3dDevice.Get(),
-                m_CommandList.Get(),
-                TexDiff->FileName.c_str(),
-                TexDiff->Resource,
-                TexDiff->UploadHeap));
-
+            AddTexture(TexDiff, true);
             m_Textures[TexDiff->Name] = std::move(TexDiff);
         }
  
@@ -365,43 +621,72 @@ void D3DSample::BuildTextures()
             auto TexNor = std::make_unique<TextureInfo>();
             TexNor->Name = normalName;
             TexNor->FileName = normalFileName;
-            TexNor->TextureHeapIndex = TextureHeapIndex++;
-
-            ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(
-                m_D3dDevice.Get(),
-                m_CommandList.Get(),
-                TexNor->FileName.c_str(),
-                TexNor->Resource,
-                TexNor->UploadHeap));
-
+            AddTexture(TexNor, true);
             m_Textures[TexNor->Name] = std::move(TexNor);
         }
     }
 
-    // ī̹ڽ  ؽó 迭  ߰  ؽó
-    // ī̹ڽ ؽó ϱ
+    // 스카이박스는 모든 텍스처 배열 다음에 추가한 개별 텍스처
+    // 스카이박스 텍스처 생성하기
     m_SkyboxTexture = std::make_unique<TextureInfo>();
     m_SkyboxTexture->Name = TEXT("Skybox");
     m_SkyboxTexture->FileName = TEXT("../Textures/grasscube1024.dds");
-    m_SkyboxTexture->TextureHeapIndex = TextureHeapIndex++;
-    ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(
-        m_D3dDevice.Get(),
-        m_CommandList.Get(),
-        m_SkyboxTexture->FileName.c_str(),
-        m_SkyboxTexture->Resource,
-        m_SkyboxTexture->UploadHeap));
+    AddTexture(m_SkyboxTexture, false);
+
+    // 파일 읽기/검증은 워커 스레드에서 병렬로, 업로드는 하나의 스테이징 버퍼로 일괄 기록
+    m_TextureLoader.Execute(m_D3dDevice.Get(), m_CommandList.Get(), *m_ThreadPool);
+
+    m_TextureStreamer.SetBudget(m_TextureStreamingBudget);
+
+    for (size_t i = 0; i < PendingTextures.size(); ++i)
+    {
+        TextureInfo* Texture = PendingTextures[i];
+        Texture->Resource = m_TextureLoader.GetResource((UINT)i);
+
+        // 상위 밉은 화면 크기에 따라 UpdateTextureStreaming 에서 로드
+        if (PendingStreamed[i])
+        {
+            Texture->StreamIndex = (int)m_TextureStreamer.Register(Texture->FileName, Texture->Resource, m_TextureLoader.GetFirstMip((UINT)i));
+            m_StreamedTextures.push_back(Texture);
+        }
+    }
+
+    const TextureBatchStats& Stats = m_TextureLoader.GetStats();
+
+    std::wostringstream Log;
+    Log << L"Textures: " << Stats.TextureCount << L" files, " << Stats.SubresourceCount << L" subresources, "
+        << Stats.FileBytes / 1024 << L" KB read, " << Stats.StagingBytes / 1024 << L" KB staging, "
+        << L"parse " << Stats.ParseMilliseconds << L" ms, copy " << Stats.CopyMilliseconds << L" ms\n";
+    OutputDebugString(Log.str().c_str());
 }
 
 void D3DSample::BuildMaterials()
 {
     UINT MatCBIndex = 0;
 
+    // 팩에 들어간 텍스처는 팩의 서술자와 슬라이스, 아틀라스 UV 변환을 함께 사용
+    auto BindTexture = [&](MaterialInfo* Material, const std::wstring& TextureName)
+    {
+        TextureInfo* Texture = m_Textures[TextureName].get();
+        Material->Texture_On = 1;
+        Material->DiffuseTexture = Texture->Pack != nullptr ? Texture->Pack : Texture;
+        Material->TextureSlice = Texture->ArraySlice;
+        Material->TextureScaleBias = Texture->UvScaleBias;
+    };
+
+    // 노멀 맵은 색상 텍스처의 슬라이스 / UV 변환을 그대로 씀 (노멀 팩은 색상 팩과 같은 배치)
+    auto BindNormal = [&](MaterialInfo* Material, const std::wstring& TextureName)
+    {
+        TextureInfo* Texture = m_Textures[TextureName].get();
+        Material->Normal_On = 1;
+        Material->NormalTexture = Texture->Pack != nullptr ? Texture->Pack : Texture;
+    };
+
     auto Brick = std::make_unique<MaterialInfo>();
     Brick->Name = TEXT("Brick");
     Brick->MatCBIndex = MatCBIndex++;
-    Brick->Texture_On = 1;
-    Brick->TextureHeapIndex = m_Textures[TEXT("BrickTexture")]->TextureHeapIndex;
-    Brick->Normal_On = 1;
+    BindTexture(Brick.get(), TEXT("BrickTexture"));
+    BindNormal(Brick.get(), TEXT("BrickNormal"));
     Brick->Albedo = XMFLOAT4(Colors::LightGray);
     Brick->Fresnel = XMFLOAT3(0.02f, 0.02f, 0.02f);
     Brick->Roughness = 0.1f;
@@ -409,8 +694,7 @@ void D3DSample::BuildMaterials()
 
     auto Stone = std::make_unique<MaterialInfo>();
     Stone->Name = TEXT("Stone");
-    Stone->Texture_On = 1;
-    Stone->TextureHeapIndex = m_Textures[TEXT("StoneTexture")]->TextureHeapIndex;
+    BindTexture(Stone.get(), TEXT("StoneTexture"));
     Stone->MatCBIndex = MatCBIndex++;
     Stone->Albedo = XMFLOAT4(Colors::LightSteelBlue);
     Stone->Fresnel = XMFLOAT3(0.05f, 0.05f, 0.05f);
@@ -419,9 +703,8 @@ void D3DSample::BuildMaterials()
 
     auto Tile = std::make_unique<MaterialInfo>();
     Tile->Name = TEXT("Tile");
-    Tile->Texture_On = 1;
-    Tile->TextureHeapIndex = m_Textures[TEXT("TileTexture")]->TextureHeapIndex;
-    Tile->Normal_On = 1;
+    BindTexture(Tile.get(), TEXT("TileTexture"));
+    BindNormal(Tile.get(), TEXT("TileNormal"));
     Tile->MatCBIndex = MatCBIndex++;
     Tile->Albedo = XMFLOAT4(Colors::LightGray);
     Tile->Fresnel = XMFLOAT3(0.02f, 0.02f, 0.02f);
@@ -430,8 +713,7 @@ void D3DSample::BuildMaterials()
 
     auto Fence = std::make_unique<MaterialInfo>();
     Fence->Name = TEXT("Fence");
-    Fence->Texture_On = 1;
-    Fence->TextureHeapIndex = m_Textures[TEXT("FenceTexture")]->TextureHeapIndex;
+    BindTexture(Fence.get(), TEXT("FenceTexture"));
     Fence->MatCBIndex = MatCBIndex++;
     Fence->Albedo = XMFLOAT4(Colors::White);
     Fence->Fresnel = XMFLOAT3(0.1f, 0.1f, 0.1f);
@@ -446,7 +728,7 @@ void D3DSample::BuildMaterials()
     Skull->Roughness = 0.3f;
     m_Materials[Skull->Name] = std::move(Skull);
 
-    // ī̹ڽ  ߰
+    // 스카이박스 재질 추가
     auto Skybox = std::make_unique<MaterialInfo>();
     Skybox->Name = TEXT("Skybox");
     Skybox->MatCBIndex = MatCBIndex++;
@@ -455,7 +737,7 @@ void D3DSample::BuildMaterials()
     Skybox->Roughness = 1.0f;
     m_Materials[Skybox->Name] = std::move(Skybox);
 
-    // ſ ݻ 
+    // 거울 반사 재질
     auto Mirror = std::make_unique<MaterialInfo>();
     Mirror->Name = TEXT("Mirror");
     Mirror->MatCBIndex = MatCBIndex++;
@@ -464,12 +746,11 @@ void D3DSample::BuildMaterials()
     Mirror->Roughness = 0.1f;
     m_Materials[Mirror->Name] = std::move(Mirror);
 
-    //  
+    // 나무 재질
     auto Tree = std::make_unique<MaterialInfo>();
     Tree->Name = TEXT("Tree");
     Tree->MatCBIndex = MatCBIndex++;
-    Tree->Texture_On = 1;
-    Tree->TextureHeapIndex = m_Textures[TEXT("TreeTexture")]->TextureHeapIndex;
+    BindTexture(Tree.get(), TEXT("TreeTexture"));
     Tree->Albedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
     Tree->Fresnel = XMFLOAT3(0.1f, 0.1f, 0.1f);
     Tree->Roughness = 0.1f;
@@ -489,12 +770,11 @@ void D3DSample::BuildMaterials()
         SkinnedMat->MatCBIndex = MatCBIndex++;
         if (m_Textures[diffuseName])
         {
-            SkinnedMat->Texture_On = 1;
-            SkinnedMat->TextureHeapIndex = m_Textures[diffuseName]->TextureHeapIndex;
+            BindTexture(SkinnedMat.get(), diffuseName);
         }
         if (m_Textures[normalName])
         {
-            SkinnedMat->Normal_On = 1;
+            BindNormal(SkinnedMat.get(), normalName);
         }
         SkinnedMat->Albedo = m_SkinnedMaterials[i].DiffuseAlbedo;
         SkinnedMat->Fresnel = m_SkinnedMaterials[i].FresnelR0;
@@ -575,16 +855,17 @@ void D3DSample::BuildRenderItems()
         m_RenderItems.push_back(std::move(RightSphereItem));
     }
 
-    // ī̹ڽ Ʈ 
+    // 스카이박스 오브젝트 생성
     auto SkyboxItem = std::make_unique<RenderItem>();
     SkyboxItem->ObjectCBIndex = ObjectCBIndex++;
     XMStoreFloat4x4(&SkyboxItem->World, XMMatrixScaling(5000.0f, 5000.0f, 5000.0f));
     SkyboxItem->Geometry = m_Geometries[TEXT("Box")].get();
     SkyboxItem->Material = m_Materials[TEXT("Skybox")].get();
+    SkyboxItem->bCullable = false;
     m_RenderItemLayer[(int)RenderLayer::Skybox].push_back(SkyboxItem.get());
     m_RenderItems.push_back(std::move(SkyboxItem));
 
-    ////  ؽó  Ʈ 
+    //// 쉐도우맵 텍스처 쿼드 오브젝트 생성
     //auto QuadItem = std::make_unique<RenderItem>();
     //QuadItem->ObjectCBIndex = ObjectCBIndex++;
     //QuadItem->World = MathHelper::Identity4x4();
@@ -594,7 +875,7 @@ void D3DSample::BuildRenderItems()
     //m_RenderItems.push_back(std::move(QuadItem));
 
 
-    //// ٴ Ʈ 
+    //// 바닥 오브젝트 생성
     //auto QuadPathItem = std::make_unique<RenderItem>();
     //QuadPathItem->ObjectCBIndex = ObjectCBIndex++;
     //QuadPathItem->World = MathHelper::Identity4x4();
@@ -604,17 +885,17 @@ void D3DSample::BuildRenderItems()
     //m_RenderItemLayer[(int)RenderLayer::QuadPatch].push_back(QuadPathItem.get());
     //m_RenderItems.push_back(std::move(QuadPathItem));
 
-    ////  Ʈ 
-    //auto TreeItem = std::make_unique<RenderItem>();
-    //TreeItem->ObjectCBIndex = ObjectCBIndex++;
-    //TreeItem->World = MathHelper::Identity4x4();
-    //TreeItem->Geometry = m_Geometries[TEXT("Tree")].get();
-    //TreeItem->Material = m_Materials[TEXT("Tree")].get();
-    //TreeItem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_POINTLIST;
-    //m_RenderItemLayer[(int)RenderLayer::Tree].push_back(TreeItem.get());
-    //m_RenderItems.push_back(std::move(TreeItem));
-
-    // Skinned Object 
+    // 나무 오브젝트 생성
+    auto TreeItem = std::make_unique<RenderItem>();
+    TreeItem->ObjectCBIndex = ObjectCBIndex++;
+    TreeItem->World = MathHelper::Identity4x4();
+    TreeItem->Geometry = m_Geometries[TEXT("Tree")].get();
+    TreeItem->Material = m_Materials[TEXT("Tree")].get();
+    TreeItem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_POINTLIST;
+    m_RenderItemLayer[(int)RenderLayer::Tree].push_back(TreeItem.get());
+    m_RenderItems.push_back(std::move(TreeItem));
+
+    // Skinned Object 생성
     for (size_t i = 0; i < m_SkinnedSubsets.size(); ++i)
     {
         std::wstring subMeshName = TEXT("sm_") + std::to_wstring(i);
@@ -635,125 +916,140 @@ void D3DSample::BuildRenderItems()
         m_RenderItemLayer[(int)RenderLayer::SkinnedOpaque].push_back(SkinnedItem.get());
         m_RenderItems.push_back(std::move(SkinnedItem));
     }
-}
 
-void D3DSample::BuildConstantBuffer()
-{
-    // Ʈ   
-    UINT ObjectSize = sizeof(ObjectConstant);
-    m_ObjectByteSize = ((ObjectSize + 255) & ~255) * (UINT)m_RenderItems.size();
+    // 절두체 컬링용 로컬 AABB 와 월드 행렬 (아이템은 움직이지 않으므로 한 번만 등록)
+    std::vector<BVHBounds> WorldBounds;
+    m_FrustumCuller.Clear();
+    m_CullItems.clear();
+    for (const auto& Item : m_RenderItems)
+    {
+        if (!Item->bCullable)
+            continue;
 
-    D3D12_RESOURCE_DESC ObjectDesc = CD3DX12_RESOURCE_DESC::Buffer(m_ObjectByteSize);
-    D3D12_HEAP_PROPERTIES ObjectHeap = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+        BoundingBox Bounds = Item->Geometry->Bounds;
 
-    m_D3dDevice->CreateCommittedResource(
-        &ObjectHeap,
-        D3D12_HEAP_FLAG_NONE,
-        &ObjectDesc,
-        D3D12_RESOURCE_STATE_GENERIC_READ,
-        nullptr,
-        IID_PPV_ARGS(&m_ObjectCB));
+        // 애니메이션으로 바인드 포즈 경계 밖으로 나갈 수 있으므로 여유를 둠
+        if (Item->SkinnedAnimation != nullptr)
+            XMStoreFloat3(&Bounds.Extents, XMVectorScale(XMLoadFloat3(&Bounds.Extents), 1.5f));
 
-    m_ObjectCB->Map(0, nullptr, reinterpret_cast<void**>(&m_ObjectMappedData));
+        Item->CullIndex = m_FrustumCuller.AddItem(&Bounds.Center.x, &Bounds.Extents.x, &Item->World.m[0][0]);
+        m_CullItems.push_back(Item.get());
+        WorldBounds.push_back(BVHBounds::FromLocalBox(&Bounds.Center.x, &Bounds.Extents.x, &Item->World.m[0][0]));
+    }
 
-    //    
-    UINT PassSize = sizeof(PassConstant);
-    m_PassByteSize = ((PassSize + 255) & ~255) * 2;
+    // 정적 배치이므로 SAH 로 한 번에 빌드, 움직이는 아이템이 생기면 Move 로 갱신
+    m_SceneBVH.BuildStatic(WorldBounds.data(), (UINT)WorldBounds.size());
 
-    D3D12_RESOURCE_DESC PassDesc = CD3DX12_RESOURCE_DESC::Buffer(m_PassByteSize);
-    D3D12_HEAP_PROPERTIES PassHeap = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+    // 정렬 키용 지오메트리 번호 (처음 쓰인 순서)
+    UINT GeometrySortId = 0;
+    std::unordered_map<GeometryInfo*, UINT> GeometrySortIds;
+    for (const auto& Item : m_RenderItems)
+    {
+        if (GeometrySortIds.emplace(Item->Geometry, GeometrySortId).second)
+            Item->Geometry->SortId = GeometrySortId++;
+    }
+}
 
-    m_D3dDevice->CreateCommittedResource(
-        &PassHeap,
-        D3D12_HEAP_FLAG_NONE,
-        &PassDesc,
-        D3D12_RESOURCE_STATE_GENERIC_READ,
-        nullptr,
-        IID_PPV_ARGS(&m_PassCB));
+void D3DSample::BuildFrameResources()
+{
+    for (FrameResource& Frame : m_FrameResources)
+    {
+        ThrowIfFailed(m_D3dDevice->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&Frame.CommandAlloc)));
+    }
+}
 
-    m_PassCB->Map(0, nullptr, reinterpret_cast<void**>(&m_PassMappedData));
+void D3DSample::BuildConstantBuffer()
+{
+    m_MaterialsByCBIndex.assign(m_Materials.size(), nullptr);
+    for (auto& Material : m_Materials)
+    {
+        m_MaterialsByCBIndex[Material.second->MatCBIndex] = Material.second.get();
+    }
 
-    //    
-    UINT MaterialSize = sizeof(MatConstant);
-    m_MaterialByteSize = ((MaterialSize + 255) & ~255) * m_Materials.size();
+    // 상수 버퍼 / 인스턴스 버퍼는 모두 프레임 업로드 힙에서 매 프레임 할당
+    ReserveUploadHeap();
+}
 
-    D3D12_RESOURCE_DESC MaterialDesc = CD3DX12_RESOURCE_DESC::Buffer(m_MaterialByteSize);
-    D3D12_HEAP_PROPERTIES MaterialHeap = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+void D3DSample::ReserveUploadHeap()
+{
+    // 한 프레임이 할당하는 최대 크기 (인스턴스 레코드는 아이템마다 하나,
+    // 인덱스 목록은 메인 패스와 쉐도우 패스가 같은 레코드를 가리키므로 아이템 수의 두 배까지)
+    UINT64 ObjectSize = (UINT64)d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstant)) * m_RenderItems.size();
+    UINT64 MaterialSize = (UINT64)d3dUtil::CalcConstantBufferByteSize(sizeof(MatConstant)) * m_MaterialsByCBIndex.size();
+    UINT64 PassSize = (UINT64)d3dUtil::CalcConstantBufferByteSize(sizeof(PassConstant)) * 2;
+    UINT64 SkinnedSize = d3dUtil::CalcConstantBufferByteSize(sizeof(SkinnedConstant));
+    UINT64 InstanceSize = FrameUploadAllocator::AlignUp(sizeof(InstanceData) * m_RenderItems.size(), FrameUploadAllocator::DefaultAlignment);
+    UINT64 InstanceIndexSize = FrameUploadAllocator::AlignUp(sizeof(UINT) * m_RenderItems.size() * 2, FrameUploadAllocator::DefaultAlignment);
+    UINT64 FrameSize = ObjectSize + MaterialSize + PassSize + SkinnedSize + InstanceSize + InstanceIndexSize;
+
+    // 오브젝트 (+ 인스턴스 레코드) / 재질 블록은 매 프레임 가장 먼저 같은 크기로 할당되어 슬롯 안 위치가 고정되므로
+    // 바뀐 값만 기록해도 됨. 개수가 바뀌면 위치도 바뀌므로 모든 슬롯에 다시 기록
+    bool bLayoutChanged = m_ObjectDirty.GetCount() != (UINT)m_RenderItems.size() ||
+        m_MaterialDirty.GetCount() != (UINT)m_MaterialsByCBIndex.size();
+
+    if (m_UploadHeap == nullptr || FrameSize > m_UploadAllocator.GetRegionSize())
+    {
+        // 이전 힙을 쓰는 프레임이 모두 끝난 뒤 교체 (장면이 커질 때만 일어나므로 대기를 허용)
+        if (m_UploadHeap != nullptr)
+        {
+            WaitForGpu(m_CurrentFence);
+            m_UploadHeap->Unmap(0, nullptr);
+            m_UploadHeap = nullptr;
+        }
 
-    m_D3dDevice->CreateCommittedResource(
-        &MaterialHeap,
-        D3D12_HEAP_FLAG_NONE,
-        &MaterialDesc,
-        D3D12_RESOURCE_STATE_GENERIC_READ,
-        nullptr,
-        IID_PPV_ARGS(&m_MaterialCB));
+        // 아이템이 조금씩 늘 때마다 다시 만들지 않도록 여유를 둠
+        m_UploadAllocator.Reset(FrameSize + FrameSize / 4, FRAME_RESOURCE_COUNT);
 
-    m_MaterialCB->Map(0, nullptr, reinterpret_cast<void**>(&m_MaterialMappedData));
+        D3D12_RESOURCE_DESC UploadDesc = CD3DX12_RESOURCE_DESC::Buffer(m_UploadAllocator.GetBufferSize());
+        D3D12_HEAP_PROPERTIES UploadHeap = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
 
-    // Ų Ʈ   
-    UINT SkinnedSize = sizeof(SkinnedConstant);
-    m_SkinnedByteSize = ((SkinnedSize + 255) & ~255);
+        ThrowIfFailed(m_D3dDevice->CreateCommittedResource(
+            &UploadHeap,
+            D3D12_HEAP_FLAG_NONE,
+            &UploadDesc,
+            D3D12_RESOURCE_STATE_GENERIC_READ,
+            nullptr,
+            IID_PPV_ARGS(&m_UploadHeap)));
 
-    D3D12_RESOURCE_DESC SkinnedDesc = CD3DX12_RESOURCE_DESC::Buffer(m_SkinnedByteSize);
-    D3D12_HEAP_PROPERTIES SkinnedHeap = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+        // 업로드 힙은 계속 매핑해 둠
+        ThrowIfFailed(m_UploadHeap->Map(0, nullptr, reinterpret_cast<void**>(&m_UploadMappedData)));
 
-    m_D3dDevice->CreateCommittedResource(
-        &SkinnedHeap,
-        D3D12_HEAP_FLAG_NONE,
-        &SkinnedDesc,
-        D3D12_RESOURCE_STATE_GENERIC_READ,
-        nullptr,
-        IID_PPV_ARGS(&m_SkinnedCB));
+        // 새 힙에는 아무 값도 없음
+        bLayoutChanged = true;
+    }
+
+    if (bLayoutChanged)
+    {
+        m_ObjectDirty.Reset((UINT)m_RenderItems.size());
+        m_MaterialDirty.Reset((UINT)m_MaterialsByCBIndex.size());
+    }
+}
 
-    m_SkinnedCB->Map(0, nullptr, reinterpret_cast<void**>(&m_SkinnedMappedData));
+UploadAllocation D3DSample::AllocateUpload(UINT64 byteSize)
+{
+    UINT64 Offset = m_UploadAllocator.Allocate(byteSize);
+
+    // ReserveUploadHeap 이 프레임 최대 크기를 확보하므로 여기서 모자라면 크기 계산이 잘못된 것
+    if (Offset == FrameUploadAllocator::InvalidOffset)
+        ThrowIfFailed(E_OUTOFMEMORY);
+
+    UploadAllocation Allocation;
+    Allocation.CpuAddress = m_UploadMappedData + Offset;
+    Allocation.GpuAddress = m_UploadHeap->GetGPUVirtualAddress() + Offset;
+    return Allocation;
 }
 
 void D3DSample::BuildDescriptorHeap()
 {
     // SRV Heap
-    // ؽó   + ī̹ڽ ؽó  +   ؽó 
-    D3D12_DESCRIPTOR_HEAP_DESC TextureHeapDesc = {};
-    TextureHeapDesc.NumDescriptors = m_Textures.size() + 1 + 1;
-    TextureHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-    TextureHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
-    ThrowIfFailed(m_D3dDevice->CreateDescriptorHeap(&TextureHeapDesc, IID_PPV_ARGS(&m_TextureDescriptorHeap)));
-
+    // 텍스처 슬롯은 BuildTextures 에서 할당 (팩에 들어간 텍스처는 슬롯 없음)
     for (auto& Texture : m_Textures)
     {
-        TextureInfo* TexInfo = Texture.second.get();
-
-        CD3DX12_CPU_DESCRIPTOR_HANDLE hDescriptor(m_TextureDescriptorHeap->GetCPUDescriptorHandleForHeapStart());
-        hDescriptor.Offset(TexInfo->TextureHeapIndex, m_CbvSrvUavDescriptorSize);
-
-        auto TexResource = TexInfo->Resource;
-        D3D12_SHADER_RESOURCE_VIEW_DESC TexDesc = {};
-        TexDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-        TexDesc.Format = TexResource->GetDesc().Format;
-
-        switch (TexInfo->TextureType)
-        {
-        case ETextureType::Texture2D:
-            TexDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-            TexDesc.Texture2D.MostDetailedMip = 0;
-            TexDesc.Texture2D.MipLevels = TexResource->GetDesc().MipLevels;
-            TexDesc.Texture2D.ResourceMinLODClamp = 0.0f;
-            break;
-        case ETextureType::Texture2DArray:
-            TexDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
-            TexDesc.Texture2DArray.MostDetailedMip = 0;
-            TexDesc.Texture2DArray.MipLevels = -1;
-            TexDesc.Texture2DArray.FirstArraySlice = 0;
-            TexDesc.Texture2DArray.ArraySize = TexResource->GetDesc().DepthOrArraySize;
-            break;
-        }        
-
-        m_D3dDevice->CreateShaderResourceView(TexResource.Get(), &TexDesc, hDescriptor);
-    }
-
-    // ī̹ڽ ؽó  ϱ
-    CD3DX12_CPU_DESCRIPTOR_HANDLE hDescriptor(m_TextureDescriptorHeap->GetCPUDescriptorHandleForHeapStart());
-    hDescriptor.Offset(m_SkyboxTexture->TextureHeapIndex, m_CbvSrvUavDescriptorSize);
+        if (Texture.second->Resource)
+            CreateTextureSRV(Texture.second.get());
+    }
 
+    // 스카이박스 텍스처 서술자 생성하기
     auto SkyboxResource = m_SkyboxTexture->Resource;
     D3D12_SHADER_RESOURCE_VIEW_DESC SkyboxDesc = {};
     SkyboxDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
@@ -763,13 +1059,11 @@ void D3DSample::BuildDescriptorHeap()
     SkyboxDesc.TextureCube.MipLevels = SkyboxResource->GetDesc().MipLevels;
     SkyboxDesc.TextureCube.ResourceMinLODClamp = 0.0f;
 
-    m_D3dDevice->CreateShaderResourceView(SkyboxResource.Get(), &SkyboxDesc, hDescriptor);
-
-    //   ؽó 
-    m_ShadowMapHeapIndex = (UINT)m_SkyboxTexture->TextureHeapIndex + 1;
+    m_D3dDevice->CreateShaderResourceView(SkyboxResource.Get(), &SkyboxDesc, m_SrvHeap.GetStagingHandle(m_SkyboxTexture->TextureHeapIndex));
+    m_SrvHeap.Publish(m_SkyboxTexture->TextureHeapIndex);
 
-    CD3DX12_CPU_DESCRIPTOR_HANDLE hSrvDescriptor(m_TextureDescriptorHeap->GetCPUDescriptorHandleForHeapStart());
-    hSrvDescriptor.Offset(m_ShadowMapHeapIndex, m_CbvSrvUavDescriptorSize);
+    // 쉐도우 맵 텍스처 서술자
+    m_ShadowMapHeapIndex = m_SrvHeap.AllocatePersistent();
 
     D3D12_SHADER_RESOURCE_VIEW_DESC ShadowMapDesc;
     ShadowMapDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
@@ -780,7 +1074,33 @@ void D3DSample::BuildDescriptorHeap()
     ShadowMapDesc.Texture2D.ResourceMinLODClamp = 0.0f;
     ShadowMapDesc.Texture2D.PlaneSlice = 0;
 
-    m_D3dDevice->CreateShaderResourceView(m_ShadowMapResource.Get(), &ShadowMapDesc, hSrvDescriptor);
+    m_D3dDevice->CreateShaderResourceView(m_ShadowMapResource.Get(), &ShadowMapDesc, m_SrvHeap.GetStagingHandle(m_ShadowMapHeapIndex));
+    m_SrvHeap.Publish(m_ShadowMapHeapIndex);
+}
+
+void D3DSample::CreateTextureSRV(TextureInfo* texture)
+{
+    auto TexResource = texture->Resource;
+    D3D12_SHADER_RESOURCE_VIEW_DESC TexDesc = {};
+    TexDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+    TexDesc.Format = TexResource->GetDesc().Format;
+
+    // 셰이더는 t0/t1 을 Texture2DArray 로 받으므로 일반 텍스처도 슬라이스 1개짜리 배열 뷰로 생성
+    switch (texture->TextureType)
+    {
+    case ETextureType::Texture2D:
+    case ETextureType::Texture2DArray:
+        TexDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
+        TexDesc.Texture2DArray.MostDetailedMip = 0;
+        TexDesc.Texture2DArray.MipLevels = -1;
+        TexDesc.Texture2DArray.FirstArraySlice = 0;
+        TexDesc.Texture2DArray.ArraySize = TexResource->GetDesc().DepthOrArraySize;
+        break;
+    }
+
+    // 스테이징 힙에 만든 뒤 셰이더 힙의 같은 슬롯으로 복사
+    m_D3dDevice->CreateShaderResourceView(TexResource.Get(), &TexDesc, m_SrvHeap.GetStagingHandle(texture->TextureHeapIndex));
+    m_SrvHeap.Publish(texture->TextureHeapIndex);
 }
 
 void D3DSample::BuildDsvDescriptorHeap()
@@ -799,47 +1119,74 @@ void D3DSample::BuildDsvDescriptorHeap()
 
 void D3DSample::BuildShader()
 {
-    const D3D_SHADER_MACRO FogDefines[] =
-    {
-        "FOG", "1",
-        NULL, NULL
-    };
-    const D3D_SHADER_MACRO AlphaTestedDefines[] =
+    // 소스와 include 파일이 그대로면 디스크 캐시의 바이트코드 사용
+    m_ShaderCompiler.SetCacheDirectory(m_ShaderCacheDirectory);
+    m_ShaderCompiler.ResetStats();
+
+    m_BuildGraph.Reset();
+    m_ShaderTasks.clear();
+
+    // 여기서는 컴파일 작업만 등록하고, BuildPipelineState 에서 PSO 작업과 함께 스레드 풀에서 실행
+    // define 은 퍼뮤테이션 기능 비트에서 만들고, 바인드리스 모드는 모든 셰이더에 BINDLESS 를 더함 (리소스 배열 인덱싱은 5.1 부터)
+    // 미리 컴파일한 파일 이름을 주면 그 파일을 먼저 읽어 봄
+    auto CompileShader = [&](ComPtr<ID3DBlob>& shader, const std::wstring& fileName, std::uint32_t features, const std::string& entryPoint, const std::string& target,
+        const std::wstring& byteCodeFile = std::wstring())
     {
-        "FOG", "1",
-        "ALPHA_TESTED", "1",
-        NULL, NULL
-    };
+        const char* Defines[ShaderPermutation::FeatureCount];
+        const std::uint32_t DefineCount = ShaderPermutation::GetDefines(features, Defines);
 
-    m_Shaders[TEXT("VS")] = d3dUtil::CompileShader(TEXT("../Shader/Default.hlsl"), nullptr, "VS", "vs_5_0");
-    m_Shaders[TEXT("PS")] = d3dUtil::CompileShader(TEXT("../Shader/Default.hlsl"), FogDefines, "PS", "ps_5_0");
-    m_Shaders[TEXT("AlphaTestedPS")] = d3dUtil::CompileShader(TEXT("../Shader/Default.hlsl"), AlphaTestedDefines, "PS", "ps_5_0");
+        std::vector<D3D_SHADER_MACRO> Macros;
+        for (std::uint32_t i = 0; i < DefineCount; ++i)
+        {
+            Macros.push_back({ Defines[i], "1" });
+        }
+        if (m_bBindless)
+            Macros.push_back({ "BINDLESS", "1" });
+        Macros.push_back({ NULL, NULL });
 
-    m_Shaders[TEXT("SkyboxVS")] = d3dUtil::CompileShader(TEXT("../Shader/Skybox.hlsl"), nullptr, "VS", "vs_5_0");
-    m_Shaders[TEXT("SkyboxPS")] = d3dUtil::CompileShader(TEXT("../Shader/Skybox.hlsl"), nullptr, "PS", "ps_5_0");
+        // 결과 슬롯은 미리 만들어 두고 작업은 자기 슬롯에만 씀 (다른 스레드에서 맵 구조를 바꾸지 않음)
+        m_ShaderTasks[&shader] = m_BuildGraph.AddTask([this, &shader, fileName, Macros, entryPoint, target, byteCodeFile]()
+        {
+            if (!byteCodeFile.empty())
+                shader = m_ShaderCompiler.LoadPrecompiled(byteCodeFile, fileName);
+            if (shader == nullptr)
+                shader = m_ShaderCompiler.Compile(fileName, Macros.data(), entryPoint, target);
+        });
+    };
 
-    m_Shaders[TEXT("TessVS")] = d3dUtil::CompileShader(TEXT("../Shader/QuadPatch.hlsl"), nullptr, "VS", "vs_5_0");
-    m_Shaders[TEXT("TessHS")] = d3dUtil::CompileShader(TEXT("../Shader/QuadPatch.hlsl"), nullptr, "HS", "hs_5_0");
-    m_Shaders[TEXT("TessDS")] = d3dUtil::CompileShader(TEXT("../Shader/QuadPatch.hlsl"), nullptr, "DS", "ds_5_0");
-    m_Shaders[TEXT("TessPS")] = d3dUtil::CompileShader(TEXT("../Shader/QuadPatch.hlsl"), nullptr, "PS", "ps_5_0");
+    // 오브젝트 셰이더 : 유효한 퍼뮤테이션 전체를 컴파일 (한 번 실행하면 셰이더 캐시에 전체 세트가 남음)
+    // 단계가 읽지 않는 기능 비트만 다른 키는 같은 바이트코드이므로 단계 마스크 안의 키만 컴파일
+    // 미리 컴파일한 파일 이름은 TextureTool permutations --fxc 와 같음 (Object<VS|PS>_<퍼뮤테이션 이름>.cso)
+    const std::wstring PrecompiledDirectory = m_PrecompiledShaderDirectory.empty() ? std::wstring() :
+        m_PrecompiledShaderDirectory + (m_bBindless ? L"/Bindless/" : L"/");
 
-    m_Shaders[TEXT("TreeVS")] = d3dUtil::CompileShader(TEXT("../Shader/Tree.hlsl"), nullptr, "VS", "vs_5_0");
-    m_Shaders[TEXT("TreeGS")] = d3dUtil::CompileShader(TEXT("../Shader/Tree.hlsl"), nullptr, "GS", "gs_5_0");
-    m_Shaders[TEXT("TreePS")] = d3dUtil::CompileShader(TEXT("../Shader/Tree.hlsl"), AlphaTestedDefines, "PS", "ps_5_0");
+    for (std::uint32_t i = 0; i < ShaderPermutation::Count; ++i)
+    {
+        const std::uint32_t Key = ShaderPermutation::Permutations.Keys[i];
+        const std::wstring FileName = (Key & ShaderFeature_Shadow) ? TEXT("../Shader/ShadowMap.hlsl") : TEXT("../Shader/Default.hlsl");
+        const std::wstring Name = AnsiToWString(ShaderPermutation::GetName(Key));
+
+        if ((Key & ~ShaderPermutation::VertexFeatures) == 0)
+            CompileShader(m_ObjectVS[Key], FileName, Key, "VS", "vs_5_1", PrecompiledDirectory.empty() ? std::wstring() : PrecompiledDirectory + L"ObjectVS_" + Name + L".cso");
+        if ((Key & ~ShaderPermutation::PixelFeatures) == 0)
+            CompileShader(m_ObjectPS[Key], FileName, Key, "PS", "ps_5_1", PrecompiledDirectory.empty() ? std::wstring() : PrecompiledDirectory + L"ObjectPS_" + Name + L".cso");
+    }
 
-    m_Shaders[TEXT("ShadowVS")] = d3dUtil::CompileShader(TEXT("../Shader/ShadowMap.hlsl"), nullptr, "VS", "vs_5_0");
-    m_Shaders[TEXT("ShadowPS")] = d3dUtil::CompileShader(TEXT("../Shader/ShadowMap.hlsl"), nullptr, "PS", "ps_5_0");
+    // 전용 셰이더
+    CompileShader(m_Shaders[TEXT("SkyboxVS")], TEXT("../Shader/Skybox.hlsl"), ShaderFeature_None, "VS", "vs_5_1");
+    CompileShader(m_Shaders[TEXT("SkyboxPS")], TEXT("../Shader/Skybox.hlsl"), ShaderFeature_None, "PS", "ps_5_1");
 
-    m_Shaders[TEXT("DebugVS")] = d3dUtil::CompileShader(TEXT("../Shader/ShadowMapDebug.hlsl"), nullptr, "VS", "vs_5_0");
-    m_Shaders[TEXT("DebugPS")] = d3dUtil::CompileShader(TEXT("../Shader/ShadowMapDebug.hlsl"), nullptr, "PS", "ps_5_0");
+    CompileShader(m_Shaders[TEXT("TessVS")], TEXT("../Shader/QuadPatch.hlsl"), ShaderFeature_None, "VS", "vs_5_1");
+    CompileShader(m_Shaders[TEXT("TessHS")], TEXT("../Shader/QuadPatch.hlsl"), ShaderFeature_None, "HS", "hs_5_1");
+    CompileShader(m_Shaders[TEXT("TessDS")], TEXT("../Shader/QuadPatch.hlsl"), ShaderFeature_None, "DS", "ds_5_1");
+    CompileShader(m_Shaders[TEXT("TessPS")], TEXT("../Shader/QuadPatch.hlsl"), ShaderFeature_None, "PS", "ps_5_1");
 
-    const D3D_SHADER_MACRO SkinnedDefines[] =
-    {
-        "SKINNED", "1",
-        NULL, NULL
-    };
+    CompileShader(m_Shaders[TEXT("TreeVS")], TEXT("../Shader/Tree.hlsl"), ShaderFeature_None, "VS", "vs_5_1");
+    CompileShader(m_Shaders[TEXT("TreeGS")], TEXT("../Shader/Tree.hlsl"), ShaderFeature_None, "GS", "gs_5_1");
+    CompileShader(m_Shaders[TEXT("TreePS")], TEXT("../Shader/Tree.hlsl"), ShaderFeature_Fog | ShaderFeature_AlphaTested, "PS", "ps_5_1");
 
-    m_Shaders[TEXT("SkinnedVS")] = d3dUtil::CompileShader(TEXT("../Shader/Default.hlsl"), SkinnedDefines, "VS", "vs_5_0");
+    CompileShader(m_Shaders[TEXT("DebugVS")], TEXT("../Shader/ShadowMapDebug.hlsl"), ShaderFeature_None, "VS", "vs_5_1");
+    CompileShader(m_Shaders[TEXT("DebugPS")], TEXT("../Shader/ShadowMapDebug.hlsl"), ShaderFeature_None, "PS", "ps_5_1");
 }
 
 void D3DSample::BuildRootSignature()
@@ -848,20 +1195,30 @@ void D3DSample::BuildRootSignature()
     TextureTable[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0); // t0 : Diffuse Texture
     TextureTable[1].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 1); // t1 : Normal Texture
 
+    // 바인드리스 : t0, space2 부터 힙 전체를 Texture2DArray 배열로 묶고 재질 상수의 인덱스로 선택
+    // (버전 1.0 루트 시그니처의 서술자는 휘발성이므로 빈 슬롯이나 다른 종류의 뷰가 섞여 있어도 읽지만 않으면 됨)
+    CD3DX12_DESCRIPTOR_RANGE BindlessTable[1];
+    BindlessTable[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, UINT_MAX, 0, 2); // t0.., space2 : Texture Array
+
     CD3DX12_DESCRIPTOR_RANGE SkyboxTable[1];
     SkyboxTable[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 2); // t2 : Skybox Texture
 
     CD3DX12_DESCRIPTOR_RANGE ShadowMapTable[1];
     ShadowMapTable[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 3); // t3 : ShadowMap Texture
 
-    CD3DX12_ROOT_PARAMETER Params[7];
-    Params[0].InitAsConstantBufferView(0); // 0 -> b0 : CBV m_ObjectCB
-    Params[1].InitAsConstantBufferView(1); // 1 -> b1 : CBV m_PassCB
-    Params[2].InitAsConstantBufferView(2); // 2 -> b2 : CBV m_MaterialCB
-    Params[3].InitAsDescriptorTable(_countof(TextureTable), TextureTable);      // 3 -> t0, t1 TexTable
-    Params[4].InitAsDescriptorTable(_countof(SkyboxTable), SkyboxTable);        // 4 -> t2, Skybox Table
-    Params[5].InitAsDescriptorTable(_countof(ShadowMapTable), ShadowMapTable);  // 5 -> t3, ShadowMap Table
-    Params[6].InitAsConstantBufferView(3); // 6 -> b3 : CBV m_SkinnedCB
+    CD3DX12_ROOT_PARAMETER Params[9];
+    Params[0].InitAsConstantBufferView(0); // 0번 -> b0 : CBV m_ObjectCBAddress
+    Params[1].InitAsConstantBufferView(1); // 1번 -> b1 : CBV m_PassCBAddress
+    Params[2].InitAsConstantBufferView(2); // 2번 -> b2 : CBV m_MaterialCBAddress
+    if (m_bBindless)
+        Params[3].InitAsDescriptorTable(_countof(BindlessTable), BindlessTable);    // 3번 -> t0.., space2 Bindless Table
+    else
+        Params[3].InitAsDescriptorTable(_countof(TextureTable), TextureTable);      // 3번 -> t0, t1 TexTable
+    Params[4].InitAsDescriptorTable(_countof(SkyboxTable), SkyboxTable);        // 4번 -> t2, Skybox Table
+    Params[5].InitAsDescriptorTable(_countof(ShadowMapTable), ShadowMapTable);  // 5번 -> t3, ShadowMap Table
+    Params[6].InitAsConstantBufferView(3); // 6번 -> b3 : CBV m_SkinnedCBAddress
+    Params[7].InitAsShaderResourceView(0, 1); // 7번 -> t0, space1 : SRV m_InstanceIndexAddress (배치마다 시작 위치를 옮김)
+    Params[8].InitAsShaderResourceView(1, 1); // 8번 -> t1, space1 : SRV m_InstanceAddress
 
 
     const CD3DX12_STATIC_SAMPLER_DESC pointWrap(
@@ -931,21 +1288,61 @@ void D3DSample::BuildInputLayout()
 
 void D3DSample::BuildPipelineState()
 {
-    D3D12_GRAPHICS_PIPELINE_STATE_DESC ObjectDesc;
-    ZeroMemory(&ObjectDesc, sizeof(D3D12_GRAPHICS_PIPELINE_STATE_DESC));
+    // 셰이더가 바뀌지 않았으면 직렬화된 파이프라인 라이브러리에서 PSO 를 읽음
+    m_PipelineLibrary.Initialize(m_D3dDevice.Get(), m_PipelineLibraryFileName);
 
-    ObjectDesc.InputLayout = { m_InputLayout.data(), (UINT)m_InputLayout.size() };
-    ObjectDesc.pRootSignature = m_RootSignature.Get();
-    ObjectDesc.VS =
+    // 단계별 셰이더 슬롯 (없으면 nullptr)
+    struct ShaderStages
+    {
+        const ComPtr<ID3DBlob>* VS;
+        const ComPtr<ID3DBlob>* HS;
+        const ComPtr<ID3DBlob>* DS;
+        const ComPtr<ID3DBlob>* GS;
+        const ComPtr<ID3DBlob>* PS;
+    };
+
+    auto Shader = [this](const wchar_t* name)
     {
-        reinterpret_cast<BYTE*>(m_Shaders[TEXT("VS")]->GetBufferPointer()),
-        m_Shaders[TEXT("VS")]->GetBufferSize()
+        return &m_Shaders.at(name);
     };
-    ObjectDesc.PS =
+
+    // PSO 작업은 자기가 쓰는 셰이더의 컴파일 작업이 끝나면 실행
+    // 바이트코드는 그때 채우므로 여기서는 나머지 상태만 설정
+    auto AddPipeline = [&](const std::wstring& name, const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, const ShaderStages& stages, ComPtr<ID3D12PipelineState>& pipelineState)
     {
-        reinterpret_cast<BYTE*>(m_Shaders[TEXT("PS")]->GetBufferPointer()),
-        m_Shaders[TEXT("PS")]->GetBufferSize()
+        std::vector<TaskGraph::TaskId> Dependencies;
+        for (const ComPtr<ID3DBlob>* Stage : { stages.VS, stages.HS, stages.DS, stages.GS, stages.PS })
+        {
+            if (Stage != nullptr)
+                Dependencies.push_back(m_ShaderTasks.at(Stage));
+        }
+
+        m_BuildGraph.AddTask([this, name, desc, stages, &pipelineState]()
+        {
+            auto ByteCode = [](const ComPtr<ID3DBlob>* stage)
+            {
+                if (stage == nullptr)
+                    return D3D12_SHADER_BYTECODE{ nullptr, 0 };
+
+                return D3D12_SHADER_BYTECODE{ (*stage)->GetBufferPointer(), (*stage)->GetBufferSize() };
+            };
+
+            D3D12_GRAPHICS_PIPELINE_STATE_DESC Desc = desc;
+            Desc.VS = ByteCode(stages.VS);
+            Desc.HS = ByteCode(stages.HS);
+            Desc.DS = ByteCode(stages.DS);
+            Desc.GS = ByteCode(stages.GS);
+            Desc.PS = ByteCode(stages.PS);
+
+            pipelineState = m_PipelineLibrary.CreateGraphicsPipelineState(name, Desc);
+        }, Dependencies);
     };
+
+    D3D12_GRAPHICS_PIPELINE_STATE_DESC ObjectDesc;
+    ZeroMemory(&ObjectDesc, sizeof(D3D12_GRAPHICS_PIPELINE_STATE_DESC));
+
+    ObjectDesc.InputLayout = { m_InputLayout.data(), (UINT)m_InputLayout.size() };
+    ObjectDesc.pRootSignature = m_RootSignature.Get();
     ObjectDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
     ObjectDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
     ObjectDesc.DepthStencilState = CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT);
@@ -957,18 +1354,30 @@ void D3DSample::BuildPipelineState()
     ObjectDesc.SampleDesc.Quality = 0;
     ObjectDesc.DSVFormat = DXGI_FORMAT_R24_UNORM_X8_TYPELESS;
 
-    ThrowIfFailed(m_D3dDevice->CreateGraphicsPipelineState(&ObjectDesc, IID_PPV_ARGS(&m_PipelineStates[RenderLayer::Opaque])));
+    // 쉐도우 맵 패스 : 깊이만 기록
+    D3D12_GRAPHICS_PIPELINE_STATE_DESC ShadowMapDesc = ObjectDesc;
+    ShadowMapDesc.RasterizerState.DepthBias = 100000;
+    ShadowMapDesc.RasterizerState.DepthBiasClamp = 0.0f;
+    ShadowMapDesc.RasterizerState.SlopeScaledDepthBias = 1.0f;
+    ShadowMapDesc.RTVFormats[0] = DXGI_FORMAT_UNKNOWN;
+    ShadowMapDesc.NumRenderTargets = 0;
 
-    // PSO : AlphaTested Objects
-    D3D12_GRAPHICS_PIPELINE_STATE_DESC AlphaTestedDesc = ObjectDesc;
-    AlphaTestedDesc.PS = 
+    // PSO : 오브젝트 (유효한 퍼뮤테이션마다 하나, 기능 비트가 셰이더와 입력 배치, 컬링을 결정)
+    for (std::uint32_t i = 0; i < ShaderPermutation::Count; ++i)
     {
-        reinterpret_cast<BYTE*>(m_Shaders[TEXT("AlphaTestedPS")]->GetBufferPointer()),
-        m_Shaders[TEXT("AlphaTestedPS")]->GetBufferSize()
-    };
-    AlphaTestedDesc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
-
-    ThrowIfFailed(m_D3dDevice->CreateGraphicsPipelineState(&AlphaTestedDesc, IID_PPV_ARGS(&m_PipelineStates[RenderLayer::AlphaTested])));
+        const std::uint32_t Key = ShaderPermutation::Permutations.Keys[i];
+
+        D3D12_GRAPHICS_PIPELINE_STATE_DESC Desc = (Key & ShaderFeature_Shadow) ? ShadowMapDesc : ObjectDesc;
+        if (Key & ShaderFeature_AlphaTested)
+            Desc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
+        if (Key & ShaderFeature_Skinned)
+            Desc.InputLayout = { m_SkinnedInputLayout.data(), (UINT)m_SkinnedInputLayout.size() };
+
+        const std::string Name = "Object " + ShaderPermutation::GetName(Key);
+        AddPipeline(std::wstring(Name.begin(), Name.end()), Desc,
+            { &m_ObjectVS[Key & ShaderPermutation::VertexFeatures], nullptr, nullptr, nullptr, &m_ObjectPS[Key & ShaderPermutation::PixelFeatures] },
+            m_ObjectPipelines[Key]);
+    }
 
     // PSO : Transparent Objects
     D3D12_GRAPHICS_PIPELINE_STATE_DESC TransparentDesc = ObjectDesc;
@@ -986,136 +1395,69 @@ void D3DSample::BuildPipelineState()
 
     TransparentDesc.BlendState.RenderTarget[0] = TransparentBlendDesc;
 
-    ThrowIfFailed(m_D3dDevice->CreateGraphicsPipelineState(&TransparentDesc, IID_PPV_ARGS(&m_PipelineStates[RenderLayer::Transparent])));
-
+    AddPipeline(TEXT("Transparent"), TransparentDesc,
+        { &m_ObjectVS.Get<ShaderFeature_None>(), nullptr, nullptr, nullptr, &m_ObjectPS.Get<ShaderFeature_Fog>() },
+        m_PipelineStates[(int)RenderLayer::Transparent]);
 
     // PSO : Skybox Objects
     D3D12_GRAPHICS_PIPELINE_STATE_DESC SkyboxDesc = ObjectDesc;
-    // ø 
+    // 컬링 제거
     SkyboxDesc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
 
-    // ̽ٽ  ø 
+    // 깊이스텐실 버퍼 컬링 제거
     SkyboxDesc.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_LESS_EQUAL;
 
     SkyboxDesc.pRootSignature = m_RootSignature.Get();
 
-    SkyboxDesc.VS =
-    {
-        reinterpret_cast<BYTE*>(m_Shaders[TEXT("SkyboxVS")]->GetBufferPointer()),
-        m_Shaders[TEXT("SkyboxVS")]->GetBufferSize()
-    };
-    SkyboxDesc.PS =
-    {
-        reinterpret_cast<BYTE*>(m_Shaders[TEXT("SkyboxPS")]->GetBufferPointer()),
-        m_Shaders[TEXT("SkyboxPS")]->GetBufferSize()
-    };
-
-    ThrowIfFailed(m_D3dDevice->CreateGraphicsPipelineState(&SkyboxDesc, IID_PPV_ARGS(&m_PipelineStates[RenderLayer::Skybox])));
+    AddPipeline(TEXT("Skybox"), SkyboxDesc, { Shader(TEXT("SkyboxVS")), nullptr, nullptr, nullptr, Shader(TEXT("SkyboxPS")) }, m_PipelineStates[(int)RenderLayer::Skybox]);
 
     // PSO : QuadPatch Objects
     D3D12_GRAPHICS_PIPELINE_STATE_DESC QuadPatchDesc = ObjectDesc;
-    QuadPatchDesc.VS =
-    {
-        reinterpret_cast<BYTE*>(m_Shaders[TEXT("TessVS")]->GetBufferPointer()),
-        m_Shaders[TEXT("TessVS")]->GetBufferSize()
-    };
-    QuadPatchDesc.HS =
-    {
-        reinterpret_cast<BYTE*>(m_Shaders[TEXT("TessHS")]->GetBufferPointer()),
-        m_Shaders[TEXT("TessHS")]->GetBufferSize()
-    };
-    QuadPatchDesc.DS =
-    {
-        reinterpret_cast<BYTE*>(m_Shaders[TEXT("TessDS")]->GetBufferPointer()),
-        m_Shaders[TEXT("TessDS")]->GetBufferSize()
-    };
-    QuadPatchDesc.PS =
-    {
-        reinterpret_cast<BYTE*>(m_Shaders[TEXT("TessPS")]->GetBufferPointer()),
-        m_Shaders[TEXT("TessPS")]->GetBufferSize()
-    };
-
     QuadPatchDesc.InputLayout = { m_QuadPatchInputLayout.data(), (UINT)m_QuadPatchInputLayout.size() };
     QuadPatchDesc.RasterizerState.FillMode = D3D12_FILL_MODE_WIREFRAME;
     QuadPatchDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_PATCH;
 
-    ThrowIfFailed(m_D3dDevice->CreateGraphicsPipelineState(&QuadPatchDesc, IID_PPV_ARGS(&m_PipelineStates[RenderLayer::QuadPatch])));
+    AddPipeline(TEXT("QuadPatch"), QuadPatchDesc, { Shader(TEXT("TessVS")), Shader(TEXT("TessHS")), Shader(TEXT("TessDS")), nullptr, Shader(TEXT("TessPS")) }, m_PipelineStates[(int)RenderLayer::QuadPatch]);
 
     // PSO : Tree Objects
     D3D12_GRAPHICS_PIPELINE_STATE_DESC TreeDesc = ObjectDesc;
-    TreeDesc.VS =
-    {
-        reinterpret_cast<BYTE*>(m_Shaders[TEXT("TreeVS")]->GetBufferPointer()),
-        m_Shaders[TEXT("TreeVS")]->GetBufferSize()
-    };
-    TreeDesc.GS =
-    {
-        reinterpret_cast<BYTE*>(m_Shaders[TEXT("TreeGS")]->GetBufferPointer()),
-        m_Shaders[TEXT("TreeGS")]->GetBufferSize()
-    };
-    TreeDesc.PS =
-    {
-        reinterpret_cast<BYTE*>(m_Shaders[TEXT("TreePS")]->GetBufferPointer()),
-        m_Shaders[TEXT("TreePS")]->GetBufferSize()
-    };
-
     TreeDesc.InputLayout = { m_TreeInputLayout.data(), (UINT)m_TreeInputLayout.size() };
     TreeDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_POINT;
     TreeDesc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
 
-    ThrowIfFailed(m_D3dDevice->CreateGraphicsPipelineState(&TreeDesc, IID_PPV_ARGS(&m_PipelineStates[RenderLayer::Tree])));
+    AddPipeline(TEXT("Tree"), TreeDesc, { Shader(TEXT("TreeVS")), nullptr, nullptr, Shader(TEXT("TreeGS")), Shader(TEXT("TreePS")) }, m_PipelineStates[(int)RenderLayer::Tree]);
 
-    // PSO : ShadowMap Objects
-    D3D12_GRAPHICS_PIPELINE_STATE_DESC ShadowMapDesc = ObjectDesc;
-    ShadowMapDesc.VS =
-    {
-        reinterpret_cast<BYTE*>(m_Shaders[TEXT("ShadowVS")]->GetBufferPointer()),
-        m_Shaders[TEXT("ShadowVS")]->GetBufferSize()
-    };
-    ShadowMapDesc.PS =
-    {
-        reinterpret_cast<BYTE*>(m_Shaders[TEXT("ShadowPS")]->GetBufferPointer()),
-        m_Shaders[TEXT("ShadowPS")]->GetBufferSize()
-    };
+    // PSO : ShadowMapDebug Objects
+    AddPipeline(TEXT("ShadowMapDebug"), ObjectDesc, { Shader(TEXT("DebugVS")), nullptr, nullptr, nullptr, Shader(TEXT("DebugPS")) }, m_PipelineStates[(int)RenderLayer::ShadowMapDebug]);
 
-    ShadowMapDesc.RasterizerState.DepthBias = 100000;
-    ShadowMapDesc.RasterizerState.DepthBiasClamp = 0.0f;
-    ShadowMapDesc.RasterizerState.SlopeScaledDepthBias = 1.0f;
-    ShadowMapDesc.RTVFormats[0] = DXGI_FORMAT_UNKNOWN;
-    ShadowMapDesc.NumRenderTargets = 0;
+    // 컴파일과 PSO 생성 실행 (실패한 작업의 예외는 모든 작업이 끝난 뒤 여기서 다시 던짐)
+    auto StartTime = std::chrono::high_resolution_clock::now();
 
-    ThrowIfFailed(m_D3dDevice->CreateGraphicsPipelineState(&ShadowMapDesc, IID_PPV_ARGS(&m_PipelineStates[RenderLayer::ShadowMap])));
+    if (m_bParallelPipelineBuild)
+        m_BuildGraph.Run(*m_ThreadPool);
+    else
+        m_BuildGraph.RunSerial();
 
-    // PSO : ShadowMapDebug Objects
-    D3D12_GRAPHICS_PIPELINE_STATE_DESC DebugDesc = ObjectDesc;
-    DebugDesc.VS =
-    {
-        reinterpret_cast<BYTE*>(m_Shaders[TEXT("DebugVS")]->GetBufferPointer()),
-        m_Shaders[TEXT("DebugVS")]->GetBufferSize()
-    };
-    DebugDesc.PS =
-    {
-        reinterpret_cast<BYTE*>(m_Shaders[TEXT("DebugPS")]->GetBufferPointer()),
-        m_Shaders[TEXT("DebugPS")]->GetBufferSize()
-    };
+    auto EndTime = std::chrono::high_resolution_clock::now();
 
-    ThrowIfFailed(m_D3dDevice->CreateGraphicsPipelineState(&DebugDesc, IID_PPV_ARGS(&m_PipelineStates[RenderLayer::ShadowMapDebug])));
+    m_PipelineLibrary.Save();
 
-    // PSO : SkinnedOpaque Objects
-    D3D12_GRAPHICS_PIPELINE_STATE_DESC SkinnedDesc = ObjectDesc;
-    SkinnedDesc.VS =
-    {
-        reinterpret_cast<BYTE*>(m_Shaders[TEXT("SkinnedVS")]->GetBufferPointer()),
-        m_Shaders[TEXT("SkinnedVS")]->GetBufferSize()
-    };
-    SkinnedDesc.PS =
-    {
-        reinterpret_cast<BYTE*>(m_Shaders[TEXT("PS")]->GetBufferPointer()),
-        m_Shaders[TEXT("PS")]->GetBufferSize()
-    };
+    const ShaderCacheStats CacheStats = m_ShaderCompiler.GetStats();
+    const PipelineLibraryStats LibraryStats = m_PipelineLibrary.GetStats();
 
-    SkinnedDesc.InputLayout = { m_SkinnedInputLayout.data(), (UINT)m_SkinnedInputLayout.size() };
-    ThrowIfFailed(m_D3dDevice->CreateGraphicsPipelineState(&SkinnedDesc, IID_PPV_ARGS(&m_PipelineStates[RenderLayer::SkinnedOpaque])));
+    std::wostringstream Log;
+    Log << L"Shaders and pipelines: " << m_BuildGraph.GetTaskCount() << L" tasks in "
+        << std::chrono::duration<double, std::milli>(EndTime - StartTime).count() << L" ms ("
+        << (m_bParallelPipelineBuild ? L"parallel, " : L"serial, ") << m_BuildGraph.GetStats().PeakRunning << L" at once), "
+        << m_ShaderTasks.size() << L" shaders: " << m_ShaderCompiler.GetPrecompiledCount() << L" precompiled, "
+        << CacheStats.Hits << L" from cache, " << m_ShaderCompiler.GetCompileCount() << L" compiled ("
+        << CacheStats.Stale << L" invalidated by changed sources), "
+        << LibraryStats.Loaded + LibraryStats.Created << L" pipelines: " << LibraryStats.Loaded << L" from library, " << LibraryStats.Created << L" created"
+        << (m_PipelineLibrary.IsEnabled() ? L"\n" : L" (no pipeline library)\n");
+    OutputDebugString(Log.str().c_str());
+
+    m_BuildGraph.Reset();
+    m_ShaderTasks.clear();
 }
 
 void D3DSample::CreateBoxGeometry()
@@ -1138,25 +1480,11 @@ void D3DSample::CreateBoxGeometry()
     auto Geometry = std::make_unique<GeometryInfo>();
     Geometry->Name = TEXT("Box");
 
-    //  
-    Geometry->VertexCount = (UINT)Vertices.size();
-    const UINT VBByteSize = Geometry->VertexCount * sizeof(Vertex);
-
-    Geometry->VertexBuffer = d3dUtil::CreateDefaultBuffer(m_D3dDevice.Get(), m_CommandList.Get(), Vertices.data(), VBByteSize, Geometry->VertexUploadBuffer);
-
-    Geometry->VertexBufferView.BufferLocation = Geometry->VertexBuffer->GetGPUVirtualAddress();
-    Geometry->VertexBufferView.StrideInBytes = sizeof(Vertex);
-    Geometry->VertexBufferView.SizeInBytes = VBByteSize;
+    // 경계 상자
+    BoundingBox::CreateFromPoints(Geometry->Bounds, Vertices.size(), &Vertices[0].Pos, sizeof(Vertex));
 
-    // ε 
-    Geometry->IndexCount = (UINT)Indices.size();
-    const UINT IBByteSize = Geometry->IndexCount * sizeof(std::int32_t);
-
-    Geometry->IndexBuffer = d3dUtil::CreateDefaultBuffer(m_D3dDevice.Get(), m_CommandList.Get(), Indices.data(), IBByteSize, Geometry->IndexUploadBuffer);
-
-    Geometry->IndexBufferView.BufferLocation = Geometry->IndexBuffer->GetGPUVirtualAddress();
-    Geometry->IndexBufferView.Format = DXGI_FORMAT_R32_UINT;
-    Geometry->IndexBufferView.SizeInBytes = IBByteSize;
+    // 정점 / 인덱스 버퍼
+    UploadGeometry(Geometry.get(), Vertices.data(), (UINT)Vertices.size(), sizeof(Vertex), Indices.data(), (UINT)Indices.size());
 
     m_Geometries[Geometry->Name] = std::move(Geometry);
 }
@@ -1181,25 +1509,11 @@ void D3DSample::CreateGridGeometry()
     auto Geometry = std::make_unique<GeometryInfo>();
     Geometry->Name = TEXT("Grid");
 
-    //  
-    Geometry->VertexCount = (UINT)Vertices.size();
-    const UINT VBByteSize = Geometry->VertexCount * sizeof(Vertex);
-
-    Geometry->VertexBuffer = d3dUtil::CreateDefaultBuffer(m_D3dDevice.Get(), m_CommandList.Get(), Vertices.data(), VBByteSize, Geometry->VertexUploadBuffer);
-
-    Geometry->VertexBufferView.BufferLocation = Geometry->VertexBuffer->GetGPUVirtualAddress();
-    Geometry->VertexBufferView.StrideInBytes = sizeof(Vertex);
-    Geometry->VertexBufferView.SizeInBytes = VBByteSize;
-
-    // ε 
-    Geometry->IndexCount = (UINT)Indices.size();
-    const UINT IBByteSize = Geometry->IndexCount * sizeof(std::int32_t);
+    // 경계 상자
+    BoundingBox::CreateFromPoints(Geometry->Bounds, Vertices.size(), &Vertices[0].Pos, sizeof(Vertex));
 
-    Geometry->IndexBuffer = d3dUtil::CreateDefaultBuffer(m_D3dDevice.Get(), m_CommandList.Get(), Indices.data(), IBByteSize, Geometry->IndexUploadBuffer);
-
-    Geometry->IndexBufferView.BufferLocation = Geometry->IndexBuffer->GetGPUVirtualAddress();
-    Geometry->IndexBufferView.Format = DXGI_FORMAT_R32_UINT;
-    Geometry->IndexBufferView.SizeInBytes = IBByteSize;
+    // 정점 / 인덱스 버퍼
+    UploadGeometry(Geometry.get(), Vertices.data(), (UINT)Vertices.size(), sizeof(Vertex), Indices.data(), (UINT)Indices.size());
 
     m_Geometries[Geometry->Name] = std::move(Geometry);
 }
@@ -1224,25 +1538,11 @@ void D3DSample::CreateSphereGeometry()
     auto Geometry = std::make_unique<GeometryInfo>();
     Geometry->Name = TEXT("Sphere");
 
-    //  
-    Geometry->VertexCount = (UINT)Vertices.size();
-    const UINT VBByteSize = Geometry->VertexCount * sizeof(Vertex);
-
-    Geometry->VertexBuffer = d3dUtil::CreateDefaultBuffer(m_D3dDevice.Get(), m_CommandList.Get(), Vertices.data(), VBByteSize, Geometry->VertexUploadBuffer);
-
-    Geometry->VertexBufferView.BufferLocation = Geometry->VertexBuffer->GetGPUVirtualAddress();
-    Geometry->VertexBufferView.StrideInBytes = sizeof(Vertex);
-    Geometry->VertexBufferView.SizeInBytes = VBByteSize;
-
-    // ε 
-    Geometry->IndexCount = (UINT)Indices.size();
-    const UINT IBByteSize = Geometry->IndexCount * sizeof(std::int32_t);
-
-    Geometry->IndexBuffer = d3dUtil::CreateDefaultBuffer(m_D3dDevice.Get(), m_CommandList.Get(), Indices.data(), IBByteSize, Geometry->IndexUploadBuffer);
+    // 경계 상자
+    BoundingBox::CreateFromPoints(Geometry->Bounds, Vertices.size(), &Vertices[0].Pos, sizeof(Vertex));
 
-    Geometry->IndexBufferView.BufferLocation = Geometry->IndexBuffer->GetGPUVirtualAddress();
-    Geometry->IndexBufferView.Format = DXGI_FORMAT_R32_UINT;
-    Geometry->IndexBufferView.SizeInBytes = IBByteSize;
+    // 정점 / 인덱스 버퍼
+    UploadGeometry(Geometry.get(), Vertices.data(), (UINT)Vertices.size(), sizeof(Vertex), Indices.data(), (UINT)Indices.size());
 
     m_Geometries[Geometry->Name] = std::move(Geometry);
 }
@@ -1267,40 +1567,29 @@ void D3DSample::CreateCylinderGeometry()
     auto Geometry = std::make_unique<GeometryInfo>();
     Geometry->Name = TEXT("Cylinder");
 
-    //  
-    Geometry->VertexCount = (UINT)Vertices.size();
-    const UINT VBByteSize = Geometry->VertexCount * sizeof(Vertex);
+    // 경계 상자
+    BoundingBox::CreateFromPoints(Geometry->Bounds, Vertices.size(), &Vertices[0].Pos, sizeof(Vertex));
 
-    Geometry->VertexBuffer = d3dUtil::CreateDefaultBuffer(m_D3dDevice.Get(), m_CommandList.Get(), Vertices.data(), VBByteSize, Geometry->VertexUploadBuffer);
-
-    Geometry->VertexBufferView.BufferLocation = Geometry->VertexBuffer->GetGPUVirtualAddress();
-    Geometry->VertexBufferView.StrideInBytes = sizeof(Vertex);
-    Geometry->VertexBufferView.SizeInBytes = VBByteSize;
-
-    // ε 
-    Geometry->IndexCount = (UINT)Indices.size();
-    const UINT IBByteSize = Geometry->IndexCount * sizeof(std::int32_t);
-
-    Geometry->IndexBuffer = d3dUtil::CreateDefaultBuffer(m_D3dDevice.Get(), m_CommandList.Get(), Indices.data(), IBByteSize, Geometry->IndexUploadBuffer);
-
-    Geometry->IndexBufferView.BufferLocation = Geometry->IndexBuffer->GetGPUVirtualAddress();
-    Geometry->IndexBufferView.Format = DXGI_FORMAT_R32_UINT;
-    Geometry->IndexBufferView.SizeInBytes = IBByteSize;
+    // 정점 / 인덱스 버퍼
+    UploadGeometry(Geometry.get(), Vertices.data(), (UINT)Vertices.size(), sizeof(Vertex), Indices.data(), (UINT)Indices.size());
 
     m_Geometries[Geometry->Name] = std::move(Geometry);
 }
 
 void D3DSample::CreateSkullGeometry()
 {
-    // Skull  ε
-    std::ifstream InputFile("../Models/skull.txt");
+    // Skull 파일 로드 (Initialize에서 요청한 읽기 완료 대기)
+    FileReadResult SkullFile = m_SkullFile.get();
 
-    if (!InputFile)
+    if (!SkullFile.bOk)
     {
         MessageBox(0, TEXT("../Models/skull.txt not found"), 0, 0);
         return;
     }
 
+    ByteViewBuffer SkullBuffer(SkullFile.Data);
+    std::istream InputFile(&SkullBuffer);
+
     UINT VertexCount = 0;
     UINT TriangleCount = 0;
     
@@ -1325,30 +1614,18 @@ void D3DSample::CreateSkullGeometry()
         InputFile >> Indices[i * 3 + 0] >> Indices[i * 3 + 1] >> Indices[i * 3 + 2];
     }
 
-    InputFile.close();
+    // 중간에 잘리거나 형식이 다르면 스트림이 실패 상태가 됨
+    if (!InputFile || VertexCount == 0)
+        throw DxException(HRESULT_FROM_WIN32(ERROR_INVALID_DATA), L"CreateSkullGeometry: ../Models/skull.txt", AnsiToWString(__FILE__), __LINE__);
 
     auto Geometry = std::make_unique<GeometryInfo>();
     Geometry->Name = TEXT("Skull");
 
-    //  
-    Geometry->VertexCount = (UINT)Vertices.size();
-    const UINT VBByteSize = Geometry->VertexCount * sizeof(Vertex);
-
-    Geometry->VertexBuffer = d3dUtil::CreateDefaultBuffer(m_D3dDevice.Get(), m_CommandList.Get(), Vertices.data(), VBByteSize, Geometry->VertexUploadBuffer);
-
-    Geometry->VertexBufferView.BufferLocation = Geometry->VertexBuffer->GetGPUVirtualAddress();
-    Geometry->VertexBufferView.StrideInBytes = sizeof(Vertex);
-    Geometry->VertexBufferView.SizeInBytes = VBByteSize;
-
-    // ε 
-    Geometry->IndexCount = (UINT)Indices.size();
-    const UINT IBByteSize = Geometry->IndexCount * sizeof(std::int32_t);
+    // 경계 상자
+    BoundingBox::CreateFromPoints(Geometry->Bounds, Vertices.size(), &Vertices[0].Pos, sizeof(Vertex));
 
-    Geometry->IndexBuffer = d3dUtil::CreateDefaultBuffer(m_D3dDevice.Get(), m_CommandList.Get(), Indices.data(), IBByteSize, Geometry->IndexUploadBuffer);
-
-    Geometry->IndexBufferView.BufferLocation = Geometry->IndexBuffer->GetGPUVirtualAddress();
-    Geometry->IndexBufferView.Format = DXGI_FORMAT_R32_UINT;
-    Geometry->IndexBufferView.SizeInBytes = IBByteSize;
+    // 정점 / 인덱스 버퍼
+    UploadGeometry(Geometry.get(), Vertices.data(), (UINT)Vertices.size(), sizeof(Vertex), Indices.data(), (UINT)Indices.size());
 
     m_Geometries[Geometry->Name] = std::move(Geometry);
 }
@@ -1368,74 +1645,102 @@ void D3DSample::CreateQuadPatchGeometry()
     auto Geometry = std::make_unique<GeometryInfo>();
     Geometry->Name = TEXT("QuadPatch");
 
-    //  
-    Geometry->VertexCount = (UINT)Vertices.size();
-    const UINT VBByteSize = Geometry->VertexCount * sizeof(QuadPatchVertex);
+    // 경계 상자
+    BoundingBox::CreateFromPoints(Geometry->Bounds, Vertices.size(), &Vertices[0].Pos, sizeof(QuadPatchVertex));
 
-    Geometry->VertexBuffer = d3dUtil::CreateDefaultBuffer(m_D3dDevice.Get(), m_CommandList.Get(), Vertices.data(), VBByteSize, Geometry->VertexUploadBuffer);
+    // 정점 / 인덱스 버퍼
+    UploadGeometry(Geometry.get(), Vertices.data(), (UINT)Vertices.size(), sizeof(QuadPatchVertex), Indices.data(), (UINT)Indices.size());
 
-    Geometry->VertexBufferView.BufferLocation = Geometry->VertexBuffer->GetGPUVirtualAddress();
-    Geometry->VertexBufferView.StrideInBytes = sizeof(QuadPatchVertex);
-    Geometry->VertexBufferView.SizeInBytes = VBByteSize;
+    m_Geometries[Geometry->Name] = std::move(Geometry);
+}
 
-    // ε 
-    Geometry->IndexCount = (UINT)Indices.size();
-    const UINT IBByteSize = Geometry->IndexCount * sizeof(std::int32_t);
+void D3DSample::CreateTreeGeometry()
+{
+    // 나무 + 풀 레이어 (Poisson-disk 분포)
+    std::vector<VegetationLayerDesc> Layers(2);
+
+    Layers[0].MinDistance = 3.0f;
+    Layers[0].MinHeight = 8.0f;
+    Layers[0].MaxHeight = 12.0f;
+    Layers[0].DrawDistance = 200.0f;
+
+    Layers[1].MinDistance = 2.0f;
+    Layers[1].MinHeight = 1.0f;
+    Layers[1].MaxHeight = 2.0f;
+    Layers[1].Aspect = 1.5f;
+    Layers[1].DrawDistance = 60.0f;
+
+    // 고정 시드로 매 실행마다 동일한 배치
+    // 분포 생성은 1초 가까이 걸리므로 워커 스레드에서 텍스처 로딩 / PSO 생성과 겹쳐서 진행하고,
+    // 인스턴스 수로 크기를 정하는 버퍼는 FinishTreeGeometry 에서 생성
+    m_VegetationBuild = m_ThreadPool->Submit([this, Layers]()
+    {
+        const float AreaMin[2] = { -512.0f, -512.0f };
+        const float AreaMax[2] = { +512.0f, +512.0f };
+        m_Vegetation.Build(0x5EED, AreaMin, AreaMax, 0.0f, 32.0f, Layers);
+    });
 
-    Geometry->IndexBuffer = d3dUtil::CreateDefaultBuffer(m_D3dDevice.Get(), m_CommandList.Get(), Indices.data(), IBByteSize, Geometry->IndexUploadBuffer);
+    auto Geometry = std::make_unique<GeometryInfo>();
+    Geometry->Name = TEXT("Tree");
 
-    Geometry->IndexBufferView.BufferLocation = Geometry->IndexBuffer->GetGPUVirtualAddress();
-    Geometry->IndexBufferView.Format = DXGI_FORMAT_R32_UINT;
-    Geometry->IndexBufferView.SizeInBytes = IBByteSize;
+    // 경계 상자 : 식생 영역 전체
+    BoundingBox::CreateFromPoints(Geometry->Bounds, XMVectorSet(-512.0f, 0.0f, -512.0f, 0.0f), XMVectorSet(+512.0f, Layers[0].MaxHeight, +512.0f, 0.0f));
 
+    // 그릴 개수는 매 프레임 UpdateVegetation 이 정함
+    Geometry->IndexCount = 0;
+
+    m_VegetationGeometry = Geometry.get();
     m_Geometries[Geometry->Name] = std::move(Geometry);
 }
 
-void D3DSample::CreateTreeGeometry()
+void D3DSample::FinishTreeGeometry()
 {
-    static const int TreeCount = 32;
-    std::array<TreeVertex, TreeCount> Vertices;
-    for (UINT i = 0; i < TreeCount; ++i)
-    {
-        float x = MathHelper::RandF(-45.0f, 45.0f);
-        float z = MathHelper::RandF(-45.0f, 50.0f);
-        float y = 4.0f;
+    // 분포 생성이 끝날 때까지 대기 (생성 중 예외는 여기서 다시 던짐)
+    auto StartTime = std::chrono::high_resolution_clock::now();
+    m_VegetationBuild.get();
+    auto EndTime = std::chrono::high_resolution_clock::now();
 
-        Vertices[i].Pos = XMFLOAT3(x, y, z);
-        Vertices[i].Size = XMFLOAT2(10.0f, 10.0f);
-    }
+    m_VegetationCapacity = m_Vegetation.GetInstanceCount();
 
-    std::array<std::int32_t, TreeCount> Indices;
-    for (UINT i = 0; i < TreeCount; ++i)
-    {
-        Indices[i] = i;
-    }
+    GeometryInfo* Geometry = m_VegetationGeometry;
 
-    auto Geometry = std::make_unique<GeometryInfo>();
-    Geometry->Name = TEXT("Tree");
-
-    //  
-    Geometry->VertexCount = (UINT)Vertices.size();
+    // 정점 버퍼 : 보이는 인스턴스만 매 프레임 기록 (UpdateVegetation), 프레임 슬롯마다 별도 영역
+    // 인덱스 버퍼 : 0 ~ Capacity-1 을 정점 영역 뒤에 한 번만 기록 (지오메트리 풀은 BuildGeometry 에서 이미 업로드를 마침)
+    Geometry->VertexCount = m_VegetationCapacity;
     const UINT VBByteSize = Geometry->VertexCount * sizeof(TreeVertex);
+    const UINT IBByteSize = m_VegetationCapacity * sizeof(std::uint32_t);
+    const UINT64 IndexOffset = (UINT64)VBByteSize * FRAME_RESOURCE_COUNT;
 
-    Geometry->VertexBuffer = d3dUtil::CreateDefaultBuffer(m_D3dDevice.Get(), m_CommandList.Get(), Vertices.data(), VBByteSize, Geometry->VertexUploadBuffer);
+    ThrowIfFailed(m_D3dDevice->CreateCommittedResource(
+        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+        D3D12_HEAP_FLAG_NONE,
+        &CD3DX12_RESOURCE_DESC::Buffer(IndexOffset + IBByteSize),
+        D3D12_RESOURCE_STATE_GENERIC_READ,
+        nullptr,
+        IID_PPV_ARGS(&m_VegetationInstanceBuffer)));
 
-    Geometry->VertexBufferView.BufferLocation = Geometry->VertexBuffer->GetGPUVirtualAddress();
+    ThrowIfFailed(m_VegetationInstanceBuffer->Map(0, nullptr, reinterpret_cast<void**>(&m_VegetationMappedData)));
+
+    Geometry->VertexBufferView.BufferLocation = m_VegetationInstanceBuffer->GetGPUVirtualAddress();
     Geometry->VertexBufferView.StrideInBytes = sizeof(TreeVertex);
     Geometry->VertexBufferView.SizeInBytes = VBByteSize;
+    Geometry->BaseVertexLocation = 0;
 
-    // ε 
-    Geometry->IndexCount = (UINT)Indices.size();
-    const UINT IBByteSize = Geometry->IndexCount * sizeof(std::int32_t);
-
-    Geometry->IndexBuffer = d3dUtil::CreateDefaultBuffer(m_D3dDevice.Get(), m_CommandList.Get(), Indices.data(), IBByteSize, Geometry->IndexUploadBuffer);
+    std::uint32_t* Indices = reinterpret_cast<std::uint32_t*>(reinterpret_cast<BYTE*>(m_VegetationMappedData) + IndexOffset);
+    for (UINT i = 0; i < m_VegetationCapacity; ++i)
+    {
+        Indices[i] = i;
+    }
 
-    Geometry->IndexBufferView.BufferLocation = Geometry->IndexBuffer->GetGPUVirtualAddress();
+    Geometry->IndexBufferView.BufferLocation = m_VegetationInstanceBuffer->GetGPUVirtualAddress() + IndexOffset;
     Geometry->IndexBufferView.Format = DXGI_FORMAT_R32_UINT;
     Geometry->IndexBufferView.SizeInBytes = IBByteSize;
+    Geometry->StartIndexLocation = 0;
 
-    m_Geometries[Geometry->Name] = std::move(Geometry);
-
+    std::wostringstream Log;
+    Log << L"Vegetation: " << m_VegetationCapacity << L" instances, waited "
+        << std::chrono::duration<double, std::milli>(EndTime - StartTime).count() << L" ms for the scatter build\n";
+    OutputDebugString(Log.str().c_str());
 }
 
 void D3DSample::CreateQuadGeometry()
@@ -1458,25 +1763,11 @@ void D3DSample::CreateQuadGeometry()
     auto Geometry = std::make_unique<GeometryInfo>();
     Geometry->Name = TEXT("Quad");
 
-    //  
-    Geometry->VertexCount = (UINT)Vertices.size();
-    const UINT VBByteSize = Geometry->VertexCount * sizeof(Vertex);
-
-    Geometry->VertexBuffer = d3dUtil::CreateDefaultBuffer(m_D3dDevice.Get(), m_CommandList.Get(), Vertices.data(), VBByteSize, Geometry->VertexUploadBuffer);
-
-    Geometry->VertexBufferView.BufferLocation = Geometry->VertexBuffer->GetGPUVirtualAddress();
-    Geometry->VertexBufferView.StrideInBytes = sizeof(Vertex);
-    Geometry->VertexBufferView.SizeInBytes = VBByteSize;
+    // 경계 상자
+    BoundingBox::CreateFromPoints(Geometry->Bounds, Vertices.size(), &Vertices[0].Pos, sizeof(Vertex));
 
-    // ε 
-    Geometry->IndexCount = (UINT)Indices.size();
-    const UINT IBByteSize = Geometry->IndexCount * sizeof(std::int32_t);
-
-    Geometry->IndexBuffer = d3dUtil::CreateDefaultBuffer(m_D3dDevice.Get(), m_CommandList.Get(), Indices.data(), IBByteSize, Geometry->IndexUploadBuffer);
-
-    Geometry->IndexBufferView.BufferLocation = Geometry->IndexBuffer->GetGPUVirtualAddress();
-    Geometry->IndexBufferView.Format = DXGI_FORMAT_R32_UINT;
-    Geometry->IndexBufferView.SizeInBytes = IBByteSize;
+    // 정점 / 인덱스 버퍼
+    UploadGeometry(Geometry.get(), Vertices.data(), (UINT)Vertices.size(), sizeof(Vertex), Indices.data(), (UINT)Indices.size());
 
     m_Geometries[Geometry->Name] = std::move(Geometry);
 }
@@ -1486,8 +1777,20 @@ void D3DSample::CreateSkinnedModel()
     std::vector<M3DLoader::SkinnedVertex> Vertices;
     std::vector<std::uint16_t> Indices;
 
+    FileReadResult ModelFile = m_SkinnedModelFile.get();
+
+    // 빈 스트림을 파싱하면 본이 없는 모델이 되므로 읽기 실패는 여기서 알림
+    if (!ModelFile.bOk)
+    {
+        const HRESULT hr = ModelFile.Error != 0 ? HRESULT_FROM_WIN32(ModelFile.Error) : HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+        throw DxException(hr, L"CreateSkinnedModel: " + AnsiToWString(m_SkinnedModelFileName), AnsiToWString(__FILE__), __LINE__);
+    }
+
+    ByteViewBuffer ModelBuffer(ModelFile.Data);
+    std::istream ModelStream(&ModelBuffer);
+
     M3DLoader ModelLoader;
-    ModelLoader.LoadM3d(m_SkinnedModelFileName, Vertices, Indices, m_SkinnedSubsets, m_SkinnedMaterials, m_SkinnedInfo);
+    ModelLoader.LoadM3d(ModelStream, Vertices, Indices, m_SkinnedSubsets, m_SkinnedMaterials, m_SkinnedInfo);
 
     m_SkinnedModelAnimation = std::make_unique<SkinnedModelAnimation>();
     m_SkinnedModelAnimation->SkinnedInfo = &m_SkinnedInfo;
@@ -1495,34 +1798,25 @@ void D3DSample::CreateSkinnedModel()
     m_SkinnedModelAnimation->ClipName = "Take1";
     m_SkinnedModelAnimation->TimePos = 0.0f;
 
-    for (UINT i = 0; i < (UINT)m_SkinnedSubsets.size(); ++i)
-    {
-        auto Geometry = std::make_unique<GeometryInfo>();
-        Geometry->Name = TEXT("sm_") + std::to_wstring(i);
-
-        //  
-        Geometry->VertexCount = (UINT)Vertices.size();
-        const UINT VBByteSize = Geometry->VertexCount * sizeof(M3DLoader::SkinnedVertex);
-
-        Geometry->VertexBuffer = d3dUtil::CreateDefaultBuffer(m_D3dDevice.Get(), m_CommandList.Get(), Vertices.data(), VBByteSize, Geometry->VertexUploadBuffer);
+    // 모든 서브셋이 정점 / 인덱스를 한 번만 올린 범위를 공유 (풀 인덱스 버퍼는 32비트)
+    std::vector<std::int32_t> Indices32(Indices.begin(), Indices.end());
 
-        Geometry->VertexBufferView.BufferLocation = Geometry->VertexBuffer->GetGPUVirtualAddress();
-        Geometry->VertexBufferView.StrideInBytes = sizeof(M3DLoader::SkinnedVertex);
-        Geometry->VertexBufferView.SizeInBytes = VBByteSize;
+    GeometryInfo Shared;
+    UploadGeometry(&Shared, Vertices.data(), (UINT)Vertices.size(), sizeof(M3DLoader::SkinnedVertex), Indices32.data(), (UINT)Indices32.size());
 
-        // ε 
-        Geometry->IndexCount = (UINT)Indices.size();
-        const UINT IBByteSize = Geometry->IndexCount * sizeof(std::uint16_t);
+    BoundingBox Bounds;
+    BoundingBox::CreateFromPoints(Bounds, Vertices.size(), &Vertices[0].Pos, sizeof(M3DLoader::SkinnedVertex));
 
-        Geometry->IndexBuffer = d3dUtil::CreateDefaultBuffer(m_D3dDevice.Get(), m_CommandList.Get(), Indices.data(), IBByteSize, Geometry->IndexUploadBuffer);
+    for (UINT i = 0; i < (UINT)m_SkinnedSubsets.size(); ++i)
+    {
+        auto Geometry = std::make_unique<GeometryInfo>(Shared);
+        Geometry->Name = TEXT("sm_") + std::to_wstring(i);
 
-        Geometry->IndexBufferView.BufferLocation = Geometry->IndexBuffer->GetGPUVirtualAddress();
-        Geometry->IndexBufferView.Format = DXGI_FORMAT_R16_UINT;
-        Geometry->IndexBufferView.SizeInBytes = IBByteSize;
+        // 경계 상자
+        Geometry->Bounds = Bounds;
 
         Geometry->IndexCount = (UINT)m_SkinnedSubsets[i].FaceCount * 3;
-        Geometry->StartIndexLocation = m_SkinnedSubsets[i].FaceStart * 3;
-        Geometry->BaseVertexLocation = 0;
+        Geometry->StartIndexLocation = Shared.StartIndexLocation + m_SkinnedSubsets[i].FaceStart * 3;
 
         m_Geometries[Geometry->Name] = std::move(Geometry);
     }
@@ -1530,9 +1824,21 @@ void D3DSample::CreateSkinnedModel()
 
 void D3DSample::UpdateObjectCB(float deltaTime)
 {
-    for (size_t i = 0; i < m_RenderItems.size(); ++i)
+    UINT ElementByteSize = (sizeof(ObjectConstant) + 255) & ~255;
+
+    UploadAllocation ObjectCB = AllocateUpload((UINT64)ElementByteSize * m_RenderItems.size());
+    m_ObjectCBAddress = ObjectCB.GpuAddress;
+    BYTE* ObjectData = ObjectCB.CpuAddress;
+
+    // 인스턴싱 배치가 읽는 아이템별 레코드 (오브젝트 상수와 같은 값이므로 같은 추적기로 바뀐 아이템만 기록)
+    UploadAllocation InstanceBuffer = AllocateUpload(sizeof(InstanceData) * m_RenderItems.size());
+    m_InstanceAddress = InstanceBuffer.GpuAddress;
+    InstanceData* Instances = reinterpret_cast<InstanceData*>(InstanceBuffer.CpuAddress);
+
+    // 이 슬롯에 아직 없는 값만 기록 (ObjectCBIndex 는 m_RenderItems 순서와 같고, 오름차순이라 주소도 앞으로만 진행)
+    m_ObjectsWritten = m_ObjectDirty.Flush([&](uint32_t ElementIndex)
     {
-        auto RenderItem = m_RenderItems[i].get();
+        auto RenderItem = m_RenderItems[ElementIndex].get();
         XMMATRIX World = XMLoadFloat4x4(&RenderItem->World);
         XMMATRIX TextureTransform = XMLoadFloat4x4(&RenderItem->TextureTransform);
 
@@ -1540,10 +1846,14 @@ void D3DSample::UpdateObjectCB(float deltaTime)
         XMStoreFloat4x4(&ObjectCB.World, XMMatrixTranspose(World));
         XMStoreFloat4x4(&ObjectCB.TextureTransform, XMMatrixTranspose(TextureTransform));
 
-        UINT ElementIndex = RenderItem->ObjectCBIndex;
-        UINT ElementByteSize = (sizeof(ObjectConstant) + 255) & ~255;
-        memcpy(&m_ObjectMappedData[ElementIndex * ElementByteSize], &ObjectCB, sizeof(ObjectCB));
-    }
+        memcpy(&ObjectData[ElementIndex * ElementByteSize], &ObjectCB, sizeof(ObjectCB));
+
+        InstanceData& Instance = Instances[ElementIndex];
+        Instance.World = ObjectCB.World;
+        Instance.TextureTransform = ObjectCB.TextureTransform;
+    });
+
+    m_CBBytesWritten += m_ObjectsWritten * (sizeof(ObjectConstant) + sizeof(InstanceData));
 }
 
 void D3DSample::UpdatePassCB(float deltaTime)
@@ -1581,14 +1891,24 @@ void D3DSample::UpdatePassCB(float deltaTime)
 
 
 
-    memcpy(&m_PassMappedData[0], &PassCB, sizeof(PassCB));
+    UploadAllocation PassCBAllocation = AllocateUpload(sizeof(PassConstant));
+    m_PassCBAddress = PassCBAllocation.GpuAddress;
+
+    memcpy(PassCBAllocation.CpuAddress, &PassCB, sizeof(PassCB));
+    m_CBBytesWritten += sizeof(PassCB);
 }
 
 void D3DSample::UpdateMaterialCB(float deltaTime)
 {
-    for (auto& Material : m_Materials)
+    UploadAllocation MaterialCB = AllocateUpload((UINT64)d3dUtil::CalcConstantBufferByteSize(sizeof(MatConstant)) * m_MaterialsByCBIndex.size());
+    m_MaterialCBAddress = MaterialCB.GpuAddress;
+    BYTE* MaterialData = MaterialCB.CpuAddress;
+
+    m_MaterialsWritten = m_MaterialDirty.Flush([&](uint32_t MaterialIndex)
     {
-        MaterialInfo* MatInfo = Material.second.get();
+        MaterialInfo* MatInfo = m_MaterialsByCBIndex[MaterialIndex];
+        if (MatInfo == nullptr)
+            return;
 
         MatConstant MaterialCB;
         MaterialCB.Albedo = MatInfo->Albedo;
@@ -1596,11 +1916,28 @@ void D3DSample::UpdateMaterialCB(float deltaTime)
         MaterialCB.Roughness = MatInfo->Roughness;
         MaterialCB.Texture_On = MatInfo->Texture_On;
         MaterialCB.Normal_On = MatInfo->Normal_On;
+        MaterialCB.TextureSlice = MatInfo->TextureSlice;
+        MaterialCB.TextureScaleBias = MatInfo->TextureScaleBias;
+
+        // 바인드리스 모드에서 셰이더가 고를 서술자 슬롯
+        MaterialCB.DiffuseIndex = MatInfo->DiffuseTexture ? MatInfo->DiffuseTexture->TextureHeapIndex : 0;
+        MaterialCB.NormalIndex = MatInfo->NormalTexture ? MatInfo->NormalTexture->TextureHeapIndex : MaterialCB.DiffuseIndex;
 
-        UINT MaterialIndex = MatInfo->MatCBIndex;
         UINT MaterialByteSize = (sizeof(MatConstant) + 255) & ~255;
-        memcpy(&m_MaterialMappedData[MaterialIndex * MaterialByteSize], &MaterialCB, sizeof(MaterialCB));
-    }
+        memcpy(&MaterialData[MaterialIndex * MaterialByteSize], &MaterialCB, sizeof(MaterialCB));
+    });
+
+    m_CBBytesWritten += m_MaterialsWritten * sizeof(MatConstant);
+}
+
+void D3DSample::MarkObjectDirty(RenderItem* item)
+{
+    m_ObjectDirty.MarkDirty(item->ObjectCBIndex);
+}
+
+void D3DSample::MarkMaterialDirty(MaterialInfo* material)
+{
+    m_MaterialDirty.MarkDirty(material->MatCBIndex);
 }
 
 void D3DSample::UpdateShadowMapPassCB(float deltaTime)
@@ -1622,8 +1959,11 @@ void D3DSample::UpdateShadowMapPassCB(float deltaTime)
 
     ShadowMapPassCB.EyePosW = m_LightPosW;
 
-    UINT PassCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(PassConstant));
-    memcpy(&m_PassMappedData[1 * PassCBByteSize], &ShadowMapPassCB, sizeof(PassConstant));
+    UploadAllocation ShadowPassCB = AllocateUpload(sizeof(PassConstant));
+    m_ShadowPassCBAddress = ShadowPassCB.GpuAddress;
+
+    memcpy(ShadowPassCB.CpuAddress, &ShadowMapPassCB, sizeof(PassConstant));
+    m_CBBytesWritten += sizeof(PassConstant);
 }
 
 void D3DSample::UpdateSkinnedCB(float deltaTime)
@@ -1636,7 +1976,11 @@ void D3DSample::UpdateSkinnedCB(float deltaTime)
         std::end(m_SkinnedModelAnimation->FinalTransforms),
         &SkinnedCB.BoneTransforms[0]);
 
-    memcpy(&m_SkinnedMappedData[0], &SkinnedCB, sizeof(SkinnedConstant));
+    UploadAllocation SkinnedCBAllocation = AllocateUpload(sizeof(SkinnedConstant));
+    m_SkinnedCBAddress = SkinnedCBAllocation.GpuAddress;
+
+    memcpy(SkinnedCBAllocation.CpuAddress, &SkinnedCB, sizeof(SkinnedConstant));
+    m_CBBytesWritten += sizeof(SkinnedConstant);
 }
 
 void D3DSample::UpdateCamera(float deltaTime)
@@ -1662,7 +2006,7 @@ void D3DSample::UpdateLight(float deltaTime)
     lightDir = XMVector3TransformNormal(lightDir, R);
     XMStoreFloat3(&m_RotatedLightDirection, lightDir);
 
-    // Ʈ  
+    // 라이트 행렬 연산
     XMVECTOR lightPos = -2.0f * m_SceneBounds.Radius * lightDir;
     XMVECTOR targetPos = XMLoadFloat3(&m_SceneBounds.Center);
     XMVECTOR lightUp = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
@@ -1684,6 +2028,8 @@ void D3DSample::UpdateLight(float deltaTime)
 
     m_LightNearZ = nearZ;
     m_LightFarZ = farZ;
+    m_LightVolumeMin = XMFLOAT3(left, bottom, nearZ);
+    m_LightVolumeMax = XMFLOAT3(right, top, farZ);
 
     XMStoreFloat4x4(&m_LightView, lightView);
     XMStoreFloat4x4(&m_LightProj, lightProj);
@@ -1698,101 +2044,690 @@ void D3DSample::UpdateLight(float deltaTime)
     XMStoreFloat4x4(&m_ShadowTransform, S);
 }
 
+void D3DSample::UpdateVegetation(float deltaTime)
+{
+    // 월드 공간 카메라 절두체 평면 (CullRenderItems 와 같은 추출)
+    XMFLOAT4X4 ViewProj;
+    XMStoreFloat4x4(&ViewProj, XMMatrixMultiply(m_Camera.GetView(), m_Camera.GetProj()));
+
+    float Planes[6][4];
+    FrustumCuller::ExtractPlanes(&ViewProj.m[0][0], Planes);
+
+    const XMFLOAT3 EyePos = m_Camera.GetPosition3f();
+
+    // 보이는 인스턴스를 이번 프레임 슬롯 영역 앞쪽에 연속으로 기록
+    GeometryInfo* Geometry = m_VegetationGeometry;
+    const UINT FrameByteSize = Geometry->VertexBufferView.SizeInBytes;
+    const UINT FrameOffset = m_FrameRing.GetCurrentIndex() * FrameByteSize;
+
+    VegetationInstance* FrameData = reinterpret_cast<VegetationInstance*>(reinterpret_cast<BYTE*>(m_VegetationMappedData) + FrameOffset);
+    UINT VisibleCount = m_Vegetation.Cull(Planes, &EyePos.x, FrameData, m_VegetationCapacity);
+
+    Geometry->VertexBufferView.BufferLocation = m_VegetationInstanceBuffer->GetGPUVirtualAddress() + FrameOffset;
+    Geometry->IndexCount = VisibleCount;
+}
+
+void D3DSample::UpdateTextureStreaming()
+{
+    m_TextureStreamer.BeginFrame();
+
+    const XMVECTOR EyePos = m_Camera.GetPosition();
+    const float ProjScaleY = m_Camera.GetProj4x4f()._22;
+
+    auto RequestTexture = [&](const TextureInfo* texture, float screenTexels)
+    {
+        if (texture != nullptr && texture->StreamIndex >= 0)
+            m_TextureStreamer.RequestFootprint((UINT)texture->StreamIndex, screenTexels);
+    };
+
+    // 렌더 아이템 경계 구의 화면 크기로 필요한 밉 추정
+    for (auto& RenderItem : m_RenderItems)
+    {
+        const MaterialInfo* Material = RenderItem->Material;
+        if (Material == nullptr || Material->Texture_On == 0)
+            continue;
+
+        BoundingSphere WorldSphere;
+        BoundingSphere::CreateFromBoundingBox(WorldSphere, RenderItem->Geometry->Bounds);
+        WorldSphere.Transform(WorldSphere, XMLoadFloat4x4(&RenderItem->World));
+
+        const float Distance = XMVectorGetX(XMVector3Length(XMLoadFloat3(&WorldSphere.Center) - EyePos));
+        const float UvScale = (std::max)(fabsf(RenderItem->TextureTransform._11), fabsf(RenderItem->TextureTransform._22));
+
+        const float ScreenTexels = TextureStreamingPolicy::EstimateScreenTexels(
+            WorldSphere.Radius, Distance, ProjScaleY, (float)m_nClientHeight, UvScale);
+
+        // 아틀라스 서브 이미지는 아틀라스 전체 크기 기준 텍셀 수로 환산
+        const float PackScale = (std::max)(Material->TextureScaleBias.x, Material->TextureScaleBias.y);
+
+        RequestTexture(Material->DiffuseTexture, ScreenTexels / PackScale);
+
+        if (Material->Normal_On)
+            RequestTexture(Material->NormalTexture, ScreenTexels / PackScale);
+    }
+
+    // GPU 가 복사를 끝낸 업로드 링 공간과 다 읽은 서술자 슬롯 회수
+    const UINT64 CompletedFence = m_Fence->GetCompletedValue();
+    m_UploadRing.Reclaim(CompletedFence);
+    m_SrvHeap.Reclaim(CompletedFence);
+
+    // 교체된 리소스와 링 공간은 이번 프레임 펜스(m_CurrentFence + 1)를 지난 뒤 해제
+    std::vector<UINT> ChangedTextures;
+    m_TextureStreamer.Update(m_D3dDevice.Get(), m_CommandList.Get(), *m_ThreadPool, m_UploadRing,
+        CompletedFence, m_CurrentFence + 1, ChangedTextures);
+
+    // 아직 실행 중인 이전 프레임이 기존 SRV 를 읽고 있으므로 덮어쓰지 않고 새 슬롯에 만들고,
+    // 기존 슬롯은 이번 프레임 펜스를 지나면 해제 목록으로 돌려줌 (GPU 대기 없음)
+    for (UINT StreamIndex : ChangedTextures)
+    {
+        TextureInfo* Texture = m_StreamedTextures[StreamIndex];
+        Texture->Resource = m_TextureStreamer.GetResource(StreamIndex);
+
+        m_SrvHeap.FreePersistent(Texture->TextureHeapIndex, 1, m_CurrentFence + 1);
+        Texture->TextureHeapIndex = m_SrvHeap.AllocatePersistent();
+        CreateTextureSRV(Texture);
+
+        // 재질 상수의 서술자 인덱스는 다음 프레임부터 새 슬롯 (이번 프레임은 기존 슬롯을 읽음)
+        for (MaterialInfo* Material : m_MaterialsByCBIndex)
+        {
+            if (Material != nullptr && (Material->DiffuseTexture == Texture || Material->NormalTexture == Texture))
+                MarkMaterialDirty(Material);
+        }
+    }
+}
+
+void D3DSample::UpdateTextureTables()
+{
+    // 바인드리스 모드는 재질 상수의 인덱스로 텍스처를 고르므로 테이블이 필요 없음
+    if (m_bBindless)
+        return;
+
+    for (MaterialInfo* Material : m_MaterialsByCBIndex)
+    {
+        if (Material != nullptr)
+            Material->TextureTableIndex = DescriptorAllocator::InvalidIndex;
+    }
+
+    // 재질의 t0/t1 서술자를 임시 영역에 나란히 복사 (이번 프레임 펜스를 지나면 재사용)
+    // 같은 텍스처 쌍은 테이블 하나를 공유하고, 노멀 맵이 없는 재질은 t1 을 읽지 않으므로
+    // 색상 텍스처만 같으면 공유 (그래서 노멀 맵이 있는 재질부터 복사)
+    for (int Pass = 0; Pass < 2; ++Pass)
+    {
+        for (MaterialInfo* Material : m_MaterialsByCBIndex)
+        {
+            if (Material == nullptr || Material->Texture_On == 0 || (Material->NormalTexture != nullptr) != (Pass == 0))
+                continue;
+
+            for (const MaterialInfo* Other : m_MaterialsByCBIndex)
+            {
+                if (Other != nullptr && Other->TextureTableIndex != DescriptorAllocator::InvalidIndex &&
+                    Other->DiffuseTexture == Material->DiffuseTexture &&
+                    (Material->NormalTexture == nullptr || Other->NormalTexture == Material->NormalTexture))
+                {
+                    Material->TextureTableIndex = Other->TextureTableIndex;
+                    break;
+                }
+            }
+
+            if (Material->TextureTableIndex == DescriptorAllocator::InvalidIndex)
+            {
+                const TextureInfo* Normal = Material->NormalTexture != nullptr ? Material->NormalTexture : Material->DiffuseTexture;
+                const UINT Table[2] = { Material->DiffuseTexture->TextureHeapIndex, Normal->TextureHeapIndex };
+                Material->TextureTableIndex = m_SrvHeap.CopyToTransient(Table, _countof(Table));
+            }
+        }
+    }
+
+    m_SrvHeap.RetireTransient(m_CurrentFence + 1);
+}
+
+void D3DSample::CullRenderItems()
+{
+    auto StartTime = std::chrono::high_resolution_clock::now();
+
+    if (m_bFrustumCulling)
+    {
+        XMFLOAT4X4 ViewProj;
+        XMStoreFloat4x4(&ViewProj, XMMatrixMultiply(m_Camera.GetView(), m_Camera.GetProj()));
+
+        if (m_bUseSceneBVH)
+        {
+            float Planes[6][4];
+            FrustumCuller::ExtractPlanes(&ViewProj.m[0][0], Planes);
+
+            m_VisibleItems.clear();
+            m_SceneBVH.QueryFrustum(Planes, [&](uint32_t Item) { m_VisibleItems.push_back(Item); });
+        }
+        else
+        {
+            m_FrustumCuller.SetViewProjection(&ViewProj.m[0][0]);
+            m_FrustumCuller.Cull(m_VisibleItems);
+        }
+
+        for (RenderItem* Item : m_CullItems)
+        {
+            Item->bVisible = false;
+        }
+        for (uint32_t Index : m_VisibleItems)
+        {
+            m_CullItems[Index]->bVisible = true;
+        }
+    }
+    else
+    {
+        m_VisibleItems.resize(m_CullItems.size());
+        for (size_t i = 0; i < m_CullItems.size(); ++i)
+        {
+            m_CullItems[i]->bVisible = true;
+            m_VisibleItems[i] = (uint32_t)i;
+        }
+    }
+
+    auto EndTime = std::chrono::high_resolution_clock::now();
+    m_ItemCullMilliseconds = std::chrono::duration<double, std::milli>(EndTime - StartTime).count();
+
+#if defined(_DEBUG)
+    // 평면 테스트는 보수적이므로 BoundingFrustum 이 보인다고 판정한 아이템은 반드시 남아 있어야 함
+    XMMATRIX View = m_Camera.GetView();
+    XMMATRIX InvView = XMMatrixInverse(&XMMatrixDeterminant(View), View);
+
+    BoundingFrustum CameraFrustum;
+    BoundingFrustum::CreateFromMatrix(CameraFrustum, m_Camera.GetProj());
+
+    BoundingFrustum WorldFrustum;
+    CameraFrustum.Transform(WorldFrustum, InvView);
+
+    for (const RenderItem* Item : m_CullItems)
+    {
+        BoundingBox WorldBounds;
+        Item->Geometry->Bounds.Transform(WorldBounds, XMLoadFloat4x4(&Item->World));
+        assert(Item->bVisible || !WorldFrustum.Intersects(WorldBounds));
+    }
+#endif
+}
+
+void D3DSample::CullShadowCasters()
+{
+    for (auto& Item : m_RenderItems)
+    {
+        Item->bShadowVisible = !m_bShadowCasterCulling;
+    }
+
+    if (m_bShadowCasterCulling)
+    {
+        XMMATRIX LightView = XMLoadFloat4x4(&m_LightView);
+
+        // 그림자를 받는 영역 : 라이트 공간에서 본 카메라 절두체의 AABB 와 라이트 직교 볼륨의 교집합
+        XMMATRIX View = m_Camera.GetView();
+        XMMATRIX InvView = XMMatrixInverse(&XMMatrixDeterminant(View), View);
+
+        BoundingFrustum CameraFrustum;
+        BoundingFrustum::CreateFromMatrix(CameraFrustum, m_Camera.GetProj());
+
+        BoundingFrustum WorldFrustum;
+        CameraFrustum.Transform(WorldFrustum, InvView);
+
+        XMFLOAT3 Corners[BoundingFrustum::CORNER_COUNT];
+        WorldFrustum.GetCorners(Corners);
+
+        XMVECTOR ReceiverMin = XMVectorReplicate(+MathHelper::Infinity);
+        XMVECTOR ReceiverMax = XMVectorReplicate(-MathHelper::Infinity);
+        for (const XMFLOAT3& Corner : Corners)
+        {
+            XMVECTOR CornerLS = XMVector3Transform(XMLoadFloat3(&Corner), LightView);
+            ReceiverMin = XMVectorMin(ReceiverMin, CornerLS);
+            ReceiverMax = XMVectorMax(ReceiverMax, CornerLS);
+        }
+        ReceiverMin = XMVectorMax(ReceiverMin, XMLoadFloat3(&m_LightVolumeMin));
+        ReceiverMax = XMVectorMin(ReceiverMax, XMLoadFloat3(&m_LightVolumeMax));
+
+        XMFLOAT3 Min, Max;
+        XMStoreFloat3(&Min, ReceiverMin);
+        XMStoreFloat3(&Max, ReceiverMax);
+
+        // 받는 영역이 비어 있으면 그릴 캐스터도 없음
+        if (Min.x <= Max.x && Min.y <= Max.y && Min.z <= Max.z)
+        {
+            // 캐스터는 받는 영역의 x, y 범위 안에 있고 가장 먼 리시버보다 라이트에 가까워야 함
+            // 라이트 쪽(near)으로는 제한 없이 늘림
+            const XMFLOAT4 PlanesLS[6] =
+            {
+                XMFLOAT4(+1.0f, 0.0f, 0.0f, -Min.x),
+                XMFLOAT4(-1.0f, 0.0f, 0.0f, +Max.x),
+                XMFLOAT4(0.0f, +1.0f, 0.0f, -Min.y),
+                XMFLOAT4(0.0f, -1.0f, 0.0f, +Max.y),
+                XMFLOAT4(0.0f, 0.0f, -1.0f, +Max.z),
+                XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f),
+            };
+
+            // 라이트 공간 평면을 월드 공간으로 (n_w = LightView * n, d_w = d + 이동 성분)
+            XMMATRIX LightViewT = XMMatrixTranspose(LightView);
+            float Planes[6][4];
+            for (int i = 0; i < 6; ++i)
+            {
+                XMFLOAT4 PlaneW;
+                XMStoreFloat4(&PlaneW, XMVector4Transform(XMVectorSet(PlanesLS[i].x, PlanesLS[i].y, PlanesLS[i].z, 0.0f), LightViewT));
+                Planes[i][0] = PlaneW.x;
+                Planes[i][1] = PlaneW.y;
+                Planes[i][2] = PlaneW.z;
+                Planes[i][3] = PlaneW.w + PlanesLS[i].w;
+            }
+
+            m_SceneBVH.QueryFrustum(Planes, [&](uint32_t Index) { m_CullItems[Index]->bShadowVisible = true; });
+        }
+    }
+
+    m_ShadowCastersDrawn = 0;
+    m_ShadowCastersCulled = 0;
+    for (const ShadowPassLayer& Pass : ShadowPassLayers)
+    {
+        for (RenderItem* Item : m_RenderItemLayer[(int)Pass.Caster])
+        {
+            if (Item->bShadowVisible)
+                ++m_ShadowCastersDrawn;
+            else
+                ++m_ShadowCastersCulled;
+        }
+    }
+}
+
+void D3DSample::SortRenderItems()
+{
+    for (int i = 0; i < (int)RenderLayer::Count; ++i)
+    {
+        m_SortedRenderItemLayer[i].clear();
+        m_ShadowCasterLayer[i].clear();
+    }
+
+    // 정렬을 끄면 추가한 순서 그대로
+    if (!m_bSortDraws)
+    {
+        for (int i = 0; i < (int)RenderLayer::Count; ++i)
+        {
+            for (RenderItem* Item : m_RenderItemLayer[i])
+            {
+                if (Item->bVisible)
+                    m_SortedRenderItemLayer[i].push_back(Item);
+            }
+        }
+        for (const ShadowPassLayer& Pass : ShadowPassLayers)
+        {
+            for (RenderItem* Item : m_RenderItemLayer[(int)Pass.Caster])
+            {
+                if (Item->bShadowVisible)
+                    m_ShadowCasterLayer[(int)Pass.Caster].push_back(Item);
+            }
+        }
+        return;
+    }
+
+    XMVECTOR EyePosition = m_Camera.GetPosition();
+    XMVECTOR LookDirection = m_Camera.GetLook();
+    const float FarZ = m_Camera.GetFarZ();
+
+    m_DrawSortEntries.clear();
+    m_DrawSortItems.clear();
+
+    // 레이어 필드 = 그리는 순서, 파이프라인 필드 = 레이어의 PSO
+    for (UINT Pass = 0; Pass < _countof(MainPassLayers); ++Pass)
+    {
+        const RenderLayer Layer = MainPassLayers[Pass];
+
+        // 블렌딩하는 레이어는 뒤에서 앞으로, 나머지는 앞에서 뒤로
+        const bool bBackToFront = Layer == RenderLayer::Transparent;
+
+        for (RenderItem* Item : m_RenderItemLayer[(int)Layer])
+        {
+            XMVECTOR Center = XMVector3Transform(XMLoadFloat3(&Item->Geometry->Bounds.Center), XMLoadFloat4x4(&Item->World));
+            float ViewDepth = XMVectorGetX(XMVector3Dot(Center - EyePosition, LookDirection));
+
+            const MaterialInfo* Material = Item->Material;
+
+            DrawSortEntry Entry;
+            Entry.Key = DrawSortKey::Make(
+                Pass,
+                (UINT)Layer,
+                Material->Texture_On ? Material->DiffuseTexture->TextureHeapIndex + 1 : 0,
+                Material->MatCBIndex,
+                Item->Geometry->SortId,
+                DrawSortKey::QuantizeDepth(ViewDepth, FarZ),
+                bBackToFront);
+            Entry.Index = (UINT)m_DrawSortItems.size();
+
+            m_DrawSortEntries.push_back(Entry);
+            m_DrawSortItems.push_back(Item);
+        }
+    }
+
+    RadixSortDraws(m_DrawSortEntries, m_DrawSortScratch);
+
+    // 카메라에 보이지 않아도 그림자는 드리울 수 있으므로 캐스터는 따로 판정한 결과를 씀
+    for (const DrawSortEntry& Entry : m_DrawSortEntries)
+    {
+        const RenderLayer Layer = MainPassLayers[DrawSortKey::GetLayer(Entry.Key)];
+        RenderItem* Item = m_DrawSortItems[Entry.Index];
+
+        if (Item->bShadowVisible && IsShadowCasterLayer(Layer))
+            m_ShadowCasterLayer[(int)Layer].push_back(Item);
+
+        if (Item->bVisible)
+            m_SortedRenderItemLayer[(int)Layer].push_back(Item);
+    }
+}
+
+void D3DSample::BuildInstanceBatches()
+{
+    for (int i = 0; i < (int)RenderLayer::Count; ++i)
+    {
+        m_InstanceBatchLayer[i].clear();
+        m_ShadowBatchLayer[i].clear();
+    }
+
+    m_InstancedItems = 0;
+    m_InstancedDraws = 0;
+
+    if (!m_bInstancing)
+        return;
+
+    // 인스턴스 레코드는 UpdateObjectCB 가 아이템마다 하나씩 유지하므로 여기서는 배치가 읽을 레코드 번호만 기록
+    size_t TotalInstances = 0;
+    for (RenderLayer Layer : MainPassLayers)
+    {
+        if (IsInstancedLayer(Layer))
+            TotalInstances += m_SortedRenderItemLayer[(int)Layer].size();
+    }
+    for (const ShadowPassLayer& Pass : ShadowPassLayers)
+    {
+        if (IsInstancedLayer(Pass.Caster))
+            TotalInstances += m_ShadowCasterLayer[(int)Pass.Caster].size();
+    }
+
+    if (TotalInstances == 0)
+        return;
+
+    UploadAllocation IndexBuffer = AllocateUpload(sizeof(UINT) * TotalInstances);
+    m_InstanceIndexAddress = IndexBuffer.GpuAddress;
+
+    UINT* InstanceIndices = reinterpret_cast<UINT*>(IndexBuffer.CpuAddress);
+    UINT InstanceCount = 0;
+
+    auto AddBatches = [&](const std::vector<RenderItem*>& items, std::vector<DrawBatch>& batches)
+    {
+        // 정렬 키가 텍스처 / 재질 / 지오메트리 순이므로 같은 상태의 아이템은 이미 이어져 있음
+        FindInstanceRuns((uint32_t)items.size(), [&items](uint32_t previous, uint32_t current)
+        {
+            const RenderItem* Previous = items[previous];
+            const RenderItem* Current = items[current];
+            return Previous->Geometry == Current->Geometry &&
+                Previous->Material == Current->Material &&
+                Previous->PrimitiveType == Current->PrimitiveType;
+        }, m_InstanceRuns);
+
+        for (const InstanceRun& Run : m_InstanceRuns)
+        {
+            DrawBatch Batch;
+            Batch.Item = items[Run.First];
+            Batch.InstanceBase = InstanceCount;
+            Batch.InstanceCount = Run.Count;
+
+            // 메인 패스와 쉐도우 패스가 같은 레코드를 가리키므로 행렬은 다시 쓰지 않음
+            for (UINT i = Run.First; i < Run.First + Run.Count; ++i)
+                InstanceIndices[InstanceCount++] = items[i]->ObjectCBIndex;
+
+            batches.push_back(Batch);
+        }
+
+        m_InstancedItems += (UINT)items.size();
+        m_InstancedDraws += (UINT)m_InstanceRuns.size();
+    };
+
+    for (RenderLayer Layer : MainPassLayers)
+    {
+        if (IsInstancedLayer(Layer))
+            AddBatches(m_SortedRenderItemLayer[(int)Layer], m_InstanceBatchLayer[(int)Layer]);
+    }
+    for (const ShadowPassLayer& Pass : ShadowPassLayers)
+    {
+        if (IsInstancedLayer(Pass.Caster))
+            AddBatches(m_ShadowCasterLayer[(int)Pass.Caster], m_ShadowBatchLayer[(int)Pass.Caster]);
+    }
+}
+
+void D3DSample::WaitForGpu(UINT64 fenceValue)
+{
+    GpuFence Fence = { m_Fence.Get(), m_hFenceEvent };
+    if (Fence.GetCompletedValue() < fenceValue)
+        Fence.Wait(fenceValue);
+}
+
+void D3DSample::BindTextureTable(ID3D12GraphicsCommandList* cmdList, const MaterialInfo* material, DrawStateTracker& tracker)
+{
+    // 바인드리스 모드는 패스 상태에서 힙 전체를 한 번만 묶음
+    if (material->Texture_On == 0 || m_bBindless)
+        return;
+
+    if (!tracker.Set(DrawState::TextureTable, material->TextureTableIndex))
+        return;
+
+    cmdList->SetGraphicsRootDescriptorTable(3, m_SrvHeap.GetGpuHandle(material->TextureTableIndex));
+}
+
 void D3DSample::RenderGeometry()
 {
     UINT ObjectCBByteSize = (sizeof(ObjectConstant) + 255) & ~255;
     UINT MaterialCBByteSize = (sizeof(MatConstant) + 255) & ~255;
 
+    // 이 호출 안에서 묶은 상태
+    DrawStateTracker Tracker;
+
     for (size_t i = 0; i < m_RenderItems.size(); ++i)
     {
         auto RenderItem = m_RenderItems[i].get();
 
-        //  Ʈ ()   ε
-        D3D12_GPU_VIRTUAL_ADDRESS ObjectCBAddress = m_ObjectCB->GetGPUVirtualAddress();
+        // 개별 오브젝트 상수(월드행렬) 버퍼 정보 업로드
+        D3D12_GPU_VIRTUAL_ADDRESS ObjectCBAddress = m_ObjectCBAddress;
         ObjectCBAddress += RenderItem->ObjectCBIndex * ObjectCBByteSize;
 
         m_CommandList->SetGraphicsRootConstantBufferView(0, ObjectCBAddress);
 
-        //  Ʈ    ε
-        D3D12_GPU_VIRTUAL_ADDRESS MaterialCBAddress = m_MaterialCB->GetGPUVirtualAddress();
+        // 개별 오브젝트 재질 버퍼 정보 업로드
+        D3D12_GPU_VIRTUAL_ADDRESS MaterialCBAddress = m_MaterialCBAddress;
         MaterialCBAddress += RenderItem->Material->MatCBIndex * MaterialCBByteSize;
 
         m_CommandList->SetGraphicsRootConstantBufferView(2, MaterialCBAddress);
 
-        // ؽó   ε
-        CD3DX12_GPU_DESCRIPTOR_HANDLE TextureHeapAddress(m_TextureDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
-        TextureHeapAddress.Offset(RenderItem->Material->TextureHeapIndex, m_CbvSrvUavDescriptorSize);
-
-        if (RenderItem->Material->Texture_On)
-        {
-            m_CommandList->SetGraphicsRootDescriptorTable(3, TextureHeapAddress);
-        }
+        // 텍스처 버퍼 서술자 업로드 (같은 팩을 쓰는 연속된 아이템은 테이블을 다시 묶지 않음)
+        BindTextureTable(m_CommandList.Get(), RenderItem->Material, Tracker);
 
-        //  ε  
+        // 정점 인덱스 토폴로지 연결
         m_CommandList->IASetVertexBuffers(0, 1, &RenderItem->Geometry->VertexBufferView);
         m_CommandList->IASetIndexBuffer(&RenderItem->Geometry->IndexBufferView);
         m_CommandList->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
-        // 
-        m_CommandList->DrawIndexedInstanced(RenderItem->Geometry->IndexCount, 1, 0, 0, 0);
+        // 렌더링
+        m_CommandList->DrawIndexedInstanced(RenderItem->Geometry->IndexCount, 1, RenderItem->Geometry->StartIndexLocation, RenderItem->Geometry->BaseVertexLocation, 0);
     }
 }
 
 void D3DSample::RenderGeometry(const std::vector<RenderItem*>& RenderItems)
+{
+    RenderGeometry(m_CommandList.Get(), RenderItems.data(), RenderItems.size());
+}
+
+void D3DSample::RenderGeometry(ID3D12GraphicsCommandList* cmdList, RenderItem* const* renderItems, size_t count)
 {
     UINT ObjectCBByteSize = (sizeof(ObjectConstant) + 255) & ~255;
     UINT MaterialCBByteSize = (sizeof(MatConstant) + 255) & ~255;
     UINT SkinnedCBByteSize = (sizeof(SkinnedConstant) + 255) & ~255;
 
-    for (size_t i = 0; i < RenderItems.size(); ++i)
+    // 이 호출 안에서 묶은 상태 (정렬 키가 같은 상태를 쓰는 아이템을 모아 주므로 대부분 생략됨)
+    DrawStateTracker Tracker;
+
+    for (size_t i = 0; i < count; ++i)
     {
-        auto RenderItem = RenderItems[i];
+        auto RenderItem = renderItems[i];
 
-        //  Ʈ ()   ε
-        D3D12_GPU_VIRTUAL_ADDRESS ObjectCBAddress = m_ObjectCB->GetGPUVirtualAddress();
+        // 개별 오브젝트 상수(월드행렬) 버퍼 정보 업로드
+        D3D12_GPU_VIRTUAL_ADDRESS ObjectCBAddress = m_ObjectCBAddress;
         ObjectCBAddress += RenderItem->ObjectCBIndex * ObjectCBByteSize;
-        m_CommandList->SetGraphicsRootConstantBufferView(0, ObjectCBAddress);
+        if (Tracker.Set(DrawState::ObjectCB, ObjectCBAddress))
+            cmdList->SetGraphicsRootConstantBufferView(0, ObjectCBAddress);
 
-        //  Ʈ    ε
-        D3D12_GPU_VIRTUAL_ADDRESS MaterialCBAddress = m_MaterialCB->GetGPUVirtualAddress();
+        // 개별 오브젝트 재질 버퍼 정보 업로드
+        D3D12_GPU_VIRTUAL_ADDRESS MaterialCBAddress = m_MaterialCBAddress;
         MaterialCBAddress += RenderItem->Material->MatCBIndex * MaterialCBByteSize;
-        m_CommandList->SetGraphicsRootConstantBufferView(2, MaterialCBAddress);
+        if (Tracker.Set(DrawState::MaterialCB, MaterialCBAddress))
+            cmdList->SetGraphicsRootConstantBufferView(2, MaterialCBAddress);
 
-        // ؽó   ε
-        CD3DX12_GPU_DESCRIPTOR_HANDLE TextureHeapAddress(m_TextureDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
-        TextureHeapAddress.Offset(RenderItem->Material->TextureHeapIndex, m_CbvSrvUavDescriptorSize);
-        if (RenderItem->Material->Texture_On)
-        {
-            m_CommandList->SetGraphicsRootDescriptorTable(3, TextureHeapAddress);
-        }
+        // 텍스처 버퍼 서술자 업로드
+        BindTextureTable(cmdList, RenderItem->Material, Tracker);
 
-        // ŲƮ Ʈ 
-        D3D12_GPU_VIRTUAL_ADDRESS SkinnedCBAddress = m_SkinnedCB->GetGPUVirtualAddress();
+        // 스킨트 오브젝트의 본행렬
+        D3D12_GPU_VIRTUAL_ADDRESS SkinnedCBAddress = m_SkinnedCBAddress;
         SkinnedCBAddress += RenderItem->SkinnedCBIndex * SkinnedCBByteSize;
-        m_CommandList->SetGraphicsRootConstantBufferView(6, SkinnedCBAddress);
-
-        //  ε  
-        m_CommandList->IASetVertexBuffers(0, 1, &RenderItem->Geometry->VertexBufferView);
-        m_CommandList->IASetIndexBuffer(&RenderItem->Geometry->IndexBufferView);
-        m_CommandList->IASetPrimitiveTopology(RenderItem->PrimitiveType);
-
-        // 
-        m_CommandList->DrawIndexedInstanced(
+        if (Tracker.Set(DrawState::SkinnedCB, SkinnedCBAddress))
+            cmdList->SetGraphicsRootConstantBufferView(6, SkinnedCBAddress);
+
+        // 정점 인덱스 토폴로지 연결 (이 샘플에서 같은 버퍼의 뷰는 크기와 간격도 같음)
+        if (Tracker.Set(DrawState::VertexBuffer, RenderItem->Geometry->VertexBufferView.BufferLocation))
+            cmdList->IASetVertexBuffers(0, 1, &RenderItem->Geometry->VertexBufferView);
+        if (Tracker.Set(DrawState::IndexBuffer, RenderItem->Geometry->IndexBufferView.BufferLocation))
+            cmdList->IASetIndexBuffer(&RenderItem->Geometry->IndexBufferView);
+        if (Tracker.Set(DrawState::Topology, RenderItem->PrimitiveType))
+            cmdList->IASetPrimitiveTopology(RenderItem->PrimitiveType);
+
+        // 렌더링
+        cmdList->DrawIndexedInstanced(
             RenderItem->Geometry->IndexCount,
             1,
             RenderItem->Geometry->StartIndexLocation,
             RenderItem->Geometry->BaseVertexLocation,
             0);           
     }
+
+    for (UINT i = 0; i < (UINT)DrawState::Count; ++i)
+    {
+        m_StateCalls[i] += Tracker.GetIssued((DrawState)i);
+        m_StateSkips[i] += Tracker.GetSkipped((DrawState)i);
+    }
 }
 
-void D3DSample::RenderSceneToShadowMap()
+void D3DSample::RenderBatches(const std::vector<DrawBatch>& batches)
+{
+    RenderBatches(m_CommandList.Get(), batches.data(), batches.size());
+}
+
+void D3DSample::RenderBatches(ID3D12GraphicsCommandList* cmdList, const DrawBatch* batches, size_t count)
+{
+    UINT MaterialCBByteSize = (sizeof(MatConstant) + 255) & ~255;
+
+    D3D12_GPU_VIRTUAL_ADDRESS InstanceIndexAddress = m_InstanceIndexAddress;
+
+    // 레코드는 프레임 전체가 같은 위치이므로 명령 리스트마다 한 번만 연결
+    cmdList->SetGraphicsRootShaderResourceView(8, m_InstanceAddress);
+
+    DrawStateTracker Tracker;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        const DrawBatch& Batch = batches[i];
+        auto RenderItem = Batch.Item;
+
+        // 레코드 번호 목록 (SV_InstanceID 는 StartInstanceLocation 을 더하지 않으므로 SRV 시작 위치를 배치로 옮김)
+        cmdList->SetGraphicsRootShaderResourceView(7, InstanceIndexAddress + (UINT64)Batch.InstanceBase * sizeof(UINT));
+
+        // 배치 재질 버퍼 정보 업로드
+        D3D12_GPU_VIRTUAL_ADDRESS MaterialCBAddress = m_MaterialCBAddress;
+        MaterialCBAddress += RenderItem->Material->MatCBIndex * MaterialCBByteSize;
+        if (Tracker.Set(DrawState::MaterialCB, MaterialCBAddress))
+            cmdList->SetGraphicsRootConstantBufferView(2, MaterialCBAddress);
+
+        // 텍스처 버퍼 서술자 업로드
+        BindTextureTable(cmdList, RenderItem->Material, Tracker);
+
+        // 정점 인덱스 토폴로지 연결
+        if (Tracker.Set(DrawState::VertexBuffer, RenderItem->Geometry->VertexBufferView.BufferLocation))
+            cmdList->IASetVertexBuffers(0, 1, &RenderItem->Geometry->VertexBufferView);
+        if (Tracker.Set(DrawState::IndexBuffer, RenderItem->Geometry->IndexBufferView.BufferLocation))
+            cmdList->IASetIndexBuffer(&RenderItem->Geometry->IndexBufferView);
+        if (Tracker.Set(DrawState::Topology, RenderItem->PrimitiveType))
+            cmdList->IASetPrimitiveTopology(RenderItem->PrimitiveType);
+
+        // 배치 전체를 한 번에 렌더링
+        cmdList->DrawIndexedInstanced(
+            RenderItem->Geometry->IndexCount,
+            Batch.InstanceCount,
+            RenderItem->Geometry->StartIndexLocation,
+            RenderItem->Geometry->BaseVertexLocation,
+            0);
+    }
+
+    for (UINT i = 0; i < (UINT)DrawState::Count; ++i)
+    {
+        m_StateCalls[i] += Tracker.GetIssued((DrawState)i);
+        m_StateSkips[i] += Tracker.GetSkipped((DrawState)i);
+    }
+}
+
+void D3DSample::SetShadowPassState(ID3D12GraphicsCommandList* cmdList)
+{
+    cmdList->SetGraphicsRootSignature(m_RootSignature.Get());
+
+    cmdList->RSSetViewports(1, &m_ShadowMapViewport);
+    cmdList->RSSetScissorRects(1, &m_ShadowMapScissorRect);
+
+    cmdList->OMSetRenderTargets(0, nullptr, false, &m_hShadowMapDsv);
+
+    // 텍스처 서술자 렌더링 파이프라인에 묶기
+    ID3D12DescriptorHeap* DescritprHeaps[] = { m_SrvHeap.GetHeap() };
+    cmdList->SetDescriptorHeaps(_countof(DescritprHeaps), DescritprHeaps);
+
+    // 바인드리스 텍스처 배열 (알파 테스트 캐스터가 읽음)
+    if (m_bBindless)
+        cmdList->SetGraphicsRootDescriptorTable(3, m_SrvHeap.GetGpuHandle(0));
+
+    // 그림자 맵 공용 상수 버퍼
+    cmdList->SetGraphicsRootConstantBufferView(1, m_ShadowPassCBAddress);
+}
+
+void D3DSample::SetMainPassState(ID3D12GraphicsCommandList* cmdList)
+{
+    cmdList->RSSetViewports(1, &m_ScreenViewport);
+    cmdList->RSSetScissorRects(1, &m_ScissorRect);
+
+    cmdList->OMSetRenderTargets(1, &GetRenderTargetView(), true, &GetDepthStencilView());
+
+    cmdList->SetGraphicsRootSignature(m_RootSignature.Get());
+
+    // 텍스처 서술자 렌더링 파이프라인에 묶기
+    ID3D12DescriptorHeap* DescritprHeaps[] = { m_SrvHeap.GetHeap() };
+    cmdList->SetDescriptorHeaps(_countof(DescritprHeaps), DescritprHeaps);
+
+    // 바인드리스 텍스처 배열 (드로우마다 테이블을 묶지 않음)
+    if (m_bBindless)
+        cmdList->SetGraphicsRootDescriptorTable(3, m_SrvHeap.GetGpuHandle(0));
+
+    // 공용 상수 버퍼(뷰, 투영 행렬)
+    cmdList->SetGraphicsRootConstantBufferView(1, m_PassCBAddress);
+
+    // 스카이박스 텍스처 렌더링 파이프라인에 묶기
+    cmdList->SetGraphicsRootDescriptorTable(4, m_SrvHeap.GetGpuHandle(m_SkyboxTexture->TextureHeapIndex));
+
+    // 쉐도우 맵 텍스처 렌더링 파이프라인에 묶기
+    cmdList->SetGraphicsRootDescriptorTable(5, m_SrvHeap.GetGpuHandle(m_ShadowMapHeapIndex));
+}
+
+ID3D12PipelineState* D3DSample::GetPipelineState(RenderLayer layer, bool bInstanced)
 {
-    m_CommandList->SetGraphicsRootSignature(m_RootSignature.Get());
+    const std::uint32_t Features = GetLayerFeatures(layer);
+    if (Features == NoPermutation)
+        return m_PipelineStates[(int)layer].Get();
 
-    m_CommandList->RSSetViewports(1, &m_ShadowMapViewport);
-    m_CommandList->RSSetScissorRects(1, &m_ShadowMapScissorRect);
+    return m_ObjectPipelines[bInstanced ? Features | ShaderFeature_Instanced : Features].Get();
+}
 
+void D3DSample::RenderSceneToShadowMap()
+{
     m_CommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(
         m_ShadowMapResource.Get(),
         D3D12_RESOURCE_STATE_GENERIC_READ,
@@ -1800,23 +2735,181 @@ void D3DSample::RenderSceneToShadowMap()
 
     m_CommandList->ClearDepthStencilView(m_hShadowMapDsv, D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0, 0, nullptr);
 
-    m_CommandList->OMSetRenderTargets(0, nullptr, false, &m_hShadowMapDsv);
+    SetShadowPassState(m_CommandList.Get());
 
-    // ؽó   ο 
-    ID3D12DescriptorHeap* DescritprHeaps[] = { m_TextureDescriptorHeap.Get() };
-    m_CommandList->SetDescriptorHeaps(_countof(DescritprHeaps), DescritprHeaps);
-
-    // ׸    
-    UINT PassCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(PassConstant));
-    D3D12_GPU_VIRTUAL_ADDRESS PassCBAddress = m_PassCB->GetGPUVirtualAddress() + PassCBByteSize;
-    m_CommandList->SetGraphicsRootConstantBufferView(1, PassCBAddress);
-
-    // Opaque Ʈ 
-    m_CommandList->SetPipelineState(m_PipelineStates[RenderLayer::ShadowMap].Get());
-    RenderGeometry(m_RenderItemLayer[(int)RenderLayer::Opaque]);
+    // Opaque / SkinnedOpaque / AlphaTested 캐스터 렌더링
+    for (const ShadowPassLayer& Pass : ShadowPassLayers)
+    {
+        if (m_bInstancing && IsInstancedLayer(Pass.Caster))
+        {
+            m_CommandList->SetPipelineState(GetPipelineState(Pass.Pipeline, true));
+            RenderBatches(m_ShadowBatchLayer[(int)Pass.Caster]);
+        }
+        else
+        {
+            m_CommandList->SetPipelineState(GetPipelineState(Pass.Pipeline, false));
+            RenderGeometry(m_ShadowCasterLayer[(int)Pass.Caster]);
+        }
+    }
 
     m_CommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(
         m_ShadowMapResource.Get(),
         D3D12_RESOURCE_STATE_DEPTH_WRITE,
         D3D12_RESOURCE_STATE_GENERIC_READ));
 }
+
+void D3DSample::RenderParallel()
+{
+    auto StartTime = std::chrono::high_resolution_clock::now();
+
+    FrameResource& Frame = m_FrameResources[m_FrameRing.GetCurrentIndex()];
+    ID3D12Resource* BackBuffer = CurrentBackBuffer();
+
+    m_Recorder.Reset();
+
+    // 패스 1 : 쉐도우 맵 렌더링
+    m_Recorder.AddJob([this](ID3D12GraphicsCommandList& cmdList)
+    {
+        cmdList.ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(
+            m_ShadowMapResource.Get(), D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_STATE_DEPTH_WRITE));
+        cmdList.ClearDepthStencilView(m_hShadowMapDsv, D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0, 0, nullptr);
+    });
+
+    for (const ShadowPassLayer& Pass : ShadowPassLayers)
+    {
+        if (m_bInstancing && IsInstancedLayer(Pass.Caster))
+        {
+            const std::vector<DrawBatch>& ShadowBatches = m_ShadowBatchLayer[(int)Pass.Caster];
+            ID3D12PipelineState* ShadowMapPSO = GetPipelineState(Pass.Pipeline, true);
+
+            m_Recorder.AddPass(
+                [this, ShadowMapPSO](ID3D12GraphicsCommandList& cmdList)
+                {
+                    SetShadowPassState(&cmdList);
+                    cmdList.SetPipelineState(ShadowMapPSO);
+                },
+                ShadowBatches.size(), m_RecordChunkSize,
+                [this, &ShadowBatches](ID3D12GraphicsCommandList& cmdList, size_t begin, size_t end)
+                {
+                    RenderBatches(&cmdList, ShadowBatches.data() + begin, end - begin);
+                });
+            continue;
+        }
+
+        const std::vector<RenderItem*>& ShadowItems = m_ShadowCasterLayer[(int)Pass.Caster];
+
+        // 기록 람다는 PSO 포인터만 들고 가도록 미리 꺼내 둠
+        ID3D12PipelineState* ShadowMapPSO = GetPipelineState(Pass.Pipeline, false);
+
+        m_Recorder.AddPass(
+            [this, ShadowMapPSO](ID3D12GraphicsCommandList& cmdList)
+            {
+                SetShadowPassState(&cmdList);
+                cmdList.SetPipelineState(ShadowMapPSO);
+            },
+            ShadowItems.size(), m_RecordChunkSize,
+            [this, &ShadowItems](ID3D12GraphicsCommandList& cmdList, size_t begin, size_t end)
+            {
+                RenderGeometry(&cmdList, ShadowItems.data() + begin, end - begin);
+            });
+    }
+
+    // 패스 사이 전환 : 쉐도우 맵은 읽기, 백 버퍼는 렌더 타깃으로
+    m_Recorder.AddJob([this, BackBuffer](ID3D12GraphicsCommandList& cmdList)
+    {
+        D3D12_RESOURCE_BARRIER Barriers[] =
+        {
+            CD3DX12_RESOURCE_BARRIER::Transition(m_ShadowMapResource.Get(), D3D12_RESOURCE_STATE_DEPTH_WRITE, D3D12_RESOURCE_STATE_GENERIC_READ),
+            CD3DX12_RESOURCE_BARRIER::Transition(BackBuffer, D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET),
+        };
+        cmdList.ResourceBarrier(_countof(Barriers), Barriers);
+
+        cmdList.ClearRenderTargetView(GetRenderTargetView(), Colors::LightSkyBlue, 0, nullptr);
+        cmdList.ClearDepthStencilView(GetDepthStencilView(), D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0, 0, nullptr);
+    });
+
+    // 패스 2 : 오브젝트 렌더링 (직렬 경로와 같은 레이어 순서)
+    for (RenderLayer Layer : MainPassLayers)
+    {
+        if (m_bInstancing && IsInstancedLayer(Layer))
+        {
+            const std::vector<DrawBatch>& Batches = m_InstanceBatchLayer[(int)Layer];
+            ID3D12PipelineState* PipelineState = GetPipelineState(Layer, true);
+
+            m_Recorder.AddPass(
+                [this, PipelineState](ID3D12GraphicsCommandList& cmdList)
+                {
+                    SetMainPassState(&cmdList);
+                    cmdList.SetPipelineState(PipelineState);
+                },
+                Batches.size(), m_RecordChunkSize,
+                [this, &Batches](ID3D12GraphicsCommandList& cmdList, size_t begin, size_t end)
+                {
+                    RenderBatches(&cmdList, Batches.data() + begin, end - begin);
+                });
+            continue;
+        }
+
+        const std::vector<RenderItem*>& Items = m_SortedRenderItemLayer[(int)Layer];
+        ID3D12PipelineState* PipelineState = GetPipelineState(Layer, false);
+
+        m_Recorder.AddPass(
+            [this, PipelineState](ID3D12GraphicsCommandList& cmdList)
+            {
+                SetMainPassState(&cmdList);
+                cmdList.SetPipelineState(PipelineState);
+            },
+            Items.size(), m_RecordChunkSize,
+            [this, &Items](ID3D12GraphicsCommandList& cmdList, size_t begin, size_t end)
+            {
+                RenderGeometry(&cmdList, Items.data() + begin, end - begin);
+            });
+    }
+
+    m_Recorder.AddJob([BackBuffer](ID3D12GraphicsCommandList& cmdList)
+    {
+        cmdList.ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(BackBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT));
+    });
+
+    // 작업 수만큼 이 슬롯의 할당자 / 리스트 확보 (닫힌 상태로 보관)
+    const size_t JobCount = m_Recorder.GetJobCount();
+    while (Frame.JobLists.size() < JobCount)
+    {
+        ComPtr<ID3D12CommandAllocator> CommandAlloc;
+        ThrowIfFailed(m_D3dDevice->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(&CommandAlloc)));
+
+        ComPtr<ID3D12GraphicsCommandList> CommandList;
+        ThrowIfFailed(m_D3dDevice->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, CommandAlloc.Get(), nullptr, IID_PPV_ARGS(&CommandList)));
+        ThrowIfFailed(CommandList->Close());
+
+        Frame.JobAllocs.push_back(CommandAlloc);
+        Frame.JobLists.push_back(CommandList);
+    }
+
+    // 작업 i 는 항상 리스트 i 에 기록되므로 제출 순서는 작업을 추가한 순서
+    auto BeginList = [&Frame](size_t i) -> ID3D12GraphicsCommandList&
+    {
+        ThrowIfFailed(Frame.JobAllocs[i]->Reset());
+        ThrowIfFailed(Frame.JobLists[i]->Reset(Frame.JobAllocs[i].Get(), nullptr));
+        return *Frame.JobLists[i].Get();
+    };
+    auto EndList = [](size_t, ID3D12GraphicsCommandList& cmdList)
+    {
+        ThrowIfFailed(cmdList.Close());
+    };
+
+    m_Recorder.Record(*m_ThreadPool, BeginList, EndList);
+
+    // 텍스처 스트리밍 복사가 담긴 m_CommandList 가 맨 앞
+    ThrowIfFailed(m_CommandList->Close());
+
+    m_SubmitLists.clear();
+    m_SubmitLists.push_back(m_CommandList.Get());
+    for (size_t i = 0; i < JobCount; ++i)
+    {
+        m_SubmitLists.push_back(Frame.JobLists[i].Get());
+    }
+
+    auto EndTime = std::chrono::high_resolution_clock::now();
+    m_RecordMilliseconds = std::chrono::duration<double, std::milli>(EndTime - StartTime).count();
+}
@@ -22,6 +22,10 @@ private:
 	virtual void OnMouseDown(WPARAM btnState, int x, int y)override;
 	virtual void OnMouseUp(WPARAM btnState, int x, int y)override;
 	virtual void OnMouseMove(WPARAM btnState, int x, int y)override;
+	virtual void OnKeyUp(WPARAM key)override;
+
+	virtual std::wstring GetFrameStats() const override;
+	std::wstring GetFrameStats(FrameStatsGroup group) const;
 
 #pragma region Rendering Geometry
 
@@ -31,9 +35,11 @@ public:
 	void BuildTextures();
 	void BuildMaterials();
 	void BuildRenderItems();
+	void BuildFrameResources();
 	void BuildConstantBuffer();
 	void BuildDescriptorHeap();
 	void BuildDsvDescriptorHeap();
+	void CreateTextureSRV(TextureInfo* texture);
 	void BuildShader();
 	void BuildRootSignature();
 	void BuildInputLayout();
@@ -47,9 +53,13 @@ private:
 	void CreateSkullGeometry();
 	void CreateQuadPatchGeometry();
 	void CreateTreeGeometry();
+	void FinishTreeGeometry();
 	void CreateQuadGeometry();
 	void CreateSkinnedModel();
 
+	// 정점 / 인덱스를 지오메트리 풀에 추가하고 범위와 뷰를 설정 (복사는 BuildGeometry 끝에서 한 번에 기록)
+	void UploadGeometry(GeometryInfo* geometry, const void* vertices, UINT vertexCount, UINT vertexStride, const std::int32_t* indices, UINT indexCount);
+
 public:
 	void UpdateObjectCB(float deltaTime);
 	void UpdatePassCB(float deltaTime);
@@ -57,85 +67,219 @@ public:
 	void UpdateShadowMapPassCB(float deltaTime);
 	void UpdateSkinnedCB(float deltaTime);
 
+	// 월드 / 텍스처 행렬이나 재질 값을 바꾼 뒤 호출 (모든 프레임 슬롯에 다시 기록됨)
+	void MarkObjectDirty(RenderItem* item);
+	void MarkMaterialDirty(MaterialInfo* material);
+
 	void UpdateCamera(float deltaTime);
 	void UpdateLight(float deltaTime);
+	void UpdateVegetation(float deltaTime);
+	void UpdateTextureStreaming();
+	void UpdateTextureTables();
+
+	// 이번 프레임에 필요한 크기만큼 업로드 힙 슬롯 영역을 확보 (모자라면 GPU 대기 후 다시 생성)
+	void ReserveUploadHeap();
+
+	// 현재 프레임 슬롯 영역에서 256 바이트 정렬로 할당 (여러 스레드에서 호출 가능)
+	UploadAllocation AllocateUpload(UINT64 byteSize);
+
+	void WaitForGpu(UINT64 fenceValue);
 
+	// 카메라 절두체 밖의 아이템 제외
+	void CullRenderItems();
+
+	// 라이트 볼륨과 카메라 영역 사이에 그림자를 드리울 수 없는 캐스터 제외
+	void CullShadowCasters();
+
+	// 카메라 기준 정렬 키로 레이어별 그리기 순서 결정
+	void SortRenderItems();
+
+	// 정렬된 레이어에서 같은 상태가 이어지는 구간을 배치로 묶고 인스턴스 데이터 기록
+	void BuildInstanceBatches();
+
+	void BindTextureTable(ID3D12GraphicsCommandList* cmdList, const MaterialInfo* material, DrawStateTracker& tracker);
 	void RenderGeometry();
 	void RenderGeometry(const std::vector<RenderItem*>& RenderItems);
+	void RenderGeometry(ID3D12GraphicsCommandList* cmdList, RenderItem* const* renderItems, size_t count);
+	void RenderBatches(const std::vector<DrawBatch>& batches);
+	void RenderBatches(ID3D12GraphicsCommandList* cmdList, const DrawBatch* batches, size_t count);
+
+	// 커맨드 리스트마다 다시 설정해야 하는 패스 상태 (루트 시그니처, 힙, 패스 상수, 렌더 타깃)
+	void SetShadowPassState(ID3D12GraphicsCommandList* cmdList);
+	void SetMainPassState(ID3D12GraphicsCommandList* cmdList);
+
+	// 레이어의 PSO (오브젝트 레이어는 퍼뮤테이션 배열에서, 인스턴싱이면 Instanced 비트를 더해 선택)
+	ID3D12PipelineState* GetPipelineState(RenderLayer layer, bool bInstanced);
 
 	void RenderSceneToShadowMap();
+	void RenderParallel();
 
 private:
-	// ϵ 
+	// 기본 힙 리소스를 큰 ID3D12Heap 블록에 배치 (아래 리소스들보다 나중에 해제되도록 먼저 선언)
+	GpuMemoryAllocator m_GpuAllocator;
+
+	// 지오메트리 / 스트리밍 업로드가 함께 쓰는 상주 업로드 링 (펜스 통과 후 공간 재사용)
+	UploadRing m_UploadRing;
+	UINT64 m_UploadRingSize = 16 * 1024 * 1024;
+
+	// 기하도형 맵
 	std::unordered_map<std::wstring, std::unique_ptr<GeometryInfo>> m_Geometries;
 
-	// ؽó 
+	// 모든 메시의 정점 / 인덱스 버퍼 (정점 간격마다 큰 기본 힙 버퍼, 인덱스는 32비트 버퍼 하나)
+	GeometryPool m_GeometryPool;
+
+	// 텍스처 맵
 	std::unordered_map<std::wstring, std::unique_ptr<TextureInfo>> m_Textures;
 
-	//  
+	// 재질 맵
 	std::unordered_map<std::wstring, std::unique_ptr<MaterialInfo>> m_Materials;
 
-	//   Ʈ Ʈ
+	// 렌더링 할 오브젝트 리스트
 	std::vector<std::unique_ptr<RenderItem>> m_RenderItems;
 
-	//   ̾ и
+	// 렌더링 아이템을 레이어로 분리
 	std::vector<RenderItem*> m_RenderItemLayer[(int)RenderLayer::Count];
 
-	// ī̹ڽ ؽó 
+	// 정렬 키 순서로 다시 나열한 레이어 (매 프레임 SortRenderItems 에서 갱신)
+	std::vector<RenderItem*> m_SortedRenderItemLayer[(int)RenderLayer::Count];
+	std::vector<DrawSortEntry> m_DrawSortEntries;
+	std::vector<DrawSortEntry> m_DrawSortScratch;
+	std::vector<RenderItem*> m_DrawSortItems;
+	bool m_bSortDraws = true;
+
+	// 쉐도우 패스에서 그릴 캐스터 (캐스터 레이어별, 정렬 순서)
+	std::vector<RenderItem*> m_ShadowCasterLayer[(int)RenderLayer::Count];
+	bool m_bShadowCasterCulling = true;
+	UINT m_ShadowCastersDrawn = 0;
+	UINT m_ShadowCastersCulled = 0;
+
+	// 인스턴싱 배치 (Opaque / AlphaTested 레이어, 메인 패스와 쉐도우 패스 각각)
+	std::vector<DrawBatch> m_InstanceBatchLayer[(int)RenderLayer::Count];
+	std::vector<DrawBatch> m_ShadowBatchLayer[(int)RenderLayer::Count];
+	std::vector<InstanceRun> m_InstanceRuns;
+	bool m_bInstancing = true;
+	UINT m_InstancedItems = 0;
+	UINT m_InstancedDraws = 0;
+
+	// 로컬 AABB + 월드 행렬을 SoA 로 보관해 8개씩 AVX 로 검사
+	FrustumCuller m_FrustumCuller;
+	std::vector<uint32_t> m_VisibleItems;
+
+	// 컬링 번호 -> 아이템 (bCullable 인 아이템만, 번호는 CullIndex)
+	std::vector<RenderItem*> m_CullItems;
+	bool m_bFrustumCulling = true;
+
+	// 월드 AABB 계층 구조, 아이템 i 의 프록시 번호는 CullIndex
+	DynamicBVH m_SceneBVH;
+	bool m_bUseSceneBVH = true;
+	double m_ItemCullMilliseconds = 0.0;
+
+	// 스카이박스 텍스처 정보
 	std::unique_ptr<TextureInfo> m_SkyboxTexture;
 
-	// Ʈ  
-	ComPtr<ID3D12Resource>	m_ObjectCB = nullptr;
-	BYTE* m_ObjectMappedData = nullptr;
-	UINT m_ObjectByteSize = 0;
-
-	//   
-	ComPtr<ID3D12Resource>	m_PassCB = nullptr;
-	BYTE* m_PassMappedData = nullptr;
-	UINT m_PassByteSize = 0;
-
-	//   
-	ComPtr<ID3D12Resource>	m_MaterialCB = nullptr;
-	BYTE* m_MaterialMappedData = nullptr;
-	UINT m_MaterialByteSize = 0;
-
-	// Ų Ʈ  
-	ComPtr<ID3D12Resource>	m_SkinnedCB = nullptr;
-	BYTE* m_SkinnedMappedData = nullptr;
-	UINT m_SkinnedByteSize = 0;
-
-	// ؽó  
-	ComPtr<ID3D12DescriptorHeap> m_TextureDescriptorHeap = nullptr;
-
-	// Ʈ ñ״ó
+	// 프레임 업로드 힙 (상수 버퍼 / 인스턴스 버퍼가 모두 여기서 프레임 슬롯마다 선형 할당됨)
+	ComPtr<ID3D12Resource>	m_UploadHeap = nullptr;
+	BYTE* m_UploadMappedData = nullptr;
+	FrameUploadAllocator m_UploadAllocator;
+
+	// 이번 프레임에 할당된 상수 버퍼 / 인스턴스 버퍼 주소
+	D3D12_GPU_VIRTUAL_ADDRESS m_ObjectCBAddress = 0;
+	D3D12_GPU_VIRTUAL_ADDRESS m_MaterialCBAddress = 0;
+	D3D12_GPU_VIRTUAL_ADDRESS m_PassCBAddress = 0;
+	D3D12_GPU_VIRTUAL_ADDRESS m_ShadowPassCBAddress = 0;
+	D3D12_GPU_VIRTUAL_ADDRESS m_SkinnedCBAddress = 0;
+	D3D12_GPU_VIRTUAL_ADDRESS m_InstanceAddress = 0;
+	D3D12_GPU_VIRTUAL_ADDRESS m_InstanceIndexAddress = 0;
+
+	// 슬롯마다 아직 기록하지 않은 오브젝트 (+ 인스턴스 레코드) / 재질 (인덱스는 ObjectCBIndex / MatCBIndex)
+	DirtyTracker m_ObjectDirty{ FRAME_RESOURCE_COUNT };
+	DirtyTracker m_MaterialDirty{ FRAME_RESOURCE_COUNT };
+	std::vector<MaterialInfo*> m_MaterialsByCBIndex;
+
+	// 이번 프레임 상수 버퍼에 기록한 오브젝트 / 재질 수와 바이트 수
+	UINT m_ObjectsWritten = 0;
+	UINT m_MaterialsWritten = 0;
+	UINT m_CBBytesWritten = 0;
+
+	// 텍스처 서술자 힙 (영구 슬롯은 해제 목록으로 재사용, 테이블은 프레임마다 임시 영역에 복사)
+	ShaderDescriptorHeap m_SrvHeap;
+	UINT m_SrvPersistentCount = 1024;
+	UINT m_SrvTransientCount = 1024;
+
+	// 재질 상수의 서술자 인덱스로 셰이더가 무제한 SRV 배열에서 텍스처를 고름
+	// (리소스 바인딩 티어 2 미만이면 Initialize 에서 끄고 드로우마다 테이블을 묶음)
+	bool m_bBindless = true;
+
+	// 루트 시그니처
 	ComPtr<ID3D12RootSignature> m_RootSignature = nullptr;
 
-	// Է ġ
+	// 입력 배치
 	std::vector<D3D12_INPUT_ELEMENT_DESC> m_InputLayout;
 
-	// ٴ Է ġ
+	// 바닥 입력 배치
 	std::vector<D3D12_INPUT_ELEMENT_DESC> m_QuadPatchInputLayout;
 
-	//  Է ġ
+	// 나무 입력 배치
 	std::vector<D3D12_INPUT_ELEMENT_DESC> m_TreeInputLayout;
 
-	// Ų Ʈ Է ġ
+	// 스킨드 오브젝트 입력 배치
 	std::vector<D3D12_INPUT_ELEMENT_DESC> m_SkinnedInputLayout;
 
-	// ̴ 
+	// 셰이더 맵 (오브젝트 셰이더 외의 전용 셰이더)
 	std::unordered_map<std::wstring, ComPtr<ID3DBlob>> m_Shaders;
 
-	//   
-	std::unordered_map<RenderLayer, ComPtr<ID3D12PipelineState>> m_PipelineStates;
+	// 오브젝트 셰이더 퍼뮤테이션 (단계가 읽는 기능 비트만 남긴 키의 슬롯만 채움)
+	ShaderPermutationArray<ComPtr<ID3DBlob>> m_ObjectVS;
+	ShaderPermutationArray<ComPtr<ID3DBlob>> m_ObjectPS;
+
+	// 셰이더 바이트코드 디스크 캐시 (빈 문자열이면 매번 컴파일)
+	ShaderCompiler m_ShaderCompiler;
+	std::string m_ShaderCacheDirectory = "../Shader/Cache";
+
+	// TextureTool permutations --fxc 로 미리 컴파일한 오브젝트 셰이더 (바인드리스는 Bindless 하위 폴더, 없거나 소스보다 오래되면 컴파일)
+	std::wstring m_PrecompiledShaderDirectory = L"../Shader/Compiled";
+
+	// 셰이더 컴파일 -> PSO 생성 작업 그래프 (BuildShader 에서 채우고 BuildPipelineState 에서 실행)
+	TaskGraph m_BuildGraph;
+	std::unordered_map<const ComPtr<ID3DBlob>*, TaskGraph::TaskId> m_ShaderTasks;
+	bool m_bParallelPipelineBuild = true;
 
-//   
+	// 직렬화된 PSO 라이브러리 (빈 문자열이면 사용하지 않음)
+	PipelineLibrary m_PipelineLibrary;
+	std::string m_PipelineLibraryFileName = "../Shader/Cache/Pipelines.bin";
+
+	// 오브젝트 렌더링 파이프라인 (유효한 퍼뮤테이션마다 하나)
+	ShaderPermutationArray<ComPtr<ID3D12PipelineState>> m_ObjectPipelines;
+
+	// 전용 셰이더를 쓰는 레이어의 렌더링 파이프라인 (Skybox, QuadPatch, Tree, Transparent, ShadowMapDebug)
+	ComPtr<ID3D12PipelineState> m_PipelineStates[(int)RenderLayer::Count];
+
+// 프레임 리소스 링
 private:
-	// ShadowMap ҽ & 
+	// 슬롯을 다시 쓸 때만 GPU 를 기다림 (매 프레임 FlushCommandQueue 하지 않음)
+	FrameResourceRing m_FrameRing{ FRAME_RESOURCE_COUNT };
+	FrameResource m_FrameResources[FRAME_RESOURCE_COUNT];
+
+// 병렬 커맨드 리스트 기록
+private:
+	// 쉐도우 패스와 각 레이어를 청크 단위 작업으로 나눠 워커 스레드에서 기록
+	bool m_bParallelRecording = true;
+	UINT m_RecordChunkSize = 32;
+
+	CommandListRecorder<ID3D12GraphicsCommandList> m_Recorder;
+
+	// 이번 프레임에 한 번에 제출할 리스트 (기록 순서)
+	std::vector<ID3D12CommandList*> m_SubmitLists;
+	double m_RecordMilliseconds = 0.0;
+
+// 쉐도우 맵 정보
+private:
+	// ShadowMap 리소스 & 정보
 	ComPtr<ID3D12Resource>			m_ShadowMapResource = nullptr;
 	CD3DX12_CPU_DESCRIPTOR_HANDLE	m_hShadowMapDsv;
 	CD3DX12_CPU_DESCRIPTOR_HANDLE	m_hShadowMapSrv;
 
-	// ShadowMap ؽó ε
+	// ShadowMap 텍스처 인덱스
 	UINT							m_ShadowMapHeapIndex = 0;
 
 	D3D12_VIEWPORT	m_ShadowMapViewport;
@@ -144,9 +288,50 @@ private:
 	UINT			m_ShadowMapWidth = 2048;
 	UINT			m_ShadowMapHeight = 2048;
 
-// Skinned Model  
+// 텍스처 로딩
+private:
+	// 텍스처 로딩 등 초기화 작업용 워커 스레드
+	std::unique_ptr<ThreadPool> m_ThreadPool;
+
+	// 모델 파일을 초기화 시작 시점에 한꺼번에 요청해 두는 비동기 I/O 큐
+	std::unique_ptr<AsyncFileQueue> m_FileQueue;
+	std::future<FileReadResult> m_SkullFile;
+	std::future<FileReadResult> m_SkinnedModelFile;
+
+	// 병렬 파일 읽기 + 단일 스테이징 버퍼 업로드
+	TextureBatchLoader m_TextureLoader;
+
+	// 화면 크기 기반 밉 스트리밍 (작은 밉은 상주, 상위 밉은 예산 내에서 로드)
+	TextureStreamer m_TextureStreamer;
+	UINT64 m_TextureStreamingBudget = 4 * 1024 * 1024;
+
+	// 스트리밍 인덱스 -> 텍스처
+	std::vector<TextureInfo*> m_StreamedTextures;
+
+	// TextureTool pack 결과 (없으면 원본 텍스처를 개별로 사용)
+	TexturePackManifest m_TexturePacks;
+
+	// 프레임당 상태별 바인딩 호출 / 같은 값이라 생략한 횟수 (병렬 기록 시 여러 스레드에서 증가)
+	std::atomic<UINT> m_StateCalls[(int)DrawState::Count] = {};
+	std::atomic<UINT> m_StateSkips[(int)DrawState::Count] = {};
+
+// 식생 정보
 private:
-	// Skinned Model Load 
+	// Poisson-disk 분포 + 균일 격자 컬링 (분포는 초기화 중 워커 스레드에서 생성)
+	VegetationScatter m_Vegetation;
+	std::future<void> m_VegetationBuild;
+
+	// 매 프레임 보이는 인스턴스만 기록하는 정점 버퍼 (Upload Heap)
+	ComPtr<ID3D12Resource> m_VegetationInstanceBuffer = nullptr;
+	VegetationInstance* m_VegetationMappedData = nullptr;
+	UINT m_VegetationCapacity = 0;
+
+	// m_Geometries 의 "Tree" 항목 (매 프레임 맵 검색을 피하려고 보관)
+	GeometryInfo* m_VegetationGeometry = nullptr;
+
+// Skinned Model 정보 
+private:
+	// Skinned Model Load 정보
 	std::string m_SkinnedModelFileName = "../3DModels/soldier.m3d";
 	std::vector<M3DLoader::Subset> m_SkinnedSubsets;
 	std::vector<M3DLoader::M3dMaterial> m_SkinnedMaterials;
@@ -155,32 +340,37 @@ private:
 	std::unique_ptr<SkinnedModelAnimation> m_SkinnedModelAnimation;
 
 private:
-	// ī޶ Ŭ
+	// 카메라 클래스
 	Camera m_Camera;
 
-	// Ʈ 
+	// 창 제목에 보여줄 통계 묶음
+	FrameStatsGroup m_StatsGroup = FrameStatsGroup::Culling;
+
+	// 라이트 정보
 	XMFLOAT3 m_BaseLightDirection = XMFLOAT3(0.57735f, -0.57735f, 0.57735f);
 	XMFLOAT3 m_RotatedLightDirection;
 	float m_LightRotationAngle = 0.0f;
 	float m_LightRotationSpeed = 0.1f;
 
-	// Ʈ 
+	// 라이트 행렬
 	float m_LightNearZ = 0.0f;
 	float m_LightFarZ = 0.0f;
+	XMFLOAT3 m_LightVolumeMin;	// 라이트 공간 직교 볼륨
+	XMFLOAT3 m_LightVolumeMax;
 	XMFLOAT3 m_LightPosW;
 	XMFLOAT4X4 m_LightView = MathHelper::Identity4x4();
 	XMFLOAT4X4 m_LightProj = MathHelper::Identity4x4();
 	XMFLOAT4X4 m_ShadowTransform = MathHelper::Identity4x4();
 
-	//  
+	// 경계 구
 	BoundingSphere m_SceneBounds;
 
-	//  ǥ  
+	// 구면 좌표 제어 값
 	float m_Theta = 1.5f * XM_PI;
 	float m_Phi = XM_PIDIV4;
 	float m_Radius = 5.0f;
 
-	// 콺 ǥ
+	// 마우스 좌표
 	POINT m_LastMousePos = { 0, 0 };
 #pragma endregion
 
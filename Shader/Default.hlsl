@@ -26,10 +26,19 @@ struct VertexOut
     float3 TangentW : TANGENT;
 };
 
-VertexOut VS(VertexIn vin)
+VertexOut VS(VertexIn vin, uint instanceID : SV_InstanceID)
 {
     VertexOut vout;
     
+#ifdef INSTANCED
+    InstanceData instance = gInstanceData[gInstanceIndex[instanceID]];
+    float4x4 world = instance.World;
+    float4x4 textureTransform = instance.TextureTransform;
+#else
+    float4x4 world = gWorld;
+    float4x4 textureTransform = gTextureTransform;
+#endif
+    
 #ifdef SKINNED
     float weights[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
     weights[0] = vin.BoneWeights.x;
@@ -53,15 +62,15 @@ VertexOut VS(VertexIn vin)
     vin.TangentU = tangentL;
 #endif
     
-        float4 posW = mul(float4(vin.PosL, 1.0f), gWorld);
+    float4 posW = mul(float4(vin.PosL, 1.0f), world);
     vout.PosH = mul(posW, gViewProj);
     vout.PosW = posW.xyz;
-    vout.NormalW = mul(vin.NormalL, (float3x3) gWorld);
+    vout.NormalW = mul(vin.NormalL, (float3x3) world);
     
-    float4 Uv = mul(float4(vin.Uv, 0.0f, 1.0f), gTextureTransform);
+    float4 Uv = mul(float4(vin.Uv, 0.0f, 1.0f), textureTransform);
     vout.Uv = Uv.xy;
     
-    vout.TangentW = mul(vin.TangentU, (float3x3) gWorld);
+    vout.TangentW = mul(vin.TangentU, (float3x3) world);
     
     vout.ShadowPosH = mul(posW, gShadowTransform);
     return vout;
@@ -73,7 +82,7 @@ float4 PS(VertexOut pin) : SV_Target
     
     if(gTexture_On)
     {
-        diffuseAlbedo = gTexture_Diffuse.Sample(gSampler, pin.Uv) * gAlbedo;
+        diffuseAlbedo = SamplePackedTexture(gTexture_Diffuse, pin.Uv) * gAlbedo;
     }
     
 #ifdef ALPHA_TESTED
@@ -86,7 +95,7 @@ float4 PS(VertexOut pin) : SV_Target
     float3 bumpedNormalW = pin.NormalW;
     if(gNormal_On)
     {
-        normalMapSample = gTexture_Normal.Sample(gSampler, pin.Uv);
+        normalMapSample = SamplePackedTexture(gTexture_Normal, pin.Uv);
         bumpedNormalW = NormalSampleToWorldSpace(normalMapSample.rgb, pin.NormalW, pin.TangentW);
     }    
     
@@ -53,7 +53,11 @@ cbuffer cbMaterial : register(b2)
     float gRoughness;
     int gTexture_On;
     int gNormal_On;
-    float2 gTexPadding;
+    uint gTextureSlice;
+    uint gDiffuseIndex;
+    float4 gTexScaleBias;
+    uint gNormalIndex;
+    float3 gIndexPadding;
 }
 
 cbuffer cbSkinned : register(b3)
@@ -61,20 +65,53 @@ cbuffer cbSkinned : register(b3)
     float4x4 gBoneTransform[96];
 }
 
-Texture2D gTexture_Diffuse : register(t0);
-Texture2D gTexture_Normal : register(t1);
+// 인스턴싱 배치가 그릴 레코드 번호 (SRV 시작 위치를 배치의 첫 인스턴스로 옮겨서 바인딩)
+StructuredBuffer<uint> gInstanceIndex : register(t0, space1);
+
+// 아이템별 인스턴스 레코드 (메인 패스와 쉐도우 패스가 함께 읽음)
+struct InstanceData
+{
+    float4x4 World;
+    float4x4 TextureTransform;
+};
+
+StructuredBuffer<InstanceData> gInstanceData : register(t1, space1);
+
+// 텍스처 팩(배열/아틀라스) 을 쓰므로 일반 텍스처도 슬라이스 1개짜리 배열로 바인딩
+#ifdef BINDLESS
+// 바인드리스 : 서술자 힙 전체를 배열로 묶고 재질 상수의 서술자 인덱스로 선택
+Texture2DArray gTextures[] : register(t0, space2);
+#define gTexture_Diffuse gTextures[gDiffuseIndex]
+#define gTexture_Normal gTextures[gNormalIndex]
+#else
+Texture2DArray gTexture_Diffuse : register(t0);
+Texture2DArray gTexture_Normal : register(t1);
+#endif
 TextureCube gCube_Skybox : register(t2);
 Texture2D gTexture_ShadowMap : register(t3);
 
 SamplerState gSampler : register(s0);
 SamplerComparisonState gSampler_ShadowMap : register(s1);
 
-// 븻  ->  ̽
+// 팩 텍스처 샘플링
+// 아틀라스는 반복 UV 를 서브 이미지 영역으로 옮기고, 미분값은 원래 UV 에서 구해 경계에서 밉이 튀지 않게 함
+float4 SamplePackedTexture(Texture2DArray tex, float2 uv)
+{
+    float2 packedUv = frac(uv) * gTexScaleBias.xy + gTexScaleBias.zw;
+    float2 dx = ddx(uv) * gTexScaleBias.xy;
+    float2 dy = ddy(uv) * gTexScaleBias.xy;
+    return tex.SampleGrad(gSampler, float3(packedUv, gTextureSlice), dx, dy);
+}
+
+// 노말맵 샘플 -> 월드 스페이스
 float3 NormalSampleToWorldSpace(float3 normalMapSample, float3 unitNormalW, float3 tangentW)
 {
     // [0, 1] -> [-1, 1]
-    float3 normalT = 2.0f * normalMapSample - 1.0f;
-    
+    // BC5 노말맵은 XY만 저장하므로 Z는 단위 길이로 복원
+    float3 normalT;
+    normalT.xy = 2.0f * normalMapSample.xy - 1.0f;
+    normalT.z = sqrt(saturate(1.0f - dot(normalT.xy, normalT.xy)));
+
     // TBN Matrix
     float3 N = unitNormalW;
     float3 T = normalize(tangentW - dot(tangentW, N) * N);
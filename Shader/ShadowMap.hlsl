@@ -6,24 +6,65 @@
 struct VertexIn
 {
     float3 PosL : POSITION;
+    float2 Uv : TEXCOORD;
+#ifdef SKINNED
+    float3 BoneWeights : WEIGHTS;
+    uint4 BoneIndices : BONEINDICES;
+#endif
 };
 
 struct VertexOut
 {
     float4 PosH : SV_Position;
+    float2 Uv : TEXCOORD;
 };
 
-VertexOut VS(VertexIn vin)
+VertexOut VS(VertexIn vin, uint instanceID : SV_InstanceID)
 {
     VertexOut vout;
     
-    float4 posW = mul(float4(vin.PosL, 1.0f), gWorld);
+#ifdef INSTANCED
+    InstanceData instance = gInstanceData[gInstanceIndex[instanceID]];
+    float4x4 world = instance.World;
+    float4x4 textureTransform = instance.TextureTransform;
+#else
+    float4x4 world = gWorld;
+    float4x4 textureTransform = gTextureTransform;
+#endif
+    
+#ifdef SKINNED
+    float weights[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    weights[0] = vin.BoneWeights.x;
+    weights[1] = vin.BoneWeights.y;
+    weights[2] = vin.BoneWeights.z;
+    weights[3] = 1.0f - weights[0] - weights[1] - weights[2];
+    
+    float3 posL = float3(0.0f, 0.0f, 0.0f);
+    for (int i = 0; i < 4; ++i)
+    {
+        posL += weights[i] * mul(float4(vin.PosL, 1.0f), gBoneTransform[vin.BoneIndices[i]]).xyz;
+    }
+    vin.PosL = posL;
+#endif
+    
+    float4 posW = mul(float4(vin.PosL, 1.0f), world);
     vout.PosH = mul(posW, gViewProj);
     
+    float4 Uv = mul(float4(vin.Uv, 0.0f, 1.0f), textureTransform);
+    vout.Uv = Uv.xy;
+    
     return vout;
 }
 
 void PS(VertexOut pin)
 {
+#ifdef ALPHA_TESTED
+    float4 diffuseAlbedo = gAlbedo;
+    if(gTexture_On)
+    {
+        diffuseAlbedo = SamplePackedTexture(gTexture_Diffuse, pin.Uv) * gAlbedo;
+    }
+    clip(diffuseAlbedo.a - 0.1f);
+#endif
 }
-#endif
\ No newline at end of file
+#endif
@@ -26,7 +26,7 @@ VertexOut VS(VertexIn vin)
     float4 posW = mul(float4(vin.PosL, 1.0f), gWorld);
     posW.xyz += gEyePosW;
     
-    // z  ׻ 1 
+    // z 값이 항상 1로 유지
     vout.PosH = mul(posW, gViewProj).xyww;
     
     return vout;
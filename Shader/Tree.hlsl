@@ -4,7 +4,11 @@
 #include "Params.hlsli"
 #include "LightingUtil.hlsl"
 
+#ifdef BINDLESS
+#define gTexture_Tree gTextures[gDiffuseIndex]
+#else
 Texture2DArray gTexture_Tree : register(t0);
+#endif
 
 struct VertexIn
 {
@@ -36,14 +40,18 @@ struct GeoOut
     float3 PosW : POSITION;
     float3 NormalW : NORMAL;
     float2 Uv : TEXCOORD;
-    uint PrimID : SV_PrimitiveID;
+    nointerpolation uint Slice : SLICE;
 };
 
 [maxvertexcount(4)]
 void GS( point VertexOut gin[1],
-         uint primID : SV_PrimitiveID,
          inout TriangleStream<GeoOut> triStream)
 {
+    // Visible instances are compacted every frame, so SV_PrimitiveID is not
+    // stable.  Pick the texture slice from a hash of the world position instead.
+    uint hash = (asuint(gin[0].CenterW.x) * 73856093u) ^ (asuint(gin[0].CenterW.z) * 19349663u);
+    uint slice = hash % 3u;
+
     float3 up = float3(0.0f, 1.0f, 0.0f);
     float3 look = gEyePosW - gin[0].CenterW;
     look.y = 0.0f;
@@ -73,7 +81,7 @@ void GS( point VertexOut gin[1],
         gout.PosW = v[i].xyz;
         gout.NormalW = look;
         gout.Uv = texC[i];
-        gout.PrimID = primID;
+        gout.Slice = slice;
         
         triStream.Append(gout);
     }
@@ -83,7 +91,7 @@ float4 PS(GeoOut pin) : SV_Target
 {
     float4 diffuseAlbedo = gAlbedo;
     
-    float3 uvw = float3(pin.Uv, pin.PrimID % 3);
+    float3 uvw = float3(pin.Uv, pin.Slice);
     diffuseAlbedo = gTexture_Tree.Sample(gSampler, uvw) * gAlbedo;
     
 #ifdef ALPHA_TESTED
@@ -0,0 +1,989 @@
+#include "BlockCompress.h"
+#include "../Common/ThreadPool.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BC_USE_SSE2 1
+#include <emmintrin.h>
+#else
+#define BC_USE_SSE2 0
+#endif
+
+using BC::Block;
+
+namespace
+{
+    // BC7 4-bit index interpolation weights (out of 64).
+    const uint32_t BC7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    uint8_t ClampByte(float value)
+    {
+        return (uint8_t)(std::min)((std::max)(value + 0.5f, 0.0f), 255.0f);
+    }
+
+    uint16_t PackRGB565(const float rgb[3])
+    {
+        uint32_t R = (ClampByte(rgb[0]) * 31 + 127) / 255;
+        uint32_t G = (ClampByte(rgb[1]) * 63 + 127) / 255;
+        uint32_t B = (ClampByte(rgb[2]) * 31 + 127) / 255;
+        return (uint16_t)((R << 11) | (G << 5) | B);
+    }
+
+    void UnpackRGB565(uint16_t color, uint8_t rgb[3])
+    {
+        uint32_t R = (color >> 11) & 31;
+        uint32_t G = (color >> 5) & 63;
+        uint32_t B = color & 31;
+        rgb[0] = (uint8_t)((R << 3) | (R >> 2));
+        rgb[1] = (uint8_t)((G << 2) | (G >> 4));
+        rgb[2] = (uint8_t)((B << 3) | (B >> 2));
+    }
+
+    // Mean and dominant direction of a point cloud (power iteration on the covariance).
+    template<int N>
+    void PrincipalAxis(const float (*points)[N], int count, float mean[N], float axis[N])
+    {
+        for (int c = 0; c < N; ++c)
+        {
+            mean[c] = 0.0f;
+            for (int i = 0; i < count; ++i)
+            {
+                mean[c] += points[i][c];
+            }
+            mean[c] /= (float)count;
+        }
+
+        float Covariance[N][N] = {};
+        for (int i = 0; i < count; ++i)
+        {
+            for (int a = 0; a < N; ++a)
+            {
+                for (int b = 0; b < N; ++b)
+                {
+                    Covariance[a][b] += (points[i][a] - mean[a]) * (points[i][b] - mean[b]);
+                }
+            }
+        }
+
+        for (int c = 0; c < N; ++c)
+        {
+            axis[c] = 1.0f;
+        }
+
+        for (int Iteration = 0; Iteration < 8; ++Iteration)
+        {
+            float Next[N] = {};
+            float Length = 0.0f;
+            for (int a = 0; a < N; ++a)
+            {
+                for (int b = 0; b < N; ++b)
+                {
+                    Next[a] += Covariance[a][b] * axis[b];
+                }
+                Length = (std::max)(Length, std::fabs(Next[a]));
+            }
+
+            // Flat block: any axis works, the endpoints collapse onto the mean.
+            if (Length < 1e-8f)
+                return;
+
+            for (int c = 0; c < N; ++c)
+            {
+                axis[c] = Next[c] / Length;
+            }
+        }
+    }
+
+    // Endpoints at the extremes of the points projected on the axis.
+    template<int N>
+    void FitEndpoints(const float (*points)[N], int count, float e0[N], float e1[N])
+    {
+        float Mean[N];
+        float Axis[N];
+        PrincipalAxis<N>(points, count, Mean, Axis);
+
+        float MinT = FLT_MAX;
+        float MaxT = -FLT_MAX;
+        for (int i = 0; i < count; ++i)
+        {
+            float T = 0.0f;
+            for (int c = 0; c < N; ++c)
+            {
+                T += (points[i][c] - Mean[c]) * Axis[c];
+            }
+            MinT = (std::min)(MinT, T);
+            MaxT = (std::max)(MaxT, T);
+        }
+
+        for (int c = 0; c < N; ++c)
+        {
+            e0[c] = Mean[c] + Axis[c] * MaxT;
+            e1[c] = Mean[c] + Axis[c] * MinT;
+        }
+    }
+
+    // Closest of four RGB palette entries for every texel.  Returns the summed squared error.
+    uint32_t FindColorIndices(const Block& block, const uint8_t palette[4][4], uint8_t indices[16])
+    {
+        uint32_t TotalError = 0;
+
+#if BC_USE_SSE2
+        const __m128i Zero = _mm_setzero_si128();
+        const __m128i RGBMask = _mm_set1_epi32(0x00FFFFFF);
+
+        __m128i Entries[4];
+        for (int k = 0; k < 4; ++k)
+        {
+            Entries[k] = _mm_set_epi16(0, palette[k][2], palette[k][1], palette[k][0], 0, palette[k][2], palette[k][1], palette[k][0]);
+        }
+
+        // Four texels per iteration: widen to 16 bits, square the differences with madd
+        // and fold the RG and B partial sums together.
+        for (int Group = 0; Group < 4; ++Group)
+        {
+            __m128i Texels = _mm_and_si128(_mm_loadu_si128((const __m128i*)block.Texels[Group * 4]), RGBMask);
+            __m128i Lo = _mm_unpacklo_epi8(Texels, Zero);
+            __m128i Hi = _mm_unpackhi_epi8(Texels, Zero);
+
+            __m128i BestError = _mm_set1_epi32(INT_MAX);
+            __m128i BestIndex = Zero;
+
+            for (int k = 0; k < 4; ++k)
+            {
+                __m128i DiffLo = _mm_sub_epi16(Lo, Entries[k]);
+                __m128i DiffHi = _mm_sub_epi16(Hi, Entries[k]);
+                __m128i SumLo = _mm_madd_epi16(DiffLo, DiffLo);
+                __m128i SumHi = _mm_madd_epi16(DiffHi, DiffHi);
+                SumLo = _mm_add_epi32(SumLo, _mm_shuffle_epi32(SumLo, _MM_SHUFFLE(2, 3, 0, 1)));
+                SumHi = _mm_add_epi32(SumHi, _mm_shuffle_epi32(SumHi, _MM_SHUFFLE(2, 3, 0, 1)));
+
+                __m128i Error = _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(SumLo), _mm_castsi128_ps(SumHi), _MM_SHUFFLE(2, 0, 2, 0)));
+
+                __m128i Better = _mm_cmplt_epi32(Error, BestError);
+                BestError = _mm_or_si128(_mm_and_si128(Better, Error), _mm_andnot_si128(Better, BestError));
+                BestIndex = _mm_or_si128(_mm_and_si128(Better, _mm_set1_epi32(k)), _mm_andnot_si128(Better, BestIndex));
+            }
+
+            alignas(16) int32_t Errors[4];
+            alignas(16) int32_t Indices[4];
+            _mm_store_si128((__m128i*)Errors, BestError);
+            _mm_store_si128((__m128i*)Indices, BestIndex);
+
+            for (int j = 0; j < 4; ++j)
+            {
+                indices[Group * 4 + j] = (uint8_t)Indices[j];
+                TotalError += (uint32_t)Errors[j];
+            }
+        }
+#else
+        for (int i = 0; i < 16; ++i)
+        {
+            uint32_t BestError = UINT_MAX;
+            for (int k = 0; k < 4; ++k)
+            {
+                int Dr = (int)block.Texels[i][0] - palette[k][0];
+                int Dg = (int)block.Texels[i][1] - palette[k][1];
+                int Db = (int)block.Texels[i][2] - palette[k][2];
+                uint32_t Error = (uint32_t)(Dr * Dr + Dg * Dg + Db * Db);
+                if (Error < BestError)
+                {
+                    BestError = Error;
+                    indices[i] = (uint8_t)k;
+                }
+            }
+            TotalError += BestError;
+        }
+#endif
+
+        return TotalError;
+    }
+
+    // Closest of eight palette values for 16 scalars.  Returns the summed squared error.
+    uint32_t FindAlphaIndices(const uint8_t values[16], const uint8_t palette[8], uint8_t indices[16])
+    {
+#if BC_USE_SSE2
+        const __m128i Zero = _mm_setzero_si128();
+        __m128i Packed = _mm_loadu_si128((const __m128i*)values);
+        __m128i Lo = _mm_unpacklo_epi8(Packed, Zero);
+        __m128i Hi = _mm_unpackhi_epi8(Packed, Zero);
+
+        __m128i BestLo = _mm_set1_epi16(SHRT_MAX);
+        __m128i BestHi = _mm_set1_epi16(SHRT_MAX);
+        __m128i IndexLo = Zero;
+        __m128i IndexHi = Zero;
+
+        for (int k = 0; k < 8; ++k)
+        {
+            __m128i Entry = _mm_set1_epi16(palette[k]);
+            __m128i Index = _mm_set1_epi16((short)k);
+
+            __m128i DiffLo = _mm_sub_epi16(Lo, Entry);
+            __m128i DiffHi = _mm_sub_epi16(Hi, Entry);
+            DiffLo = _mm_max_epi16(DiffLo, _mm_sub_epi16(Zero, DiffLo));
+            DiffHi = _mm_max_epi16(DiffHi, _mm_sub_epi16(Zero, DiffHi));
+
+            __m128i BetterLo = _mm_cmplt_epi16(DiffLo, BestLo);
+            __m128i BetterHi = _mm_cmplt_epi16(DiffHi, BestHi);
+            BestLo = _mm_min_epi16(BestLo, DiffLo);
+            BestHi = _mm_min_epi16(BestHi, DiffHi);
+            IndexLo = _mm_or_si128(_mm_and_si128(BetterLo, Index), _mm_andnot_si128(BetterLo, IndexLo));
+            IndexHi = _mm_or_si128(_mm_and_si128(BetterHi, Index), _mm_andnot_si128(BetterHi, IndexHi));
+        }
+
+        alignas(16) int16_t Errors[16];
+        alignas(16) int16_t Indices[16];
+        _mm_store_si128((__m128i*)Errors, BestLo);
+        _mm_store_si128((__m128i*)(Errors + 8), BestHi);
+        _mm_store_si128((__m128i*)Indices, IndexLo);
+        _mm_store_si128((__m128i*)(Indices + 8), IndexHi);
+
+        uint32_t TotalError = 0;
+        for (int i = 0; i < 16; ++i)
+        {
+            indices[i] = (uint8_t)Indices[i];
+            TotalError += (uint32_t)(Errors[i] * Errors[i]);
+        }
+        return TotalError;
+#else
+        uint32_t TotalError = 0;
+        for (int i = 0; i < 16; ++i)
+        {
+            int BestError = INT_MAX;
+            for (int k = 0; k < 8; ++k)
+            {
+                int Error = std::abs((int)values[i] - (int)palette[k]);
+                if (Error < BestError)
+                {
+                    BestError = Error;
+                    indices[i] = (uint8_t)k;
+                }
+            }
+            TotalError += (uint32_t)(BestError * BestError);
+        }
+        return TotalError;
+#endif
+    }
+
+    void BuildColorPalette(uint16_t a, uint16_t b, bool threeColor, uint8_t palette[4][4])
+    {
+        UnpackRGB565(a, palette[0]);
+        UnpackRGB565(b, palette[1]);
+
+        for (int c = 0; c < 3; ++c)
+        {
+            if (threeColor)
+            {
+                palette[2][c] = (uint8_t)((palette[0][c] + palette[1][c] + 1) / 2);
+                palette[3][c] = 0;
+            }
+            else
+            {
+                palette[2][c] = (uint8_t)((2 * palette[0][c] + palette[1][c] + 1) / 3);
+                palette[3][c] = (uint8_t)((palette[0][c] + 2 * palette[1][c] + 1) / 3);
+            }
+        }
+
+        for (int k = 0; k < 4; ++k)
+        {
+            palette[k][3] = 255;
+        }
+
+        if (threeColor)
+            palette[3][3] = 0;
+    }
+
+    void BuildAlphaPalette(uint8_t a0, uint8_t a1, uint8_t palette[8])
+    {
+        palette[0] = a0;
+        palette[1] = a1;
+
+        if (a0 > a1)
+        {
+            for (int i = 2; i < 8; ++i)
+            {
+                palette[i] = (uint8_t)(((8 - i) * a0 + (i - 1) * a1 + 3) / 7);
+            }
+        }
+        else
+        {
+            for (int i = 2; i < 6; ++i)
+            {
+                palette[i] = (uint8_t)(((6 - i) * a0 + (i - 1) * a1 + 2) / 5);
+            }
+            palette[6] = 0;
+            palette[7] = 255;
+        }
+    }
+
+    // Error of the block against endpoints a, b in four-colour order (palette a, b, 2/3, 1/3).
+    uint32_t EvaluateColor(const Block& block, uint16_t a, uint16_t b, uint8_t indices[16])
+    {
+        uint8_t Palette[4][4];
+        BuildColorPalette(a, b, false, Palette);
+        return FindColorIndices(block, Palette, indices);
+    }
+
+    void WriteColorBlock(uint8_t* out, uint16_t c0, uint16_t c1, const uint8_t indices[16])
+    {
+        uint32_t Bits = 0;
+        for (int i = 0; i < 16; ++i)
+        {
+            Bits |= (uint32_t)(indices[i] & 3) << (i * 2);
+        }
+
+        out[0] = (uint8_t)(c0 & 0xFF);
+        out[1] = (uint8_t)(c0 >> 8);
+        out[2] = (uint8_t)(c1 & 0xFF);
+        out[3] = (uint8_t)(c1 >> 8);
+        memcpy(out + 4, &Bits, 4);
+    }
+
+    void EncodeColor(const Block& block, uint8_t* out, bool allowAlpha)
+    {
+        bool Transparent[16] = {};
+        bool bHasTransparent = false;
+
+        float Points[16][3];
+        int Count = 0;
+        for (int i = 0; i < 16; ++i)
+        {
+            if (allowAlpha && block.Texels[i][3] < 128)
+            {
+                Transparent[i] = true;
+                bHasTransparent = true;
+                continue;
+            }
+
+            for (int c = 0; c < 3; ++c)
+            {
+                Points[Count][c] = block.Texels[i][c];
+            }
+            ++Count;
+        }
+
+        uint8_t Indices[16] = {};
+
+        if (Count == 0)
+        {
+            // c0 <= c1 selects three-colour mode, index 3 is transparent black.
+            memset(Indices, 3, sizeof(Indices));
+            WriteColorBlock(out, 0, 0, Indices);
+            return;
+        }
+
+        float E0[3];
+        float E1[3];
+        FitEndpoints<3>(Points, Count, E0, E1);
+
+        // Pull the endpoints in a little: the extremes are usually outliers.
+        for (int c = 0; c < 3; ++c)
+        {
+            float Inset = (E0[c] - E1[c]) / 16.0f;
+            E0[c] -= Inset;
+            E1[c] += Inset;
+        }
+
+        uint16_t A = PackRGB565(E0);
+        uint16_t B = PackRGB565(E1);
+
+        if (bHasTransparent)
+        {
+            // Three-colour mode needs c0 <= c1.
+            if (A > B)
+                std::swap(A, B);
+
+            uint8_t Palette[4][4];
+            BuildColorPalette(A, B, true, Palette);
+
+            // Index 3 is transparent, keep it out of the search.
+            memcpy(Palette[3], Palette[2], 4);
+            FindColorIndices(block, Palette, Indices);
+
+            for (int i = 0; i < 16; ++i)
+            {
+                if (Transparent[i])
+                    Indices[i] = 3;
+            }
+
+            WriteColorBlock(out, A, B, Indices);
+            return;
+        }
+
+        uint32_t Error = EvaluateColor(block, A, B, Indices);
+
+        // Least-squares refit of the endpoints to the chosen indices.
+        static const float Weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+        for (int Iteration = 0; Iteration < 2 && Error > 0; ++Iteration)
+        {
+            float Saa = 0.0f, Sab = 0.0f, Sbb = 0.0f;
+            float Sap[3] = {}, Sbp[3] = {};
+            for (int i = 0; i < 16; ++i)
+            {
+                const float Wa = Weights[Indices[i]];
+                const float Wb = 1.0f - Wa;
+                Saa += Wa * Wa;
+                Sab += Wa * Wb;
+                Sbb += Wb * Wb;
+                for (int c = 0; c < 3; ++c)
+                {
+                    Sap[c] += Wa * block.Texels[i][c];
+                    Sbp[c] += Wb * block.Texels[i][c];
+                }
+            }
+
+            const float Det = Saa * Sbb - Sab * Sab;
+            if (std::fabs(Det) < 1e-6f)
+                break;
+
+            float NewA[3];
+            float NewB[3];
+            for (int c = 0; c < 3; ++c)
+            {
+                NewA[c] = (Sbb * Sap[c] - Sab * Sbp[c]) / Det;
+                NewB[c] = (Saa * Sbp[c] - Sab * Sap[c]) / Det;
+            }
+
+            uint16_t CandidateA = PackRGB565(NewA);
+            uint16_t CandidateB = PackRGB565(NewB);
+
+            uint8_t CandidateIndices[16];
+            uint32_t CandidateError = EvaluateColor(block, CandidateA, CandidateB, CandidateIndices);
+            if (CandidateError >= Error)
+                break;
+
+            A = CandidateA;
+            B = CandidateB;
+            Error = CandidateError;
+            memcpy(Indices, CandidateIndices, sizeof(Indices));
+        }
+
+        // Four-colour mode needs c0 > c1.
+        if (A < B)
+        {
+            std::swap(A, B);
+            for (int i = 0; i < 16; ++i)
+            {
+                Indices[i] ^= 1;
+            }
+        }
+        else if (A == B)
+        {
+            memset(Indices, 0, sizeof(Indices));
+        }
+
+        WriteColorBlock(out, A, B, Indices);
+    }
+
+    void DecodeColor(const uint8_t* in, Block& out, bool fourColorOnly)
+    {
+        const uint16_t C0 = (uint16_t)(in[0] | (in[1] << 8));
+        const uint16_t C1 = (uint16_t)(in[2] | (in[3] << 8));
+
+        uint8_t Palette[4][4];
+        BuildColorPalette(C0, C1, !fourColorOnly && C0 <= C1, Palette);
+
+        uint32_t Bits;
+        memcpy(&Bits, in + 4, 4);
+
+        for (int i = 0; i < 16; ++i)
+        {
+            memcpy(out.Texels[i], Palette[(Bits >> (i * 2)) & 3], 4);
+        }
+    }
+
+    // Little-endian bit stream over one 128-bit BC7 block.
+    class BitStream
+    {
+    public:
+        explicit BitStream(uint8_t* data) : m_Data(data) {}
+        explicit BitStream(const uint8_t* data) : m_Data(const_cast<uint8_t*>(data)) {}
+
+        void Write(uint32_t value, uint32_t bits)
+        {
+            for (uint32_t i = 0; i < bits; ++i, ++m_Position)
+            {
+                if (value & (1u << i))
+                    m_Data[m_Position >> 3] |= (uint8_t)(1u << (m_Position & 7));
+            }
+        }
+
+        uint32_t Read(uint32_t bits)
+        {
+            uint32_t Value = 0;
+            for (uint32_t i = 0; i < bits; ++i, ++m_Position)
+            {
+                Value |= (uint32_t)((m_Data[m_Position >> 3] >> (m_Position & 7)) & 1) << i;
+            }
+            return Value;
+        }
+
+    private:
+        uint8_t* m_Data;
+        uint32_t m_Position = 0;
+    };
+
+    // Mode 6 endpoint: 7 bits per channel plus one shared p-bit as the low bit.
+    struct BC7Endpoint
+    {
+        uint8_t Value[4];   // 7-bit
+        uint8_t PBit;
+
+        uint8_t Expand(int c)const { return (uint8_t)((Value[c] << 1) | PBit); }
+    };
+
+    BC7Endpoint QuantizeBC7Endpoint(const float color[4])
+    {
+        BC7Endpoint Best = {};
+        float BestError = FLT_MAX;
+
+        for (uint8_t PBit = 0; PBit < 2; ++PBit)
+        {
+            BC7Endpoint Candidate;
+            Candidate.PBit = PBit;
+
+            float Error = 0.0f;
+            for (int c = 0; c < 4; ++c)
+            {
+                float Clamped = (std::min)((std::max)(color[c], 0.0f), 255.0f);
+                int Q = (int)std::floor((Clamped - PBit) / 2.0f + 0.5f);
+                Candidate.Value[c] = (uint8_t)(std::min)((std::max)(Q, 0), 127);
+
+                float Diff = Clamped - Candidate.Expand(c);
+                Error += Diff * Diff;
+            }
+
+            if (Error < BestError)
+            {
+                BestError = Error;
+                Best = Candidate;
+            }
+        }
+
+        return Best;
+    }
+
+    uint32_t EvaluateBC7(const Block& block, const BC7Endpoint& e0, const BC7Endpoint& e1, uint8_t indices[16])
+    {
+        int Palette[16][4];
+        for (int k = 0; k < 16; ++k)
+        {
+            for (int c = 0; c < 4; ++c)
+            {
+                Palette[k][c] = (int)(((64 - BC7Weights4[k]) * e0.Expand(c) + BC7Weights4[k] * e1.Expand(c) + 32) >> 6);
+            }
+        }
+
+        uint32_t TotalError = 0;
+        for (int i = 0; i < 16; ++i)
+        {
+            uint32_t BestError = UINT_MAX;
+            for (int k = 0; k < 16; ++k)
+            {
+                uint32_t Error = 0;
+                for (int c = 0; c < 4; ++c)
+                {
+                    int Diff = (int)block.Texels[i][c] - Palette[k][c];
+                    Error += (uint32_t)(Diff * Diff);
+                }
+
+                if (Error < BestError)
+                {
+                    BestError = Error;
+                    indices[i] = (uint8_t)k;
+                }
+            }
+            TotalError += BestError;
+        }
+
+        return TotalError;
+    }
+}
+
+namespace BC
+{
+    void EncodeBC1(const Block& block, uint8_t* out, bool allowAlpha)
+    {
+        EncodeColor(block, out, allowAlpha);
+    }
+
+    void EncodeBC3(const Block& block, uint8_t* out)
+    {
+        EncodeBC4(block, out, 3);
+        EncodeColor(block, out + 8, false);
+    }
+
+    void EncodeBC4(const Block& block, uint8_t* out, int channel)
+    {
+        uint8_t Values[16];
+        uint8_t Min = 255;
+        uint8_t Max = 0;
+        for (int i = 0; i < 16; ++i)
+        {
+            Values[i] = block.Texels[i][channel];
+            Min = (std::min)(Min, Values[i]);
+            Max = (std::max)(Max, Values[i]);
+        }
+
+        uint8_t Indices[16] = {};
+        if (Min != Max)
+        {
+            // a0 > a1 selects the eight-value ramp.
+            uint8_t Palette[8];
+            BuildAlphaPalette(Max, Min, Palette);
+            FindAlphaIndices(Values, Palette, Indices);
+        }
+
+        uint64_t Bits = 0;
+        for (int i = 0; i < 16; ++i)
+        {
+            Bits |= (uint64_t)(Indices[i] & 7) << (i * 3);
+        }
+
+        out[0] = Max;
+        out[1] = Min;
+        for (int i = 0; i < 6; ++i)
+        {
+            out[2 + i] = (uint8_t)(Bits >> (i * 8));
+        }
+    }
+
+    void EncodeBC5(const Block& block, uint8_t* out)
+    {
+        EncodeBC4(block, out, 0);
+        EncodeBC4(block, out + 8, 1);
+    }
+
+    void EncodeBC7(const Block& block, uint8_t* out)
+    {
+        float Points[16][4];
+        for (int i = 0; i < 16; ++i)
+        {
+            for (int c = 0; c < 4; ++c)
+            {
+                Points[i][c] = block.Texels[i][c];
+            }
+        }
+
+        float E0[4];
+        float E1[4];
+        FitEndpoints<4>(Points, 16, E0, E1);
+
+        BC7Endpoint End0 = QuantizeBC7Endpoint(E0);
+        BC7Endpoint End1 = QuantizeBC7Endpoint(E1);
+
+        uint8_t Indices[16];
+        uint32_t Error = EvaluateBC7(block, End0, End1, Indices);
+
+        // Least-squares refit of the endpoints to the chosen indices.
+        for (int Iteration = 0; Iteration < 2 && Error > 0; ++Iteration)
+        {
+            float Saa = 0.0f, Sab = 0.0f, Sbb = 0.0f;
+            float Sap[4] = {}, Sbp[4] = {};
+            for (int i = 0; i < 16; ++i)
+            {
+                const float Wb = BC7Weights4[Indices[i]] / 64.0f;
+                const float Wa = 1.0f - Wb;
+                Saa += Wa * Wa;
+                Sab += Wa * Wb;
+                Sbb += Wb * Wb;
+                for (int c = 0; c < 4; ++c)
+                {
+                    Sap[c] += Wa * Points[i][c];
+                    Sbp[c] += Wb * Points[i][c];
+                }
+            }
+
+            const float Det = Saa * Sbb - Sab * Sab;
+            if (std::fabs(Det) < 1e-6f)
+                break;
+
+            float NewA[4];
+            float NewB[4];
+            for (int c = 0; c < 4; ++c)
+            {
+                NewA[c] = (Sbb * Sap[c] - Sab * Sbp[c]) / Det;
+                NewB[c] = (Saa * Sbp[c] - Sab * Sap[c]) / Det;
+            }
+
+            BC7Endpoint CandidateA = QuantizeBC7Endpoint(NewA);
+            BC7Endpoint CandidateB = QuantizeBC7Endpoint(NewB);
+
+            uint8_t CandidateIndices[16];
+            uint32_t CandidateError = EvaluateBC7(block, CandidateA, CandidateB, CandidateIndices);
+            if (CandidateError >= Error)
+                break;
+
+            End0 = CandidateA;
+            End1 = CandidateB;
+            Error = CandidateError;
+            memcpy(Indices, CandidateIndices, sizeof(Indices));
+        }
+
+        // The anchor index is stored with 3 bits, so its top bit must be clear.
+        if (Indices[0] & 8)
+        {
+            std::swap(End0, End1);
+            for (int i = 0; i < 16; ++i)
+            {
+                Indices[i] = (uint8_t)(15 - Indices[i]);
+            }
+        }
+
+        memset(out, 0, 16);
+        BitStream Stream(out);
+        Stream.Write(1u << 6, 7);
+
+        for (int c = 0; c < 4; ++c)
+        {
+            Stream.Write(End0.Value[c], 7);
+            Stream.Write(End1.Value[c], 7);
+        }
+
+        Stream.Write(End0.PBit, 1);
+        Stream.Write(End1.PBit, 1);
+
+        Stream.Write(Indices[0], 3);
+        for (int i = 1; i < 16; ++i)
+        {
+            Stream.Write(Indices[i], 4);
+        }
+    }
+
+    void DecodeBC1(const uint8_t* in, Block& out, bool fourColorOnly)
+    {
+        DecodeColor(in, out, fourColorOnly);
+    }
+
+    void DecodeBC2(const uint8_t* in, Block& out)
+    {
+        DecodeColor(in + 8, out, true);
+
+        uint64_t Bits;
+        memcpy(&Bits, in, 8);
+        for (int i = 0; i < 16; ++i)
+        {
+            out.Texels[i][3] = (uint8_t)(((Bits >> (i * 4)) & 0xF) * 17);
+        }
+    }
+
+    void DecodeBC3(const uint8_t* in, Block& out)
+    {
+        DecodeColor(in + 8, out, true);
+        DecodeBC4(in, out, 3);
+    }
+
+    void DecodeBC4(const uint8_t* in, Block& out, int channel)
+    {
+        uint8_t Palette[8];
+        BuildAlphaPalette(in[0], in[1], Palette);
+
+        uint64_t Bits = 0;
+        for (int i = 0; i < 6; ++i)
+        {
+            Bits |= (uint64_t)in[2 + i] << (i * 8);
+        }
+
+        for (int i = 0; i < 16; ++i)
+        {
+            out.Texels[i][channel] = Palette[(Bits >> (i * 3)) & 7];
+        }
+    }
+
+    void DecodeBC5(const uint8_t* in, Block& out)
+    {
+        DecodeBC4(in, out, 0);
+        DecodeBC4(in + 8, out, 1);
+    }
+
+    bool DecodeBC7(const uint8_t* in, Block& out)
+    {
+        BitStream Stream(in);
+        if (Stream.Read(7) != (1u << 6))
+            return false;
+
+        BC7Endpoint End0;
+        BC7Endpoint End1;
+        for (int c = 0; c < 4; ++c)
+        {
+            End0.Value[c] = (uint8_t)Stream.Read(7);
+            End1.Value[c] = (uint8_t)Stream.Read(7);
+        }
+
+        End0.PBit = (uint8_t)Stream.Read(1);
+        End1.PBit = (uint8_t)Stream.Read(1);
+
+        for (int i = 0; i < 16; ++i)
+        {
+            const uint32_t Index = Stream.Read(i == 0 ? 3 : 4);
+            for (int c = 0; c < 4; ++c)
+            {
+                out.Texels[i][c] = (uint8_t)(((64 - BC7Weights4[Index]) * End0.Expand(c) + BC7Weights4[Index] * End1.Expand(c) + 32) >> 6);
+            }
+        }
+
+        return true;
+    }
+
+    size_t GetBlockBytes(DXGI_FORMAT format)
+    {
+        switch (format)
+        {
+        case DXGI_FORMAT_BC1_UNORM:
+        case DXGI_FORMAT_BC1_UNORM_SRGB:
+        case DXGI_FORMAT_BC4_UNORM:
+            return 8;
+
+        case DXGI_FORMAT_BC2_UNORM:
+        case DXGI_FORMAT_BC2_UNORM_SRGB:
+        case DXGI_FORMAT_BC3_UNORM:
+        case DXGI_FORMAT_BC3_UNORM_SRGB:
+        case DXGI_FORMAT_BC5_UNORM:
+        case DXGI_FORMAT_BC7_UNORM:
+        case DXGI_FORMAT_BC7_UNORM_SRGB:
+            return 16;
+
+        default:
+            return 0;
+        }
+    }
+
+    uint32_t GetChannelMask(DXGI_FORMAT format)
+    {
+        switch (format)
+        {
+        case DXGI_FORMAT_BC1_UNORM:
+        case DXGI_FORMAT_BC1_UNORM_SRGB:
+            return 0x7;
+        case DXGI_FORMAT_BC4_UNORM:
+            return 0x1;
+        case DXGI_FORMAT_BC5_UNORM:
+            return 0x3;
+        default:
+            return 0xF;
+        }
+    }
+
+    void Compress(const Surface& source, DXGI_FORMAT format, ThreadPool& pool, std::vector<uint8_t>& out)
+    {
+        const uint32_t BlocksWide = (std::max)(1u, (source.Width + 3) / 4);
+        const uint32_t BlocksHigh = (std::max)(1u, (source.Height + 3) / 4);
+        const size_t BlockBytes = GetBlockBytes(format);
+
+        out.assign(BlocksWide * BlocksHigh * BlockBytes, 0);
+
+        pool.ParallelFor(BlocksHigh, [&](size_t by)
+        {
+            for (uint32_t bx = 0; bx < BlocksWide; ++bx)
+            {
+                // Edge blocks repeat the last row and column.
+                Block Texels;
+                for (uint32_t y = 0; y < 4; ++y)
+                {
+                    const uint32_t SrcY = (std::min)((uint32_t)by * 4 + y, source.Height - 1);
+                    for (uint32_t x = 0; x < 4; ++x)
+                    {
+                        const uint32_t SrcX = (std::min)(bx * 4 + x, source.Width - 1);
+                        memcpy(Texels.Texels[y * 4 + x], source.Texel(SrcX, SrcY), 4);
+                    }
+                }
+
+                uint8_t* Dst = &out[(by * BlocksWide + bx) * BlockBytes];
+                switch (format)
+                {
+                case DXGI_FORMAT_BC1_UNORM:
+                case DXGI_FORMAT_BC1_UNORM_SRGB:
+                    EncodeBC1(Texels, Dst, true);
+                    break;
+                case DXGI_FORMAT_BC3_UNORM:
+                case DXGI_FORMAT_BC3_UNORM_SRGB:
+                    EncodeBC3(Texels, Dst);
+                    break;
+                case DXGI_FORMAT_BC4_UNORM:
+                    EncodeBC4(Texels, Dst, 0);
+                    break;
+                case DXGI_FORMAT_BC5_UNORM:
+                    EncodeBC5(Texels, Dst);
+                    break;
+                case DXGI_FORMAT_BC7_UNORM:
+                case DXGI_FORMAT_BC7_UNORM_SRGB:
+                    EncodeBC7(Texels, Dst);
+                    break;
+                default:
+                    break;
+                }
+            }
+        });
+    }
+
+    bool Decompress(const uint8_t* data, uint32_t width, uint32_t height, DXGI_FORMAT format, Surface& out)
+    {
+        const size_t BlockBytes = GetBlockBytes(format);
+        if (BlockBytes == 0)
+            return false;
+
+        const uint32_t BlocksWide = (std::max)(1u, (width + 3) / 4);
+        const uint32_t BlocksHigh = (std::max)(1u, (height + 3) / 4);
+
+        out.Resize(width, height);
+
+        for (uint32_t by = 0; by < BlocksHigh; ++by)
+        {
+            for (uint32_t bx = 0; bx < BlocksWide; ++bx)
+            {
+                const uint8_t* Src = data + (by * BlocksWide + bx) * BlockBytes;
+
+                // BC4/BC5 leave the missing channels at (0, 0, 1) like the sampler does.
+                Block Texels;
+                for (int i = 0; i < 16; ++i)
+                {
+                    Texels.Texels[i][0] = Texels.Texels[i][1] = Texels.Texels[i][2] = 0;
+                    Texels.Texels[i][3] = 255;
+                }
+
+                switch (format)
+                {
+                case DXGI_FORMAT_BC1_UNORM:
+                case DXGI_FORMAT_BC1_UNORM_SRGB:
+                    DecodeBC1(Src, Texels, false);
+                    break;
+                case DXGI_FORMAT_BC2_UNORM:
+                case DXGI_FORMAT_BC2_UNORM_SRGB:
+                    DecodeBC2(Src, Texels);
+                    break;
+                case DXGI_FORMAT_BC3_UNORM:
+                case DXGI_FORMAT_BC3_UNORM_SRGB:
+                    DecodeBC3(Src, Texels);
+                    break;
+                case DXGI_FORMAT_BC4_UNORM:
+                    DecodeBC4(Src, Texels, 0);
+                    break;
+                case DXGI_FORMAT_BC5_UNORM:
+                    DecodeBC5(Src, Texels);
+                    break;
+                case DXGI_FORMAT_BC7_UNORM:
+                case DXGI_FORMAT_BC7_UNORM_SRGB:
+                    if (!DecodeBC7(Src, Texels))
+                        return false;
+                    break;
+                default:
+                    return false;
+                }
+
+                for (uint32_t y = 0; y < 4 && by * 4 + y < height; ++y)
+                {
+                    for (uint32_t x = 0; x < 4 && bx * 4 + x < width; ++x)
+                    {
+                        memcpy(out.Texel(bx * 4 + x, by * 4 + y), Texels.Texels[y * 4 + x], 4);
+                    }
+                }
+            }
+        }
+
+        return true;
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "Image.h"
+#include "../Common/DDSHeader.h"
+
+class ThreadPool;
+
+// CPU block compression for BC1, BC3, BC4, BC5 and a single-mode BC7.
+// BC7 uses mode 6 only (one subset, RGBA endpoints, 4-bit indices): far quicker than
+// a full mode search and good enough for smooth diffuse maps.
+namespace BC
+{
+    // 4x4 RGBA8 texels, row-major.
+    struct Block
+    {
+        uint8_t Texels[16][4];
+    };
+
+    void EncodeBC1(const Block& block, uint8_t* out, bool allowAlpha);
+    void EncodeBC3(const Block& block, uint8_t* out);
+    void EncodeBC4(const Block& block, uint8_t* out, int channel);
+    void EncodeBC5(const Block& block, uint8_t* out);
+    void EncodeBC7(const Block& block, uint8_t* out);
+
+    void DecodeBC1(const uint8_t* in, Block& out, bool fourColorOnly);
+    void DecodeBC2(const uint8_t* in, Block& out);
+    void DecodeBC3(const uint8_t* in, Block& out);
+    void DecodeBC4(const uint8_t* in, Block& out, int channel);
+    void DecodeBC5(const uint8_t* in, Block& out);
+
+    // Only mode 6 blocks; returns false for any other mode.
+    bool DecodeBC7(const uint8_t* in, Block& out);
+
+    // 8 or 16, 0 for formats this encoder does not produce.
+    size_t GetBlockBytes(DXGI_FORMAT format);
+
+    // Channels the format stores, as an ErrorMetric mask.
+    uint32_t GetChannelMask(DXGI_FORMAT format);
+
+    // Rows of blocks are spread over the pool.  out is resized to the packed block data.
+    void Compress(const Surface& source, DXGI_FORMAT format, ThreadPool& pool, std::vector<uint8_t>& out);
+
+    // Returns false for formats that cannot be decoded.
+    bool Decompress(const uint8_t* data, uint32_t width, uint32_t height, DXGI_FORMAT format, Surface& out);
+}
@@ -0,0 +1,364 @@
+#include "Commands.h"
+#include "../Common/DynamicBVH.h"
+#include "../Common/FrustumCuller.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+namespace
+{
+    struct BvhBenchOptions
+    {
+        std::vector<uint32_t> Counts;
+        uint32_t Frames = 10;
+        uint32_t Queries = 100;
+        uint32_t Seed = 1;
+    };
+
+    bool ParseOptions(const std::vector<std::string>& args, BvhBenchOptions& options)
+    {
+        for (size_t i = 0; i < args.size(); ++i)
+        {
+            const std::string& Arg = args[i];
+
+            if (Arg == "--frames" && i + 1 < args.size())
+                options.Frames = (uint32_t)(std::max)(atoi(args[++i].c_str()), 1);
+            else if (Arg == "--queries" && i + 1 < args.size())
+                options.Queries = (uint32_t)(std::max)(atoi(args[++i].c_str()), 1);
+            else if (Arg == "--seed" && i + 1 < args.size())
+                options.Seed = (uint32_t)atoi(args[++i].c_str());
+            else if (!Arg.empty() && Arg[0] != '-')
+                options.Counts.push_back((uint32_t)(std::max)(atoi(Arg.c_str()), 1));
+            else
+            {
+                fprintf(stderr, "unknown option '%s'\n", Arg.c_str());
+                return false;
+            }
+        }
+
+        if (options.Counts.empty())
+            options.Counts = { 1000, 10000, 100000, 1000000 };
+
+        return true;
+    }
+
+    typedef std::chrono::high_resolution_clock Clock;
+
+    double MillisecondsSince(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    // An open level: boxes of 0.5-4 units on a square ground area that grows with the item
+    // count, so density stays the same, up to 20 units high.  One in ten items moves.
+    struct BenchScene
+    {
+        float Size = 0.0f;
+        std::vector<BVHBounds> Bounds;
+        std::vector<uint32_t> Moving;
+        std::vector<float> Velocity;
+    };
+
+    BenchScene BuildScene(uint32_t count, uint32_t seed)
+    {
+        std::mt19937 Random(seed);
+        std::uniform_real_distribution<float> Unit(0.0f, 1.0f);
+
+        BenchScene Scene;
+        Scene.Size = std::sqrt((float)count) * 8.0f;
+        Scene.Bounds.resize(count);
+
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            const float Center[3] = { (Unit(Random) - 0.5f) * Scene.Size, Unit(Random) * 20.0f, (Unit(Random) - 0.5f) * Scene.Size };
+            const float Extents[3] = { 0.25f + Unit(Random) * 1.75f, 0.25f + Unit(Random) * 1.75f, 0.25f + Unit(Random) * 1.75f };
+            Scene.Bounds[i] = BVHBounds::FromCenterExtents(Center, Extents);
+
+            if (Unit(Random) < 0.1f)
+            {
+                Scene.Moving.push_back(i);
+                for (int Axis = 0; Axis < 3; ++Axis)
+                {
+                    Scene.Velocity.push_back((Unit(Random) - 0.5f) * (Axis == 1 ? 0.1f : 1.0f));
+                }
+            }
+        }
+
+        return Scene;
+    }
+
+    // One frame of movement.  Movers turn back at the edge of the level.
+    void StepScene(BenchScene& scene)
+    {
+        const float Limit[3] = { scene.Size * 0.5f, 20.0f, scene.Size * 0.5f };
+        for (size_t i = 0; i < scene.Moving.size(); ++i)
+        {
+            BVHBounds& Bounds = scene.Bounds[scene.Moving[i]];
+            for (int Axis = 0; Axis < 3; ++Axis)
+            {
+                float& Velocity = scene.Velocity[i * 3 + Axis];
+                const float Center = (Bounds.Min[Axis] + Bounds.Max[Axis]) * 0.5f;
+                if ((Center > Limit[Axis] && Velocity > 0.0f) || (Center < (Axis == 1 ? 0.0f : -Limit[Axis]) && Velocity < 0.0f))
+                    Velocity = -Velocity;
+
+                Bounds.Min[Axis] += Velocity;
+                Bounds.Max[Axis] += Velocity;
+            }
+        }
+    }
+
+    // Camera at the edge of the level looking in along +z, 60 degree vertical field of view,
+    // far plane at 500.  With no rotation the view-projection matrix is the projection with
+    // the eye translation folded into its last row.
+    void BuildViewProjection(const float eye[3], float viewProj[16])
+    {
+        const float YScale = 1.0f / std::tan(3.1415927f / 6.0f);
+        const float XScale = YScale / (16.0f / 9.0f);
+        const float NearZ = 1.0f;
+        const float FarZ = 500.0f;
+        const float Range = FarZ / (FarZ - NearZ);
+
+        const float Matrix[16] =
+        {
+            XScale, 0.0f, 0.0f, 0.0f,
+            0.0f, YScale, 0.0f, 0.0f,
+            0.0f, 0.0f, Range, 1.0f,
+            -eye[0] * XScale, -eye[1] * YScale, -eye[2] * Range - Range * NearZ, -eye[2],
+        };
+        std::copy(Matrix, Matrix + 16, viewProj);
+    }
+
+    bool SameItems(std::vector<uint32_t>& a, std::vector<uint32_t>& b)
+    {
+        std::sort(a.begin(), a.end());
+        std::sort(b.begin(), b.end());
+        return a == b;
+    }
+}
+
+int RunBvhBench(const std::vector<std::string>& args)
+{
+    BvhBenchOptions Options;
+    if (!ParseOptions(args, Options))
+    {
+        fprintf(stderr, "usage: TextureTool bvh-bench [--frames n] [--queries n] [--seed n] [count...]\n");
+        return 1;
+    }
+
+    bool bOk = true;
+
+    for (uint32_t Count : Options.Counts)
+    {
+        BenchScene Scene = BuildScene(Count, Options.Seed);
+        printf("%u items, %zu moving, level %.0f x %.0f\n", Count, Scene.Moving.size(), Scene.Size, Scene.Size);
+
+        // Build.
+        DynamicBVH Tree;
+        Clock::time_point Start = Clock::now();
+        Tree.BuildStatic(Scene.Bounds.data(), Count);
+        const double StaticTime = MillisecondsSince(Start);
+        printf("  build      static sah   %10.2f ms   cost %8.1f   height %3u\n", StaticTime, Tree.ComputeSAHCost(), Tree.ComputeHeight());
+
+        {
+            std::vector<uint32_t> Order(Count);
+            for (uint32_t i = 0; i < Count; ++i)
+            {
+                Order[i] = i;
+            }
+            std::shuffle(Order.begin(), Order.end(), std::mt19937(Options.Seed));
+
+            DynamicBVH Incremental;
+            std::vector<uint32_t> Proxies(Count);
+            Start = Clock::now();
+            for (uint32_t Item : Order)
+            {
+                Proxies[Item] = Incremental.Insert(Scene.Bounds[Item], Item);
+            }
+            const double InsertTime = MillisecondsSince(Start);
+            printf("             insert       %10.2f ms   cost %8.1f   height %3u   (%.3f us/item)\n",
+                InsertTime, Incremental.ComputeSAHCost(), Incremental.ComputeHeight(), InsertTime * 1000.0 / Count);
+
+            // Remove every other item.
+            Start = Clock::now();
+            for (uint32_t i = 0; i < Count; i += 2)
+            {
+                Incremental.Remove(Proxies[i]);
+            }
+            const double RemoveTime = MillisecondsSince(Start);
+            if (Incremental.GetLeafCount() != Count / 2)
+            {
+                printf("    %u leaves left after removing half\n", Incremental.GetLeafCount());
+                bOk = false;
+            }
+            printf("             remove half  %10.2f ms   cost %8.1f   height %3u\n", RemoveTime, Incremental.ComputeSAHCost(), Incremental.ComputeHeight());
+        }
+
+        // Update.
+        Tree.SetMargin(0.5f);
+        uint32_t Changed = 0;
+        Start = Clock::now();
+        for (uint32_t Frame = 0; Frame < Options.Frames; ++Frame)
+        {
+            StepScene(Scene);
+            for (uint32_t Item : Scene.Moving)
+            {
+                Changed += Tree.Move(Item, Scene.Bounds[Item]) ? 1 : 0;
+            }
+        }
+        const double UpdateTime = MillisecondsSince(Start) / Options.Frames;
+        const float UpdatedCost = Tree.ComputeSAHCost();
+
+        Start = Clock::now();
+        Tree.Optimize(Tree.GetNodeCount());
+        const double OptimizeTime = MillisecondsSince(Start);
+        printf("  update     %u frames     %10.3f ms/frame, %4.1f%% of moves touched the tree, cost %.1f, optimize pass %.2f ms -> %.1f\n",
+            Options.Frames, UpdateTime, Scene.Moving.empty() ? 0.0 : 100.0 * Changed / (Scene.Moving.size() * Options.Frames),
+            UpdatedCost, OptimizeTime, Tree.ComputeSAHCost());
+
+        // Every leaf has to still contain its item.
+        for (uint32_t i = 0; i < Count; ++i)
+        {
+            if (Tree.GetItem(i) != i || !Tree.GetFatBounds(i).Contains(Scene.Bounds[i]))
+            {
+                printf("    leaf %u lost its item\n", i);
+                bOk = false;
+                break;
+            }
+        }
+
+        // Queries, each checked against a brute-force loop over the leaf boxes with the same
+        // test.
+        std::mt19937 Random(Options.Seed + 1);
+        std::uniform_real_distribution<float> Unit(0.0f, 1.0f);
+        std::vector<uint32_t> Found;
+        std::vector<uint32_t> Expected;
+
+        {
+            const float Eye[3] = { 0.0f, 10.0f, -Scene.Size * 0.5f };
+            float ViewProj[16];
+            float Planes[6][4];
+            BuildViewProjection(Eye, ViewProj);
+            FrustumCuller::ExtractPlanes(ViewProj, Planes);
+
+            Start = Clock::now();
+            Tree.QueryFrustum(Planes, [&](uint32_t Item) { Found.push_back(Item); });
+            const double TreeTime = MillisecondsSince(Start);
+
+            for (uint32_t i = 0; i < Count; ++i)
+            {
+                bool bInside = true;
+                for (int Plane = 0; Plane < 6 && bInside; ++Plane)
+                {
+                    bInside = Tree.GetFatBounds(i).ClassifyPlane(Planes[Plane]) >= 0;
+                }
+                if (bInside)
+                    Expected.push_back(i);
+            }
+
+            // The flat culler for comparison, on the tight boxes.
+            FrustumCuller Flat;
+            const float Identity[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+            for (const BVHBounds& Bounds : Scene.Bounds)
+            {
+                float Center[3];
+                float Extents[3];
+                for (int Axis = 0; Axis < 3; ++Axis)
+                {
+                    Center[Axis] = (Bounds.Min[Axis] + Bounds.Max[Axis]) * 0.5f;
+                    Extents[Axis] = (Bounds.Max[Axis] - Bounds.Min[Axis]) * 0.5f;
+                }
+                Flat.AddItem(Center, Extents, Identity);
+            }
+            Flat.SetViewProjection(ViewProj);
+            std::vector<uint32_t> FlatVisible;
+            Start = Clock::now();
+            Flat.Cull(FlatVisible);
+            const double FlatTime = MillisecondsSince(Start);
+
+            printf("  frustum    1 query      %10.3f ms   %u visible   (flat %s cull %.3f ms)\n",
+                TreeTime, (uint32_t)Found.size(), FrustumCuller::IsAVXAvailable() ? "avx" : "scalar", FlatTime);
+
+            if (!SameItems(Found, Expected))
+            {
+                printf("    frustum query returned %zu items, brute force %zu\n", Found.size(), Expected.size());
+                bOk = false;
+            }
+        }
+
+        {
+            uint32_t Hits = 0;
+            uint32_t Mismatches = 0;
+            double TreeTime = 0.0;
+            for (uint32_t Query = 0; Query < Options.Queries; ++Query)
+            {
+                const float Center[3] = { (Unit(Random) - 0.5f) * Scene.Size, Unit(Random) * 20.0f, (Unit(Random) - 0.5f) * Scene.Size };
+                const float Radius = 5.0f + Unit(Random) * 20.0f;
+
+                Found.clear();
+                Expected.clear();
+                Start = Clock::now();
+                Tree.QuerySphere(Center, Radius, [&](uint32_t Item) { Found.push_back(Item); });
+                TreeTime += MillisecondsSince(Start);
+
+                for (uint32_t i = 0; i < Count; ++i)
+                {
+                    if (Tree.GetFatBounds(i).OverlapsSphere(Center, Radius))
+                        Expected.push_back(i);
+                }
+
+                Hits += (uint32_t)Found.size();
+                Mismatches += SameItems(Found, Expected) ? 0 : 1;
+            }
+
+            printf("  sphere     %u queries  %10.3f ms   %.1f items each\n", Options.Queries, TreeTime, (double)Hits / Options.Queries);
+            if (Mismatches != 0)
+            {
+                printf("    %u sphere queries disagree with brute force\n", Mismatches);
+                bOk = false;
+            }
+        }
+
+        {
+            uint32_t Hits = 0;
+            uint32_t Mismatches = 0;
+            double TreeTime = 0.0;
+            const float MaxT = 200.0f;
+            for (uint32_t Query = 0; Query < Options.Queries; ++Query)
+            {
+                const float Origin[3] = { (Unit(Random) - 0.5f) * Scene.Size, Unit(Random) * 20.0f, (Unit(Random) - 0.5f) * Scene.Size };
+                const float Yaw = Unit(Random) * 6.2831853f;
+                const float Direction[3] = { std::cos(Yaw), (Unit(Random) - 0.5f) * 0.2f, std::sin(Yaw) };
+
+                Found.clear();
+                Expected.clear();
+                Start = Clock::now();
+                Tree.QueryRay(Origin, Direction, MaxT, [&](uint32_t Item, float) { Found.push_back(Item); return MaxT; });
+                TreeTime += MillisecondsSince(Start);
+
+                const float InvDirection[3] = { 1.0f / Direction[0], 1.0f / Direction[1], 1.0f / Direction[2] };
+                for (uint32_t i = 0; i < Count; ++i)
+                {
+                    if (Tree.GetFatBounds(i).IntersectRay(Origin, InvDirection, MaxT) >= 0.0f)
+                        Expected.push_back(i);
+                }
+
+                Hits += (uint32_t)Found.size();
+                Mismatches += SameItems(Found, Expected) ? 0 : 1;
+            }
+
+            printf("  ray        %u rays     %10.3f ms   %.1f hits each within %.0f units\n", Options.Queries, TreeTime, (double)Hits / Options.Queries, MaxT);
+            if (Mismatches != 0)
+            {
+                printf("    %u rays disagree with brute force\n", Mismatches);
+                bOk = false;
+            }
+        }
+    }
+
+    printf(bOk ? "ok\n" : "FAILED\n");
+    return bOk ? 0 : 1;
+}
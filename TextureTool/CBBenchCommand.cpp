@@ -0,0 +1,186 @@
+#include "Commands.h"
+#include "../Common/DirtyTracker.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+namespace
+{
+    struct CBBenchOptions
+    {
+        uint32_t Items = 100000;
+        uint32_t Frames = 30;
+        uint32_t Seed = 1;
+        std::vector<uint32_t> MovingCounts;
+    };
+
+    bool ParseOptions(const std::vector<std::string>& args, CBBenchOptions& options)
+    {
+        for (size_t i = 0; i < args.size(); ++i)
+        {
+            const std::string& Arg = args[i];
+
+            if (Arg == "--items" && i + 1 < args.size())
+                options.Items = (uint32_t)(std::max)(atoi(args[++i].c_str()), 1);
+            else if (Arg == "--frames" && i + 1 < args.size())
+                options.Frames = (uint32_t)(std::max)(atoi(args[++i].c_str()), 1);
+            else if (Arg == "--seed" && i + 1 < args.size())
+                options.Seed = (uint32_t)atoi(args[++i].c_str());
+            else if (!Arg.empty() && Arg[0] != '-')
+                options.MovingCounts.push_back((uint32_t)(std::max)(atoi(Arg.c_str()), 0));
+            else
+            {
+                fprintf(stderr, "unknown option '%s'\n", Arg.c_str());
+                return false;
+            }
+        }
+
+        if (options.MovingCounts.empty())
+            options.MovingCounts = { 0, 100, 1000, 10000 };
+
+        return true;
+    }
+
+    // The sample's frame slot count and object constant layout: two transposed matrices
+    // in a 256 byte aligned element.
+    const uint32_t FrameCount = 3;
+    const uint32_t ElementByteSize = 256;
+
+    struct BenchItem
+    {
+        float World[16];
+        float TextureTransform[16];
+    };
+
+    void WriteElement(uint8_t* slot, uint32_t index, const BenchItem& item)
+    {
+        float Constant[32];
+        for (int Row = 0; Row < 4; ++Row)
+        {
+            for (int Column = 0; Column < 4; ++Column)
+            {
+                Constant[Row * 4 + Column] = item.World[Column * 4 + Row];
+                Constant[16 + Row * 4 + Column] = item.TextureTransform[Column * 4 + Row];
+            }
+        }
+        memcpy(slot + (size_t)index * ElementByteSize, Constant, sizeof(Constant));
+    }
+
+    struct RunResult
+    {
+        double FullMilliseconds = 0.0;
+        double DirtyMilliseconds = 0.0;
+        double DirtyBytes = 0.0;
+        bool bSame = true;
+    };
+
+    // Moves movingCount random items every frame and updates one buffer by rewriting every
+    // element and another through DirtyTracker.  After each frame the slot just written has
+    // to be identical in both.  Times are per frame, averaged over the frames after the
+    // first FrameCount, which write everything in both cases.
+    RunResult RunFrames(const CBBenchOptions& options, uint32_t movingCount)
+    {
+        std::mt19937 Random(options.Seed);
+        std::uniform_real_distribution<float> Unit(0.0f, 1.0f);
+
+        std::vector<BenchItem> Items(options.Items);
+        for (BenchItem& Item : Items)
+        {
+            for (int i = 0; i < 16; ++i)
+            {
+                Item.World[i] = (i % 5 == 0) ? 1.0f : 0.0f;
+                Item.TextureTransform[i] = (i % 5 == 0) ? 1.0f : 0.0f;
+            }
+            Item.World[12] = (Unit(Random) - 0.5f) * 1000.0f;
+            Item.World[14] = (Unit(Random) - 0.5f) * 1000.0f;
+        }
+
+        const size_t SlotBytes = (size_t)options.Items * ElementByteSize;
+        std::vector<uint8_t> FullBuffer(SlotBytes * FrameCount, 0);
+        std::vector<uint8_t> DirtyBuffer(SlotBytes * FrameCount, 0);
+
+        DirtyTracker Tracker(FrameCount);
+        Tracker.Reset(options.Items);
+
+        typedef std::chrono::high_resolution_clock Clock;
+        RunResult Result;
+        uint32_t TimedFrames = 0;
+
+        for (uint32_t Frame = 0; Frame < options.Frames + FrameCount; ++Frame)
+        {
+            for (uint32_t i = 0; i < movingCount; ++i)
+            {
+                const uint32_t Index = Random() % options.Items;
+                Items[Index].World[12] += Unit(Random) - 0.5f;
+                Items[Index].World[13] = Unit(Random);
+                Tracker.MarkDirty(Index);
+            }
+
+            const size_t SlotOffset = (Frame % FrameCount) * SlotBytes;
+            uint8_t* FullSlot = FullBuffer.data() + SlotOffset;
+            uint8_t* DirtySlot = DirtyBuffer.data() + SlotOffset;
+
+            const Clock::time_point FullStart = Clock::now();
+            for (uint32_t i = 0; i < options.Items; ++i)
+            {
+                WriteElement(FullSlot, i, Items[i]);
+            }
+            const Clock::time_point DirtyStart = Clock::now();
+            const uint32_t Written = Tracker.Flush([&](uint32_t index) { WriteElement(DirtySlot, index, Items[index]); });
+            const Clock::time_point End = Clock::now();
+
+            Result.bSame = Result.bSame && memcmp(FullSlot, DirtySlot, SlotBytes) == 0;
+
+            if (Frame >= FrameCount)
+            {
+                Result.FullMilliseconds += std::chrono::duration<double, std::milli>(DirtyStart - FullStart).count();
+                Result.DirtyMilliseconds += std::chrono::duration<double, std::milli>(End - DirtyStart).count();
+                Result.DirtyBytes += (double)Written * sizeof(float) * 32;
+                ++TimedFrames;
+            }
+        }
+
+        Result.FullMilliseconds /= TimedFrames;
+        Result.DirtyMilliseconds /= TimedFrames;
+        Result.DirtyBytes /= TimedFrames;
+        return Result;
+    }
+}
+
+int RunCBBench(const std::vector<std::string>& args)
+{
+    CBBenchOptions Options;
+    if (!ParseOptions(args, Options))
+    {
+        fprintf(stderr, "usage: TextureTool cb-bench [--items n] [--frames n] [--seed n] [moving...]\n");
+        return 1;
+    }
+
+    const double FullBytes = (double)Options.Items * sizeof(float) * 32;
+
+    printf("%u items, %u frame slots, %u frames\n", Options.Items, FrameCount, Options.Frames);
+    printf("  %8s %12s %12s %12s %12s %8s\n", "moving", "full ms", "full KB", "dirty ms", "dirty KB", "speedup");
+
+    bool bOk = true;
+    for (uint32_t Moving : Options.MovingCounts)
+    {
+        const RunResult Result = RunFrames(Options, Moving);
+
+        printf("  %8u %12.4f %12.1f %12.4f %12.1f %7.1fx\n", Moving, Result.FullMilliseconds, FullBytes / 1024.0,
+            Result.DirtyMilliseconds, Result.DirtyBytes / 1024.0,
+            Result.DirtyMilliseconds > 0.0 ? Result.FullMilliseconds / Result.DirtyMilliseconds : 0.0);
+
+        if (!Result.bSame)
+        {
+            printf("    slots written through the dirty tracker differ from full rewrites\n");
+            bOk = false;
+        }
+    }
+
+    printf(bOk ? "ok\n" : "FAILED\n");
+    return bOk ? 0 : 1;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Each command receives the arguments after its name and returns the process exit code.
+int RunBvhBench(const std::vector<std::string>& args);
+int RunCBBench(const std::vector<std::string>& args);
+int RunCompress(const std::vector<std::string>& args);
+int RunCullBench(const std::vector<std::string>& args);
+int RunDescriptorSim(const std::vector<std::string>& args);
+int RunDrawSort(const std::vector<std::string>& args);
+int RunFrameSim(const std::vector<std::string>& args);
+int RunHeapSim(const std::vector<std::string>& args);
+int RunInstanceSim(const std::vector<std::string>& args);
+int RunLoadBench(const std::vector<std::string>& args);
+int RunMips(const std::vector<std::string>& args);
+int RunPack(const std::vector<std::string>& args);
+int RunPermutations(const std::vector<std::string>& args);
+int RunProbe(const std::vector<std::string>& args);
+int RunRangeSim(const std::vector<std::string>& args);
+int RunReadBench(const std::vector<std::string>& args);
+int RunRecordSim(const std::vector<std::string>& args);
+int RunRingSim(const std::vector<std::string>& args);
+int RunScatterBench(const std::vector<std::string>& args);
+int RunShaderCache(const std::vector<std::string>& args);
+int RunStreamSim(const std::vector<std::string>& args);
+int RunTaskGraph(const std::vector<std::string>& args);
+int RunUploadSim(const std::vector<std::string>& args);
+
+// Helpers shared by the commands.
+std::string GetFileName(const std::string& path);
+std::string JoinPath(const std::string& directory, const std::string& fileName);
@@ -0,0 +1,217 @@
+#include "Commands.h"
+#include "BlockCompress.h"
+#include "DDSFile.h"
+#include "MipGenerator.h"
+#include "../Common/ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+
+namespace
+{
+    struct CompressOptions
+    {
+        std::string OutputDirectory = ".";
+        DXGI_FORMAT ForcedFormat = DXGI_FORMAT_UNKNOWN;
+        bool bNormalMap = false;
+        size_t ThreadCount = 0;
+        std::vector<std::string> Inputs;
+    };
+
+    bool ParseFormat(const std::string& name, DXGI_FORMAT& format)
+    {
+        if (name == "bc1")      format = DXGI_FORMAT_BC1_UNORM;
+        else if (name == "bc3") format = DXGI_FORMAT_BC3_UNORM;
+        else if (name == "bc4") format = DXGI_FORMAT_BC4_UNORM;
+        else if (name == "bc5") format = DXGI_FORMAT_BC5_UNORM;
+        else if (name == "bc7") format = DXGI_FORMAT_BC7_UNORM;
+        else return false;
+
+        return true;
+    }
+
+    bool ParseOptions(const std::vector<std::string>& args, CompressOptions& options)
+    {
+        for (size_t i = 0; i < args.size(); ++i)
+        {
+            const std::string& Arg = args[i];
+            const bool bHasValue = i + 1 < args.size();
+
+            if (Arg == "-o" && bHasValue)
+                options.OutputDirectory = args[++i];
+            else if (Arg == "-f" && bHasValue)
+            {
+                if (!ParseFormat(args[++i], options.ForcedFormat))
+                {
+                    fprintf(stderr, "unknown format '%s'\n", args[i].c_str());
+                    return false;
+                }
+            }
+            else if (Arg == "-j" && bHasValue)
+                options.ThreadCount = (size_t)atoi(args[++i].c_str());
+            else if (Arg == "--normal")
+                options.bNormalMap = true;
+            else if (!Arg.empty() && Arg[0] == '-')
+            {
+                fprintf(stderr, "unknown option '%s'\n", Arg.c_str());
+                return false;
+            }
+            else
+                options.Inputs.push_back(Arg);
+        }
+
+        return !options.Inputs.empty();
+    }
+
+    bool HasAlpha(const Surface& surface)
+    {
+        for (size_t i = 3; i < surface.Pixels.size(); i += 4)
+        {
+            if (surface.Pixels[i] != 255)
+                return true;
+        }
+        return false;
+    }
+
+    // Files without mips get a full chain, filtered in linear light for colour data.
+    void CompleteMipChain(RGBATexture& texture, bool bNormalMap, ThreadPool& pool)
+    {
+        if (texture.MipCount != 1)
+            return;
+
+        MipOptions Options;
+        Options.bNormalMap = bNormalMap;
+
+        const bool bSRGB = !bNormalMap;
+
+        std::vector<Surface> Chain;
+        for (uint32_t Slice = 0; Slice < texture.ArraySize; ++Slice)
+        {
+            FloatImage Top;
+            SurfaceToFloat(texture.Subresources[Slice], bSRGB, Top);
+
+            std::vector<FloatImage> Levels;
+            GenerateMipChain(Top, Options, pool, Levels);
+
+            for (const FloatImage& Level : Levels)
+            {
+                Chain.emplace_back();
+                FloatToSurface(Level, bSRGB, Chain.back());
+            }
+
+            texture.MipCount = (uint32_t)Levels.size();
+        }
+
+        texture.Subresources = std::move(Chain);
+    }
+
+    bool CompressFile(const std::string& input, const CompressOptions& options, ThreadPool& pool, double& outMegapixels, double& outSeconds)
+    {
+        std::string Error;
+        RGBATexture Source;
+        if (!LoadRGBATexture(input, Source, Error))
+        {
+            fprintf(stderr, "%s: %s\n", input.c_str(), Error.c_str());
+            return false;
+        }
+
+        const std::string FileName = GetFileName(input);
+        const bool bNormalMap = options.bNormalMap || FileName.find("_nmap") != std::string::npos;
+
+        DXGI_FORMAT Format = options.ForcedFormat;
+        if (Format == DXGI_FORMAT_UNKNOWN)
+        {
+            if (bNormalMap)
+                Format = DXGI_FORMAT_BC5_UNORM;
+            else if (HasAlpha(Source.Subresources[0]))
+                Format = DXGI_FORMAT_BC3_UNORM;
+            else
+                Format = DXGI_FORMAT_BC1_UNORM;
+        }
+
+        CompleteMipChain(Source, bNormalMap, pool);
+
+        TextureFile Output;
+        Output.Format = Format;
+        Output.Width = Source.Subresources[0].Width;
+        Output.Height = Source.Subresources[0].Height;
+        Output.MipCount = Source.MipCount;
+        Output.ArraySize = Source.ArraySize;
+        Output.IsCubeMap = Source.IsCubeMap;
+        Output.Subresources.resize(Source.Subresources.size());
+
+        uint64_t Pixels = 0;
+        auto StartTime = std::chrono::high_resolution_clock::now();
+
+        for (size_t i = 0; i < Source.Subresources.size(); ++i)
+        {
+            BC::Compress(Source.Subresources[i], Format, pool, Output.Subresources[i]);
+            Pixels += (uint64_t)Source.Subresources[i].Width * Source.Subresources[i].Height;
+        }
+
+        auto EndTime = std::chrono::high_resolution_clock::now();
+        const double Seconds = std::chrono::duration<double>(EndTime - StartTime).count();
+
+        // Quality against the (mip-completed) source.
+        ErrorMetric Metric;
+        size_t OutputBytes = 0;
+        for (size_t i = 0; i < Source.Subresources.size(); ++i)
+        {
+            const Surface& Reference = Source.Subresources[i];
+
+            Surface Decoded;
+            BC::Decompress(Output.Subresources[i].data(), Reference.Width, Reference.Height, Format, Decoded);
+            Metric.Add(Reference, Decoded, BC::GetChannelMask(Format));
+
+            OutputBytes += Output.Subresources[i].size();
+        }
+
+        const std::string OutputPath = JoinPath(options.OutputDirectory, FileName);
+        if (!SaveTextureFile(OutputPath, Output, Error))
+        {
+            fprintf(stderr, "%s: %s\n", OutputPath.c_str(), Error.c_str());
+            return false;
+        }
+
+        const double Megapixels = Pixels / 1.0e6;
+        printf("%-24s %5ux%-5u %2u mips  %-16s -> %-10s %8zu KB  %8.1f MPix/s  PSNR %5.2f dB\n",
+            FileName.c_str(), Output.Width, Output.Height, Output.MipCount,
+            GetFormatName(Source.SourceFormat), GetFormatName(Format),
+            OutputBytes / 1024, Seconds > 0.0 ? Megapixels / Seconds : 0.0, Metric.GetPSNR());
+
+        outMegapixels += Megapixels;
+        outSeconds += Seconds;
+        return true;
+    }
+}
+
+int RunCompress(const std::vector<std::string>& args)
+{
+    CompressOptions Options;
+    if (!ParseOptions(args, Options))
+    {
+        fprintf(stderr, "usage: TextureTool compress [-o dir] [-f bc1|bc3|bc4|bc5|bc7] [--normal] [-j threads] <input.dds>...\n");
+        return 1;
+    }
+
+    ThreadPool Pool(Options.ThreadCount);
+
+    double Megapixels = 0.0;
+    double Seconds = 0.0;
+    int Failures = 0;
+
+    for (const std::string& Input : Options.Inputs)
+    {
+        if (!CompressFile(Input, Options, Pool, Megapixels, Seconds))
+            ++Failures;
+    }
+
+    printf("%zu textures, %.1f MPix in %.3f s (%.1f MPix/s, %zu threads)\n",
+        Options.Inputs.size() - Failures, Megapixels, Seconds, Seconds > 0.0 ? Megapixels / Seconds : 0.0, Pool.GetThreadCount() + 1);
+
+    return Failures == 0 ? 0 : 1;
+}
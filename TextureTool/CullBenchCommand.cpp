@@ -0,0 +1,318 @@
+#include "Commands.h"
+#include "../Common/FrustumCuller.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+namespace
+{
+    struct CullBenchOptions
+    {
+        std::vector<uint32_t> Counts;
+        uint32_t Repeats = 0;
+        uint32_t Seed = 1;
+    };
+
+    bool ParseOptions(const std::vector<std::string>& args, CullBenchOptions& options)
+    {
+        for (size_t i = 0; i < args.size(); ++i)
+        {
+            const std::string& Arg = args[i];
+
+            if (Arg == "--repeats" && i + 1 < args.size())
+                options.Repeats = (uint32_t)(std::max)(atoi(args[++i].c_str()), 1);
+            else if (Arg == "--seed" && i + 1 < args.size())
+                options.Seed = (uint32_t)atoi(args[++i].c_str());
+            else if (!Arg.empty() && Arg[0] != '-')
+                options.Counts.push_back((uint32_t)(std::max)(atoi(Arg.c_str()), 1));
+            else
+            {
+                fprintf(stderr, "unknown option '%s'\n", Arg.c_str());
+                return false;
+            }
+        }
+
+        if (options.Counts.empty())
+            options.Counts = { 1000, 10000, 100000 };
+
+        return true;
+    }
+
+    // Row-vector matrices in the DirectXMath layout, built the way XMMatrixLookAtLH and
+    // XMMatrixPerspectiveFovLH build them.
+    struct Matrix
+    {
+        float m[16];
+    };
+
+    Matrix Multiply(const Matrix& a, const Matrix& b)
+    {
+        Matrix Result;
+        for (int Row = 0; Row < 4; ++Row)
+        {
+            for (int Column = 0; Column < 4; ++Column)
+            {
+                float Sum = 0.0f;
+                for (int k = 0; k < 4; ++k)
+                {
+                    Sum += a.m[Row * 4 + k] * b.m[k * 4 + Column];
+                }
+                Result.m[Row * 4 + Column] = Sum;
+            }
+        }
+        return Result;
+    }
+
+    Matrix LookToLH(const float eye[3], const float look[3])
+    {
+        // look must be normalized and not vertical.
+        float Right[3] = { look[2], 0.0f, -look[0] };
+        const float RightLength = std::sqrt(Right[0] * Right[0] + Right[2] * Right[2]);
+        Right[0] /= RightLength;
+        Right[2] /= RightLength;
+
+        const float Up[3] =
+        {
+            look[1] * Right[2] - look[2] * Right[1],
+            look[2] * Right[0] - look[0] * Right[2],
+            look[0] * Right[1] - look[1] * Right[0],
+        };
+
+        auto Dot = [&](const float* a) { return a[0] * eye[0] + a[1] * eye[1] + a[2] * eye[2]; };
+
+        Matrix View =
+        { {
+            Right[0], Up[0], look[0], 0.0f,
+            Right[1], Up[1], look[1], 0.0f,
+            Right[2], Up[2], look[2], 0.0f,
+            -Dot(Right), -Dot(Up), -Dot(look), 1.0f,
+        } };
+        return View;
+    }
+
+    Matrix PerspectiveFovLH(float fovY, float aspect, float nearZ, float farZ)
+    {
+        const float YScale = 1.0f / std::tan(fovY * 0.5f);
+        const float Range = farZ / (farZ - nearZ);
+
+        Matrix Proj =
+        { {
+            YScale / aspect, 0.0f, 0.0f, 0.0f,
+            0.0f, YScale, 0.0f, 0.0f,
+            0.0f, 0.0f, Range, 1.0f,
+            0.0f, 0.0f, -Range * nearZ, 0.0f,
+        } };
+        return Proj;
+    }
+
+    struct BenchItem
+    {
+        float Center[3];
+        float Extents[3];
+        Matrix World;
+    };
+
+    // Boxes of 0.5-4 units, randomly rotated, scaled and scattered in a 400 unit cube
+    // around the camera.
+    std::vector<BenchItem> BuildItems(uint32_t count, uint32_t seed)
+    {
+        std::mt19937 Random(seed);
+        std::uniform_real_distribution<float> Unit(0.0f, 1.0f);
+
+        std::vector<BenchItem> Items(count);
+        for (BenchItem& Item : Items)
+        {
+            for (int i = 0; i < 3; ++i)
+            {
+                Item.Center[i] = (Unit(Random) - 0.5f) * 2.0f;
+                Item.Extents[i] = 0.25f + Unit(Random) * 1.75f;
+            }
+
+            const float Yaw = Unit(Random) * 6.2831853f;
+            const float Pitch = (Unit(Random) - 0.5f) * 3.1415927f;
+            const float Scale = 0.5f + Unit(Random) * 1.5f;
+            const float Cy = std::cos(Yaw), Sy = std::sin(Yaw), Cp = std::cos(Pitch), Sp = std::sin(Pitch);
+
+            Item.World =
+            { {
+                Cy * Scale, 0.0f, -Sy * Scale, 0.0f,
+                Sy * Sp * Scale, Cp * Scale, Cy * Sp * Scale, 0.0f,
+                Sy * Cp * Scale, -Sp * Scale, Cy * Cp * Scale, 0.0f,
+                (Unit(Random) - 0.5f) * 400.0f, (Unit(Random) - 0.5f) * 400.0f, (Unit(Random) - 0.5f) * 400.0f, 1.0f,
+            } };
+        }
+
+        return Items;
+    }
+
+    // Independent references in double precision, projected to clip space without any plane
+    // extraction.  Each returns the margin by which the box clears the plane that rejects
+    // it best; negative means culled.
+    //
+    // bWorldAabb false tests the corners of the oriented box itself.  The culler tests the
+    // world-space AABB around it, so it may keep boxes this rejects but never the reverse.
+    // bWorldAabb true tests the corners of that AABB, which the culler has to match.
+    double ReferenceMargin(const BenchItem& item, const Matrix& viewProj, bool bWorldAabb)
+    {
+        double Corners[8][4];
+        double Min[3] = { 1e30, 1e30, 1e30 };
+        double Max[3] = { -1e30, -1e30, -1e30 };
+
+        for (int Corner = 0; Corner < 8; ++Corner)
+        {
+            const double Local[4] =
+            {
+                item.Center[0] + ((Corner & 1) ? item.Extents[0] : -item.Extents[0]),
+                item.Center[1] + ((Corner & 2) ? item.Extents[1] : -item.Extents[1]),
+                item.Center[2] + ((Corner & 4) ? item.Extents[2] : -item.Extents[2]),
+                1.0,
+            };
+
+            for (int c = 0; c < 4; ++c)
+            {
+                Corners[Corner][c] = 0.0;
+                for (int k = 0; k < 4; ++k)
+                {
+                    Corners[Corner][c] += Local[k] * item.World.m[k * 4 + c];
+                }
+            }
+
+            for (int c = 0; c < 3; ++c)
+            {
+                Min[c] = (std::min)(Min[c], Corners[Corner][c]);
+                Max[c] = (std::max)(Max[c], Corners[Corner][c]);
+            }
+        }
+
+        if (bWorldAabb)
+        {
+            for (int Corner = 0; Corner < 8; ++Corner)
+            {
+                Corners[Corner][0] = (Corner & 1) ? Max[0] : Min[0];
+                Corners[Corner][1] = (Corner & 2) ? Max[1] : Min[1];
+                Corners[Corner][2] = (Corner & 4) ? Max[2] : Min[2];
+            }
+        }
+
+        double Worst = 1e30;
+        for (int Plane = 0; Plane < 6; ++Plane)
+        {
+            double Best = -1e30;
+            for (int Corner = 0; Corner < 8; ++Corner)
+            {
+                double Clip[4] = {};
+                for (int c = 0; c < 4; ++c)
+                {
+                    for (int k = 0; k < 4; ++k)
+                    {
+                        Clip[c] += Corners[Corner][k] * viewProj.m[k * 4 + c];
+                    }
+                }
+
+                const double W = Clip[3];
+                const double Inside[6] = { W + Clip[0], W - Clip[0], W + Clip[1], W - Clip[1], Clip[2], W - Clip[2] };
+                Best = (std::max)(Best, Inside[Plane]);
+            }
+
+            Worst = (std::min)(Worst, Best);
+        }
+
+        return Worst;
+    }
+
+    template<typename F>
+    double BestMilliseconds(uint32_t repeats, F&& func)
+    {
+        typedef std::chrono::high_resolution_clock Clock;
+
+        double Best = 1e30;
+        for (uint32_t i = 0; i < repeats; ++i)
+        {
+            const Clock::time_point Start = Clock::now();
+            func();
+            Best = (std::min)(Best, std::chrono::duration<double, std::milli>(Clock::now() - Start).count());
+        }
+        return Best;
+    }
+}
+
+int RunCullBench(const std::vector<std::string>& args)
+{
+    CullBenchOptions Options;
+    if (!ParseOptions(args, Options))
+    {
+        fprintf(stderr, "usage: TextureTool cull-bench [--repeats n] [--seed n] [count...]\n");
+        return 1;
+    }
+
+    const float Eye[3] = { 0.0f, 2.0f, -15.0f };
+    const float Look[3] = { 0.0f, 0.0f, 1.0f };
+    const Matrix ViewProj = Multiply(LookToLH(Eye, Look), PerspectiveFovLH(0.25f * 3.1415927f, 16.0f / 9.0f, 1.0f, 1000.0f));
+
+    printf("avx %s\n", FrustumCuller::IsAVXAvailable() ? "available" : "not available, both runs use the scalar path");
+    printf("  %8s %9s %7s %12s %12s %8s %10s\n", "items", "visible", "extra", "scalar ms", "avx ms", "speedup", "Mitems/s");
+
+    bool bOk = true;
+
+    for (uint32_t Count : Options.Counts)
+    {
+        const std::vector<BenchItem> Items = BuildItems(Count, Options.Seed);
+
+        FrustumCuller Culler;
+        for (const BenchItem& Item : Items)
+        {
+            Culler.AddItem(Item.Center, Item.Extents, Item.World.m);
+        }
+        Culler.SetViewProjection(ViewProj.m);
+
+        std::vector<uint32_t> ScalarVisible;
+        std::vector<uint32_t> AVXVisible;
+        Culler.Cull(ScalarVisible, CullPath::Scalar);
+        Culler.Cull(AVXVisible, CullPath::AVX);
+
+        // Both paths must agree exactly, and with the AABB reference wherever the box is
+        // clear of the deciding plane by more than rounding.
+        uint32_t Mismatches = ScalarVisible == AVXVisible ? 0 : 1;
+        uint32_t WronglyCulled = 0;
+        uint32_t ExtraKept = 0;
+        std::vector<bool> bVisible(Count, false);
+        for (uint32_t Index : AVXVisible)
+        {
+            bVisible[Index] = true;
+        }
+        for (uint32_t i = 0; i < Count; ++i)
+        {
+            const double AabbMargin = ReferenceMargin(Items[i], ViewProj, true);
+            if (std::fabs(AabbMargin) > 1e-2 && (AabbMargin >= 0.0) != bVisible[i])
+                ++Mismatches;
+
+            const double BoxMargin = ReferenceMargin(Items[i], ViewProj, false);
+            if (BoxMargin > 1e-2 && !bVisible[i])
+                ++WronglyCulled;
+            else if (BoxMargin < 0.0 && bVisible[i])
+                ++ExtraKept;
+        }
+
+        const uint32_t Repeats = Options.Repeats != 0 ? Options.Repeats : (std::max)(2000000u / Count, 5u);
+        std::vector<uint32_t> Visible;
+        const double ScalarTime = BestMilliseconds(Repeats, [&]() { Culler.Cull(Visible, CullPath::Scalar); });
+        const double AVXTime = BestMilliseconds(Repeats, [&]() { Culler.Cull(Visible, CullPath::AVX); });
+
+        printf("  %8u %9zu %7u %12.4f %12.4f %7.2fx %10.1f\n", Count, AVXVisible.size(), ExtraKept, ScalarTime, AVXTime,
+            AVXTime > 0.0 ? ScalarTime / AVXTime : 0.0, AVXTime > 0.0 ? Count / AVXTime / 1000.0 : 0.0);
+
+        if (Mismatches != 0 || WronglyCulled != 0)
+        {
+            printf("    %u disagreements between scalar, avx and the aabb reference, %u visible boxes culled\n",
+                Mismatches, WronglyCulled);
+            bOk = false;
+        }
+    }
+
+    printf(bOk ? "ok\n" : "FAILED\n");
+    return bOk ? 0 : 1;
+}
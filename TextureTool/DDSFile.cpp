@@ -0,0 +1,307 @@
+#include "DDSFile.h"
+#include "BlockCompress.h"
+#include "../Common/MappedFile.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+    // Flags the DDS_HEADER fields need but DDSHeader.h does not name.
+    const uint32_t DDSD_CAPS = 0x00000001;
+    const uint32_t DDSD_PIXELFORMAT = 0x00001000;
+    const uint32_t DDSD_MIPMAPCOUNT = 0x00020000;
+    const uint32_t DDSD_PITCH = 0x00000008;
+    const uint32_t DDSD_LINEARSIZE = 0x00080000;
+    const uint32_t DDSCAPS_COMPLEX = 0x00000008;
+    const uint32_t DDSCAPS_TEXTURE = 0x00001000;
+    const uint32_t DDSCAPS_MIPMAP = 0x00400000;
+
+    bool ExpandSubresource(const uint8_t* bits, const DDS::Subresource& layout, DXGI_FORMAT format, Surface& out)
+    {
+        switch (format)
+        {
+        case DXGI_FORMAT_R8G8B8A8_UNORM:
+        case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+        case DXGI_FORMAT_B8G8R8A8_UNORM:
+        case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+        case DXGI_FORMAT_B8G8R8X8_UNORM:
+        case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+            break;
+
+        default:
+            return BC::Decompress(bits, layout.Width, layout.Height, format, out);
+        }
+
+        const bool bSwapRB = format != DXGI_FORMAT_R8G8B8A8_UNORM && format != DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+        const bool bOpaque = format == DXGI_FORMAT_B8G8R8X8_UNORM || format == DXGI_FORMAT_B8G8R8X8_UNORM_SRGB;
+
+        out.Resize(layout.Width, layout.Height);
+        for (uint32_t y = 0; y < layout.Height; ++y)
+        {
+            const uint8_t* Src = bits + layout.RowPitch * y;
+            for (uint32_t x = 0; x < layout.Width; ++x, Src += 4)
+            {
+                uint8_t* Dst = out.Texel(x, y);
+                Dst[0] = bSwapRB ? Src[2] : Src[0];
+                Dst[1] = Src[1];
+                Dst[2] = bSwapRB ? Src[0] : Src[2];
+                Dst[3] = bOpaque ? 255 : Src[3];
+            }
+        }
+
+        return true;
+    }
+
+    bool IsFloatFormat(DXGI_FORMAT format)
+    {
+        return format == DXGI_FORMAT_R16G16B16A16_FLOAT || format == DXGI_FORMAT_R32G32B32A32_FLOAT ||
+            format == DXGI_FORMAT_R16_FLOAT || format == DXGI_FORMAT_R32_FLOAT;
+    }
+
+    void ExpandFloatSubresource(const uint8_t* bits, const DDS::Subresource& layout, DXGI_FORMAT format, FloatImage& out)
+    {
+        const uint32_t Channels = (format == DXGI_FORMAT_R16_FLOAT || format == DXGI_FORMAT_R32_FLOAT) ? 1 : 4;
+        const bool bHalf = format == DXGI_FORMAT_R16G16B16A16_FLOAT || format == DXGI_FORMAT_R16_FLOAT;
+
+        out.Resize(layout.Width, layout.Height, Channels);
+        for (uint32_t y = 0; y < layout.Height; ++y)
+        {
+            const uint8_t* Src = bits + layout.RowPitch * y;
+            float* Dst = out.Row(y);
+
+            for (uint32_t i = 0; i < layout.Width * Channels; ++i)
+            {
+                if (bHalf)
+                {
+                    uint16_t Value;
+                    memcpy(&Value, Src + i * 2, sizeof(Value));
+                    Dst[i] = HalfToFloat(Value);
+                }
+                else
+                {
+                    memcpy(&Dst[i], Src + i * 4, sizeof(float));
+                }
+            }
+        }
+    }
+
+    bool OpenTexture(const std::string& fileName, MappedFile& file, DDS::FileView& view, DDS::TextureDesc& desc,
+        std::vector<DDS::Subresource>& layout, std::string& error)
+    {
+        if (!file.Open(fileName))
+        {
+            error = "cannot open file";
+            return false;
+        }
+
+        if (DDS::ParseHeader(file.GetData(), file.GetSize(), view) != DDS::Status::Ok ||
+            DDS::GetTextureDesc(view, desc) != DDS::Status::Ok ||
+            DDS::GetSubresourceLayout(desc, view.BitSize, layout) != DDS::Status::Ok)
+        {
+            error = "not a valid DDS file";
+            return false;
+        }
+
+        if (desc.Dimension != DDS_DIMENSION_TEXTURE2D)
+        {
+            error = "only 2D textures are supported";
+            return false;
+        }
+
+        return true;
+    }
+}
+
+bool LoadRGBATexture(const std::string& fileName, RGBATexture& out, std::string& error)
+{
+    MappedFile File;
+    DDS::FileView View;
+    DDS::TextureDesc Desc;
+    std::vector<DDS::Subresource> Layout;
+
+    if (!OpenTexture(fileName, File, View, Desc, Layout, error))
+        return false;
+
+    out.SourceFormat = Desc.Format;
+    out.MipCount = Desc.MipCount;
+    out.ArraySize = Desc.ArraySize;
+    out.IsCubeMap = Desc.IsCubeMap;
+    out.Subresources.resize(Layout.size());
+
+    for (size_t i = 0; i < Layout.size(); ++i)
+    {
+        if (!ExpandSubresource(View.BitData + Layout[i].Offset, Layout[i], Desc.Format, out.Subresources[i]))
+        {
+            error = std::string("unsupported format ") + GetFormatName(Desc.Format);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool LoadFloatTexture(const std::string& fileName, bool bSRGB, FloatTexture& out, std::string& error)
+{
+    MappedFile File;
+    DDS::FileView View;
+    DDS::TextureDesc Desc;
+    std::vector<DDS::Subresource> Layout;
+
+    if (!OpenTexture(fileName, File, View, Desc, Layout, error))
+        return false;
+
+    out.SourceFormat = Desc.Format;
+    out.MipCount = Desc.MipCount;
+    out.ArraySize = Desc.ArraySize;
+    out.IsCubeMap = Desc.IsCubeMap;
+    out.Subresources.resize(Layout.size());
+
+    if (IsFloatFormat(Desc.Format))
+    {
+        for (size_t i = 0; i < Layout.size(); ++i)
+        {
+            ExpandFloatSubresource(View.BitData + Layout[i].Offset, Layout[i], Desc.Format, out.Subresources[i]);
+        }
+        return true;
+    }
+
+    // Everything else goes through RGBA8.
+    RGBATexture Texture;
+    if (!LoadRGBATexture(fileName, Texture, error))
+        return false;
+
+    for (size_t i = 0; i < Texture.Subresources.size(); ++i)
+    {
+        SurfaceToFloat(Texture.Subresources[i], bSRGB || IsSRGBFormat(Desc.Format), out.Subresources[i]);
+    }
+
+    return true;
+}
+
+bool LoadTextureFile(const std::string& fileName, TextureFile& out, std::string& error)
+{
+    MappedFile File;
+    DDS::FileView View;
+    DDS::TextureDesc Desc;
+    std::vector<DDS::Subresource> Layout;
+
+    if (!OpenTexture(fileName, File, View, Desc, Layout, error))
+        return false;
+
+    out.Format = Desc.Format;
+    out.Width = Desc.Width;
+    out.Height = Desc.Height;
+    out.MipCount = Desc.MipCount;
+    out.ArraySize = Desc.ArraySize;
+    out.IsCubeMap = Desc.IsCubeMap;
+    out.Subresources.resize(Layout.size());
+
+    for (size_t i = 0; i < Layout.size(); ++i)
+    {
+        const uint8_t* Bits = View.BitData + Layout[i].Offset;
+        out.Subresources[i].assign(Bits, Bits + Layout[i].SlicePitch * Layout[i].Depth);
+    }
+
+    return true;
+}
+
+bool SaveTextureFile(const std::string& fileName, const TextureFile& texture, std::string& error)
+{
+    size_t RowBytes = 0;
+    size_t NumBytes = 0;
+    DDS::GetSurfaceInfo(texture.Width, texture.Height, texture.Format, &NumBytes, &RowBytes, nullptr);
+
+    const bool bCompressed = BC::GetBlockBytes(texture.Format) != 0;
+
+    DDS_HEADER Header = {};
+    Header.size = sizeof(DDS_HEADER);
+    Header.flags = DDSD_CAPS | DDS_HEIGHT | DDS_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | (bCompressed ? DDSD_LINEARSIZE : DDSD_PITCH);
+    Header.height = texture.Height;
+    Header.width = texture.Width;
+    Header.pitchOrLinearSize = (uint32_t)(bCompressed ? NumBytes : RowBytes);
+    Header.depth = 1;
+    Header.mipMapCount = texture.MipCount;
+    Header.ddspf.size = sizeof(DDS_PIXELFORMAT);
+    Header.ddspf.flags = DDS_FOURCC;
+    Header.ddspf.fourCC = MAKEFOURCC('D', 'X', '1', '0');
+    Header.caps = DDSCAPS_TEXTURE | (texture.MipCount > 1 ? DDSCAPS_MIPMAP | DDSCAPS_COMPLEX : 0);
+    Header.caps2 = texture.IsCubeMap ? DDS_CUBEMAP_ALLFACES : 0;
+
+    DDS_HEADER_DXT10 HeaderDXT10 = {};
+    HeaderDXT10.dxgiFormat = texture.Format;
+    HeaderDXT10.resourceDimension = DDS_DIMENSION_TEXTURE2D;
+    HeaderDXT10.miscFlag = texture.IsCubeMap ? DDS_RESOURCE_MISC_TEXTURECUBE : 0;
+    HeaderDXT10.arraySize = texture.IsCubeMap ? texture.ArraySize / 6 : texture.ArraySize;
+
+    FILE* Output = fopen(fileName.c_str(), "wb");
+    if (Output == nullptr)
+    {
+        error = "cannot create file";
+        return false;
+    }
+
+    bool bWritten = fwrite(&DDS_MAGIC, sizeof(DDS_MAGIC), 1, Output) == 1 &&
+        fwrite(&Header, sizeof(Header), 1, Output) == 1 &&
+        fwrite(&HeaderDXT10, sizeof(HeaderDXT10), 1, Output) == 1;
+
+    for (size_t i = 0; i < texture.Subresources.size() && bWritten; ++i)
+    {
+        const std::vector<uint8_t>& Data = texture.Subresources[i];
+        bWritten = fwrite(Data.data(), 1, Data.size(), Output) == Data.size();
+    }
+
+    if (fclose(Output) != 0 || !bWritten)
+    {
+        error = "write failed";
+        return false;
+    }
+
+    return true;
+}
+
+const char* GetFormatName(DXGI_FORMAT format)
+{
+    switch (format)
+    {
+    case DXGI_FORMAT_R8G8B8A8_UNORM:        return "R8G8B8A8_UNORM";
+    case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:   return "R8G8B8A8_UNORM_SRGB";
+    case DXGI_FORMAT_B8G8R8A8_UNORM:        return "B8G8R8A8_UNORM";
+    case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:   return "B8G8R8A8_UNORM_SRGB";
+    case DXGI_FORMAT_B8G8R8X8_UNORM:        return "B8G8R8X8_UNORM";
+    case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:   return "B8G8R8X8_UNORM_SRGB";
+    case DXGI_FORMAT_BC1_UNORM:             return "BC1_UNORM";
+    case DXGI_FORMAT_BC1_UNORM_SRGB:        return "BC1_UNORM_SRGB";
+    case DXGI_FORMAT_BC2_UNORM:             return "BC2_UNORM";
+    case DXGI_FORMAT_BC2_UNORM_SRGB:        return "BC2_UNORM_SRGB";
+    case DXGI_FORMAT_BC3_UNORM:             return "BC3_UNORM";
+    case DXGI_FORMAT_BC3_UNORM_SRGB:        return "BC3_UNORM_SRGB";
+    case DXGI_FORMAT_BC4_UNORM:             return "BC4_UNORM";
+    case DXGI_FORMAT_BC5_UNORM:             return "BC5_UNORM";
+    case DXGI_FORMAT_BC7_UNORM:             return "BC7_UNORM";
+    case DXGI_FORMAT_BC7_UNORM_SRGB:        return "BC7_UNORM_SRGB";
+    case DXGI_FORMAT_R16G16B16A16_FLOAT:    return "R16G16B16A16_FLOAT";
+    case DXGI_FORMAT_R32G32B32A32_FLOAT:    return "R32G32B32A32_FLOAT";
+    case DXGI_FORMAT_R16_FLOAT:             return "R16_FLOAT";
+    case DXGI_FORMAT_R32_FLOAT:             return "R32_FLOAT";
+    default:                                return "UNKNOWN";
+    }
+}
+
+bool IsSRGBFormat(DXGI_FORMAT format)
+{
+    switch (format)
+    {
+    case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+    case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+    case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+    case DXGI_FORMAT_BC1_UNORM_SRGB:
+    case DXGI_FORMAT_BC2_UNORM_SRGB:
+    case DXGI_FORMAT_BC3_UNORM_SRGB:
+    case DXGI_FORMAT_BC7_UNORM_SRGB:
+        return true;
+
+    default:
+        return false;
+    }
+}
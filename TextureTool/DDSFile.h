@@ -0,0 +1,64 @@
+#pragma once
+
+#include "Image.h"
+#include "../Common/DDSHeader.h"
+
+#include <string>
+
+// A 2D texture (or array / cube) expanded to RGBA8, one surface per subresource.
+struct RGBATexture
+{
+    DXGI_FORMAT SourceFormat = DXGI_FORMAT_UNKNOWN;
+    uint32_t MipCount = 0;
+    uint32_t ArraySize = 0;
+    bool IsCubeMap = false;
+
+    // Array slice major, then mip: Subresources[slice * MipCount + mip].
+    std::vector<Surface> Subresources;
+};
+
+// A texture expanded to float.  R16_FLOAT / R32_FLOAT sources keep one channel, everything
+// else has four.  Same subresource order as RGBATexture.
+struct FloatTexture
+{
+    DXGI_FORMAT SourceFormat = DXGI_FORMAT_UNKNOWN;
+    uint32_t MipCount = 0;
+    uint32_t ArraySize = 0;
+    bool IsCubeMap = false;
+
+    std::vector<FloatImage> Subresources;
+};
+
+// Texture data ready to be written as-is.
+struct TextureFile
+{
+    DXGI_FORMAT Format = DXGI_FORMAT_UNKNOWN;
+    uint32_t Width = 0;
+    uint32_t Height = 0;
+    uint32_t MipCount = 0;
+    uint32_t ArraySize = 0;
+    bool IsCubeMap = false;
+
+    // Same order as RGBATexture, tightly packed rows (or rows of blocks).
+    std::vector<std::vector<uint8_t>> Subresources;
+};
+
+// Reads R8G8B8A8, B8G8R8A8, B8G8R8X8 and BC1-BC5 files (BC7 mode 6 only) through the
+// loader's DDS parsing code.  On failure returns false and describes the problem in error.
+bool LoadRGBATexture(const std::string& fileName, RGBATexture& out, std::string& error);
+
+// Reads everything LoadRGBATexture does plus R16G16B16A16_FLOAT, R32G32B32A32_FLOAT,
+// R16_FLOAT and R32_FLOAT.  8-bit and block-compressed data is converted to linear light
+// when bSRGB is set or the source format is an _SRGB one.
+bool LoadFloatTexture(const std::string& fileName, bool bSRGB, FloatTexture& out, std::string& error);
+
+// Reads any 2D DDS without converting it: subresources keep the file's own bytes.
+bool LoadTextureFile(const std::string& fileName, TextureFile& out, std::string& error);
+
+// Writes a DDS with the DX10 header extension.
+bool SaveTextureFile(const std::string& fileName, const TextureFile& texture, std::string& error);
+
+// Short name for reports, e.g. "BC5_UNORM".
+const char* GetFormatName(DXGI_FORMAT format);
+
+bool IsSRGBFormat(DXGI_FORMAT format);
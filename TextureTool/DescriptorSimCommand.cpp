@@ -0,0 +1,233 @@
+#include "Commands.h"
+#include "../Common/DescriptorAllocator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+namespace
+{
+    struct DescriptorSimOptions
+    {
+        uint32_t Frames = 1000;
+        uint32_t Latency = 3;
+        uint32_t Textures = 200;
+        uint32_t Swaps = 4;
+        uint32_t Materials = 64;
+        uint32_t Persistent = 1024;
+        uint32_t Transient = 1024;
+        uint32_t Seed = 1;
+    };
+
+    bool ParseOptions(const std::vector<std::string>& args, DescriptorSimOptions& options)
+    {
+        for (size_t i = 0; i < args.size(); ++i)
+        {
+            const std::string& Arg = args[i];
+
+            if (Arg == "--frames" && i + 1 < args.size())
+                options.Frames = (uint32_t)(std::max)(atoi(args[++i].c_str()), 1);
+            else if (Arg == "--latency" && i + 1 < args.size())
+                options.Latency = (uint32_t)(std::max)(atoi(args[++i].c_str()), 0);
+            else if (Arg == "--textures" && i + 1 < args.size())
+                options.Textures = (uint32_t)(std::max)(atoi(args[++i].c_str()), 1);
+            else if (Arg == "--swaps" && i + 1 < args.size())
+                options.Swaps = (uint32_t)(std::max)(atoi(args[++i].c_str()), 0);
+            else if (Arg == "--materials" && i + 1 < args.size())
+                options.Materials = (uint32_t)(std::max)(atoi(args[++i].c_str()), 0);
+            else if (Arg == "--persistent" && i + 1 < args.size())
+                options.Persistent = (uint32_t)(std::max)(atoi(args[++i].c_str()), 1);
+            else if (Arg == "--transient" && i + 1 < args.size())
+                options.Transient = (uint32_t)(std::max)(atoi(args[++i].c_str()), 2);
+            else if (Arg == "--seed" && i + 1 < args.size())
+                options.Seed = (uint32_t)atoi(args[++i].c_str());
+            else
+            {
+                fprintf(stderr, "unknown option '%s'\n", Arg.c_str());
+                return false;
+            }
+        }
+        return true;
+    }
+
+    const int FreeSlot = -1;
+
+    // A texture's view: most take one slot, array views of packs sometimes a few.
+    struct TextureSlots
+    {
+        uint32_t Index = DescriptorAllocator::InvalidIndex;
+        uint32_t Count = 0;
+    };
+
+    struct SimResult
+    {
+        uint64_t PersistentAllocations = 0;
+        uint64_t TransientAllocations = 0;
+        uint32_t FramesWithSwaps = 0;
+        uint32_t FramesRun = 0;
+        double Milliseconds = 0.0;
+        bool bOk = true;
+    };
+}
+
+int RunDescriptorSim(const std::vector<std::string>& args)
+{
+    DescriptorSimOptions Options;
+    if (!ParseOptions(args, Options))
+    {
+        fprintf(stderr, "usage: TextureTool descriptor-sim [--frames n] [--latency n] [--textures n] [--swaps n] [--materials n] [--persistent n] [--transient n] [--seed n]\n");
+        return 1;
+    }
+
+    printf("%u frames, %u frames of GPU latency, %u textures with about %u view swaps a frame, %u material tables, %u + %u slots\n",
+        Options.Frames, Options.Latency, Options.Textures, Options.Swaps, Options.Materials, Options.Persistent, Options.Transient);
+
+    std::mt19937 Random(Options.Seed);
+
+    DescriptorAllocator Allocator;
+    Allocator.Reset(Options.Persistent, Options.Transient);
+
+    // Mirror of the heap: which texture owns each persistent slot, and the fence value
+    // of the last frame that may read each slot.
+    std::vector<int> Owner(Options.Persistent, FreeSlot);
+    std::vector<uint64_t> LastRead(Options.Persistent + Options.Transient, 0);
+
+    std::vector<TextureSlots> Textures(Options.Textures);
+    SimResult Result;
+
+    auto AllocateTexture = [&](uint32_t texture, uint64_t completed)
+    {
+        TextureSlots& Slots = Textures[texture];
+        Slots.Count = Random() % 8 == 0 ? 2 + Random() % 3 : 1;
+        Slots.Index = Allocator.AllocatePersistent(Slots.Count);
+        if (Slots.Index == DescriptorAllocator::InvalidIndex)
+        {
+            printf("    persistent region full\n");
+            Result.bOk = false;
+            Slots.Count = 0;
+            return;
+        }
+        ++Result.PersistentAllocations;
+
+        for (uint32_t i = Slots.Index; i < Slots.Index + Slots.Count; ++i)
+        {
+            if (i >= Options.Persistent || Owner[i] != FreeSlot || LastRead[i] > completed)
+            {
+                printf("    slot %u handed out while %s\n", i, i < Options.Persistent && Owner[i] != FreeSlot ? "still owned" : "the GPU may read it");
+                Result.bOk = false;
+                return;
+            }
+            Owner[i] = (int)texture;
+        }
+    };
+
+    auto FreeTexture = [&](uint32_t texture, uint64_t fenceValue)
+    {
+        TextureSlots& Slots = Textures[texture];
+        for (uint32_t i = Slots.Index; i < Slots.Index + Slots.Count; ++i)
+        {
+            Owner[i] = FreeSlot;
+        }
+        Allocator.FreePersistent(Slots.Index, Slots.Count, fenceValue);
+        Slots = TextureSlots();
+    };
+
+    const std::chrono::high_resolution_clock::time_point Start = std::chrono::high_resolution_clock::now();
+
+    for (uint32_t Texture = 0; Texture < Options.Textures && Result.bOk; ++Texture)
+    {
+        AllocateTexture(Texture, 0);
+    }
+
+    for (uint32_t Frame = 0; Frame < Options.Frames && Result.bOk; ++Frame)
+    {
+        const uint64_t FenceValue = (uint64_t)Frame + 1;
+        const uint64_t Completed = Frame > Options.Latency ? Frame - Options.Latency : 0;
+        Allocator.Reclaim(Completed);
+
+        // Every live view may be read by this frame, including views replaced below: the
+        // material constants for this frame were written before the swap.
+        for (uint32_t i = 0; i < Options.Persistent; ++i)
+        {
+            if (Owner[i] != FreeSlot)
+                LastRead[i] = FenceValue;
+        }
+
+        // Streamed mips land: the new view goes to a new slot and the old one is freed with
+        // this frame's fence, since this frame and those in flight still read it.
+        const uint32_t SwapCount = Options.Swaps > 0 ? Random() % (Options.Swaps * 2 + 1) : 0;
+        for (uint32_t i = 0; i < SwapCount && Result.bOk; ++i)
+        {
+            const uint32_t Texture = Random() % Options.Textures;
+            FreeTexture(Texture, FenceValue);
+            AllocateTexture(Texture, Completed);
+        }
+        if (SwapCount > 0)
+            ++Result.FramesWithSwaps;
+
+        // Two-entry tables copied for this frame's draws.
+        for (uint32_t Material = 0; Material < Options.Materials && Result.bOk; ++Material)
+        {
+            const uint32_t Table = Allocator.AllocateTransient(2);
+            if (Table == DescriptorAllocator::InvalidIndex)
+            {
+                printf("    transient ring full in frame %u\n", Frame);
+                Result.bOk = false;
+                break;
+            }
+            ++Result.TransientAllocations;
+
+            for (uint32_t i = Table; i < Table + 2; ++i)
+            {
+                if (i < Options.Persistent || i >= Options.Persistent + Options.Transient || LastRead[i] > Completed)
+                {
+                    printf("    transient slot %u handed out while the GPU may read it\n", i);
+                    Result.bOk = false;
+                    break;
+                }
+                LastRead[i] = FenceValue;
+            }
+        }
+        Allocator.RetireTransient(FenceValue);
+        ++Result.FramesRun;
+    }
+
+    Result.Milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - Start).count();
+
+    const DescriptorAllocatorStats Peak = Allocator.GetStats();
+
+    // Unload everything: once the GPU is idle the persistent region must merge back into
+    // one free range and the ring must be empty.
+    const uint64_t LastFence = (uint64_t)Options.Frames + 1;
+    for (uint32_t Texture = 0; Texture < Options.Textures; ++Texture)
+    {
+        if (Textures[Texture].Count > 0)
+            FreeTexture(Texture, LastFence);
+    }
+    Allocator.Reclaim(LastFence);
+
+    const DescriptorAllocatorStats& Stats = Allocator.GetStats();
+    if (Stats.PersistentUsed != 0 || Stats.PendingFreeCount != 0 || Stats.TransientUsed != 0)
+    {
+        printf("    %u persistent, %u pending and %u transient slots left after unloading\n", Stats.PersistentUsed, Stats.PendingFreeCount, Stats.TransientUsed);
+        Result.bOk = false;
+    }
+    if (Allocator.AllocatePersistent(Options.Persistent) != 0)
+    {
+        printf("    free slots did not merge back into one range\n");
+        Result.bOk = false;
+    }
+
+    printf("  persistent       %llu allocations, peak %u/%u slots (%u waiting for the GPU at the end)\n",
+        (unsigned long long)Result.PersistentAllocations, Peak.PersistentPeak, Options.Persistent, Peak.PendingFreeCount);
+    printf("  transient        %llu tables, peak %u/%u slots\n",
+        (unsigned long long)Result.TransientAllocations, Peak.TransientPeak, Options.Transient);
+    printf("  swaps            %u of %u frames replaced views; overwriting in place would have waited for the GPU in each\n",
+        Result.FramesWithSwaps, Result.FramesRun);
+    printf("  time             %.2f ms\n", Result.Milliseconds);
+
+    printf(Result.bOk ? "ok\n" : "FAILED\n");
+    return Result.bOk ? 0 : 1;
+}
@@ -0,0 +1,367 @@
+#include "Commands.h"
+#include "../Common/DrawSort.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+namespace
+{
+    struct DrawSortOptions
+    {
+        uint32_t Items = 10000;
+        uint32_t Materials = 256;
+        uint32_t Textures = 64;
+        uint32_t Geometries = 200;
+        uint32_t Seed = 1;
+    };
+
+    bool ParseOptions(const std::vector<std::string>& args, DrawSortOptions& options)
+    {
+        for (size_t i = 0; i < args.size(); ++i)
+        {
+            const std::string& Arg = args[i];
+
+            if (Arg == "--items" && i + 1 < args.size())
+                options.Items = (uint32_t)(std::max)(atoi(args[++i].c_str()), 1);
+            else if (Arg == "--materials" && i + 1 < args.size())
+                options.Materials = (uint32_t)(std::max)(atoi(args[++i].c_str()), 1);
+            else if (Arg == "--textures" && i + 1 < args.size())
+                options.Textures = (uint32_t)(std::max)(atoi(args[++i].c_str()), 1);
+            else if (Arg == "--geometries" && i + 1 < args.size())
+                options.Geometries = (uint32_t)(std::max)(atoi(args[++i].c_str()), 1);
+            else if (Arg == "--seed" && i + 1 < args.size())
+                options.Seed = (uint32_t)atoi(args[++i].c_str());
+            else
+            {
+                fprintf(stderr, "unknown option '%s'\n", Arg.c_str());
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    // Pass order of the sample's main pass (MainPassLayers in D3DSample.cpp).
+    enum Pass : uint32_t
+    {
+        SkyboxPass,
+        OpaquePass,
+        SkinnedOpaquePass,
+        QuadPatchPass,
+        AlphaTestedPass,
+        TreePass,
+        TransparentPass,
+        ShadowMapDebugPass,
+        PassCount
+    };
+
+    // What RenderGeometry looks at for one RenderItem.
+    struct SimItem
+    {
+        uint32_t Pass;
+        uint32_t Object;
+        uint32_t Material;
+        uint32_t Texture;       // 0 : no texture, else heap index + 1
+        uint32_t Geometry;      // each geometry has its own vertex and index buffer
+        uint32_t Topology;
+        uint32_t Skinned;
+        float Depth;
+    };
+
+    struct SimScene
+    {
+        const char* Name;
+        float FarZ = 1000.0f;
+        std::vector<SimItem> Items;
+    };
+
+    // BuildRenderItems as of this commit, with depths along the camera's look direction
+    // from its start position (0, 2, -15).
+    SimScene BuildSampleScene()
+    {
+        enum { Brick, Tile, Fence, Skull, Skybox, Mirror, Tree, Soldier };
+        enum { BrickTexture = 1, TileTexture, FenceTexture, TreeTexture };
+        enum { GridMesh, BoxMesh, SkullMesh, CylinderMesh, SphereMesh, TreeMesh, SoldierMesh };
+        const uint32_t TriangleList = 4;
+        const uint32_t PointList = 1;
+
+        SimScene Scene;
+        Scene.Name = "sample scene";
+        uint32_t Object = 0;
+
+        auto Add = [&](uint32_t pass, uint32_t material, uint32_t texture, uint32_t geometry, uint32_t topology, float z)
+        {
+            Scene.Items.push_back({ pass, Object++, material, texture, geometry, topology, 0, z + 15.0f });
+        };
+
+        Add(OpaquePass, Tile, TileTexture, GridMesh, TriangleList, 0.0f);
+        Add(AlphaTestedPass, Fence, FenceTexture, BoxMesh, TriangleList, 0.0f);
+        Add(OpaquePass, Skull, 0, SkullMesh, TriangleList, 0.0f);
+
+        for (int i = 0; i < 5; ++i)
+        {
+            const float Z = -10.0f + i * 5.0f;
+            Add(OpaquePass, Brick, BrickTexture, CylinderMesh, TriangleList, Z);
+            Add(OpaquePass, Brick, BrickTexture, CylinderMesh, TriangleList, Z);
+            Add(OpaquePass, Mirror, 0, SphereMesh, TriangleList, Z);
+            Add(OpaquePass, Mirror, 0, SphereMesh, TriangleList, Z);
+        }
+
+        Add(SkyboxPass, Skybox, 0, BoxMesh, TriangleList, 0.0f);
+        Add(TreePass, Tree, TreeTexture, TreeMesh, PointList, 0.0f);
+
+        for (uint32_t i = 0; i < 5; ++i)
+        {
+            Add(SkinnedOpaquePass, Soldier + i, 0, SoldierMesh + i, TriangleList, -5.0f);
+        }
+
+        return Scene;
+    }
+
+    // Many objects sharing a smaller set of materials, textures and meshes, in random
+    // order: 80% opaque, 10% alpha tested, 10% transparent.
+    SimScene BuildSyntheticScene(const DrawSortOptions& options)
+    {
+        std::mt19937 Random(options.Seed);
+
+        std::vector<uint32_t> MaterialTextures(options.Materials);
+        for (uint32_t& Texture : MaterialTextures)
+        {
+            Texture = Random() % 8 == 0 ? 0 : 1 + Random() % options.Textures;
+        }
+
+        SimScene Scene;
+        Scene.Name = "synthetic scene";
+
+        for (uint32_t i = 0; i < options.Items; ++i)
+        {
+            const uint32_t Roll = Random() % 10;
+            SimItem Item;
+            Item.Pass = Roll == 0 ? AlphaTestedPass : Roll == 1 ? TransparentPass : OpaquePass;
+            Item.Object = i;
+            Item.Material = Random() % options.Materials;
+            Item.Texture = MaterialTextures[Item.Material];
+            Item.Geometry = Random() % options.Geometries;
+            Item.Topology = 4;
+            Item.Skinned = 0;
+            Item.Depth = std::uniform_real_distribution<float>(0.0f, Scene.FarZ)(Random);
+            Scene.Items.push_back(Item);
+        }
+
+        return Scene;
+    }
+
+    std::vector<DrawSortEntry> MakeEntries(const SimScene& scene)
+    {
+        std::vector<DrawSortEntry> Entries;
+        Entries.reserve(scene.Items.size());
+
+        for (uint32_t i = 0; i < (uint32_t)scene.Items.size(); ++i)
+        {
+            const SimItem& Item = scene.Items[i];
+            DrawSortEntry Entry;
+            Entry.Key = DrawSortKey::Make(Item.Pass, Item.Pass, Item.Texture, Item.Material, Item.Geometry,
+                DrawSortKey::QuantizeDepth(Item.Depth, scene.FarZ), Item.Pass == TransparentPass);
+            Entry.Index = i;
+            Entries.push_back(Entry);
+        }
+
+        return Entries;
+    }
+
+    enum class BindMode
+    {
+        // Every binding for every item.
+        Naive,
+
+        // The renderer before sort keys: only the texture table was skipped when it
+        // repeated.
+        TextureSkipOnly,
+
+        // Every binding goes through DrawStateTracker.
+        Tracked,
+    };
+
+    // Counts the calls RenderGeometry makes for one layer's items in the given order; a
+    // fresh tracker per layer, as in the renderer.
+    uint32_t CountLayerCalls(const SimScene& scene, const std::vector<uint32_t>& order, BindMode mode)
+    {
+        DrawStateTracker Tracker;
+        uint32_t Calls = 0;
+        uint32_t BoundTexture = ~0u;
+
+        auto Bind = [&](DrawState state, uint64_t value)
+        {
+            if (mode != BindMode::Tracked || Tracker.Set(state, value))
+                ++Calls;
+        };
+
+        for (uint32_t Index : order)
+        {
+            const SimItem& Item = scene.Items[Index];
+
+            Bind(DrawState::ObjectCB, Item.Object);
+            Bind(DrawState::MaterialCB, Item.Material);
+
+            if (Item.Texture != 0)
+            {
+                if (mode == BindMode::TextureSkipOnly)
+                {
+                    if (Item.Texture != BoundTexture)
+                        ++Calls;
+                    BoundTexture = Item.Texture;
+                }
+                else
+                    Bind(DrawState::TextureTable, Item.Texture);
+            }
+
+            Bind(DrawState::SkinnedCB, Item.Skinned);
+            Bind(DrawState::VertexBuffer, Item.Geometry);
+            Bind(DrawState::IndexBuffer, Item.Geometry);
+            Bind(DrawState::Topology, Item.Topology);
+
+            // DrawIndexedInstanced
+            ++Calls;
+        }
+
+        return Calls;
+    }
+
+    // Main pass plus the shadow pass over the opaque layer.
+    uint32_t CountFrameCalls(const SimScene& scene, const std::vector<uint32_t>& order, BindMode mode)
+    {
+        std::vector<uint32_t> Layers[PassCount];
+        for (uint32_t Index : order)
+        {
+            Layers[scene.Items[Index].Pass].push_back(Index);
+        }
+
+        uint32_t Calls = 0;
+        for (uint32_t Pass = 0; Pass < PassCount; ++Pass)
+        {
+            Calls += CountLayerCalls(scene, Layers[Pass], mode);
+        }
+
+        return Calls + CountLayerCalls(scene, Layers[OpaquePass], mode);
+    }
+
+    // Transparent items must come out back to front, other items front to back among items
+    // with the same state.
+    bool CheckOrder(const SimScene& scene, const std::vector<uint32_t>& order)
+    {
+        for (size_t i = 1; i < order.size(); ++i)
+        {
+            const SimItem& Previous = scene.Items[order[i - 1]];
+            const SimItem& Item = scene.Items[order[i]];
+
+            if (Item.Pass < Previous.Pass)
+                return false;
+            if (Item.Pass != Previous.Pass)
+                continue;
+
+            const uint32_t PreviousDepth = DrawSortKey::QuantizeDepth(Previous.Depth, scene.FarZ);
+            const uint32_t Depth = DrawSortKey::QuantizeDepth(Item.Depth, scene.FarZ);
+
+            if (Item.Pass == TransparentPass)
+            {
+                if (Depth > PreviousDepth)
+                    return false;
+            }
+            else if (Item.Texture == Previous.Texture && Item.Material == Previous.Material &&
+                Item.Geometry == Previous.Geometry && Depth < PreviousDepth)
+                return false;
+        }
+
+        return true;
+    }
+
+    template<typename F>
+    double BestMilliseconds(uint32_t repeats, F&& func)
+    {
+        typedef std::chrono::high_resolution_clock Clock;
+
+        double Best = 1e30;
+        for (uint32_t i = 0; i < repeats; ++i)
+        {
+            const Clock::time_point Start = Clock::now();
+            func();
+            Best = (std::min)(Best, std::chrono::duration<double, std::milli>(Clock::now() - Start).count());
+        }
+        return Best;
+    }
+
+    bool RunScene(const SimScene& scene)
+    {
+        const std::vector<DrawSortEntry> Unsorted = MakeEntries(scene);
+
+        std::vector<DrawSortEntry> Sorted = Unsorted;
+        std::vector<DrawSortEntry> Scratch;
+        RadixSortDraws(Sorted, Scratch);
+
+        // The radix sort has to agree with a stable comparison sort exactly.
+        std::vector<DrawSortEntry> Reference = Unsorted;
+        std::stable_sort(Reference.begin(), Reference.end(),
+            [](const DrawSortEntry& a, const DrawSortEntry& b) { return a.Key < b.Key; });
+
+        bool bSame = true;
+        for (size_t i = 0; i < Sorted.size(); ++i)
+        {
+            bSame = bSame && Sorted[i].Key == Reference[i].Key && Sorted[i].Index == Reference[i].Index;
+        }
+
+        std::vector<uint32_t> InsertionOrder(scene.Items.size());
+        std::vector<uint32_t> SortedOrder(scene.Items.size());
+        for (uint32_t i = 0; i < (uint32_t)scene.Items.size(); ++i)
+        {
+            InsertionOrder[i] = i;
+            SortedOrder[i] = Sorted[i].Index;
+        }
+
+        const bool bOrdered = CheckOrder(scene, SortedOrder);
+
+        const uint32_t Naive = CountFrameCalls(scene, InsertionOrder, BindMode::Naive);
+        const uint32_t Before = CountFrameCalls(scene, InsertionOrder, BindMode::TextureSkipOnly);
+        const uint32_t TrackedOnly = CountFrameCalls(scene, InsertionOrder, BindMode::Tracked);
+        const uint32_t After = CountFrameCalls(scene, SortedOrder, BindMode::Tracked);
+
+        const uint32_t Repeats = scene.Items.size() < 1000 ? 2000 : 50;
+        std::vector<DrawSortEntry> Work;
+        const double RadixTime = BestMilliseconds(Repeats, [&]() { Work = Unsorted; RadixSortDraws(Work, Scratch); });
+        const double StdSortTime = BestMilliseconds(Repeats, [&]()
+        {
+            Work = Unsorted;
+            std::sort(Work.begin(), Work.end(), [](const DrawSortEntry& a, const DrawSortEntry& b) { return a.Key < b.Key; });
+        });
+
+        auto Percent = [&](uint32_t calls) { return Naive > 0 ? 100.0 * calls / Naive : 0.0; };
+
+        printf("%s: %zu items\n", scene.Name, scene.Items.size());
+        printf("  api calls per frame (main + shadow pass, bindings + draws)\n");
+        printf("    every binding             : %8u\n", Naive);
+        printf("    before (texture skip only): %8u  (%5.1f%%)\n", Before, Percent(Before));
+        printf("    state tracker, unsorted   : %8u  (%5.1f%%)\n", TrackedOnly, Percent(TrackedOnly));
+        printf("    sort keys + state tracker : %8u  (%5.1f%%)\n", After, Percent(After));
+        printf("  sort: radix %.4f ms, std::sort %.4f ms\n", RadixTime, StdSortTime);
+        printf("  radix matches stable sort: %s, depth order: %s\n", bSame ? "yes" : "NO", bOrdered ? "ok" : "WRONG");
+
+        return bSame && bOrdered && After <= Before;
+    }
+}
+
+int RunDrawSort(const std::vector<std::string>& args)
+{
+    DrawSortOptions Options;
+    if (!ParseOptions(args, Options))
+    {
+        fprintf(stderr, "usage: TextureTool draw-sort [--items n] [--materials n] [--textures n] [--geometries n] [--seed n]\n");
+        return 1;
+    }
+
+    bool bOk = RunScene(BuildSampleScene());
+    bOk = RunScene(BuildSyntheticScene(Options)) && bOk;
+
+    printf(bOk ? "ok\n" : "FAILED\n");
+    return bOk ? 0 : 1;
+}
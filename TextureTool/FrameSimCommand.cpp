@@ -0,0 +1,263 @@
+#include "Commands.h"
+#include "../Common/FrameResourceRing.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+    typedef std::chrono::steady_clock Clock;
+
+    struct FrameSimOptions
+    {
+        uint32_t Frames = 120;
+        double CpuMilliseconds = 4.0;
+        double GpuMilliseconds = 6.0;
+        double LatencyMilliseconds = 1.0;
+    };
+
+    bool ParseOptions(const std::vector<std::string>& args, FrameSimOptions& options)
+    {
+        for (size_t i = 0; i < args.size(); ++i)
+        {
+            const std::string& Arg = args[i];
+
+            if (Arg == "--frames" && i + 1 < args.size())
+                options.Frames = (uint32_t)(std::max)(atoi(args[++i].c_str()), 1);
+            else if (Arg == "--cpu" && i + 1 < args.size())
+                options.CpuMilliseconds = atof(args[++i].c_str());
+            else if (Arg == "--gpu" && i + 1 < args.size())
+                options.GpuMilliseconds = atof(args[++i].c_str());
+            else if (Arg == "--latency" && i + 1 < args.size())
+                options.LatencyMilliseconds = atof(args[++i].c_str());
+            else
+            {
+                fprintf(stderr, "unknown option '%s'\n", Arg.c_str());
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    void SleepFor(double milliseconds)
+    {
+        std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(milliseconds));
+    }
+
+    // Stands in for ID3D12CommandQueue + ID3D12Fence.  A worker thread plays the GPU: it
+    // starts each submitted frame no earlier than the submit time plus the latency, reads
+    // the frame's slot at the start and at the end of its work, and then completes the
+    // frame's fence value.  A slot that changed while the GPU was reading it means the CPU
+    // overwrote data still in use.
+    class SimulatedGpu
+    {
+    public:
+        SimulatedGpu(const FrameSimOptions& options, const std::vector<std::atomic<uint64_t>>& slots)
+            : m_Options(options)
+            , m_Slots(slots)
+        {
+            m_Thread = std::thread([this]() { Run(); });
+        }
+
+        ~SimulatedGpu()
+        {
+            {
+                std::lock_guard<std::mutex> Lock(m_Mutex);
+                m_bStop = true;
+            }
+            m_Condition.notify_all();
+            m_Thread.join();
+        }
+
+        // Returns the fence value signalled after the frame.
+        uint64_t Submit(uint32_t slot, uint64_t frame)
+        {
+            std::lock_guard<std::mutex> Lock(m_Mutex);
+            m_Queue.push_back({ slot, frame, ++m_LastSignalled, Clock::now() });
+            m_Condition.notify_all();
+            return m_LastSignalled;
+        }
+
+        // Fence interface for FrameResourceRing.
+        uint64_t GetCompletedValue() { return m_Completed.load(); }
+
+        void Wait(uint64_t value)
+        {
+            std::unique_lock<std::mutex> Lock(m_Mutex);
+            m_Condition.wait(Lock, [&]() { return m_Completed.load() >= value; });
+        }
+
+        void WaitIdle()
+        {
+            Wait(m_LastSignalled);
+        }
+
+        uint32_t GetCorruptedFrames()const { return m_Corrupted.load(); }
+
+    private:
+        struct Submission
+        {
+            uint32_t Slot;
+            uint64_t Frame;
+            uint64_t Fence;
+            Clock::time_point SubmitTime;
+        };
+
+        void Run()
+        {
+            for (;;)
+            {
+                Submission Next;
+                {
+                    std::unique_lock<std::mutex> Lock(m_Mutex);
+                    m_Condition.wait(Lock, [this]() { return m_bStop || !m_Queue.empty(); });
+                    if (m_Queue.empty())
+                        return;
+
+                    Next = m_Queue.front();
+                    m_Queue.pop_front();
+                }
+
+                std::this_thread::sleep_until(Next.SubmitTime + std::chrono::duration_cast<Clock::duration>(
+                    std::chrono::duration<double, std::milli>(m_Options.LatencyMilliseconds)));
+
+                const bool bStartOk = m_Slots[Next.Slot].load() == Next.Frame;
+                SleepFor(m_Options.GpuMilliseconds);
+                const bool bEndOk = m_Slots[Next.Slot].load() == Next.Frame;
+
+                if (!bStartOk || !bEndOk)
+                    ++m_Corrupted;
+
+                {
+                    std::lock_guard<std::mutex> Lock(m_Mutex);
+                    m_Completed.store(Next.Fence);
+                }
+                m_Condition.notify_all();
+            }
+        }
+
+    private:
+        const FrameSimOptions& m_Options;
+        const std::vector<std::atomic<uint64_t>>& m_Slots;
+
+        std::mutex m_Mutex;
+        std::condition_variable m_Condition;
+        std::deque<Submission> m_Queue;
+        uint64_t m_LastSignalled = 0;
+        std::atomic<uint64_t> m_Completed{ 0 };
+        std::atomic<uint32_t> m_Corrupted{ 0 };
+        bool m_bStop = false;
+        std::thread m_Thread;
+    };
+
+    enum class SyncMode
+    {
+        // What EndRender used to do: wait for the GPU after every frame.
+        FlushEveryFrame,
+
+        // FrameResourceRing waits only when a slot comes round again.
+        Ring,
+
+        // No waiting at all.  Only there to show that the checker catches overwrites.
+        None,
+    };
+
+    struct FrameSimResult
+    {
+        double FrameMilliseconds = 0.0;
+        uint64_t Stalls = 0;
+        uint32_t Corrupted = 0;
+    };
+
+    FrameSimResult Simulate(const FrameSimOptions& options, SyncMode mode, uint32_t frameCount)
+    {
+        std::vector<std::atomic<uint64_t>> Slots(frameCount);
+        for (std::atomic<uint64_t>& Slot : Slots)
+        {
+            Slot.store(~0ull);
+        }
+
+        FrameResourceRing Ring(frameCount);
+        SimulatedGpu Gpu(options, Slots);
+        uint64_t Stalls = 0;
+
+        const Clock::time_point Start = Clock::now();
+
+        for (uint64_t Frame = 0; Frame < options.Frames; ++Frame)
+        {
+            if (mode == SyncMode::Ring)
+                Ring.WaitForCurrent(Gpu);
+
+            // Update*CB: write this frame's constants into the slot, then the rest of the
+            // CPU frame (culling, recording).
+            const uint32_t Slot = Ring.GetCurrentIndex();
+            Slots[Slot].store(Frame);
+            SleepFor(options.CpuMilliseconds);
+
+            const uint64_t Fence = Gpu.Submit(Slot, Frame);
+            Ring.Advance(Fence);
+
+            if (mode == SyncMode::FlushEveryFrame)
+            {
+                if (Gpu.GetCompletedValue() < Fence)
+                    ++Stalls;
+                Gpu.WaitIdle();
+            }
+        }
+
+        Gpu.WaitIdle();
+
+        FrameSimResult Result;
+        Result.FrameMilliseconds = std::chrono::duration<double, std::milli>(Clock::now() - Start).count() / options.Frames;
+        Result.Stalls = mode == SyncMode::Ring ? Ring.GetStalls() : Stalls;
+        Result.Corrupted = Gpu.GetCorruptedFrames();
+        return Result;
+    }
+}
+
+int RunFrameSim(const std::vector<std::string>& args)
+{
+    FrameSimOptions Options;
+    if (!ParseOptions(args, Options))
+    {
+        fprintf(stderr, "usage: TextureTool frame-sim [--frames n] [--cpu ms] [--gpu ms] [--latency ms]\n");
+        return 1;
+    }
+
+    printf("%u frames, cpu %.1f ms, gpu %.1f ms, queue latency %.1f ms per frame\n",
+        Options.Frames, Options.CpuMilliseconds, Options.GpuMilliseconds, Options.LatencyMilliseconds);
+    printf("  %-22s %10s %10s %10s\n", "mode", "ms/frame", "cpu waits", "corrupted");
+
+    bool bOk = true;
+    auto Report = [&](const char* name, const FrameSimResult& result, bool bExpectCorruption)
+    {
+        printf("  %-22s %10.2f %10llu %10u\n", name, result.FrameMilliseconds,
+            (unsigned long long)result.Stalls, result.Corrupted);
+
+        if ((result.Corrupted != 0) != bExpectCorruption)
+            bOk = false;
+    };
+
+    Report("flush every frame", Simulate(Options, SyncMode::FlushEveryFrame, 1), false);
+
+    for (uint32_t Count = 1; Count <= 4; ++Count)
+    {
+        char Name[32];
+        snprintf(Name, sizeof(Name), "ring, %u frame%s", Count, Count > 1 ? "s" : "");
+        Report(Name, Simulate(Options, SyncMode::Ring, Count), false);
+    }
+
+    // The unsynchronised control only overwrites in-flight data when the CPU outruns the GPU.
+    const bool bCpuAhead = Options.CpuMilliseconds < Options.GpuMilliseconds + Options.LatencyMilliseconds;
+    Report("no waits, 2 frames", Simulate(Options, SyncMode::None, 2), bCpuAhead);
+
+    printf(bOk ? "ok\n" : "FAILED: unexpected overwrite result\n");
+    return bOk ? 0 : 1;
+}
@@ -0,0 +1,381 @@
+#include "Commands.h"
+#include "../Common/HeapBlockPool.h"
+#include "../Common/TLSFAllocator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+namespace
+{
+    const uint64_t KB = 1024;
+    const uint64_t MB = 1024 * 1024;
+
+    // D3D12 placement alignments: small textures, everything else, MSAA targets.
+    const uint64_t SmallAlignment = 4 * KB;
+    const uint64_t DefaultAlignment = 64 * KB;
+    const uint64_t MsaaAlignment = 4 * MB;
+
+    struct HeapSimOptions
+    {
+        uint32_t Operations = 200000;
+        uint64_t HeapSize = 256 * MB;
+        uint64_t BlockSize = 64 * MB;
+        uint64_t DefragBytes = 256 * MB;
+        uint32_t Seed = 1;
+    };
+
+    bool ParseOptions(const std::vector<std::string>& args, HeapSimOptions& options)
+    {
+        for (size_t i = 0; i < args.size(); ++i)
+        {
+            const std::string& Arg = args[i];
+
+            if (Arg == "--ops" && i + 1 < args.size())
+                options.Operations = (uint32_t)(std::max)(atoi(args[++i].c_str()), 1);
+            else if (Arg == "--heap-mb" && i + 1 < args.size())
+                options.HeapSize = (uint64_t)(std::max)(atoi(args[++i].c_str()), 16) * MB;
+            else if (Arg == "--block-mb" && i + 1 < args.size())
+                options.BlockSize = (uint64_t)(std::max)(atoi(args[++i].c_str()), 4) * MB;
+            else if (Arg == "--defrag-mb" && i + 1 < args.size())
+                options.DefragBytes = (uint64_t)(std::max)(atoi(args[++i].c_str()), 0) * MB;
+            else if (Arg == "--seed" && i + 1 < args.size())
+                options.Seed = (uint32_t)atoi(args[++i].c_str());
+            else
+            {
+                fprintf(stderr, "unknown option '%s'\n", Arg.c_str());
+                return false;
+            }
+        }
+        return true;
+    }
+
+    uint64_t AlignUp(uint64_t value, uint64_t alignment)
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+
+    // A resource as GetResourceAllocationInfo would describe it.
+    struct ResourceSize
+    {
+        uint64_t Size;
+        uint64_t Alignment;
+    };
+
+    // Mostly small textures and buffers, some large textures, a few MSAA targets.
+    ResourceSize RandomResource(std::mt19937& random, bool bMsaa)
+    {
+        const uint32_t Kind = random() % 100;
+        if (Kind < 45)
+            return { (1 + random() % 16) * SmallAlignment, SmallAlignment };
+        if (Kind < 90 || !bMsaa)
+            return { (1 + random() % 64) * DefaultAlignment, DefaultAlignment };
+        return { (1 + random() % 4) * MsaaAlignment, MsaaAlignment };
+    }
+
+    // What the resource reserves when created committed.
+    uint64_t CommittedSize(const ResourceSize& resource)
+    {
+        return AlignUp(resource.Size, (std::max)(resource.Alignment, DefaultAlignment));
+    }
+
+    struct LiveBlock
+    {
+        uint32_t Handle;
+        uint64_t Size;
+    };
+
+    // Allocations in offset order must not overlap and must match what the caller holds.
+    bool CheckAllocations(const TLSFAllocator& allocator, size_t liveCount)
+    {
+        uint64_t End = 0;
+        size_t Count = 0;
+        bool bOk = true;
+        allocator.ForEachAllocation([&](uint32_t, uint64_t offset, uint64_t size)
+        {
+            if (offset < End || offset + size > allocator.GetSize())
+                bOk = false;
+            End = offset + size;
+            ++Count;
+        });
+        return bOk && Count == liveCount && allocator.Validate();
+    }
+
+    bool RunAllocatorFuzz(const HeapSimOptions& options)
+    {
+        printf("TLSF: %llu MB heap, %u operations\n", (unsigned long long)(options.HeapSize / MB), options.Operations);
+
+        std::mt19937 Random(options.Seed);
+
+        TLSFAllocator Allocator;
+        Allocator.Reset(options.HeapSize, SmallAlignment);
+
+        std::vector<LiveBlock> Live;
+        uint64_t LiveBytes = 0;
+
+        uint32_t Allocations = 0;
+        uint32_t Failures = 0;
+        uint32_t Misaligned = 0;
+        uint32_t BadChecks = 0;
+        uint32_t MaxFreeBlocks = 0;
+        double WorstFragmentation = 0.0;
+
+        typedef std::chrono::high_resolution_clock Clock;
+        double AllocatorMilliseconds = 0.0;
+
+        for (uint32_t Op = 0; Op < options.Operations; ++Op)
+        {
+            // Drift between filling and draining like RangeSim.
+            const bool bFillPhase = (Op / 20000) % 2 == 0;
+            const bool bAllocate = Live.empty() || (Random() % 100) < (bFillPhase ? 65u : 35u);
+
+            if (bAllocate)
+            {
+                const ResourceSize Resource = RandomResource(Random, true);
+
+                const Clock::time_point Start = Clock::now();
+                const uint32_t Handle = Allocator.Allocate(Resource.Size, Resource.Alignment);
+                AllocatorMilliseconds += std::chrono::duration<double, std::milli>(Clock::now() - Start).count();
+
+                if (Handle == TLSFAllocator::InvalidHandle)
+                {
+                    ++Failures;
+                    continue;
+                }
+
+                ++Allocations;
+                if (Allocator.GetOffset(Handle) % Resource.Alignment != 0 || Allocator.GetAllocationSize(Handle) < Resource.Size)
+                    ++Misaligned;
+
+                Live.push_back({ Handle, Allocator.GetAllocationSize(Handle) });
+                LiveBytes += Allocator.GetAllocationSize(Handle);
+            }
+            else
+            {
+                const size_t Index = Random() % Live.size();
+                const LiveBlock Block = Live[Index];
+                Live[Index] = Live.back();
+                Live.pop_back();
+                LiveBytes -= Block.Size;
+
+                const Clock::time_point Start = Clock::now();
+                Allocator.Free(Block.Handle);
+                AllocatorMilliseconds += std::chrono::duration<double, std::milli>(Clock::now() - Start).count();
+            }
+
+            if (LiveBytes != Allocator.GetUsedBytes())
+                ++BadChecks;
+
+            // The full walk is slow, so only every so often.
+            if (Op % 997 == 0 && !CheckAllocations(Allocator, Live.size()))
+                ++BadChecks;
+
+            MaxFreeBlocks = (std::max)(MaxFreeBlocks, Allocator.GetFreeBlockCount());
+            if (Allocator.GetFreeBytes() > 0)
+                WorstFragmentation = (std::max)(WorstFragmentation, 1.0 - (double)Allocator.GetLargestFreeBlock() / Allocator.GetFreeBytes());
+        }
+
+        for (const LiveBlock& Block : Live)
+        {
+            Allocator.Free(Block.Handle);
+        }
+        const bool bMerged = Allocator.GetFreeBlockCount() == 1 && Allocator.GetLargestFreeBlock() == options.HeapSize && Allocator.Validate();
+
+        printf("  allocations      %u (%u did not fit)\n", Allocations, Failures);
+        printf("  free blocks      %u at most\n", MaxFreeBlocks);
+        printf("  fragmentation    %.1f%% of free space outside the largest block at worst\n", WorstFragmentation * 100.0);
+        printf("  time             %.1f ns per operation\n", AllocatorMilliseconds * 1000000.0 / options.Operations);
+
+        bool bOk = true;
+        if (Misaligned != 0)
+        {
+            printf("    %u allocations misaligned or too small\n", Misaligned);
+            bOk = false;
+        }
+        if (BadChecks != 0)
+        {
+            printf("    %u checks found overlapping blocks or wrong counts\n", BadChecks);
+            bOk = false;
+        }
+        if (!bMerged)
+        {
+            printf("    freeing everything left %u free blocks\n", Allocator.GetFreeBlockCount());
+            bOk = false;
+        }
+        return bOk;
+    }
+
+    bool ValidatePool(const HeapBlockPool& pool)
+    {
+        for (uint32_t i = 0; i < pool.GetBlockCount(); ++i)
+        {
+            if (pool.IsBlockLive(i) && !pool.GetBlock(i).Validate())
+                return false;
+        }
+        return true;
+    }
+
+    bool RunPoolSim(const HeapSimOptions& options)
+    {
+        printf("pool: %llu MB blocks, defragmenting up to %llu MB\n",
+            (unsigned long long)(options.BlockSize / MB), (unsigned long long)(options.DefragBytes / MB));
+
+        std::mt19937 Random(options.Seed + 1);
+
+        HeapBlockPool Pool;
+        Pool.Reset(options.BlockSize, SmallAlignment);
+
+        std::vector<PoolAllocation> Live;
+        uint64_t CommittedBytes = 0;
+        uint64_t PeakCommittedBytes = 0;
+        uint64_t PeakBlockBytes = 0;
+        uint64_t PeakUsedBytes = 0;
+        uint32_t HeapsCreated = 0;
+        uint32_t HeapsReleased = 0;
+        bool bOk = true;
+
+        std::vector<uint64_t> Committed;
+
+        // Load a level's worth of resources, then stream some out and others in.
+        const uint32_t PoolOperations = (std::max)(options.Operations / 20, 2u);
+        for (uint32_t Op = 0; Op < PoolOperations; ++Op)
+        {
+            const bool bAllocate = Live.empty() || (Random() % 100) < (Op < PoolOperations / 2 ? 70u : 45u);
+
+            if (bAllocate)
+            {
+                const ResourceSize Resource = RandomResource(Random, false);
+
+                PoolAllocation Allocation;
+                bool bNewBlock = false;
+                if (!Pool.Allocate(Resource.Size, Resource.Alignment, Allocation, bNewBlock))
+                {
+                    printf("    allocation of %llu KB failed\n", (unsigned long long)(Resource.Size / KB));
+                    bOk = false;
+                    continue;
+                }
+                if (bNewBlock)
+                    ++HeapsCreated;
+
+                Live.push_back(Allocation);
+                Committed.push_back(CommittedSize(Resource));
+                CommittedBytes += Committed.back();
+            }
+            else
+            {
+                const size_t Index = Random() % Live.size();
+                if (Pool.Free(Live[Index]))
+                    HeapsReleased += Pool.ReleaseEmptyBlocks(1, [](uint32_t) {});
+
+                CommittedBytes -= Committed[Index];
+                Live[Index] = Live.back();
+                Live.pop_back();
+                Committed[Index] = Committed.back();
+                Committed.pop_back();
+            }
+
+            PeakCommittedBytes = (std::max)(PeakCommittedBytes, CommittedBytes);
+            const HeapPoolStats Stats = Pool.GetStats();
+            PeakBlockBytes = (std::max)(PeakBlockBytes, Stats.BlockBytes);
+            PeakUsedBytes = (std::max)(PeakUsedBytes, Stats.UsedBytes);
+        }
+
+        // Free a random half so the blocks are left partly used.
+        for (size_t i = 0; i < Live.size();)
+        {
+            if (Random() % 2 == 0)
+            {
+                Pool.Free(Live[i]);
+                Live[i] = Live.back();
+                Live.pop_back();
+            }
+            else
+            {
+                ++i;
+            }
+        }
+        HeapsReleased += Pool.ReleaseEmptyBlocks(0, [](uint32_t) {});
+
+        const HeapPoolStats Before = Pool.GetStats();
+
+        // Apply the plan the way GpuMemoryAllocator's caller would: copy, then free From.
+        std::vector<PoolMove> Moves;
+        typedef std::chrono::high_resolution_clock Clock;
+        const Clock::time_point Start = Clock::now();
+        Pool.PlanDefragmentation(options.DefragBytes, DefaultAlignment, Moves);
+        const double PlanMilliseconds = std::chrono::duration<double, std::milli>(Clock::now() - Start).count();
+
+        uint64_t MovedBytes = 0;
+        for (const PoolMove& Move : Moves)
+        {
+            auto Found = std::find_if(Live.begin(), Live.end(), [&Move](const PoolAllocation& Allocation)
+            {
+                return Allocation.Block == Move.From.Block && Allocation.Handle == Move.From.Handle;
+            });
+            if (Found == Live.end() || Move.To.Block == Move.From.Block || Move.To.Offset % DefaultAlignment != 0)
+            {
+                bOk = false;
+                continue;
+            }
+
+            *Found = Move.To;
+            Pool.Free(Move.From);
+            MovedBytes += Move.From.Size;
+        }
+        const uint32_t Released = Pool.ReleaseEmptyBlocks(0, [](uint32_t) {});
+
+        const HeapPoolStats After = Pool.GetStats();
+
+        uint64_t LiveBytes = 0;
+        for (const PoolAllocation& Allocation : Live)
+        {
+            LiveBytes += Allocation.Size;
+        }
+
+        printf("  heaps            %u created, %u released while streaming\n", HeapsCreated, HeapsReleased);
+        printf("  peak             %llu MB used in %llu MB of heaps, committed resources would reserve %llu MB\n",
+            (unsigned long long)(PeakUsedBytes / MB), (unsigned long long)(PeakBlockBytes / MB), (unsigned long long)(PeakCommittedBytes / MB));
+        printf("  before defrag    %u heaps, %llu/%llu MB used, %u free ranges\n", Before.BlockCount,
+            (unsigned long long)(Before.UsedBytes / MB), (unsigned long long)(Before.BlockBytes / MB), Before.FreeRangeCount);
+        printf("  defrag           %u moves, %llu MB copied, %u heaps released, planned in %.3f ms\n",
+            (uint32_t)Moves.size(), (unsigned long long)(MovedBytes / MB), Released, PlanMilliseconds);
+        printf("  after defrag     %u heaps, %llu/%llu MB used, %u free ranges\n", After.BlockCount,
+            (unsigned long long)(After.UsedBytes / MB), (unsigned long long)(After.BlockBytes / MB), After.FreeRangeCount);
+
+        if (LiveBytes != After.UsedBytes || After.AllocationCount != (uint32_t)Live.size())
+        {
+            printf("    pool holds %llu bytes in %u allocations, expected %llu in %u\n",
+                (unsigned long long)After.UsedBytes, After.AllocationCount, (unsigned long long)LiveBytes, (uint32_t)Live.size());
+            bOk = false;
+        }
+        if (!ValidatePool(Pool))
+        {
+            printf("    a block failed validation\n");
+            bOk = false;
+        }
+        if (!Moves.empty() && After.BlockCount >= Before.BlockCount && Before.BlockCount > 1)
+        {
+            printf("    defragmenting released no heap\n");
+            bOk = false;
+        }
+        return bOk;
+    }
+}
+
+int RunHeapSim(const std::vector<std::string>& args)
+{
+    HeapSimOptions Options;
+    if (!ParseOptions(args, Options))
+    {
+        fprintf(stderr, "usage: TextureTool heap-sim [--ops n] [--heap-mb n] [--block-mb n] [--defrag-mb n] [--seed n]\n");
+        return 1;
+    }
+
+    bool bOk = RunAllocatorFuzz(Options);
+    bOk = RunPoolSim(Options) && bOk;
+
+    printf(bOk ? "ok\n" : "FAILED\n");
+    return bOk ? 0 : 1;
+}
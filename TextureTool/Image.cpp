@@ -0,0 +1,247 @@
+#include "Image.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+void ErrorMetric::Add(const Surface& reference, const Surface& test, uint32_t channelMask)
+{
+    const size_t Count = (std::min)(reference.Pixels.size(), test.Pixels.size());
+
+    for (size_t i = 0; i < Count; ++i)
+    {
+        if ((channelMask & (1u << (i & 3))) == 0)
+            continue;
+
+        const double Diff = (double)reference.Pixels[i] - (double)test.Pixels[i];
+        m_SquaredError += Diff * Diff;
+        ++m_Samples;
+    }
+}
+
+double ErrorMetric::GetPSNR()const
+{
+    const double MSE = GetMSE();
+    if (MSE <= 0.0)
+        return 99.0;
+
+    return 10.0 * std::log10(255.0 * 255.0 / MSE);
+}
+
+namespace
+{
+    float SRGBToLinear(float value)
+    {
+        return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+    }
+
+    struct SRGBTables
+    {
+        float ToLinear[256];
+
+        // Linear value at the midpoint between two adjacent sRGB codes.  Encoding is a search
+        // over these, which rounds exactly in sRGB space without calling pow per texel.
+        float Thresholds[255];
+
+        SRGBTables()
+        {
+            for (int i = 0; i < 256; ++i)
+            {
+                ToLinear[i] = SRGBToLinear(i / 255.0f);
+            }
+
+            for (int i = 0; i < 255; ++i)
+            {
+                Thresholds[i] = SRGBToLinear((i + 0.5f) / 255.0f);
+            }
+        }
+    };
+
+    const SRGBTables& GetSRGBTables()
+    {
+        static const SRGBTables Tables;
+        return Tables;
+    }
+
+    uint8_t EncodeUNorm(float value)
+    {
+        return (uint8_t)((std::min)((std::max)(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+    }
+
+    uint8_t EncodeSRGB(const SRGBTables& tables, float value)
+    {
+        return (uint8_t)(std::upper_bound(tables.Thresholds, tables.Thresholds + 255, value) - tables.Thresholds);
+    }
+
+    uint32_t ReadLE(const uint8_t* bytes, int count)
+    {
+        uint32_t Value = 0;
+        for (int i = count - 1; i >= 0; --i)
+        {
+            Value = (Value << 8) | bytes[i];
+        }
+        return Value;
+    }
+}
+
+void SurfaceToFloat(const Surface& source, bool bSRGB, FloatImage& out)
+{
+    const SRGBTables& Tables = GetSRGBTables();
+
+    out.Resize(source.Width, source.Height, 4);
+    for (size_t i = 0; i < source.Pixels.size(); ++i)
+    {
+        const uint8_t Value = source.Pixels[i];
+        out.Data[i] = (bSRGB && (i & 3) != 3) ? Tables.ToLinear[Value] : Value / 255.0f;
+    }
+}
+
+void FloatToSurface(const FloatImage& source, bool bSRGB, Surface& out)
+{
+    const SRGBTables& Tables = GetSRGBTables();
+
+    out.Resize(source.Width, source.Height);
+    for (size_t i = 0; i < out.Pixels.size(); ++i)
+    {
+        const float Value = source.Data[i];
+        out.Pixels[i] = (bSRGB && (i & 3) != 3) ? EncodeSRGB(Tables, Value) : EncodeUNorm(Value);
+    }
+}
+
+uint16_t FloatToHalf(float value)
+{
+    uint32_t Bits;
+    memcpy(&Bits, &value, sizeof(Bits));
+
+    const uint32_t Sign = (Bits >> 16) & 0x8000;
+    const uint32_t Abs = Bits & 0x7FFFFFFF;
+
+    // NaN stays NaN, overflow goes to infinity.
+    if (Abs > 0x7F800000)
+        return (uint16_t)(Sign | 0x7E00);
+    if (Abs >= 0x477FF000)
+        return (uint16_t)(Sign | 0x7C00);
+
+    // Denormal result: shift the mantissa (with its implicit bit) into place and round.
+    if (Abs < 0x38800000)
+    {
+        const int Shift = 126 - (int)(Abs >> 23);
+        if (Shift > 24)
+            return (uint16_t)Sign;
+
+        const uint32_t Mantissa = (Abs & 0x007FFFFF) | 0x00800000;
+        const uint32_t Half = Mantissa >> Shift;
+        const uint32_t Rest = Mantissa & ((1u << Shift) - 1);
+        const uint32_t Midpoint = 1u << (Shift - 1);
+        const uint32_t RoundUp = (Rest > Midpoint || (Rest == Midpoint && (Half & 1))) ? 1 : 0;
+        return (uint16_t)(Sign | (Half + RoundUp));
+    }
+
+    // Rebias the exponent and round the mantissa to nearest even; a carry into the
+    // exponent is the correct result.
+    const uint32_t Rebiased = Abs - 0x38000000;
+    const uint32_t RoundUp = 0x0FFF + ((Rebiased >> 13) & 1);
+    return (uint16_t)(Sign | ((Rebiased + RoundUp) >> 13));
+}
+
+float HalfToFloat(uint16_t value)
+{
+    const uint32_t Sign = (uint32_t)(value & 0x8000) << 16;
+    uint32_t Exponent = (value >> 10) & 0x1F;
+    uint32_t Mantissa = value & 0x03FF;
+
+    uint32_t Bits;
+    if (Exponent == 0x1F)
+    {
+        Bits = Sign | 0x7F800000 | (Mantissa << 13);
+    }
+    else if (Exponent != 0)
+    {
+        Bits = Sign | ((Exponent + 112) << 23) | (Mantissa << 13);
+    }
+    else if (Mantissa != 0)
+    {
+        // Normalize the denormal.
+        Exponent = 113;
+        while ((Mantissa & 0x0400) == 0)
+        {
+            Mantissa <<= 1;
+            --Exponent;
+        }
+        Bits = Sign | (Exponent << 23) | ((Mantissa & 0x03FF) << 13);
+    }
+    else
+    {
+        Bits = Sign;
+    }
+
+    float Result;
+    memcpy(&Result, &Bits, sizeof(Result));
+    return Result;
+}
+
+bool LoadBitmapFile(const std::string& fileName, Surface& out, std::string& error)
+{
+    FILE* Input = fopen(fileName.c_str(), "rb");
+    if (Input == nullptr)
+    {
+        error = "cannot open file";
+        return false;
+    }
+
+    std::vector<uint8_t> Bytes;
+    uint8_t Buffer[65536];
+    for (size_t Read; (Read = fread(Buffer, 1, sizeof(Buffer), Input)) > 0;)
+    {
+        Bytes.insert(Bytes.end(), Buffer, Buffer + Read);
+    }
+    fclose(Input);
+
+    // BITMAPFILEHEADER (14 bytes) followed by at least a BITMAPINFOHEADER (40 bytes).
+    if (Bytes.size() < 54 || Bytes[0] != 'B' || Bytes[1] != 'M')
+    {
+        error = "not a bitmap file";
+        return false;
+    }
+
+    const uint32_t DataOffset = ReadLE(&Bytes[10], 4);
+    const int32_t Width = (int32_t)ReadLE(&Bytes[18], 4);
+    const int32_t Height = (int32_t)ReadLE(&Bytes[22], 4);
+    const uint32_t BitCount = ReadLE(&Bytes[28], 2);
+    const uint32_t Compression = ReadLE(&Bytes[30], 4);
+
+    // BI_RGB, or BI_BITFIELDS with the usual BGRA masks.
+    if ((BitCount != 24 && BitCount != 32) || (Compression != 0 && Compression != 3) || Width <= 0 || Height == 0)
+    {
+        error = "only uncompressed 24 and 32 bit bitmaps are supported";
+        return false;
+    }
+
+    const bool bBottomUp = Height > 0;
+    const uint32_t Rows = (uint32_t)(bBottomUp ? Height : -Height);
+    const uint32_t BytesPerPixel = BitCount / 8;
+    const size_t Pitch = ((size_t)Width * BytesPerPixel + 3) & ~(size_t)3;
+
+    if (DataOffset > Bytes.size() || Bytes.size() - DataOffset < Pitch * Rows)
+    {
+        error = "bitmap data is truncated";
+        return false;
+    }
+
+    out.Resize((uint32_t)Width, Rows);
+    for (uint32_t y = 0; y < Rows; ++y)
+    {
+        const uint8_t* Src = &Bytes[DataOffset + Pitch * (bBottomUp ? Rows - 1 - y : y)];
+        for (uint32_t x = 0; x < (uint32_t)Width; ++x, Src += BytesPerPixel)
+        {
+            uint8_t* Dst = out.Texel(x, y);
+            Dst[0] = Src[2];
+            Dst[1] = Src[1];
+            Dst[2] = Src[0];
+            Dst[3] = BytesPerPixel == 4 ? Src[3] : 255;
+        }
+    }
+
+    return true;
+}
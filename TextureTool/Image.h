@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// One RGBA8 mip level, rows tightly packed.
+struct Surface
+{
+    uint32_t Width = 0;
+    uint32_t Height = 0;
+    std::vector<uint8_t> Pixels;
+
+    void Resize(uint32_t width, uint32_t height)
+    {
+        Width = width;
+        Height = height;
+        Pixels.assign((size_t)width * height * 4, 0);
+    }
+
+    uint8_t* Texel(uint32_t x, uint32_t y) { return &Pixels[((size_t)y * Width + x) * 4]; }
+    const uint8_t* Texel(uint32_t x, uint32_t y)const { return &Pixels[((size_t)y * Width + x) * 4]; }
+};
+
+// One mip level in float, either four interleaved channels or one.  Rows tightly packed.
+struct FloatImage
+{
+    uint32_t Width = 0;
+    uint32_t Height = 0;
+    uint32_t Channels = 4;
+    std::vector<float> Data;
+
+    void Resize(uint32_t width, uint32_t height, uint32_t channels)
+    {
+        Width = width;
+        Height = height;
+        Channels = channels;
+        Data.assign((size_t)width * height * channels, 0.0f);
+    }
+
+    float* Row(uint32_t y) { return &Data[(size_t)y * Width * Channels]; }
+    const float* Row(uint32_t y)const { return &Data[(size_t)y * Width * Channels]; }
+};
+
+// Sums squared error over many surface pairs so a whole mip chain gets one PSNR.
+class ErrorMetric
+{
+public:
+    // channelMask: bit 0 = R ... bit 3 = A.
+    void Add(const Surface& reference, const Surface& test, uint32_t channelMask);
+
+    double GetMSE()const { return m_Samples ? m_SquaredError / (double)m_Samples : 0.0; }
+
+    // Peak signal to noise ratio in dB against 255.  Identical images report 99 dB.
+    double GetPSNR()const;
+
+private:
+    double m_SquaredError = 0.0;
+    uint64_t m_Samples = 0;
+};
+
+// RGBA8 <-> float.  With bSRGB the colour channels are converted to and from linear light;
+// alpha is always linear.  FloatToSurface clamps to [0, 1] and rounds.
+void SurfaceToFloat(const Surface& source, bool bSRGB, FloatImage& out);
+void FloatToSurface(const FloatImage& source, bool bSRGB, Surface& out);
+
+// IEEE half precision, round to nearest even.
+uint16_t FloatToHalf(float value);
+float HalfToFloat(uint16_t value);
+
+// Reads an uncompressed 24 or 32 bit Windows bitmap.  24 bit files get opaque alpha.
+bool LoadBitmapFile(const std::string& fileName, Surface& out, std::string& error);
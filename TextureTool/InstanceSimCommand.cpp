@@ -0,0 +1,414 @@
+#include "Commands.h"
+#include "../Common/DrawSort.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+namespace
+{
+    struct InstanceSimOptions
+    {
+        uint32_t Items = 50000;
+        uint32_t Meshes = 20;
+        uint32_t Materials = 16;
+        uint32_t Textures = 8;
+        uint32_t Repeats = 20;
+        uint32_t Seed = 1;
+    };
+
+    bool ParseOptions(const std::vector<std::string>& args, InstanceSimOptions& options)
+    {
+        for (size_t i = 0; i < args.size(); ++i)
+        {
+            const std::string& Arg = args[i];
+
+            if (Arg == "--items" && i + 1 < args.size())
+                options.Items = (uint32_t)(std::max)(atoi(args[++i].c_str()), 1);
+            else if (Arg == "--meshes" && i + 1 < args.size())
+                options.Meshes = (uint32_t)(std::max)(atoi(args[++i].c_str()), 1);
+            else if (Arg == "--materials" && i + 1 < args.size())
+                options.Materials = (uint32_t)(std::max)(atoi(args[++i].c_str()), 1);
+            else if (Arg == "--textures" && i + 1 < args.size())
+                options.Textures = (uint32_t)(std::max)(atoi(args[++i].c_str()), 1);
+            else if (Arg == "--repeats" && i + 1 < args.size())
+                options.Repeats = (uint32_t)(std::max)(atoi(args[++i].c_str()), 1);
+            else if (Arg == "--seed" && i + 1 < args.size())
+                options.Seed = (uint32_t)atoi(args[++i].c_str());
+            else
+            {
+                fprintf(stderr, "unknown option '%s'\n", Arg.c_str());
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    // The main pass layers that matter here, in the sample's order.
+    enum Pass : uint32_t
+    {
+        OpaquePass,
+        AlphaTestedPass,
+        TransparentPass,
+        PassCount
+    };
+
+    // What RenderGeometry and RenderBatches look at for one RenderItem.
+    struct SimItem
+    {
+        uint32_t Pass;
+        uint32_t Material;
+        uint32_t Texture;       // 0 : no texture, else heap index + 1
+        uint32_t Mesh;
+        float Depth;
+        float World[16];
+        float TextureTransform[16];
+    };
+
+    // 80% opaque, 10% alpha tested, 10% transparent, meshes and materials picked at random,
+    // scattered in a 400 unit square in front of the camera.
+    std::vector<SimItem> BuildScene(const InstanceSimOptions& options)
+    {
+        std::mt19937 Random(options.Seed);
+        std::uniform_real_distribution<float> Unit(0.0f, 1.0f);
+
+        std::vector<uint32_t> MaterialTextures(options.Materials);
+        for (uint32_t& Texture : MaterialTextures)
+        {
+            Texture = Random() % 8 == 0 ? 0 : 1 + Random() % options.Textures;
+        }
+
+        std::vector<SimItem> Items(options.Items);
+        for (SimItem& Item : Items)
+        {
+            const uint32_t Roll = Random() % 10;
+            Item.Pass = Roll == 0 ? AlphaTestedPass : Roll == 1 ? TransparentPass : OpaquePass;
+            Item.Material = Random() % options.Materials;
+            Item.Texture = MaterialTextures[Item.Material];
+            Item.Mesh = Random() % options.Meshes;
+            Item.Depth = Unit(Random) * 400.0f;
+
+            const float Scale = 0.5f + Unit(Random);
+            for (int i = 0; i < 16; ++i)
+            {
+                Item.World[i] = (i % 5 == 0) ? Scale : 0.0f;
+                Item.TextureTransform[i] = (i % 5 == 0) ? 1.0f : 0.0f;
+            }
+            Item.World[12] = (Unit(Random) - 0.5f) * 400.0f;
+            Item.World[13] = 0.0f;
+            Item.World[14] = Item.Depth;
+            Item.World[15] = 1.0f;
+        }
+
+        return Items;
+    }
+
+    // Sorted layers as SortRenderItems leaves them.
+    void SortScene(const std::vector<SimItem>& items, std::vector<uint32_t> (&layers)[PassCount])
+    {
+        std::vector<DrawSortEntry> Entries;
+        std::vector<DrawSortEntry> Scratch;
+        for (uint32_t i = 0; i < (uint32_t)items.size(); ++i)
+        {
+            const SimItem& Item = items[i];
+            DrawSortEntry Entry;
+            Entry.Key = DrawSortKey::Make(Item.Pass, Item.Pass, Item.Texture, Item.Material, Item.Mesh,
+                DrawSortKey::QuantizeDepth(Item.Depth, 1000.0f), Item.Pass == TransparentPass);
+            Entry.Index = i;
+            Entries.push_back(Entry);
+        }
+
+        RadixSortDraws(Entries, Scratch);
+
+        for (const DrawSortEntry& Entry : Entries)
+        {
+            layers[items[Entry.Index].Pass].push_back(Entry.Index);
+        }
+    }
+
+    // Stands in for the command list: one packet per API call.
+    struct MockCommandList
+    {
+        std::vector<uint64_t> Packets;
+        uint32_t Draws = 0;
+
+        void Call(uint32_t op, uint64_t value) { Packets.push_back(((uint64_t)op << 56) ^ value); }
+        void Draw(uint32_t indexCount, uint32_t instanceCount)
+        {
+            Call(15, ((uint64_t)instanceCount << 32) | indexCount);
+            ++Draws;
+        }
+    };
+
+    const uint32_t MeshIndexCount = 1200;
+
+    // RenderGeometry: object CB, material CB, texture table, skinned CB and the input
+    // assembler per item, through a fresh tracker per layer.
+    void RecordItems(const std::vector<SimItem>& items, const std::vector<uint32_t>& layer, MockCommandList& cmdList)
+    {
+        DrawStateTracker Tracker;
+
+        for (uint32_t Index : layer)
+        {
+            const SimItem& Item = items[Index];
+
+            if (Tracker.Set(DrawState::ObjectCB, Index))
+                cmdList.Call((uint32_t)DrawState::ObjectCB, Index);
+            if (Tracker.Set(DrawState::MaterialCB, Item.Material))
+                cmdList.Call((uint32_t)DrawState::MaterialCB, Item.Material);
+            if (Item.Texture != 0 && Tracker.Set(DrawState::TextureTable, Item.Texture))
+                cmdList.Call((uint32_t)DrawState::TextureTable, Item.Texture);
+            if (Tracker.Set(DrawState::SkinnedCB, 0))
+                cmdList.Call((uint32_t)DrawState::SkinnedCB, 0);
+            if (Tracker.Set(DrawState::VertexBuffer, Item.Mesh))
+                cmdList.Call((uint32_t)DrawState::VertexBuffer, Item.Mesh);
+            if (Tracker.Set(DrawState::IndexBuffer, Item.Mesh))
+                cmdList.Call((uint32_t)DrawState::IndexBuffer, Item.Mesh);
+            if (Tracker.Set(DrawState::Topology, 4))
+                cmdList.Call((uint32_t)DrawState::Topology, 4);
+
+            cmdList.Draw(MeshIndexCount, 1);
+        }
+    }
+
+    struct SimBatch
+    {
+        uint32_t First;         // Index of the batch's first item
+        uint32_t InstanceBase;
+        uint32_t InstanceCount;
+    };
+
+    // InstanceData: both matrices transposed for the shader.
+    struct SimInstance
+    {
+        float World[16];
+        float TextureTransform[16];
+    };
+
+    void StoreTransposed(float* destination, const float* source)
+    {
+        for (int Row = 0; Row < 4; ++Row)
+        {
+            for (int Column = 0; Column < 4; ++Column)
+            {
+                destination[Row * 4 + Column] = source[Column * 4 + Row];
+            }
+        }
+    }
+
+    // BuildInstanceBatches for one layer: runs of equal mesh and material, and their
+    // matrices written to the instance buffer from instanceCount on.
+    void BuildBatches(const std::vector<SimItem>& items, const std::vector<uint32_t>& layer, std::vector<InstanceRun>& runs,
+        std::vector<SimBatch>& batches, SimInstance* instances, uint32_t& instanceCount)
+    {
+        FindInstanceRuns((uint32_t)layer.size(), [&](uint32_t previous, uint32_t current)
+        {
+            const SimItem& Previous = items[layer[previous]];
+            const SimItem& Current = items[layer[current]];
+            return Previous.Mesh == Current.Mesh && Previous.Material == Current.Material;
+        }, runs);
+
+        for (const InstanceRun& Run : runs)
+        {
+            batches.push_back({ layer[Run.First], instanceCount, Run.Count });
+
+            for (uint32_t i = Run.First; i < Run.First + Run.Count; ++i)
+            {
+                const SimItem& Item = items[layer[i]];
+                SimInstance& Instance = instances[instanceCount++];
+                StoreTransposed(Instance.World, Item.World);
+                StoreTransposed(Instance.TextureTransform, Item.TextureTransform);
+            }
+        }
+    }
+
+    // RenderBatches: the instance SRV every batch, then material, textures and the input
+    // assembler through the tracker.
+    void RecordBatches(const std::vector<SimItem>& items, const std::vector<SimBatch>& batches, MockCommandList& cmdList)
+    {
+        DrawStateTracker Tracker;
+
+        for (const SimBatch& Batch : batches)
+        {
+            const SimItem& Item = items[Batch.First];
+
+            cmdList.Call(14, Batch.InstanceBase);
+            if (Tracker.Set(DrawState::MaterialCB, Item.Material))
+                cmdList.Call((uint32_t)DrawState::MaterialCB, Item.Material);
+            if (Item.Texture != 0 && Tracker.Set(DrawState::TextureTable, Item.Texture))
+                cmdList.Call((uint32_t)DrawState::TextureTable, Item.Texture);
+            if (Tracker.Set(DrawState::VertexBuffer, Item.Mesh))
+                cmdList.Call((uint32_t)DrawState::VertexBuffer, Item.Mesh);
+            if (Tracker.Set(DrawState::IndexBuffer, Item.Mesh))
+                cmdList.Call((uint32_t)DrawState::IndexBuffer, Item.Mesh);
+            if (Tracker.Set(DrawState::Topology, 4))
+                cmdList.Call((uint32_t)DrawState::Topology, 4);
+
+            cmdList.Draw(MeshIndexCount, Batch.InstanceCount);
+        }
+    }
+
+    struct FrameWork
+    {
+        std::vector<InstanceRun> Runs;
+        std::vector<SimBatch> Batches[PassCount];
+        std::vector<SimBatch> ShadowBatches[PassCount];
+        // Room for every item in both passes, like the sample's per-frame slot.
+        std::vector<SimInstance> Instances;
+        uint32_t InstanceCount = 0;
+        MockCommandList CommandList;
+    };
+
+    bool IsInstancedPass(uint32_t pass)
+    {
+        return pass == OpaquePass || pass == AlphaTestedPass;
+    }
+
+    // BuildInstanceBatches for the main and shadow pass.
+    void PrepareBatches(const std::vector<SimItem>& items, const std::vector<uint32_t> (&layers)[PassCount], FrameWork& work)
+    {
+        work.Instances.resize(items.size() * 2);
+        work.InstanceCount = 0;
+
+        for (uint32_t Pass = 0; Pass < PassCount; ++Pass)
+        {
+            work.Batches[Pass].clear();
+            work.ShadowBatches[Pass].clear();
+            if (IsInstancedPass(Pass))
+            {
+                BuildBatches(items, layers[Pass], work.Runs, work.Batches[Pass], work.Instances.data(), work.InstanceCount);
+                BuildBatches(items, layers[Pass], work.Runs, work.ShadowBatches[Pass], work.Instances.data(), work.InstanceCount);
+            }
+        }
+    }
+
+    // The main pass over every layer and the shadow pass over opaque and alpha tested
+    // casters, per item or with the prepared batches where the sample uses them.
+    void RecordFrame(const std::vector<SimItem>& items, const std::vector<uint32_t> (&layers)[PassCount],
+        bool bInstancing, FrameWork& work)
+    {
+        work.CommandList.Packets.clear();
+        work.CommandList.Draws = 0;
+
+        for (uint32_t Pass = 0; Pass < PassCount; ++Pass)
+        {
+            if (bInstancing && IsInstancedPass(Pass))
+                RecordBatches(items, work.Batches[Pass], work.CommandList);
+            else
+                RecordItems(items, layers[Pass], work.CommandList);
+        }
+
+        for (uint32_t Pass = 0; Pass < PassCount; ++Pass)
+        {
+            if (!IsInstancedPass(Pass))
+                continue;
+
+            if (bInstancing)
+                RecordBatches(items, work.ShadowBatches[Pass], work.CommandList);
+            else
+                RecordItems(items, layers[Pass], work.CommandList);
+        }
+    }
+
+    // Every item of an instanced layer lands in exactly one batch of that layer, every
+    // batch has one mesh and material, and each instance carries its own item's matrices.
+    bool CheckBatches(const std::vector<SimItem>& items, const std::vector<uint32_t> (&layers)[PassCount], const FrameWork& work)
+    {
+        for (uint32_t Pass = 0; Pass < PassCount; ++Pass)
+        {
+            if (!IsInstancedPass(Pass))
+                continue;
+
+            const std::vector<SimBatch>* Lists[] = { &work.Batches[Pass], &work.ShadowBatches[Pass] };
+            for (const std::vector<SimBatch>* Batches : Lists)
+            {
+                size_t Position = 0;
+                for (const SimBatch& Batch : *Batches)
+                {
+                    const SimItem& First = items[Batch.First];
+                    for (uint32_t i = 0; i < Batch.InstanceCount; ++i, ++Position)
+                    {
+                        if (Position >= layers[Pass].size())
+                            return false;
+
+                        const SimItem& Item = items[layers[Pass][Position]];
+                        if (Item.Mesh != First.Mesh || Item.Material != First.Material)
+                            return false;
+
+                        const SimInstance& Instance = work.Instances[Batch.InstanceBase + i];
+                        if (Instance.World[3] != Item.World[12] || Instance.World[11] != Item.World[14] || Instance.World[0] != Item.World[0])
+                            return false;
+                    }
+                }
+
+                if (Position != layers[Pass].size())
+                    return false;
+            }
+        }
+
+        return true;
+    }
+
+    template<typename F>
+    double BestMilliseconds(uint32_t repeats, F&& func)
+    {
+        typedef std::chrono::high_resolution_clock Clock;
+
+        double Best = 1e30;
+        for (uint32_t i = 0; i < repeats; ++i)
+        {
+            const Clock::time_point Start = Clock::now();
+            func();
+            Best = (std::min)(Best, std::chrono::duration<double, std::milli>(Clock::now() - Start).count());
+        }
+        return Best;
+    }
+}
+
+int RunInstanceSim(const std::vector<std::string>& args)
+{
+    InstanceSimOptions Options;
+    if (!ParseOptions(args, Options))
+    {
+        fprintf(stderr, "usage: TextureTool instance-sim [--items n] [--meshes n] [--materials n] [--textures n] [--repeats n] [--seed n]\n");
+        return 1;
+    }
+
+    const std::vector<SimItem> Items = BuildScene(Options);
+
+    std::vector<uint32_t> Layers[PassCount];
+    SortScene(Items, Layers);
+
+    FrameWork PerItem;
+    FrameWork Instanced;
+    PrepareBatches(Items, Layers, Instanced);
+    RecordFrame(Items, Layers, false, PerItem);
+    RecordFrame(Items, Layers, true, Instanced);
+
+    const bool bValid = CheckBatches(Items, Layers, Instanced);
+
+    const double PerItemTime = BestMilliseconds(Options.Repeats, [&]() { RecordFrame(Items, Layers, false, PerItem); });
+    const double BatchTime = BestMilliseconds(Options.Repeats, [&]() { PrepareBatches(Items, Layers, Instanced); });
+    const double InstancedTime = BestMilliseconds(Options.Repeats, [&]() { RecordFrame(Items, Layers, true, Instanced); });
+
+    const uint32_t PerItemCalls = (uint32_t)PerItem.CommandList.Packets.size();
+    const uint32_t InstancedCalls = (uint32_t)Instanced.CommandList.Packets.size();
+
+    printf("%u items, %u meshes, %u materials (main pass + opaque and alpha tested shadow casters)\n",
+        Options.Items, Options.Meshes, Options.Materials);
+    printf("  %-10s %9s %9s %10s %10s %12s\n", "", "draws", "bindings", "batch ms", "record ms", "instance KB");
+    printf("  %-10s %9u %9u %10s %10.4f %12s\n", "per item", PerItem.CommandList.Draws,
+        PerItemCalls - PerItem.CommandList.Draws, "-", PerItemTime, "-");
+    printf("  %-10s %9u %9u %10.4f %10.4f %12zu\n", "instanced", Instanced.CommandList.Draws,
+        InstancedCalls - Instanced.CommandList.Draws, BatchTime, InstancedTime, (size_t)Instanced.InstanceCount * sizeof(SimInstance) / 1024);
+    printf("  api calls %.1f%% of per item; the mock list has no driver cost, so record ms only covers the\n"
+        "  application side and batch ms is the price paid for the calls saved\n",
+        100.0 * InstancedCalls / PerItemCalls);
+    printf("  batches cover every item once with one mesh and material each: %s\n", bValid ? "yes" : "NO");
+
+    const bool bOk = bValid && Instanced.CommandList.Draws <= PerItem.CommandList.Draws;
+    printf(bOk ? "ok\n" : "FAILED\n");
+    return bOk ? 0 : 1;
+}
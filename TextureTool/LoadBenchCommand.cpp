@@ -0,0 +1,291 @@
+#include "Commands.h"
+#include "../Common/DDSHeader.h"
+#include "../Common/MappedFile.h"
+#include "../Common/ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+
+namespace
+{
+    struct LoadBenchOptions
+    {
+        uint32_t Runs = 50;
+        size_t Threads = 0;
+        std::vector<std::string> Inputs;
+    };
+
+    bool ParseOptions(const std::vector<std::string>& args, LoadBenchOptions& options)
+    {
+        for (size_t i = 0; i < args.size(); ++i)
+        {
+            const std::string& Arg = args[i];
+
+            if (Arg == "--runs" && i + 1 < args.size())
+                options.Runs = (uint32_t)(std::max)(atoi(args[++i].c_str()), 1);
+            else if (Arg == "-j" && i + 1 < args.size())
+                options.Threads = (size_t)(std::max)(atoi(args[++i].c_str()), 1);
+            else if (!Arg.empty() && Arg[0] == '-')
+            {
+                fprintf(stderr, "unknown option '%s'\n", Arg.c_str());
+                return false;
+            }
+            else
+                options.Inputs.push_back(Arg);
+        }
+
+        return !options.Inputs.empty();
+    }
+
+    void CollectFiles(const std::vector<std::string>& inputs, std::vector<std::string>& outFiles)
+    {
+        namespace fs = std::filesystem;
+
+        for (const std::string& Input : inputs)
+        {
+            std::error_code Error;
+            if (!fs::is_directory(Input, Error))
+            {
+                outFiles.push_back(Input);
+                continue;
+            }
+
+            for (const fs::directory_entry& Entry : fs::directory_iterator(Input, Error))
+            {
+                if (Entry.is_regular_file(Error) && Entry.path().extension() == ".dds")
+                    outFiles.push_back(Entry.path().string());
+            }
+        }
+
+        std::sort(outFiles.begin(), outFiles.end());
+    }
+
+    // D3D12 copy footprint rules: rows padded to 256 bytes, subresources placed on 512
+    // byte boundaries.  Upload heaps are committed in 64 KB pages.
+    const size_t RowPitchAlignment = 256;
+    const size_t PlacementAlignment = 512;
+    const size_t HeapAlignment = 64 * 1024;
+
+    size_t AlignUp(size_t value, size_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    // A texture laid out for upload: where each subresource goes in the staging memory.
+    struct TexturePlan
+    {
+        DDS::FileView View;
+        std::vector<DDS::Subresource> Layout;
+        std::vector<size_t> Offsets;
+        size_t Size = 0;
+    };
+
+    bool PlanTexture(const uint8_t* data, size_t size, TexturePlan& outPlan)
+    {
+        DDS::TextureDesc Desc;
+        if (DDS::ParseHeader(data, size, outPlan.View) != DDS::Status::Ok ||
+            DDS::GetTextureDesc(outPlan.View, Desc) != DDS::Status::Ok ||
+            DDS::GetSubresourceLayout(Desc, outPlan.View.BitSize, outPlan.Layout) != DDS::Status::Ok)
+            return false;
+
+        size_t Offset = 0;
+        outPlan.Offsets.clear();
+        for (const DDS::Subresource& Sub : outPlan.Layout)
+        {
+            Offset = AlignUp(Offset, PlacementAlignment);
+            outPlan.Offsets.push_back(Offset);
+            Offset += AlignUp(Sub.RowPitch, RowPitchAlignment) * Sub.NumRows * (std::max)(Sub.Depth, 1u);
+        }
+        outPlan.Size = Offset;
+        return true;
+    }
+
+    void CopyRows(const TexturePlan& plan, uint8_t* destination)
+    {
+        for (size_t i = 0; i < plan.Layout.size(); ++i)
+        {
+            const DDS::Subresource& Sub = plan.Layout[i];
+            const size_t Pitch = AlignUp(Sub.RowPitch, RowPitchAlignment);
+            const size_t Rows = Sub.NumRows * (std::max)(Sub.Depth, 1u);
+
+            for (size_t Row = 0; Row < Rows; ++Row)
+            {
+                memcpy(destination + plan.Offsets[i] + Pitch * Row, plan.View.BitData + Sub.Offset + Sub.RowPitch * Row, Sub.RowPitch);
+            }
+        }
+    }
+
+    // Heap bytes held by a loader, counted per allocation.
+    struct HeapCounter
+    {
+        size_t Current = 0;
+        size_t Peak = 0;
+
+        void Allocate(size_t bytes)
+        {
+            Current += bytes;
+            Peak = (std::max)(Peak, Current);
+        }
+
+        void Free(size_t bytes) { Current -= bytes; }
+    };
+
+    // What BuildTextures did before TextureBatchLoader: read each file into a new[] copy,
+    // lay it out in its own upload heap (rounded to 64 KB) and keep that heap for the run.
+    bool LoadSerial(const std::vector<std::string>& files, std::vector<std::vector<uint8_t>>& outHeaps, HeapCounter& counter)
+    {
+        outHeaps.clear();
+
+        for (const std::string& File : files)
+        {
+            std::ifstream Input(File, std::ios::binary | std::ios::ate);
+            if (!Input)
+                return false;
+
+            const size_t Size = (size_t)Input.tellg();
+            Input.seekg(0);
+
+            std::unique_ptr<uint8_t[]> Buffer(new uint8_t[Size]);
+            counter.Allocate(Size);
+            if (!Input.read(reinterpret_cast<char*>(Buffer.get()), (std::streamsize)Size))
+                return false;
+
+            TexturePlan Plan;
+            if (!PlanTexture(Buffer.get(), Size, Plan))
+                return false;
+
+            const size_t HeapSize = AlignUp(Plan.Size, HeapAlignment);
+            outHeaps.emplace_back(HeapSize);
+            counter.Allocate(HeapSize);
+            CopyRows(Plan, outHeaps.back().data());
+
+            counter.Free(Size);
+        }
+
+        return true;
+    }
+
+    // TextureBatchLoader's path: map and plan every file on the pool, then copy all of them
+    // in parallel into one staging buffer that the sample releases after the startup fence.
+    bool LoadBatch(ThreadPool& pool, const std::vector<std::string>& files, std::vector<uint8_t>& outStaging,
+        std::vector<size_t>& outBases, std::vector<size_t>& outSizes, HeapCounter& counter)
+    {
+        std::vector<MappedFile> Mappings(files.size());
+        std::vector<TexturePlan> Plans(files.size());
+        std::vector<char> bPlanned(files.size(), 0);
+
+        pool.ParallelFor(files.size(), [&](size_t i)
+        {
+            bPlanned[i] = Mappings[i].Open(files[i]) && PlanTexture(Mappings[i].GetData(), Mappings[i].GetSize(), Plans[i]);
+        });
+
+        if (std::find(bPlanned.begin(), bPlanned.end(), 0) != bPlanned.end())
+            return false;
+
+        size_t Total = 0;
+        outBases.resize(files.size());
+        outSizes.resize(files.size());
+        for (size_t i = 0; i < files.size(); ++i)
+        {
+            Total = AlignUp(Total, PlacementAlignment);
+            outBases[i] = Total;
+            outSizes[i] = Plans[i].Size;
+            Total += Plans[i].Size;
+        }
+
+        outStaging.assign(Total, 0);
+        counter.Allocate(Total);
+
+        pool.ParallelFor(files.size(), [&](size_t i)
+        {
+            CopyRows(Plans[i], outStaging.data() + outBases[i]);
+        });
+
+        return true;
+    }
+
+    double Median(std::vector<double> values)
+    {
+        std::sort(values.begin(), values.end());
+        return values[values.size() / 2];
+    }
+}
+
+int RunLoadBench(const std::vector<std::string>& args)
+{
+    typedef std::chrono::high_resolution_clock Clock;
+
+    LoadBenchOptions Options;
+    if (!ParseOptions(args, Options))
+    {
+        fprintf(stderr, "usage: TextureTool load-bench [--runs n] [-j threads] <dir|file.dds>...\n");
+        return 1;
+    }
+
+    std::vector<std::string> Files;
+    CollectFiles(Options.Inputs, Files);
+    if (Files.empty())
+    {
+        fprintf(stderr, "no .dds files found\n");
+        return 1;
+    }
+
+    ThreadPool Pool(Options.Threads);
+
+    // One counted run of each path, which also checks that both lay out the same bytes.
+    HeapCounter SerialHeap;
+    std::vector<std::vector<uint8_t>> Heaps;
+    if (!LoadSerial(Files, Heaps, SerialHeap))
+    {
+        printf("FAILED: a file could not be read or parsed\n");
+        return 1;
+    }
+
+    HeapCounter BatchHeap;
+    std::vector<uint8_t> Staging;
+    std::vector<size_t> Bases;
+    std::vector<size_t> Sizes;
+    if (!LoadBatch(Pool, Files, Staging, Bases, Sizes, BatchHeap))
+    {
+        printf("FAILED: a file could not be mapped or parsed\n");
+        return 1;
+    }
+
+    uint32_t Mismatches = 0;
+    for (size_t i = 0; i < Files.size(); ++i)
+    {
+        if (memcmp(Heaps[i].data(), Staging.data() + Bases[i], Sizes[i]) != 0)
+            ++Mismatches;
+    }
+
+    std::vector<double> SerialTimes;
+    std::vector<double> BatchTimes;
+    for (uint32_t Run = 0; Run < Options.Runs; ++Run)
+    {
+        HeapCounter Unused;
+
+        Clock::time_point Start = Clock::now();
+        LoadSerial(Files, Heaps, Unused);
+        SerialTimes.push_back(std::chrono::duration<double, std::milli>(Clock::now() - Start).count());
+
+        Start = Clock::now();
+        LoadBatch(Pool, Files, Staging, Bases, Sizes, Unused);
+        BatchTimes.push_back(std::chrono::duration<double, std::milli>(Clock::now() - Start).count());
+    }
+
+    printf("%zu textures, %zu worker threads, median of %u warm runs\n", Files.size(), Pool.GetThreadCount(), Options.Runs);
+    printf("  serial : %8.3f ms, heap peak %6.2f MB, %6.2f MB kept for the run in %zu upload heaps\n",
+        Median(SerialTimes), SerialHeap.Peak / (1024.0 * 1024.0), SerialHeap.Current / (1024.0 * 1024.0), Heaps.size());
+    printf("  batch  : %8.3f ms, heap peak %6.2f MB, released after the startup fence\n",
+        Median(BatchTimes), BatchHeap.Peak / (1024.0 * 1024.0));
+    printf("  %u of %zu textures laid out differently\n", Mismatches, Files.size());
+
+    printf(Mismatches == 0 ? "ok\n" : "FAILED: the batch staging buffer differs from the per-texture heaps\n");
+    return Mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,474 @@
+#include "MipGenerator.h"
+#include "../Common/ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+
+// The AVX2 kernels are compiled for every x86 build and chosen at run time, so the tool
+// still runs on machines without AVX2.
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define MIP_USE_AVX2 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define MIP_AVX2_TARGET
+#else
+#define MIP_AVX2_TARGET __attribute__((target("avx2,fma")))
+#endif
+#else
+#define MIP_USE_AVX2 0
+#endif
+
+namespace
+{
+    const double Pi = 3.14159265358979323846;
+
+    // Output rows per ParallelFor task.
+    const uint32_t RowsPerTile = 16;
+
+    // Source taps and weights for each output texel of one dimension, stored tap major
+    // (Index[tap * Count + texel]) so the SIMD kernels can load several texels at once.
+    // Texels with fewer taps are padded with zero weights.
+    struct FilterTable
+    {
+        uint32_t Count = 0;
+        uint32_t Taps = 0;
+        std::vector<int32_t> Index;
+        std::vector<float> Weight;
+    };
+
+    double Sinc(double x)
+    {
+        if (std::fabs(x) < 1e-6)
+            return 1.0;
+
+        return std::sin(Pi * x) / (Pi * x);
+    }
+
+    double BesselI0(double x)
+    {
+        double Sum = 1.0;
+        double Term = 1.0;
+        for (int k = 1; k < 64 && Term > Sum * 1e-12; ++k)
+        {
+            const double Half = x / (2.0 * k);
+            Term *= Half * Half;
+            Sum += Term;
+        }
+        return Sum;
+    }
+
+    // Support radius in destination texels.
+    double GetFilterRadius(MipFilter filter)
+    {
+        return filter == MipFilter::Box ? 0.5 : 3.0;
+    }
+
+    double EvaluateFilter(MipFilter filter, double x)
+    {
+        const double Radius = GetFilterRadius(filter);
+        if (std::fabs(x) >= Radius)
+            return 0.0;
+
+        switch (filter)
+        {
+        case MipFilter::Kaiser:
+        {
+            const double Alpha = 4.0;
+            const double t = x / Radius;
+            return Sinc(x) * BesselI0(Alpha * std::sqrt(1.0 - t * t)) / BesselI0(Alpha);
+        }
+
+        case MipFilter::Lanczos:
+            return Sinc(x) * Sinc(x / Radius);
+
+        default:
+            return 1.0;
+        }
+    }
+
+    int32_t ResolveIndex(int64_t index, uint32_t size, bool bWrap)
+    {
+        if (bWrap)
+        {
+            const int64_t Wrapped = index % (int64_t)size;
+            return (int32_t)(Wrapped < 0 ? Wrapped + size : Wrapped);
+        }
+
+        return (int32_t)(std::min)((std::max)(index, (int64_t)0), (int64_t)size - 1);
+    }
+
+    FilterTable BuildFilterTable(uint32_t srcSize, uint32_t dstSize, MipFilter filter, bool bWrap)
+    {
+        const double Scale = (double)srcSize / dstSize;
+        const double Radius = GetFilterRadius(filter) * Scale;
+
+        std::vector<std::vector<std::pair<int32_t, double>>> Texels(dstSize);
+        size_t MaxTaps = 1;
+
+        for (uint32_t x = 0; x < dstSize; ++x)
+        {
+            const double Center = (x + 0.5) * Scale;
+            const int64_t First = (int64_t)std::floor(Center - Radius);
+            const int64_t Last = (int64_t)std::ceil(Center + Radius);
+
+            double Sum = 0.0;
+            for (int64_t i = First; i < Last; ++i)
+            {
+                double Weight;
+                if (filter == MipFilter::Box)
+                {
+                    // Coverage of source texel [i, i + 1] by the destination footprint.
+                    Weight = (std::min)((double)i + 1.0, Center + Radius) - (std::max)((double)i, Center - Radius);
+                }
+                else
+                {
+                    Weight = EvaluateFilter(filter, (i + 0.5 - Center) / Scale);
+                }
+
+                if (std::fabs(Weight) < 1e-9)
+                    continue;
+
+                Texels[x].emplace_back(ResolveIndex(i, srcSize, bWrap), Weight);
+                Sum += Weight;
+            }
+
+            for (auto& Tap : Texels[x])
+            {
+                Tap.second /= Sum;
+            }
+
+            MaxTaps = (std::max)(MaxTaps, Texels[x].size());
+        }
+
+        FilterTable Table;
+        Table.Count = dstSize;
+        Table.Taps = (uint32_t)MaxTaps;
+        Table.Index.resize(MaxTaps * dstSize);
+        Table.Weight.resize(MaxTaps * dstSize);
+
+        for (uint32_t x = 0; x < dstSize; ++x)
+        {
+            for (size_t k = 0; k < MaxTaps; ++k)
+            {
+                const bool bPadding = k >= Texels[x].size();
+                Table.Index[k * dstSize + x] = bPadding ? Texels[x][0].first : Texels[x][k].first;
+                Table.Weight[k * dstSize + x] = bPadding ? 0.0f : (float)Texels[x][k].second;
+            }
+        }
+
+        return Table;
+    }
+
+    //-----------------------------------------------------------------------------------
+    // Scalar reference kernels.
+    //-----------------------------------------------------------------------------------
+
+    // out[i] = sum of weights[k] * rows[k][i].
+    void FilterRowsScalar(const float* const* rows, const float* weights, uint32_t taps, size_t count, float* out)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            float Sum = 0.0f;
+            for (uint32_t k = 0; k < taps; ++k)
+            {
+                Sum += weights[k] * rows[k][i];
+            }
+            out[i] = Sum;
+        }
+    }
+
+    void FilterTexelsScalar(const float* src, const FilterTable& table, uint32_t channels, float* out)
+    {
+        for (uint32_t x = 0; x < table.Count; ++x)
+        {
+            for (uint32_t c = 0; c < channels; ++c)
+            {
+                float Sum = 0.0f;
+                for (uint32_t k = 0; k < table.Taps; ++k)
+                {
+                    const size_t Tap = (size_t)k * table.Count + x;
+                    Sum += table.Weight[Tap] * src[(size_t)table.Index[Tap] * channels + c];
+                }
+                out[(size_t)x * channels + c] = Sum;
+            }
+        }
+    }
+
+#if MIP_USE_AVX2
+    //-----------------------------------------------------------------------------------
+    // AVX2 + FMA kernels.  Same arithmetic as the scalar ones except for fused rounding.
+    //-----------------------------------------------------------------------------------
+
+    MIP_AVX2_TARGET void FilterRowsAVX2(const float* const* rows, const float* weights, uint32_t taps, size_t count, float* out)
+    {
+        size_t i = 0;
+        for (; i + 32 <= count; i += 32)
+        {
+            __m256 Acc0 = _mm256_setzero_ps();
+            __m256 Acc1 = _mm256_setzero_ps();
+            __m256 Acc2 = _mm256_setzero_ps();
+            __m256 Acc3 = _mm256_setzero_ps();
+
+            for (uint32_t k = 0; k < taps; ++k)
+            {
+                const __m256 Weight = _mm256_set1_ps(weights[k]);
+                const float* Row = rows[k] + i;
+                Acc0 = _mm256_fmadd_ps(Weight, _mm256_loadu_ps(Row), Acc0);
+                Acc1 = _mm256_fmadd_ps(Weight, _mm256_loadu_ps(Row + 8), Acc1);
+                Acc2 = _mm256_fmadd_ps(Weight, _mm256_loadu_ps(Row + 16), Acc2);
+                Acc3 = _mm256_fmadd_ps(Weight, _mm256_loadu_ps(Row + 24), Acc3);
+            }
+
+            _mm256_storeu_ps(out + i, Acc0);
+            _mm256_storeu_ps(out + i + 8, Acc1);
+            _mm256_storeu_ps(out + i + 16, Acc2);
+            _mm256_storeu_ps(out + i + 24, Acc3);
+        }
+
+        for (; i + 8 <= count; i += 8)
+        {
+            __m256 Acc = _mm256_setzero_ps();
+            for (uint32_t k = 0; k < taps; ++k)
+            {
+                Acc = _mm256_fmadd_ps(_mm256_set1_ps(weights[k]), _mm256_loadu_ps(rows[k] + i), Acc);
+            }
+            _mm256_storeu_ps(out + i, Acc);
+        }
+
+        for (; i < count; ++i)
+        {
+            float Sum = 0.0f;
+            for (uint32_t k = 0; k < taps; ++k)
+            {
+                Sum += weights[k] * rows[k][i];
+            }
+            out[i] = Sum;
+        }
+    }
+
+    // Four channels: one texel per 128-bit half, two output texels per iteration.
+    MIP_AVX2_TARGET void FilterTexelsRGBA_AVX2(const float* src, const FilterTable& table, float* out)
+    {
+        const uint32_t Count = table.Count;
+
+        uint32_t x = 0;
+        for (; x + 2 <= Count; x += 2)
+        {
+            __m256 Acc = _mm256_setzero_ps();
+            for (uint32_t k = 0; k < table.Taps; ++k)
+            {
+                const int32_t* Index = &table.Index[(size_t)k * Count + x];
+                const float* Weight = &table.Weight[(size_t)k * Count + x];
+
+                const __m256 Texels = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(src + (size_t)Index[0] * 4)),
+                    _mm_loadu_ps(src + (size_t)Index[1] * 4), 1);
+                const __m256 Weights = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_set1_ps(Weight[0])),
+                    _mm_set1_ps(Weight[1]), 1);
+
+                Acc = _mm256_fmadd_ps(Weights, Texels, Acc);
+            }
+            _mm256_storeu_ps(out + (size_t)x * 4, Acc);
+        }
+
+        for (; x < Count; ++x)
+        {
+            __m128 Acc = _mm_setzero_ps();
+            for (uint32_t k = 0; k < table.Taps; ++k)
+            {
+                const size_t Tap = (size_t)k * Count + x;
+                Acc = _mm_fmadd_ps(_mm_set1_ps(table.Weight[Tap]), _mm_loadu_ps(src + (size_t)table.Index[Tap] * 4), Acc);
+            }
+            _mm_storeu_ps(out + (size_t)x * 4, Acc);
+        }
+    }
+
+    // One channel: eight output texels per iteration through gathers.
+    MIP_AVX2_TARGET void FilterTexelsR_AVX2(const float* src, const FilterTable& table, float* out)
+    {
+        const uint32_t Count = table.Count;
+
+        uint32_t x = 0;
+        for (; x + 8 <= Count; x += 8)
+        {
+            __m256 Acc = _mm256_setzero_ps();
+            for (uint32_t k = 0; k < table.Taps; ++k)
+            {
+                const size_t Tap = (size_t)k * Count + x;
+                const __m256i Index = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&table.Index[Tap]));
+                Acc = _mm256_fmadd_ps(_mm256_loadu_ps(&table.Weight[Tap]), _mm256_i32gather_ps(src, Index, 4), Acc);
+            }
+            _mm256_storeu_ps(out + x, Acc);
+        }
+
+        for (; x < Count; ++x)
+        {
+            float Sum = 0.0f;
+            for (uint32_t k = 0; k < table.Taps; ++k)
+            {
+                const size_t Tap = (size_t)k * Count + x;
+                Sum += table.Weight[Tap] * src[table.Index[Tap]];
+            }
+            out[x] = Sum;
+        }
+    }
+#endif
+
+    void RenormalizeRow(float* row, uint32_t width)
+    {
+        for (uint32_t x = 0; x < width; ++x, row += 4)
+        {
+            float N[3] = { row[0] * 2.0f - 1.0f, row[1] * 2.0f - 1.0f, row[2] * 2.0f - 1.0f };
+
+            const float Length = std::sqrt(N[0] * N[0] + N[1] * N[1] + N[2] * N[2]);
+            if (Length < 1e-6f)
+            {
+                N[0] = 0.0f;
+                N[1] = 0.0f;
+                N[2] = 1.0f;
+            }
+            else
+            {
+                for (float& Component : N)
+                {
+                    Component /= Length;
+                }
+            }
+
+            for (int c = 0; c < 3; ++c)
+            {
+                row[c] = N[c] * 0.5f + 0.5f;
+            }
+        }
+    }
+}
+
+FloatImage DownsampleImage(const FloatImage& source, const MipOptions& options, ThreadPool& pool)
+{
+    const uint32_t Width = (std::max)(source.Width / 2, 1u);
+    const uint32_t Height = (std::max)(source.Height / 2, 1u);
+    const uint32_t Channels = source.Channels;
+
+    const FilterTable Horizontal = BuildFilterTable(source.Width, Width, options.Filter, options.bWrap);
+    const FilterTable Vertical = BuildFilterTable(source.Height, Height, options.Filter, options.bWrap);
+
+#if MIP_USE_AVX2
+    const bool bAVX2 = !options.bForceScalar && IsAVX2Available() && (Channels == 1 || Channels == 4);
+#else
+    const bool bAVX2 = false;
+#endif
+
+    FloatImage Result;
+    Result.Resize(Width, Height, Channels);
+
+    const size_t TileCount = (Height + RowsPerTile - 1) / RowsPerTile;
+    pool.ParallelFor(TileCount, [&](size_t tile)
+    {
+        // The vertical pass writes one full-width row, the horizontal pass reduces it.
+        std::vector<float> Column((size_t)source.Width * Channels);
+        std::vector<const float*> Rows(Vertical.Taps);
+        std::vector<float> Weights(Vertical.Taps);
+
+        const uint32_t FirstRow = (uint32_t)tile * RowsPerTile;
+        const uint32_t LastRow = (std::min)(FirstRow + RowsPerTile, Height);
+
+        for (uint32_t y = FirstRow; y < LastRow; ++y)
+        {
+            for (uint32_t k = 0; k < Vertical.Taps; ++k)
+            {
+                const size_t Tap = (size_t)k * Vertical.Count + y;
+                Rows[k] = source.Row(Vertical.Index[Tap]);
+                Weights[k] = Vertical.Weight[Tap];
+            }
+
+            float* Out = Result.Row(y);
+
+#if MIP_USE_AVX2
+            if (bAVX2)
+            {
+                FilterRowsAVX2(Rows.data(), Weights.data(), Vertical.Taps, Column.size(), Column.data());
+                if (Channels == 4)
+                    FilterTexelsRGBA_AVX2(Column.data(), Horizontal, Out);
+                else
+                    FilterTexelsR_AVX2(Column.data(), Horizontal, Out);
+            }
+            else
+#endif
+            {
+                FilterRowsScalar(Rows.data(), Weights.data(), Vertical.Taps, Column.size(), Column.data());
+                FilterTexelsScalar(Column.data(), Horizontal, Channels, Out);
+            }
+
+            if (options.bNormalMap && Channels == 4)
+                RenormalizeRow(Out, Width);
+        }
+    });
+
+    return Result;
+}
+
+void GenerateMipChain(const FloatImage& source, const MipOptions& options, ThreadPool& pool, std::vector<FloatImage>& chain)
+{
+    chain.clear();
+    chain.push_back(source);
+
+    while (chain.back().Width > 1 || chain.back().Height > 1)
+    {
+        FloatImage Next = DownsampleImage(chain.back(), options, pool);
+        chain.push_back(std::move(Next));
+    }
+}
+
+bool IsAVX2Available()
+{
+#if MIP_USE_AVX2
+    static const bool bAvailable = []()
+    {
+#if defined(_MSC_VER)
+        int Info[4];
+        __cpuid(Info, 0);
+        if (Info[0] < 7)
+            return false;
+
+        // AVX and FMA in leaf 1, and the OS must save the YMM registers.
+        __cpuid(Info, 1);
+        const bool bOSXSave = (Info[2] & (1 << 27)) != 0;
+        const bool bAVX = (Info[2] & (1 << 28)) != 0;
+        const bool bFMA = (Info[2] & (1 << 12)) != 0;
+        if (!bOSXSave || !bAVX || !bFMA || (_xgetbv(0) & 6) != 6)
+            return false;
+
+        __cpuidex(Info, 7, 0);
+        return (Info[1] & (1 << 5)) != 0;
+#else
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+    }();
+
+    return bAvailable;
+#else
+    return false;
+#endif
+}
+
+bool ParseMipFilter(const std::string& name, MipFilter& filter)
+{
+    if (name == "box")          filter = MipFilter::Box;
+    else if (name == "kaiser")  filter = MipFilter::Kaiser;
+    else if (name == "lanczos") filter = MipFilter::Lanczos;
+    else return false;
+
+    return true;
+}
+
+const char* GetMipFilterName(MipFilter filter)
+{
+    switch (filter)
+    {
+    case MipFilter::Box:        return "box";
+    case MipFilter::Kaiser:     return "kaiser";
+    case MipFilter::Lanczos:    return "lanczos";
+    default:                    return "unknown";
+    }
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "Image.h"
+
+class ThreadPool;
+
+enum class MipFilter
+{
+    Box,        // Exact area average.  Cheapest, slightly blurry on odd sizes.
+    Kaiser,     // Kaiser-windowed sinc, radius 3, alpha 4.
+    Lanczos,    // Lanczos-3.
+};
+
+struct MipOptions
+{
+    MipFilter Filter = MipFilter::Kaiser;
+
+    // Wrap instead of clamping at the edges, for tiling textures.
+    bool bWrap = false;
+
+    // Treat RGB as a [0, 1] encoded vector and renormalize it on every level.
+    bool bNormalMap = false;
+
+    // Use the scalar reference path even when AVX2 is available.
+    bool bForceScalar = false;
+};
+
+// Halves each dimension (rounding down, never below 1) with a separable filter.  The
+// image is expected to hold linear data; callers convert sRGB before and after.
+FloatImage DownsampleImage(const FloatImage& source, const MipOptions& options, ThreadPool& pool);
+
+// Fills chain with source followed by every smaller level down to 1x1.  Each level is
+// filtered from the previous float level so nothing is quantized between steps.
+void GenerateMipChain(const FloatImage& source, const MipOptions& options, ThreadPool& pool, std::vector<FloatImage>& chain);
+
+// True when the AVX2 + FMA kernels are compiled in and the CPU and OS support them.
+bool IsAVX2Available();
+
+bool ParseMipFilter(const std::string& name, MipFilter& filter);
+const char* GetMipFilterName(MipFilter filter);
@@ -0,0 +1,368 @@
+#include "Commands.h"
+#include "DDSFile.h"
+#include "MipGenerator.h"
+#include "../Common/ThreadPool.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+    struct MipsOptions
+    {
+        std::string OutputDirectory = ".";
+        MipOptions Generator;
+        bool bLinear = false;
+        size_t ThreadCount = 0;
+        uint32_t BenchmarkSize = 0;
+        std::vector<std::string> Inputs;
+    };
+
+    bool ParseOptions(const std::vector<std::string>& args, MipsOptions& options)
+    {
+        for (size_t i = 0; i < args.size(); ++i)
+        {
+            const std::string& Arg = args[i];
+            const bool bHasValue = i + 1 < args.size();
+
+            if (Arg == "-o" && bHasValue)
+                options.OutputDirectory = args[++i];
+            else if (Arg == "-f" && bHasValue)
+            {
+                if (!ParseMipFilter(args[++i], options.Generator.Filter))
+                {
+                    fprintf(stderr, "unknown filter '%s'\n", args[i].c_str());
+                    return false;
+                }
+            }
+            else if (Arg == "-j" && bHasValue)
+                options.ThreadCount = (size_t)atoi(args[++i].c_str());
+            else if (Arg == "--bench")
+            {
+                options.BenchmarkSize = 4096;
+                if (bHasValue && isdigit((unsigned char)args[i + 1][0]))
+                    options.BenchmarkSize = (uint32_t)atoi(args[++i].c_str());
+            }
+            else if (Arg == "--normal")
+                options.Generator.bNormalMap = true;
+            else if (Arg == "--linear")
+                options.bLinear = true;
+            else if (Arg == "--wrap")
+                options.Generator.bWrap = true;
+            else if (Arg == "--scalar")
+                options.Generator.bForceScalar = true;
+            else if (!Arg.empty() && Arg[0] == '-')
+            {
+                fprintf(stderr, "unknown option '%s'\n", Arg.c_str());
+                return false;
+            }
+            else
+                options.Inputs.push_back(Arg);
+        }
+
+        return options.BenchmarkSize > 0 || !options.Inputs.empty();
+    }
+
+    bool HasExtension(const std::string& fileName, const char* extension)
+    {
+        const size_t Length = strlen(extension);
+        if (fileName.size() < Length)
+            return false;
+
+        for (size_t i = 0; i < Length; ++i)
+        {
+            if (tolower((unsigned char)fileName[fileName.size() - Length + i]) != extension[i])
+                return false;
+        }
+        return true;
+    }
+
+    std::string ReplaceExtension(const std::string& fileName, const char* extension)
+    {
+        const size_t Dot = fileName.find_last_of('.');
+        return (Dot == std::string::npos ? fileName : fileName.substr(0, Dot)) + extension;
+    }
+
+    DXGI_FORMAT GetOutputFormat(DXGI_FORMAT sourceFormat)
+    {
+        switch (sourceFormat)
+        {
+        case DXGI_FORMAT_R16G16B16A16_FLOAT:
+        case DXGI_FORMAT_R32G32B32A32_FLOAT:
+        case DXGI_FORMAT_R16_FLOAT:
+        case DXGI_FORMAT_R32_FLOAT:
+            return sourceFormat;
+
+        default:
+            return IsSRGBFormat(sourceFormat) ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM;
+        }
+    }
+
+    void EncodeLevel(const FloatImage& level, DXGI_FORMAT format, bool bSRGB, std::vector<uint8_t>& out)
+    {
+        const size_t Count = level.Data.size();
+
+        switch (format)
+        {
+        case DXGI_FORMAT_R16G16B16A16_FLOAT:
+        case DXGI_FORMAT_R16_FLOAT:
+            out.resize(Count * 2);
+            for (size_t i = 0; i < Count; ++i)
+            {
+                const uint16_t Half = FloatToHalf(level.Data[i]);
+                memcpy(&out[i * 2], &Half, sizeof(Half));
+            }
+            break;
+
+        case DXGI_FORMAT_R32G32B32A32_FLOAT:
+        case DXGI_FORMAT_R32_FLOAT:
+            out.resize(Count * 4);
+            memcpy(out.data(), level.Data.data(), out.size());
+            break;
+
+        default:
+        {
+            Surface Encoded;
+            FloatToSurface(level, bSRGB, Encoded);
+            out = std::move(Encoded.Pixels);
+            break;
+        }
+        }
+    }
+
+    bool ProcessFile(const std::string& input, const MipsOptions& options, ThreadPool& pool, double& outMegapixels, double& outSeconds)
+    {
+        const std::string FileName = GetFileName(input);
+
+        MipOptions Generator = options.Generator;
+        Generator.bNormalMap = Generator.bNormalMap || FileName.find("_nmap") != std::string::npos;
+
+        // Colour data is filtered in linear light; normal maps and --linear are filtered as stored.
+        const bool bSRGB = !options.bLinear && !Generator.bNormalMap;
+
+        std::string Error;
+        FloatTexture Source;
+
+        if (HasExtension(FileName, ".bmp"))
+        {
+            Surface Bitmap;
+            if (!LoadBitmapFile(input, Bitmap, Error))
+            {
+                fprintf(stderr, "%s: %s\n", input.c_str(), Error.c_str());
+                return false;
+            }
+
+            Source.SourceFormat = DXGI_FORMAT_R8G8B8A8_UNORM;
+            Source.MipCount = 1;
+            Source.ArraySize = 1;
+            Source.Subresources.resize(1);
+            SurfaceToFloat(Bitmap, bSRGB, Source.Subresources[0]);
+        }
+        else if (!LoadFloatTexture(input, bSRGB, Source, Error))
+        {
+            fprintf(stderr, "%s: %s\n", input.c_str(), Error.c_str());
+            return false;
+        }
+
+        const DXGI_FORMAT Format = GetOutputFormat(Source.SourceFormat);
+        const bool bEncodeSRGB = bSRGB || IsSRGBFormat(Source.SourceFormat);
+
+        // Existing mips are replaced: every slice is rebuilt from its top level.
+        std::vector<std::vector<FloatImage>> Slices(Source.ArraySize);
+        double Megapixels = 0.0;
+
+        auto StartTime = std::chrono::high_resolution_clock::now();
+
+        for (uint32_t Slice = 0; Slice < Source.ArraySize; ++Slice)
+        {
+            GenerateMipChain(Source.Subresources[(size_t)Slice * Source.MipCount], Generator, pool, Slices[Slice]);
+
+            for (size_t Mip = 0; Mip + 1 < Slices[Slice].size(); ++Mip)
+            {
+                Megapixels += (double)Slices[Slice][Mip].Width * Slices[Slice][Mip].Height / 1.0e6;
+            }
+        }
+
+        auto EndTime = std::chrono::high_resolution_clock::now();
+        const double Seconds = std::chrono::duration<double>(EndTime - StartTime).count();
+
+        TextureFile Output;
+        Output.Format = Format;
+        Output.Width = Slices[0][0].Width;
+        Output.Height = Slices[0][0].Height;
+        Output.MipCount = (uint32_t)Slices[0].size();
+        Output.ArraySize = Source.ArraySize;
+        Output.IsCubeMap = Source.IsCubeMap;
+
+        for (const std::vector<FloatImage>& Chain : Slices)
+        {
+            for (const FloatImage& Level : Chain)
+            {
+                Output.Subresources.emplace_back();
+                EncodeLevel(Level, Format, bEncodeSRGB, Output.Subresources.back());
+            }
+        }
+
+        const std::string OutputPath = JoinPath(options.OutputDirectory, ReplaceExtension(FileName, ".dds"));
+        if (!SaveTextureFile(OutputPath, Output, Error))
+        {
+            fprintf(stderr, "%s: %s\n", OutputPath.c_str(), Error.c_str());
+            return false;
+        }
+
+        printf("%-24s %5ux%-5u %2u mips  %-8s %-20s -> %-20s %8.2f ms  %8.1f MPix/s\n",
+            FileName.c_str(), Output.Width, Output.Height, Output.MipCount, GetMipFilterName(Generator.Filter),
+            GetFormatName(Source.SourceFormat), GetFormatName(Format),
+            Seconds * 1000.0, Seconds > 0.0 ? Megapixels / Seconds : 0.0);
+
+        outMegapixels += Megapixels;
+        outSeconds += Seconds;
+        return true;
+    }
+
+    // Zone plate in red (aliasing shows up as moire), gradient, noise and a checker.  The
+    // single channel variant keeps only the zone plate.
+    FloatImage MakeBenchmarkImage(uint32_t size, uint32_t channels)
+    {
+        FloatImage Image;
+        Image.Resize(size, size, channels);
+
+        const double Frequency = 3.14159265358979323846 / size;
+        uint32_t Seed = 12345;
+
+        for (uint32_t y = 0; y < size; ++y)
+        {
+            float* Row = Image.Row(y);
+            for (uint32_t x = 0; x < size; ++x)
+            {
+                const double dx = x - size * 0.5;
+                const double dy = y - size * 0.5;
+                const float Zone = (float)(0.5 + 0.5 * std::cos(Frequency * (dx * dx + dy * dy)));
+
+                if (channels == 1)
+                {
+                    Row[x] = Zone;
+                    continue;
+                }
+
+                Seed = Seed * 1664525u + 1013904223u;
+                Row[x * 4 + 0] = Zone;
+                Row[x * 4 + 1] = (float)x / size;
+                Row[x * 4 + 2] = (Seed >> 8) / 16777216.0f;
+                Row[x * 4 + 3] = ((x / 8 + y / 8) & 1) ? 1.0f : 0.0f;
+            }
+        }
+
+        return Image;
+    }
+
+    // Best of two runs, so the first one's page faults do not count.
+    double TimeMipChain(const FloatImage& source, const MipOptions& options, ThreadPool& pool, std::vector<FloatImage>& chain)
+    {
+        double Best = 0.0;
+        for (int Run = 0; Run < 2; ++Run)
+        {
+            auto StartTime = std::chrono::high_resolution_clock::now();
+            GenerateMipChain(source, options, pool, chain);
+            auto EndTime = std::chrono::high_resolution_clock::now();
+
+            const double Seconds = std::chrono::duration<double>(EndTime - StartTime).count();
+            Best = Run == 0 ? Seconds : (std::min)(Best, Seconds);
+        }
+        return Best;
+    }
+
+    float GetMaxDifference(const std::vector<FloatImage>& a, const std::vector<FloatImage>& b)
+    {
+        float MaxDifference = 0.0f;
+        for (size_t Level = 0; Level < a.size(); ++Level)
+        {
+            for (size_t i = 0; i < a[Level].Data.size(); ++i)
+            {
+                MaxDifference = (std::max)(MaxDifference, std::fabs(a[Level].Data[i] - b[Level].Data[i]));
+            }
+        }
+        return MaxDifference;
+    }
+
+    // Times each filter on a synthetic image with the SIMD and the scalar kernels and checks
+    // that both produce the same chain.
+    int RunBenchmark(uint32_t size, ThreadPool& pool, bool bWrap)
+    {
+        const float Tolerance = 1e-4f;
+
+        printf("mip chain of a %ux%u image, %zu threads, AVX2 %s\n", size, size, pool.GetThreadCount() + 1,
+            IsAVX2Available() ? "on" : "not available, both runs use the scalar kernels");
+
+        int Failures = 0;
+
+        for (uint32_t Channels : { 4u, 1u })
+        {
+            const FloatImage Source = MakeBenchmarkImage(size, Channels);
+            const double Megapixels = (double)size * size * 4.0 / 3.0 / 1.0e6;
+
+            for (MipFilter Filter : { MipFilter::Box, MipFilter::Kaiser, MipFilter::Lanczos })
+            {
+                MipOptions Options;
+                Options.Filter = Filter;
+                Options.bWrap = bWrap;
+
+                std::vector<FloatImage> Fast;
+                std::vector<FloatImage> Reference;
+
+                const double FastSeconds = TimeMipChain(Source, Options, pool, Fast);
+                Options.bForceScalar = true;
+                const double ReferenceSeconds = TimeMipChain(Source, Options, pool, Reference);
+
+                const float MaxDifference = GetMaxDifference(Fast, Reference);
+                const bool bPassed = MaxDifference <= Tolerance;
+                if (!bPassed)
+                    ++Failures;
+
+                printf("%s %-8s simd %8.2f ms (%7.1f MPix/s)  scalar %8.2f ms (%7.1f MPix/s)  x%.2f  max diff %.2e %s\n",
+                    Channels == 4 ? "RGBA" : "R   ", GetMipFilterName(Filter),
+                    FastSeconds * 1000.0, Megapixels / FastSeconds, ReferenceSeconds * 1000.0, Megapixels / ReferenceSeconds,
+                    ReferenceSeconds / FastSeconds, MaxDifference, bPassed ? "ok" : "MISMATCH");
+            }
+        }
+
+        return Failures == 0 ? 0 : 1;
+    }
+}
+
+int RunMips(const std::vector<std::string>& args)
+{
+    MipsOptions Options;
+    if (!ParseOptions(args, Options))
+    {
+        fprintf(stderr, "usage: TextureTool mips [-o dir] [-f box|kaiser|lanczos] [--normal] [--linear] [--wrap] [--scalar] [-j threads] <input.dds|input.bmp>...\n"
+            "       TextureTool mips --bench [size]\n");
+        return 1;
+    }
+
+    ThreadPool Pool(Options.ThreadCount);
+
+    if (Options.BenchmarkSize > 0)
+        return RunBenchmark(Options.BenchmarkSize, Pool, Options.Generator.bWrap);
+
+    double Megapixels = 0.0;
+    double Seconds = 0.0;
+    int Failures = 0;
+
+    for (const std::string& Input : Options.Inputs)
+    {
+        if (!ProcessFile(Input, Options, Pool, Megapixels, Seconds))
+            ++Failures;
+    }
+
+    printf("%zu textures, %.1f MPix filtered in %.3f s (%.1f MPix/s, %s)\n",
+        Options.Inputs.size() - Failures, Megapixels, Seconds, Seconds > 0.0 ? Megapixels / Seconds : 0.0,
+        (!Options.Generator.bForceScalar && IsAVX2Available()) ? "AVX2" : "scalar");
+
+    return Failures == 0 ? 0 : 1;
+}
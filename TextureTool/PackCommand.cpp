@@ -0,0 +1,369 @@
+#include "Commands.h"
+#include "DDSFile.h"
+#include "MipGenerator.h"
+#include "TexturePacker.h"
+#include "../Common/TexturePackManifest.h"
+#include "../Common/ThreadPool.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+namespace
+{
+    struct PackOptions
+    {
+        std::string OutputDirectory = ".";
+        PackSettings Settings;
+        bool bDryRun = false;
+        size_t ThreadCount = 0;
+        std::vector<std::string> Inputs;
+    };
+
+    // A colour texture and its _nmap companion, loaded as stored.
+    struct SourceFiles
+    {
+        std::string ColourPath;
+        std::string NormalPath;
+        TextureFile Colour;
+        TextureFile Normal;
+    };
+
+    bool ParseOptions(const std::vector<std::string>& args, PackOptions& options)
+    {
+        for (size_t i = 0; i < args.size(); ++i)
+        {
+            const std::string& Arg = args[i];
+            const bool bHasValue = i + 1 < args.size();
+
+            if (Arg == "-o" && bHasValue)
+                options.OutputDirectory = args[++i];
+            else if (Arg == "-j" && bHasValue)
+                options.ThreadCount = (size_t)atoi(args[++i].c_str());
+            else if (Arg == "--atlas-size" && bHasValue)
+                options.Settings.AtlasSize = (uint32_t)atoi(args[++i].c_str());
+            else if (Arg == "--atlas-max" && bHasValue)
+                options.Settings.AtlasMaxSourceSize = (uint32_t)atoi(args[++i].c_str());
+            else if (Arg == "--atlas-mips" && bHasValue)
+                options.Settings.AtlasMipCount = (uint32_t)(std::max)(atoi(args[++i].c_str()), 1);
+            else if (Arg == "--gutter" && bHasValue)
+                options.Settings.Gutter = (uint32_t)atoi(args[++i].c_str());
+            else if (Arg == "--no-atlas")
+                options.Settings.bAtlas = false;
+            else if (Arg == "--dry-run")
+                options.bDryRun = true;
+            else if (!Arg.empty() && Arg[0] == '-')
+            {
+                fprintf(stderr, "unknown option '%s'\n", Arg.c_str());
+                return false;
+            }
+            else
+                options.Inputs.push_back(Arg);
+        }
+
+        return !options.Inputs.empty();
+    }
+
+    std::string GetNormalCompanion(const std::string& path)
+    {
+        const size_t Dot = path.find_last_of('.');
+        const size_t Slash = path.find_last_of("/\\");
+
+        if (Dot == std::string::npos || (Slash != std::string::npos && Dot < Slash))
+            return path + "_nmap";
+
+        return path.substr(0, Dot) + "_nmap" + path.substr(Dot);
+    }
+
+    bool FileExists(const std::string& path)
+    {
+        FILE* File = fopen(path.c_str(), "rb");
+        if (File == nullptr)
+            return false;
+
+        fclose(File);
+        return true;
+    }
+
+    bool ReadSources(const std::vector<std::string>& inputs, std::vector<PackSource>& outSources, std::vector<SourceFiles>& outFiles)
+    {
+        for (const std::string& Input : inputs)
+        {
+            const std::string FileName = GetFileName(Input);
+
+            // Normal maps come along with their colour map.
+            if (FileName.find("_nmap") != std::string::npos)
+                continue;
+
+            SourceFiles Files;
+            Files.ColourPath = Input;
+
+            std::string Error;
+            if (!LoadTextureFile(Input, Files.Colour, Error))
+            {
+                fprintf(stderr, "%s: %s\n", Input.c_str(), Error.c_str());
+                return false;
+            }
+
+            if (Files.Colour.ArraySize != 1 || Files.Colour.IsCubeMap)
+            {
+                printf("skipping %s: arrays and cube maps are left as they are\n", FileName.c_str());
+                continue;
+            }
+
+            PackSource Source;
+            Source.Name = FileName;
+            Source.Format = Files.Colour.Format;
+            Source.Width = Files.Colour.Width;
+            Source.Height = Files.Colour.Height;
+            Source.MipCount = Files.Colour.MipCount;
+
+            const std::string NormalPath = GetNormalCompanion(Input);
+            if (FileExists(NormalPath))
+            {
+                Files.NormalPath = NormalPath;
+                if (!LoadTextureFile(NormalPath, Files.Normal, Error))
+                {
+                    fprintf(stderr, "%s: %s\n", NormalPath.c_str(), Error.c_str());
+                    return false;
+                }
+
+                Source.bHasNormal = true;
+                Source.NormalFormat = Files.Normal.Format;
+                Source.NormalWidth = Files.Normal.Width;
+                Source.NormalHeight = Files.Normal.Height;
+                Source.NormalMipCount = Files.Normal.MipCount;
+            }
+
+            outSources.push_back(Source);
+            outFiles.push_back(std::move(Files));
+        }
+
+        return true;
+    }
+
+    // Array slices are copied byte for byte, so block-compressed data is not re-encoded.
+    TextureFile BuildArray(const TexturePack& pack, const std::vector<SourceFiles>& files, bool bNormal)
+    {
+        TextureFile Output;
+        Output.Format = bNormal ? pack.NormalFormat : pack.Format;
+        Output.MipCount = bNormal ? pack.NormalMipCount : pack.MipCount;
+        Output.ArraySize = (uint32_t)pack.Entries.size();
+
+        for (const PackEntry& Entry : pack.Entries)
+        {
+            const TextureFile& Source = bNormal ? files[Entry.Source].Normal : files[Entry.Source].Colour;
+            Output.Width = Source.Width;
+            Output.Height = Source.Height;
+            Output.Subresources.insert(Output.Subresources.end(), Source.Subresources.begin(), Source.Subresources.end());
+        }
+
+        return Output;
+    }
+
+    // Every sub-image brings its own mip chain and is padded by replicating its edge texels
+    // on each level, so filtering near a border never reads a neighbour.
+    bool BuildAtlas(const TexturePack& pack, const std::vector<SourceFiles>& files, bool bNormal, ThreadPool& pool,
+        TextureFile& output, std::string& error)
+    {
+        std::vector<Surface> Levels(pack.MipCount);
+        for (uint32_t Mip = 0; Mip < pack.MipCount; ++Mip)
+        {
+            Levels[Mip].Resize((std::max)(pack.Width >> Mip, 1u), (std::max)(pack.Height >> Mip, 1u));
+        }
+
+        for (const PackEntry& Entry : pack.Entries)
+        {
+            const std::string& Path = bNormal ? files[Entry.Source].NormalPath : files[Entry.Source].ColourPath;
+
+            RGBATexture Source;
+            if (!LoadRGBATexture(Path, Source, error))
+            {
+                error = Path + ": " + error;
+                return false;
+            }
+
+            std::vector<Surface> Chain;
+            if (Source.MipCount >= pack.MipCount)
+            {
+                Chain.assign(Source.Subresources.begin(), Source.Subresources.begin() + pack.MipCount);
+            }
+            else
+            {
+                MipOptions Options;
+                Options.bNormalMap = bNormal;
+
+                FloatImage Top;
+                SurfaceToFloat(Source.Subresources[0], !bNormal, Top);
+
+                std::vector<FloatImage> Generated;
+                GenerateMipChain(Top, Options, pool, Generated);
+
+                Chain.resize((std::min)((size_t)pack.MipCount, Generated.size()));
+                for (size_t Mip = 0; Mip < Chain.size(); ++Mip)
+                {
+                    FloatToSurface(Generated[Mip], !bNormal, Chain[Mip]);
+                }
+            }
+
+            for (uint32_t Mip = 0; Mip < (uint32_t)Chain.size(); ++Mip)
+            {
+                const Surface& Image = Chain[Mip];
+                Surface& Level = Levels[Mip];
+
+                const uint32_t CellX = (Entry.X - pack.Gutter) >> Mip;
+                const uint32_t CellY = (Entry.Y - pack.Gutter) >> Mip;
+                const uint32_t ContentX = Entry.X >> Mip;
+                const uint32_t ContentY = Entry.Y >> Mip;
+                const uint32_t CellRight = (std::min)(CellX + (Entry.CellWidth >> Mip), Level.Width);
+                const uint32_t CellBottom = (std::min)(CellY + (Entry.CellHeight >> Mip), Level.Height);
+
+                for (uint32_t y = CellY; y < CellBottom; ++y)
+                {
+                    const int64_t SrcY = (std::min)((std::max)((int64_t)y - ContentY, (int64_t)0), (int64_t)Image.Height - 1);
+                    for (uint32_t x = CellX; x < CellRight; ++x)
+                    {
+                        const int64_t SrcX = (std::min)((std::max)((int64_t)x - ContentX, (int64_t)0), (int64_t)Image.Width - 1);
+                        const uint8_t* Src = Image.Texel((uint32_t)SrcX, (uint32_t)SrcY);
+                        std::copy(Src, Src + 4, Level.Texel(x, y));
+                    }
+                }
+            }
+        }
+
+        output.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+        output.Width = pack.Width;
+        output.Height = pack.Height;
+        output.MipCount = pack.MipCount;
+        output.ArraySize = 1;
+        output.IsCubeMap = false;
+        output.Subresources.clear();
+
+        for (Surface& Level : Levels)
+        {
+            output.Subresources.push_back(std::move(Level.Pixels));
+        }
+
+        return true;
+    }
+
+    std::string GetPackName(const TexturePack& pack, uint32_t index, bool bNormal)
+    {
+        const char* Kind = pack.Kind == PackKind::Array ? "array" : "atlas";
+        return std::string("pack_") + Kind + std::to_string(index) + (bNormal ? "_nmap" : "") + ".dds";
+    }
+
+    void PrintPlan(const PackPlan& plan, const std::vector<PackSource>& sources)
+    {
+        uint32_t ArrayCount = 0;
+        uint32_t AtlasCount = 0;
+
+        for (const TexturePack& Pack : plan.Packs)
+        {
+            const bool bArray = Pack.Kind == PackKind::Array;
+            const std::string Name = GetPackName(Pack, bArray ? ArrayCount++ : AtlasCount++, false);
+
+            printf("%-22s %-16s %5ux%-5u %2u mips  %3zu %s%s\n", Name.c_str(), GetFormatName(Pack.Format),
+                Pack.Width, Pack.Height, Pack.MipCount, Pack.Entries.size(), bArray ? "slices" : "sub-images",
+                Pack.bHasNormal ? "  + normal" : "");
+
+            for (const PackEntry& Entry : Pack.Entries)
+            {
+                if (bArray)
+                    printf("    [%u] %s\n", Entry.Slice, sources[Entry.Source].Name.c_str());
+                else
+                    printf("    (%u, %u) %s\n", Entry.X, Entry.Y, sources[Entry.Source].Name.c_str());
+            }
+        }
+
+        for (uint32_t Source : plan.Unpacked)
+        {
+            printf("%-22s %s\n", "(left as is)", sources[Source].Name.c_str());
+        }
+    }
+}
+
+int RunPack(const std::vector<std::string>& args)
+{
+    PackOptions Options;
+    if (!ParseOptions(args, Options))
+    {
+        fprintf(stderr, "usage: TextureTool pack [-o dir] [--atlas-size n] [--atlas-max n] [--atlas-mips n] [--gutter n] [--no-atlas] [--dry-run] <colour.dds>...\n");
+        return 1;
+    }
+
+    std::vector<PackSource> Sources;
+    std::vector<SourceFiles> Files;
+    if (!ReadSources(Options.Inputs, Sources, Files))
+        return 1;
+
+    const PackPlan Plan = PlanTexturePacks(Sources, Options.Settings);
+    PrintPlan(Plan, Sources);
+
+    // Each colour texture used to need its own table; now every pack is one table.
+    const size_t TablesBefore = Sources.size();
+    const size_t TablesAfter = Plan.Packs.size() + Plan.Unpacked.size();
+    printf("%zu textures -> %zu packs + %zu unpacked: %zu texture tables instead of %zu, up to %zu fewer descriptor table changes per frame\n",
+        Sources.size(), Plan.Packs.size(), Plan.Unpacked.size(), TablesAfter, TablesBefore, TablesBefore - TablesAfter);
+
+    if (Options.bDryRun)
+        return 0;
+
+    ThreadPool Pool(Options.ThreadCount);
+    TexturePackManifest Manifest;
+
+    uint32_t ArrayCount = 0;
+    uint32_t AtlasCount = 0;
+
+    for (const TexturePack& Pack : Plan.Packs)
+    {
+        const uint32_t Index = Pack.Kind == PackKind::Array ? ArrayCount++ : AtlasCount++;
+
+        for (int Pass = 0; Pass < (Pack.bHasNormal ? 2 : 1); ++Pass)
+        {
+            const bool bNormal = Pass == 1;
+            const std::string Name = GetPackName(Pack, Index, bNormal);
+
+            std::string Error;
+            TextureFile Output;
+
+            if (Pack.Kind == PackKind::Array)
+                Output = BuildArray(Pack, Files, bNormal);
+            else if (!BuildAtlas(Pack, Files, bNormal, Pool, Output, Error))
+            {
+                fprintf(stderr, "%s\n", Error.c_str());
+                return 1;
+            }
+
+            if (!SaveTextureFile(JoinPath(Options.OutputDirectory, Name), Output, Error))
+            {
+                fprintf(stderr, "%s: %s\n", Name.c_str(), Error.c_str());
+                return 1;
+            }
+
+            const uint32_t PackIndex = Manifest.AddPack(Name);
+            for (const PackEntry& Entry : Pack.Entries)
+            {
+                TexturePackPlacement Placement;
+                Placement.SourceName = GetFileName(bNormal ? Files[Entry.Source].NormalPath : Files[Entry.Source].ColourPath);
+                Placement.PackIndex = PackIndex;
+                Placement.Slice = Entry.Slice;
+                Placement.Scale[0] = Entry.Scale[0];
+                Placement.Scale[1] = Entry.Scale[1];
+                Placement.Bias[0] = Entry.Bias[0];
+                Placement.Bias[1] = Entry.Bias[1];
+                Manifest.AddPlacement(Placement);
+            }
+        }
+    }
+
+    const std::string ManifestPath = JoinPath(Options.OutputDirectory, "packs.txt");
+    if (!Manifest.Save(ManifestPath))
+    {
+        fprintf(stderr, "%s: write failed\n", ManifestPath.c_str());
+        return 1;
+    }
+
+    printf("wrote %zu pack files and %s\n", Manifest.GetPacks().size(), ManifestPath.c_str());
+    return 0;
+}
@@ -0,0 +1,164 @@
+#include "Commands.h"
+#include "../Common/ShaderPermutation.h"
+
+#include <cstdio>
+#include <set>
+
+namespace
+{
+    struct PermutationsOptions
+    {
+        std::string FxcDirectory;
+        bool bBindless = false;
+    };
+
+    bool ParseOptions(const std::vector<std::string>& args, PermutationsOptions& options)
+    {
+        for (size_t i = 0; i < args.size(); ++i)
+        {
+            const std::string& Arg = args[i];
+
+            if (Arg == "--fxc" && i + 1 < args.size())
+                options.FxcDirectory = args[++i];
+            else if (Arg == "--bindless")
+                options.bBindless = true;
+            else
+            {
+                fprintf(stderr, "unknown option '%s'\n", Arg.c_str());
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::string GetDefineList(uint32_t key)
+    {
+        const char* Defines[ShaderPermutation::FeatureCount];
+        const uint32_t DefineCount = ShaderPermutation::GetDefines(key, Defines);
+
+        std::string List;
+        for (uint32_t i = 0; i < DefineCount; ++i)
+        {
+            List += (List.empty() ? "" : " ") + std::string(Defines[i]);
+        }
+        return List.empty() ? "-" : List;
+    }
+
+    // Same source file choice as D3DSample::BuildShader.
+    const char* GetSourceFile(uint32_t key)
+    {
+        return (key & ShaderFeature_Shadow) ? "../Shader/ShadowMap.hlsl" : "../Shader/Default.hlsl";
+    }
+
+    // Returns the number of problems found.
+    uint32_t Verify(std::set<uint32_t>& vertexKeys, std::set<uint32_t>& pixelKeys)
+    {
+        uint32_t Problems = 0;
+
+        for (uint32_t Key = 0; Key < ShaderPermutation::KeyCount; ++Key)
+        {
+            const uint32_t Index = ShaderPermutation::GetIndex(Key);
+            if (!ShaderPermutation::IsValid(Key))
+            {
+                if (Index != ShaderPermutation::InvalidIndex)
+                {
+                    printf("  invalid key 0x%02x has index %u\n", Key, Index);
+                    ++Problems;
+                }
+                continue;
+            }
+
+            if (Index >= ShaderPermutation::Count || ShaderPermutation::Permutations.Keys[Index] != Key)
+            {
+                printf("  key 0x%02x does not round-trip through its index\n", Key);
+                ++Problems;
+            }
+
+            // The pipelines look their stages up by masked key, so those slots must exist.
+            const uint32_t VertexKey = Key & ShaderPermutation::VertexFeatures;
+            const uint32_t PixelKey = Key & ShaderPermutation::PixelFeatures;
+            if (!ShaderPermutation::IsValid(VertexKey) || !ShaderPermutation::IsValid(PixelKey))
+            {
+                printf("  key 0x%02x masks to an invalid stage key\n", Key);
+                ++Problems;
+            }
+
+            vertexKeys.insert(VertexKey);
+            pixelKeys.insert(PixelKey);
+        }
+
+        if (ShaderPermutation::GetIndex(ShaderPermutation::KeyCount) != ShaderPermutation::InvalidIndex)
+        {
+            printf("  out of range key has an index\n");
+            ++Problems;
+        }
+
+        return Problems;
+    }
+}
+
+int RunPermutations(const std::vector<std::string>& args)
+{
+    PermutationsOptions Options;
+    if (!ParseOptions(args, Options))
+    {
+        fprintf(stderr, "usage: TextureTool permutations [--fxc outdir] [--bindless]\n");
+        return 1;
+    }
+
+    std::set<uint32_t> VertexKeys;
+    std::set<uint32_t> PixelKeys;
+    const uint32_t Problems = Verify(VertexKeys, PixelKeys);
+
+    if (!Options.FxcDirectory.empty())
+    {
+        // One line per distinct stage variant, which is what the sample compiles at startup.
+        // The sample loads these names from ../Shader/Compiled, and bindless builds from its
+        // Bindless subdirectory, before compiling; the defines match its runtime compile.
+        const std::string Bindless = Options.bBindless ? " /D BINDLESS=1" : "";
+        const std::string Directory = Options.FxcDirectory + (Options.bBindless ? "/Bindless" : "");
+        for (const std::set<uint32_t>* Keys : { &VertexKeys, &PixelKeys })
+        {
+            const bool bVertex = Keys == &VertexKeys;
+            for (uint32_t Key : *Keys)
+            {
+                std::string Defines;
+                const char* Names[ShaderPermutation::FeatureCount];
+                const uint32_t DefineCount = ShaderPermutation::GetDefines(Key, Names);
+                for (uint32_t i = 0; i < DefineCount; ++i)
+                {
+                    Defines += " /D " + std::string(Names[i]) + "=1";
+                }
+
+                printf("fxc /nologo /T %s /E %s%s%s /Fo %s/Object%s_%s.cso %s\n",
+                    bVertex ? "vs_5_1" : "ps_5_1", bVertex ? "VS" : "PS", Defines.c_str(), Bindless.c_str(),
+                    Directory.c_str(), bVertex ? "VS" : "PS", ShaderPermutation::GetName(Key).c_str(), GetSourceFile(Key));
+            }
+        }
+        return Problems == 0 ? 0 : 1;
+    }
+
+    printf("%u of %u feature combinations are valid\n", ShaderPermutation::Count, ShaderPermutation::KeyCount);
+    printf("  %5s  %4s  %-28s  %-28s  %-18s  %s\n", "index", "key", "name", "defines", "vertex shader", "pixel shader");
+    for (uint32_t i = 0; i < ShaderPermutation::Count; ++i)
+    {
+        const uint32_t Key = ShaderPermutation::Permutations.Keys[i];
+        printf("  %5u  0x%02x  %-28s  %-28s  %-18s  %s\n", i, Key, ShaderPermutation::GetName(Key).c_str(), GetDefineList(Key).c_str(),
+            ShaderPermutation::GetName(Key & ShaderPermutation::VertexFeatures).c_str(),
+            ShaderPermutation::GetName(Key & ShaderPermutation::PixelFeatures).c_str());
+    }
+
+    printf("  %zu vertex and %zu pixel shader variants feed %u pipeline states\n", VertexKeys.size(), PixelKeys.size(), ShaderPermutation::Count);
+
+    // Skinned, instanced and shadow combine to six vertex variants, and fog, alpha test and
+    // shadow to six pixel variants once fogged shadows are ruled out.
+    bool bOk = Problems == 0;
+    if (VertexKeys.size() != 6 || PixelKeys.size() != 6)
+    {
+        printf("  expected 6 vertex and 6 pixel shader variants\n");
+        bOk = false;
+    }
+
+    printf(bOk ? "ok\n" : "FAILED\n");
+    return bOk ? 0 : 1;
+}
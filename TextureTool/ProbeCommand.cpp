@@ -0,0 +1,416 @@
+#include "Commands.h"
+#include "DDSFile.h"
+#include "../Common/DDSProbe.h"
+#include "../Common/ThreadPool.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <map>
+
+namespace
+{
+    struct ProbeOptions
+    {
+        bool bRecursive = false;
+        bool bCsv = false;
+        bool bSummaryOnly = false;
+        bool bVerify = false;
+        size_t ThreadCount = 0;
+        std::vector<std::string> Inputs;
+    };
+
+    struct ProbeResult
+    {
+        std::string Path;
+        bool bOpened = false;
+        DDS::Status Status = DDS::Status::InvalidData;
+        DDS::ProbeInfo Info;
+    };
+
+    bool ParseOptions(const std::vector<std::string>& args, ProbeOptions& options)
+    {
+        for (size_t i = 0; i < args.size(); ++i)
+        {
+            const std::string& Arg = args[i];
+
+            if (Arg == "-r")
+                options.bRecursive = true;
+            else if (Arg == "--csv")
+                options.bCsv = true;
+            else if (Arg == "--summary")
+                options.bSummaryOnly = true;
+            else if (Arg == "--verify")
+                options.bVerify = true;
+            else if (Arg == "-j" && i + 1 < args.size())
+                options.ThreadCount = (size_t)atoi(args[++i].c_str());
+            else if (!Arg.empty() && Arg[0] == '-')
+            {
+                fprintf(stderr, "unknown option '%s'\n", Arg.c_str());
+                return false;
+            }
+            else
+                options.Inputs.push_back(Arg);
+        }
+
+        return options.bVerify || !options.Inputs.empty();
+    }
+
+    const char* GetStatusName(DDS::Status status)
+    {
+        switch (status)
+        {
+        case DDS::Status::Ok:           return "ok";
+        case DDS::Status::InvalidData:  return "invalid";
+        case DDS::Status::NotSupported: return "unsupported";
+        case DDS::Status::EndOfFile:    return "truncated";
+        }
+        return "?";
+    }
+
+    std::string GetFormatLabel(DXGI_FORMAT format)
+    {
+        const char* Name = GetFormatName(format);
+        return strcmp(Name, "UNKNOWN") != 0 ? Name : "DXGI_FORMAT_" + std::to_string((uint32_t)format);
+    }
+
+    bool HasDDSExtension(const std::filesystem::path& path)
+    {
+        std::string Extension = path.extension().string();
+        std::transform(Extension.begin(), Extension.end(), Extension.begin(), [](unsigned char c) { return (char)tolower(c); });
+        return Extension == ".dds";
+    }
+
+    // Directories contribute their .dds files; anything else is probed as given.
+    void CollectFiles(const std::vector<std::string>& inputs, bool bRecursive, std::vector<std::string>& outFiles)
+    {
+        namespace fs = std::filesystem;
+
+        for (const std::string& Input : inputs)
+        {
+            std::error_code Error;
+            if (!fs::is_directory(Input, Error))
+            {
+                outFiles.push_back(Input);
+                continue;
+            }
+
+            auto AddEntry = [&](const fs::directory_entry& Entry)
+            {
+                if (Entry.is_regular_file(Error) && HasDDSExtension(Entry.path()))
+                    outFiles.push_back(Entry.path().string());
+            };
+
+            if (bRecursive)
+            {
+                for (const fs::directory_entry& Entry : fs::recursive_directory_iterator(Input, fs::directory_options::skip_permission_denied, Error))
+                    AddEntry(Entry);
+            }
+            else
+            {
+                for (const fs::directory_entry& Entry : fs::directory_iterator(Input, Error))
+                    AddEntry(Entry);
+            }
+        }
+
+        std::sort(outFiles.begin(), outFiles.end());
+        outFiles.erase(std::unique(outFiles.begin(), outFiles.end()), outFiles.end());
+    }
+
+    void PrintResult(const ProbeResult& result, bool bCsv)
+    {
+        const DDS::TextureDesc& Desc = result.Info.Desc;
+
+        if (bCsv)
+        {
+            printf("%s,%s,%u,%u,%u,%u,%u,%d,%s,%llu,%llu", result.Path.c_str(),
+                result.bOpened ? GetStatusName(result.Status) : "unreadable",
+                Desc.Width, Desc.Height, Desc.Depth, Desc.MipCount, Desc.ArraySize, Desc.IsCubeMap ? 1 : 0,
+                GetFormatLabel(Desc.Format).c_str(), (unsigned long long)result.Info.TotalBytes,
+                (unsigned long long)result.Info.FileSize);
+
+            for (uint32_t Mip = 0; Mip < Desc.MipCount && result.Status == DDS::Status::Ok; ++Mip)
+            {
+                printf(",%llu", (unsigned long long)result.Info.MipBytes[Mip]);
+            }
+            printf("\n");
+            return;
+        }
+
+        const std::string Name = GetFileName(result.Path);
+
+        if (!result.bOpened)
+        {
+            printf("%-28s unreadable\n", Name.c_str());
+            return;
+        }
+
+        if (result.Status != DDS::Status::Ok && result.Status != DDS::Status::EndOfFile)
+        {
+            printf("%-28s %s\n", Name.c_str(), GetStatusName(result.Status));
+            return;
+        }
+
+        char Size[64];
+        snprintf(Size, sizeof(Size), "%ux%ux%u", Desc.Width, Desc.Height, Desc.Depth);
+
+        printf("%-28s %-16s %2u mips  %4u %-5s  %-20s %10.1f KB%s\n", Name.c_str(), Size, Desc.MipCount,
+            Desc.ArraySize, Desc.IsCubeMap ? "cube" : "array", GetFormatLabel(Desc.Format).c_str(),
+            result.Info.TotalBytes / 1024.0, result.Status == DDS::Status::EndOfFile ? "  (truncated)" : "");
+    }
+
+    void PrintSummary(const std::vector<ProbeResult>& results, double seconds)
+    {
+        struct FormatTotal
+        {
+            size_t Count = 0;
+            uint64_t Bytes = 0;
+        };
+
+        std::map<std::string, FormatTotal> ByFormat;
+        size_t Usable = 0;
+        uint64_t TotalBytes = 0;
+        uint64_t TopMipBytes = 0;
+
+        for (const ProbeResult& Result : results)
+        {
+            if (!Result.bOpened || Result.Status != DDS::Status::Ok)
+                continue;
+
+            FormatTotal& Total = ByFormat[GetFormatLabel(Result.Info.Desc.Format)];
+            ++Total.Count;
+            Total.Bytes += Result.Info.TotalBytes;
+
+            ++Usable;
+            TotalBytes += Result.Info.TotalBytes;
+            TopMipBytes += Result.Info.MipBytes[0] * Result.Info.Desc.ArraySize;
+        }
+
+        printf("\n");
+        for (const auto& Entry : ByFormat)
+        {
+            printf("  %-20s %6zu files %12.1f MB\n", Entry.first.c_str(), Entry.second.Count, Entry.second.Bytes / (1024.0 * 1024.0));
+        }
+
+        // Streaming keeps everything but the top levels resident, so the tail is the
+        // lower bound of a texture budget.
+        printf("%zu files, %zu usable, %zu rejected: %.1f MB of texels, %.1f MB without the top mips\n",
+            results.size(), Usable, results.size() - Usable, TotalBytes / (1024.0 * 1024.0),
+            (TotalBytes - TopMipBytes) / (1024.0 * 1024.0));
+        printf("probed in %.1f ms (%.0f files/s)\n", seconds * 1000.0, seconds > 0.0 ? results.size() / seconds : 0.0);
+    }
+
+    // Checks the constexpr tables against the runtime functions in DDSHeader.cpp, and
+    // ProbeHeader against ParseHeader + GetTextureDesc on real and mutated headers.
+    int Verify(const std::vector<std::string>& files)
+    {
+        size_t Checks = 0;
+        size_t Failures = 0;
+
+        auto Check = [&](bool bOk, const char* what, uint32_t a, uint32_t b)
+        {
+            ++Checks;
+            if (!bOk && ++Failures <= 20)
+                fprintf(stderr, "mismatch: %s (%u, %u)\n", what, a, b);
+        };
+
+        const uint32_t Sizes[] = { 0, 1, 2, 3, 4, 5, 7, 8, 13, 64, 333, 1023, 4096 };
+
+        for (uint32_t Format = 0; Format < 256; ++Format)
+        {
+            const DXGI_FORMAT Fmt = (DXGI_FORMAT)Format;
+            Check(DDS::GetFormatInfo(Fmt).BitsPerPixel == DDS::BitsPerPixel(Fmt), "bits per pixel", Format, 0);
+
+            for (uint32_t Width : Sizes)
+            {
+                for (uint32_t Height : Sizes)
+                {
+                    size_t NumBytes = 0, RowBytes = 0, NumRows = 0;
+                    DDS::GetSurfaceInfo(Width, Height, Fmt, &NumBytes, &RowBytes, &NumRows);
+
+                    const DDS::SurfaceSize Size = DDS::ComputeSurfaceSize(Width, Height, Fmt);
+                    Check(Size.NumBytes == NumBytes && Size.RowBytes == RowBytes && Size.NumRows == NumRows,
+                        "surface size", Format, Width * 10000 + Height);
+                }
+            }
+        }
+
+        // Legacy pixel formats: every table entry plus random near misses.
+        uint32_t Seed = 12345;
+        auto Random = [&]() { Seed = Seed * 1664525u + 1013904223u; return Seed; };
+
+        const uint32_t Flags[] = { DDS_RGB, DDS_LUMINANCE, DDS_ALPHA, DDS_FOURCC, DDS_RGB | DDS_ALPHA, DDS_FOURCC | DDS_RGB, 0 };
+        for (int i = 0; i < 200000; ++i)
+        {
+            const DDS::Detail::LegacyFormat& Base = DDS::Detail::LegacyFormatTable[Random() % (sizeof(DDS::Detail::LegacyFormatTable) / sizeof(DDS::Detail::LegacyFormatTable[0]))];
+
+            DDS_PIXELFORMAT Pixel = {};
+            Pixel.size = sizeof(DDS_PIXELFORMAT);
+            Pixel.flags = (i & 3) ? Base.Flags : Flags[Random() % 7];
+            Pixel.fourCC = Base.FourCC;
+            Pixel.RGBBitCount = Base.BitCount;
+            Pixel.RBitMask = Base.RMask;
+            Pixel.GBitMask = Base.GMask;
+            Pixel.BBitMask = Base.BMask;
+            Pixel.ABitMask = Base.AMask;
+
+            // Flip one field now and then.
+            switch (i % 8 == 0 ? Random() % 6 : 6)
+            {
+            case 0: Pixel.fourCC ^= 1u << (Random() % 32); break;
+            case 1: Pixel.RGBBitCount = (Random() % 5) * 8; break;
+            case 2: Pixel.RBitMask ^= 1u << (Random() % 32); break;
+            case 3: Pixel.GBitMask = 0; break;
+            case 4: Pixel.ABitMask ^= 0xff000000; break;
+            case 5: Pixel.fourCC = Random() % 128; break;
+            }
+
+            Check(DDS::FindLegacyFormat(Pixel) == DDS::GetDXGIFormat(Pixel), "legacy format", Pixel.flags, Pixel.fourCC);
+        }
+
+        // Headers: the files given plus mutated copies of them.
+        size_t HeadersCompared = 0;
+        size_t MipCountRejects = 0;
+
+        auto CompareHeader = [&](const uint8_t* data, size_t size)
+        {
+            DDS::FileView View;
+            DDS::TextureDesc Desc;
+            DDS::Status Expected = DDS::ParseHeader(data, size, View);
+            if (Expected == DDS::Status::Ok)
+                Expected = DDS::GetTextureDesc(View, Desc);
+
+            DDS::ProbeInfo Info;
+            const DDS::Status Actual = DDS::ProbeHeader(data, size, Info);
+            ++HeadersCompared;
+
+            // The probe also refuses mip counts the dimensions cannot have.
+            if (Expected == DDS::Status::Ok && Actual == DDS::Status::InvalidData &&
+                Desc.MipCount > DDS::GetFullMipCount(Desc.Width, Desc.Height, Desc.Depth))
+            {
+                ++MipCountRejects;
+                return;
+            }
+
+            Check(Expected == Actual, "header status", (uint32_t)Expected, (uint32_t)Actual);
+            if (Expected != DDS::Status::Ok || Actual != DDS::Status::Ok)
+                return;
+
+            const DDS::TextureDesc& Probed = Info.Desc;
+            Check(Probed.Width == Desc.Width && Probed.Height == Desc.Height && Probed.Depth == Desc.Depth &&
+                Probed.MipCount == Desc.MipCount && Probed.ArraySize == Desc.ArraySize && Probed.Format == Desc.Format &&
+                Probed.IsCubeMap == Desc.IsCubeMap && Probed.Dimension == Desc.Dimension, "texture desc", Desc.Width, Probed.Width);
+
+            Check(Info.DataOffset == size_t(View.BitData - data), "data offset", Info.DataOffset, (uint32_t)(View.BitData - data));
+        };
+
+        for (const std::string& File : files)
+        {
+            std::vector<uint8_t> Header(DDS::ProbeHeaderSize, 0);
+
+            FILE* Input = fopen(File.c_str(), "rb");
+            if (Input == nullptr)
+                continue;
+            const size_t Read = fread(Header.data(), 1, Header.size(), Input);
+            fclose(Input);
+
+            // The whole file must agree with the subresource layout the loaders compute.
+            DDS::ProbeInfo Info;
+            DDS::Status Status;
+            if (DDS::ProbeFile(File.c_str(), Info, Status) && Status == DDS::Status::Ok)
+            {
+                std::vector<uint8_t> Data(Info.FileSize);
+                Input = fopen(File.c_str(), "rb");
+                const size_t FileRead = Input ? fread(Data.data(), 1, Data.size(), Input) : 0;
+                if (Input)
+                    fclose(Input);
+
+                DDS::FileView View;
+                DDS::TextureDesc Desc;
+                std::vector<DDS::Subresource> Layout;
+                const bool bLoaded = DDS::ParseHeader(Data.data(), FileRead, View) == DDS::Status::Ok &&
+                    DDS::GetTextureDesc(View, Desc) == DDS::Status::Ok &&
+                    DDS::GetSubresourceLayout(Desc, View.BitSize, Layout) == DDS::Status::Ok;
+
+                uint64_t LayoutBytes = 0;
+                for (const DDS::Subresource& Sub : Layout)
+                {
+                    LayoutBytes += (uint64_t)Sub.SlicePitch * Sub.Depth;
+                }
+                Check(bLoaded && LayoutBytes == Info.TotalBytes, "total bytes", (uint32_t)LayoutBytes, (uint32_t)Info.TotalBytes);
+            }
+
+            CompareHeader(Header.data(), Read);
+
+            for (int i = 0; i < 20000; ++i)
+            {
+                std::vector<uint8_t> Mutated(Header.begin(), Header.begin() + Read);
+                const int Edits = 1 + Random() % 3;
+                for (int Edit = 0; Edit < Edits && !Mutated.empty(); ++Edit)
+                {
+                    Mutated[Random() % Mutated.size()] ^= (uint8_t)(1u << (Random() % 8));
+                }
+
+                // Also try short buffers.
+                const size_t Size = (i % 16 == 0) ? Random() % (Mutated.size() + 1) : Mutated.size();
+                CompareHeader(Mutated.data(), Size);
+            }
+        }
+
+        printf("%zu checks, %zu headers (%zu with impossible mip counts), %zu mismatches\n",
+            Checks, HeadersCompared, MipCountRejects, Failures);
+        return Failures == 0 ? 0 : 1;
+    }
+}
+
+int RunProbe(const std::vector<std::string>& args)
+{
+    ProbeOptions Options;
+    if (!ParseOptions(args, Options))
+    {
+        fprintf(stderr, "usage: TextureTool probe [-r] [--csv] [--summary] [-j threads] <dir|file.dds>...\n"
+                        "       TextureTool probe --verify [file.dds...]\n");
+        return 1;
+    }
+
+    std::vector<std::string> Files;
+    CollectFiles(Options.Inputs, Options.bRecursive, Files);
+
+    if (Options.bVerify)
+        return Verify(Files);
+
+    auto StartTime = std::chrono::high_resolution_clock::now();
+
+    // The work per file is an open and a 148 byte read, so the threads mostly overlap I/O.
+    std::vector<ProbeResult> Results(Files.size());
+    ThreadPool Pool(Options.ThreadCount);
+    Pool.ParallelFor(Files.size(), [&](size_t i)
+    {
+        ProbeResult& Result = Results[i];
+        Result.Path = Files[i];
+        Result.bOpened = DDS::ProbeFile(Files[i].c_str(), Result.Info, Result.Status);
+    });
+
+    auto EndTime = std::chrono::high_resolution_clock::now();
+    const double Seconds = std::chrono::duration<double>(EndTime - StartTime).count();
+
+    if (Options.bCsv)
+        printf("path,status,width,height,depth,mips,array,cube,format,bytes,file_bytes,mip_bytes...\n");
+
+    if (!Options.bSummaryOnly)
+    {
+        for (const ProbeResult& Result : Results)
+        {
+            PrintResult(Result, Options.bCsv);
+        }
+    }
+
+    if (!Options.bCsv)
+        PrintSummary(Results, Seconds);
+
+    return 0;
+}
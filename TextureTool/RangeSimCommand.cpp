@@ -0,0 +1,175 @@
+#include "Commands.h"
+#include "../Common/RangeAllocator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+namespace
+{
+    struct RangeSimOptions
+    {
+        uint32_t Capacity = 1 << 20;
+        uint32_t Operations = 200000;
+        uint32_t MaxCount = 8192;
+        uint32_t Seed = 1;
+    };
+
+    bool ParseOptions(const std::vector<std::string>& args, RangeSimOptions& options)
+    {
+        for (size_t i = 0; i < args.size(); ++i)
+        {
+            const std::string& Arg = args[i];
+
+            if (Arg == "--capacity" && i + 1 < args.size())
+                options.Capacity = (uint32_t)(std::max)(atoi(args[++i].c_str()), 1);
+            else if (Arg == "--ops" && i + 1 < args.size())
+                options.Operations = (uint32_t)(std::max)(atoi(args[++i].c_str()), 1);
+            else if (Arg == "--max" && i + 1 < args.size())
+                options.MaxCount = (uint32_t)(std::max)(atoi(args[++i].c_str()), 1);
+            else if (Arg == "--seed" && i + 1 < args.size())
+                options.Seed = (uint32_t)atoi(args[++i].c_str());
+            else
+            {
+                fprintf(stderr, "unknown option '%s'\n", Arg.c_str());
+                return false;
+            }
+        }
+        return true;
+    }
+
+    struct LiveRange
+    {
+        uint32_t Offset;
+        uint32_t Count;
+    };
+}
+
+int RunRangeSim(const std::vector<std::string>& args)
+{
+    RangeSimOptions Options;
+    if (!ParseOptions(args, Options))
+    {
+        fprintf(stderr, "usage: TextureTool range-sim [--capacity n] [--ops n] [--max n] [--seed n]\n");
+        return 1;
+    }
+
+    printf("capacity %u, %u operations, ranges of 1..%u\n", Options.Capacity, Options.Operations, Options.MaxCount);
+
+    std::mt19937 Random(Options.Seed);
+
+    RangeAllocator Allocator;
+    Allocator.Reset(Options.Capacity);
+
+    // Owner of every unit, to catch overlapping ranges.
+    std::vector<uint32_t> Owner(Options.Capacity, 0);
+    std::vector<LiveRange> Live;
+
+    uint32_t Allocations = 0;
+    uint32_t Failures = 0;
+    uint32_t Overlaps = 0;
+    uint32_t BadCounts = 0;
+    uint32_t MaxFreeRanges = 0;
+    double WorstFragmentation = 0.0;
+    uint32_t NextId = 1;
+
+    typedef std::chrono::high_resolution_clock Clock;
+    double AllocatorMilliseconds = 0.0;
+
+    for (uint32_t Op = 0; Op < Options.Operations; ++Op)
+    {
+        // Drift between mostly allocating and mostly freeing so the buffer fills and drains.
+        const bool bFillPhase = (Op / 20000) % 2 == 0;
+        const bool bAllocate = Live.empty() || (Random() % 100) < (bFillPhase ? 65u : 35u);
+
+        if (bAllocate)
+        {
+            const uint32_t Count = 1 + Random() % Options.MaxCount;
+
+            const Clock::time_point Start = Clock::now();
+            const uint32_t Offset = Allocator.Allocate(Count);
+            AllocatorMilliseconds += std::chrono::duration<double, std::milli>(Clock::now() - Start).count();
+
+            if (Offset == RangeAllocator::InvalidOffset)
+            {
+                ++Failures;
+                continue;
+            }
+
+            ++Allocations;
+            const uint32_t Id = NextId++;
+            for (uint32_t i = Offset; i < Offset + Count; ++i)
+            {
+                if (i >= Options.Capacity || Owner[i] != 0)
+                    ++Overlaps;
+                else
+                    Owner[i] = Id;
+            }
+            Live.push_back({ Offset, Count });
+        }
+        else
+        {
+            const size_t Index = Random() % Live.size();
+            const LiveRange Range = Live[Index];
+            Live[Index] = Live.back();
+            Live.pop_back();
+
+            for (uint32_t i = Range.Offset; i < Range.Offset + Range.Count; ++i)
+            {
+                Owner[i] = 0;
+            }
+
+            const Clock::time_point Start = Clock::now();
+            Allocator.Free(Range.Offset, Range.Count);
+            AllocatorMilliseconds += std::chrono::duration<double, std::milli>(Clock::now() - Start).count();
+        }
+
+        uint32_t LiveCount = 0;
+        for (const LiveRange& Range : Live)
+        {
+            LiveCount += Range.Count;
+        }
+        if (LiveCount != Allocator.GetUsedCount())
+            ++BadCounts;
+
+        MaxFreeRanges = (std::max)(MaxFreeRanges, Allocator.GetFreeRangeCount());
+
+        // Share of the free space not in the largest free range.
+        if (Allocator.GetFreeCount() > 0)
+            WorstFragmentation = (std::max)(WorstFragmentation, 1.0 - (double)Allocator.GetLargestFreeRange() / Allocator.GetFreeCount());
+    }
+
+    // Freeing everything has to merge back into one range covering the whole capacity.
+    for (const LiveRange& Range : Live)
+    {
+        Allocator.Free(Range.Offset, Range.Count);
+    }
+    const bool bMerged = Allocator.GetFreeRangeCount() == 1 && Allocator.GetLargestFreeRange() == Options.Capacity;
+
+    printf("  allocations      %u (%u did not fit)\n", Allocations, Failures);
+    printf("  free ranges      %u at most\n", MaxFreeRanges);
+    printf("  fragmentation    %.1f%% of free space outside the largest range at worst\n", WorstFragmentation * 100.0);
+    printf("  time             %.3f us per operation\n", AllocatorMilliseconds * 1000.0 / Options.Operations);
+
+    bool bOk = true;
+    if (Overlaps != 0)
+    {
+        printf("    %u units handed out twice or past the capacity\n", Overlaps);
+        bOk = false;
+    }
+    if (BadCounts != 0)
+    {
+        printf("    used count disagreed with the live ranges %u times\n", BadCounts);
+        bOk = false;
+    }
+    if (!bMerged)
+    {
+        printf("    freeing everything left %u free ranges\n", Allocator.GetFreeRangeCount());
+        bOk = false;
+    }
+
+    printf(bOk ? "ok\n" : "FAILED\n");
+    return bOk ? 0 : 1;
+}
@@ -0,0 +1,274 @@
+#include "Commands.h"
+#include "../Common/AsyncFileQueue.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    struct ReadBenchOptions
+    {
+        FileIOBackend Backend = FileIOBackend::Auto;
+        uint32_t QueueDepth = 32;
+        uint32_t Passes = 3;
+        bool bCold = false;
+        std::vector<std::string> Inputs;
+    };
+
+    bool ParseOptions(const std::vector<std::string>& args, ReadBenchOptions& options)
+    {
+        for (size_t i = 0; i < args.size(); ++i)
+        {
+            const std::string& Arg = args[i];
+
+            if (Arg == "--backend" && i + 1 < args.size())
+            {
+                const std::string& Name = args[++i];
+                if (Name == "auto")
+                    options.Backend = FileIOBackend::Auto;
+                else if (Name == "threads")
+                    options.Backend = FileIOBackend::Threads;
+                else if (Name == "native")
+                    options.Backend = FileIOBackend::Native;
+                else
+                {
+                    fprintf(stderr, "unknown backend '%s'\n", Name.c_str());
+                    return false;
+                }
+            }
+            else if (Arg == "--depth" && i + 1 < args.size())
+                options.QueueDepth = (uint32_t)(std::max)(atoi(args[++i].c_str()), 1);
+            else if (Arg == "--passes" && i + 1 < args.size())
+                options.Passes = (uint32_t)(std::max)(atoi(args[++i].c_str()), 1);
+            else if (Arg == "--cold")
+                options.bCold = true;
+            else if (!Arg.empty() && Arg[0] == '-')
+            {
+                fprintf(stderr, "unknown option '%s'\n", Arg.c_str());
+                return false;
+            }
+            else
+                options.Inputs.push_back(Arg);
+        }
+
+        return !options.Inputs.empty();
+    }
+
+    void CollectFiles(const std::vector<std::string>& inputs, std::vector<std::string>& outFiles)
+    {
+        namespace fs = std::filesystem;
+
+        for (const std::string& Input : inputs)
+        {
+            std::error_code Error;
+            if (!fs::is_directory(Input, Error))
+            {
+                outFiles.push_back(Input);
+                continue;
+            }
+
+            for (const fs::directory_entry& Entry : fs::recursive_directory_iterator(Input, fs::directory_options::skip_permission_denied, Error))
+            {
+                if (Entry.is_regular_file(Error))
+                    outFiles.push_back(Entry.path().string());
+            }
+        }
+
+        std::sort(outFiles.begin(), outFiles.end());
+    }
+
+    // Asks the OS to forget the cached pages of every file.  Only clean pages are dropped,
+    // which is all a read-only benchmark leaves behind.
+    bool DropCache(const std::vector<std::string>& files)
+    {
+#if defined(_WIN32)
+        (void)files;
+        return false;
+#else
+        for (const std::string& File : files)
+        {
+            int Handle = open(File.c_str(), O_RDONLY);
+            if (Handle < 0)
+                continue;
+            posix_fadvise(Handle, 0, 0, POSIX_FADV_DONTNEED);
+            close(Handle);
+        }
+        return true;
+#endif
+    }
+
+    // What the loaders did before: one std::ifstream read after another, each into its own
+    // buffer like the queue's results.
+    uint64_t ReadBlocking(const std::vector<std::string>& files)
+    {
+        uint64_t Bytes = 0;
+
+        for (const std::string& File : files)
+        {
+            std::ifstream Input(File, std::ios::binary | std::ios::ate);
+            if (!Input)
+                continue;
+
+            std::vector<char> Buffer((size_t)Input.tellg());
+            Input.seekg(0);
+            Input.read(Buffer.data(), (std::streamsize)Buffer.size());
+            Bytes += (uint64_t)Input.gcount();
+        }
+
+        return Bytes;
+    }
+
+    uint64_t ReadQueued(AsyncFileQueue& queue, const std::vector<std::string>& files, uint32_t& outFailed)
+    {
+        std::vector<std::future<FileReadResult>> Reads;
+        Reads.reserve(files.size());
+        for (const std::string& File : files)
+        {
+            Reads.push_back(queue.Read(File));
+        }
+
+        uint64_t Bytes = 0;
+        for (std::future<FileReadResult>& Read : Reads)
+        {
+            FileReadResult Result = Read.get();
+            Bytes += Result.BytesRead;
+            if (!Result.bOk)
+                ++outFailed;
+        }
+
+        return Bytes;
+    }
+
+    // Same reads into buffers the caller owns, which leaves out the allocation and first-touch
+    // cost of the result buffers.
+    uint64_t ReadQueuedInto(AsyncFileQueue& queue, const std::vector<std::string>& files,
+        std::vector<std::vector<uint8_t>>& buffers, uint32_t& outFailed)
+    {
+        std::vector<std::future<FileReadResult>> Reads;
+        Reads.reserve(files.size());
+        for (size_t i = 0; i < files.size(); ++i)
+        {
+            auto Promise = std::make_shared<std::promise<FileReadResult>>();
+            Reads.push_back(Promise->get_future());
+
+            FileReadRequest Request;
+            Request.FileName = files[i];
+            Request.Size = buffers[i].size();
+            Request.Destination = buffers[i].data();
+            Request.OnComplete = [Promise](FileReadResult result) { Promise->set_value(std::move(result)); };
+            queue.Submit(std::move(Request));
+        }
+
+        uint64_t Bytes = 0;
+        for (std::future<FileReadResult>& Read : Reads)
+        {
+            FileReadResult Result = Read.get();
+            Bytes += Result.BytesRead;
+            if (!Result.bOk)
+                ++outFailed;
+        }
+
+        return Bytes;
+    }
+}
+
+int RunReadBench(const std::vector<std::string>& args)
+{
+    ReadBenchOptions Options;
+    if (!ParseOptions(args, Options))
+    {
+        fprintf(stderr, "usage: TextureTool read-bench [--backend auto|threads|native] [--depth n] [--passes n] [--cold] <dir|file>...\n");
+        return 1;
+    }
+
+    std::vector<std::string> Files;
+    CollectFiles(Options.Inputs, Files);
+    if (Files.empty())
+    {
+        fprintf(stderr, "no files to read\n");
+        return 1;
+    }
+
+    if (Options.bCold && !DropCache(Files))
+    {
+        fprintf(stderr, "--cold is not supported on this platform\n");
+        return 1;
+    }
+
+    AsyncFileQueue Queue(Options.QueueDepth, Options.Backend);
+    printf("%zu files, backend %s, queue depth %u, %s cache\n", Files.size(), Queue.GetBackendName(),
+        Options.QueueDepth, Options.bCold ? "cold" : "warm");
+
+    std::vector<std::vector<uint8_t>> Buffers(Files.size());
+    for (size_t i = 0; i < Files.size(); ++i)
+    {
+        // A missing file gets no buffer and shows up as a failed read.
+        std::error_code Error;
+        const uintmax_t Size = std::filesystem::file_size(Files[i], Error);
+        Buffers[i].resize(Error ? 0 : (size_t)Size);
+    }
+
+    // Warm runs read everything once first so that every pass starts from the same state.
+    if (!Options.bCold)
+        ReadBlocking(Files);
+
+    typedef std::chrono::high_resolution_clock Clock;
+
+    double BestBlocking = 0.0;
+    double BestQueued = 0.0;
+    double BestQueuedInto = 0.0;
+    uint64_t Bytes = 0;
+    uint32_t Failed = 0;
+
+    for (uint32_t Pass = 0; Pass < Options.Passes; ++Pass)
+    {
+        if (Options.bCold)
+            DropCache(Files);
+
+        auto Start = Clock::now();
+        Bytes = ReadBlocking(Files);
+        double Seconds = std::chrono::duration<double>(Clock::now() - Start).count();
+        BestBlocking = (std::max)(BestBlocking, Bytes / Seconds);
+
+        if (Options.bCold)
+            DropCache(Files);
+
+        Start = Clock::now();
+        uint64_t QueuedBytes = ReadQueued(Queue, Files, Failed);
+        Seconds = std::chrono::duration<double>(Clock::now() - Start).count();
+        BestQueued = (std::max)(BestQueued, QueuedBytes / Seconds);
+
+        if (Options.bCold)
+            DropCache(Files);
+
+        Start = Clock::now();
+        QueuedBytes = ReadQueuedInto(Queue, Files, Buffers, Failed);
+        Seconds = std::chrono::duration<double>(Clock::now() - Start).count();
+        BestQueuedInto = (std::max)(BestQueuedInto, QueuedBytes / Seconds);
+    }
+
+    const double MB = 1024.0 * 1024.0;
+    auto Ratio = [&](double value) { return BestBlocking > 0.0 ? value / BestBlocking : 0.0; };
+
+    const FileIOStats Stats = Queue.GetStats();
+    printf("%.1f MB per pass, best of %u passes\n", Bytes / MB, Options.Passes);
+    printf("  blocking ifstream       : %8.1f MB/s\n", BestBlocking / MB);
+    printf("  queued, result buffers  : %8.1f MB/s  (%.2fx)\n", BestQueued / MB, Ratio(BestQueued));
+    printf("  queued, caller buffers  : %8.1f MB/s  (%.2fx)\n", BestQueuedInto / MB, Ratio(BestQueuedInto));
+    printf("  %llu requests, %llu chunks, %llu short reads, %llu failed\n",
+        (unsigned long long)Stats.Requests, (unsigned long long)Stats.Chunks,
+        (unsigned long long)Stats.ShortReads, (unsigned long long)Stats.Failed);
+    if (Stats.DriverFailures > 0)
+        printf("  native driver failed, continued with %s\n", Queue.GetBackendName());
+
+    return Failed == 0 ? 0 : 1;
+}
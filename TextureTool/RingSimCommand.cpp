@@ -0,0 +1,294 @@
+#include "Commands.h"
+#include "../Common/RingAllocator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <random>
+
+namespace
+{
+    const uint64_t KB = 1024;
+    const uint64_t MB = 1024 * 1024;
+
+    // D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT, and the size a committed buffer is rounded to.
+    const uint64_t PlacementAlignment = 512;
+    const uint64_t CommittedAlignment = 64 * KB;
+
+    struct RingSimOptions
+    {
+        uint32_t Frames = 600;
+        uint32_t Latency = 3;
+        uint32_t Uploads = 6;
+        uint64_t MaxSize = 2 * MB;
+        uint64_t RingSize = 16 * MB;
+        uint32_t Seed = 1;
+    };
+
+    bool ParseOptions(const std::vector<std::string>& args, RingSimOptions& options)
+    {
+        for (size_t i = 0; i < args.size(); ++i)
+        {
+            const std::string& Arg = args[i];
+
+            if (Arg == "--frames" && i + 1 < args.size())
+                options.Frames = (uint32_t)(std::max)(atoi(args[++i].c_str()), 1);
+            else if (Arg == "--latency" && i + 1 < args.size())
+                options.Latency = (uint32_t)(std::max)(atoi(args[++i].c_str()), 0);
+            else if (Arg == "--uploads" && i + 1 < args.size())
+                options.Uploads = (uint32_t)(std::max)(atoi(args[++i].c_str()), 1);
+            else if (Arg == "--max-kb" && i + 1 < args.size())
+                options.MaxSize = (uint64_t)(std::max)(atoi(args[++i].c_str()), 4) * KB;
+            else if (Arg == "--ring-mb" && i + 1 < args.size())
+                options.RingSize = (uint64_t)(std::max)(atoi(args[++i].c_str()), 1) * MB;
+            else if (Arg == "--seed" && i + 1 < args.size())
+                options.Seed = (uint32_t)atoi(args[++i].c_str());
+            else
+            {
+                fprintf(stderr, "unknown option '%s'\n", Arg.c_str());
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // One load: Size bytes, filled Delay frames after it was requested (the worker's time),
+    // and copied by the GPU in that frame.
+    struct Upload
+    {
+        uint64_t Size;
+        uint32_t Delay;
+    };
+
+    // The same requests for both runs.
+    std::vector<std::vector<Upload>> MakeRequests(const RingSimOptions& options)
+    {
+        std::mt19937 Random(options.Seed);
+        std::vector<std::vector<Upload>> Frames(options.Frames);
+        for (std::vector<Upload>& Frame : Frames)
+        {
+            const uint32_t Count = Random() % (options.Uploads * 2 + 1);
+            for (uint32_t i = 0; i < Count; ++i)
+            {
+                // Mip chains: many small ones, a few near the maximum.
+                const double Scale = std::pow((double)(Random() % 1000) / 1000.0, 3.0);
+                const uint64_t Size = (std::max)((uint64_t)(Scale * options.MaxSize), 4 * KB);
+                Frame.push_back({ Size, (uint32_t)(Random() % 3) });
+            }
+        }
+        return Frames;
+    }
+
+    struct RunResult
+    {
+        double Milliseconds = 0.0;
+        uint64_t Bytes = 0;
+        uint64_t PeakResident = 0;
+        uint64_t BufferCreations = 0;
+        uint64_t Deferred = 0;
+        uint32_t FinishFrame = 0;
+        bool bOk = true;
+    };
+
+    typedef std::chrono::high_resolution_clock Clock;
+
+    // Every upload in a buffer of its own, freed once its fence passes, as
+    // d3dUtil::CreateDefaultBuffer and the per-job streaming buffers did.
+    RunResult RunSeparateBuffers(const RingSimOptions& options, const std::vector<std::vector<Upload>>& requests, const uint8_t* source)
+    {
+        struct LiveBuffer
+        {
+            std::unique_ptr<uint8_t[]> Data;
+            uint64_t Size;
+            uint64_t FenceValue;
+        };
+
+        RunResult Result;
+        std::deque<LiveBuffer> Live;
+        uint64_t Resident = 0;
+
+        const Clock::time_point Start = Clock::now();
+        for (uint32_t Frame = 0; Frame < options.Frames + options.Latency + 3; ++Frame)
+        {
+            const uint64_t Completed = Frame > options.Latency ? Frame - options.Latency : 0;
+            while (!Live.empty() && Live.front().FenceValue <= Completed)
+            {
+                Resident -= Live.front().Size;
+                Live.pop_front();
+            }
+
+            if (Frame >= options.Frames)
+                continue;
+
+            for (const Upload& U : requests[Frame])
+            {
+                const uint64_t Size = (U.Size + CommittedAlignment - 1) & ~(CommittedAlignment - 1);
+                LiveBuffer Buffer = { std::unique_ptr<uint8_t[]>(new uint8_t[Size]), Size, (uint64_t)Frame + 1 + U.Delay };
+                memcpy(Buffer.Data.get(), source, (size_t)U.Size);
+
+                Resident += Size;
+                Result.Bytes += U.Size;
+                ++Result.BufferCreations;
+                Live.push_back(std::move(Buffer));
+            }
+            Result.PeakResident = (std::max)(Result.PeakResident, Resident);
+        }
+        Result.Milliseconds = std::chrono::duration<double, std::milli>(Clock::now() - Start).count();
+        Result.FinishFrame = options.Frames;
+        return Result;
+    }
+
+    RunResult RunRing(const RingSimOptions& options, const std::vector<std::vector<Upload>>& requests, const uint8_t* source)
+    {
+        struct LiveSpan
+        {
+            uint64_t Offset;
+            uint64_t Size;
+            uint64_t FenceValue;
+            uint32_t ReadyFrame;
+        };
+
+        RunResult Result;
+
+        std::unique_ptr<uint8_t[]> Memory(new uint8_t[options.RingSize]);
+        RingAllocator Ring;
+        Ring.Reset(options.RingSize);
+
+        // Allocations in order, mirroring the ring so overlaps can be checked.
+        std::deque<LiveSpan> Live;
+        std::deque<Upload> Waiting;
+
+        // A ring too small for the load falls behind, but it must never stop moving.
+        uint32_t IdleFrames = 0;
+
+        const Clock::time_point Start = Clock::now();
+        uint32_t Frame = 0;
+        for (; Frame < options.Frames || !Waiting.empty() || !Live.empty(); ++Frame)
+        {
+            if (IdleFrames > options.Latency + 4)
+            {
+                printf("    ring stopped with %u loads waiting\n", (uint32_t)Waiting.size());
+                Result.bOk = false;
+                break;
+            }
+
+            const uint64_t Completed = Frame > options.Latency ? Frame - options.Latency : 0;
+            Ring.Reclaim(Completed);
+            while (!Live.empty() && Live.front().FenceValue <= Completed)
+            {
+                Live.pop_front();
+            }
+            if (Ring.GetLiveCount() != (uint32_t)Live.size())
+                Result.bOk = false;
+
+            // Loads the worker finished are copied in this frame.
+            for (LiveSpan& Span : Live)
+            {
+                if (Span.FenceValue == ~0ull && Span.ReadyFrame <= Frame)
+                {
+                    Span.FenceValue = (uint64_t)Frame + 1;
+                    Ring.Retire(Span.Offset, Span.FenceValue);
+                }
+            }
+
+            const size_t LiveBefore = Live.size();
+            if (Frame < options.Frames)
+                Waiting.insert(Waiting.end(), requests[Frame].begin(), requests[Frame].end());
+
+            // Start loads in order until the ring is full, like TextureStreamer.
+            while (!Waiting.empty())
+            {
+                const Upload U = Waiting.front();
+                const uint64_t Offset = Ring.Allocate(U.Size, PlacementAlignment);
+                if (Offset == RingAllocator::InvalidOffset)
+                {
+                    ++Result.Deferred;
+                    break;
+                }
+                Waiting.pop_front();
+
+                if (Offset % PlacementAlignment != 0 || Offset + U.Size > options.RingSize)
+                    Result.bOk = false;
+                for (const LiveSpan& Span : Live)
+                {
+                    if (Offset < Span.Offset + Span.Size && Span.Offset < Offset + U.Size)
+                        Result.bOk = false;
+                }
+
+                memcpy(Memory.get() + Offset, source, (size_t)U.Size);
+                Result.Bytes += U.Size;
+                Live.push_back({ Offset, U.Size, ~0ull, Frame + U.Delay });
+            }
+
+            IdleFrames = !Waiting.empty() && Live.size() == LiveBefore ? IdleFrames + 1 : 0;
+        }
+        Result.Milliseconds = std::chrono::duration<double, std::milli>(Clock::now() - Start).count();
+        Result.PeakResident = options.RingSize;
+        Result.BufferCreations = 1;
+        Result.FinishFrame = Frame;
+
+        if (Ring.GetUsedBytes() != 0)
+            Result.bOk = false;
+        return Result;
+    }
+
+    void PrintResult(const char* name, const RunResult& result)
+    {
+        printf("  %-16s %8.1f MB in %7.2f ms (%7.0f MB/s), %6llu buffers, %6llu MB resident at peak\n", name,
+            (double)result.Bytes / MB, result.Milliseconds, result.Milliseconds > 0.0 ? (double)result.Bytes / MB / (result.Milliseconds / 1000.0) : 0.0,
+            (unsigned long long)result.BufferCreations, (unsigned long long)(result.PeakResident / MB));
+    }
+}
+
+int RunRingSim(const std::vector<std::string>& args)
+{
+    RingSimOptions Options;
+    if (!ParseOptions(args, Options))
+    {
+        fprintf(stderr, "usage: TextureTool ring-sim [--frames n] [--latency n] [--uploads n] [--max-kb n] [--ring-mb n] [--seed n]\n");
+        return 1;
+    }
+
+    printf("%u frames, %u frames of GPU latency, about %u uploads a frame up to %llu KB, %llu MB ring\n",
+        Options.Frames, Options.Latency, Options.Uploads, (unsigned long long)(Options.MaxSize / KB), (unsigned long long)(Options.RingSize / MB));
+
+    if (Options.MaxSize > Options.RingSize)
+    {
+        fprintf(stderr, "the ring must hold the largest upload\n");
+        return 1;
+    }
+
+    const std::vector<std::vector<Upload>> Requests = MakeRequests(Options);
+
+    std::unique_ptr<uint8_t[]> Source(new uint8_t[Options.MaxSize]);
+    std::mt19937 Random(Options.Seed);
+    for (uint64_t i = 0; i < Options.MaxSize; ++i)
+    {
+        Source[i] = (uint8_t)Random();
+    }
+
+    const RunResult Separate = RunSeparateBuffers(Options, Requests, Source.get());
+    const RunResult Ring = RunRing(Options, Requests, Source.get());
+
+    PrintResult("separate buffers", Separate);
+    PrintResult("upload ring", Ring);
+    printf("  ring             %llu loads waited a frame for space, last load copied in frame %u\n",
+        (unsigned long long)Ring.Deferred, Ring.FinishFrame);
+
+    bool bOk = Ring.bOk;
+    if (Ring.Bytes != Separate.Bytes)
+    {
+        printf("    ring uploaded %llu bytes, expected %llu\n", (unsigned long long)Ring.Bytes, (unsigned long long)Separate.Bytes);
+        bOk = false;
+    }
+    if (!Ring.bOk)
+        printf("    ring handed out overlapping or misaligned space, or stopped\n");
+
+    printf(bOk ? "ok\n" : "FAILED\n");
+    return bOk ? 0 : 1;
+}
@@ -0,0 +1,363 @@
+#include "Commands.h"
+#include "../Common/FrustumCuller.h"
+#include "../Common/VegetationScatter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_map>
+
+namespace
+{
+    struct ScatterBenchOptions
+    {
+        float Size = 1024.0f;
+        float CellSize = 32.0f;
+        uint32_t Repeats = 20;
+        uint64_t Seed = 0x5EED;
+    };
+
+    bool ParseOptions(const std::vector<std::string>& args, ScatterBenchOptions& options)
+    {
+        for (size_t i = 0; i < args.size(); ++i)
+        {
+            const std::string& Arg = args[i];
+
+            if (Arg == "--size" && i + 1 < args.size())
+                options.Size = (std::max)((float)atof(args[++i].c_str()), 16.0f);
+            else if (Arg == "--cell" && i + 1 < args.size())
+                options.CellSize = (std::max)((float)atof(args[++i].c_str()), 1.0f);
+            else if (Arg == "--repeats" && i + 1 < args.size())
+                options.Repeats = (uint32_t)(std::max)(atoi(args[++i].c_str()), 1);
+            else if (Arg == "--seed" && i + 1 < args.size())
+                options.Seed = strtoull(args[++i].c_str(), nullptr, 0);
+            else
+            {
+                fprintf(stderr, "unknown option '%s'\n", Arg.c_str());
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // The sample's two layers (D3DSample::CreateTreeGeometry).  Their height ranges do not
+    // overlap, so the checks below can tell an instance's layer from its height.
+    std::vector<VegetationLayerDesc> SampleLayers()
+    {
+        std::vector<VegetationLayerDesc> Layers(2);
+
+        Layers[0].MinDistance = 3.0f;
+        Layers[0].MinHeight = 8.0f;
+        Layers[0].MaxHeight = 12.0f;
+        Layers[0].DrawDistance = 200.0f;
+
+        Layers[1].MinDistance = 2.0f;
+        Layers[1].MinHeight = 1.0f;
+        Layers[1].MaxHeight = 2.0f;
+        Layers[1].Aspect = 1.5f;
+        Layers[1].DrawDistance = 60.0f;
+
+        return Layers;
+    }
+
+    size_t LayerOf(const VegetationInstance& instance, const std::vector<VegetationLayerDesc>& layers)
+    {
+        for (size_t l = 0; l < layers.size(); ++l)
+        {
+            if (instance.Size[1] >= layers[l].MinHeight && instance.Size[1] <= layers[l].MaxHeight)
+                return l;
+        }
+        return layers.size();
+    }
+
+    // Pairs of the same layer closer than the layer's minimum distance, found through a
+    // hash grid with cells of that distance.
+    uint32_t CountSpacingViolations(const std::vector<VegetationInstance>& instances, const std::vector<VegetationLayerDesc>& layers)
+    {
+        uint32_t Violations = 0;
+
+        for (size_t l = 0; l < layers.size(); ++l)
+        {
+            const float Radius = layers[l].MinDistance;
+
+            auto Key = [](int64_t x, int64_t z) { return (x << 32) ^ (z & 0xffffffff); };
+
+            std::unordered_map<int64_t, std::vector<uint32_t>> Grid;
+            for (uint32_t i = 0; i < (uint32_t)instances.size(); ++i)
+            {
+                if (LayerOf(instances[i], layers) != l)
+                    continue;
+
+                const int64_t x = (int64_t)std::floor(instances[i].Position[0] / Radius);
+                const int64_t z = (int64_t)std::floor(instances[i].Position[2] / Radius);
+                Grid[Key(x, z)].push_back(i);
+            }
+
+            for (const auto& Entry : Grid)
+            {
+                for (uint32_t i : Entry.second)
+                {
+                    const VegetationInstance& A = instances[i];
+                    const int64_t x = (int64_t)std::floor(A.Position[0] / Radius);
+                    const int64_t z = (int64_t)std::floor(A.Position[2] / Radius);
+
+                    for (int64_t dz = -1; dz <= 1; ++dz)
+                    {
+                        for (int64_t dx = -1; dx <= 1; ++dx)
+                        {
+                            auto Neighbors = Grid.find(Key(x + dx, z + dz));
+                            if (Neighbors == Grid.end())
+                                continue;
+
+                            for (uint32_t j : Neighbors->second)
+                            {
+                                if (j <= i)
+                                    continue;
+
+                                const VegetationInstance& B = instances[j];
+                                const float ddx = A.Position[0] - B.Position[0];
+                                const float ddz = A.Position[2] - B.Position[2];
+                                if (ddx * ddx + ddz * ddz < Radius * Radius)
+                                    ++Violations;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        return Violations;
+    }
+
+    // Row-vector matrices in the DirectXMath layout, built the way XMMatrixLookToLH and
+    // XMMatrixPerspectiveFovLH build them.
+    struct Matrix
+    {
+        float m[16];
+    };
+
+    Matrix Multiply(const Matrix& a, const Matrix& b)
+    {
+        Matrix Result;
+        for (int Row = 0; Row < 4; ++Row)
+        {
+            for (int Column = 0; Column < 4; ++Column)
+            {
+                float Sum = 0.0f;
+                for (int k = 0; k < 4; ++k)
+                {
+                    Sum += a.m[Row * 4 + k] * b.m[k * 4 + Column];
+                }
+                Result.m[Row * 4 + Column] = Sum;
+            }
+        }
+        return Result;
+    }
+
+    Matrix LookToLH(const float eye[3], const float look[3])
+    {
+        // look must be normalized and not vertical.
+        float Right[3] = { look[2], 0.0f, -look[0] };
+        const float RightLength = std::sqrt(Right[0] * Right[0] + Right[2] * Right[2]);
+        Right[0] /= RightLength;
+        Right[2] /= RightLength;
+
+        const float Up[3] =
+        {
+            look[1] * Right[2] - look[2] * Right[1],
+            look[2] * Right[0] - look[0] * Right[2],
+            look[0] * Right[1] - look[1] * Right[0],
+        };
+
+        auto Dot = [&](const float* a) { return a[0] * eye[0] + a[1] * eye[1] + a[2] * eye[2]; };
+
+        Matrix View =
+        { {
+            Right[0], Up[0], look[0], 0.0f,
+            Right[1], Up[1], look[1], 0.0f,
+            Right[2], Up[2], look[2], 0.0f,
+            -Dot(Right), -Dot(Up), -Dot(look), 1.0f,
+        } };
+        return View;
+    }
+
+    Matrix PerspectiveFovLH(float fovY, float aspect, float nearZ, float farZ)
+    {
+        const float YScale = 1.0f / std::tan(fovY * 0.5f);
+        const float Range = farZ / (farZ - nearZ);
+
+        Matrix Proj =
+        { {
+            YScale / aspect, 0.0f, 0.0f, 0.0f,
+            0.0f, YScale, 0.0f, 0.0f,
+            0.0f, 0.0f, Range, 1.0f,
+            0.0f, 0.0f, -Range * nearZ, 0.0f,
+        } };
+        return Proj;
+    }
+
+    struct BenchView
+    {
+        const char* Name;
+        float Eye[3];
+        float Yaw;
+        float Pitch;
+    };
+
+    // Brute force over every instance with the same distance and sphere tests the cull
+    // applies to cells the frustum only partly covers.
+    std::vector<VegetationInstance> ReferenceCull(
+        const std::vector<VegetationInstance>& instances,
+        const std::vector<VegetationLayerDesc>& layers,
+        const float planes[6][4],
+        const float eye[3])
+    {
+        std::vector<VegetationInstance> Visible;
+        for (const VegetationInstance& Instance : instances)
+        {
+            const float DrawDistance = layers[LayerOf(Instance, layers)].DrawDistance;
+            const float dx = Instance.Position[0] - eye[0];
+            const float dy = Instance.Position[1] - eye[1];
+            const float dz = Instance.Position[2] - eye[2];
+            if (dx * dx + dy * dy + dz * dz > DrawDistance * DrawDistance)
+                continue;
+
+            const float Radius = 0.5f * (std::max)(Instance.Size[0], Instance.Size[1]);
+            bool bInside = true;
+            for (int i = 0; i < 6 && bInside; ++i)
+            {
+                const float* Plane = planes[i];
+                bInside = Plane[0] * Instance.Position[0] + Plane[1] * Instance.Position[1] + Plane[2] * Instance.Position[2] + Plane[3] >= -Radius;
+            }
+
+            if (bInside)
+                Visible.push_back(Instance);
+        }
+        return Visible;
+    }
+
+    void SortInstances(std::vector<VegetationInstance>& instances)
+    {
+        std::sort(instances.begin(), instances.end(), [](const VegetationInstance& a, const VegetationInstance& b)
+        {
+            return memcmp(&a, &b, sizeof(VegetationInstance)) < 0;
+        });
+    }
+}
+
+int RunScatterBench(const std::vector<std::string>& args)
+{
+    typedef std::chrono::high_resolution_clock Clock;
+
+    ScatterBenchOptions Options;
+    if (!ParseOptions(args, Options))
+    {
+        fprintf(stderr, "usage: TextureTool scatter-bench [--size n] [--cell n] [--repeats n] [--seed n]\n");
+        return 1;
+    }
+
+    const std::vector<VegetationLayerDesc> Layers = SampleLayers();
+    const float AreaMin[2] = { -0.5f * Options.Size, -0.5f * Options.Size };
+    const float AreaMax[2] = { +0.5f * Options.Size, +0.5f * Options.Size };
+
+    printf("%.0f x %.0f area, %zu layers, cells of %.0f, seed 0x%llx\n",
+        Options.Size, Options.Size, Layers.size(), Options.CellSize, (unsigned long long)Options.Seed);
+
+    bool bOk = true;
+
+    // Build twice: the second must reproduce the first exactly.
+    VegetationScatter Scatter;
+    Clock::time_point Start = Clock::now();
+    Scatter.Build(Options.Seed, AreaMin, AreaMax, 0.0f, Options.CellSize, Layers);
+    const double BuildMilliseconds = std::chrono::duration<double, std::milli>(Clock::now() - Start).count();
+
+    VegetationScatter Rebuilt;
+    Rebuilt.Build(Options.Seed, AreaMin, AreaMax, 0.0f, Options.CellSize, Layers);
+
+    const std::vector<VegetationInstance>& Instances = Scatter.GetInstances();
+    const bool bDeterministic = Instances.size() == Rebuilt.GetInstances().size() &&
+        memcmp(Instances.data(), Rebuilt.GetInstances().data(), Instances.size() * sizeof(VegetationInstance)) == 0;
+
+    std::vector<uint32_t> LayerCounts(Layers.size() + 1, 0);
+    for (const VegetationInstance& Instance : Instances)
+    {
+        LayerCounts[LayerOf(Instance, Layers)]++;
+    }
+
+    const uint32_t Violations = CountSpacingViolations(Instances, Layers);
+
+    printf("  build              : %9.1f ms, %zu instances (%.0f per ms)\n", BuildMilliseconds, Instances.size(),
+        BuildMilliseconds > 0.0 ? Instances.size() / BuildMilliseconds : 0.0);
+    for (size_t l = 0; l < Layers.size(); ++l)
+    {
+        printf("    layer %zu           : %9u instances, min distance %.1f\n", l, LayerCounts[l], Layers[l].MinDistance);
+    }
+    printf("  rebuild            : %s\n", bDeterministic ? "identical" : "DIFFERENT");
+    printf("  spacing violations : %9u\n", Violations);
+
+    if (!bDeterministic || Violations != 0 || LayerCounts[Layers.size()] != 0 || Instances.empty())
+        bOk = false;
+
+    // Views like the sample's camera: at head height, turned around, and from above.
+    const BenchView Views[] =
+    {
+        { "start",     { 0.0f, 2.0f, -15.0f }, 0.0f, 0.0f },
+        { "turned",    { 0.0f, 2.0f, -15.0f }, 2.5f, 0.0f },
+        { "corner",    { -0.45f * Options.Size, 2.0f, -0.45f * Options.Size }, 0.8f, 0.0f },
+        { "overhead",  { 0.0f, 80.0f, 0.0f }, 0.3f, -1.2f },
+    };
+
+    const Matrix Proj = PerspectiveFovLH(0.25f * 3.1415927f, 16.0f / 9.0f, 1.0f, 1000.0f);
+    std::vector<VegetationInstance> Visible(Instances.size());
+
+    printf("  %-10s %9s %9s %7s %10s %12s %14s\n", "view", "visible", "culled", "cells", "cull ms", "inst/ms", "culled/ms");
+
+    for (const BenchView& View : Views)
+    {
+        const float Look[3] =
+        {
+            std::sin(View.Yaw) * std::cos(View.Pitch),
+            std::sin(View.Pitch),
+            std::cos(View.Yaw) * std::cos(View.Pitch),
+        };
+        const Matrix ViewProj = Multiply(LookToLH(View.Eye, Look), Proj);
+
+        float Planes[6][4];
+        FrustumCuller::ExtractPlanes(ViewProj.m, Planes);
+
+        uint32_t VisibleCount = 0;
+        double Best = 1e30;
+        for (uint32_t r = 0; r < Options.Repeats; ++r)
+        {
+            VisibleCount = Scatter.Cull(Planes, View.Eye, Visible.data(), (uint32_t)Visible.size());
+            Best = (std::min)(Best, Scatter.GetStats().CullMilliseconds);
+        }
+
+        const VegetationCullStats& Stats = Scatter.GetStats();
+        const uint32_t Culled = Stats.TotalInstances - VisibleCount;
+
+        std::vector<VegetationInstance> Culler(Visible.begin(), Visible.begin() + VisibleCount);
+        std::vector<VegetationInstance> Reference = ReferenceCull(Instances, Layers, Planes, View.Eye);
+        SortInstances(Culler);
+        SortInstances(Reference);
+
+        const bool bMatch = Culler.size() == Reference.size() &&
+            (Culler.empty() || memcmp(Culler.data(), Reference.data(), Culler.size() * sizeof(VegetationInstance)) == 0);
+
+        printf("  %-10s %9u %9u %3u/%-3u %10.4f %12.0f %14.0f%s\n", View.Name, VisibleCount, Culled, Stats.CellsVisible, Stats.CellsTested,
+            Best, Best > 0.0 ? Stats.TotalInstances / Best : 0.0, Best > 0.0 ? Culled / Best : 0.0,
+            bMatch ? "" : "  MISMATCH");
+
+        if (!bMatch)
+        {
+            printf("    brute force keeps %zu instances\n", Reference.size());
+            bOk = false;
+        }
+    }
+
+    printf(bOk ? "ok\n" : "FAILED\n");
+    return bOk ? 0 : 1;
+}
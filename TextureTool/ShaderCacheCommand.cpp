@@ -0,0 +1,281 @@
+#include "Commands.h"
+#include "../Common/ShaderCache.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+namespace
+{
+    struct ShaderCacheOptions
+    {
+        uint32_t Shaders = 64;
+        uint32_t Includes = 6;
+        uint32_t Seed = 1;
+    };
+
+    bool ParseOptions(const std::vector<std::string>& args, ShaderCacheOptions& options)
+    {
+        for (size_t i = 0; i < args.size(); ++i)
+        {
+            const std::string& Arg = args[i];
+
+            if (Arg == "--shaders" && i + 1 < args.size())
+                options.Shaders = (uint32_t)(std::max)(atoi(args[++i].c_str()), 1);
+            else if (Arg == "--includes" && i + 1 < args.size())
+                options.Includes = (uint32_t)(std::max)(atoi(args[++i].c_str()), 1);
+            else if (Arg == "--seed" && i + 1 < args.size())
+                options.Seed = (uint32_t)atoi(args[++i].c_str());
+            else
+            {
+                fprintf(stderr, "unknown option '%s'\n", Arg.c_str());
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void WriteText(const std::string& path, const std::string& text)
+    {
+        std::ofstream File(path, std::ios::binary | std::ios::trunc);
+        File << text;
+    }
+
+    // A permutation of one of a few sources, like the sample's Default.hlsl variants,
+    // and the includes its compile would open.
+    struct SyntheticShader
+    {
+        ShaderCacheKey Key;
+        std::vector<uint32_t> Includes;
+    };
+
+    typedef std::chrono::high_resolution_clock Clock;
+}
+
+int RunShaderCache(const std::vector<std::string>& args)
+{
+    ShaderCacheOptions Options;
+    if (!ParseOptions(args, Options))
+    {
+        fprintf(stderr, "usage: TextureTool shader-cache [--shaders n] [--includes n] [--seed n]\n");
+        return 1;
+    }
+
+    namespace fs = std::filesystem;
+
+    std::error_code Error;
+    const fs::path Root = fs::temp_directory_path(Error) / ("texturetool-shader-cache-" + std::to_string(Options.Seed));
+    fs::remove_all(Root, Error);
+    fs::create_directories(Root, Error);
+    if (Error)
+    {
+        fprintf(stderr, "cannot create %s\n", Root.string().c_str());
+        return 1;
+    }
+
+    const std::string Directory = Root.string() + "/";
+    const std::string CacheDirectory = Directory + "Cache";
+
+    printf("%u shader permutations over %u includes in %s\n", Options.Shaders, Options.Includes, Directory.c_str());
+
+    std::mt19937 Random(Options.Seed);
+
+    std::vector<std::string> IncludeText(Options.Includes);
+    for (uint32_t i = 0; i < Options.Includes; ++i)
+    {
+        IncludeText[i] = "// include " + std::to_string(i) + "\n" + std::string(2048 + Random() % 8192, (char)('a' + i % 26)) + "\n";
+        WriteText(Directory + "Include" + std::to_string(i) + ".hlsli", IncludeText[i]);
+    }
+
+    static const char* Targets[] = { "vs_5_1", "ps_5_1", "gs_5_1" };
+    static const char* DefineNames[] = { "FOG", "ALPHA_TESTED", "SKINNED", "INSTANCED", "BINDLESS" };
+
+    const uint32_t SourceCount = (std::max)(Options.Shaders / 8, 1u);
+    for (uint32_t i = 0; i < SourceCount; ++i)
+    {
+        WriteText(Directory + "Source" + std::to_string(i) + ".hlsl", "// source " + std::to_string(i) + "\n" + std::string(4096, 'x'));
+    }
+
+    std::vector<SyntheticShader> Shaders(Options.Shaders);
+    for (uint32_t i = 0; i < Options.Shaders; ++i)
+    {
+        SyntheticShader& Shader = Shaders[i];
+        Shader.Key.SourcePath = Directory + "Source" + std::to_string(i % SourceCount) + ".hlsl";
+        Shader.Key.EntryPoint = i % 2 == 0 ? "VS" : "PS";
+        Shader.Key.Target = Targets[i % 3];
+        Shader.Key.Flags = 0;
+        Shader.Key.CompilerVersion = 47;
+        for (uint32_t d = 0; d < 5; ++d)
+        {
+            if ((i / 3 >> d) & 1)
+                Shader.Key.Defines.push_back({ DefineNames[d], "1" });
+        }
+        // The defines, entry point and target only tell 96 permutations apart.
+        if (i >= 96)
+            Shader.Key.Defines.push_back({ "VARIANT", std::to_string(i / 96) });
+        for (uint32_t Include = 0; Include < Options.Includes; ++Include)
+        {
+            if (Include == 0 || Random() % 2 == 0)
+                Shader.Includes.push_back(Include);
+        }
+    }
+
+    // The files a compile of the shader opens, with the hashes of their current contents.
+    auto GetDependencies = [&](const SyntheticShader& shader)
+    {
+        std::vector<std::string> Paths(1, shader.Key.SourcePath);
+        for (uint32_t Include : shader.Includes)
+        {
+            Paths.push_back(Directory + "Include" + std::to_string(Include) + ".hlsli");
+        }
+
+        std::vector<ShaderDependency> Dependencies;
+        for (const std::string& Path : Paths)
+        {
+            std::ifstream File(Path, std::ios::binary);
+            const std::string Text((std::istreambuf_iterator<char>(File)), std::istreambuf_iterator<char>());
+            Dependencies.push_back({ Path, ShaderCache::HashBytes(Text.data(), Text.size()) });
+        }
+        return Dependencies;
+    };
+
+    // Stands in for the compiler: produces bytes that depend on the key and on the contents
+    // of every file the compile opens.
+    auto GetByteCode = [&](const SyntheticShader& shader, const std::vector<ShaderDependency>& dependencies)
+    {
+        const std::string KeyText = shader.Key.ToString();
+        uint64_t Hash = ShaderCache::HashBytes(KeyText.data(), KeyText.size());
+        for (const ShaderDependency& Dependency : dependencies)
+        {
+            Hash = ShaderCache::HashBytes(&Dependency.Hash, sizeof(Dependency.Hash), Hash);
+        }
+
+        std::vector<uint8_t> ByteCode(256 + Hash % 1024);
+        for (size_t b = 0; b < ByteCode.size(); ++b)
+        {
+            ByteCode[b] = (uint8_t)(Hash >> (b % 8 * 8)) ^ (uint8_t)b;
+        }
+        return ByteCode;
+    };
+
+    bool bOk = true;
+
+    // Each pass uses a new ShaderCache, as a new run of the sample would.
+    struct PassResult
+    {
+        ShaderCacheStats Stats;
+        double Milliseconds = 0.0;
+        uint32_t Wrong = 0;
+    };
+
+    auto RunPass = [&](const char* name)
+    {
+        ShaderCache Cache;
+        Cache.SetDirectory(CacheDirectory);
+
+        // What a compile of the current files gives, which a hit must match.
+        std::vector<std::vector<ShaderDependency>> Dependencies(Options.Shaders);
+        std::vector<std::vector<uint8_t>> Expected(Options.Shaders);
+        for (uint32_t i = 0; i < Options.Shaders; ++i)
+        {
+            Dependencies[i] = GetDependencies(Shaders[i]);
+            Expected[i] = GetByteCode(Shaders[i], Dependencies[i]);
+        }
+
+        PassResult Result;
+        const Clock::time_point Start = Clock::now();
+        for (uint32_t i = 0; i < Options.Shaders; ++i)
+        {
+            std::vector<uint8_t> ByteCode;
+            if (Cache.Find(Shaders[i].Key, ByteCode))
+            {
+                if (ByteCode != Expected[i])
+                    ++Result.Wrong;
+            }
+            else
+            {
+                Cache.Store(Shaders[i].Key, Dependencies[i], Expected[i].data(), Expected[i].size());
+            }
+        }
+        Result.Milliseconds = std::chrono::duration<double, std::milli>(Clock::now() - Start).count();
+        Result.Stats = Cache.GetStats();
+
+        printf("  %-24s %4u hits, %4u misses, %4u stale, %4u stored in %7.3f ms\n", name,
+            Result.Stats.Hits, Result.Stats.Misses, Result.Stats.Stale, Result.Stats.Stores, Result.Milliseconds);
+        if (Result.Wrong > 0)
+        {
+            printf("    %u entries returned the wrong bytecode\n", Result.Wrong);
+            bOk = false;
+        }
+        return Result;
+    };
+
+    const PassResult Cold = RunPass("cold");
+    bOk = bOk && Cold.Stats.Misses == Options.Shaders && Cold.Stats.Stores == Options.Shaders;
+
+    const PassResult Warm = RunPass("warm");
+    bOk = bOk && Warm.Stats.Hits == Options.Shaders;
+
+    // Editing an include invalidates exactly the permutations that pulled it in.
+    const uint32_t Edited = Options.Includes > 1 ? 1 : 0;
+    uint32_t Dependents = 0;
+    for (const SyntheticShader& Shader : Shaders)
+    {
+        Dependents += std::count(Shader.Includes.begin(), Shader.Includes.end(), Edited) > 0 ? 1 : 0;
+    }
+
+    WriteText(Directory + "Include" + std::to_string(Edited) + ".hlsli", IncludeText[Edited] + "// edited\n");
+    const PassResult AfterEdit = RunPass("include edited");
+    if (AfterEdit.Stats.Stale != Dependents || AfterEdit.Stats.Hits != Options.Shaders - Dependents)
+    {
+        printf("    expected %u stale entries\n", Dependents);
+        bOk = false;
+    }
+
+    // Entries are named by contents, not time stamps, and the edit stored new entries next
+    // to the old ones: reverting it, and then making it again, compiles nothing.
+    WriteText(Directory + "Include" + std::to_string(Edited) + ".hlsli", IncludeText[Edited]);
+    const PassResult Reverted = RunPass("include reverted");
+    bOk = bOk && Reverted.Stats.Hits == Options.Shaders;
+
+    WriteText(Directory + "Include" + std::to_string(Edited) + ".hlsli", IncludeText[Edited] + "// edited\n");
+    const PassResult Reedited = RunPass("include edited again");
+    bOk = bOk && Reedited.Stats.Hits == Options.Shaders;
+
+    WriteText(Directory + "Include" + std::to_string(Edited) + ".hlsli", IncludeText[Edited]);
+
+    // A different define set is a different entry, and a damaged entry is a miss.
+    {
+        ShaderCache Cache;
+        Cache.SetDirectory(CacheDirectory);
+
+        ShaderCacheKey Other = Shaders[0].Key;
+        Other.Defines.push_back({ "DEBUG_VIEW", "1" });
+
+        std::vector<uint8_t> ByteCode;
+        if (Cache.Find(Other, ByteCode))
+        {
+            printf("    a key with another define found an entry\n");
+            bOk = false;
+        }
+
+        const std::string EntryPath = Cache.GetEntryPath(Shaders[0].Key, GetDependencies(Shaders[0]));
+        fs::resize_file(EntryPath, fs::file_size(EntryPath, Error) / 2, Error);
+        if (Cache.Find(Shaders[0].Key, ByteCode))
+        {
+            printf("    a truncated entry was used\n");
+            bOk = false;
+        }
+    }
+
+    printf("  lookups %.1f us per shader warm\n", Warm.Milliseconds * 1000.0 / Options.Shaders);
+
+    fs::remove_all(Root, Error);
+
+    printf(bOk ? "ok\n" : "FAILED\n");
+    return bOk ? 0 : 1;
+}
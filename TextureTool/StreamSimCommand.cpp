@@ -0,0 +1,348 @@
+#include "Commands.h"
+#include "../Common/TextureStreamingPolicy.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+namespace
+{
+    const uint64_t MB = 1024 * 1024;
+
+    // Mips of this size and smaller form the tail loaded at startup, as in the sample.
+    const uint32_t TailSize = 64;
+
+    struct StreamSimOptions
+    {
+        uint32_t Textures = 300;
+        uint32_t Frames = 3000;
+        uint64_t Budget = 96 * MB;
+        uint32_t MaxPending = 4;
+        uint32_t Latency = 3;
+        uint32_t Seed = 1;
+    };
+
+    bool ParseOptions(const std::vector<std::string>& args, StreamSimOptions& options)
+    {
+        for (size_t i = 0; i < args.size(); ++i)
+        {
+            const std::string& Arg = args[i];
+
+            if (Arg == "--textures" && i + 1 < args.size())
+                options.Textures = (uint32_t)(std::max)(atoi(args[++i].c_str()), 1);
+            else if (Arg == "--frames" && i + 1 < args.size())
+                options.Frames = (uint32_t)(std::max)(atoi(args[++i].c_str()), 1);
+            else if (Arg == "--budget-mb" && i + 1 < args.size())
+                options.Budget = (uint64_t)(std::max)(atoi(args[++i].c_str()), 1) * MB;
+            else if (Arg == "--max-pending" && i + 1 < args.size())
+                options.MaxPending = (uint32_t)(std::max)(atoi(args[++i].c_str()), 1);
+            else if (Arg == "--latency" && i + 1 < args.size())
+                options.Latency = (uint32_t)(std::max)(atoi(args[++i].c_str()), 1);
+            else if (Arg == "--seed" && i + 1 < args.size())
+                options.Seed = (uint32_t)atoi(args[++i].c_str());
+            else
+            {
+                fprintf(stderr, "unknown option '%s'\n", Arg.c_str());
+                return false;
+            }
+        }
+        return true;
+    }
+
+    const uint32_t NoRequest = UINT32_MAX;
+
+    // What the simulation knows about a texture independently of the policy.
+    struct SimTexture
+    {
+        StreamingTextureDesc Desc;
+        float Position = 0.0f;
+        float UvScale = 1.0f;
+
+        uint64_t LastUsedFrame = 0;
+        uint32_t PendingMip = NoRequest;
+        uint32_t DueFrame = 0;
+    };
+
+    // A square or 2:1 block-compressed texture of 256 to 4096 texels with a full chain.
+    StreamingTextureDesc MakeDesc(std::mt19937& random)
+    {
+        StreamingTextureDesc Desc;
+        Desc.Width = 256u << (random() % 5);
+        Desc.Height = random() % 3 == 0 ? Desc.Width / 2 : Desc.Width;
+
+        // BC1 (8 bytes per block) or BC3/BC5 (16 bytes per block).
+        const uint64_t BlockBytes = random() % 2 == 0 ? 8 : 16;
+
+        uint32_t Width = Desc.Width;
+        uint32_t Height = Desc.Height;
+        for (;;)
+        {
+            if (Desc.TailMip == 0 && (std::max)(Width, Height) <= TailSize)
+                Desc.TailMip = (uint32_t)Desc.MipBytes.size();
+
+            Desc.MipBytes.push_back((uint64_t)((Width + 3) / 4) * ((Height + 3) / 4) * BlockBytes);
+            if (Width == 1 && Height == 1)
+                break;
+
+            Width = (std::max)(Width / 2, 1u);
+            Height = (std::max)(Height / 2, 1u);
+        }
+
+        return Desc;
+    }
+
+    uint64_t BytesFrom(const StreamingTextureDesc& desc, uint32_t firstMip)
+    {
+        uint64_t Bytes = 0;
+        for (size_t i = firstMip; i < desc.MipBytes.size(); ++i)
+        {
+            Bytes += desc.MipBytes[i];
+        }
+        return Bytes;
+    }
+
+    struct Problems
+    {
+        uint32_t OverBudget = 0;
+        uint32_t BadCommitted = 0;
+        uint32_t TailEvicted = 0;
+        uint32_t NotLru = 0;
+        uint32_t BadVictim = 0;
+        uint32_t TooManyPending = 0;
+        uint32_t DoubleRequest = 0;
+
+        uint32_t Total()const { return OverBudget + BadCommitted + TailEvicted + NotLru + BadVictim + TooManyPending + DoubleRequest; }
+    };
+}
+
+int RunStreamSim(const std::vector<std::string>& args)
+{
+    StreamSimOptions Options;
+    if (!ParseOptions(args, Options))
+    {
+        fprintf(stderr, "usage: TextureTool stream-sim [--textures n] [--frames n] [--budget-mb n] [--max-pending n] [--latency n] [--seed n]\n");
+        return 1;
+    }
+
+    std::mt19937 Random(Options.Seed);
+
+    // Textures spread along a path the camera walks back and forth, so that textures
+    // come into view, go out of it and come back, as in a fly-through.
+    const float PathLength = 1000.0f;
+    const float ViewRange = 120.0f;
+
+    TextureStreamingPolicy Policy;
+    Policy.SetBudget(Options.Budget);
+    Policy.SetMaxPendingRequests(Options.MaxPending);
+
+    std::vector<SimTexture> Textures(Options.Textures);
+    uint64_t TailBytes = 0;
+    uint64_t FullBytes = 0;
+    for (uint32_t i = 0; i < Options.Textures; ++i)
+    {
+        SimTexture& Texture = Textures[i];
+        Texture.Desc = MakeDesc(Random);
+        Texture.Position = std::uniform_real_distribution<float>(0.0f, PathLength)(Random);
+        Texture.UvScale = std::uniform_real_distribution<float>(0.5f, 4.0f)(Random);
+
+        Policy.AddTexture(Texture.Desc);
+        TailBytes += BytesFrom(Texture.Desc, Texture.Desc.TailMip);
+        FullBytes += BytesFrom(Texture.Desc, 0);
+    }
+
+    printf("%u textures (%.1f MB of tails, %.1f MB in full), %.1f MB budget, %u requests in flight, %u frames\n",
+        Options.Textures, (double)TailBytes / MB, (double)FullBytes / MB, (double)Options.Budget / MB, Options.MaxPending, Options.Frames);
+
+    if (TailBytes > Options.Budget)
+    {
+        fprintf(stderr, "the budget must hold every tail\n");
+        return 1;
+    }
+
+    // Halfway through the budget drops to three quarters, which the policy has to enforce
+    // with the request slots it has free.
+    const uint32_t LoweredFrame = Options.Frames / 2;
+    const uint64_t LoweredBudget = (std::max)(TailBytes, Options.Budget * 3 / 4);
+
+    Problems Found;
+    uint64_t Budget = Options.Budget;
+    uint64_t PreviousCommitted = TailBytes;
+    uint32_t Pending = 0;
+    uint32_t PeakPending = 0;
+    uint64_t Upgrades = 0;
+    uint64_t Evictions = 0;
+    uint32_t EvictToAdmitFrames = 0;
+    uint32_t OverBudgetFrames = 0;
+
+    std::vector<StreamingRequest> Requests;
+    std::vector<uint32_t> Eligible;
+    std::vector<char> bEvicted(Options.Textures);
+
+    for (uint32_t Frame = 1; Frame <= Options.Frames; ++Frame)
+    {
+        if (Frame == LoweredFrame)
+        {
+            Budget = LoweredBudget;
+            Policy.SetBudget(Budget);
+        }
+
+        // Requests land after one to Latency frames, the worker's and the GPU's time.
+        for (uint32_t i = 0; i < Options.Textures; ++i)
+        {
+            SimTexture& Texture = Textures[i];
+            if (Texture.PendingMip == NoRequest || Texture.DueFrame > Frame)
+                continue;
+
+            Policy.OnRequestCompleted(i, Texture.PendingMip);
+            Texture.PendingMip = NoRequest;
+            --Pending;
+        }
+
+        Policy.BeginFrame();
+
+        const float Phase = std::fmod(Frame * 0.75f, 2.0f * PathLength);
+        const float Camera = Phase < PathLength ? Phase : 2.0f * PathLength - Phase;
+        for (uint32_t i = 0; i < Options.Textures; ++i)
+        {
+            SimTexture& Texture = Textures[i];
+            const float Distance = std::fabs(Texture.Position - Camera);
+            if (Distance > ViewRange)
+                continue;
+
+            // A sphere of radius 4 seen through a 90 degree field of view on a 1080 line screen.
+            Policy.RequestFootprint(i, TextureStreamingPolicy::EstimateScreenTexels(4.0f, Distance, 1.0f, 1080.0f, Texture.UvScale));
+            Texture.LastUsedFrame = Frame;
+        }
+
+        // Textures the policy may evict: idle and holding mips this frame does not need.
+        Eligible.clear();
+        for (uint32_t i = 0; i < Options.Textures; ++i)
+        {
+            if (Textures[i].PendingMip == NoRequest && Policy.GetWantedMip(i) > Policy.GetResidentMip(i))
+                Eligible.push_back(i);
+            bEvicted[i] = 0;
+        }
+
+        std::vector<uint32_t> ResidentBefore(Options.Textures);
+        for (uint32_t i = 0; i < Options.Textures; ++i)
+        {
+            ResidentBefore[i] = Policy.GetResidentMip(i);
+        }
+
+        Requests.clear();
+        Policy.Update(Requests);
+
+        bool bFrameUpgraded = false;
+        bool bFrameEvicted = false;
+        for (const StreamingRequest& Request : Requests)
+        {
+            SimTexture& Texture = Textures[Request.Texture];
+            if (Texture.PendingMip != NoRequest)
+            {
+                ++Found.DoubleRequest;
+                continue;
+            }
+
+            if (Request.FirstMip > Texture.Desc.TailMip)
+                ++Found.TailEvicted;
+
+            if (Request.FirstMip > ResidentBefore[Request.Texture])
+            {
+                ++Evictions;
+                bFrameEvicted = true;
+                bEvicted[Request.Texture] = 1;
+                if (std::find(Eligible.begin(), Eligible.end(), Request.Texture) == Eligible.end())
+                    ++Found.BadVictim;
+            }
+            else
+            {
+                ++Upgrades;
+                bFrameUpgraded = true;
+            }
+
+            Texture.PendingMip = Request.FirstMip;
+            Texture.DueFrame = Frame + 1 + Random() % Options.Latency;
+            ++Pending;
+        }
+
+        // Victims have to be the least recently used of the eligible textures: every
+        // eligible texture left alone was used later (or as recently, with a higher index).
+        auto Older = [&](uint32_t a, uint32_t b)
+        {
+            return Textures[a].LastUsedFrame != Textures[b].LastUsedFrame ? Textures[a].LastUsedFrame < Textures[b].LastUsedFrame : a < b;
+        };
+        uint32_t NewestVictim = NoRequest;
+        for (uint32_t i : Eligible)
+        {
+            if (bEvicted[i] && (NewestVictim == NoRequest || Older(NewestVictim, i)))
+                NewestVictim = i;
+        }
+        if (NewestVictim != NoRequest)
+        {
+            for (uint32_t i : Eligible)
+            {
+                if (!bEvicted[i] && Older(i, NewestVictim))
+                    ++Found.NotLru;
+            }
+        }
+
+        if (bFrameUpgraded && bFrameEvicted)
+            ++EvictToAdmitFrames;
+
+        PeakPending = (std::max)(PeakPending, Pending);
+        if (Pending > Options.MaxPending || Pending != Policy.GetStats().PendingRequests)
+            ++Found.TooManyPending;
+
+        // Committed bytes count in-flight requests at their target size.
+        uint64_t Committed = 0;
+        for (uint32_t i = 0; i < Options.Textures; ++i)
+        {
+            const SimTexture& Texture = Textures[i];
+            Committed += BytesFrom(Texture.Desc, Texture.PendingMip != NoRequest ? Texture.PendingMip : Policy.GetResidentMip(i));
+        }
+        if (Committed != Policy.GetStats().CommittedBytes)
+            ++Found.BadCommitted;
+
+        // Right after the budget drops, the policy may take a few frames to get under it,
+        // but it must not grow in the meantime.
+        if (Committed > Budget)
+        {
+            ++OverBudgetFrames;
+            if (Committed > PreviousCommitted)
+                ++Found.OverBudget;
+        }
+        PreviousCommitted = Committed;
+    }
+
+    const StreamingStats& Stats = Policy.GetStats();
+    printf("  upgrades         %llu (%llu denied by the budget)\n", (unsigned long long)Upgrades, (unsigned long long)Stats.BudgetDenials);
+    printf("  evictions        %llu, in %u frames together with the upgrades they made room for\n", (unsigned long long)Evictions, EvictToAdmitFrames);
+    printf("  in flight        %u at most of %u\n", PeakPending, Options.MaxPending);
+    printf("  committed        %.1f MB at the end, %u frames over budget after it dropped to %.1f MB\n",
+        (double)PreviousCommitted / MB, OverBudgetFrames, (double)LoweredBudget / MB);
+
+    bool bOk = Found.Total() == 0 && PreviousCommitted <= Budget && Upgrades == Stats.Upgrades && Evictions == Stats.Evictions;
+    if (Found.OverBudget != 0)
+        printf("    budget exceeded or grown while over it %u times\n", Found.OverBudget);
+    if (Found.BadCommitted != 0)
+        printf("    committed bytes disagreed with the resident and pending mips %u times\n", Found.BadCommitted);
+    if (Found.TailEvicted != 0)
+        printf("    %u requests dropped mips of the tail\n", Found.TailEvicted);
+    if (Found.BadVictim != 0)
+        printf("    %u textures evicted while in use or in flight\n", Found.BadVictim);
+    if (Found.NotLru != 0)
+        printf("    %u evictions skipped a less recently used texture\n", Found.NotLru);
+    if (Found.TooManyPending != 0)
+        printf("    more than %u requests in flight, or the policy's count disagreed, %u times\n", Options.MaxPending, Found.TooManyPending);
+    if (Found.DoubleRequest != 0)
+        printf("    %u requests for textures already in flight\n", Found.DoubleRequest);
+    if (PreviousCommitted > Budget)
+        printf("    still over budget at the end\n");
+    if (Upgrades != Stats.Upgrades || Evictions != Stats.Evictions)
+        printf("    the policy's upgrade and eviction counts disagree with its requests\n");
+
+    printf(bOk ? "ok\n" : "FAILED\n");
+    return bOk ? 0 : 1;
+}
@@ -0,0 +1,266 @@
+#include "Commands.h"
+#include "../Common/TaskGraph.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <stdexcept>
+
+namespace
+{
+    struct TaskGraphOptions
+    {
+        // The sample compiles 22 shaders into 13 pipeline states.
+        uint32_t Shaders = 22;
+        uint32_t Pipelines = 13;
+        uint32_t CompileMicroseconds = 4000;
+        uint32_t PipelineMicroseconds = 2000;
+        uint32_t Threads = 0;
+        uint32_t Seed = 1;
+    };
+
+    bool ParseOptions(const std::vector<std::string>& args, TaskGraphOptions& options)
+    {
+        for (size_t i = 0; i < args.size(); ++i)
+        {
+            const std::string& Arg = args[i];
+
+            if (Arg == "--shaders" && i + 1 < args.size())
+                options.Shaders = (uint32_t)(std::max)(atoi(args[++i].c_str()), 1);
+            else if (Arg == "--pipelines" && i + 1 < args.size())
+                options.Pipelines = (uint32_t)(std::max)(atoi(args[++i].c_str()), 0);
+            else if (Arg == "--compile-us" && i + 1 < args.size())
+                options.CompileMicroseconds = (uint32_t)(std::max)(atoi(args[++i].c_str()), 0);
+            else if (Arg == "--pso-us" && i + 1 < args.size())
+                options.PipelineMicroseconds = (uint32_t)(std::max)(atoi(args[++i].c_str()), 0);
+            else if (Arg == "-j" && i + 1 < args.size())
+                options.Threads = (uint32_t)(std::max)(atoi(args[++i].c_str()), 0);
+            else if (Arg == "--seed" && i + 1 < args.size())
+                options.Seed = (uint32_t)atoi(args[++i].c_str());
+            else
+            {
+                fprintf(stderr, "unknown option '%s'\n", Arg.c_str());
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    typedef std::chrono::steady_clock Clock;
+
+    // Stands in for D3DCompile or CreateGraphicsPipelineState: keeps a core busy.
+    void Spin(uint32_t microseconds)
+    {
+        const Clock::time_point End = Clock::now() + std::chrono::microseconds(microseconds);
+        while (Clock::now() < End)
+        {
+        }
+    }
+
+    struct FakeTask
+    {
+        uint32_t Microseconds = 0;
+        std::vector<uint32_t> Shaders;      // pipelines only
+
+        // Positions on a shared counter, so that order across threads can be checked.
+        std::atomic<uint32_t> RunCount{ 0 };
+        std::atomic<uint32_t> Started{ 0 };
+        std::atomic<uint32_t> Finished{ 0 };
+    };
+
+    struct FakeBuild
+    {
+        std::vector<FakeTask> Shaders;
+        std::vector<FakeTask> Pipelines;
+        std::atomic<uint32_t> Clock{ 0 };
+        uint32_t FailingShader = UINT32_MAX;
+
+        void ResetCounters()
+        {
+            Clock = 0;
+            for (std::vector<FakeTask>* Tasks : { &Shaders, &Pipelines })
+            {
+                for (FakeTask& Task : *Tasks)
+                {
+                    Task.RunCount = 0;
+                    Task.Started = 0;
+                    Task.Finished = 0;
+                }
+            }
+        }
+    };
+
+    void RunFake(FakeBuild& build, FakeTask& task, bool bFail)
+    {
+        ++task.RunCount;
+        task.Started = ++build.Clock;
+        Spin(task.Microseconds);
+        task.Finished = ++build.Clock;
+
+        if (bFail)
+            throw std::runtime_error("compile failed");
+    }
+
+    // Shaders first, then pipelines that depend on them, like BuildShader followed by
+    // BuildPipelineState.
+    void AddTasks(TaskGraph& graph, FakeBuild& build)
+    {
+        graph.Reset();
+
+        std::vector<TaskGraph::TaskId> ShaderTasks;
+        for (uint32_t i = 0; i < build.Shaders.size(); ++i)
+        {
+            ShaderTasks.push_back(graph.AddTask([&build, i]()
+            {
+                RunFake(build, build.Shaders[i], i == build.FailingShader);
+            }));
+        }
+
+        for (uint32_t i = 0; i < build.Pipelines.size(); ++i)
+        {
+            std::vector<TaskGraph::TaskId> Dependencies;
+            for (uint32_t Shader : build.Pipelines[i].Shaders)
+            {
+                Dependencies.push_back(ShaderTasks[Shader]);
+            }
+
+            graph.AddTask([&build, i]() { RunFake(build, build.Pipelines[i], false); }, Dependencies);
+        }
+    }
+
+    // Returns the number of problems found.  Pipelines using the failing shader must not
+    // have run; everything else must have run once, after the shaders it uses.
+    uint32_t Verify(const FakeBuild& build)
+    {
+        uint32_t Problems = 0;
+
+        for (const FakeTask& Shader : build.Shaders)
+        {
+            Problems += Shader.RunCount == 1 ? 0 : 1;
+        }
+
+        for (const FakeTask& Pipeline : build.Pipelines)
+        {
+            bool bBlocked = false;
+            bool bOrdered = true;
+            for (uint32_t Shader : Pipeline.Shaders)
+            {
+                bBlocked = bBlocked || Shader == build.FailingShader;
+                bOrdered = bOrdered && build.Shaders[Shader].Finished < Pipeline.Started;
+            }
+
+            if (Pipeline.RunCount != (bBlocked ? 0u : 1u) || (!bBlocked && !bOrdered))
+                ++Problems;
+        }
+
+        return Problems;
+    }
+}
+
+int RunTaskGraph(const std::vector<std::string>& args)
+{
+    TaskGraphOptions Options;
+    if (!ParseOptions(args, Options))
+    {
+        fprintf(stderr, "usage: TextureTool task-graph [--shaders n] [--pipelines n] [--compile-us n] [--pso-us n] [-j threads] [--seed n]\n");
+        return 1;
+    }
+
+    ThreadPool Pool(Options.Threads);
+
+    std::mt19937 Random(Options.Seed);
+    std::uniform_real_distribution<float> Jitter(0.5f, 1.5f);
+
+    FakeBuild Build;
+    Build.Shaders = std::vector<FakeTask>(Options.Shaders);
+    Build.Pipelines = std::vector<FakeTask>(Options.Pipelines);
+
+    for (FakeTask& Shader : Build.Shaders)
+    {
+        Shader.Microseconds = (uint32_t)(Options.CompileMicroseconds * Jitter(Random));
+    }
+
+    // A vertex and a pixel shader each, sometimes hull, domain or geometry shaders too.
+    for (FakeTask& Pipeline : Build.Pipelines)
+    {
+        Pipeline.Microseconds = (uint32_t)(Options.PipelineMicroseconds * Jitter(Random));
+
+        const uint32_t StageCount = (std::min)(2u + (Random() % 4 == 0 ? 1u + (uint32_t)(Random() % 3) : 0u), Options.Shaders);
+        while (Pipeline.Shaders.size() < StageCount)
+        {
+            const uint32_t Shader = Random() % Options.Shaders;
+            if (std::find(Pipeline.Shaders.begin(), Pipeline.Shaders.end(), Shader) == Pipeline.Shaders.end())
+                Pipeline.Shaders.push_back(Shader);
+        }
+    }
+
+    printf("%u shaders (%u us) feeding %u pipeline states (%u us) on %zu threads\n",
+        Options.Shaders, Options.CompileMicroseconds, Options.Pipelines, Options.PipelineMicroseconds, Pool.GetThreadCount());
+
+    bool bOk = true;
+    TaskGraph Graph;
+
+    auto Time = [&](const char* name, bool bParallel)
+    {
+        Build.ResetCounters();
+        AddTasks(Graph, Build);
+
+        const Clock::time_point Start = Clock::now();
+        if (bParallel)
+            Graph.Run(Pool);
+        else
+            Graph.RunSerial();
+        const double Milliseconds = std::chrono::duration<double, std::milli>(Clock::now() - Start).count();
+
+        const uint32_t Problems = Verify(Build);
+        printf("  %-10s %8.2f ms, %zu tasks, %zu at once\n", name, Milliseconds, Graph.GetStats().TaskCount, Graph.GetStats().PeakRunning);
+        if (Problems > 0)
+        {
+            printf("    %u tasks ran the wrong number of times or before their dependencies\n", Problems);
+            bOk = false;
+        }
+        return Milliseconds;
+    };
+
+    const double SerialTime = Time("serial", false);
+    const double ParallelTime = Time("parallel", true);
+    printf("  speedup    %8.2fx\n", SerialTime / (std::max)(ParallelTime, 0.001));
+
+    // A failed compile skips the pipelines using it, lets the rest finish and is reported
+    // to the caller, as a shader error at startup would be.
+    uint32_t Dependents = 0;
+    for (const FakeTask& Pipeline : Build.Pipelines)
+    {
+        Dependents += std::count(Pipeline.Shaders.begin(), Pipeline.Shaders.end(), 0u) > 0 ? 1 : 0;
+    }
+
+    Build.FailingShader = 0;
+    Build.ResetCounters();
+    AddTasks(Graph, Build);
+
+    bool bThrown = false;
+    try
+    {
+        Graph.Run(Pool);
+    }
+    catch (const std::runtime_error&)
+    {
+        bThrown = true;
+    }
+
+    const uint32_t Problems = Verify(Build);
+    printf("  failure    %s, %zu of %u dependent pipelines skipped\n", bThrown ? "rethrown" : "NOT rethrown", Graph.GetStats().SkippedCount, Dependents);
+    if (!bThrown || Problems > 0 || Graph.GetStats().SkippedCount != Dependents)
+    {
+        if (Problems > 0)
+            printf("    %u tasks ran the wrong number of times or before their dependencies\n", Problems);
+        bOk = false;
+    }
+
+    printf(bOk ? "ok\n" : "FAILED\n");
+    return bOk ? 0 : 1;
+}
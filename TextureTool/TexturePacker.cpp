@@ -0,0 +1,231 @@
+#include "TexturePacker.h"
+
+#include <algorithm>
+#include <map>
+#include <numeric>
+#include <tuple>
+
+namespace
+{
+    typedef std::tuple<int, uint32_t, uint32_t, uint32_t, bool, int, uint32_t, uint32_t, uint32_t> ArrayKey;
+
+    ArrayKey GetArrayKey(const PackSource& source)
+    {
+        // Sources without a normal map ignore the normal fields.
+        const bool bNormal = source.bHasNormal;
+        return ArrayKey((int)source.Format, source.Width, source.Height, source.MipCount, bNormal,
+            bNormal ? (int)source.NormalFormat : 0, bNormal ? source.NormalWidth : 0,
+            bNormal ? source.NormalHeight : 0, bNormal ? source.NormalMipCount : 0);
+    }
+
+    uint32_t AlignUp(uint32_t value, uint32_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    uint32_t NextPowerOfTwo(uint32_t value)
+    {
+        uint32_t Result = 1;
+        while (Result < value)
+        {
+            Result <<= 1;
+        }
+        return Result;
+    }
+
+    uint32_t GetFullMipCount(uint32_t width, uint32_t height)
+    {
+        uint32_t Count = 1;
+        for (uint32_t Size = (std::max)(width, height); Size > 1; Size /= 2)
+        {
+            ++Count;
+        }
+        return Count;
+    }
+
+    void MakeArray(const std::vector<PackSource>& sources, const std::vector<uint32_t>& members, PackPlan& plan)
+    {
+        const PackSource& First = sources[members[0]];
+
+        TexturePack Pack;
+        Pack.Kind = PackKind::Array;
+        Pack.bHasNormal = First.bHasNormal;
+        Pack.Format = First.Format;
+        Pack.NormalFormat = First.NormalFormat;
+        Pack.Width = First.Width;
+        Pack.Height = First.Height;
+        Pack.MipCount = First.MipCount;
+        Pack.NormalMipCount = First.NormalMipCount;
+
+        for (uint32_t i = 0; i < (uint32_t)members.size(); ++i)
+        {
+            PackEntry Entry;
+            Entry.Source = members[i];
+            Entry.Slice = i;
+            Entry.CellWidth = First.Width;
+            Entry.CellHeight = First.Height;
+            Pack.Entries.push_back(Entry);
+        }
+
+        plan.Packs.push_back(std::move(Pack));
+    }
+
+    // Shelf packing, tallest cells first.  Atlases that end up holding a single texture save
+    // nothing and are dropped again.
+    void MakeAtlases(const std::vector<PackSource>& sources, std::vector<uint32_t> members, bool bHasNormal,
+        const PackSettings& settings, PackPlan& plan)
+    {
+        const uint32_t MipCount = (std::max)(settings.AtlasMipCount, 1u);
+        const uint32_t Alignment = 1u << (MipCount - 1);
+        const uint32_t Gutter = AlignUp((std::max)(settings.Gutter, 1u), Alignment);
+
+        auto CellWidth = [&](uint32_t i) { return AlignUp(sources[i].Width + Gutter * 2, Alignment); };
+        auto CellHeight = [&](uint32_t i) { return AlignUp(sources[i].Height + Gutter * 2, Alignment); };
+
+        std::vector<uint32_t> Fitting;
+        for (uint32_t i : members)
+        {
+            if (CellWidth(i) <= settings.AtlasSize && CellHeight(i) <= settings.AtlasSize)
+                Fitting.push_back(i);
+            else
+                plan.Unpacked.push_back(i);
+        }
+
+        std::sort(Fitting.begin(), Fitting.end(), [&](uint32_t a, uint32_t b)
+        {
+            if (CellHeight(a) != CellHeight(b))
+                return CellHeight(a) > CellHeight(b);
+            if (CellWidth(a) != CellWidth(b))
+                return CellWidth(a) > CellWidth(b);
+            return sources[a].Name < sources[b].Name;
+        });
+
+        size_t Next = 0;
+        while (Next < Fitting.size())
+        {
+            TexturePack Pack;
+            Pack.Kind = PackKind::Atlas;
+            Pack.bHasNormal = bHasNormal;
+            Pack.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+            Pack.NormalFormat = bHasNormal ? DXGI_FORMAT_R8G8B8A8_UNORM : DXGI_FORMAT_UNKNOWN;
+            Pack.Gutter = Gutter;
+
+            uint32_t ShelfX = 0;
+            uint32_t ShelfY = 0;
+            uint32_t ShelfHeight = 0;
+            uint32_t UsedWidth = 0;
+
+            for (; Next < Fitting.size(); ++Next)
+            {
+                const uint32_t Source = Fitting[Next];
+                const uint32_t Width = CellWidth(Source);
+                const uint32_t Height = CellHeight(Source);
+
+                if (ShelfX + Width > settings.AtlasSize)
+                {
+                    ShelfY += ShelfHeight;
+                    ShelfX = 0;
+                    ShelfHeight = 0;
+                }
+
+                if (ShelfY + Height > settings.AtlasSize)
+                    break;
+
+                PackEntry Entry;
+                Entry.Source = Source;
+                Entry.X = ShelfX + Gutter;
+                Entry.Y = ShelfY + Gutter;
+                Entry.CellWidth = Width;
+                Entry.CellHeight = Height;
+                Pack.Entries.push_back(Entry);
+
+                ShelfX += Width;
+                ShelfHeight = (std::max)(ShelfHeight, Height);
+                UsedWidth = (std::max)(UsedWidth, ShelfX);
+            }
+
+            if (Pack.Entries.size() < 2)
+            {
+                for (const PackEntry& Entry : Pack.Entries)
+                {
+                    plan.Unpacked.push_back(Entry.Source);
+                }
+                continue;
+            }
+
+            Pack.Width = NextPowerOfTwo(UsedWidth);
+            Pack.Height = NextPowerOfTwo(ShelfY + ShelfHeight);
+            Pack.MipCount = (std::min)(MipCount, GetFullMipCount(Pack.Width, Pack.Height));
+            Pack.NormalMipCount = bHasNormal ? Pack.MipCount : 0;
+
+            for (PackEntry& Entry : Pack.Entries)
+            {
+                const PackSource& Source = sources[Entry.Source];
+                Entry.Scale[0] = (float)Source.Width / Pack.Width;
+                Entry.Scale[1] = (float)Source.Height / Pack.Height;
+                Entry.Bias[0] = (float)Entry.X / Pack.Width;
+                Entry.Bias[1] = (float)Entry.Y / Pack.Height;
+            }
+
+            plan.Packs.push_back(std::move(Pack));
+        }
+    }
+}
+
+PackPlan PlanTexturePacks(const std::vector<PackSource>& sources, const PackSettings& settings)
+{
+    // Work in name order so the plan does not depend on the order of the inputs.
+    std::vector<uint32_t> Order(sources.size());
+    std::iota(Order.begin(), Order.end(), 0u);
+    std::stable_sort(Order.begin(), Order.end(), [&](uint32_t a, uint32_t b) { return sources[a].Name < sources[b].Name; });
+
+    std::map<ArrayKey, std::vector<uint32_t>> Groups;
+    for (uint32_t i : Order)
+    {
+        Groups[GetArrayKey(sources[i])].push_back(i);
+    }
+
+    PackPlan Plan;
+    std::vector<uint32_t> Leftovers;
+
+    for (const auto& Group : Groups)
+    {
+        const std::vector<uint32_t>& Members = Group.second;
+        const size_t MaxSlices = (std::max)(settings.MaxArraySlices, 1u);
+
+        for (size_t First = 0; First < Members.size(); First += MaxSlices)
+        {
+            std::vector<uint32_t> Chunk(Members.begin() + First, Members.begin() + (std::min)(First + MaxSlices, Members.size()));
+
+            if (Chunk.size() >= settings.MinArraySlices)
+                MakeArray(sources, Chunk, Plan);
+            else
+                Leftovers.insert(Leftovers.end(), Chunk.begin(), Chunk.end());
+        }
+    }
+
+    // Atlas sub-images share one placement for colour and normal, so the normal map must
+    // match the colour map's size.
+    std::vector<uint32_t> AtlasColour;
+    std::vector<uint32_t> AtlasNormal;
+
+    for (uint32_t i : Leftovers)
+    {
+        const PackSource& Source = sources[i];
+        const bool bSmall = (std::max)(Source.Width, Source.Height) <= settings.AtlasMaxSourceSize;
+        const bool bNormalMatches = !Source.bHasNormal || (Source.NormalWidth == Source.Width && Source.NormalHeight == Source.Height);
+
+        if (!settings.bAtlas || !bSmall || !bNormalMatches)
+            Plan.Unpacked.push_back(i);
+        else if (Source.bHasNormal)
+            AtlasNormal.push_back(i);
+        else
+            AtlasColour.push_back(i);
+    }
+
+    MakeAtlases(sources, AtlasColour, false, settings, Plan);
+    MakeAtlases(sources, AtlasNormal, true, settings, Plan);
+
+    std::sort(Plan.Unpacked.begin(), Plan.Unpacked.end(), [&](uint32_t a, uint32_t b) { return sources[a].Name < sources[b].Name; });
+    return Plan;
+}
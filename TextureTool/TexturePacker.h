@@ -0,0 +1,86 @@
+#pragma once
+
+#include "../Common/DDSHeader.h"
+
+#include <string>
+#include <vector>
+
+// Header facts about one colour texture and its optional _nmap companion.
+struct PackSource
+{
+    std::string Name;
+    DXGI_FORMAT Format = DXGI_FORMAT_UNKNOWN;
+    uint32_t Width = 0;
+    uint32_t Height = 0;
+    uint32_t MipCount = 0;
+
+    bool bHasNormal = false;
+    DXGI_FORMAT NormalFormat = DXGI_FORMAT_UNKNOWN;
+    uint32_t NormalWidth = 0;
+    uint32_t NormalHeight = 0;
+    uint32_t NormalMipCount = 0;
+};
+
+struct PackSettings
+{
+    // Smallest group worth turning into an array.
+    uint32_t MinArraySlices = 2;
+    uint32_t MaxArraySlices = 2048;
+
+    // Leftovers no larger than this in either dimension go into atlases.
+    bool bAtlas = true;
+    uint32_t AtlasSize = 1024;
+    uint32_t AtlasMaxSourceSize = 256;
+
+    // Atlas mips are built per sub-image with a gutter at every level, so the number of
+    // levels fixes the cell alignment (1 << (AtlasMipCount - 1)).
+    uint32_t AtlasMipCount = 4;
+    uint32_t Gutter = 4;
+};
+
+enum class PackKind
+{
+    Array,
+    Atlas,
+};
+
+// One sub-image of a pack.  For atlases X/Y is where the texel data (not the gutter) starts.
+struct PackEntry
+{
+    uint32_t Source = 0;
+    uint32_t Slice = 0;
+    uint32_t X = 0;
+    uint32_t Y = 0;
+    uint32_t CellWidth = 0;
+    uint32_t CellHeight = 0;
+    float Scale[2] = { 1.0f, 1.0f };
+    float Bias[2] = { 0.0f, 0.0f };
+};
+
+struct TexturePack
+{
+    PackKind Kind = PackKind::Array;
+    bool bHasNormal = false;
+
+    // Arrays keep the sources' format and mips; atlases are R8G8B8A8_UNORM.
+    DXGI_FORMAT Format = DXGI_FORMAT_UNKNOWN;
+    DXGI_FORMAT NormalFormat = DXGI_FORMAT_UNKNOWN;
+    uint32_t Width = 0;
+    uint32_t Height = 0;
+    uint32_t MipCount = 0;
+    uint32_t NormalMipCount = 0;
+    uint32_t Gutter = 0;
+
+    std::vector<PackEntry> Entries;
+};
+
+struct PackPlan
+{
+    std::vector<TexturePack> Packs;
+    std::vector<uint32_t> Unpacked;
+};
+
+// Groups same format / size / mip count sources (with matching normal maps) into arrays
+// and shelf-packs small leftovers into atlases.  The result depends only on the inputs, not
+// on their order, so repeated bakes produce identical files.
+PackPlan PlanTexturePacks(const std::vector<PackSource>& sources, const PackSettings& settings);
@@ -0,0 +1,360 @@
+#include "Commands.h"
+#include "../Common/FrameUploadAllocator.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <thread>
+
+namespace
+{
+    struct UploadSimOptions
+    {
+        uint32_t Frames = 300;
+        uint32_t Items = 10000;
+        uint32_t Grow = 50;
+        uint32_t Threads = 0;
+        uint32_t Allocations = 2000;
+        uint32_t Seed = 1;
+    };
+
+    bool ParseOptions(const std::vector<std::string>& args, UploadSimOptions& options)
+    {
+        for (size_t i = 0; i < args.size(); ++i)
+        {
+            const std::string& Arg = args[i];
+
+            if (Arg == "--frames" && i + 1 < args.size())
+                options.Frames = (uint32_t)(std::max)(atoi(args[++i].c_str()), 1);
+            else if (Arg == "--items" && i + 1 < args.size())
+                options.Items = (uint32_t)(std::max)(atoi(args[++i].c_str()), 1);
+            else if (Arg == "--grow" && i + 1 < args.size())
+                options.Grow = (uint32_t)(std::max)(atoi(args[++i].c_str()), 0);
+            else if (Arg == "-j" && i + 1 < args.size())
+                options.Threads = (uint32_t)(std::max)(atoi(args[++i].c_str()), 1);
+            else if (Arg == "--allocations" && i + 1 < args.size())
+                options.Allocations = (uint32_t)(std::max)(atoi(args[++i].c_str()), 1);
+            else if (Arg == "--seed" && i + 1 < args.size())
+                options.Seed = (uint32_t)atoi(args[++i].c_str());
+            else
+            {
+                fprintf(stderr, "unknown option '%s'\n", Arg.c_str());
+                return false;
+            }
+        }
+
+        if (options.Threads == 0)
+            options.Threads = (std::max)(std::thread::hardware_concurrency(), 2u);
+
+        return true;
+    }
+
+    // The sample's frame slot count and constant element size.
+    const uint32_t FrameCount = 3;
+    const uint64_t ElementByteSize = 256;
+
+    // Size of the per-thread allocations: small constant buffers up to a few KB of
+    // instance data.
+    const uint64_t MaxThreadAllocation = 4096;
+
+    struct Allocation
+    {
+        uint64_t Offset;
+        uint64_t Size;
+        uint32_t Tag;
+    };
+
+    uint32_t MakeTag(uint32_t frame, uint32_t thread, uint32_t index)
+    {
+        return (frame * 2654435761u) ^ (thread * 40503u) ^ (index * 97u) ^ 0x5a5a5a5au;
+    }
+
+    void Fill(uint8_t* data, const Allocation& allocation)
+    {
+        uint32_t* Words = reinterpret_cast<uint32_t*>(data + allocation.Offset);
+        for (uint64_t i = 0; i < allocation.Size / sizeof(uint32_t); ++i)
+        {
+            Words[i] = allocation.Tag + (uint32_t)i;
+        }
+    }
+
+    bool Check(const uint8_t* data, const Allocation& allocation)
+    {
+        const uint32_t* Words = reinterpret_cast<const uint32_t*>(data + allocation.Offset);
+        for (uint64_t i = 0; i < allocation.Size / sizeof(uint32_t); ++i)
+        {
+            if (Words[i] != allocation.Tag + (uint32_t)i)
+                return false;
+        }
+        return true;
+    }
+
+    struct FrameRecord
+    {
+        uint64_t ObjectOffset = 0;
+        std::vector<Allocation> Allocations;
+    };
+
+    struct SimResult
+    {
+        uint32_t Regrows = 0;
+        uint32_t Overflows = 0;
+        uint32_t Misaligned = 0;
+        uint32_t Overlaps = 0;
+        uint32_t Corrupted = 0;
+        uint32_t MovedObjectBlocks = 0;
+        uint64_t Peak = 0;
+        uint64_t RegionSize = 0;
+        uint64_t AllocationCount = 0;
+        double AllocateMilliseconds = 0.0;
+    };
+
+    // Runs frames the way the sample does: the object block first, then every thread
+    // allocating and filling its own pieces at once.  A frame's data is checked when its slot
+    // comes round again, which is the point the GPU would have finished reading it.  The
+    // item count grows each frame, and the buffer is recreated (after "waiting for the GPU",
+    // i.e. checking every frame still in flight) when a frame no longer fits its region.
+    SimResult RunFrames(const UploadSimOptions& options)
+    {
+        SimResult Result;
+
+        FrameUploadAllocator Allocator;
+        std::vector<uint8_t> Buffer;
+        FrameRecord Slots[FrameCount];
+
+        uint32_t Items = options.Items;
+        const uint64_t ThreadBytes = (uint64_t)options.Threads * options.Allocations * MaxThreadAllocation;
+
+        auto CheckSlot = [&](FrameRecord& record)
+        {
+            for (const Allocation& A : record.Allocations)
+            {
+                if (!Check(Buffer.data(), A))
+                    ++Result.Corrupted;
+            }
+            record.Allocations.clear();
+        };
+
+        typedef std::chrono::high_resolution_clock Clock;
+
+        for (uint32_t Frame = 0; Frame < options.Frames; ++Frame)
+        {
+            const uint32_t Slot = Frame % FrameCount;
+
+            // The GPU is done with this slot's previous frame.
+            CheckSlot(Slots[Slot]);
+
+            const uint64_t FrameSize = Items * ElementByteSize + ThreadBytes;
+            if (Buffer.empty() || FrameSize > Allocator.GetRegionSize())
+            {
+                for (FrameRecord& Record : Slots)
+                {
+                    CheckSlot(Record);
+                }
+
+                Allocator.Reset(FrameSize + FrameSize / 4, FrameCount);
+                Buffer.assign((size_t)Allocator.GetBufferSize(), 0);
+                ++Result.Regrows;
+            }
+
+            Allocator.BeginFrame(Slot);
+            FrameRecord& Record = Slots[Slot];
+
+            // Object constants: same size at the start of every frame, so the same place in
+            // the slot until the item count changes.
+            const uint64_t ObjectOffset = Allocator.Allocate(Items * ElementByteSize);
+            if (ObjectOffset == FrameUploadAllocator::InvalidOffset)
+            {
+                ++Result.Overflows;
+                continue;
+            }
+            if (Frame >= FrameCount && options.Grow == 0 && ObjectOffset != Record.ObjectOffset)
+                ++Result.MovedObjectBlocks;
+            Record.ObjectOffset = ObjectOffset;
+
+            Allocation ObjectBlock = { ObjectOffset, Items * ElementByteSize, MakeTag(Frame, 0xffff, 0) };
+            Fill(Buffer.data(), ObjectBlock);
+            Record.Allocations.push_back(ObjectBlock);
+
+            std::vector<std::vector<Allocation>> ThreadAllocations(options.Threads);
+            std::vector<uint32_t> ThreadOverflows(options.Threads, 0);
+
+            const Clock::time_point Start = Clock::now();
+
+            std::vector<std::thread> Workers;
+            for (uint32_t Thread = 0; Thread < options.Threads; ++Thread)
+            {
+                Workers.emplace_back([&, Thread]()
+                {
+                    std::mt19937 Random(options.Seed + Frame * 131 + Thread);
+                    std::vector<Allocation>& Mine = ThreadAllocations[Thread];
+                    Mine.reserve(options.Allocations);
+
+                    for (uint32_t i = 0; i < options.Allocations; ++i)
+                    {
+                        const uint64_t Size = ((Random() % MaxThreadAllocation) + 4) & ~3ull;
+                        const uint64_t Offset = Allocator.Allocate(Size);
+                        if (Offset == FrameUploadAllocator::InvalidOffset)
+                        {
+                            ++ThreadOverflows[Thread];
+                            continue;
+                        }
+
+                        Allocation A = { Offset, Size, MakeTag(Frame, Thread, i) };
+                        Fill(Buffer.data(), A);
+                        Mine.push_back(A);
+                    }
+                });
+            }
+            for (std::thread& Worker : Workers)
+            {
+                Worker.join();
+            }
+
+            Result.AllocateMilliseconds += std::chrono::duration<double, std::milli>(Clock::now() - Start).count();
+
+            for (uint32_t Thread = 0; Thread < options.Threads; ++Thread)
+            {
+                Result.Overflows += ThreadOverflows[Thread];
+                Record.Allocations.insert(Record.Allocations.end(), ThreadAllocations[Thread].begin(), ThreadAllocations[Thread].end());
+            }
+            Result.AllocationCount += Record.Allocations.size();
+
+            // Every piece aligned, inside this slot's region and apart from every other.
+            std::vector<Allocation> Sorted = Record.Allocations;
+            std::sort(Sorted.begin(), Sorted.end(), [](const Allocation& a, const Allocation& b) { return a.Offset < b.Offset; });
+
+            const uint64_t RegionBegin = (uint64_t)Slot * Allocator.GetRegionSize();
+            const uint64_t RegionEnd = RegionBegin + Allocator.GetRegionSize();
+            for (size_t i = 0; i < Sorted.size(); ++i)
+            {
+                if (Sorted[i].Offset % FrameUploadAllocator::DefaultAlignment != 0)
+                    ++Result.Misaligned;
+                if (Sorted[i].Offset < RegionBegin || Sorted[i].Offset + Sorted[i].Size > RegionEnd)
+                    ++Result.Overlaps;
+                if (i > 0 && Sorted[i - 1].Offset + Sorted[i - 1].Size > Sorted[i].Offset)
+                    ++Result.Overlaps;
+            }
+
+            Items += options.Grow;
+        }
+
+        for (FrameRecord& Record : Slots)
+        {
+            CheckSlot(Record);
+        }
+
+        Allocator.BeginFrame(0);
+        Result.Peak = Allocator.GetPeak();
+        Result.RegionSize = Allocator.GetRegionSize();
+        return Result;
+    }
+
+    // Times only the allocations of RunFrames' thread pattern, through FrameUploadAllocator
+    // or through a bump pointer behind a mutex.
+    double TimeAllocation(const UploadSimOptions& options, bool bLocked)
+    {
+        const uint64_t RegionSize = (uint64_t)options.Threads * options.Allocations * MaxThreadAllocation;
+
+        FrameUploadAllocator Allocator;
+        Allocator.Reset(RegionSize, FrameCount);
+
+        std::mutex Lock;
+        uint64_t Offset = 0;
+        std::vector<uint64_t> Sums(options.Threads, 0);
+
+        typedef std::chrono::high_resolution_clock Clock;
+        double Milliseconds = 0.0;
+
+        for (uint32_t Frame = 0; Frame < options.Frames; ++Frame)
+        {
+            Offset = 0;
+            Allocator.BeginFrame(Frame % FrameCount);
+
+            const Clock::time_point Start = Clock::now();
+
+            std::vector<std::thread> Workers;
+            for (uint32_t Thread = 0; Thread < options.Threads; ++Thread)
+            {
+                Workers.emplace_back([&, Thread]()
+                {
+                    std::mt19937 Random(options.Seed + Frame * 131 + Thread);
+                    for (uint32_t i = 0; i < options.Allocations; ++i)
+                    {
+                        const uint64_t Size = ((Random() % MaxThreadAllocation) + 4) & ~3ull;
+
+                        if (bLocked)
+                        {
+                            std::lock_guard<std::mutex> Guard(Lock);
+                            const uint64_t Begin = FrameUploadAllocator::AlignUp(Offset, FrameUploadAllocator::DefaultAlignment);
+                            Offset = Begin + Size;
+                            Sums[Thread] += Begin;
+                        }
+                        else
+                            Sums[Thread] += Allocator.Allocate(Size);
+                    }
+                });
+            }
+            for (std::thread& Worker : Workers)
+            {
+                Worker.join();
+            }
+
+            Milliseconds += std::chrono::duration<double, std::milli>(Clock::now() - Start).count();
+        }
+
+        return Milliseconds;
+    }
+}
+
+int RunUploadSim(const std::vector<std::string>& args)
+{
+    UploadSimOptions Options;
+    if (!ParseOptions(args, Options))
+    {
+        fprintf(stderr, "usage: TextureTool upload-sim [--frames n] [--items n] [--grow n] [-j threads] [--allocations n] [--seed n]\n");
+        return 1;
+    }
+
+    printf("%u frames, %u frame slots, %u items growing by %u per frame, %u threads x %u allocations\n",
+        Options.Frames, FrameCount, Options.Items, Options.Grow, Options.Threads, Options.Allocations);
+
+    const SimResult Result = RunFrames(Options);
+
+    // Timing without the fills and checks, so the allocator itself is what is measured.
+    const uint32_t TimingFrames = (std::min)(Options.Frames, 50u);
+    UploadSimOptions TimingOptions = Options;
+    TimingOptions.Frames = TimingFrames;
+    const double LockFreeMilliseconds = TimeAllocation(TimingOptions, false);
+    const double LockedMilliseconds = TimeAllocation(TimingOptions, true);
+
+    printf("  allocations      %llu\n", (unsigned long long)Result.AllocationCount);
+    printf("  region           %llu KB per slot, peak %llu KB used\n",
+        (unsigned long long)(Result.RegionSize / 1024), (unsigned long long)(Result.Peak / 1024));
+    printf("  regrows          %u\n", Result.Regrows);
+    printf("  fill             %.3f ms per frame\n", Result.AllocateMilliseconds / Options.Frames);
+    printf("  lock-free        %.3f ms per frame\n", LockFreeMilliseconds / TimingFrames);
+    printf("  mutex bump       %.3f ms per frame\n", LockedMilliseconds / TimingFrames);
+
+    bool bOk = true;
+    auto Expect = [&bOk](uint32_t count, const char* what)
+    {
+        if (count != 0)
+        {
+            printf("    %u %s\n", count, what);
+            bOk = false;
+        }
+    };
+    Expect(Result.Overflows, "allocations did not fit their region");
+    Expect(Result.Misaligned, "allocations were not 256 byte aligned");
+    Expect(Result.Overlaps, "allocations overlapped each other or left their region");
+    Expect(Result.Corrupted, "allocations were overwritten before their slot came round again");
+    Expect(Result.MovedObjectBlocks, "object blocks moved within their slot with a fixed item count");
+
+    printf(bOk ? "ok\n" : "FAILED\n");
+    return bOk ? 0 : 1;
+}
@@ -0,0 +1,219 @@
+//***************************************************************************************
+// TextureTool: offline processing for the sample's textures, plus headless checks of
+// the sample's API-independent pieces.  Has no Direct3D dependency so it runs on any
+// platform with a C++17 compiler.
+//***************************************************************************************
+
+#include "Commands.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+    void PrintUsage()
+    {
+        printf(
+            "usage: TextureTool <command> [options]\n"
+            "\n"
+            "  bvh-bench [--frames n] [--queries n] [--seed n] [count...]\n"
+            "      Builds, updates and queries DynamicBVH over synthetic open levels (default 1000 up to\n"
+            "      1000000 items, one in ten moving), checks every query against brute force, and reports\n"
+            "      build, update and query times and the tree's SAH cost.\n"
+            "\n"
+            "  cb-bench [--items n] [--frames n] [--seed n] [moving...]\n"
+            "      Updates per-frame-slot object constants for a mostly static scene (default 100000 items\n"
+            "      with 0, 100, 1000 and 10000 moving per frame) by full rewrites and through DirtyTracker,\n"
+            "      checks that every slot ends up identical, and compares bytes written and time.\n"
+            "\n"
+            "  compress [-o dir] [-f bc1|bc3|bc4|bc5|bc7] [--normal] [-j threads] <input.dds>...\n"
+            "      Block-compresses each input with a full mip chain and reports speed and PSNR.\n"
+            "      Files named *_nmap* (or --normal) go to BC5, files with alpha to BC3, others to BC1.\n"
+            "\n"
+            "  cull-bench [--repeats n] [--seed n] [count...]\n"
+            "      Frustum-culls random boxes (default 1000, 10000 and 100000) with FrustumCuller's scalar\n"
+            "      and AVX paths, checks both against a double-precision clip-space reference, and\n"
+            "      compares their speed.\n"
+            "\n"
+            "  descriptor-sim [--frames n] [--latency n] [--textures n] [--swaps n] [--materials n]\n"
+            "                 [--persistent n] [--transient n] [--seed n]\n"
+            "      Streams view swaps and per-frame tables through DescriptorAllocator (the sample's\n"
+            "      descriptor heap) with fence-delayed release, checks that no slot the GPU may still\n"
+            "      read is handed out again and that freed slots merge back into one range.\n"
+            "\n"
+            "  draw-sort [--items n] [--materials n] [--textures n] [--geometries n] [--seed n]\n"
+            "      Orders the sample's scene and a synthetic scene (default 10000 items) by draw sort key,\n"
+            "      checks the radix sort against std::stable_sort and the depth order, and counts the\n"
+            "      binding and draw calls with and without sorting and state tracking.\n"
+            "\n"
+            "  frame-sim [--frames n] [--cpu ms] [--gpu ms] [--latency ms]\n"
+            "      Drives FrameResourceRing against a simulated GPU queue and fence, comparing a flush\n"
+            "      every frame with 1-4 frames in flight, and checks that no slot is overwritten while\n"
+            "      the GPU still reads it.\n"
+            "\n"
+            "  heap-sim [--ops n] [--heap-mb n] [--block-mb n] [--defrag-mb n] [--seed n]\n"
+            "      Fuzzes TLSFAllocator (the GPU heap placement allocator) with 4KB, 64KB and 4MB aligned\n"
+            "      resources, checking alignment and overlap, then streams resources through a\n"
+            "      HeapBlockPool, applies a defragmentation plan and reports the heaps it releases and\n"
+            "      the memory saved over committed resources.\n"
+            "\n"
+            "  instance-sim [--items n] [--meshes n] [--materials n] [--textures n] [--repeats n] [--seed n]\n"
+            "      Records a synthetic scene (default 50000 items, 20 meshes) per item and with automatic\n"
+            "      instancing into mock command lists, checks that the batches cover every item with one\n"
+            "      mesh and material each, and compares draw and binding calls and recording time.\n"
+            "\n"
+            "  load-bench [--runs n] [-j threads] <dir|file.dds>...\n"
+            "      Loads the given textures the way BuildTextures did before TextureBatchLoader (a read\n"
+            "      and an upload heap per file) and the way the loader does now (mapped, planned and copied\n"
+            "      on the thread pool into one staging buffer), checks that both lay out the same bytes,\n"
+            "      and compares time and heap memory.\n"
+            "\n"
+            "  mips [-o dir] [-f box|kaiser|lanczos] [--normal] [--linear] [--wrap] [--scalar] [-j threads] <input.dds|input.bmp>...\n"
+            "      Rebuilds the full mip chain of each input in float.  Colour is filtered in linear light\n"
+            "      unless --linear is given; normal maps are renormalized per level.\n"
+            "\n"
+            "  mips --bench [size]\n"
+            "      Times every filter on a synthetic image (default 4096) and checks the SIMD kernels\n"
+            "      against the scalar reference.\n"
+            "\n"
+            "  pack [-o dir] [--atlas-size n] [--atlas-max n] [--atlas-mips n] [--gutter n] [--no-atlas] [--dry-run] <colour.dds>...\n"
+            "      Groups textures of the same format, size and mip count (with their *_nmap companions)\n"
+            "      into arrays and packs small leftovers into atlases, then writes packs.txt for the sample.\n"
+            "      --dry-run prints the plan and the descriptor table count without writing anything.\n"
+            "\n"
+            "  permutations [--fxc outdir] [--bindless]\n"
+            "      Lists the valid object shader permutations with their defines and the vertex and pixel\n"
+            "      variants each pipeline uses, and checks the key to index table.  --fxc prints fxc\n"
+            "      command lines that compile the whole set offline instead, into outdir/Bindless with\n"
+            "      --bindless.  With outdir ../Shader/Compiled the sample loads them instead of compiling.\n"
+            "\n"
+            "  probe [-r] [--csv] [--summary] [-j threads] <dir|file.dds>...\n"
+            "      Reads only the header of each file and lists size, mips, format and texel bytes,\n"
+            "      with totals per format.  Directories are scanned for .dds files (-r recurses).\n"
+            "\n"
+            "  probe --verify [file.dds...]\n"
+            "      Cross-checks the probe's format tables and header parsing against the loader's.\n"
+            "\n"
+            "  range-sim [--capacity n] [--ops n] [--max n] [--seed n]\n"
+            "      Allocates and frees random ranges through RangeAllocator (the geometry pool's free\n"
+            "      list), checks that no unit is handed out twice and that everything merges back into\n"
+            "      one range, and reports fragmentation.\n"
+            "\n"
+            "  read-bench [--backend auto|threads|native] [--depth n] [--passes n] [--cold] <dir|file>...\n"
+            "      Reads every file through AsyncFileQueue and through blocking ifstream reads and\n"
+            "      compares throughput.  --cold drops the files from the page cache before each pass.\n"
+            "\n"
+            "  record-sim [--frames n] [--items n] [--chunk n] [-j threads] [--work n]\n"
+            "      Records a frame shaped like the sample's through CommandListRecorder into mock command\n"
+            "      lists, serially and on the thread pool, checks that every list sets its own state and\n"
+            "      that the submitted stream matches the serial one, and compares recording time.\n"
+            "\n"
+            "  ring-sim [--frames n] [--latency n] [--uploads n] [--max-kb n] [--ring-mb n] [--seed n]\n"
+            "      Streams random uploads through RingAllocator (the upload ring) with fence-delayed\n"
+            "      release, checks that no live space is handed out twice, and compares copy throughput\n"
+            "      and resident upload memory with an upload buffer per load.\n"
+            "\n"
+            "  scatter-bench [--size n] [--cell n] [--repeats n] [--seed n]\n"
+            "      Builds the sample's vegetation scatter (default 1024 x 1024, trees and grass), checks\n"
+            "      that a rebuild is identical and no two instances of a layer are closer than its minimum\n"
+            "      distance, culls it from several views against brute force, and reports build time and\n"
+            "      instances culled per millisecond.\n"
+            "\n"
+            "  shader-cache [--shaders n] [--includes n] [--seed n]\n"
+            "      Stores synthetic shader permutations in a ShaderCache, checks that a second run hits\n"
+            "      every entry, that editing an include invalidates exactly the permutations using it\n"
+            "      and reverting the edit hits again, and that other defines or a damaged entry miss,\n"
+            "      and reports cold and warm times.\n"
+            "\n"
+            "  stream-sim [--textures n] [--frames n] [--budget-mb n] [--max-pending n] [--latency n] [--seed n]\n"
+            "      Walks a camera past synthetic textures and drives TextureStreamingPolicy with their\n"
+            "      footprints, checks that the budget holds, that evictions go least recently used first\n"
+            "      and never touch the tail mips, and that in-flight requests stay within the limit.\n"
+            "\n"
+            "  task-graph [--shaders n] [--pipelines n] [--compile-us n] [--pso-us n] [-j threads] [--seed n]\n"
+            "      Runs fake shader compiles feeding fake pipeline state creation through TaskGraph,\n"
+            "      serially and on the thread pool, checks that every task ran once and after its\n"
+            "      dependencies and that a failed compile skips only its dependents, and compares times.\n"
+            "\n"
+            "  upload-sim [--frames n] [--items n] [--grow n] [-j threads] [--allocations n] [--seed n]\n"
+            "      Allocates a growing scene's constants and per-thread pieces from FrameUploadAllocator\n"
+            "      every frame, checks that they are aligned, never overlap and survive until their slot\n"
+            "      comes round again, and compares lock-free allocation with a mutex.\n");
+    }
+}
+
+std::string GetFileName(const std::string& path)
+{
+    size_t Slash = path.find_last_of("/\\");
+    return Slash == std::string::npos ? path : path.substr(Slash + 1);
+}
+
+std::string JoinPath(const std::string& directory, const std::string& fileName)
+{
+    if (directory.empty())
+        return fileName;
+
+    char Last = directory.back();
+    return (Last == '/' || Last == '\\') ? directory + fileName : directory + "/" + fileName;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    std::vector<std::string> Args(argv + 2, argv + argc);
+
+    if (strcmp(argv[1], "bvh-bench") == 0)
+        return RunBvhBench(Args);
+    if (strcmp(argv[1], "cb-bench") == 0)
+        return RunCBBench(Args);
+    if (strcmp(argv[1], "compress") == 0)
+        return RunCompress(Args);
+    if (strcmp(argv[1], "cull-bench") == 0)
+        return RunCullBench(Args);
+    if (strcmp(argv[1], "descriptor-sim") == 0)
+        return RunDescriptorSim(Args);
+    if (strcmp(argv[1], "draw-sort") == 0)
+        return RunDrawSort(Args);
+    if (strcmp(argv[1], "frame-sim") == 0)
+        return RunFrameSim(Args);
+    if (strcmp(argv[1], "heap-sim") == 0)
+        return RunHeapSim(Args);
+    if (strcmp(argv[1], "instance-sim") == 0)
+        return RunInstanceSim(Args);
+    if (strcmp(argv[1], "load-bench") == 0)
+        return RunLoadBench(Args);
+    if (strcmp(argv[1], "mips") == 0)
+        return RunMips(Args);
+    if (strcmp(argv[1], "pack") == 0)
+        return RunPack(Args);
+    if (strcmp(argv[1], "permutations") == 0)
+        return RunPermutations(Args);
+    if (strcmp(argv[1], "probe") == 0)
+        return RunProbe(Args);
+    if (strcmp(argv[1], "range-sim") == 0)
+        return RunRangeSim(Args);
+    if (strcmp(argv[1], "read-bench") == 0)
+        return RunReadBench(Args);
+    if (strcmp(argv[1], "record-sim") == 0)
+        return RunRecordSim(Args);
+    if (strcmp(argv[1], "ring-sim") == 0)
+        return RunRingSim(Args);
+    if (strcmp(argv[1], "scatter-bench") == 0)
+        return RunScatterBench(Args);
+    if (strcmp(argv[1], "shader-cache") == 0)
+        return RunShaderCache(Args);
+    if (strcmp(argv[1], "stream-sim") == 0)
+        return RunStreamSim(Args);
+    if (strcmp(argv[1], "task-graph") == 0)
+        return RunTaskGraph(Args);
+    if (strcmp(argv[1], "upload-sim") == 0)
+        return RunUploadSim(Args);
+
+    PrintUsage();
+    return 1;
+}